@@ -0,0 +1,201 @@
+#include "stdafx.h"
+#include "CAssetCache.h"
+#include "mywow.h"
+#include "CMappedFile.h"
+
+#define ASSET_CACHE_MAGIC		0x4341574D		//"MWAC"
+#define ASSET_CACHE_ALIGN(x)		(((x) + 15) & ~15)
+
+static const c8* g_assetCacheTypeDirs[EACT_COUNT] =
+{
+	"m2",
+	"wmogroup",
+	"adt",
+};
+
+CAssetCache::CAssetCache( const c8* baseDir )
+	: NumHits(0), NumMisses(0), NumWrites(0)
+{
+	Q_strcpy(CacheDir, QMAX_PATH, baseDir);
+	normalizeFileName(CacheDir);
+	u32 len = (u32)strlen(CacheDir);
+	if (len > 0 && CacheDir[len - 1] != '/')
+		Q_strcat(CacheDir, QMAX_PATH, "/");
+	Q_strcat(CacheDir, QMAX_PATH, "AssetCache/");
+
+	INIT_LOCK(&cs);
+}
+
+CAssetCache::~CAssetCache()
+{
+	DESTROY_LOCK(&cs);
+}
+
+u64 CAssetCache::combineStamp( u64 stamp, u64 other )
+{
+	//fnv-1a, 8ֽڻ, ˳й
+	stamp ^= other;
+	stamp *= 1099511628211ULL;
+	return stamp;
+}
+
+u64 CAssetCache::hashFileName( const c8* filename )
+{
+	u64 h = 14695981039346656037ULL;			//fnv-1a, ִСдͷָ
+	for (const c8* p = filename; *p; ++p)
+	{
+		c8 c = *p;
+		if (c == '\\')
+			c = '/';
+		else if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		h ^= (u8)c;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+void CAssetCache::getCachePath( E_ASSET_CACHE_TYPE type, u64 nameHash, c8* path, u32 size ) const
+{
+	Q_sprintf(path, size, "%s%s/%08x%08x.bin", CacheDir, g_assetCacheTypeDirs[type], (u32)(nameHash >> 32), (u32)(nameHash & 0xffffffff));
+}
+
+bool CAssetCache::load( E_ASSET_CACHE_TYPE type, const c8* filename, u64 srcStamp, SEntry& entry )
+{
+	ASSERT(type < EACT_COUNT);
+	ASSERT(!entry.File);
+
+	u64 nameHash = hashFileName(filename);
+
+	c8 path[QMAX_PATH];
+	getCachePath(type, nameHash, path, QMAX_PATH);
+
+	//ӳļ, ֻϻַ
+	CMappedFile* file = new CMappedFile(path, path);
+	if (!file->isValid())
+	{
+		delete file;
+		ATOMIC_INCREMENT(&NumMisses);
+		return false;
+	}
+
+	u32 fileSize = file->getSize();
+	const u8* block = file->getBuffer();
+	SHeader header;
+	if (fileSize < sizeof(SHeader))
+		memset(&header, 0, sizeof(SHeader));
+	else
+		memcpy(&header, block, sizeof(SHeader));
+
+	if (header.magic != ASSET_CACHE_MAGIC ||
+		header.version != CACHE_VERSION ||
+		header.type != (u32)type ||
+		header.nameHash != nameHash ||
+		header.srcStamp != srcStamp ||
+		header.totalSize != fileSize ||
+		header.numSections > MAX_SECTIONS ||
+		fileSize < sizeof(SHeader) + sizeof(SSection) * header.numSections)
+	{
+		delete file;
+		ATOMIC_INCREMENT(&NumMisses);
+		return false;
+	}
+
+	bool ok = true;
+	const SSection* sections = (const SSection*)(block + sizeof(SHeader));
+	for (u32 i=0; ok && i<header.numSections; ++i)
+	{
+		if (sections[i].offset > fileSize || sections[i].size > fileSize - sections[i].offset)
+			ok = false;
+	}
+
+	if (!ok)
+	{
+		delete file;
+		ATOMIC_INCREMENT(&NumMisses);
+		return false;
+	}
+
+	entry.File = file;
+	entry.NumSections = header.numSections;
+	for (u32 i=0; i<header.numSections; ++i)
+	{
+		entry.Sections[i].data = sections[i].size ? block + sections[i].offset : NULL_PTR;
+		entry.Sections[i].size = sections[i].size;
+	}
+
+	ATOMIC_INCREMENT(&NumHits);
+	return true;
+}
+
+void CAssetCache::release( SEntry& entry )
+{
+	delete entry.File;
+	entry.File = NULL_PTR;
+	entry.NumSections = 0;
+}
+
+bool CAssetCache::save( E_ASSET_CACHE_TYPE type, const c8* filename, u64 srcStamp, const SAssetCacheSection* sections, u32 numSections )
+{
+	ASSERT(type < EACT_COUNT);
+	ASSERT(numSections <= MAX_SECTIONS);
+
+	u64 nameHash = hashFileName(filename);
+
+	c8 path[QMAX_PATH];
+	getCachePath(type, nameHash, path, QMAX_PATH);
+
+	//ڴƴúһд
+	u32 offset = ASSET_CACHE_ALIGN((u32)(sizeof(SHeader) + sizeof(SSection) * numSections));
+	SSection secs[MAX_SECTIONS];
+	for (u32 i=0; i<numSections; ++i)
+	{
+		secs[i].offset = offset;
+		secs[i].size = sections[i].size;
+		offset = ASSET_CACHE_ALIGN(offset + sections[i].size);
+	}
+
+	SHeader header;
+	header.magic = ASSET_CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.type = (u32)type;
+	header.numSections = numSections;
+	header.nameHash = nameHash;
+	header.srcStamp = srcStamp;
+	header.totalSize = offset;
+
+	u8* block = new u8[offset];
+	memset(block, 0, offset);
+	memcpy(block, &header, sizeof(SHeader));
+	memcpy(block + sizeof(SHeader), secs, sizeof(SSection) * numSections);
+	for (u32 i=0; i<numSections; ++i)
+	{
+		if (sections[i].size)
+			memcpy(block + secs[i].offset, sections[i].data, sections[i].size);
+	}
+
+	bool ret = false;
+
+	BEGIN_LOCK(&cs);
+
+	if (Q_MakeDirForFileName(path))
+	{
+		IWriteFile* file = g_Engine->getFileSystem()->createAndWriteFile(path, true);
+		if (file)
+		{
+			ret = file->write(block, offset) == offset;
+			delete file;
+		}
+	}
+
+	END_LOCK(&cs);
+
+	delete[] block;
+
+	if (ret)
+		ATOMIC_INCREMENT(&NumWrites);
+	else
+		g_Engine->getFileSystem()->writeLog(ELOG_RES, "CAssetCache::save failed: %s", path);
+
+	return ret;
+}
@@ -0,0 +1,529 @@
+#include "stdafx.h"
+#include "CAudioDecodeServices.h"
+#include "mywow.h"
+#include "CWavInput.h"
+#include "CVorbisInput.h"
+#include "CMP3Input.h"
+
+#ifdef MW_PLATFORM_WINDOWS
+
+CAudioStream::CAudioStream( CAudioDecodeServices* services, const string256& name )
+	: Services(services), Name(name), Input(NULL_PTR), Clip(NULL_PTR), ClipPos(0),
+	Ring(NULL_PTR), Chunk(NULL_PTR), RingSize(0), ReadPos(0), WritePos(0), DecodedSinceReset(0),
+	RecordAllowed(false), Recording(false), InputEnd(false), Loop(false)
+{
+	BitsPerSample = 0;
+	NumChannels = 0;
+	SampleRate = 0;
+
+	INIT_LOCK(&cs);
+}
+
+CAudioStream::~CAudioStream()
+{
+	if (Input)
+	{
+		Input->closeFile();
+		delete Input;
+	}
+
+	delete[] Ring;
+	delete[] Chunk;
+
+	DESTROY_LOCK(&cs);
+}
+
+u32 CAudioStream::read( void* buffer, u32 size )
+{
+	u8* dest = (u8*)buffer;
+	u32 copied = 0;
+
+	BEGIN_LOCK(&cs);
+
+	if (Clip)
+	{
+		const u32 clipSize = (u32)Clip->data.size();
+		while (copied < size)
+		{
+			if (ClipPos >= clipSize)
+			{
+				if (!Loop || clipSize == 0)
+					break;
+				ClipPos = 0;
+			}
+
+			u32 n = min_(size - copied, clipSize - ClipPos);
+			memcpy(dest + copied, &Clip->data[ClipPos], n);
+			ClipPos += n;
+			copied += n;
+		}
+
+		END_LOCK(&cs);
+		return copied;
+	}
+
+	copied = readRingLocked(dest, size);
+
+	//߳û, ﲹ
+	bool underrun = false;
+	while (copied < size && !InputEnd)
+	{
+		underrun = true;
+		if (decodeLocked(size - copied) == 0 && WritePos == ReadPos)
+			break;
+		copied += readRingLocked(dest + copied, size - copied);
+	}
+
+	END_LOCK(&cs);
+
+	if (underrun)
+		ATOMIC_INCREMENT(&Services->Underruns);
+
+	SET_EVENT(&Services->WakeEvent);
+
+	return copied;
+}
+
+void CAudioStream::rewind()
+{
+	BEGIN_LOCK(&cs);
+
+	ClipPos = 0;
+
+	if (Input)
+	{
+		Input->reset();
+
+		ReadPos = WritePos = 0;
+		DecodedSinceReset = 0;
+		InputEnd = false;
+
+		Record.clear();
+		Recording = RecordAllowed;
+	}
+
+	END_LOCK(&cs);
+
+	SET_EVENT(&Services->WakeEvent);
+}
+
+void CAudioStream::setLoop( bool loop )
+{
+	BEGIN_LOCK(&cs);
+
+	//߳̿ѭǰѾ⵽ļβ, Ŵͷ
+	if (loop && !Loop && Input && InputEnd && DecodedSinceReset > 0)
+	{
+		Input->reset();
+		DecodedSinceReset = 0;
+		InputEnd = false;
+	}
+	Loop = loop;
+
+	END_LOCK(&cs);
+
+	SET_EVENT(&Services->WakeEvent);
+}
+
+bool CAudioStream::isEnd() const
+{
+	bool end;
+
+	BEGIN_LOCK(&cs);
+	if (Clip)
+		end = !Loop && ClipPos >= (u32)Clip->data.size();
+	else
+		end = InputEnd && WritePos == ReadPos;
+	END_LOCK(&cs);
+
+	return end;
+}
+
+u32 CAudioStream::readRingLocked( u8* dest, u32 size )
+{
+	u32 avail = WritePos - ReadPos;
+	u32 total = min_(size, avail);
+
+	u32 offset = ReadPos % RingSize;
+	u32 first = min_(total, RingSize - offset);
+	memcpy(dest, Ring + offset, first);
+	if (total > first)
+		memcpy(dest + first, Ring, total - first);
+
+	ReadPos += total;
+	return total;
+}
+
+u32 CAudioStream::decodeLocked( u32 maxBytes )
+{
+	if (!Input || InputEnd)
+		return 0;
+
+	const u32 sampleSize = getSampleSize();
+	u32 freeBytes = RingSize - (WritePos - ReadPos);
+	u32 want = min_(min_(freeBytes, maxBytes), (u32)CAudioDecodeServices::DECODE_CHUNK_SIZE);
+	want -= want % sampleSize;
+	if (want == 0)
+		return 0;
+
+	//Ƚ⵽Chunkٿλ, Ҫ
+	u32 got = 0;
+	while (got < want)
+	{
+		u32 n = Input->fillBuffer(Chunk + got, want - got);
+		if (n == 0)
+		{
+			onInputEndLocked();
+
+			if (Loop && DecodedSinceReset > 0)			//ļѭ
+			{
+				Input->reset();
+				DecodedSinceReset = 0;
+				continue;
+			}
+
+			InputEnd = true;
+			break;
+		}
+
+		if (Recording)
+		{
+			if (Record.size() + n > Services->MaxClipSize)
+			{
+				Recording = false;
+				RecordAllowed = false;
+				std::vector<u8>().swap(Record);
+				Services->markLongStream(Name);
+			}
+			else
+			{
+				Record.insert(Record.end(), Chunk + got, Chunk + got + n);
+			}
+		}
+
+		got += n;
+		DecodedSinceReset += n;
+	}
+
+	u32 offset = WritePos % RingSize;
+	u32 first = min_(got, RingSize - offset);
+	memcpy(Ring + offset, Chunk, first);
+	if (got > first)
+		memcpy(Ring, Chunk + first, got - first);
+
+	WritePos += got;
+	return got;
+}
+
+void CAudioStream::onInputEndLocked()
+{
+	if (!Recording)
+		return;
+
+	//ļ¼, 뻺湩´β
+	if (!Record.empty())
+		Services->publishClip(Name, Record, BitsPerSample, NumChannels, SampleRate);
+
+	std::vector<u8>().swap(Record);
+	Recording = false;
+	RecordAllowed = false;
+}
+
+CAudioDecodeServices::CAudioDecodeServices( u32 cacheLimit, u32 maxClipSize )
+	: CacheSize(0), CacheLimit(cacheLimit), MaxClipSize(maxClipSize),
+	CacheHits(0), CacheMisses(0), Underruns(0), Quit(0)
+{
+	INIT_LOCK(&cs);
+	INIT_LOCK(&cacheCS);
+	INIT_EVENT(&WakeEvent, NULL_PTR);
+
+	INIT_THREAD(&Thread, DecodeThreadFunc, this, false);
+}
+
+CAudioDecodeServices::~CAudioDecodeServices()
+{
+	ATOMIC_INCREMENT(&Quit);
+	SET_EVENT(&WakeEvent);
+
+	if (!WAIT_THREAD(&Thread))
+	{
+		ASSERT(false);
+	}
+	DESTROY_THREAD(&Thread);
+
+	ASSERT(Streams.empty());
+	for (u32 i=0; i<(u32)Streams.size(); ++i)
+		delete Streams[i];
+	Streams.clear();
+
+	for (T_ClipList::iterator itr = ClipLRU.begin(); itr != ClipLRU.end(); ++itr)
+		delete (*itr);
+	ClipLRU.clear();
+	ClipMap.clear();
+
+	DESTROY_EVENT(&WakeEvent);
+	DESTROY_LOCK(&cacheCS);
+	DESTROY_LOCK(&cs);
+}
+
+CAudioStream* CAudioDecodeServices::openStream( const c8* filename, E_SOUND_TYPE type )
+{
+	string256 name(filename);
+	name.normalize();
+	name.make_lower();
+
+	CAudioStream* stream = new CAudioStream(this, name);
+
+	SPCMClip* clip = acquireClip(name);
+	if (clip)
+	{
+		ATOMIC_INCREMENT(&CacheHits);
+
+		stream->Clip = clip;
+		stream->BitsPerSample = clip->bitsPerSample;
+		stream->NumChannels = clip->numChannels;
+		stream->SampleRate = clip->sampleRate;
+		return stream;
+	}
+
+	ATOMIC_INCREMENT(&CacheMisses);
+
+	IAudioInput* input;
+	switch (type)
+	{
+	case EST_WAV:
+		input = new CWavInput;
+		break;
+	case EST_OGG:
+		input = new CVorbisInput;
+		break;
+	case EST_MP3:
+		input = new CMP3Input;
+		break;
+	default:
+		ASSERT(false);
+		input = NULL_PTR;
+		break;
+	}
+
+	if (!input || !input->openFile(filename) || !input->getSampleSize() || !input->SampleRate)
+	{
+		delete input;
+		delete stream;
+		return NULL_PTR;
+	}
+
+	stream->Input = input;
+	stream->BitsPerSample = input->BitsPerSample;
+	stream->NumChannels = input->NumChannels;
+	stream->SampleRate = input->SampleRate;
+
+	//λȡС
+	u32 bytesPerSecond = input->SampleRate * input->getSampleSize();
+	u32 ringSize = bytesPerSecond / 1000 * RING_MILLISECONDS;
+	ringSize = (ringSize + DECODE_CHUNK_SIZE - 1) / DECODE_CHUNK_SIZE * DECODE_CHUNK_SIZE;
+	stream->RingSize = max_(ringSize, (u32)DECODE_CHUNK_SIZE * 2);
+	stream->Ring = new u8[stream->RingSize];
+	stream->Chunk = new u8[DECODE_CHUNK_SIZE];
+
+	stream->RecordAllowed = MaxClipSize > 0 && !isLongStream(name);
+	stream->Recording = stream->RecordAllowed;
+
+	BEGIN_LOCK(&cs);
+	Streams.push_back(stream);
+	END_LOCK(&cs);
+
+	SET_EVENT(&WakeEvent);
+
+	return stream;
+}
+
+void CAudioDecodeServices::closeStream( CAudioStream* stream )
+{
+	if (!stream)
+		return;
+
+	BEGIN_LOCK(&cs);
+	for (u32 i=0; i<(u32)Streams.size(); ++i)
+	{
+		if (Streams[i] == stream)
+		{
+			Streams[i] = Streams.back();
+			Streams.pop_back();
+			break;
+		}
+	}
+	END_LOCK(&cs);
+
+	if (stream->Clip)
+		releaseClip(stream->Clip);
+
+	delete stream;
+}
+
+void CAudioDecodeServices::setCacheLimit( u32 limit )
+{
+	BEGIN_LOCK(&cacheCS);
+	CacheLimit = limit;
+	trimCacheLocked();
+	END_LOCK(&cacheCS);
+}
+
+void CAudioDecodeServices::flushCache()
+{
+	BEGIN_LOCK(&cacheCS);
+	for (T_ClipList::iterator itr = ClipLRU.begin(); itr != ClipLRU.end();)
+	{
+		SPCMClip* clip = (*itr);
+		if (clip->refCount == 0)
+		{
+			CacheSize -= (u32)clip->data.size();
+			ClipMap.erase(clip->name);
+			delete clip;
+			itr = ClipLRU.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+	END_LOCK(&cacheCS);
+}
+
+void CAudioDecodeServices::getStats( SAudioDecodeStats& stats ) const
+{
+	stats.cacheHits = (u32)ATOMIC_LOAD(&CacheHits);
+	stats.cacheMisses = (u32)ATOMIC_LOAD(&CacheMisses);
+	stats.underruns = (u32)ATOMIC_LOAD(&Underruns);
+
+	BEGIN_LOCK(&cacheCS);
+	stats.numClips = (u32)ClipLRU.size();
+	stats.cacheSize = CacheSize;
+	END_LOCK(&cacheCS);
+}
+
+SPCMClip* CAudioDecodeServices::acquireClip( const string256& name )
+{
+	SPCMClip* clip = NULL_PTR;
+
+	BEGIN_LOCK(&cacheCS);
+	T_ClipMap::iterator itr = ClipMap.find(name);
+	if (itr != ClipMap.end())
+	{
+		clip = *(itr->second);
+		++clip->refCount;
+		ClipLRU.splice(ClipLRU.begin(), ClipLRU, itr->second);
+	}
+	END_LOCK(&cacheCS);
+
+	return clip;
+}
+
+void CAudioDecodeServices::releaseClip( SPCMClip* clip )
+{
+	BEGIN_LOCK(&cacheCS);
+	ASSERT(clip->refCount > 0);
+	--clip->refCount;
+	trimCacheLocked();
+	END_LOCK(&cacheCS);
+}
+
+void CAudioDecodeServices::publishClip( const string256& name, std::vector<u8>& data, u32 bitsPerSample, u32 numChannels, u32 sampleRate )
+{
+	BEGIN_LOCK(&cacheCS);
+
+	if (ClipMap.find(name) == ClipMap.end() && data.size() <= CacheLimit)
+	{
+		SPCMClip* clip = new SPCMClip;
+		clip->name = name;
+		clip->data.swap(data);
+		clip->bitsPerSample = bitsPerSample;
+		clip->numChannels = numChannels;
+		clip->sampleRate = sampleRate;
+		clip->refCount = 0;
+
+		ClipLRU.push_front(clip);
+		ClipMap[name] = ClipLRU.begin();
+		CacheSize += (u32)clip->data.size();
+
+		trimCacheLocked();
+	}
+
+	END_LOCK(&cacheCS);
+}
+
+void CAudioDecodeServices::markLongStream( const string256& name )
+{
+	BEGIN_LOCK(&cacheCS);
+	LongStreams.insert(name);
+	END_LOCK(&cacheCS);
+}
+
+bool CAudioDecodeServices::isLongStream( const string256& name ) const
+{
+	BEGIN_LOCK(&cacheCS);
+	bool ret = LongStreams.find(name) != LongStreams.end();
+	END_LOCK(&cacheCS);
+	return ret;
+}
+
+void CAudioDecodeServices::trimCacheLocked()
+{
+	//δõĿʼɾ, ڲŵ
+	T_ClipList::iterator itr = ClipLRU.end();
+	while (CacheSize > CacheLimit && itr != ClipLRU.begin())
+	{
+		--itr;
+		SPCMClip* clip = (*itr);
+		if (clip->refCount)
+			continue;
+
+		CacheSize -= (u32)clip->data.size();
+		ClipMap.erase(clip->name);
+		delete clip;
+		itr = ClipLRU.erase(itr);
+	}
+}
+
+void CAudioDecodeServices::refillStream( CAudioStream* stream )
+{
+	//ÿſ, ̲̫߳
+	for (;;)
+	{
+		BEGIN_LOCK(&stream->cs);
+		u32 freeBytes = stream->RingSize - (stream->WritePos - stream->ReadPos);
+		u32 n = 0;
+		if (freeBytes >= DECODE_CHUNK_SIZE)
+			n = stream->decodeLocked(DECODE_CHUNK_SIZE);
+		END_LOCK(&stream->cs);
+
+		if (n == 0)
+			break;
+	}
+}
+
+int CAudioDecodeServices::DecodeThreadFunc( void* lpParam )
+{
+	CAudioDecodeServices* services = (CAudioDecodeServices*)lpParam;
+
+	for (;;)
+	{
+		WAIT_EVENT(&services->WakeEvent, REFILL_INTERVAL);
+
+		if (ATOMIC_LOAD(&services->Quit))
+			break;
+
+		BEGIN_LOCK(&services->cs);
+		for (u32 i=0; i<(u32)services->Streams.size(); ++i)
+		{
+			CAudioStream* stream = services->Streams[i];
+			if (stream->Input)
+				services->refillStream(stream);
+		}
+		END_LOCK(&services->cs);
+	}
+
+	return 0;
+}
+
+#endif
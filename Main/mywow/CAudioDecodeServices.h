@@ -0,0 +1,158 @@
+#pragma once
+
+#include "core.h"
+#include "ISound.h"
+#include "CSysSync.h"
+#include "CSysThread.h"
+#include <vector>
+#include <list>
+#include <map>
+#include <set>
+
+#ifdef MW_PLATFORM_WINDOWS
+
+class IAudioInput;
+class CAudioDecodeServices;
+
+//pcm, ļڻй
+struct SPCMClip
+{
+	string256		name;
+	std::vector<u8>		data;
+	u32		bitsPerSample;
+	u32		numChannels;
+	u32		sampleRate;
+	u32		refCount;			//ڲŵstream, Ϊ0ʱܱ̭
+};
+
+//һ·ŵpcmԴ: еpcm, ɽ߳ǰĻλ
+class CAudioStream
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CAudioStream);
+
+public:
+	//ֵСsizeʾѾ, λ岻ʱڵ̲߳
+	u32 read(void* buffer, u32 size);
+	void rewind();
+	void setLoop(bool loop);
+	bool isEnd() const;
+
+	bool isCached() const { return Clip != NULL_PTR; }
+	u32 getSampleSize() const { return BitsPerSample / 8 * NumChannels; }
+
+public:
+	u32		BitsPerSample;
+	u32		NumChannels;
+	u32		SampleRate;
+
+private:
+	CAudioStream(CAudioDecodeServices* services, const string256& name);
+	~CAudioStream();
+
+	u32 decodeLocked(u32 maxBytes);
+	u32 readRingLocked(u8* dest, u32 size);
+	void onInputEndLocked();
+
+private:
+	CAudioDecodeServices*		Services;
+	string256		Name;
+
+	IAudioInput*		Input;
+	SPCMClip*		Clip;
+	u32		ClipPos;
+
+	u8*		Ring;
+	u8*		Chunk;
+	u32		RingSize;
+	u32		ReadPos;				//ۼֽ, RingSizeȡģõλ
+	u32		WritePos;
+	u32		DecodedSinceReset;
+
+	std::vector<u8>		Record;			//״βʱ¼µpcm, 㹻ʱ뻺
+	bool		RecordAllowed;
+	bool		Recording;
+	bool		InputEnd;
+	bool		Loop;
+
+	mutable lock_type		cs;
+
+	friend class CAudioDecodeServices;
+};
+
+struct SAudioDecodeStats
+{
+	u32		cacheHits;
+	u32		cacheMisses;
+	u32		underruns;				//λ, ڲ̲߳Ĵ
+	u32		numClips;
+	u32		cacheSize;
+};
+
+//Ƶ, һָ̱߳streamĻλȲλ
+//Чһβʱ¼pcm, 밴СƵLRU, ֮󲥷Ųٽ
+class CAudioDecodeServices
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CAudioDecodeServices);
+
+public:
+	CAudioDecodeServices(u32 cacheLimit, u32 maxClipSize);
+	~CAudioDecodeServices();
+
+public:
+	CAudioStream* openStream(const c8* filename, E_SOUND_TYPE type);
+	void closeStream(CAudioStream* stream);
+
+	void setCacheLimit(u32 limit);
+	u32 getCacheLimit() const { return CacheLimit; }
+	u32 getMaxClipSize() const { return MaxClipSize; }
+
+	void flushCache();				//ɾûڲŵĻ
+	void getStats(SAudioDecodeStats& stats) const;
+
+private:
+	enum
+	{
+		DECODE_CHUNK_SIZE = 16 * 1024,
+		RING_MILLISECONDS = 2000,
+		REFILL_INTERVAL = 10,
+	};
+
+	typedef std::list<SPCMClip*>		T_ClipList;
+	typedef std::map<string256, T_ClipList::iterator>		T_ClipMap;
+
+	SPCMClip* acquireClip(const string256& name);
+	void releaseClip(SPCMClip* clip);
+	void publishClip(const string256& name, std::vector<u8>& data, u32 bitsPerSample, u32 numChannels, u32 sampleRate);
+	void markLongStream(const string256& name);
+	bool isLongStream(const string256& name) const;
+	void trimCacheLocked();
+
+	void refillStream(CAudioStream* stream);
+	static int DecodeThreadFunc(void* lpParam);
+
+private:
+	std::vector<CAudioStream*>		Streams;
+	lock_type		cs;				//Streams
+
+	T_ClipList		ClipLRU;			//ͷʹ
+	T_ClipMap		ClipMap;
+	std::set<string256>		LongStreams;			//MaxClipSizeļ¼
+	u32		CacheSize;
+	u32		CacheLimit;
+	u32		MaxClipSize;
+	mutable lock_type		cacheCS;			//˳: cs -> stream.cs -> cacheCS
+
+	volatile int		CacheHits;
+	volatile int		CacheMisses;
+	volatile int		Underruns;
+
+	thread_type		Thread;
+	event_type		WakeEvent;
+	volatile int		Quit;
+
+	friend class CAudioStream;
+};
+
+#endif
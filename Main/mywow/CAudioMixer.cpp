@@ -0,0 +1,173 @@
+#include "stdafx.h"
+#include "CAudioMixer.h"
+#include "mywow.h"
+#include "CAudioDecodeServices.h"
+
+#ifdef MW_PLATFORM_WINDOWS
+
+CAudioMixer::CAudioMixer( u32 outputSampleRate )
+	: OutputSampleRate(outputSampleRate)
+{
+	memset(Voices, 0, sizeof(Voices));
+
+	Accum.resize(MIX_BLOCK_FRAMES * 2);
+}
+
+s32 CAudioMixer::addVoice( CAudioStream* stream, f32 volume )
+{
+	if (!stream || !stream->SampleRate || !stream->getSampleSize())
+		return -1;
+
+	for (u32 i=0; i<MAX_VOICES; ++i)
+	{
+		SVoice& voice = Voices[i];
+		if (voice.stream)
+			continue;
+
+		memset(&voice, 0, sizeof(SVoice));
+		voice.stream = stream;
+		voice.step = (u32)(((u64)stream->SampleRate << FRAC_BITS) / OutputSampleRate);
+		setVoiceVolume(i, volume);
+		return (s32)i;
+	}
+
+	return -1;
+}
+
+void CAudioMixer::removeVoice( u32 voice )
+{
+	if (voice < MAX_VOICES)
+		memset(&Voices[voice], 0, sizeof(SVoice));
+}
+
+void CAudioMixer::setVoiceVolume( u32 voice, f32 volume )
+{
+	if (voice < MAX_VOICES)
+		Voices[voice].volume = (s32)(clamp_<f32>(volume, 0.0f, 1.0f) * 256.0f);
+}
+
+u32 CAudioMixer::mix( s16* output, u32 numFrames )
+{
+	u32 done = 0;
+	while (done < numFrames)
+	{
+		u32 n = min_(numFrames - done, (u32)MIX_BLOCK_FRAMES);
+		s32* accum = &Accum[0];
+		memset(accum, 0, sizeof(s32) * 2 * n);
+
+		for (u32 i=0; i<MAX_VOICES; ++i)
+		{
+			SVoice& voice = Voices[i];
+			if (voice.stream && !voice.ended)
+				mixVoice(voice, accum, n);
+		}
+
+		if (output)
+		{
+			s16* dst = output + done * 2;
+			for (u32 k=0; k<n * 2; ++k)
+				dst[k] = (s16)clamp_<s32>(accum[k], -32768, 32767);
+		}
+
+		done += n;
+	}
+
+	u32 active = 0;
+	for (u32 i=0; i<MAX_VOICES; ++i)
+	{
+		if (isVoiceActive(i))
+			++active;
+	}
+	return active;
+}
+
+void CAudioMixer::mixVoice( SVoice& voice, s32* accum, u32 numFrames )
+{
+	const u32 one = 1 << FRAC_BITS;
+
+	//һҪǰԴ֡
+	u32 advances = (u32)(((u64)voice.frac + (u64)voice.step * numFrames) >> FRAC_BITS);
+	u32 got = readSource(voice, advances);
+	const s32* src = advances ? &SourceFrames[0] : NULL_PTR;
+
+	const s32 volume = voice.volume;
+	for (u32 i=0; i<numFrames; ++i)
+	{
+		//Ȩȡ12λ, ֵȨز
+		s32 w = (s32)(voice.frac >> (FRAC_BITS - 12));
+		s32 l = voice.prev[0] + (((voice.next[0] - voice.prev[0]) * w) >> 12);
+		s32 r = voice.prev[1] + (((voice.next[1] - voice.prev[1]) * w) >> 12);
+
+		accum[i * 2] += (l * volume) >> 8;
+		accum[i * 2 + 1] += (r * volume) >> 8;
+
+		voice.frac += voice.step;
+		while (voice.frac >= one)
+		{
+			voice.frac -= one;
+			voice.prev[0] = voice.next[0];
+			voice.prev[1] = voice.next[1];
+			voice.next[0] = src[0];
+			voice.next[1] = src[1];
+			src += 2;
+		}
+	}
+
+	if (got < advances)
+		voice.ended = true;
+}
+
+u32 CAudioMixer::readSource( SVoice& voice, u32 numFrames )
+{
+	if (numFrames == 0)
+		return 0;
+
+	CAudioStream* stream = voice.stream;
+	const u32 sampleSize = stream->getSampleSize();
+
+	if (SourceBytes.size() < numFrames * sampleSize)
+		SourceBytes.resize(numFrames * sampleSize);
+	if (SourceFrames.size() < numFrames * 2)
+		SourceFrames.resize(numFrames * 2);
+
+	u32 got = stream->read(&SourceBytes[0], numFrames * sampleSize) / sampleSize;
+
+	//תΪ, 16λΧ
+	s32* dst = &SourceFrames[0];
+	if (stream->BitsPerSample == 16)
+	{
+		const s16* s = (const s16*)&SourceBytes[0];
+		if (stream->NumChannels == 2)
+		{
+			for (u32 i=0; i<got * 2; ++i)
+				dst[i] = s[i];
+		}
+		else
+		{
+			for (u32 i=0; i<got; ++i)
+				dst[i * 2] = dst[i * 2 + 1] = s[i];
+		}
+	}
+	else
+	{
+		const u8* s = &SourceBytes[0];
+		if (stream->NumChannels == 2)
+		{
+			for (u32 i=0; i<got * 2; ++i)
+				dst[i] = ((s32)s[i] - 128) << 8;
+		}
+		else
+		{
+			for (u32 i=0; i<got; ++i)
+				dst[i * 2] = dst[i * 2 + 1] = ((s32)s[i] - 128) << 8;
+		}
+	}
+
+	//󲹾
+	for (u32 i=got * 2; i<numFrames * 2; ++i)
+		dst[i] = 0;
+
+	return got;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core.h"
+#include <vector>
+
+#ifdef MW_PLATFORM_WINDOWS
+
+class CAudioStream;
+
+//, 16λ, ·Բֵز
+//addVoice/removeVoice/mixͬһ̵߳
+class CAudioMixer
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CAudioMixer);
+
+public:
+	explicit CAudioMixer(u32 outputSampleRate);
+
+public:
+	enum
+	{
+		MAX_VOICES = 32,
+	};
+
+	//λ, ûпλʱ-1
+	s32 addVoice(CAudioStream* stream, f32 volume);
+	void removeVoice(u32 voice);
+	void setVoiceVolume(u32 voice, f32 volume);
+	bool isVoiceActive(u32 voice) const { return voice < MAX_VOICES && Voices[voice].stream != NULL_PTR && !Voices[voice].ended; }
+
+	//numFrames֡output(ҽ), ڲŵ
+	u32 mix(s16* output, u32 numFrames);
+
+	u32 getOutputSampleRate() const { return OutputSampleRate; }
+
+private:
+	enum
+	{
+		MIX_BLOCK_FRAMES = 512,
+		FRAC_BITS = 16,
+	};
+
+	struct SVoice
+	{
+		CAudioStream*		stream;
+		s32		volume;				//8λ
+		u32		step;				//ÿ֡ǰԴ֡, FRAC_BITS
+		u32		frac;
+		s32		prev[2];
+		s32		next[2];
+		bool		ended;
+	};
+
+	void mixVoice(SVoice& voice, s32* accum, u32 numFrames);
+	u32 readSource(SVoice& voice, u32 numFrames);
+
+private:
+	SVoice		Voices[MAX_VOICES];
+	std::vector<s32>		Accum;
+	std::vector<u8>		SourceBytes;
+	std::vector<s32>		SourceFrames;
+	u32		OutputSampleRate;
+};
+
+#endif
@@ -2,7 +2,7 @@
 #include "CBLPImage.h"
 #include "mywow.h"
 #include "CBlit.h"
-#include "ddslib.h"
+#include "CDXTEncoder.h"
 
 CBLPImage::CBLPImage()
 {
@@ -87,22 +87,31 @@ bool CBLPImage::loadFile( IMemFile* file, bool abgr )
 
 bool CBLPImage::fromImageData( const u8* src, const dimension2du& size, ECOLOR_FORMAT format, bool mipmap )
 {
-	if (size.Width % 4 != 0 || size.Height % 4 != 0 || format != ECF_A8R8G8B8)
+	CDXTEncoder encoder(false);
+	return fromImageData(src, size, format, mipmap, ECF_DXT1, &encoder);
+}
+
+bool CBLPImage::fromImageData( const u8* src, const dimension2du& size, ECOLOR_FORMAT format, bool mipmap, ECOLOR_FORMAT dxtFormat, CDXTEncoder* encoder )
+{
+	if (size.Width % 4 != 0 || size.Height % 4 != 0 || format != ECF_A8R8G8B8 ||
+		(dxtFormat != ECF_DXT1 && dxtFormat != ECF_DXT5))
 	{
 		ASSERT(false);
 		return false;
 	}
 
-	Format = ECF_DXT1;
-	AlphaDepth = 0;
+	bool dxt5 = dxtFormat == ECF_DXT5;
+
+	Format = dxtFormat;
+	AlphaDepth = dxt5 ? 8 : 0;
 	Size = size;
 
 	SBLPHeader header = {0};
 	header.magic = FOURCC('B', 'L', 'P', '2');
 	header._version = 1;
 	header._compress = 2;
-	header._alphaDepth = 0;
-	header._alphaCompress = 0;
+	header._alphaDepth = (u8)AlphaDepth;
+	header._alphaCompress = dxt5 ? 7 : 0;
 	header._mipmap = 1;
 	header._xres = Size.Width;
 	header._yres = Size.Height;
@@ -132,56 +141,43 @@ bool CBLPImage::fromImageData( const u8* src, const dimension2du& size, ECOLOR_F
 	FileData = new u8[offset];
 	Q_memcpy(FileData, sizeof(SBLPHeader), &header, sizeof(SBLPHeader));
 
-	//
-	u32 mipmapOfs[16] = {0};
-	offset = 0;
-	u32 bpp = getBytesPerPixelFromFormat(ECF_R5G6B5);
-	for (u32 i=0; i<NumMipMaps; ++i)
-	{
-		dimension2du s = Size.getMipLevelSize(i);
-		mipmapOfs[i] = offset;
-		offset += bpp * s.getArea();
-	}
-
-    if (!offset)
-    {
-		ASSERT(false);
-		return false;
-	}
-    
-	u8* tmpdata = (u8*)Z_AllocateTempMemory(offset);
-	
-	//mip 0 data
-	CBlit::resizeBilinearA8R8G8B8(src, Size.Width, Size.Height, tmpdata, Size.Width, Size.Height, ECF_R5G6B5);
-	//CBlit::resizeBicubicA8R8G8B8(src, Size.Width, Size.Height, tmpdata, Size.Width, Size.Height, ECF_R5G6B5);
-
-	//mip 0 data -> dxt1
-	u8* dst0 = FileData + header._mipmapOfs[0];
-	if (header._mipmapSize[0] != DDSCompressRGB565ToDXT1(tmpdata, Size.Width, Size.Height, dst0))
+	//mip 0 data -> dxt
+	if (header._mipmapSize[0] != encoder->compress((const u32*)src, Size.Width, Size.Height, Format, FileData + header._mipmapOfs[0]))
 	{
 		ASSERT(false);
-		Z_FreeTempMemory(tmpdata);
 		return false;
 	}
 
+	if (NumMipMaps == 1)
+		return true;
+
+	//mipmapһA8R8G8B8, R5G6B5
+	u32 mipPixels = 0;
+	for (u32 i=1; i<NumMipMaps; ++i)
+		mipPixels += Size.getMipLevelSize(i).getArea();
+
+	u32* tmpdata = (u32*)Z_AllocateTempMemory(mipPixels * sizeof(u32));
+
+	const u32* upperData = (const u32*)src;
+	u32* lowerData = tmpdata;
 	for (u32 i=1; i<NumMipMaps; ++i)
 	{
 		dimension2du upper = Size.getMipLevelSize(i-1);
 		dimension2du lower = Size.getMipLevelSize(i);
-		const u8* s = tmpdata + mipmapOfs[i-1];
-		u8* tgt = tmpdata + mipmapOfs[i];
 
 		//mip i data
-		copy16BitMipMap(s, tgt, lower.Width, lower.Height, bpp * upper.Width, bpp * lower.Width);
+		CDXTEncoder::buildMipLevel(upperData, upper.Width, upper.Height, lowerData);
 
-		//mip i data -> dxt1
-		u8* dst = FileData + header._mipmapOfs[i];
-		if (header._mipmapSize[i] != DDSCompressRGB565ToDXT1(tgt, lower.Width, lower.Height, dst))
+		//mip i data -> dxt
+		if (header._mipmapSize[i] != encoder->compress(lowerData, lower.Width, lower.Height, Format, FileData + header._mipmapOfs[i]))
 		{
 			ASSERT(false);
 			Z_FreeTempMemory(tmpdata);
 			return false;
 		}
+
+		upperData = lowerData;
+		lowerData += lower.getArea();
 	}
 
 	Z_FreeTempMemory(tmpdata);
@@ -285,39 +281,3 @@ bool CBLPImage::copyMipmapData( u32 level, void* dest, u32 pitch, u32 width, u32
 
 	return true;
 }
-
-void CBLPImage::copy16BitMipMap( const u8* src, u8* tgt, u32 width, u32 height, u32 pitchsrc, u32 pitchtgt ) const
-{
-	for (u32 y=0; y<height; ++y)
-	{
-		for (u32 x=0; x<width; ++x)
-		{
-			u32 a=0, r=0, g=0, b=0;
-
-			for (s32 dy=0; dy<2; ++dy)
-			{
-				const s32 tgy = (y*2)+dy;
-				for (s32 dx=0; dx<2; ++dx)
-				{
-					const s32 tgx = (x*2)+dx;
-
-					SColor c = SColor::R5G6B5toA8R8G8B8(*(u16*)(&src[(tgx*2)+(tgy*pitchsrc)]));
-
-					a += c.getAlpha();
-					r += c.getRed();
-					g += c.getGreen();
-					b += c.getBlue();
-				}
-			}
-
-			a /= 4;
-			r /= 4;
-			g /= 4;
-			b /= 4;
-
-			u16 c;
-			c = SColor::A8R8G8B8toR5G6B5(SColor(a,r,g,b).color);
-			*(u16*)(&tgt[(x*2)+(y*pitchtgt)]) = c;
-		}
-	}
-}
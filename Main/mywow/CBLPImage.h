@@ -3,6 +3,8 @@
 #include "core.h"
 #include "IBLPImage.h"
 
+class CDXTEncoder;
+
 class CBLPImage : public IBLPImage
 {
 private:
@@ -15,13 +17,11 @@ public:
 public:
 	virtual bool loadFile(IMemFile* file, bool abgr);	
 	virtual bool fromImageData(const u8* src, const dimension2du& size, ECOLOR_FORMAT format, bool mipmap);
+	//dxtFormatΪECF_DXT1ECF_DXT5
+	bool fromImageData(const u8* src, const dimension2du& size, ECOLOR_FORMAT format, bool mipmap, ECOLOR_FORMAT dxtFormat, CDXTEncoder* encoder);
 	virtual const void* getMipmapData(u32 level) const;  
 	virtual bool copyMipmapData(u32 level, void* dest, u32 pitch, u32 width, u32 height);
 
-private:
-	void copy16BitMipMap(const u8* src, u8* tgt,
-		u32 width, u32 height,  u32 pitchsrc, u32 pitchtgt) const;
-
 private:
 	u8*			FileData;
 
@@ -1,6 +1,615 @@
 #include "stdafx.h"
 #include "CBlit.h"
 #include "CImage.h"
+#include "CSysUtility.h"
+#include "temp_memory.h"
+
+#ifdef MW_USE_SSE
+#include <emmintrin.h>
+#endif
+
+#ifdef MW_USE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+#ifdef MW_USE_AVX2
+#include <immintrin.h>
+#endif
+
+typedef void (*BLIT_CONVERT_FUNC)(const void* sP, s32 sN, void* dP);
+
+//scalarʵ, Ҳsimd汾ıȽϻ׼β
+static void convert_A8R8G8B8toR5G6B5_scalar(const void* sP, s32 sN, void* dP)
+{
+	u8 * sB = (u8 *)sP;
+	u16* dB = (u16*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+	{
+		s32 r = sB[2] >> 3;
+		s32 g = sB[1] >> 2;
+		s32 b = sB[0] >> 3;
+
+		dB[0] = (u16)((r << 11) | (g << 5) | (b));
+
+		sB += 4;
+		dB += 1;
+	}
+}
+
+static void convert_A8R8G8B8toA1R5G5B5_scalar(const void* sP, s32 sN, void* dP)
+{
+	u32* sB = (u32*)sP;
+	u16* dB = (u16*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+		*dB++ = SColor::A8R8G8B8toA1R5G5B5(*sB++);
+}
+
+static void convert_R5G6B5toA8R8G8B8_scalar(const void* sP, s32 sN, void* dP)
+{
+	u16* sB = (u16*)sP;
+	u32* dB = (u32*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+		*dB++ = SColor::R5G6B5toA8R8G8B8(*sB++);
+}
+
+static void convert_A1R5G5B5toA8R8G8B8_scalar(const void* sP, s32 sN, void* dP)
+{
+	u16* sB = (u16*)sP;
+	u32* dB = (u32*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+		*dB++ = SColor::A1R5G5B5toA8R8G8B8(*sB++);
+}
+
+static void convert_R8G8B8toA8R8G8B8_scalar(const void* sP, s32 sN, void* dP)
+{
+	u8*  sB = (u8* )sP;
+	u32* dB = (u32*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+	{
+		*dB = 0xff000000 | (sB[0]<<16) | (sB[1]<<8) | sB[2];
+
+		sB += 3;
+		++dB;
+	}
+}
+
+static void convert_B8G8R8toA8R8G8B8_scalar(const void* sP, s32 sN, void* dP)
+{
+	u8*  sB = (u8* )sP;
+	u32* dB = (u32*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+	{
+		*dB = 0xff000000 | (sB[2]<<16) | (sB[1]<<8) | sB[0];
+
+		sB += 3;
+		++dB;
+	}
+}
+
+static void convert_A8R8G8B8toR8G8B8_scalar(const void* sP, s32 sN, void* dP)
+{
+	u8* sB = (u8*)sP;
+	u8* dB = (u8*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+	{
+		// sB[3] is alpha
+		dB[0] = sB[2];
+		dB[1] = sB[1];
+		dB[2] = sB[0];
+
+		sB += 4;
+		dB += 3;
+	}
+}
+
+static void convert_A8R8G8B8toB8G8R8_scalar(const void* sP, s32 sN, void* dP)
+{
+	u8* sB = (u8*)sP;
+	u8* dB = (u8*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+	{
+		// sB[3] is alpha
+		dB[0] = sB[0];
+		dB[1] = sB[1];
+		dB[2] = sB[2];
+
+		sB += 4;
+		dB += 3;
+	}
+}
+
+static void convert_R8G8B8toR5G6B5_scalar(const void* sP, s32 sN, void* dP)
+{
+	u8 * sB = (u8 *)sP;
+	u16* dB = (u16*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+	{
+		s32 r = sB[0] >> 3;
+		s32 g = sB[1] >> 2;
+		s32 b = sB[2] >> 3;
+
+		dB[0] = (u16)((r << 11) | (g << 5) | (b));
+
+		sB += 3;
+		dB += 1;
+	}
+}
+
+static void convert_R8G8B8toA1R5G5B5_scalar(const void* sP, s32 sN, void* dP)
+{
+	u8 * sB = (u8 *)sP;
+	u16* dB = (u16*)dP;
+
+	for (s32 x = 0; x < sN; ++x)
+	{
+		s32 r = sB[0] >> 3;
+		s32 g = sB[1] >> 3;
+		s32 b = sB[2] >> 3;
+
+		dB[0] = (u16)((0x8000) | (r << 10) | (g << 5) | (b));
+
+		sB += 3;
+		dB += 1;
+	}
+}
+
+#ifdef MW_USE_SSE
+
+//32λس16λ, ȷչ, зpackᱥ
+static inline __m128i pack32To16_SSE2(__m128i lo, __m128i hi)
+{
+	lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+	hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+	return _mm_packs_epi32(lo, hi);
+}
+
+//°32λͨ4, ʽSColorеͬ
+static inline __m128i A8R8G8B8toR5G6B5_SSE2(__m128i c)
+{
+	return _mm_or_si128(_mm_or_si128(
+		_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0x00F80000)), 8),
+		_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0x0000FC00)), 5)),
+		_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0x000000F8)), 3));
+}
+
+static inline __m128i A8R8G8B8toA1R5G5B5_SSE2(__m128i c)
+{
+	return _mm_or_si128(_mm_or_si128(
+		_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0x80000000)), 16),
+		_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0x00F80000)), 9)), _mm_or_si128(
+		_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0x0000F800)), 6),
+		_mm_srli_epi32(_mm_and_si128(c, _mm_set1_epi32(0x000000F8)), 3)));
+}
+
+static inline __m128i R5G6B5toA8R8G8B8_SSE2(__m128i c)
+{
+	return _mm_or_si128(_mm_or_si128(_mm_set1_epi32(0xFF000000),
+		_mm_slli_epi32(_mm_and_si128(c, _mm_set1_epi32(0xF800)), 8)), _mm_or_si128(
+		_mm_slli_epi32(_mm_and_si128(c, _mm_set1_epi32(0x07E0)), 5),
+		_mm_slli_epi32(_mm_and_si128(c, _mm_set1_epi32(0x001F)), 3)));
+}
+
+static inline __m128i A1R5G5B5toA8R8G8B8_SSE2(__m128i c)
+{
+	__m128i a = _mm_and_si128(_mm_srai_epi32(_mm_slli_epi32(c, 16), 31), _mm_set1_epi32(0xFF000000));
+	__m128i r = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(c, 9), _mm_set1_epi32(0x00F80000)),
+		_mm_and_si128(_mm_slli_epi32(c, 4), _mm_set1_epi32(0x00070000)));
+	__m128i g = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(c, 6), _mm_set1_epi32(0x0000F800)),
+		_mm_and_si128(_mm_slli_epi32(c, 1), _mm_set1_epi32(0x00000700)));
+	__m128i b = _mm_or_si128(_mm_and_si128(_mm_slli_epi32(c, 3), _mm_set1_epi32(0x000000F8)),
+		_mm_and_si128(_mm_srli_epi32(c, 2), _mm_set1_epi32(0x00000007)));
+	return _mm_or_si128(_mm_or_si128(a, r), _mm_or_si128(g, b));
+}
+
+template <__m128i (*PIXEL4)(__m128i), BLIT_CONVERT_FUNC TAIL>
+static void convert32To16_SSE2(const void* sP, s32 sN, void* dP)
+{
+	const u32* sB = (const u32*)sP;
+	u16* dB = (u16*)dP;
+
+	s32 x = 0;
+	for (; x + 8 <= sN; x += 8)
+	{
+		__m128i lo = PIXEL4(_mm_loadu_si128((const __m128i*)(sB + x)));
+		__m128i hi = PIXEL4(_mm_loadu_si128((const __m128i*)(sB + x + 4)));
+		_mm_storeu_si128((__m128i*)(dB + x), pack32To16_SSE2(lo, hi));
+	}
+
+	TAIL(sB + x, sN - x, dB + x);
+}
+
+template <__m128i (*PIXEL4)(__m128i), BLIT_CONVERT_FUNC TAIL>
+static void convert16To32_SSE2(const void* sP, s32 sN, void* dP)
+{
+	const u16* sB = (const u16*)sP;
+	u32* dB = (u32*)dP;
+
+	const __m128i zero = _mm_setzero_si128();
+	s32 x = 0;
+	for (; x + 8 <= sN; x += 8)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i*)(sB + x));
+		_mm_storeu_si128((__m128i*)(dB + x), PIXEL4(_mm_unpacklo_epi16(c, zero)));
+		_mm_storeu_si128((__m128i*)(dB + x + 4), PIXEL4(_mm_unpackhi_epi16(c, zero)));
+	}
+
+	TAIL(sB + x, sN - x, dB + x);
+}
+
+//һA8R8G8B8ص4ͨ4float, ˳scalar汾ͬ, λһ
+static inline u32 bilinearA8R8G8B8_SSE2(const u32* p, s32 w, f32 x_diff, f32 y_diff)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i ab = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), zero);
+	__m128i cd = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(p + w)), zero);
+	__m128 a = _mm_cvtepi32_ps(_mm_unpacklo_epi16(ab, zero));
+	__m128 b = _mm_cvtepi32_ps(_mm_unpackhi_epi16(ab, zero));
+	__m128 c = _mm_cvtepi32_ps(_mm_unpacklo_epi16(cd, zero));
+	__m128 d = _mm_cvtepi32_ps(_mm_unpackhi_epi16(cd, zero));
+
+	__m128 wx0 = _mm_set1_ps(1-x_diff);
+	__m128 wx1 = _mm_set1_ps(x_diff);
+	__m128 wy0 = _mm_set1_ps(1-y_diff);
+	__m128 wy1 = _mm_set1_ps(y_diff);
+	__m128 wxy = _mm_set1_ps(x_diff*y_diff);
+
+	__m128 v = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(_mm_mul_ps(a, wx0), wy0),
+		_mm_mul_ps(_mm_mul_ps(b, wx1), wy0)),
+		_mm_mul_ps(_mm_mul_ps(c, wy1), wx0)),
+		_mm_mul_ps(d, wxy));
+
+	__m128i i = _mm_cvttps_epi32(v);
+	i = _mm_packs_epi32(i, i);
+	return (u32)_mm_cvtsi128_si32(_mm_packus_epi16(i, i));
+}
+
+#endif
+
+#ifdef MW_USE_SSSE3
+
+//R8G8B8ΪRǰ, B8G8R8ΪBǰ, ųA8R8G8B8ڴ˳(b, g, r, a)
+#define SHUFFLE_R8G8B8_TO_32		2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1
+#define SHUFFLE_B8G8R8_TO_32		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+#define SHUFFLE_32_TO_R8G8B8		2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+#define SHUFFLE_32_TO_B8G8R8		0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1
+
+static inline void store12_SSSE3(u8* d, __m128i v)
+{
+	_mm_storel_epi64((__m128i*)d, v);
+	*(s32*)(d + 8) = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+}
+
+//16ֽڶȡ4ֽ, ʣ6ʱsimd
+static void convert24To32_SSSE3(const void* sP, s32 sN, void* dP, __m128i mask, BLIT_CONVERT_FUNC tail)
+{
+	const u8* sB = (const u8*)sP;
+	u32* dB = (u32*)dP;
+
+	const __m128i alpha = _mm_set1_epi32(0xFF000000);
+	s32 x = 0;
+	for (; x + 6 <= sN; x += 4)
+	{
+		__m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(sB + x * 3)), mask);
+		_mm_storeu_si128((__m128i*)(dB + x), _mm_or_si128(c, alpha));
+	}
+
+	tail(sB + x * 3, sN - x, dB + x);
+}
+
+static void convert32To24_SSSE3(const void* sP, s32 sN, void* dP, __m128i mask, BLIT_CONVERT_FUNC tail)
+{
+	const u32* sB = (const u32*)sP;
+	u8* dB = (u8*)dP;
+
+	s32 x = 0;
+	for (; x + 4 <= sN; x += 4)
+		store12_SSSE3(dB + x * 3, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(sB + x)), mask));
+
+	tail(sB + x, sN - x, dB + x * 3);
+}
+
+template <__m128i (*PIXEL4)(__m128i), BLIT_CONVERT_FUNC TAIL>
+static void convert24To16_SSSE3(const void* sP, s32 sN, void* dP)
+{
+	const u8* sB = (const u8*)sP;
+	u16* dB = (u16*)dP;
+
+	const __m128i mask = _mm_setr_epi8(SHUFFLE_R8G8B8_TO_32);
+	const __m128i alpha = _mm_set1_epi32(0xFF000000);
+	s32 x = 0;
+	for (; x + 10 <= sN; x += 8)
+	{
+		__m128i lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(sB + x * 3)), mask);
+		__m128i hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(sB + x * 3 + 12)), mask);
+		lo = PIXEL4(_mm_or_si128(lo, alpha));
+		hi = PIXEL4(_mm_or_si128(hi, alpha));
+		_mm_storeu_si128((__m128i*)(dB + x), pack32To16_SSE2(lo, hi));
+	}
+
+	TAIL(sB + x * 3, sN - x, dB + x);
+}
+
+static void convert_R8G8B8toA8R8G8B8_SSSE3(const void* sP, s32 sN, void* dP)
+{
+	convert24To32_SSSE3(sP, sN, dP, _mm_setr_epi8(SHUFFLE_R8G8B8_TO_32), convert_R8G8B8toA8R8G8B8_scalar);
+}
+
+static void convert_B8G8R8toA8R8G8B8_SSSE3(const void* sP, s32 sN, void* dP)
+{
+	convert24To32_SSSE3(sP, sN, dP, _mm_setr_epi8(SHUFFLE_B8G8R8_TO_32), convert_B8G8R8toA8R8G8B8_scalar);
+}
+
+static void convert_A8R8G8B8toR8G8B8_SSSE3(const void* sP, s32 sN, void* dP)
+{
+	convert32To24_SSSE3(sP, sN, dP, _mm_setr_epi8(SHUFFLE_32_TO_R8G8B8), convert_A8R8G8B8toR8G8B8_scalar);
+}
+
+static void convert_A8R8G8B8toB8G8R8_SSSE3(const void* sP, s32 sN, void* dP)
+{
+	convert32To24_SSSE3(sP, sN, dP, _mm_setr_epi8(SHUFFLE_32_TO_B8G8R8), convert_A8R8G8B8toB8G8R8_scalar);
+}
+
+#endif
+
+#ifdef MW_USE_AVX2
+
+static inline __m256i A8R8G8B8toR5G6B5_AVX2(__m256i c)
+{
+	return _mm256_or_si256(_mm256_or_si256(
+		_mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x00F80000)), 8),
+		_mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x0000FC00)), 5)),
+		_mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x000000F8)), 3));
+}
+
+static inline __m256i A8R8G8B8toA1R5G5B5_AVX2(__m256i c)
+{
+	return _mm256_or_si256(_mm256_or_si256(
+		_mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x80000000)), 16),
+		_mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x00F80000)), 9)), _mm256_or_si256(
+		_mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x0000F800)), 6),
+		_mm256_srli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x000000F8)), 3)));
+}
+
+static inline __m256i R5G6B5toA8R8G8B8_AVX2(__m256i c)
+{
+	return _mm256_or_si256(_mm256_or_si256(_mm256_set1_epi32(0xFF000000),
+		_mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0xF800)), 8)), _mm256_or_si256(
+		_mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x07E0)), 5),
+		_mm256_slli_epi32(_mm256_and_si256(c, _mm256_set1_epi32(0x001F)), 3)));
+}
+
+static inline __m256i A1R5G5B5toA8R8G8B8_AVX2(__m256i c)
+{
+	__m256i a = _mm256_and_si256(_mm256_srai_epi32(_mm256_slli_epi32(c, 16), 31), _mm256_set1_epi32(0xFF000000));
+	__m256i r = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(c, 9), _mm256_set1_epi32(0x00F80000)),
+		_mm256_and_si256(_mm256_slli_epi32(c, 4), _mm256_set1_epi32(0x00070000)));
+	__m256i g = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(c, 6), _mm256_set1_epi32(0x0000F800)),
+		_mm256_and_si256(_mm256_slli_epi32(c, 1), _mm256_set1_epi32(0x00000700)));
+	__m256i b = _mm256_or_si256(_mm256_and_si256(_mm256_slli_epi32(c, 3), _mm256_set1_epi32(0x000000F8)),
+		_mm256_and_si256(_mm256_srli_epi32(c, 2), _mm256_set1_epi32(0x00000007)));
+	return _mm256_or_si256(_mm256_or_si256(a, r), _mm256_or_si256(g, b));
+}
+
+//128λͨһͬű
+static inline __m256i broadcastMask_AVX2(__m128i mask)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(mask), mask, 1);
+}
+
+template <__m256i (*PIXEL8)(__m256i), BLIT_CONVERT_FUNC TAIL>
+static void convert32To16_AVX2(const void* sP, s32 sN, void* dP)
+{
+	const u32* sB = (const u32*)sP;
+	u16* dB = (u16*)dP;
+
+	s32 x = 0;
+	for (; x + 16 <= sN; x += 16)
+	{
+		__m256i lo = PIXEL8(_mm256_loadu_si256((const __m256i*)(sB + x)));
+		__m256i hi = PIXEL8(_mm256_loadu_si256((const __m256i*)(sB + x + 8)));
+		lo = _mm256_srai_epi32(_mm256_slli_epi32(lo, 16), 16);
+		hi = _mm256_srai_epi32(_mm256_slli_epi32(hi, 16), 16);
+
+		//packÿ128λͨڽ, ٰ64λŻԭ˳
+		__m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)(dB + x), v);
+	}
+
+	TAIL(sB + x, sN - x, dB + x);
+}
+
+template <__m256i (*PIXEL8)(__m256i), BLIT_CONVERT_FUNC TAIL>
+static void convert16To32_AVX2(const void* sP, s32 sN, void* dP)
+{
+	const u16* sB = (const u16*)sP;
+	u32* dB = (u32*)dP;
+
+	s32 x = 0;
+	for (; x + 8 <= sN; x += 8)
+	{
+		__m256i c = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(sB + x)));
+		_mm256_storeu_si256((__m256i*)(dB + x), PIXEL8(c));
+	}
+
+	TAIL(sB + x, sN - x, dB + x);
+}
+
+//ÿ128λͨ4ص12ֽ, ڶζȡ4ֽ
+static void convert24To32_AVX2(const void* sP, s32 sN, void* dP, __m128i mask, BLIT_CONVERT_FUNC tail)
+{
+	const u8* sB = (const u8*)sP;
+	u32* dB = (u32*)dP;
+
+	const __m256i mask2 = broadcastMask_AVX2(mask);
+	const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+	s32 x = 0;
+	for (; x + 10 <= sN; x += 8)
+	{
+		const u8* s = sB + x * 3;
+		__m256i c = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)s)),
+			_mm_loadu_si128((const __m128i*)(s + 12)), 1);
+		_mm256_storeu_si256((__m256i*)(dB + x), _mm256_or_si256(_mm256_shuffle_epi8(c, mask2), alpha));
+	}
+
+	tail(sB + x * 3, sN - x, dB + x);
+}
+
+static void convert32To24_AVX2(const void* sP, s32 sN, void* dP, __m128i mask, BLIT_CONVERT_FUNC tail)
+{
+	const u32* sB = (const u32*)sP;
+	u8* dB = (u8*)dP;
+
+	const __m256i mask2 = broadcastMask_AVX2(mask);
+	s32 x = 0;
+	for (; x + 8 <= sN; x += 8)
+	{
+		__m256i v = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(sB + x)), mask2);
+		store12_SSSE3(dB + x * 3, _mm256_castsi256_si128(v));
+		store12_SSSE3(dB + x * 3 + 12, _mm256_extracti128_si256(v, 1));
+	}
+
+	tail(sB + x, sN - x, dB + x * 3);
+}
+
+static void convert_R8G8B8toA8R8G8B8_AVX2(const void* sP, s32 sN, void* dP)
+{
+	convert24To32_AVX2(sP, sN, dP, _mm_setr_epi8(SHUFFLE_R8G8B8_TO_32), convert_R8G8B8toA8R8G8B8_scalar);
+}
+
+static void convert_B8G8R8toA8R8G8B8_AVX2(const void* sP, s32 sN, void* dP)
+{
+	convert24To32_AVX2(sP, sN, dP, _mm_setr_epi8(SHUFFLE_B8G8R8_TO_32), convert_B8G8R8toA8R8G8B8_scalar);
+}
+
+static void convert_A8R8G8B8toR8G8B8_AVX2(const void* sP, s32 sN, void* dP)
+{
+	convert32To24_AVX2(sP, sN, dP, _mm_setr_epi8(SHUFFLE_32_TO_R8G8B8), convert_A8R8G8B8toR8G8B8_scalar);
+}
+
+static void convert_A8R8G8B8toB8G8R8_AVX2(const void* sP, s32 sN, void* dP)
+{
+	convert32To24_AVX2(sP, sN, dP, _mm_setr_epi8(SHUFFLE_32_TO_B8G8R8), convert_A8R8G8B8toB8G8R8_scalar);
+}
+
+#endif
+
+//תڵǰʹõʵ, ֻڳʼsetSIMDLevelʱ޸
+struct SBlitKernels
+{
+	SBlitKernels()
+	{
+		u32 features = CSysUtility::getCPUFeatures();
+		maxLevel = EBS_SCALAR;
+#ifdef MW_USE_SSE
+		if (features & ECPU_SSE2)
+			maxLevel = EBS_SSE2;
+#endif
+#ifdef MW_USE_SSSE3
+		if (maxLevel == EBS_SSE2 && (features & ECPU_SSSE3))
+			maxLevel = EBS_SSSE3;
+#endif
+#ifdef MW_USE_AVX2
+		if (maxLevel == EBS_SSSE3 && (features & ECPU_AVX2))
+			maxLevel = EBS_AVX2;
+#endif
+		setLevel(maxLevel);
+	}
+
+	void setLevel(E_BLIT_SIMD l)
+	{
+		level = l;
+
+		A8R8G8B8toR5G6B5 = convert_A8R8G8B8toR5G6B5_scalar;
+		A8R8G8B8toA1R5G5B5 = convert_A8R8G8B8toA1R5G5B5_scalar;
+		R5G6B5toA8R8G8B8 = convert_R5G6B5toA8R8G8B8_scalar;
+		A1R5G5B5toA8R8G8B8 = convert_A1R5G5B5toA8R8G8B8_scalar;
+		R8G8B8toA8R8G8B8 = convert_R8G8B8toA8R8G8B8_scalar;
+		B8G8R8toA8R8G8B8 = convert_B8G8R8toA8R8G8B8_scalar;
+		A8R8G8B8toR8G8B8 = convert_A8R8G8B8toR8G8B8_scalar;
+		A8R8G8B8toB8G8R8 = convert_A8R8G8B8toB8G8R8_scalar;
+		R8G8B8toR5G6B5 = convert_R8G8B8toR5G6B5_scalar;
+		R8G8B8toA1R5G5B5 = convert_R8G8B8toA1R5G5B5_scalar;
+
+#ifdef MW_USE_SSE
+		if (level >= EBS_SSE2)
+		{
+			A8R8G8B8toR5G6B5 = convert32To16_SSE2<A8R8G8B8toR5G6B5_SSE2, convert_A8R8G8B8toR5G6B5_scalar>;
+			A8R8G8B8toA1R5G5B5 = convert32To16_SSE2<A8R8G8B8toA1R5G5B5_SSE2, convert_A8R8G8B8toA1R5G5B5_scalar>;
+			R5G6B5toA8R8G8B8 = convert16To32_SSE2<R5G6B5toA8R8G8B8_SSE2, convert_R5G6B5toA8R8G8B8_scalar>;
+			A1R5G5B5toA8R8G8B8 = convert16To32_SSE2<A1R5G5B5toA8R8G8B8_SSE2, convert_A1R5G5B5toA8R8G8B8_scalar>;
+		}
+#endif
+
+#ifdef MW_USE_SSSE3
+		if (level >= EBS_SSSE3)
+		{
+			R8G8B8toA8R8G8B8 = convert_R8G8B8toA8R8G8B8_SSSE3;
+			B8G8R8toA8R8G8B8 = convert_B8G8R8toA8R8G8B8_SSSE3;
+			A8R8G8B8toR8G8B8 = convert_A8R8G8B8toR8G8B8_SSSE3;
+			A8R8G8B8toB8G8R8 = convert_A8R8G8B8toB8G8R8_SSSE3;
+			R8G8B8toR5G6B5 = convert24To16_SSSE3<A8R8G8B8toR5G6B5_SSE2, convert_R8G8B8toR5G6B5_scalar>;
+			R8G8B8toA1R5G5B5 = convert24To16_SSSE3<A8R8G8B8toA1R5G5B5_SSE2, convert_R8G8B8toA1R5G5B5_scalar>;
+		}
+#endif
+
+#ifdef MW_USE_AVX2
+		//24λת16λssse3汾
+		if (level >= EBS_AVX2)
+		{
+			A8R8G8B8toR5G6B5 = convert32To16_AVX2<A8R8G8B8toR5G6B5_AVX2, convert_A8R8G8B8toR5G6B5_scalar>;
+			A8R8G8B8toA1R5G5B5 = convert32To16_AVX2<A8R8G8B8toA1R5G5B5_AVX2, convert_A8R8G8B8toA1R5G5B5_scalar>;
+			R5G6B5toA8R8G8B8 = convert16To32_AVX2<R5G6B5toA8R8G8B8_AVX2, convert_R5G6B5toA8R8G8B8_scalar>;
+			A1R5G5B5toA8R8G8B8 = convert16To32_AVX2<A1R5G5B5toA8R8G8B8_AVX2, convert_A1R5G5B5toA8R8G8B8_scalar>;
+			R8G8B8toA8R8G8B8 = convert_R8G8B8toA8R8G8B8_AVX2;
+			B8G8R8toA8R8G8B8 = convert_B8G8R8toA8R8G8B8_AVX2;
+			A8R8G8B8toR8G8B8 = convert_A8R8G8B8toR8G8B8_AVX2;
+			A8R8G8B8toB8G8R8 = convert_A8R8G8B8toB8G8R8_AVX2;
+		}
+#endif
+	}
+
+	E_BLIT_SIMD		level;
+	E_BLIT_SIMD		maxLevel;
+
+	BLIT_CONVERT_FUNC		A8R8G8B8toR5G6B5;
+	BLIT_CONVERT_FUNC		A8R8G8B8toA1R5G5B5;
+	BLIT_CONVERT_FUNC		R5G6B5toA8R8G8B8;
+	BLIT_CONVERT_FUNC		A1R5G5B5toA8R8G8B8;
+	BLIT_CONVERT_FUNC		R8G8B8toA8R8G8B8;
+	BLIT_CONVERT_FUNC		B8G8R8toA8R8G8B8;
+	BLIT_CONVERT_FUNC		A8R8G8B8toR8G8B8;
+	BLIT_CONVERT_FUNC		A8R8G8B8toB8G8R8;
+	BLIT_CONVERT_FUNC		R8G8B8toR5G6B5;
+	BLIT_CONVERT_FUNC		R8G8B8toA1R5G5B5;
+};
+
+static SBlitKernels g_blitKernels;
+
+E_BLIT_SIMD CBlit::getSIMDLevel()
+{
+	return g_blitKernels.level;
+}
+
+E_BLIT_SIMD CBlit::getMaxSIMDLevel()
+{
+	return g_blitKernels.maxLevel;
+}
+
+void CBlit::setSIMDLevel( E_BLIT_SIMD level )
+{
+	g_blitKernels.setLevel(level < g_blitKernels.maxLevel ? level : g_blitKernels.maxLevel);
+}
+
 
 bool CBlit::Blit( CImage* dest, const vector2di& destPos, const dimension2du& destDimension, CImage* src, const vector2di& srcPos )
 {
@@ -105,36 +714,29 @@ void CBlit::executeBlit_TextureCopy_x_to_x( const SBlitJob * job )
 
 void CBlit::executeBlit_TextureCopy_16_to_32( const SBlitJob * job )
 {
-	const u16 *src = (u16*) job->src;
-	u32 *dst = (u32*) job->dst;
+	const u8* src = (const u8*) job->src;
+	u8* dst = (u8*) job->dst;
 
 	for ( s32 dy = 0; dy != job->height; ++dy )
 	{
-		for ( s32 dx = 0; dx != job->width; ++dx )
-		{
-			dst[dx] = SColor::A1R5G5B5toA8R8G8B8( src[dx] );
-		}
+		g_blitKernels.A1R5G5B5toA8R8G8B8(src, job->width, dst);
 
-		src = (u16*) ( (u8*) (src) + job->srcPitch );
-		dst = (u32*) ( (u8*) (dst) + job->dstPitch );
+		src += job->srcPitch;
+		dst += job->dstPitch;
 	}
 }
 
 void CBlit::executeBlit_TextureCopy_32_to_16( const SBlitJob * job )
 {
-	const u32 *src = static_cast<const u32*>(job->src);
-	u16 *dst = static_cast<u16*>(job->dst);
+	const u8* src = (const u8*) job->src;
+	u8* dst = (u8*) job->dst;
 
 	for ( s32 dy = 0; dy != job->height; ++dy )
 	{
-		for ( s32 dx = 0; dx != job->width; ++dx )
-		{
-			const u32 s = src[dx];
-			dst[dx] = SColor::A8R8G8B8toA1R5G5B5( s );
-		}
+		g_blitKernels.A8R8G8B8toA1R5G5B5(src, job->width, dst);
 
-		src = (u32*) ( (u8*) (src) + job->srcPitch );
-		dst = (u16*) ( (u8*) (dst) + job->dstPitch );
+		src += job->srcPitch;
+		dst += job->dstPitch;
 	}
 }
 
@@ -161,61 +763,43 @@ void CBlit::executeBlit_TextureCopy_16_to_24( const SBlitJob * job )
 
 void CBlit::executeBlit_TextureCopy_24_to_16( const SBlitJob * job )
 {
-	const void *src = (void*) job->src;
-	u16 *dst = (u16*) job->dst;
+	const u8* src = (const u8*) job->src;
+	u8* dst = (u8*) job->dst;
 
 	for ( s32 dy = 0; dy != job->height; ++dy )
 	{
-		u8 * s = (u8*) src;
-
-		for ( s32 dx = 0; dx != job->width; ++dx )
-		{
-			dst[dx] = SColor::RGB16(s[0], s[1], s[2]);
-			s += 3;
-		}
+		g_blitKernels.R8G8B8toA1R5G5B5(src, job->width, dst);
 
-		src = (void*) ( (u8*) (src) + job->srcPitch );
-		dst = (u16*) ( (u8*) (dst) + job->dstPitch );
+		src += job->srcPitch;
+		dst += job->dstPitch;
 	}
 }
 
 void CBlit::executeBlit_TextureCopy_24_to_32( const SBlitJob * job )
 {
-	void *src = (void*) job->src;
-	u32 *dst = (u32*) job->dst;
+	const u8* src = (const u8*) job->src;
+	u8* dst = (u8*) job->dst;
 
 	for ( s32 dy = 0; dy != job->height; ++dy )
 	{
-		u8 * s = (u8*) src;
+		g_blitKernels.R8G8B8toA8R8G8B8(src, job->width, dst);
 
-		for ( s32 dx = 0; dx != job->width; ++dx )
-		{
-			dst[dx] = 0xFF000000 | s[0] << 16 | s[1] << 8 | s[2];
-			s += 3;
-		}
-
-		src = (void*) ( (u8*) (src) + job->srcPitch );
-		dst = (u32*) ( (u8*) (dst) + job->dstPitch );
+		src += job->srcPitch;
+		dst += job->dstPitch;
 	}
 }
 
 void CBlit::executeBlit_TextureCopy_32_to_24( const SBlitJob * job )
 {
-	const u32 * src = (u32*) job->src;
-	u8 * dst = (u8*) job->dst;
+	const u8* src = (const u8*) job->src;
+	u8* dst = (u8*) job->dst;
 
 	for ( s32 dy = 0; dy != job->height; ++dy )
 	{
-		for ( s32 dx = 0; dx != job->width; ++dx )
-		{
-			u8 * writeTo = &dst[dx * 3];
-			*writeTo++ = (src[dx] >> 16)& 0xFF;
-			*writeTo++ = (src[dx] >> 8) & 0xFF;
-			*writeTo++ = src[dx] & 0xFF;
-		}
+		g_blitKernels.A8R8G8B8toR8G8B8(src, job->width, dst);
 
-		src = (u32*) ( (u8*) (src) + job->srcPitch );
-		dst += job->dstPitch ;
+		src += job->srcPitch;
+		dst += job->dstPitch;
 	}
 }
 
@@ -341,13 +925,9 @@ void CBlit::convert_A1R5G5B5toB8G8R8(const void* sP, s32 sN, void* dP)
 	}
 }
 
-void CBlit::convert_A1R5G5B5toA8R8G8B8( const void* sP, s32 sN, void* dP )
+void CBlit::convert_A1R5G5B5toA8R8G8B8(const void* sP, s32 sN, void* dP)
 {
-	u16* sB = (u16*)sP;
-	u32* dB = (u32*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-		*dB++ = SColor::A1R5G5B5toA8R8G8B8(*sB++);
+	g_blitKernels.A1R5G5B5toA8R8G8B8(sP, sN, dP);
 }
 
 void CBlit::convert_A1R5G5B5toA1R5G5B5( const void* sP, s32 sN, void* dP )
@@ -381,38 +961,14 @@ void CBlit::convert_A8R8G8B8toA8B8G8R8( const void* sP, s32 sN, void* dP )
 	}
 }
 
-void CBlit::convert_A8R8G8B8toR8G8B8( const void* sP, s32 sN, void* dP )
+void CBlit::convert_A8R8G8B8toR8G8B8(const void* sP, s32 sN, void* dP)
 {
-	u8* sB = (u8*)sP;
-	u8* dB = (u8*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-	{
-		// sB[3] is alpha
-		dB[0] = sB[2];
-		dB[1] = sB[1];
-		dB[2] = sB[0];
-
-		sB += 4;
-		dB += 3;
-	}
+	g_blitKernels.A8R8G8B8toR8G8B8(sP, sN, dP);
 }
 
 void CBlit::convert_A8R8G8B8toB8G8R8(const void* sP, s32 sN, void* dP)
 {
-	u8* sB = (u8*)sP;
-	u8* dB = (u8*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-	{
-		// sB[3] is alpha
-		dB[0] = sB[0];
-		dB[1] = sB[1];
-		dB[2] = sB[2];
-
-		sB += 4;
-		dB += 3;
-	}
+	g_blitKernels.A8R8G8B8toB8G8R8(sP, sN, dP);
 }
 
 void CBlit::convert_A8R8G8B8toA8R8G8B8( const void* sP, s32 sN, void* dP )
@@ -420,31 +976,14 @@ void CBlit::convert_A8R8G8B8toA8R8G8B8( const void* sP, s32 sN, void* dP )
 	memcpy(dP, sP, sN * 4);
 }
 
-void CBlit::convert_A8R8G8B8toA1R5G5B5( const void* sP, s32 sN, void* dP )
+void CBlit::convert_A8R8G8B8toA1R5G5B5(const void* sP, s32 sN, void* dP)
 {
-	u32* sB = (u32*)sP;
-	u16* dB = (u16*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-		*dB++ = SColor::A8R8G8B8toA1R5G5B5(*sB++);
+	g_blitKernels.A8R8G8B8toA1R5G5B5(sP, sN, dP);
 }
 
 void CBlit::convert_A8R8G8B8toR5G6B5(const void* sP, s32 sN, void* dP)
 {
-	u8 * sB = (u8 *)sP;
-	u16* dB = (u16*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-	{
-		s32 r = sB[2] >> 3;
-		s32 g = sB[1] >> 2;
-		s32 b = sB[0] >> 3;
-
-		dB[0] = (u16)((r << 11) | (g << 5) | (b));
-
-		sB += 4;
-		dB += 1;
-	}
+	g_blitKernels.A8R8G8B8toR5G6B5(sP, sN, dP);
 }
 
 void CBlit::convert_R8G8B8toR8G8B8( const void* sP, s32 sN, void* dP )
@@ -452,54 +991,19 @@ void CBlit::convert_R8G8B8toR8G8B8( const void* sP, s32 sN, void* dP )
 	memcpy(dP, sP, sN * 3);
 }
 
-void CBlit::convert_R8G8B8toA8R8G8B8( const void* sP, s32 sN, void* dP )
+void CBlit::convert_R8G8B8toA8R8G8B8(const void* sP, s32 sN, void* dP)
 {
-	u8*  sB = (u8* )sP;
-	u32* dB = (u32*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-	{
-		*dB = 0xff000000 | (sB[0]<<16) | (sB[1]<<8) | sB[2];
-
-		sB += 4;
-		++dB;
-	}
+	g_blitKernels.R8G8B8toA8R8G8B8(sP, sN, dP);
 }
 
-void CBlit::convert_R8G8B8toA1R5G5B5( const void* sP, s32 sN, void* dP )
+void CBlit::convert_R8G8B8toA1R5G5B5(const void* sP, s32 sN, void* dP)
 {
-	u8 * sB = (u8 *)sP;
-	u16* dB = (u16*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-	{
-		s32 r = sB[0] >> 3;
-		s32 g = sB[1] >> 3;
-		s32 b = sB[2] >> 3;
-
-		dB[0] = (u16)((0x8000) | (r << 10) | (g << 5) | (b));
-
-		sB += 3;
-		dB += 1;
-	}
+	g_blitKernels.R8G8B8toA1R5G5B5(sP, sN, dP);
 }
 
 void CBlit::convert_R8G8B8toR5G6B5(const void* sP, s32 sN, void* dP)
 {
-	u8 * sB = (u8 *)sP;
-	u16* dB = (u16*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-	{
-		s32 r = sB[0] >> 3;
-		s32 g = sB[1] >> 2;
-		s32 b = sB[2] >> 3;
-
-		dB[0] = (u16)((r << 11) | (g << 5) | (b));
-
-		sB += 3;
-		dB += 1;
-	}
+	g_blitKernels.R8G8B8toR5G6B5(sP, sN, dP);
 }
 
 void CBlit::convert_R5G6B5toR5G6B5(const void* sP, s32 sN, void* dP)
@@ -541,11 +1045,7 @@ void CBlit::convert_R5G6B5toB8G8R8(const void* sP, s32 sN, void* dP)
 
 void CBlit::convert_R5G6B5toA8R8G8B8(const void* sP, s32 sN, void* dP)
 {
-	u16* sB = (u16*)sP;
-	u32* dB = (u32*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-		*dB++ = SColor::R5G6B5toA8R8G8B8(*sB++);
+	g_blitKernels.R5G6B5toA8R8G8B8(sP, sN, dP);
 }
 
 void CBlit::convert_R5G6B5toA1R5G5B5(const void* sP, s32 sN, void* dP)
@@ -559,16 +1059,7 @@ void CBlit::convert_R5G6B5toA1R5G5B5(const void* sP, s32 sN, void* dP)
 
 void CBlit::convert_B8G8R8toA8R8G8B8(const void* sP, s32 sN, void* dP)
 {
-	u8*  sB = (u8* )sP;
-	u32* dB = (u32*)dP;
-
-	for (s32 x = 0; x < sN; ++x)
-	{
-		*dB = 0xff000000 | (sB[2]<<16) | (sB[1]<<8) | sB[0];
-
-		sB += 3;
-		++dB;
-	}
+	g_blitKernels.B8G8R8toA8R8G8B8(sP, sN, dP);
 }
 
 void CBlit::convert_B8G8R8A8toA8R8G8B8(const void* sP, s32 sN, void* dP)
@@ -807,7 +1298,12 @@ void CBlit::resizeBilinearA8R8G8B8( const void* src, u32 w1, u32 h1, void* targe
 	float x_ratio = ((float)(w-1))/w2 ;
 	float y_ratio = ((float)(h-1))/h2 ;
 	float x_diff, y_diff;
+
+	//ȲֵһA8R8G8B8, תĿʽ
+	u32* row = format == ECF_A8R8G8B8 ? NULL_PTR : (u32*)Z_AllocateTempMemory(w2 * sizeof(u32));
+
 	for (u32 i=0;i<h2;i++) {
+		u32* out = row ? row : (u32*)target + i * w2;
 		for (u32 j=0;j<w2;j++) {
 			x = (int)(x_ratio * j) ;
 			y = (int)(y_ratio * i) ;
@@ -815,6 +1311,14 @@ void CBlit::resizeBilinearA8R8G8B8( const void* src, u32 w1, u32 h1, void* targe
 			y_diff = (y_ratio * i) - y ;
 			index = y*w+x ;
 
+#ifdef MW_USE_SSE
+			if (g_blitKernels.level >= EBS_SSE2)
+			{
+				out[j] = bilinearA8R8G8B8_SSE2(pixels + index, w, x_diff, y_diff);
+				continue;
+			}
+#endif
+
 			// range is 0 to 255 thus bitwise AND with 0xff
 			a = pixels[index];
 			b = pixels[index+1];
@@ -839,10 +1343,15 @@ void CBlit::resizeBilinearA8R8G8B8( const void* src, u32 w1, u32 h1, void* targe
 			red = (u32) (((a>>16)&0xff)*(1-x_diff)*(1-y_diff) + ((b>>16)&0xff)*(x_diff)*(1-y_diff) +
 				((c>>16)&0xff)*(y_diff)*(1-x_diff)   + ((d>>16)&0xff)*(x_diff*y_diff));
 
-			SColor color(gray, red, green, blue);
-			convert_viaFormat(&color, ECF_A8R8G8B8, 1, (u8*)target + bpp * (i * w2 + j), format);                                
+			out[j] = SColor(gray, red, green, blue).color;
 		}
+
+		if (row)
+			convert_viaFormat(row, ECF_A8R8G8B8, (s32)w2, (u8*)target + bpp * i * w2, format);
 	}
+
+	if (row)
+		Z_FreeTempMemory(row);
 }
 
 void CBlit::resizeBilinearR8G8B8( const void* src, u32 w1, u32 h1, void* target, u32 w2, u32 h2, ECOLOR_FORMAT format )
@@ -1169,4 +1678,135 @@ void CBlit::copyR8G8B8BitMipMap( const u8* src, u8* tgt, u32 width, u32 height,
 			t[2] = b;
 		}
 	}
-}
\ No newline at end of file
+}
+
+void CBlit::resizeBilinearA8R8G8B8Fixed( const u32* src, u32 w1, u32 h1, u32* target, u32 w2, u32 h2, u32 targetPitch )
+{
+	if (!w2 || !h2)
+		return;
+
+	ASSERT(w1 > 1 && h1 > 1);
+
+	//16.16, ȨȡСֵĸ8λ
+	u32 xStep = (u32)(((u64)(w1 - 1) << 16) / w2);
+	u32 yStep = (u32)(((u64)(h1 - 1) << 16) / h2);
+
+#ifdef MW_USE_SSE
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i w256 = _mm_set1_epi16(256);
+#endif
+
+	for (u32 i=0; i<h2; ++i)
+	{
+		u32 fy = i * yStep;
+		u32 y = fy >> 16;
+		u32 wy = (fy >> 8) & 0xff;
+		const u32* row0 = src + y * w1;
+		const u32* row1 = row0 + w1;
+		u32* out = (u32*)((u8*)target + i * targetPitch);
+
+#ifdef MW_USE_SSE
+		const __m128i vwy = _mm_set1_epi16((s16)wy);
+		const __m128i vwy0 = _mm_sub_epi16(w256, vwy);
+#endif
+
+		for (u32 j=0; j<w2; ++j)
+		{
+			u32 fx = j * xStep;
+			u32 x = fx >> 16;
+			u32 wx = (fx >> 8) & 0xff;
+
+#ifdef MW_USE_SSE
+			//[a, b][c, d]ռһĴ, ٺֵ
+			__m128i top = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(row0 + x)), zero);
+			__m128i bottom = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(row1 + x)), zero);
+			__m128i v = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(top, vwy0), _mm_mullo_epi16(bottom, vwy)), 8);
+
+			__m128i vwx = _mm_unpacklo_epi64(_mm_set1_epi16((s16)(256 - wx)), _mm_set1_epi16((s16)wx));
+			v = _mm_mullo_epi16(v, vwx);
+			v = _mm_srli_epi16(_mm_add_epi16(v, _mm_srli_si128(v, 8)), 8);
+			out[j] = (u32)_mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+#else
+			u32 a = row0[x], b = row0[x + 1];
+			u32 c = row1[x], d = row1[x + 1];
+			u32 color = 0;
+			for (u32 shift=0; shift<32; shift+=8)
+			{
+				u32 top = (((a >> shift) & 0xff) * (256 - wy) + ((c >> shift) & 0xff) * wy) >> 8;
+				u32 bottom = (((b >> shift) & 0xff) * (256 - wy) + ((d >> shift) & 0xff) * wy) >> 8;
+				color |= (((top * (256 - wx) + bottom * wx) >> 8) & 0xff) << shift;
+			}
+			out[j] = color;
+#endif
+		}
+	}
+}
+
+void CBlit::blendA8R8G8B8( const u32* src, u32* dst, u32 count )
+{
+	u32 i = 0;
+
+#ifdef MW_USE_SSE
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i v255 = _mm_set1_epi16(255);
+	const __m128i v128 = _mm_set1_epi16(128);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+
+		//ȫ͸4زô, ȫ͸ֱӿ
+		__m128i alpha = _mm_srli_epi32(s, 24);
+		s32 transparent = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, zero));
+		if (transparent == 0xffff)
+			continue;
+		s32 opaque = _mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_set1_epi32(255)));
+		if (opaque == 0xffff)
+		{
+			_mm_storeu_si128((__m128i*)(dst + i), s);
+			continue;
+		}
+
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+
+		__m128i sLo = _mm_unpacklo_epi8(s, zero);
+		__m128i sHi = _mm_unpackhi_epi8(s, zero);
+		__m128i dLo = _mm_unpacklo_epi8(d, zero);
+		__m128i dHi = _mm_unpackhi_epi8(d, zero);
+
+		//ÿصalphaչ416λ
+		__m128i aLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sLo, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+		__m128i aHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sHi, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+
+		//x = s * a + d * (255 - a), x / 255 = (x + 128 + ((x + 128) >> 8)) >> 8
+		__m128i xLo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(sLo, aLo), _mm_mullo_epi16(dLo, _mm_sub_epi16(v255, aLo))), v128);
+		__m128i xHi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(sHi, aHi), _mm_mullo_epi16(dHi, _mm_sub_epi16(v255, aHi))), v128);
+		xLo = _mm_srli_epi16(_mm_add_epi16(xLo, _mm_srli_epi16(xLo, 8)), 8);
+		xHi = _mm_srli_epi16(_mm_add_epi16(xHi, _mm_srli_epi16(xHi, 8)), 8);
+
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(xLo, xHi));
+	}
+#endif
+
+	for (; i<count; ++i)
+	{
+		u32 s = src[i];
+		u32 a = s >> 24;
+		if (a == 0)
+			continue;
+		if (a == 255)
+		{
+			dst[i] = s;
+			continue;
+		}
+
+		u32 d = dst[i];
+		u32 color = 0;
+		for (u32 shift=0; shift<32; shift+=8)
+		{
+			u32 x = ((s >> shift) & 0xff) * a + ((d >> shift) & 0xff) * (255 - a) + 128;
+			color |= ((x + (x >> 8)) >> 8) << shift;
+		}
+		dst[i] = color;
+	}
+}
@@ -5,6 +5,17 @@
 
 class CImage;
 
+//ʽתʹõָ, ʱcpuѡߵһ
+enum E_BLIT_SIMD
+{
+	EBS_SCALAR = 0,
+	EBS_SSE2,
+	EBS_SSSE3,			//24λʽֽ
+	EBS_AVX2,
+
+	EBS_COUNT,
+};
+
 struct SBlitJob
 {
 	void * src;
@@ -30,6 +41,11 @@ public:
 
 	static void convert_viaFormat(const void* sP, ECOLOR_FORMAT sF, s32 sN, void* dP, ECOLOR_FORMAT dF);
 
+	//ʱԽȽϽ, ܳgetMaxSIMDLevel, scalarλͬ
+	static E_BLIT_SIMD getSIMDLevel();
+	static E_BLIT_SIMD getMaxSIMDLevel();
+	static void setSIMDLevel(E_BLIT_SIMD level);
+
 public:
 	static void convert1BitTo16Bit(const u8* in, u16* out, s32 width, s32 height, s32 linepad=0, bool flip=false);
 
@@ -55,6 +71,12 @@ public:
 	//bicubic interpolationȷȻкڱ
 	static void resizeBicubicA8R8G8B8( const void* src, u32 w1, u32 h1, void* target, u32 w2, u32 h2, ECOLOR_FORMAT format );
 
+	//resizeBilinearA8R8G8B8λͬ, 8λȨ, ֻA8R8G8B8, Ŀɴpitch
+	static void resizeBilinearA8R8G8B8Fixed( const u32* src, u32 w1, u32 h1, u32* target, u32 w2, u32 h2, u32 targetPitch );
+
+	//dst = src * a + dst * (1 - a), aΪsrcalpha, alphaͨ, 
+	static void blendA8R8G8B8(const u32* src, u32* dst, u32 count);
+
 
 	static void copyA8L8MipMap(const u8* src, u8* tgt,
 		u32 width, u32 height,  u32 pitchsrc, u32 pitchtgt);
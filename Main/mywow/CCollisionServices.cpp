@@ -0,0 +1,222 @@
+#include "stdafx.h"
+#include "CCollisionServices.h"
+#include "mywow.h"
+#include "CTileCollision.h"
+#include "CJobSystem.h"
+
+CCollisionServices::CCollisionServices()
+{
+
+}
+
+CCollisionServices::~CCollisionServices()
+{
+	for (u32 i=0; i<(u32)Tiles.size(); ++i)
+		delete Tiles[i].collision;
+}
+
+CCollisionServices::STileEntry* CCollisionServices::findTile( IFileADT* adt )
+{
+	for (u32 i=0; i<(u32)Tiles.size(); ++i)
+	{
+		if (Tiles[i].adt == adt)
+			return &Tiles[i];
+	}
+	return NULL_PTR;
+}
+
+void CCollisionServices::updateTileBox( STileEntry& entry )
+{
+	entry.box = entry.collision->getBoundingBox();
+	entry.mat.transformBox(entry.box);
+}
+
+void CCollisionServices::addTile( IFileADT* adt, const matrix4& transform )
+{
+	STileEntry* entry = findTile(adt);
+	if (!entry)
+	{
+		STileEntry newEntry;
+		newEntry.adt = adt;
+		newEntry.collision = new CTileCollision(adt);
+		Tiles.push_back(newEntry);
+		entry = &Tiles.back();
+	}
+
+	entry->mat = transform;
+	if (!transform.getInverse(entry->invMat))
+		entry->invMat = matrix4::Identity();
+
+	vector3df unit(1, 0, 0);
+	entry->invMat.rotateVect(unit);
+	entry->invScale = unit.getLength();
+
+	updateTileBox(*entry);
+}
+
+void CCollisionServices::removeTile( IFileADT* adt )
+{
+	for (u32 i=0; i<(u32)Tiles.size(); ++i)
+	{
+		if (Tiles[i].adt == adt)
+		{
+			delete Tiles[i].collision;
+			Tiles[i] = Tiles.back();
+			Tiles.pop_back();
+			return;
+		}
+	}
+}
+
+void CCollisionServices::addM2Instance( IFileADT* adt, IFileM2* m2, const matrix4& mat )
+{
+	STileEntry* entry = findTile(adt);
+	if (!entry)
+		return;
+
+	entry->collision->addM2Instance(m2, mat);
+	updateTileBox(*entry);
+}
+
+void CCollisionServices::addWMOInstance( IFileADT* adt, IFileWMO* wmo, const matrix4& mat )
+{
+	STileEntry* entry = findTile(adt);
+	if (!entry)
+		return;
+
+	entry->collision->addWMOInstance(wmo, mat);
+	updateTileBox(*entry);
+}
+
+bool CCollisionServices::sweep( const vector3df& start, const vector3df& end, f32 radius, SCollisionHit& hit ) const
+{
+	hit = SCollisionHit();
+
+	aabbox3df sweepBox(start);
+	sweepBox.addInternalPoint(end);
+	sweepBox.MinEdge -= vector3df(radius);
+	sweepBox.MaxEdge += vector3df(radius);
+
+	//fractionڸtile乲, tileҵвŻ
+	const STileEntry* hitTile = NULL_PTR;
+	for (u32 i=0; i<(u32)Tiles.size(); ++i)
+	{
+		const STileEntry& entry = Tiles[i];
+		if (!entry.box.intersectsWithBox(sweepBox))
+			continue;
+
+		vector3df localStart = start;
+		vector3df localEnd = end;
+		entry.invMat.transformVect(localStart);
+		entry.invMat.transformVect(localEnd);
+
+		if (entry.collision->sweep(localStart, localEnd, radius * entry.invScale, hit))
+			hitTile = &entry;
+	}
+
+	if (!hitTile)
+		return false;
+
+	hitTile->mat.rotateVect(hit.normal);
+	hit.normal.normalize();
+	hit.position = start + (end - start) * hit.fraction;
+	return true;
+}
+
+bool CCollisionServices::raycast( const line3df& ray, SCollisionHit& hit ) const
+{
+	return sweep(ray.start, ray.end, 0.0f, hit);
+}
+
+bool CCollisionServices::getHeightBelow( const vector3df& pos, f32 maxDrop, SCollisionHit& hit ) const
+{
+	return sweep(pos, vector3df(pos.X, pos.Y - maxDrop, pos.Z), 0.0f, hit);
+}
+
+bool CCollisionServices::sweepSphere( const vector3df& start, const vector3df& end, f32 radius, SCollisionHit& hit ) const
+{
+	return sweep(start, end, radius, hit);
+}
+
+u32 CCollisionServices::raycastBatch( const line3df* rays, u32 count, SCollisionHit* hits )
+{
+	SBatchJob proto = {0};
+	proto.services = this;
+	proto.rays = rays;
+	proto.hits = hits;
+	return runBatch(proto, count);
+}
+
+u32 CCollisionServices::getHeightBelowBatch( const vector3df* positions, u32 count, f32 maxDrop, SCollisionHit* hits )
+{
+	SBatchJob proto = {0};
+	proto.services = this;
+	proto.starts = positions;
+	proto.maxDrop = maxDrop;
+	proto.hits = hits;
+	return runBatch(proto, count);
+}
+
+u32 CCollisionServices::sweepSphereBatch( const vector3df* starts, const vector3df* ends, u32 count, f32 radius, SCollisionHit* hits )
+{
+	SBatchJob proto = {0};
+	proto.services = this;
+	proto.starts = starts;
+	proto.ends = ends;
+	proto.radius = radius;
+	proto.hits = hits;
+	return runBatch(proto, count);
+}
+
+u32 CCollisionServices::runBatch( SBatchJob& proto, u32 count )
+{
+	if (!count)
+		return 0;
+
+	//ʱֱڵִ߳
+	if (count <= BATCH_JOB_SIZE)
+	{
+		proto.begin = 0;
+		proto.end = count;
+		batchJob(&proto);
+		return proto.numHits;
+	}
+
+	u32 numJobs = (count + BATCH_JOB_SIZE - 1) / BATCH_JOB_SIZE;
+	std::vector<SBatchJob> jobs(numJobs, proto);
+	std::vector<void*> params(numJobs);
+	for (u32 i=0; i<numJobs; ++i)
+	{
+		jobs[i].begin = i * BATCH_JOB_SIZE;
+		jobs[i].end = min_(count, jobs[i].begin + BATCH_JOB_SIZE);
+		params[i] = &jobs[i];
+	}
+
+	g_Engine->getJobSystem()->parallelFor(batchJob, &params[0], numJobs);
+
+	u32 numHits = 0;
+	for (u32 i=0; i<numJobs; ++i)
+		numHits += jobs[i].numHits;
+	return numHits;
+}
+
+void CCollisionServices::batchJob( void* param )
+{
+	SBatchJob* job = reinterpret_cast<SBatchJob*>(param);
+	const CCollisionServices* services = job->services;
+
+	job->numHits = 0;
+	for (u32 i=job->begin; i<job->end; ++i)
+	{
+		bool ret;
+		if (job->rays)
+			ret = services->sweep(job->rays[i].start, job->rays[i].end, 0.0f, job->hits[i]);
+		else if (job->ends)
+			ret = services->sweep(job->starts[i], job->ends[i], job->radius, job->hits[i]);
+		else
+			ret = services->getHeightBelow(job->starts[i], job->maxDrop, job->hits[i]);
+
+		if (ret)
+			++job->numHits;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ICollisionServices.h"
+#include <vector>
+
+class CTileCollision;
+
+//ֻ߳޸tileʵ, ѯʱֻ߳
+class CCollisionServices : public ICollisionServices
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CCollisionServices);
+
+public:
+	CCollisionServices();
+	~CCollisionServices();
+
+public:
+	virtual void addTile(IFileADT* adt, const matrix4& transform);
+	virtual void removeTile(IFileADT* adt);
+
+	virtual void addM2Instance(IFileADT* adt, IFileM2* m2, const matrix4& mat);
+	virtual void addWMOInstance(IFileADT* adt, IFileWMO* wmo, const matrix4& mat);
+
+	virtual bool raycast(const line3df& ray, SCollisionHit& hit) const;
+	virtual bool getHeightBelow(const vector3df& pos, f32 maxDrop, SCollisionHit& hit) const;
+	virtual bool sweepSphere(const vector3df& start, const vector3df& end, f32 radius, SCollisionHit& hit) const;
+
+	virtual u32 raycastBatch(const line3df* rays, u32 count, SCollisionHit* hits);
+	virtual u32 getHeightBelowBatch(const vector3df* positions, u32 count, f32 maxDrop, SCollisionHit* hits);
+	virtual u32 sweepSphereBatch(const vector3df* starts, const vector3df* ends, u32 count, f32 radius, SCollisionHit* hits);
+
+private:
+	enum
+	{
+		BATCH_JOB_SIZE = 64,
+	};
+
+	struct STileEntry
+	{
+		IFileADT*		adt;
+		CTileCollision*		collision;
+		matrix4		mat;
+		matrix4		invMat;
+		f32		invScale;
+		aabbox3df		box;			//ռ
+	};
+
+	struct SBatchJob
+	{
+		const CCollisionServices*		services;
+		const vector3df*		starts;
+		const vector3df*		ends;
+		const line3df*		rays;
+		SCollisionHit*		hits;
+		u32		begin;
+		u32		end;
+		f32		radius;
+		f32		maxDrop;
+		u32		numHits;
+	};
+
+	STileEntry* findTile(IFileADT* adt);
+	void updateTileBox(STileEntry& entry);
+
+	bool sweep(const vector3df& start, const vector3df& end, f32 radius, SCollisionHit& hit) const;
+
+	u32 runBatch(SBatchJob& proto, u32 count);
+
+	static void batchJob(void* param);
+
+private:
+	std::vector<STileEntry>		Tiles;
+};
@@ -8,6 +8,7 @@
 
 #include "CImage.h"
 #include "CBLPImage.h"
+#include "CDXTEncoder.h"
 #include "CD3D11Texture.h"
 #include "CD3D11RenderTarget.h"
 #include "CD3D11Driver.h"
@@ -17,6 +18,8 @@ CD3D11ManualTextureServices::CD3D11ManualTextureServices()
 	Driver= static_cast<CD3D11Driver*>(g_Engine->getDriver());
 	Driver->registerLostReset(this);
 
+	DXTEncoder = new CDXTEncoder(true);
+
 	loadDefaultTextures();
 }
 
@@ -24,6 +27,8 @@ CD3D11ManualTextureServices::~CD3D11ManualTextureServices()
 {
 	Driver->removeLostReset(this);
 
+	delete DXTEncoder;
+
 	for (T_TextureMap::const_iterator itr = TextureMap.begin(); itr != TextureMap.end(); ++itr)
 	{
 		ITexture* tex = itr->second;
@@ -115,7 +120,7 @@ ITexture* CD3D11ManualTextureServices::createTextureFromData( const dimension2du
 ITexture* CD3D11ManualTextureServices::createCompressTextureFromData( const dimension2du& size, ECOLOR_FORMAT format, const void* data, bool mipmap )
 {
 	CBLPImage* image = new CBLPImage;
-	if (!image->fromImageData((const u8*)data, size, format, mipmap))
+	if (!image->fromImageData((const u8*)data, size, format, mipmap, ECF_DXT1, DXTEncoder))
 	{
 		image->drop();
 		return NULL_PTR;
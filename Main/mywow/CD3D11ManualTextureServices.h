@@ -7,6 +7,7 @@
 #include "IManualTextureServices.h"
 
 class CD3D11Driver;
+class CDXTEncoder;
 
 class CD3D11ManualTextureServices : public  IManualTextureServices
 {
@@ -41,6 +42,7 @@ private:
 	T_RTList		RenderTargets;
 
 	CD3D11Driver*	Driver;
+	CDXTEncoder*	DXTEncoder;			//createCompressTextureFromDataʹ
 };
 
 #endif
\ No newline at end of file
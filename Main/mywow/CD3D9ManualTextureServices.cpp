@@ -8,6 +8,7 @@
 
 #include "CImage.h"
 #include "CBLPImage.h"
+#include "CDXTEncoder.h"
 #include "CD3D9Texture.h"
 #include "CD3D9RenderTarget.h"
 #include "CD3D9Driver.h"
@@ -17,6 +18,8 @@ CD3D9ManualTextureServices::CD3D9ManualTextureServices()
 	Driver = static_cast<CD3D9Driver*>(g_Engine->getDriver());
 	Driver->registerLostReset(this);
 
+	DXTEncoder = new CDXTEncoder(true);
+
 	loadDefaultTextures();
 }
 
@@ -24,6 +27,8 @@ CD3D9ManualTextureServices::~CD3D9ManualTextureServices()
 {	
 	Driver->removeLostReset(this);
 
+	delete DXTEncoder;
+
 	for (T_TextureMap::const_iterator itr = TextureMap.begin(); itr != TextureMap.end(); ++itr)
 	{
 		ITexture* tex = itr->second;
@@ -131,7 +136,7 @@ ITexture* CD3D9ManualTextureServices::createTextureFromData( const dimension2du&
 ITexture* CD3D9ManualTextureServices::createCompressTextureFromData( const dimension2du& size, ECOLOR_FORMAT format, const void* data, bool mipmap )
 {
 	CBLPImage* image = new CBLPImage;
-	if (!image->fromImageData((const u8*)data, size, format, mipmap))
+	if (!image->fromImageData((const u8*)data, size, format, mipmap, ECF_DXT1, DXTEncoder))
 	{
 		image->drop();
 		return NULL_PTR;
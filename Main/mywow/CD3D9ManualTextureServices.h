@@ -10,6 +10,7 @@
 #include "fixstring.h"
 
 class CD3D9Driver;
+class CDXTEncoder;
 
 class CD3D9ManualTextureServices : public IManualTextureServices
 {
@@ -44,6 +45,7 @@ private:
 	T_RTList		RenderTargets;
 
 	CD3D9Driver* Driver;
+	CDXTEncoder*	DXTEncoder;			//createCompressTextureFromDataʹ
 };
 
 #endif
\ No newline at end of file
@@ -2,6 +2,10 @@
 #include "CDSAudioPlayer.h"
 #include "mywow.h"
 #include "CDSSound.h"
+#include "CAudioDecodeServices.h"
+
+#define AUDIO_CACHE_LIMIT		(16 * 1024 * 1024)
+#define AUDIO_MAX_CLIP_SIZE		(1024 * 1024)			//Լ644.1k
 
 #ifdef MW_PLATFORM_WINDOWS
 
@@ -13,6 +17,7 @@ CDSAudioPlayer::CDSAudioPlayer( ) : AudioAvailable(false)
 {
 	HLib = NULL_PTR;
 	pIDSound = NULL_PTR;
+	DecodeServices = new CAudioDecodeServices(AUDIO_CACHE_LIMIT, AUDIO_MAX_CLIP_SIZE);
 	::memset(WavSounds, 0, sizeof(CDSSound*)*NUM_WAV_SOUNDS);
 	::memset(OggSounds, 0, sizeof(CDSSound*)*NUM_OGG_SOUNDS);
 	::memset(Mp3Sounds, 0, sizeof(CDSSound*)*NUM_MP3_SOUNDS);
@@ -35,6 +40,8 @@ CDSAudioPlayer::~CDSAudioPlayer()
 	for (u32 i=0; i<NUM_OGG_SOUNDS; ++i) delete OggSounds[i];
 	for (u32 i=0; i<NUM_MP3_SOUNDS; ++i) delete Mp3Sounds[i];
 
+	delete DecodeServices;
+
 	if (pIDSound)
 		pIDSound->Release();
 
@@ -75,13 +82,13 @@ bool CDSAudioPlayer::initDevice( HWND hwnd, u32 primaryChannels, u32 primarySamp
 	bool ret = setPrimaryBufferFormat(primaryChannels, primarySampleRate, primayBitsPerSample);
 
 	for (u32 i=0; i<NUM_WAV_SOUNDS; ++i)
-		WavSounds[i] = new CDSSound(pIDSound, EST_WAV, i);
+		WavSounds[i] = new CDSSound(pIDSound, DecodeServices, EST_WAV, i);
 
 	for (u32 i=0; i<NUM_OGG_SOUNDS; ++i)
-		OggSounds[i] = new CDSSound(pIDSound, EST_OGG, i);
+		OggSounds[i] = new CDSSound(pIDSound, DecodeServices, EST_OGG, i);
 
 	for (u32 i=0; i<NUM_MP3_SOUNDS; ++i) 
-		Mp3Sounds[i] = new CDSSound(pIDSound, EST_MP3, i);
+		Mp3Sounds[i] = new CDSSound(pIDSound, DecodeServices, EST_MP3, i);
 
 	if (ret)
 		g_Engine->getFileSystem()->writeLog(ELOG_SOUND, "DSAudioPlayer successfully created!");
@@ -9,6 +9,7 @@
 #ifdef MW_USE_AUDIO
 
 class CDSSound;
+class CAudioDecodeServices;
 
 class CDSAudioPlayer : public IAudioPlayer
 {
@@ -46,6 +47,8 @@ private:
 	HMODULE		HLib;
 	LPDIRECTSOUND		pIDSound;
 
+	CAudioDecodeServices*		DecodeServices;
+
 	CDSSound*	WavSounds[NUM_WAV_SOUNDS];
 	CDSSound*	OggSounds[NUM_OGG_SOUNDS];
 	CDSSound*	Mp3Sounds[NUM_MP3_SOUNDS];
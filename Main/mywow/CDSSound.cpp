@@ -6,14 +6,12 @@
 #ifdef MW_USE_AUDIO
 
 #include "mywow.h"
-#include "CWavInput.h"
-#include "CVorbisInput.h"
-#include "CMP3Input.h"
+#include "CAudioDecodeServices.h"
 
 #define  NUM_PLAY_NOTIFICATIONS 16
 
-CDSSound::CDSSound(LPDIRECTSOUND pIDS, E_SOUND_TYPE type, u32 index)
-	: pIDSound(pIDS), pIDSBuffer(NULL_PTR), pIDNotify(NULL_PTR), ISound(type), Index(index), Callback(NULL_PTR)
+CDSSound::CDSSound(LPDIRECTSOUND pIDS, CAudioDecodeServices* decodeServices, E_SOUND_TYPE type, u32 index)
+	: pIDSound(pIDS), DecodeServices(decodeServices), Stream(NULL_PTR), pIDSBuffer(NULL_PTR), pIDNotify(NULL_PTR), ISound(type), Index(index), Callback(NULL_PTR)
 {
 	INIT_LOCK(&cs);
 	INIT_EVENT(&NotificationEvent, "");
@@ -23,23 +21,6 @@ CDSSound::CDSSound(LPDIRECTSOUND pIDS, E_SOUND_TYPE type, u32 index)
 	NotifySize = 0;
 	Volume = 1.0f;
 
-	switch (type)
-	{
-	case EST_WAV:
-		AudioInput = new CWavInput;
-		break;
-	case EST_OGG:
-		AudioInput = new CVorbisInput;
-		break;
-	case EST_MP3:
-		AudioInput = new CMP3Input;
-		break;
-	default:
-		ASSERT(false);
-		AudioInput = NULL_PTR;
-		break;
-	}
-
 	memset(&LastWFX, 0, sizeof(WAVEFORMATEX));
 	memset(&WFX, 0, sizeof(WAVEFORMATEX));
 
@@ -49,7 +30,6 @@ CDSSound::CDSSound(LPDIRECTSOUND pIDS, E_SOUND_TYPE type, u32 index)
 CDSSound::~CDSSound()
 {
 	unload();
-	delete AudioInput;
 
 	SAFE_RELEASE_STRICT(pIDSBuffer);
 	SAFE_RELEASE_STRICT(pIDNotify);
@@ -62,24 +42,25 @@ bool CDSSound::load( const c8* filename )
 {
 	unload();
 
-	BEGIN_LOCK(&cs);
-	bool ret = AudioInput->openFile(filename);
-	if (!ret)
+	CAudioStream* stream = DecodeServices->openStream(filename, (E_SOUND_TYPE)Type);
+	if (!stream)
 	{
-		END_LOCK(&cs);
 		ASSERT(false);
 		return false;
 	}
+
+	BEGIN_LOCK(&cs);
+	Stream = stream;
 	END_LOCK(&cs);
 
 	//create dsbuffer
 	memset(&WFX, 0, sizeof(WAVEFORMATEX));
 	WFX.cbSize = 0;
 	WFX.wFormatTag = WAVE_FORMAT_PCM;
-	WFX.nSamplesPerSec = (DWORD)AudioInput->SampleRate;
-	WFX.nChannels = (WORD)AudioInput->NumChannels;
-	WFX.wBitsPerSample = (WORD)AudioInput->BitsPerSample;
-	WFX.nBlockAlign = (WORD)AudioInput->getSampleSize();
+	WFX.nSamplesPerSec = (DWORD)Stream->SampleRate;
+	WFX.nChannels = (WORD)Stream->NumChannels;
+	WFX.wBitsPerSample = (WORD)Stream->BitsPerSample;
+	WFX.nBlockAlign = (WORD)Stream->getSampleSize();
 	WFX.nAvgBytesPerSec = WFX.nSamplesPerSec * WFX.nBlockAlign;
 	
 	if (WFX.wFormatTag != LastWFX.wFormatTag ||
@@ -115,10 +96,12 @@ void CDSSound::unload()
 		stop();
 
 	BEGIN_LOCK(&cs);
-	if(AudioInput)
-		AudioInput->closeFile();
+	CAudioStream* stream = Stream;
+	Stream = NULL_PTR;
 	END_LOCK(&cs);
 
+	DecodeServices->closeStream(stream);
+
 	reset();
 }
 
@@ -136,6 +119,8 @@ bool CDSSound::play(bool loop, FN_SOUND_CALLBACK callback)
 
 	Callback = callback;
 	Loop = loop;
+	if (Stream)
+		Stream->setLoop(loop);			//ѭstreamڽʱν
 
 	pIDSBuffer->Play(0, 0, DSBPLAY_LOOPING);
 
@@ -164,8 +149,11 @@ void CDSSound::reset()
 	SilenceCount = 0;
 	Callback = NULL_PTR;
 
-	if(AudioInput)
-		AudioInput->reset();
+	if (Stream)
+	{
+		Stream->setLoop(false);
+		Stream->rewind();
+	}
 
 	if (pIDSBuffer)
 	{
@@ -204,8 +192,6 @@ bool CDSSound::isStopped() const
 
 bool CDSSound::handleStreamNotification()
 {
-	ASSERT(AudioInput);
-
 	bool restored = false;
 	if (!restoreBuffer(restored, 100))
 		return false;
@@ -217,6 +203,12 @@ bool CDSSound::handleStreamNotification()
 
 	BEGIN_LOCK(&cs);
 
+	if (!Stream)
+	{
+		END_LOCK(&cs);
+		return false;
+	}
+
 	if (restored)
 	{
 		fillBufferWithSilence();
@@ -234,41 +226,27 @@ bool CDSSound::handleStreamNotification()
 	}
 	ASSERT(!pDSLockedBuffer2);
 
+	//ӻλ򻺴pcm, ڽ߳
 	u32 written;
 	if (!FillNextNotificationWithSilence)
-		written = AudioInput->fillBuffer(pDSLockedBuffer, dwDSLockedBufferSize);
+		written = Stream->read(pDSLockedBuffer, dwDSLockedBufferSize);
 	else
 	{
 		FillMemory((u8*)pDSLockedBuffer, 
 			dwDSLockedBufferSize,
-			(u8)(AudioInput->BitsPerSample == 8 ? 128 : 0));
+			(u8)(Stream->BitsPerSample == 8 ? 128 : 0));
 		written = dwDSLockedBufferSize;
 		++SilenceCount;
 	}
 
-	if (written < dwDSLockedBufferSize)
+	if (written < dwDSLockedBufferSize)			//ѭʱstreamǰ
 	{	
-		if (!Loop)
-		{
-			FillMemory((u8*)pDSLockedBuffer + written, 
-				dwDSLockedBufferSize - written,
-				(u8)(AudioInput->BitsPerSample == 8 ? 128 : 0));
+		FillMemory((u8*)pDSLockedBuffer + written, 
+			dwDSLockedBufferSize - written,
+			(u8)(Stream->BitsPerSample == 8 ? 128 : 0));
 
-			FillNextNotificationWithSilence = true;
-			SilenceCount = 0;
-		}
-		else
-		{
-			u32 nRead = written;
-			AudioInput->reset();
-			while(nRead < dwDSLockedBufferSize )
-			{
-				u32 n = AudioInput->fillBuffer( (u8*)pDSLockedBuffer + nRead,
-					dwDSLockedBufferSize - nRead);
-
-				nRead += n;
-			}
-		}
+		FillNextNotificationWithSilence = true;
+		SilenceCount = 0;
 	}
 
 	pIDSBuffer->Unlock(pDSLockedBuffer, dwDSLockedBufferSize, NULL_PTR, 0);
@@ -342,7 +320,7 @@ void CDSSound::fillBufferWithSilence()
 	//0
 	FillMemory((u8*)pDSLockedBuffer, 
 		dwDSLockedBufferSize,
-		(u8)(AudioInput->BitsPerSample == 8 ? 128 : 0));
+		(u8)(WFX.wBitsPerSample == 8 ? 128 : 0));
 
 	pIDSBuffer->Unlock(pDSLockedBuffer, dwDSLockedBufferSize, NULL_PTR, 0);
 }
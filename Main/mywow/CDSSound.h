@@ -8,14 +8,15 @@
 
 #include <dsound.h>
 
-class IAudioInput;
+class CAudioStream;
+class CAudioDecodeServices;
 struct SAudioSetting;
 
-//ʾһƵļds֣ݲCXXXInput 
+//ʾһƵļds֣CAudioDecodeServicesĽ߳ǰ׼ 
 class CDSSound : public ISound
 {
 public:
-	CDSSound(LPDIRECTSOUND pIDS, E_SOUND_TYPE type, u32 index);
+	CDSSound(LPDIRECTSOUND pIDS, CAudioDecodeServices* decodeServices, E_SOUND_TYPE type, u32 index);
 	~CDSSound();
 
 public:
@@ -39,7 +40,8 @@ protected:
 private:
 	LPDIRECTSOUND		pIDSound;
 
-	IAudioInput*		AudioInput;
+	CAudioDecodeServices*		DecodeServices;
+	CAudioStream*		Stream;
 	
 	LPDIRECTSOUNDBUFFER		pIDSBuffer;
 	event_type		NotificationEvent;
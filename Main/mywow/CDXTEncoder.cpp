@@ -0,0 +1,491 @@
+#include "stdafx.h"
+#include "CDXTEncoder.h"
+#include "mywow.h"
+#include "CJobSystem.h"
+#include <vector>
+
+#ifdef MW_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	struct SColorBlock
+	{
+		f32		r[16];
+		f32		g[16];
+		f32		b[16];
+	};
+
+	inline void loadColorBlock(const u32* pixels, SColorBlock& block)
+	{
+		for (u32 i=0; i<16; ++i)
+		{
+			block.r[i] = (f32)((pixels[i] >> 16) & 0xff);
+			block.g[i] = (f32)((pixels[i] >> 8) & 0xff);
+			block.b[i] = (f32)(pixels[i] & 0xff);
+		}
+	}
+
+	inline u32 quantize(f32 v, u32 maxValue)
+	{
+		s32 q = (s32)(v * maxValue / 255.0f + 0.5f);
+		return q < 0 ? 0 : (q > (s32)maxValue ? maxValue : (u32)q);
+	}
+
+	inline u16 packRGB565(const f32* c)
+	{
+		return (u16)((quantize(c[0], 31) << 11) | (quantize(c[1], 63) << 5) | quantize(c[2], 31));
+	}
+
+	//ӲһѸλƵλ
+	inline void unpackRGB565(u16 c, s32* rgb)
+	{
+		s32 r = (c >> 11) & 31;
+		s32 g = (c >> 5) & 63;
+		s32 b = c & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	//4ɫģʽ(c0 > c1)Ϊÿѡɫ, ƽ
+	f32 matchColors(const SColorBlock& block, u16 c0, u16 c1, u32& indices)
+	{
+		s32 p[4][3];
+		unpackRGB565(c0, p[0]);
+		unpackRGB565(c1, p[1]);
+		for (u32 k=0; k<3; ++k)
+		{
+			p[2][k] = (2 * p[0][k] + p[1][k]) / 3;
+			p[3][k] = (p[0][k] + 2 * p[1][k]) / 3;
+		}
+
+		u32 idx[16];
+		f32 err = 0.0f;
+
+#ifdef MW_USE_SSE
+		__m128 pr[4], pg[4], pb[4];
+		for (u32 k=0; k<4; ++k)
+		{
+			pr[k] = _mm_set1_ps((f32)p[k][0]);
+			pg[k] = _mm_set1_ps((f32)p[k][1]);
+			pb[k] = _mm_set1_ps((f32)p[k][2]);
+		}
+
+		__m128 errSum = _mm_setzero_ps();
+		for (u32 i=0; i<16; i+=4)
+		{
+			__m128 r = _mm_loadu_ps(block.r + i);
+			__m128 g = _mm_loadu_ps(block.g + i);
+			__m128 b = _mm_loadu_ps(block.b + i);
+
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIdx = _mm_setzero_si128();
+			for (u32 k=0; k<4; ++k)
+			{
+				__m128 dr = _mm_sub_ps(r, pr[k]);
+				__m128 dg = _mm_sub_ps(g, pg[k]);
+				__m128 db = _mm_sub_ps(b, pb[k]);
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+				best = _mm_min_ps(d, best);
+				bestIdx = _mm_or_si128(_mm_andnot_si128(closer, bestIdx), _mm_and_si128(closer, _mm_set1_epi32((s32)k)));
+			}
+
+			errSum = _mm_add_ps(errSum, best);
+			_mm_storeu_si128((__m128i*)(idx + i), bestIdx);
+		}
+
+		//붼, ͵˳Ӱ
+		f32 lanes[4];
+		_mm_storeu_ps(lanes, errSum);
+		err = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+		for (u32 i=0; i<16; ++i)
+		{
+			f32 best = FLT_MAX;
+			idx[i] = 0;
+			for (u32 k=0; k<4; ++k)
+			{
+				f32 dr = block.r[i] - p[k][0];
+				f32 dg = block.g[i] - p[k][1];
+				f32 db = block.b[i] - p[k][2];
+				f32 d = dr * dr + dg * dg + db * db;
+				if (d < best)
+				{
+					best = d;
+					idx[i] = k;
+				}
+			}
+			err += best;
+		}
+#endif
+
+		indices = 0;
+		for (u32 i=0; i<16; ++i)
+			indices |= idx[i] << (i * 2);
+		return err;
+	}
+
+	//ΧеĶԽ, ˸1/16
+	void computeEndpointsBox(const SColorBlock& block, f32* e0, f32* e1)
+	{
+		const f32* channels[3] = { block.r, block.g, block.b };
+		for (u32 k=0; k<3; ++k)
+		{
+			f32 minC = 255.0f, maxC = 0.0f;
+			for (u32 i=0; i<16; ++i)
+			{
+				minC = min_(minC, channels[k][i]);
+				maxC = max_(maxC, channels[k][i]);
+			}
+			f32 inset = (maxC - minC) / 16.0f;
+			e0[k] = maxC - inset;
+			e1[k] = minC + inset;
+		}
+	}
+
+	//Э, ݵ
+	void computeEndpointsPCA(const SColorBlock& block, f32* e0, f32* e1)
+	{
+		f32 mean[3] = {0};
+		for (u32 i=0; i<16; ++i)
+		{
+			mean[0] += block.r[i];
+			mean[1] += block.g[i];
+			mean[2] += block.b[i];
+		}
+		for (u32 k=0; k<3; ++k)
+			mean[k] /= 16.0f;
+
+		f32 cov[6] = {0};			//rr, rg, rb, gg, gb, bb
+		for (u32 i=0; i<16; ++i)
+		{
+			f32 r = block.r[i] - mean[0];
+			f32 g = block.g[i] - mean[1];
+			f32 b = block.b[i] - mean[2];
+			cov[0] += r * r;
+			cov[1] += r * g;
+			cov[2] += r * b;
+			cov[3] += g * g;
+			cov[4] += g * b;
+			cov[5] += b * b;
+		}
+
+		//ӷͨпʼ
+		f32 axis[3];
+		if (cov[0] >= cov[3] && cov[0] >= cov[5])
+		{
+			axis[0] = cov[0]; axis[1] = cov[1]; axis[2] = cov[2];
+		}
+		else if (cov[3] >= cov[5])
+		{
+			axis[0] = cov[1]; axis[1] = cov[3]; axis[2] = cov[4];
+		}
+		else
+		{
+			axis[0] = cov[2]; axis[1] = cov[4]; axis[2] = cov[5];
+		}
+
+		for (u32 iter=0; iter<8; ++iter)
+		{
+			f32 x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			f32 y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			f32 z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+			f32 m = max_(fabs(x), max_(fabs(y), fabs(z)));
+			if (m < 1e-6f)
+				break;
+			axis[0] = x / m;
+			axis[1] = y / m;
+			axis[2] = z / m;
+		}
+
+		f32 len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		if (len < 1e-6f)			//ɫ
+		{
+			for (u32 k=0; k<3; ++k)
+				e0[k] = e1[k] = mean[k];
+			return;
+		}
+		for (u32 k=0; k<3; ++k)
+			axis[k] /= len;
+
+		f32 minT = FLT_MAX, maxT = -FLT_MAX;
+		for (u32 i=0; i<16; ++i)
+		{
+			f32 t = (block.r[i] - mean[0]) * axis[0] + (block.g[i] - mean[1]) * axis[1] + (block.b[i] - mean[2]) * axis[2];
+			minT = min_(minT, t);
+			maxT = max_(maxT, t);
+		}
+
+		f32 inset = (maxT - minT) / 16.0f;
+		maxT -= inset;
+		minT += inset;
+		for (u32 k=0; k<3; ++k)
+		{
+			e0[k] = clamp_(mean[k] + axis[k] * maxT, 0.0f, 255.0f);
+			e1[k] = clamp_(mean[k] + axis[k] * minT, 0.0f, 255.0f);
+		}
+	}
+
+	//̶, С˵
+	bool refineEndpoints(const SColorBlock& block, u32 indices, f32* e0, f32* e1)
+	{
+		static const f32 weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+		f32 aa = 0, bb = 0, ab = 0;
+		f32 ax[3] = {0}, bx[3] = {0};
+		for (u32 i=0; i<16; ++i)
+		{
+			f32 a = weights[(indices >> (i * 2)) & 3];
+			f32 b = 1.0f - a;
+			aa += a * a;
+			bb += b * b;
+			ab += a * b;
+			ax[0] += a * block.r[i]; ax[1] += a * block.g[i]; ax[2] += a * block.b[i];
+			bx[0] += b * block.r[i]; bx[1] += b * block.g[i]; bx[2] += b * block.b[i];
+		}
+
+		f32 det = aa * bb - ab * ab;
+		if (fabs(det) < 1e-6f)
+			return false;
+
+		f32 invDet = 1.0f / det;
+		for (u32 k=0; k<3; ++k)
+		{
+			e0[k] = clamp_((ax[k] * bb - bx[k] * ab) * invDet, 0.0f, 255.0f);
+			e1[k] = clamp_((bx[k] * aa - ax[k] * ab) * invDet, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	void encodeColorBlock(const u32* pixels, E_DXT_QUALITY quality, u8* dest)
+	{
+		SColorBlock block;
+		loadColorBlock(pixels, block);
+
+		f32 e0[3], e1[3];
+		if (quality == EDQ_FAST)
+			computeEndpointsBox(block, e0, e1);
+		else
+			computeEndpointsPCA(block, e0, e1);
+
+		u16 c0 = packRGB565(e0);
+		u16 c1 = packRGB565(e1);
+		if (c0 < c1)
+		{
+			u16 t = c0; c0 = c1; c1 = t;
+		}
+
+		//c0 == c1ʱΪ3ɫģʽ, ȫȡ0
+		u32 indices = 0;
+		if (c0 != c1)
+		{
+			f32 err = matchColors(block, c0, c1, indices);
+
+			for (u32 iter=0; quality == EDQ_HIGH && iter<2; ++iter)
+			{
+				if (!refineEndpoints(block, indices, e0, e1))
+					break;
+
+				u16 n0 = packRGB565(e0);
+				u16 n1 = packRGB565(e1);
+				if (n0 < n1)
+				{
+					u16 t = n0; n0 = n1; n1 = t;
+				}
+				if (n0 == n1)
+					break;
+
+				u32 newIndices;
+				f32 newErr = matchColors(block, n0, n1, newIndices);
+				if (newErr >= err)
+					break;
+
+				c0 = n0;
+				c1 = n1;
+				indices = newIndices;
+				err = newErr;
+			}
+		}
+
+		dest[0] = (u8)(c0 & 0xff);
+		dest[1] = (u8)(c0 >> 8);
+		dest[2] = (u8)(c1 & 0xff);
+		dest[3] = (u8)(c1 >> 8);
+		dest[4] = (u8)(indices & 0xff);
+		dest[5] = (u8)((indices >> 8) & 0xff);
+		dest[6] = (u8)((indices >> 16) & 0xff);
+		dest[7] = (u8)(indices >> 24);
+	}
+
+	//8ֵģʽ(a0 > a1), ÿȡֵ
+	void encodeAlphaBlock(const u32* pixels, u8* dest)
+	{
+		u32 minA = 255, maxA = 0;
+		for (u32 i=0; i<16; ++i)
+		{
+			u32 a = pixels[i] >> 24;
+			minA = min_(minA, a);
+			maxA = max_(maxA, a);
+		}
+
+		u64 bits = 0;
+		if (maxA > minA)
+		{
+			s32 palette[8];
+			palette[0] = (s32)maxA;
+			palette[1] = (s32)minA;
+			for (s32 k=2; k<8; ++k)
+				palette[k] = ((8 - k) * (s32)maxA + (k - 1) * (s32)minA) / 7;
+
+			for (u32 i=0; i<16; ++i)
+			{
+				s32 a = (s32)(pixels[i] >> 24);
+				u32 best = 0;
+				s32 bestDist = 256;
+				for (u32 k=0; k<8; ++k)
+				{
+					s32 d = abs(a - palette[k]);
+					if (d < bestDist)
+					{
+						bestDist = d;
+						best = k;
+					}
+				}
+				bits |= (u64)best << (i * 3);
+			}
+		}
+
+		dest[0] = (u8)maxA;
+		dest[1] = (u8)minA;
+		for (u32 i=0; i<6; ++i)
+			dest[2 + i] = (u8)(bits >> (i * 8));
+	}
+}
+
+CDXTEncoder::CDXTEncoder( bool multithread )
+	: Quality(EDQ_NORMAL), MultiThread(multithread)
+{
+
+}
+
+CDXTEncoder::~CDXTEncoder()
+{
+
+}
+
+void CDXTEncoder::compressBlockDXT1( const u32* block, E_DXT_QUALITY quality, u8* dest )
+{
+	encodeColorBlock(block, quality, dest);
+}
+
+void CDXTEncoder::compressBlockDXT5( const u32* block, E_DXT_QUALITY quality, u8* dest )
+{
+	encodeAlphaBlock(block, dest);
+	encodeColorBlock(block, quality, dest + 8);
+}
+
+u32 CDXTEncoder::compress( const u32* src, u32 width, u32 height, ECOLOR_FORMAT format, u8* dest )
+{
+	if (!width || !height || (format != ECF_DXT1 && format != ECF_DXT5))
+	{
+		ASSERT(false);
+		return 0;
+	}
+
+	bool dxt5 = format == ECF_DXT5;
+	u32 blocksX = (width + 3) / 4;
+	u32 blocksY = (height + 3) / 4;
+
+	SRowJob proto;
+	proto.src = src;
+	proto.dest = dest;
+	proto.width = width;
+	proto.height = height;
+	proto.quality = Quality;
+	proto.dxt5 = dxt5;
+
+	if (!MultiThread || blocksY < MIN_PARALLEL_BLOCK_ROWS)
+	{
+		proto.rowBegin = 0;
+		proto.rowEnd = blocksY;
+		compressRows(proto);
+	}
+	else
+	{
+		u32 numJobs = (blocksY + BLOCK_ROWS_PER_JOB - 1) / BLOCK_ROWS_PER_JOB;
+		std::vector<SRowJob> jobs(numJobs, proto);
+		std::vector<void*> params(numJobs);
+		for (u32 i=0; i<numJobs; ++i)
+		{
+			jobs[i].rowBegin = i * BLOCK_ROWS_PER_JOB;
+			jobs[i].rowEnd = min_(blocksY, jobs[i].rowBegin + BLOCK_ROWS_PER_JOB);
+			params[i] = &jobs[i];
+		}
+
+		g_Engine->getJobSystem()->parallelFor(rowJob, &params[0], numJobs);
+	}
+
+	return blocksX * blocksY * (dxt5 ? 16 : 8);
+}
+
+void CDXTEncoder::compressRows( const SRowJob& job )
+{
+	u32 blocksX = (job.width + 3) / 4;
+	u32 blockBytes = job.dxt5 ? 16 : 8;
+
+	u32 block[16];
+	for (u32 by=job.rowBegin; by<job.rowEnd; ++by)
+	{
+		u8* dest = job.dest + by * blocksX * blockBytes;
+		for (u32 bx=0; bx<blocksX; ++bx)
+		{
+			for (u32 y=0; y<4; ++y)
+			{
+				const u32* row = job.src + min_(by * 4 + y, job.height - 1) * job.width;
+				for (u32 x=0; x<4; ++x)
+					block[y * 4 + x] = row[min_(bx * 4 + x, job.width - 1)];
+			}
+
+			if (job.dxt5)
+				compressBlockDXT5(block, job.quality, dest);
+			else
+				compressBlockDXT1(block, job.quality, dest);
+			dest += blockBytes;
+		}
+	}
+}
+
+void CDXTEncoder::rowJob( void* param )
+{
+	compressRows(*reinterpret_cast<const SRowJob*>(param));
+}
+
+void CDXTEncoder::buildMipLevel( const u32* src, u32 width, u32 height, u32* dest )
+{
+	u32 w = max_(1u, width / 2);
+	u32 h = max_(1u, height / 2);
+
+	for (u32 y=0; y<h; ++y)
+	{
+		const u32* row0 = src + min_(y * 2, height - 1) * width;
+		const u32* row1 = src + min_(y * 2 + 1, height - 1) * width;
+		for (u32 x=0; x<w; ++x)
+		{
+			u32 x0 = min_(x * 2, width - 1);
+			u32 x1 = min_(x * 2 + 1, width - 1);
+			u32 a = row0[x0], b = row0[x1], c = row1[x0], d = row1[x1];
+
+			u32 color = 0;
+			for (u32 shift=0; shift<32; shift+=8)
+			{
+				u32 sum = ((a >> shift) & 0xff) + ((b >> shift) & 0xff) + ((c >> shift) & 0xff) + ((d >> shift) & 0xff);
+				color |= ((sum + 2) >> 2) << shift;
+			}
+			dest[y * w + x] = color;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core.h"
+
+enum E_DXT_QUALITY
+{
+	EDQ_FAST = 0,			//Χж˵
+	EDQ_NORMAL,			//˵
+	EDQ_HIGH,			//˵С
+
+	EDQ_COUNT,
+};
+
+//A8R8G8B8ѹΪDXT1/DXT5, н϶ʱֵ߳
+//compressֻһ߳е
+class CDXTEncoder
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CDXTEncoder);
+
+public:
+	explicit CDXTEncoder(bool multithread);
+	~CDXTEncoder();
+
+public:
+	void setQuality(E_DXT_QUALITY quality) { Quality = quality; }
+	E_DXT_QUALITY getQuality() const { return Quality; }
+
+	//formatΪECF_DXT1ECF_DXT5, ߲4ıʱԵظԵ, дֽ
+	u32 compress(const u32* src, u32 width, u32 height, ECOLOR_FORMAT format, u8* dest);
+
+	//2x2ƽõһmipmap, Ϊmax(1, w/2), max(1, h/2)
+	static void buildMipLevel(const u32* src, u32 width, u32 height, u32* dest);
+
+	//blockΪ4x4A8R8G8B8
+	static void compressBlockDXT1(const u32* block, E_DXT_QUALITY quality, u8* dest);
+	static void compressBlockDXT5(const u32* block, E_DXT_QUALITY quality, u8* dest);
+
+private:
+	enum
+	{
+		MIN_PARALLEL_BLOCK_ROWS = 32,
+		BLOCK_ROWS_PER_JOB = 8,
+	};
+
+	struct SRowJob
+	{
+		const u32*		src;
+		u8*		dest;
+		u32		width;
+		u32		height;
+		u32		rowBegin;
+		u32		rowEnd;
+		E_DXT_QUALITY		quality;
+		bool		dxt5;
+	};
+
+	static void compressRows(const SRowJob& job);
+	static void rowJob(void* param);
+
+private:
+	E_DXT_QUALITY		Quality;
+	bool		MultiThread;
+};
@@ -3,6 +3,7 @@
 #include "mywow.h"
 #include "CFontServices.h"
 #include "CFTGlyphCache.h"
+#include "CSkylinePacker.h"
 
 CFTFont::CFTFont(const char* faceName, int faceIndex, u32 size, int fontStyle, int outlineWidth)
 	: IFTFont(faceName, faceIndex, size, fontStyle, outlineWidth)
@@ -10,7 +11,7 @@ CFTFont::CFTFont(const char* faceName, int faceIndex, u32 size, int fontStyle, i
 	Ascender =
 		Descender = 0;
 
-	NextX = NextY = CurrentX = CurrentY = MaxY = 0;
+	PrewarmPos = 0;
 
 	FontServices = static_cast<CFontServices*>(g_Engine->getFontServices());
 	MyFTGlyphCache = NULL_PTR;
@@ -106,6 +107,7 @@ CFTFont::~CFTFont()
 			g_Engine->getTextureWriteServices()->removeTextureWriter(FontTextures[i]);
 			FontTextures[i]->drop();
 		}
+		delete Packers[i];
 	}
 
 	delete MyFTGlyphCache;
@@ -307,135 +309,226 @@ const IFTFont::SCharInfo* CFTFont::addChar( c16 ch )
 		return NULL;
 	}
 
-	NextX = CurrentX + m_iFontWidth;
+	//Ϣ
+	SCharInfo charInfo;
+
+	charInfo.TexIndex = (int)FontTextures.size()-1;
+	charInfo.offsetX = offsetX;
+	charInfo.offsetY = offsetY;
+	charInfo.width = chW;
+	charInfo.height = chH;
+	charInfo.UVRect.set(0, 0, 0, 0);
 
-	if (NextX > FONT_TEXTURE_SIZE)				//
+	if (bmpW > 0 && bmpH > 0)			//ոַbitmapΪգҪ
 	{
-		CurrentX = 0;
-		NextX = CurrentX + m_iFontWidth;
-		CurrentY = NextY;
+		u32 packW = (u32)bmpW + GLYPH_GUTTER;
+		u32 packH = (u32)bmpH + GLYPH_GUTTER;
+
+		vector2di pos;
+		if (!Packers.back()->insert(packW, packH, pos))			//ҳ, 
+		{
+			addFontTexture();
+
+			if (!Packers.back()->insert(packW, packH, pos))
+			{
+				ASSERT(false);
+				return NULL_PTR;
+			}
+		}
+
+		charInfo.TexIndex = (int)FontTextures.size()-1;
+		charInfo.UVRect.set(pos.X, pos.Y, pos.X + bmpW, pos.Y + bmpH);
+
+		stageGlyph((u32)charInfo.TexIndex, pos, bitmapGlyph);
 	}
 
-	MaxY = CurrentY + m_iFontHeight;						//ҳ, 
-	if (MaxY > FONT_TEXTURE_SIZE)
-	{
-		addFontTexture();
+	CharacterMap[ch] = charInfo;
+
+	return &CharacterMap[ch];
+}
 
-		CurrentX = CurrentY = NextY = 0;
-		MaxY = 0;
+void CFTFont::stageGlyph( u32 page, const vector2di& pos, FT_BitmapGlyph bitmapGlyph )
+{
+	SPendingGlyph glyph;
+	glyph.page = page;
+	glyph.pos = pos;
+	glyph.offset = (u32)PendingAlpha.size();
+	glyph.width = (u32)bitmapGlyph->bitmap.width;
+	glyph.height = (u32)bitmapGlyph->bitmap.rows;
+
+	//FreeTypeеbitmapܱ, ȿ
+	PendingAlpha.resize(glyph.offset + glyph.width * glyph.height);
+	u8* dst = &PendingAlpha[glyph.offset];
+	for (u32 i=0; i<glyph.height; ++i)
+	{
+		const u8* src = bitmapGlyph->bitmap.buffer + (i * bitmapGlyph->bitmap.pitch);
+		memcpy(dst, src, glyph.width);
+		dst += glyph.width;
 	}
 
-	//write texture
-	ITexture* tex = FontTextures.back();
+	PendingGlyphs.push_back(glyph);
+}
 
-	int charposx = CurrentX;
-	int charposy = CurrentY;
+void CFTFont::uploadGlyphs()
+{
+	if (PendingGlyphs.empty())
+		return;
 
-	recti rc(charposx, charposy, charposx + m_iFontWidth, charposy + m_iFontHeight);
+	ITextureWriteServices* writeServices = g_Engine->getTextureWriteServices();
 
-	if (!rc.isEmpty())			//ոַrectΪգҪ
+	//ֻҳ, ҳ˳, ÿҳֻlockύһ
+	u32 begin = 0;
+	while (begin < (u32)PendingGlyphs.size())
 	{
-		//CLock lock(&g_Globals.textureCS);
+		u32 page = PendingGlyphs[begin].page;
+		u32 end = begin + 1;
+		while (end < (u32)PendingGlyphs.size() && PendingGlyphs[end].page == page)
+			++end;
 
-		ITextureWriter* texWriter = g_Engine->getTextureWriteServices()->createTextureWriter(tex, false);
+		ITexture* tex = FontTextures[page];
+		ECOLOR_FORMAT format = tex->getColorFormat();
+		ITextureWriter* texWriter = writeServices->createTextureWriter(tex, false);
 
 		u32 pitch;
 		u8* data = (u8*)texWriter->lock(0, pitch);
 		ASSERT(data);
 
-		//д A8L8
-		if (tex->getColorFormat() == ECF_A8L8)
-		{
-			u8* p = data + (charposy * pitch) + sizeof(u16) * charposx; 
+		recti dirtyRect(FONT_TEXTURE_SIZE, FONT_TEXTURE_SIZE, 0, 0);
 
-			for (int i = 0; i < m_iFontHeight; ++i)
+		for (u32 g=begin; g<end; ++g)
+		{
+			const SPendingGlyph& glyph = PendingGlyphs[g];
+			const u8* src = &PendingAlpha[glyph.offset];
+
+			//ͬµĿհһд, հΪ0
+			u32 rectW = glyph.width + GLYPH_GUTTER;
+			u32 rectH = glyph.height + GLYPH_GUTTER;
+			if (glyph.pos.X + rectW > FONT_TEXTURE_SIZE)
+				rectW = FONT_TEXTURE_SIZE - glyph.pos.X;
+			if (glyph.pos.Y + rectH > FONT_TEXTURE_SIZE)
+				rectH = FONT_TEXTURE_SIZE - glyph.pos.Y;
+
+			if (format == ECF_A8L8)
 			{
-				const u8 *src = bitmapGlyph->bitmap.buffer + (i * bitmapGlyph->bitmap.pitch);       
-				u8 *dst = reinterpret_cast<u8*>(p);
-				for (int j = 0; j < m_iFontWidth; ++j)
+				u8* p = data + (glyph.pos.Y * pitch) + sizeof(u16) * glyph.pos.X;
+				for (u32 i = 0; i < rectH; ++i)
 				{
-					bool bEdge = (j >= bmpW || i >= bmpH);
-					if (bEdge)
+					u8 *dst = p;
+					for (u32 j = 0; j < rectW; ++j)
 					{
-						u8 alpha = 0;
-
-						*dst++ = 0;		//color
-						*dst++ = 0;		//alpha
-					}
-					else
-					{
-						u8 alpha = *src++;
+						u8 alpha = (j < glyph.width && i < glyph.height) ? *src++ : 0;
 
 						*dst++ = alpha; 	//color
 						*dst++ = alpha;		//alpha
 					}
+					p += pitch;
 				}
-				p += pitch;
 			}
-		}
-		else if (tex->getColorFormat() == ECF_A8R8G8B8)			//dx11 format
-		{
-			u8* p = data + (charposy * pitch) + sizeof(u32) * charposx;
-
-			for (int i = 0; i < m_iFontHeight; ++i)
+			else if (format == ECF_A8R8G8B8)			//dx11 format
 			{
-				const u8 *src = bitmapGlyph->bitmap.buffer + (i * bitmapGlyph->bitmap.pitch);       
-				u8 *dst = reinterpret_cast<u8*>(p);  
-				for (int j = 0; j < m_iFontWidth; ++j)
+				u8* p = data + (glyph.pos.Y * pitch) + sizeof(u32) * glyph.pos.X;
+				for (u32 i = 0; i < rectH; ++i)
 				{
-					bool bEdge = (j >= bmpW || i >= bmpH);
-					if (bEdge)
-					{
-						u8 alpha = 0;
-
-						*dst++ = alpha; 	//b
-						*dst++ = alpha; 	//g
-						*dst++ = alpha; 	//r
-
-						*dst++ = alpha;		//alpha
-					}
-					else
+					u32 *dst = reinterpret_cast<u32*>(p);
+					for (u32 j = 0; j < rectW; ++j)
 					{
-						u8 alpha = *src++;
-
-						*dst++ = alpha; 	//b
-						*dst++ = alpha; 	//g
-						*dst++ = alpha; 	//r
+						u32 alpha = (j < glyph.width && i < glyph.height) ? *src++ : 0;
 
-						*dst++ = alpha;		//alpha
+						*dst++ = alpha * 0x01010101;		//argb
 					}
+					p += pitch;
 				}
-				p += pitch;
 			}
-		}
-		else
-		{
-			ASSERT(false);
+			else
+			{
+				ASSERT(false);
+			}
+
+			if (glyph.pos.X < dirtyRect.UpperLeftCorner.X)
+				dirtyRect.UpperLeftCorner.X = glyph.pos.X;
+			if (glyph.pos.Y < dirtyRect.UpperLeftCorner.Y)
+				dirtyRect.UpperLeftCorner.Y = glyph.pos.Y;
+			if (glyph.pos.X + (s32)rectW > dirtyRect.LowerRightCorner.X)
+				dirtyRect.LowerRightCorner.X = glyph.pos.X + (s32)rectW;
+			if (glyph.pos.Y + (s32)rectH > dirtyRect.LowerRightCorner.Y)
+				dirtyRect.LowerRightCorner.Y = glyph.pos.Y + (s32)rectH;
 		}
 
 		texWriter->unlock(0);
 
-		texWriter->copyToTexture(tex, &rc);
+		texWriter->copyToTexture(tex, &dirtyRect);
+
+		begin = end;
 	}
 
-	//Ϣ
-	SCharInfo charInfo;
+	PendingGlyphs.clear();
+	PendingAlpha.clear();
+}
 
-	charInfo.TexIndex = (int)FontTextures.size()-1;
-	charInfo.offsetX = offsetX;
-	charInfo.offsetY = offsetY;
-	charInfo.width = chW;
-	charInfo.height = chH;
-	charInfo.UVRect = rc;
+void CFTFont::cacheTextA( const char* utf8text, int nCharCount )
+{
+	const char* p = utf8text;
+	int nLen = nCharCount > 0 ? nCharCount : (int)strlen(utf8text);
+	while(*p && nLen >= 0)
+	{
+		c16 ch;
+		int nadv;
+		ch = (c16)Q_ParseUnicodeFromUTF8Str(p, &nadv, nLen);
+		if(nadv == 0)		//parse end
+			break;
+		p += nadv;
+		nLen -= nadv;
+		if (ch == 0)		//string end
+			break;
 
-	CharacterMap[ch] = charInfo;
+		addChar(ch);
+	}
+}
+
+void CFTFont::cacheTextW( const c16* text, u32 len )
+{
+	for (u32 i=0; i<len; ++i)
+	{
+		if (text[i] != 0)
+			addChar(text[i]);
+	}
+}
 
-	CurrentX = NextX;
+void CFTFont::prewarmChars( const c16* text, int nCharCount )
+{
+	u32 len = nCharCount > 0 ? (u32)nCharCount : (u32)Q_UTF16Len(text);
 
-	if (MaxY > NextY)
-		NextY = MaxY;	
+	if (PrewarmPos == (u32)PrewarmChars.size())
+	{
+		PrewarmChars.clear();
+		PrewarmPos = 0;
+	}
 
-	return &CharacterMap[ch];
+	for (u32 i=0; i<len; ++i)
+	{
+		if (text[i] != 0)
+			PrewarmChars.push_back(text[i]);
+	}
+}
+
+void CFTFont::processPrewarm( u32 maxChars )
+{
+	u32 count = 0;
+	while (PrewarmPos < (u32)PrewarmChars.size() && count < maxChars)
+	{
+		c16 ch = PrewarmChars[PrewarmPos++];
+		if (getCharInfo(ch))				//еַ
+			continue;
+
+		addChar(ch);
+		++count;
+	}
+
+	if (PrewarmPos == (u32)PrewarmChars.size())
+	{
+		PrewarmChars.clear();
+		PrewarmPos = 0;
+	}
 }
 
 bool CFTFont::addFontTexture()
@@ -454,6 +547,13 @@ bool CFTFont::addFontTexture()
 
 	ITexture* fontTex = g_Engine->getManualTextureServices()->createEmptyTexture(dimension2du(FONT_TEXTURE_SIZE, FONT_TEXTURE_SIZE), format);	   //no mipmap
 	FontTextures.push_back(fontTex);
+	Packers.push_back(new CSkylinePacker(FONT_TEXTURE_SIZE, FONT_TEXTURE_SIZE));
+
+	if (fontTex)
+	{
+		ITextureWriter* texWriter = g_Engine->getTextureWriteServices()->createTextureWriter(fontTex, false);
+		texWriter->initEmptyData();
+	}
 
 	return true;
 }
@@ -468,6 +568,10 @@ void CFTFont::drawA(const char* utf8text, SColor color, vector2di position, int
 		(y >= pClip->bottom() || y + m_iFontHeight <= pClip->top() || x >= pClip->right()))
 		return;
 
+	//ȹդַύ, ;ʱδ
+	cacheTextA(utf8text, nCharCount);
+	uploadGlyphs();
+
 	S2DBlendParam blendParam = S2DBlendParam::UIFontBlendParam();
 	float fInv = 1.0f / FONT_TEXTURE_SIZE;
 
@@ -497,6 +601,12 @@ void CFTFont::drawA(const char* utf8text, SColor color, vector2di position, int
 			continue;
 		}
 
+		if (charInfo->UVRect.isEmpty())
+		{
+			x += charInfo->width;
+			continue;
+		}
+
 		int idx = charInfo->TexIndex;
 		ASSERT(idx >= 0 && idx < (int)FontTextures.size());
 
@@ -605,6 +715,10 @@ void CFTFont::drawW(const c16* text, SColor color, vector2di position, int nChar
 	float fInv = 1.0f / FONT_TEXTURE_SIZE;
 
 	u32 len = nCharCount > 0 ? (u32)nCharCount : (u32)Q_UTF16Len(text);
+
+	cacheTextW(text, len);
+	uploadGlyphs();
+
 	for (u32 i=0; i<len; ++i)
 	{
 		c16 c = text[i];
@@ -623,6 +737,12 @@ void CFTFont::drawW(const c16* text, SColor color, vector2di position, int nChar
 			continue;
 		}
 
+		if (charInfo->UVRect.isEmpty())
+		{
+			x += charInfo->width;
+			continue;
+		}
+
 		int idx = charInfo->TexIndex;
 		ASSERT(idx >= 0 && idx < (int)FontTextures.size());
 
@@ -779,6 +899,8 @@ void CFTFont::addTextW( const c16* text, SColor color, vector2di position, int n
 
 void CFTFont::flushText()
 {
+	processPrewarm(PREWARM_CHARS_PER_FLUSH);
+
 	drawTextWBatch();
 
 	DrawTexts.clear();
@@ -859,6 +981,10 @@ FT_BitmapGlyph CFTFont::RenderChar( u32 ch )
 
 void CFTFont::drawTextWBatch()
 {
+	if (!Texts.empty())
+		cacheTextW(&Texts[0], (u32)Texts.size());
+	uploadGlyphs();
+
 	S2DBlendParam blendParam = S2DBlendParam::UIFontBlendParam();
 	float fInv = 1.0f / FONT_TEXTURE_SIZE;
 
@@ -908,6 +1034,12 @@ void CFTFont::drawText(const SDrawText& d, const c16* txt, float fInv, const S2D
 			continue;
 		}
 
+		if (charInfo->UVRect.isEmpty())
+		{
+			x += charInfo->width;
+			continue;
+		}
+
 		int idx = charInfo->TexIndex;
 		ASSERT(idx >= 0 && idx < (int)FontTextures.size());
 
@@ -1035,6 +1167,12 @@ void CFTFont::drawTextVertical(const SDrawText& d, const c16* txt, float fInv, c
 			continue;
 		}
 
+		if (charInfo->UVRect.isEmpty())
+		{
+			y += m_iFontHeight;
+			continue;
+		}
+
 		int idx = charInfo->TexIndex;
 		ASSERT(idx >= 0 && idx < (int)FontTextures.size());
 
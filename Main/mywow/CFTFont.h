@@ -12,6 +12,7 @@
 
 class CFontServices;
 class CFTGlyphCache;
+class CSkylinePacker;
 struct S2DBlendParam;
 
 class CFTFont : public IFTFont
@@ -26,6 +27,7 @@ public:
 	virtual void addTextA(const char* text, SColor color, vector2di position, int nCharCount = -1, recti* pClip = NULL_PTR, bool bVertical = false);
 	virtual void addTextW(const c16* text, SColor color, vector2di position, int nCharCount = -1, recti* pClip = NULL_PTR, bool bVertical = false);
 	virtual void flushText();
+	virtual void prewarmChars(const c16* text, int nCharCount = -1);
 
 	virtual dimension2du getTextExtent(const char* utf8text, int nCharCount = -1, bool vertical = false);	
 	virtual dimension2du getWTextExtent(const c16* text, int nCharCount = -1, bool vertical = false) ;	
@@ -37,6 +39,10 @@ public:
 	const SCharInfo* addChar(c16 ch);	
 	ITexture* getTexture(u32 idx);
 	u32 getTextureCount() const { return (u32)FontTextures.size(); }
+	u32 getNumPrewarmPending() const { return (u32)PrewarmChars.size() - PrewarmPos; }
+
+	//ݴһύ, ǰԶ
+	void uploadGlyphs();
 
 public:
 	bool init();
@@ -61,10 +67,30 @@ private:
 		//TODO underline
 	};
 
+	//ѷλõδύ, ҶPendingAlpha
+	struct SPendingGlyph
+	{
+		u32		page;
+		vector2di	pos;
+		u32		offset;
+		u32		width;
+		u32		height;
+	};
+
+	enum
+	{
+		GLYPH_GUTTER = 1,				//Ҳ²1ؿհ
+		PREWARM_CHARS_PER_FLUSH = 32,
+	};
+
 private:
 	bool addFontTexture();
 	FT_BitmapGlyph RenderChar(u32 ch);
 	void drawTextWBatch();
+	void cacheTextA(const char* utf8text, int nCharCount);
+	void cacheTextW(const c16* text, u32 len);
+	void stageGlyph(u32 page, const vector2di& pos, FT_BitmapGlyph bitmapGlyph);
+	void processPrewarm(u32 maxChars);
 
 	void drawText(const SDrawText& d, const c16* txt, float fInv, const S2DBlendParam& blendParam);
 	void drawTextVertical(const SDrawText& d, const c16* txt, float fInv, const S2DBlendParam& blendParam);
@@ -91,12 +117,13 @@ private:
 	int		Descender;			//underhang
 
 	std::vector<ITexture*>			FontTextures;
+	std::vector<CSkylinePacker*>		Packers;
+
+	std::vector<SPendingGlyph>		PendingGlyphs;
+	std::vector<u8>		PendingAlpha;
 
-	int	NextX;
-	int  NextY;
-	int  CurrentX;
-	int  CurrentY;
-	int  MaxY;
+	std::vector<c16>		PrewarmChars;
+	u32		PrewarmPos;
 
 	//
 	std::vector<c16>		Texts;
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "CFileADT.h"
 #include "mywow.h"
+#include "CAssetCache.h"
 
 #define  BLENDMAP_SIZE	(64 * 16)
 
@@ -59,6 +60,8 @@ CFileADT::~CFileADT()
 	delete[] M2FileNameBlock;
 
 	delete VertexBuffer;
+
+	CAssetCache::release(CacheEntry);
 }
 
 bool CFileADT::loadFile( IMemFile* file )
@@ -66,6 +69,36 @@ bool CFileADT::loadFile( IMemFile* file )
 	const c8* name = file->getFileName();
 	getFullFileNameNoExtensionA(name, Name, QMAX_PATH);
 
+	//: ζ, chunkϢ, 
+	CAssetCache* cache = g_Engine->getAssetCache();
+	u64 srcStamp = 0;
+	bool cached = false;
+	if (cache && g_Engine->getWowEnvironment()->getFileStamp(name, srcStamp))
+		cached = loadCache(cache, name, srcStamp);
+	else
+		cache = NULL_PTR;
+
+	if (!cached)
+	{
+		loadChunks(file);
+
+		if (cache)
+			saveCache(cache, name, srcStamp);
+	}
+
+	//objects
+	loadObj0();
+
+	//textures
+	loadTex(0);
+
+	buildMaps();
+
+	return true;
+}
+
+void CFileADT::loadChunks( IMemFile* file )
+{
 	c8 fourcc[5];
 	u32 size;
 
@@ -140,16 +173,6 @@ bool CFileADT::loadFile( IMemFile* file )
 	ASSERT(nChunks == 256);
 
 	buildTexcoords();
-
-	//objects
-	loadObj0();
-
-	//textures
-	loadTex(0);
-
-	buildMaps();
-
-	return true;
 }
 
 bool CFileADT::loadFileSimple( IMemFile* file )
@@ -276,6 +299,7 @@ void CFileADT::readChunk( IMemFile* file, u8 row, u8 col, u32 lastpos)
 			{
 				ASSERT(currentChunk.sounds == NULL_PTR);
 				currentChunk.sounds = new SChunkSound[nSounds];
+				currentChunk.numSounds = nSounds;
 				ADT::SSoundEmitter sound;
 				for (u32 i=0; i<nSounds; ++i)
 				{
@@ -303,6 +327,117 @@ void CFileADT::readChunk( IMemFile* file, u8 row, u8 col, u32 lastpos)
 	}
 }
 
+//: Vertices, chunkϢ, ÿchunk, , Box
+#define ADT_CACHE_SECTIONS		5
+
+struct SADTChunkCache
+{
+	aabbox3df	box;
+	u32		areaID;
+	f32		xbase, ybase, zbase;
+};
+
+bool CFileADT::loadCache( CAssetCache* cache, const c8* filename, u64 srcStamp )
+{
+	CAssetCache::SEntry entry;
+	if (!cache->load(EACT_ADT, filename, srcStamp, entry))
+		return false;
+
+	const SAssetCacheSection* sec = entry.Sections;
+	bool valid = entry.NumSections == ADT_CACHE_SECTIONS &&
+		sec[0].size == sizeof(SVertex_PNCT2) * 16 * 16 * 145 &&
+		sec[1].size == sizeof(SADTChunkCache) * 16 * 16 &&
+		sec[2].size == sizeof(u32) * 16 * 16 &&
+		sec[3].size % sizeof(SChunkSound) == 0 &&
+		sec[4].size == sizeof(aabbox3df);
+
+	if (valid)
+	{
+		u32 numSounds = 0;
+		const u32* soundCounts = (const u32*)sec[2].data;
+		for (u32 i=0; i<16 * 16; ++i)
+			numSounds += soundCounts[i];
+		valid = numSounds == sec[3].size / sizeof(SChunkSound);
+	}
+
+	if (!valid)
+	{
+		CAssetCache::release(entry);
+		return false;
+	}
+
+	//ֱӳ, ٿ
+	delete[] Vertices;
+	Vertices = (SVertex_PNCT2*)sec[0].data;
+	VertexBuffer->set(Vertices, EST_PNCT2, 16 * 16 * 145, EMM_STATIC);
+	VertexBuffer->setClear(false);
+
+	memcpy(&Box, sec[4].data, sec[4].size);
+
+	const SADTChunkCache* chunks = (const SADTChunkCache*)sec[1].data;
+	const u32* soundCounts = (const u32*)sec[2].data;
+	const SChunkSound* sounds = (const SChunkSound*)sec[3].data;
+	for (u8 row=0; row<16; ++row)
+	{
+		for (u8 col=0; col<16; ++col)
+		{
+			CMapChunk& chunk = Chunks[row][col];
+			const SADTChunkCache& c = chunks[row * 16 + col];
+			chunk.box = c.box;
+			chunk.areaID = c.areaID;
+			chunk.xbase = c.xbase;
+			chunk.ybase = c.ybase;
+			chunk.zbase = c.zbase;
+
+			u32 count = soundCounts[row * 16 + col];
+			if (count)
+			{
+				chunk.sounds = new SChunkSound[count];
+				chunk.numSounds = count;
+				memcpy(chunk.sounds, sounds, sizeof(SChunkSound) * count);
+				sounds += count;
+			}
+		}
+	}
+
+	CacheEntry = entry;
+	return true;
+}
+
+void CFileADT::saveCache( CAssetCache* cache, const c8* filename, u64 srcStamp ) const
+{
+	SADTChunkCache chunks[16 * 16];
+	u32 soundCounts[16 * 16];
+	std::vector<SChunkSound> sounds;
+	for (u8 row=0; row<16; ++row)
+	{
+		for (u8 col=0; col<16; ++col)
+		{
+			const CMapChunk& chunk = Chunks[row][col];
+			SADTChunkCache& c = chunks[row * 16 + col];
+			c.box = chunk.box;
+			c.areaID = chunk.areaID;
+			c.xbase = chunk.xbase;
+			c.ybase = chunk.ybase;
+			c.zbase = chunk.zbase;
+
+			soundCounts[row * 16 + col] = chunk.numSounds;
+			for (u32 k=0; k<chunk.numSounds; ++k)
+				sounds.push_back(chunk.sounds[k]);
+		}
+	}
+
+	SAssetCacheSection sections[ADT_CACHE_SECTIONS] =
+	{
+		{ Vertices, sizeof(SVertex_PNCT2) * 16 * 16 * 145 },
+		{ chunks, sizeof(chunks) },
+		{ soundCounts, sizeof(soundCounts) },
+		{ sounds.empty() ? NULL_PTR : &sounds[0], sizeof(SChunkSound) * (u32)sounds.size() },
+		{ &Box, sizeof(aabbox3df) },
+	};
+	cache->save(EACT_ADT, filename, srcStamp, sections, ADT_CACHE_SECTIONS);
+}
+
 const CMapChunk* CFileADT::getChunk( u8 row, u8 col ) const
 {
 	ASSERT(row < 16 && col <16);
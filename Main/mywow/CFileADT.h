@@ -3,6 +3,7 @@
 #include "IFileADT.h"
 #include "S3DVertex.h"
 #include "VertexIndexBuffer.h"
+#include "CAssetCache.h"
 
 class CFileADT : public IFileADT
 {
@@ -32,6 +33,7 @@ public:
 	IVertexBuffer* getVBuffer() const { return VertexBuffer; }
 	E_VERTEX_TYPE getVertexType() const { return EVT_PNCT2; }
 	u32 getChunkVerticesOffset(u8 row, u8 col) const { return (row * 16 + col) * 145; }
+	const SVertex_PNCT2* getChunkVertices(u8 row, u8 col) const { return &Vertices[getChunkVerticesOffset(row, col)]; }
 	ITexture* getBlendMap() const { return BlendMap; }
 
 	const SM2Instance* getM2Instance(u32 index) const { return &M2Instances[index]; }
@@ -41,6 +43,8 @@ public:
 	u32 getNumTextures() const { return (u32)Textures.size(); }
 
 private:
+	void loadChunks(IMemFile* file);
+
 	void readChunk( IMemFile* file, u8 row, u8 col, u32 lastpos); 
 	
 	void loadObj0();
@@ -58,6 +62,9 @@ private:
 
 	u32 getVertexIndex(u8 row, u8 col) const;	//ҵ 9 * 9 + 8 * 8
 
+	bool loadCache(CAssetCache* cache, const c8* filename, u64 srcStamp);
+	void saveCache(CAssetCache* cache, const c8* filename, u64 srcStamp) const;
+
 private:
 	struct SChunkM2List
 	{
@@ -77,6 +84,7 @@ private:
 	//chunk
 	SVertex_PNCT2*		Vertices;
 	IVertexBuffer*		VertexBuffer;
+	CAssetCache::SEntry		CacheEntry;			//лʱVerticesֱָӳ, ʱ
 	u32*		Data_BlendMap;
 	ITexture*		BlendMap;				//adtblend map,16 X 16chunkmapϳ
 
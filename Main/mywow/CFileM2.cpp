@@ -1,10 +1,173 @@
 #include "stdafx.h"
 #include "CFileM2.h"
 #include "mywow.h"
+#include "CAssetCache.h"
+
+//m2Ķ, ֱΪʹ, skin¼ؽgeoset
+enum E_M2_CACHE_SECTION
+{
+	M2CACHE_GVERTICES = 0,
+	M2CACHE_AVERTICES,
+	M2CACHE_BOUNDINGBOX,
+	M2CACHE_BOUNDS,
+	M2CACHE_BOUNDTRIS,
+	M2CACHE_ANIMATIONS,
+	M2CACHE_RENDERFLAGS,
+	M2CACHE_ATTACHMENTS,
+	M2CACHE_BONEINFO,				//ÿbonetype, lod
+	M2CACHE_SKIN_INDICES,
+	M2CACHE_SKIN_AVERTICES,
+	M2CACHE_SKIN_GEOSETS,			//SM2GeosetCache
+	M2CACHE_SKIN_TEXUNITS,
+	M2CACHE_SKIN_BONEUNITS,			//SM2BoneUnitCache
+	M2CACHE_SKIN_BONEMAPS,			//bone unitlocal2globalMap
+	M2CACHE_SKIN_BBRECTS,
+
+	M2CACHE_COUNT,
+};
+
+struct SM2GeosetCache
+{
+	u32		GeoID;
+	u16		VStart;
+	u16		VCount;
+	u16		IStart;
+	u16		ICount;
+	u16		MaxWeights;
+	u16		BillBoard;
+	u32		NumTexUnits;
+	u32		NumBoneUnits;
+	u32		NumRects;
+};
+
+struct SM2BoneUnitCache
+{
+	u32		BoneVStart;
+	u16		TCount;
+	u16		StartIndex;
+	u8		BoneCount;
+	s8		Index;
+	u16		NumBoneMaps;
+};
+
+CM2AnimSource::CM2AnimSource( IMemFile* m2File, const u8* m2Data, const IFileM2* m2 )
+	: M2(m2), M2File(m2File), M2Data(m2Data)
+{
+	u32 num = M2->NumAnimations;
+	AnimMpqs = new IMemFile*[num];
+	AnimFiles = new SAnimFile[num];
+	AnimStates = new u8[num];
+	memset(AnimMpqs, 0, num * sizeof(IMemFile*));
+	memset(AnimFiles, 0, num * sizeof(SAnimFile));
+	memset(AnimStates, EAS_NONE, num * sizeof(u8));
+	NumLoading = 0;
+
+	INIT_LOCK(&DecodeCS);
+}
+
+CM2AnimSource::~CM2AnimSource()
+{
+	//ڼػδȡߵ.animɼ̶߳
+	if (NumLoading)
+		g_Engine->getResourceLoader()->cancelTasks(this);
+
+	releaseAnimFiles();
+
+	DESTROY_LOCK(&DecodeCS);
+
+	delete[] AnimStates;
+	delete[] AnimFiles;
+	delete[] AnimMpqs;
+	delete M2File;
+}
+
+bool CM2AnimSource::getAnimFile( u32 anim, SAnimFile& file )
+{
+	file.data = NULL_PTR;
+	file.size = 0;
+	if (anim >= M2->NumAnimations)
+		return true;
+
+	IResourceLoader* loader = g_Engine->getResourceLoader();
+	if (AnimStates[anim] != EAS_OPENED)
+	{
+		const SModelAnimation& a = M2->Animations[anim];
+		c8   filename[QMAX_PATH];
+		Q_sprintf(filename, QMAX_PATH, "%s%s%04d-%02d.anim", M2->Dir, M2->Name, a.animID, a.animSubID);
+
+		if (loader->isMultiThread())
+		{
+			//ڶ߳mpq, ǰȡֵ
+			if (AnimStates[anim] == EAS_NONE)
+			{
+				AnimStates[anim] = EAS_LOADING;
+				++NumLoading;
+
+				IResourceLoader::SParamBlock param = {0};
+				param.param1 = this;
+				param.param2 = (void*)(ptr_t)anim;
+				loader->beginLoadAnim(filename, param);
+			}
+			return false;
+		}
+
+		//ûм߳ʱ(߳ѽ)ֱӴ
+		if (AnimStates[anim] == EAS_LOADING)
+			--NumLoading;
+		openAnimFile(anim, g_Engine->getWowEnvironment()->openFile(filename, false));
+	}
+
+	file = AnimFiles[anim];
+	return true;
+}
+
+void CM2AnimSource::onAnimFileLoaded( u32 anim, IMemFile* file )
+{
+	CLock lock(&DecodeCS);
+
+	if (anim >= M2->NumAnimations || AnimStates[anim] != EAS_LOADING)
+	{
+		delete file;
+		return;
+	}
+
+	--NumLoading;
+	openAnimFile(anim, file);
+}
+
+void CM2AnimSource::openAnimFile( u32 anim, IMemFile* file )
+{
+	AnimStates[anim] = EAS_OPENED;
+	AnimMpqs[anim] = file;			//releaseAnimFiles, ʱڴ
+	if (file)
+	{
+		AnimFiles[anim].data = file->getBuffer();
+		AnimFiles[anim].size = file->getSize();
+	}
+}
+
+void CM2AnimSource::releaseAnimFiles()
+{
+	CLock lock(&DecodeCS);
+
+	for (u32 i=0; i<M2->NumAnimations; ++i)
+	{
+		if (AnimStates[i] != EAS_OPENED)			//еı״̬, ظύ
+			continue;
+
+		delete AnimMpqs[i];
+		AnimMpqs[i] = NULL_PTR;
+		AnimFiles[i].data = NULL_PTR;
+		AnimFiles[i].size = 0;
+		AnimStates[i] = EAS_NONE;
+	}
+}
 
 CFileM2::CFileM2()
 {
 	FileData = NULL_PTR;
+	FileSize = 0;
+	AnimSource = NULL_PTR;
 
 	NumTextures = 0;
 
@@ -24,6 +187,18 @@ void CFileM2::clear()
 
 	delete Skin;
 
+	//Իӳӳһ
+	if (CacheEntry.File)
+	{
+		RenderFlags = NULL_PTR;
+		Attachments = NULL_PTR;
+		Animations = NULL_PTR;
+		BoundTris = NULL_PTR;
+		Bounds = NULL_PTR;
+		AVertices = NULL_PTR;
+		GVertices = NULL_PTR;
+	}
+
 	delete[] RibbonEmitters;
 	delete[] ParticleSystems;
 	
@@ -35,6 +210,7 @@ void CFileM2::clear()
 	delete[] BoneLookup;
 	delete[]	AnimationLookup; 
 	delete[] Bones;
+	delete AnimSource;
 	delete[] Animations;
 
 	delete[]	TextureAnim;
@@ -57,6 +233,8 @@ void CFileM2::clear()
 	delete[] Bounds;
 	delete[] AVertices;
 	delete[] GVertices;
+
+	CAssetCache::release(CacheEntry);
 }
 
 bool CFileM2::loadFile( IMemFile* file )
@@ -69,12 +247,21 @@ bool CFileM2::loadFile( IMemFile* file )
 	else
 		ASSERT(false);
 
+	bool ret;
 	if (M2Version == MD20)
-		return loadFileMD20(file);
+		ret = loadFileMD20(file);
 	else if (M2Version == MD21)
-		return loadFileMD21(file);
+		ret = loadFileMD21(file);
 	else
-		return false;
+		ret = false;
+
+	//FileDataָfileĻ(ļӳ), ֮ٷ
+	//йʱfileCM2AnimSource, ͻɾ
+	FileData = NULL_PTR;
+	m2Header = NULL_PTR;
+	m2HeaderEx = NULL_PTR;
+
+	return ret;
 }
 
 bool CFileM2::loadFileMD20(IMemFile* file)
@@ -82,6 +269,7 @@ bool CFileM2::loadFileMD20(IMemFile* file)
 	ASSERT(file->getSize() >= sizeof(M2::Header20));
 
 	FileData = file->getBuffer();
+	FileSize = file->getSize();
 	m2Header = (M2::Header20*)FileData;
 
 	c8 meshName[DEFAULT_SIZE];
@@ -134,38 +322,7 @@ bool CFileM2::loadFileMD20(IMemFile* file)
 		ASSERT(NumBoneLookup >= BONE_MAX);
 	}
 
-	loadVertices();
-
-	loadBounds();
-
-	loadTextures();
-
-	loadSequences();
-
-	loadColor();
-
-	loadTransparency();
-
-	loadTextureAnimation();
-
-	loadBones();
-
-	loadRenderFlags();
-
-	loadAttachments();
-
-	loadModelCameras();
-
-	loadParticleSystems();
-
-	loadRibbonEmitters();
-
-	if(!loadSkin(0))
-	{
-		return false;
-	}
-
-	return true;
+	return loadData(file);
 }
 
 bool CFileM2::loadFileMD21(IMemFile* file)
@@ -177,6 +334,7 @@ bool CFileM2::loadFileMD21(IMemFile* file)
 	m2Header = (M2::Header20*)&m2HeaderEx->_header20;
 
 	FileData += (u32)((u8*)m2Header - (u8*)m2HeaderEx);
+	FileSize = file->getSize() - (u32)((u8*)m2Header - (u8*)m2HeaderEx);
 
 	c8 meshName[DEFAULT_SIZE];
 	Q_strncpy(meshName, DEFAULT_SIZE, (const c8*)&FileData[m2Header->_modelNameOffset], m2Header->_modelNameLength);
@@ -228,6 +386,18 @@ bool CFileM2::loadFileMD21(IMemFile* file)
 		ASSERT(NumBoneLookup >= BONE_MAX);
 	}
 
+	return loadData(file);
+}
+
+bool CFileM2::loadData( IMemFile* file )
+{
+	const c8* filename = file->getFileName();
+
+	u64 stamp = 0;
+	bool useCache = getCacheStamp(filename, stamp);
+	bool cached = useCache && loadCache(filename, stamp);
+
+	//лʱ, Χ, , render flag, ҵ, LODskinѾ, ֻಿ
 	loadVertices();
 
 	loadBounds();
@@ -242,7 +412,7 @@ bool CFileM2::loadFileMD21(IMemFile* file)
 
 	loadTextureAnimation();
 
-	loadBones();
+	loadBones(file);
 
 	loadRenderFlags();
 
@@ -254,17 +424,20 @@ bool CFileM2::loadFileMD21(IMemFile* file)
 
 	loadRibbonEmitters();
 
-	if(!loadSkin(0))
+	if (!cached && !loadSkin(0))
 	{
 		return false;
 	}
 
+	if (useCache && !cached)
+		saveCache(filename, stamp);
+
 	return true;
 }
 
 void CFileM2::loadVertices()
 {
-	if (NumVertices == 0)
+	if (NumVertices == 0 || CacheEntry.File)
 		return;
 
 	GVertices = new SVertex_PNT2W[NumVertices];
@@ -293,7 +466,7 @@ void CFileM2::loadVertices()
 
 void CFileM2::loadBounds()
 {
-	if (NumBoundingVerts > 0)
+	if (NumBoundingVerts > 0 && !CacheEntry.File)
 	{
 		Bounds = new vector3df[NumBoundingVerts];
 		vector3df* b = (vector3df*)(&FileData[m2Header->_ofsBoundingVertices]);
@@ -303,7 +476,7 @@ void CFileM2::loadBounds()
 		}
 	}
 
-	if (NumBoundingTriangles > 0)
+	if (NumBoundingTriangles > 0 && !CacheEntry.File)
 	{
 		BoundTris = new u16[NumBoundingTriangles];
 		u16* idx = (u16*)(&FileData[m2Header->_ofsBoundingTriangles]);
@@ -360,7 +533,7 @@ void CFileM2::loadTextures()
 void CFileM2::loadAttachments()
 {
 	//attachment
-	if (NumAttachments > 0)
+	if (NumAttachments > 0 && !CacheEntry.File)
 	{
 		Attachments = new SModelAttachment[NumAttachments];
 		M2::attach* att = (M2::attach*)(&FileData[m2Header->_ofsAttachments]);
@@ -434,43 +607,25 @@ void CFileM2::loadTextureAnimation()
 	}
 }
 
-void CFileM2::loadBones()
+void CFileM2::loadBones(IMemFile* file)
 {
 	if (NumAnimations == 0)
 		return;
 
-	IMemFile** animMpqs = (IMemFile**)Z_AllocateTempMemory(NumAnimations * sizeof(IMemFile*));
-	SAnimFile* animFiles = (SAnimFile*)Z_AllocateTempMemory(NumAnimations * sizeof(SAnimFile));
-	memset(animFiles, 0, NumAnimations * sizeof(SAnimFile));
-
-	Animations = new SModelAnimation[NumAnimations];
-	memset(Animations, 0, sizeof(SModelAnimation) * NumAnimations);
-
-	for (u32 i=0; i<NumAnimations; ++i)
+	if (!CacheEntry.File)
 	{
-		M2::animseq* anim = (M2::animseq*)(&FileData[m2Header->_ofsAnimations]);
-
-		Animations[i].animID = anim[i]._AnimationID;
-		Animations[i].animSubID	=	anim[i]._SubAnimationID;
-		Animations[i].timeLength = anim[i]._Length;
-		Animations[i].NextAnimation = anim[i]._NextAnimation;
-		Animations[i].Index = anim[i]._Index;
+		Animations = new SModelAnimation[NumAnimations];
+		memset(Animations, 0, sizeof(SModelAnimation) * NumAnimations);
 
-// 		const c8* animName = g_Engine->getWowDatabase()->getAnimationName(Animations[i].animID);
-// 		if (strcmp(animName, "Stand") != 0)
-// 		{
-// 			animMpqs[i] = NULL_PTR;
-// 			continue;
-// 		}
-
-		c8   filename[QMAX_PATH];
-		Q_sprintf(filename, QMAX_PATH, "%s%s%04d-%02d.anim", Dir, Name, Animations[i].animID, Animations[i].animSubID);
-
-		animMpqs[i] = g_Engine->getWowEnvironment()->openFile(filename);
-		if (animMpqs[i])
+		for (u32 i=0; i<NumAnimations; ++i)
 		{
-			animFiles[i].data = animMpqs[i]->getBuffer();
-			animFiles[i].size = animMpqs[i]->getSize();
+			M2::animseq* anim = (M2::animseq*)(&FileData[m2Header->_ofsAnimations]);
+
+			Animations[i].animID = anim[i]._AnimationID;
+			Animations[i].animSubID	=	anim[i]._SubAnimationID;
+			Animations[i].timeLength = anim[i]._Length;
+			Animations[i].NextAnimation = anim[i]._NextAnimation;
+			Animations[i].Index = anim[i]._Index;
 		}
 	}
 
@@ -500,31 +655,43 @@ void CFileM2::loadBones()
 
 	if (NumBones > 0)
 	{
+		//ڲʱŴ.animm2н
+		AnimSource = new CM2AnimSource(file, FileData, this);
+
 		Bones = new SModelBone[NumBones];
-		M2::bone* b = (M2::bone*)(&FileData[m2Header->_ofsBones]);
+		M2::bone* b = (M2::bone*)(AnimSource->getM2Data() + m2Header->_ofsBones);
 		for (u32 i=0; i<NumBones; ++i)
 		{
-			Bones[i].init(FileData, GlobalSequences, NumGlobalSequences, b[i], animFiles);
+			Bones[i].init(GlobalSequences, NumGlobalSequences, b[i], AnimSource);
+		}
 
-			if (Type == MT_CHARACTER)
-				setBoneType((s16)i);
+		//лʱbonetypelodӻȡ
+		if (CacheEntry.File)
+		{
+			const u8* info = (const u8*)CacheEntry.Sections[M2CACHE_BONEINFO].data;
+			for (u32 i=0; i<NumBones; ++i)
+			{
+				Bones[i].bonetype = (E_BONE_TYPE)info[i * 2];
+				Bones[i].lod = info[i * 2 + 1];
+			}
 		}
-	}
+		else
+		{
+			if (Type == MT_CHARACTER)
+			{
+				for (u32 i=0; i<NumBones; ++i)
+					setBoneType((s16)i);
+			}
 
-	for (s32 i=NumAnimations-1; i>=0; --i)
-	{	
-		if (animMpqs[i])
-			delete animMpqs[i];
+			buildBoneLods();
+		}
 	}
 
-	Z_FreeTempMemory(animFiles);
-	Z_FreeTempMemory(animMpqs);
-
 }
 
 void CFileM2::loadRenderFlags()
 {
-	if (NumRenderFlags > 0)
+	if (NumRenderFlags > 0 && !CacheEntry.File)
 	{
 		RenderFlags = new SRenderFlag[NumRenderFlags];
 
@@ -604,13 +771,17 @@ void CFileM2::loadModelCameras()
 	}
 }
 
+void CFileM2::getSkinFileName( u32 idx, c8* filename, u32 size ) const
+{
+	Q_sprintf(filename, size, "%s%s%02d.skin", Dir, Name, (s32)idx);
+	if(!g_Engine->getWowEnvironment()->exists(filename))
+		Q_sprintf(filename, size, "%s%s%02d.skin", Dir, FileName, (s32)idx);
+}
+
 bool CFileM2::loadSkin(u32 idx)
 {
 	c8   filename[QMAX_PATH];
-	
-	Q_sprintf(filename, QMAX_PATH, "%s%s%02d.skin", Dir, Name, (s32)idx);
-	if(!g_Engine->getWowEnvironment()->exists(filename))
-		Q_sprintf(filename, QMAX_PATH, "%s%s%02d.skin", Dir, FileName, (s32)idx);
+	getSkinFileName(idx, filename, QMAX_PATH);
 
 	IMemFile* file = g_Engine->getWowEnvironment()->openFile(filename);
 	if (file)
@@ -775,6 +946,73 @@ void CFileM2::setBoneType( s16 boneIdx )
 	Bones[boneIdx].bonetype = EBT_NONE;
 }
 
+//ӹӰĶ㷶ΧģʹСLOD, ָΪϸ
+void CFileM2::buildBoneLods()
+{
+	f32* radius = new f32[NumBones];			//ӰĶ㵽pivot
+	f32* subtree = new f32[NumBones];			//ӹ
+	::memset(radius, 0, sizeof(f32) * NumBones);
+
+	for (u32 i=0; i<NumVertices; ++i)
+	{
+		for (u32 j=0; j<4; ++j)
+		{
+			u8 b = AVertices[i].BoneIndices[j];
+			if (GVertices[i].Weights[j] == 0 || b >= NumBones)
+				continue;
+
+			f32 d = GVertices[i].Pos.getDistanceFrom(Bones[b].pivot);
+			if (d > radius[b])
+				radius[b] = d;
+		}
+	}
+
+	Q_memcpy(subtree, sizeof(f32) * NumBones, radius, sizeof(f32) * NumBones);
+	for (u32 i=0; i<NumBones; ++i)
+	{
+		if (radius[i] == 0.0f)
+			continue;
+
+		u32 depth = 0;
+		for (s32 p = Bones[i].parent; p != -1 && depth < NumBones; p = Bones[p].parent, ++depth)
+		{
+			f32 d = radius[i] + Bones[i].pivot.getDistanceFrom(Bones[p].pivot);
+			if (d > subtree[p])
+				subtree[p] = d;
+		}
+	}
+
+	f32 size = BoundingBox.getExtent().getLength() * 0.5f;
+	for (u32 i=0; i<NumBones; ++i)
+	{
+		f32 r = size > 0.0f ? subtree[i] / size : 1.0f;
+		if (r >= 0.25f)
+			Bones[i].lod = EBL_COARSE;
+		else if (r >= 0.08f)
+			Bones[i].lod = EBL_MEDIUM;
+		else
+			Bones[i].lod = EBL_FINE;
+
+		if (Type == MT_CHARACTER &&
+			(Bones[i].bonetype == EBT_LEFTHAND || Bones[i].bonetype == EBT_RIGHTHAND))
+			Bones[i].lod = EBL_FINE;
+	}
+
+	//ʡʱӹҲʡ
+	for (u32 i=0; i<NumBones; ++i)
+	{
+		u32 depth = 0;
+		for (s32 p = Bones[i].parent; p != -1 && depth < NumBones; p = Bones[p].parent, ++depth)
+		{
+			if (Bones[p].lod > Bones[i].lod)
+				Bones[i].lod = Bones[p].lod;
+		}
+	}
+
+	delete[] subtree;
+	delete[] radius;
+}
+
 wow_m2Action* CFileM2::getAction( const c8* name ) const
 {
 	T_ActionMap::const_iterator itr = ActionMap.find(name);
@@ -785,6 +1023,21 @@ wow_m2Action* CFileM2::getAction( const c8* name ) const
 	return NULL_PTR;
 }
 
+u32 CFileM2::releaseUnusedAnimations(T_AnimBlockList& retired)
+{
+	if (!AnimSource)
+		return 0;
+
+	u32 count = 0;
+	for (u32 i=0; i<NumBones; ++i)
+		count += Bones[i].releaseUnusedAnimations(retired);
+
+	//ѽвҪ.animļ
+	AnimSource->releaseAnimFiles();
+
+	return count;
+}
+
 void CFileM2::clearAllActions()
 {
 	for(T_ActionMap::const_iterator itr = ActionMap.begin(); itr != ActionMap.end(); ++itr)
@@ -839,8 +1092,237 @@ u32 CFileM2::getSkinIndex(u32 race, u32 gender, bool isHD)
 	}
 }
 
+bool CFileM2::getCacheStamp( const c8* filename, u64& stamp ) const
+{
+	if (!g_Engine->getAssetCache())
+		return false;
+
+	//m2skin 0ͬ
+	wowEnvironment* env = g_Engine->getWowEnvironment();
+	c8 skinname[QMAX_PATH];
+	getSkinFileName(0, skinname, QMAX_PATH);
+
+	u64 m2Stamp, skinStamp;
+	if (!env->getFileStamp(filename, m2Stamp) || !env->getFileStamp(skinname, skinStamp))
+		return false;
+
+	stamp = CAssetCache::combineStamp(m2Stamp, skinStamp);
+	return true;
+}
+
+bool CFileM2::loadCache( const c8* filename, u64 stamp )
+{
+	CAssetCache* cache = g_Engine->getAssetCache();
+	CAssetCache::SEntry entry;
+	if (!cache->load(EACT_M2, filename, stamp, entry))
+		return false;
+
+	const SAssetCacheSection* sec = entry.Sections;
+	bool valid = entry.NumSections == M2CACHE_COUNT &&
+		sec[M2CACHE_GVERTICES].size == sizeof(SVertex_PNT2W) * NumVertices &&
+		sec[M2CACHE_AVERTICES].size == sizeof(SVertex_A) * NumVertices &&
+		sec[M2CACHE_BOUNDINGBOX].size == sizeof(aabbox3df) &&
+		sec[M2CACHE_BOUNDS].size == sizeof(vector3df) * NumBoundingVerts &&
+		sec[M2CACHE_BOUNDTRIS].size == sizeof(u16) * NumBoundingTriangles &&
+		sec[M2CACHE_ANIMATIONS].size == sizeof(SModelAnimation) * NumAnimations &&
+		sec[M2CACHE_RENDERFLAGS].size == sizeof(SRenderFlag) * NumRenderFlags &&
+		sec[M2CACHE_ATTACHMENTS].size == sizeof(SModelAttachment) * NumAttachments &&
+		sec[M2CACHE_BONEINFO].size == 2 * NumBones &&
+		loadSkinCache(sec);
+
+	if (!valid)
+	{
+		CAssetCache::release(entry);
+		return false;
+	}
+
+	//ֱʹӳе, ӳдʱƵ
+	GVertices = (SVertex_PNT2W*)sec[M2CACHE_GVERTICES].data;
+	AVertices = (SVertex_A*)sec[M2CACHE_AVERTICES].data;
+	memcpy(&BoundingBox, sec[M2CACHE_BOUNDINGBOX].data, sizeof(aabbox3df));
+	Bounds = (vector3df*)sec[M2CACHE_BOUNDS].data;
+	BoundTris = (u16*)sec[M2CACHE_BOUNDTRIS].data;
+	Animations = (SModelAnimation*)sec[M2CACHE_ANIMATIONS].data;
+	RenderFlags = (SRenderFlag*)sec[M2CACHE_RENDERFLAGS].data;
+	Attachments = (SModelAttachment*)sec[M2CACHE_ATTACHMENTS].data;
+
+	CacheEntry = entry;
+	return true;
+}
+
+bool CFileM2::loadSkinCache( const SAssetCacheSection* sec )
+{
+	const SAssetCacheSection& secGeosets = sec[M2CACHE_SKIN_GEOSETS];
+	const SAssetCacheSection& secTexUnits = sec[M2CACHE_SKIN_TEXUNITS];
+	const SAssetCacheSection& secBoneUnits = sec[M2CACHE_SKIN_BONEUNITS];
+	const SAssetCacheSection& secRects = sec[M2CACHE_SKIN_BBRECTS];
+
+	if (secGeosets.size == 0 ||
+		secGeosets.size % sizeof(SM2GeosetCache) ||
+		sec[M2CACHE_SKIN_INDICES].size % sizeof(u16) ||
+		sec[M2CACHE_SKIN_AVERTICES].size % sizeof(SVertex_A))
+		return false;
+
+	//Ⱥ˶Լ¼͸δС, ٽgeoset
+	u32 numGeosets = secGeosets.size / sizeof(SM2GeosetCache);
+	const SM2GeosetCache* geosets = (const SM2GeosetCache*)secGeosets.data;
+	u32 numTexUnits = 0;
+	u32 numBoneUnits = 0;
+	u32 numRects = 0;
+	for (u32 i=0; i<numGeosets; ++i)
+	{
+		numTexUnits += geosets[i].NumTexUnits;
+		numBoneUnits += geosets[i].NumBoneUnits;
+		numRects += geosets[i].NumRects;
+	}
+
+	if (secTexUnits.size != sizeof(STexUnit) * numTexUnits ||
+		secBoneUnits.size != sizeof(SM2BoneUnitCache) * numBoneUnits ||
+		secRects.size != sizeof(SBRect) * numRects)
+		return false;
+
+	const SM2BoneUnitCache* boneUnits = (const SM2BoneUnitCache*)secBoneUnits.data;
+	u32 numBoneMaps = 0;
+	for (u32 i=0; i<numBoneUnits; ++i)
+		numBoneMaps += boneUnits[i].NumBoneMaps;
+
+	if (sec[M2CACHE_SKIN_BONEMAPS].size != numBoneMaps)
+		return false;
+
+	Skin = new CFileSkin;
+	Skin->NumGeosets = numGeosets;
+	Skin->NumTexUnit = numTexUnits;
+	Skin->NumIndices = sec[M2CACHE_SKIN_INDICES].size / sizeof(u16);
+	Skin->NumBoneVertices = sec[M2CACHE_SKIN_AVERTICES].size / sizeof(SVertex_A);
+	Skin->Indices = (u16*)sec[M2CACHE_SKIN_INDICES].data;
+	Skin->AVertices = (SVertex_A*)sec[M2CACHE_SKIN_AVERTICES].data;
+	Skin->FromCache = true;
+	Skin->Geosets = new CGeoset[numGeosets];
+
+	const STexUnit* texUnits = (const STexUnit*)secTexUnits.data;
+	const u8* boneMaps = (const u8*)sec[M2CACHE_SKIN_BONEMAPS].data;
+	const SBRect* rects = (const SBRect*)secRects.data;
+	for (u32 i=0; i<numGeosets; ++i)
+	{
+		const SM2GeosetCache& g = geosets[i];
+		CGeoset* set = &Skin->Geosets[i];
+
+		set->GeoID = g.GeoID;
+		set->VStart = g.VStart;
+		set->VCount = g.VCount;
+		set->IStart = g.IStart;
+		set->ICount = g.ICount;
+		set->MaxWeights = g.MaxWeights;
+		set->BillBoard = g.BillBoard != 0;
+
+		set->TexUnits.assign(texUnits, texUnits + g.NumTexUnits);
+		texUnits += g.NumTexUnits;
+
+		set->BoneUnits.resize(g.NumBoneUnits);
+		for (u32 k=0; k<g.NumBoneUnits; ++k)
+		{
+			CBoneUnit& unit = set->BoneUnits[k];
+			unit.BoneVStart = boneUnits->BoneVStart;
+			unit.TCount = boneUnits->TCount;
+			unit.StartIndex = boneUnits->StartIndex;
+			unit.BoneCount = boneUnits->BoneCount;
+			unit.Index = boneUnits->Index;
+			unit.local2globalMap.assign(boneMaps, boneMaps + boneUnits->NumBoneMaps);
+
+			boneMaps += boneUnits->NumBoneMaps;
+			++boneUnits;
+		}
+
+		if (g.NumRects)
+		{
+			set->BillboardRects = new SBRect[g.NumRects];
+			Q_memcpy(set->BillboardRects, sizeof(SBRect) * g.NumRects, rects, sizeof(SBRect) * g.NumRects);
+			rects += g.NumRects;
+		}
+	}
+
+	return true;
+}
+
+void CFileM2::saveCache( const c8* filename, u64 stamp ) const
+{
+	//skinûнgeosetʱ, ´ճ
+	if (!Skin || !Skin->Geosets)
+		return;
+
+	std::vector<u8> boneInfo(NumBones * 2, 0);
+	for (u32 i=0; Bones && i<NumBones; ++i)
+	{
+		boneInfo[i * 2] = (u8)Bones[i].bonetype;
+		boneInfo[i * 2 + 1] = Bones[i].lod;
+	}
+
+	std::vector<SM2GeosetCache> geosets(Skin->NumGeosets);
+	std::vector<STexUnit> texUnits;
+	std::vector<SM2BoneUnitCache> boneUnits;
+	std::vector<u8> boneMaps;
+	std::vector<SBRect> rects;
+	for (u32 i=0; i<Skin->NumGeosets; ++i)
+	{
+		const CGeoset& set = Skin->Geosets[i];
+		SM2GeosetCache& g = geosets[i];
+
+		g.GeoID = set.GeoID;
+		g.VStart = set.VStart;
+		g.VCount = set.VCount;
+		g.IStart = set.IStart;
+		g.ICount = set.ICount;
+		g.MaxWeights = set.MaxWeights;
+		g.BillBoard = set.BillBoard ? 1 : 0;
+		g.NumTexUnits = (u32)set.TexUnits.size();
+		g.NumBoneUnits = (u32)set.BoneUnits.size();
+		g.NumRects = set.BillboardRects ? set.VCount / 4 : 0;
+
+		texUnits.insert(texUnits.end(), set.TexUnits.begin(), set.TexUnits.end());
+
+		for (u32 k=0; k<g.NumBoneUnits; ++k)
+		{
+			const CBoneUnit& unit = set.BoneUnits[k];
+			SM2BoneUnitCache b;
+			b.BoneVStart = unit.BoneVStart;
+			b.TCount = unit.TCount;
+			b.StartIndex = unit.StartIndex;
+			b.BoneCount = unit.BoneCount;
+			b.Index = unit.Index;
+			b.NumBoneMaps = (u16)unit.local2globalMap.size();
+			boneUnits.push_back(b);
+
+			boneMaps.insert(boneMaps.end(), unit.local2globalMap.begin(), unit.local2globalMap.end());
+		}
+
+		if (g.NumRects)
+			rects.insert(rects.end(), set.BillboardRects, set.BillboardRects + g.NumRects);
+	}
+
+	SAssetCacheSection sections[M2CACHE_COUNT] =
+	{
+		{ GVertices, sizeof(SVertex_PNT2W) * NumVertices },
+		{ AVertices, sizeof(SVertex_A) * NumVertices },
+		{ &BoundingBox, sizeof(aabbox3df) },
+		{ Bounds, sizeof(vector3df) * NumBoundingVerts },
+		{ BoundTris, sizeof(u16) * NumBoundingTriangles },
+		{ Animations, sizeof(SModelAnimation) * NumAnimations },
+		{ RenderFlags, sizeof(SRenderFlag) * NumRenderFlags },
+		{ Attachments, sizeof(SModelAttachment) * NumAttachments },
+		{ boneInfo.empty() ? NULL_PTR : &boneInfo[0], (u32)boneInfo.size() },
+		{ Skin->Indices, sizeof(u16) * Skin->NumIndices },
+		{ Skin->AVertices, sizeof(SVertex_A) * Skin->NumBoneVertices },
+		{ &geosets[0], sizeof(SM2GeosetCache) * Skin->NumGeosets },
+		{ texUnits.empty() ? NULL_PTR : &texUnits[0], sizeof(STexUnit) * (u32)texUnits.size() },
+		{ boneUnits.empty() ? NULL_PTR : &boneUnits[0], sizeof(SM2BoneUnitCache) * (u32)boneUnits.size() },
+		{ boneMaps.empty() ? NULL_PTR : &boneMaps[0], (u32)boneMaps.size() },
+		{ rects.empty() ? NULL_PTR : &rects[0], sizeof(SBRect) * (u32)rects.size() },
+	};
+	g_Engine->getAssetCache()->save(EACT_M2, filename, stamp, sections, M2CACHE_COUNT);
+}
+
 CFileSkin::CFileSkin()
-	: Geosets(NULL_PTR), Indices(NULL_PTR), AVertices(NULL_PTR), NumIndices(0), NumBoneVertices(0),
+	: Geosets(NULL_PTR), Indices(NULL_PTR), AVertices(NULL_PTR), FromCache(false), NumIndices(0), NumBoneVertices(0),
 	NumGeosets(0), NumTexUnit(0), GVertexBuffer(NULL_PTR), AVertexBuffer(NULL_PTR), IndexBuffer(NULL_PTR)
 { 
 	GVertexBuffer = new IVertexBuffer(false);
@@ -850,8 +1332,11 @@ CFileSkin::CFileSkin()
 
 CFileSkin::~CFileSkin()
 {
-	delete[] Indices;
-	delete[] AVertices;
+	if (!FromCache)
+	{
+		delete[] Indices;
+		delete[] AVertices;
+	}
 	delete[] Geosets;
 
 	delete IndexBuffer;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IFileM2.h"
+#include "CAssetCache.h"
 #include <list>
 #include <unordered_map>
 #include <map>
@@ -52,6 +53,7 @@ public:
 	CGeoset*		Geosets;
 	u16*		Indices;
 	SVertex_A*		AVertices;
+	bool		FromCache;			//IndicesAVerticesָm2ӳ, ͷ
 	
 	//vm
 	IVertexBuffer*		GVertexBuffer;
@@ -59,6 +61,43 @@ public:
 	IIndexBuffer*		IndexBuffer;
 };
 
+//m2ļ, animblockm2ڵֱļ, е.animļڵһνʱ̴߳
+class CM2AnimSource : public IAnimSource
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CM2AnimSource);
+
+public:
+	CM2AnimSource(IMemFile* m2File, const u8* m2Data, const IFileM2* m2);
+	~CM2AnimSource();
+
+	virtual const u8* getM2Data() const { return M2Data; }
+	virtual bool getAnimFile(u32 anim, SAnimFile& file);
+	virtual lock_type* getDecodeLock() { return &DecodeCS; }
+
+	void releaseAnimFiles();
+	void onAnimFileLoaded(u32 anim, IMemFile* file);			//߳, CResourceLoader::beginFrameе
+
+private:
+	enum E_ANIM_STATE
+	{
+		EAS_NONE = 0,
+		EAS_LOADING,
+		EAS_OPENED,
+	};
+
+	void openAnimFile(u32 anim, IMemFile* file);
+
+	const IFileM2*		M2;
+	IMemFile*		M2File;
+	const u8*		M2Data;			//M2Filem2ͷλ
+	IMemFile**		AnimMpqs;
+	SAnimFile*		AnimFiles;
+	u8*		AnimStates;			//E_ANIM_STATE
+	u32		NumLoading;
+	lock_type		DecodeCS;
+};
+
 class CFileM2 : public IFileM2
 {
 private:
@@ -82,19 +121,28 @@ public:
 	virtual bool addAction(wow_m2Action* action);
 	virtual wow_m2Action* getAction(const c8* name) const;
 
+	virtual u32 releaseUnusedAnimations(T_AnimBlockList& retired);
+
 	const aabbox3df& getBoundingBox() const { return BoundingBox; }
 	s16 getAnimationIndex(const c8* name, u32 subIdx = 0) const;
 	u32 getAnimationCount(const c8* name) const;
 
-	u8* getFileData() const { return FileData; }
+	u8* getFileData() const { return FileData; }			//ֻloadFileڼЧ
 
 private:
 	bool loadFileMD20(IMemFile* file);
 	bool loadFileMD21(IMemFile* file);
+	bool loadData(IMemFile* file);
 
 private:
 	void clear();
 
+	//洦Ķ, Χ, , render flag, ҵ, LODskin 0Ĳ, ʱֱָӳ
+	bool getCacheStamp(const c8* filename, u64& stamp) const;
+	bool loadCache(const c8* filename, u64 stamp);
+	void saveCache(const c8* filename, u64 stamp) const;
+	bool loadSkinCache(const SAssetCacheSection* sections);
+
 	void loadVertices();
 	void loadBounds();
 	void loadTextures();
@@ -103,15 +151,17 @@ private:
 	void loadColor();
 	void loadTransparency();
 	void loadTextureAnimation();
-	void loadBones();
+	void loadBones(IMemFile* file);
 	void loadRenderFlags();
 	void loadParticleSystems();
 	void loadRibbonEmitters();
 	void loadModelCameras();
 
+	void getSkinFileName(u32 idx, c8* filename, u32 size) const;
 	bool loadSkin(u32 idx);
 
 	void setBoneType(s16 boneIdx);
+	void buildBoneLods();
 
 	u32 getSkinIndex(u32 race, u32 gender, bool isHD);
 
@@ -126,6 +176,9 @@ private:
 
 private:
 	u8*			FileData;
+	u32			FileSize;
+	CM2AnimSource*		AnimSource;
+	CAssetCache::SEntry		CacheEntry;			//лʱ, ָӳ, clearʱ
 
 	T_AnimationLookup	AnimationNameLookup;
 
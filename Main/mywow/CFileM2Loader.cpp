@@ -1,12 +1,18 @@
 #include "stdafx.h"
 #include "CFileM2Loader.h"
 #include "CFileM2.h"
+#include "IMemFile.h"
 
 IFileM2* CM2Loader::loadM2( IMemFile* file )
 {
 	CFileM2* m2File = new CFileM2;
 
-	if (!m2File->loadFile(file))
+	//йʱfileCM2AnimSource, m2ͷ
+	bool ret = m2File->loadFile(file);
+	if (!m2File->AnimSource)
+		delete file;
+
+	if (!ret)
 	{
 		m2File->drop();	
 		return NULL_PTR;
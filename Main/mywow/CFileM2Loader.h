@@ -10,5 +10,6 @@ class CM2Loader
 public:
 	static bool isALoadableFileExtension( const c8* filename ) { return hasFileExtensionA(filename, "m2"); }
 
+	//fileصm2, ʧʱҲɾ
 	IFileM2* loadM2( IMemFile* file );
 };
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "CFileSystem.h"
 #include "CReadFile.h"
 #include "CWriteFile.h"
+#include "CMemFile.h"
+#include "CMappedFile.h"
+#include "temp_memory.h"
 #include "CSysGlobal.h"
 #include "CSysUtility.h"
 #include "CLock.h"
@@ -11,6 +14,8 @@
 #define LOG_DIR	"Logs/"
 #define  SUBDIR_SHADER		"Shaders/"
 
+#define MAP_MIN_FILE_SIZE		(64 * 1024)			//Сļһfreadӳȱҳ
+
 CFileSystem::CFileSystem(const c8* baseDir, const c8* logDir, bool ignoreSetting)
 	: LogGxFile(NULL_PTR), LogResFile(NULL_PTR), LogSoundFile(NULL_PTR)
 {
@@ -133,6 +138,45 @@ IReadFile* CFileSystem::createAndOpenFile( const c8* filename, bool binary )
 	return NULL_PTR;
 }
 
+IMemFile* CFileSystem::createMemFile( const c8* filename, const c8* name, bool tempfile, bool allowMap /*= true*/ )
+{
+	u64 fileSize;
+	if (!Q_getFileSize(filename, fileSize) || fileSize <= 1 || fileSize >= 0xffffffff)
+		return NULL_PTR;
+
+	if (allowMap && fileSize >= MAP_MIN_FILE_SIZE)
+	{
+		CMappedFile* file = new CMappedFile(filename, name);
+		if (file->isValid())
+			return file;
+
+		delete file;			//ӳʧʱ˻صļ
+	}
+
+	IReadFile* rfile = createAndOpenFile(filename, true);
+	if (!rfile)
+		return NULL_PTR;
+
+	u32 size = rfile->getSize();
+	if (size <= 1)
+	{
+		delete rfile;
+		return NULL_PTR;
+	}
+
+	u8* buffer;
+	if (tempfile)
+		buffer = (u8*)Z_AllocateTempMemory(size);
+	else
+		buffer = new u8[size];
+
+	u32 readSize = rfile->read(buffer, size);
+	ASSERT(readSize == size);
+	delete rfile;
+
+	return new CMemFile(buffer, size, name, tempfile);
+}
+
 IWriteFile* CFileSystem::createAndWriteFile( const c8* filename, bool binary, bool append /*= false*/ )
 {
 	CWriteFile* file = new CWriteFile(filename, binary, append);
@@ -16,6 +16,7 @@ public:
 public:
 	virtual IReadFile* createAndOpenFile( const c8* filename, bool binary );
 	virtual IWriteFile* createAndWriteFile( const c8* filename, bool binary, bool append = false);
+	virtual IMemFile* createMemFile( const c8* filename, const c8* name, bool tempfile, bool allowMap = true );
 
 	virtual bool createDirectory(const c8* dirname);
 	virtual bool deleteDirectory(const c8* dirname);
@@ -8,6 +8,7 @@ CFileWDT::CFileWDT()
 {
 	FileData = NULL_PTR;
 	TileOffsets = new s32[TILENUM * TILENUM];
+	::memset(TileOffsets, 0, sizeof(s32) * TILENUM * TILENUM);
 	MapEnvironment = NULL_PTR;
 	MapId = 0;
 
@@ -256,6 +257,10 @@ bool CFileWDT::unloadADT( STile* tile )
 	if (!tile || !tile->fileAdt)
  		return false;
 
+	ICollisionServices* collisionServices = g_Engine->getCollisionServices();
+	if (collisionServices)
+		collisionServices->removeTile(tile->fileAdt);
+
 	tile->fileAdt->drop();
 	tile->fileAdt = NULL_PTR;
 
@@ -365,6 +370,31 @@ void CFileWDT::loadWDL()
 
 		file->seek((int)nextpos);
 	}
+
+	//MAOFÿtileMAREλ, ֻADTtile
+	WdlIndices.assign(Tiles.size(), -1);
+	WdlHeights.clear();
+	for (u32 i=0; i<(u32)Tiles.size(); ++i)
+	{
+		const STile& tile = Tiles[i];
+		s32 offset = TileOffsets[tile.row * TILENUM + tile.col];
+		if (offset <= 0 || (u32)offset + 8 + WDL_HEIGHT_COUNT * sizeof(s16) > file->getSize())
+			continue;
+
+		file->seek(offset);
+		file->read(fourcc, 4);
+		file->read(&size, 4);
+		flipcc(fourcc);
+		fourcc[4] = 0;
+
+		if (strcmp(fourcc, "MARE") != 0 || size < WDL_HEIGHT_COUNT * sizeof(s16))
+			continue;
+
+		WdlIndices[i] = (s32)WdlHeights.size();
+		WdlHeights.resize(WdlHeights.size() + WDL_HEIGHT_COUNT);
+		file->read(&WdlHeights[WdlIndices[i]], WDL_HEIGHT_COUNT * sizeof(s16));
+	}
+
 	delete file;
 }
 
@@ -438,6 +468,29 @@ const c8* CFileWDT::getWMOFileName( u32 index ) const
 	return (const c8*)&WmoFileNameBlock[WmoFileNameIndices[index]];
 }
 
+const s16* CFileWDT::getWDLHeights( u8 row, u8 col ) const
+{
+	T_TileLookup::const_iterator itr = TileLookup.find(M_MAKEWORD(col, row));
+	if (itr == TileLookup.end() || itr->second >= (u32)WdlIndices.size())
+		return NULL_PTR;
+
+	s32 index = WdlIndices[itr->second];
+	if (index < 0)
+		return NULL_PTR;
+	return &WdlHeights[index];
+}
+
+bool CFileWDT::getTileBase( s32 row, s32 col, f32& xbase, f32& zbase ) const
+{
+	if(AdtRow == -1 || AdtCol == -1)		//1st adt not read
+		return false;
+
+	//getTileByPosition෴
+	xbase = AdtPosition.X + (AdtCol - col + 1) * TILESIZE;
+	zbase = AdtPosition.Z + (row - AdtRow) * TILESIZE;
+	return true;
+}
+
 void CFileWDT::getADTFileName( u8 row, u8 col, c8* name, u32 size ) const
 {
 	ASSERT(size >= QMAX_PATH);
@@ -38,6 +38,17 @@ public:
 	void getADTFileName(u8 row, u8 col, c8* name, u32 size) const;
 	const c8* getWMOFileName(u32 index) const;
 
+	//WDL;ȵ, 17x17Χ߶Ⱥ16x16ĸ߶, +z, -x, MCVTһ
+	const s16* getWDLHeights(u8 row, u8 col) const;
+	bool getTileBase(s32 row, s32 col, f32& xbase, f32& zbase) const;		//CMapChunkһ, xbaseΪx, zbaseΪСz
+
+	enum
+	{
+		WDL_OUTER = 17,
+		WDL_INNER = 16,
+		WDL_HEIGHT_COUNT = WDL_OUTER * WDL_OUTER + WDL_INNER * WDL_INNER,
+	};
+
 private:
 	bool loadADTData(STile* tile);		//no video data
 
@@ -67,6 +78,10 @@ private:
 	//hibyte: row, lowbyte: col
 	T_TileLookup		TileLookup;
 
+	//wdl, Tiles, -1Ϊû
+	std::vector<s32>		WdlIndices;
+	std::vector<s16>		WdlHeights;
+
 };
 
 inline STile* CFileWDT::getTile( u32 index )
@@ -1,6 +1,37 @@
 #include "stdafx.h"
 #include "CFileWMO.h"
 #include "mywow.h"
+#include "CAssetCache.h"
+
+#define WMO_GROUP_BVH_LEAF_SIZE		2
+#define WMO_BSP_STACK_SIZE		128
+#define WMO_FLOOR_EPSILON		0.0001f
+
+namespace
+{
+	//bspڵķָ, ļеy, zڼʱѽ
+	inline f32 getBspAxis(const vector3df& v, u16 planetype)
+	{
+		switch(planetype & 3)
+		{
+		case 0:
+			return v.X;
+		case 1:
+			return v.Z;
+		default:
+			return v.Y;
+		}
+	}
+
+	struct SGroupCenterLess
+	{
+		SGroupCenterLess(const CWMOGroup* groups, u32 axis) : groups(groups), axis(axis) {}
+		bool operator()(u16 a, u16 b) const { return get(groups[a].box.getCenter()) < get(groups[b].box.getCenter()); }
+		f32 get(const vector3df& v) const { return axis == 0 ? v.X : (axis == 1 ? v.Y : v.Z); }
+		const CWMOGroup* groups;
+		u32 axis;
+	};
+}
 
 CWMOGroup::CWMOGroup()
 {
@@ -33,14 +64,19 @@ CWMOGroup::CWMOGroup()
 
 CWMOGroup::~CWMOGroup()
 {
-	delete[]	Doodads;
-	delete[]	Lights;
-	delete[]	Batches;
+	if (!CacheEntry.File)
+	{
+		delete[]	Doodads;
+		delete[]	Lights;
+		delete[]	Batches;
 
-	delete[] BspTriangles;
-	delete[] BspNodes;
+		delete[] BspTriangles;
+		delete[] BspNodes;
+	}
 	delete BspIndexbuffer;
 	delete BspVertexBuffer;
+
+	CAssetCache::release(CacheEntry);
 }
 
 CFileWMO::CFileWMO()
@@ -383,17 +419,6 @@ bool CFileWMO::loadFile( IMemFile* file )
 	{
 		Groups[i].loadFile(i, this);
 		Box.addInternalBox(Groups[i].box);
-
-		//group box
-		for (u32 c=0; c<Groups[i].NumBatches; ++c)
-		{
-			SWMOBatch* batch = &Groups[i].Batches[c];
-			batch->box.set(vector3df(999999.9f), vector3df(-999999.9f));
-			for (u32 k=batch->vertexStart; k<batch->vertexEnd; ++k)
-			{
-				batch->box.addInternalPoint(Groups[i].Vertices[k].Pos);
-			}
-		}
 	}
 
 	buildGroupBuffers();
@@ -424,6 +449,10 @@ bool CFileWMO::loadFile( IMemFile* file )
 
 	buildPortalEntries();
 
+	buildPortalGraph();
+
+	buildIndoorGroupBVH();
+
 	PortalVertexBuffer = new IVertexBuffer(false);
 	PortalVertexBuffer->set(PortalVertices, EST_P, NumPortalVertices, EMM_STATIC);
 
@@ -455,9 +484,14 @@ void CFileWMO::buildGroupBuffers()
 		for (u32 k=0; k<group->ICount; ++k)
 			Indices[group->IStart + k] = group->Indices[k] + group->VStart;
 
-		//ϲ֮ͷ group
-		delete[] group->Vertices;
-		delete[] group->Indices;
+		//ϲ֮ͷ group, ָ򻺴ӳĲͷ
+		if (!group->CacheEntry.File)
+		{
+			delete[] group->Vertices;
+			delete[] group->Indices;
+		}
+		group->Vertices = NULL_PTR;
+		group->Indices = NULL_PTR;
 	}
 
 	VertexBuffer = new IVertexBuffer(false);
@@ -623,6 +657,14 @@ bool CWMOGroup::loadFile( u32 index, IFileWMO* wmo )
 	c8 filename[QMAX_PATH];
 	Q_sprintf(filename, QMAX_PATH, "%s_%03d.wmo", path, (s32)index);
 
+	//Уֻȡ鵵Ԫ, ʱôgroupļ
+	CAssetCache* cache = g_Engine->getAssetCache();
+	u64 srcStamp = 0;
+	if (cache && !g_Engine->getWowEnvironment()->getFileStamp(filename, srcStamp))
+		cache = NULL_PTR;
+	if (cache && loadCache(cache, filename, srcStamp))
+		return true;
+
 	IMemFile* file = g_Engine->getWowEnvironment()->openFile(filename);
 	ASSERT(file);
 	if (!file)
@@ -817,11 +859,88 @@ bool CWMOGroup::loadFile( u32 index, IFileWMO* wmo )
 
 	delete file;
 
+	//batchΧһ𻺴
+	for (u32 c=0; c<NumBatches; ++c)
+	{
+		SWMOBatch* batch = &Batches[c];
+		batch->box.set(vector3df(999999.9f), vector3df(-999999.9f));
+		for (u32 k=batch->vertexStart; k<batch->vertexEnd; ++k)
+		{
+			batch->box.addInternalPoint(Vertices[k].Pos);
+		}
+	}
+
+	if (cache)
+		saveCache(cache, filename, srcStamp);
+
 //	buildBspVIBuffers();
 
 	return true;
 }
 
+//: Indices, Vertices, Batches(Χ), Lights, Doodads, BspNodes, BspTriangles, hasVertexColor
+#define WMOGROUP_CACHE_SECTIONS		8
+
+bool CWMOGroup::loadCache( CAssetCache* cache, const c8* filename, u64 srcStamp )
+{
+	CAssetCache::SEntry entry;
+	if (!cache->load(EACT_WMOGROUP, filename, srcStamp, entry))
+		return false;
+
+	const SAssetCacheSection* sec = entry.Sections;
+	if (entry.NumSections != WMOGROUP_CACHE_SECTIONS ||
+		sec[0].size % sizeof(u16) ||
+		sec[1].size % sizeof(SVertex_PNCT2) ||
+		sec[2].size % sizeof(SWMOBatch) ||
+		sec[3].size % sizeof(u16) ||
+		sec[4].size % sizeof(u16) ||
+		sec[5].size % sizeof(SWMOBspNode) ||
+		sec[6].size % sizeof(u16) ||
+		sec[7].size != sizeof(u32))
+	{
+		CAssetCache::release(entry);
+		return false;
+	}
+
+	ICount = sec[0].size / sizeof(u16);
+	VCount = sec[1].size / sizeof(SVertex_PNCT2);
+	NumBatches = sec[2].size / sizeof(SWMOBatch);
+	NumLights = sec[3].size / sizeof(u16);
+	NumDoodads = sec[4].size / sizeof(u16);
+	NumBspNodes = sec[5].size / sizeof(SWMOBspNode);
+	NumBspTriangles = sec[6].size / sizeof(u16);
+
+	//ֱʹӳе, ӳдʱƵ, ֮дҲӰ컺ļ
+	Indices = (u16*)sec[0].data;
+	Vertices = (SVertex_PNCT2*)sec[1].data;
+	Batches = (SWMOBatch*)sec[2].data;
+	Lights = (u16*)sec[3].data;
+	Doodads = (u16*)sec[4].data;
+	BspNodes = (SWMOBspNode*)sec[5].data;
+	BspTriangles = (u16*)sec[6].data;
+	hasVertexColor = *(const u32*)sec[7].data != 0;
+
+	CacheEntry = entry;
+	return true;
+}
+
+void CWMOGroup::saveCache( CAssetCache* cache, const c8* filename, u64 srcStamp ) const
+{
+	u32 vertexColor = hasVertexColor ? 1 : 0;
+	SAssetCacheSection sections[WMOGROUP_CACHE_SECTIONS] =
+	{
+		{ Indices, sizeof(u16) * ICount },
+		{ Vertices, sizeof(SVertex_PNCT2) * VCount },
+		{ Batches, sizeof(SWMOBatch) * NumBatches },
+		{ Lights, sizeof(u16) * NumLights },
+		{ Doodads, sizeof(u16) * NumDoodads },
+		{ BspNodes, sizeof(SWMOBspNode) * NumBspNodes },
+		{ BspTriangles, sizeof(u16) * NumBspTriangles },
+		{ &vertexColor, sizeof(u32) },
+	};
+	cache->save(EACT_WMOGROUP, filename, srcStamp, sections, WMOGROUP_CACHE_SECTIONS);
+}
+
 void CWMOGroup::buildBspVIBuffers()
 {
 	if (NumBspNodes > 0)
@@ -881,3 +1000,299 @@ void CWMOGroup::buildBspVIBuffers()
 	}
 }
 
+void CFileWMO::buildPortalGraph()
+{
+	PortalLinks.clear();
+	GroupLinkStart.assign(Header.nGroups + 1, 0);
+	EntryPortals.clear();
+	OutdoorGroups.clear();
+
+	for (u32 i=0; i<Header.nGroups; ++i)
+	{
+		if (!Groups[i].indoor)
+			OutdoorGroups.push_back((u16)i);
+	}
+
+	for (u32 i=0; i<Header.nPortals; ++i)
+	{
+		const SWMOPortal* p = &Portals[i];
+		if (!p->isValid())
+			continue;
+
+		++GroupLinkStart[p->frontGroupIndex + 1];
+		++GroupLinkStart[p->backGroupIndex + 1];
+
+		if (!Groups[p->frontGroupIndex].indoor || !Groups[p->backGroupIndex].indoor)
+			EntryPortals.push_back((u16)i);
+	}
+
+	for (u32 i=0; i<Header.nGroups; ++i)
+		GroupLinkStart[i + 1] += GroupLinkStart[i];
+
+	PortalLinks.resize(GroupLinkStart[Header.nGroups]);
+
+	//ÿgroupȷΪfrontportal, ٷΪback, ԭfront/backű˳һ
+	std::vector<u32> fill(GroupLinkStart.begin(), GroupLinkStart.end() - 1);
+	for (u32 side=0; side<2; ++side)
+	{
+		for (u32 i=0; i<Header.nPortals; ++i)
+		{
+			const SWMOPortal* p = &Portals[i];
+			if (!p->isValid())
+				continue;
+
+			u32 group = side == 0 ? p->frontGroupIndex : p->backGroupIndex;
+			SPortalLink& link = PortalLinks[fill[group]++];
+			link.portalIndex = (u16)i;
+			link.otherGroup = (u16)(side == 0 ? p->backGroupIndex : p->frontGroupIndex);
+			link.asFront = side == 0;
+		}
+	}
+}
+
+void CFileWMO::buildIndoorGroupBVH()
+{
+	GroupBVHNodes.clear();
+	GroupBVHIndices.clear();
+
+	for (u32 i=0; i<Header.nGroups; ++i)
+	{
+		if (Groups[i].indoor && Groups[i].NumBatches)
+			GroupBVHIndices.push_back((u16)i);
+	}
+
+	if (GroupBVHIndices.empty())
+		return;
+
+	GroupBVHNodes.reserve(GroupBVHIndices.size() * 2);
+	buildGroupBVHNode(0, (u32)GroupBVHIndices.size());
+}
+
+u32 CFileWMO::buildGroupBVHNode( u32 begin, u32 end )
+{
+	u32 nodeIndex = (u32)GroupBVHNodes.size();
+	GroupBVHNodes.push_back(SGroupBVHNode());
+
+	aabbox3df box = Groups[GroupBVHIndices[begin]].box;
+	aabbox3df centerBox(Groups[GroupBVHIndices[begin]].box.getCenter());
+	for (u32 i=begin+1; i<end; ++i)
+	{
+		box.addInternalBox(Groups[GroupBVHIndices[i]].box);
+		centerBox.addInternalPoint(Groups[GroupBVHIndices[i]].box.getCenter());
+	}
+
+	GroupBVHNodes[nodeIndex].box = box;
+
+	if (end - begin <= WMO_GROUP_BVH_LEAF_SIZE)
+	{
+		GroupBVHNodes[nodeIndex].first = begin;
+		GroupBVHNodes[nodeIndex].count = (u16)(end - begin);
+		return nodeIndex;
+	}
+
+	vector3df extent = centerBox.getExtent();
+	u32 axis = 0;
+	if (extent.Y > extent.X && extent.Y >= extent.Z)
+		axis = 1;
+	else if (extent.Z > extent.X && extent.Z > extent.Y)
+		axis = 2;
+
+	u32 mid = (begin + end) / 2;
+	std::nth_element(GroupBVHIndices.begin() + begin, GroupBVHIndices.begin() + mid, GroupBVHIndices.begin() + end, SGroupCenterLess(Groups, axis));
+
+	buildGroupBVHNode(begin, mid);
+	u32 right = buildGroupBVHNode(mid, end);
+
+	//push_backܱ
+	GroupBVHNodes[nodeIndex].first = right;
+	GroupBVHNodes[nodeIndex].count = 0;
+	return nodeIndex;
+}
+
+u32 CFileWMO::getIndoorGroupsAtPoint( const vector3df& pos, u16* groups, u32 maxGroups ) const
+{
+	if (GroupBVHNodes.empty() || !maxGroups)
+		return 0;
+
+	u32 stack[WMO_BSP_STACK_SIZE];
+	u32 top = 0;
+	stack[top++] = 0;
+
+	u32 count = 0;
+	while (top > 0)
+	{
+		const SGroupBVHNode& node = GroupBVHNodes[stack[--top]];
+		if (!node.box.isPointInside(pos))
+			continue;
+
+		if (node.count)
+		{
+			for (u32 i=0; i<node.count; ++i)
+			{
+				u16 groupIndex = GroupBVHIndices[node.first + i];
+				if (!Groups[groupIndex].box.isPointInside(pos))
+					continue;
+
+				groups[count++] = groupIndex;
+				if (count == maxGroups)
+					return count;
+			}
+			continue;
+		}
+
+		if (top + 2 > WMO_BSP_STACK_SIZE)
+		{
+			ASSERT(false);
+			break;
+		}
+
+		u32 self = (u32)(&node - &GroupBVHNodes[0]);
+		stack[top++] = node.first;
+		stack[top++] = self + 1;
+	}
+
+	return count;
+}
+
+bool CFileWMO::getGroupFloorDistance( u32 groupIndex, const vector3df& pos, f32 maxDist, f32& dist ) const
+{
+	const CWMOGroup* group = &Groups[groupIndex];
+	if (!group->NumBspNodes || !Indices || !Vertices)
+		return false;
+
+	struct SStackEntry
+	{
+		s16		node;
+		f32		t0;
+		f32		t1;
+	};
+
+	SStackEntry stack[WMO_BSP_STACK_SIZE];
+	u32 top = 0;
+
+	stack[top].node = 0;
+	stack[top].t0 = 0.0f;
+	stack[top].t1 = maxDist;
+	++top;
+
+	const vector3df dir(0, -1.0f, 0);
+	const u32* indices = &Indices[group->IStart];
+	bool found = false;
+	dist = maxDist;
+
+	while (top > 0)
+	{
+		SStackEntry e = stack[--top];
+		if (e.node < 0 || (u32)e.node >= group->NumBspNodes || e.t0 > dist)
+			continue;
+
+		const SWMOBspNode& node = group->BspNodes[e.node];
+		if (node.planetype & 4)			//leaf
+		{
+			for (u32 k=0; k<node.numfaces; ++k)
+			{
+				u32 face = node.firstface + k;
+				if (face >= group->NumBspTriangles)
+					break;
+
+				u32 tri = group->BspTriangles[face];
+				if (tri * 3 + 2 >= group->ICount)
+					continue;
+
+				const u32* idx = &indices[tri * 3];
+				const vector3df& v0 = Vertices[idx[0]].Pos;
+				vector3df e1 = Vertices[idx[1]].Pos - v0;
+				vector3df e2 = Vertices[idx[2]].Pos - v0;
+
+				//Moller-Trumbore, 涼
+				vector3df pvec = dir.crossProduct(e2);
+				f32 det = e1.dotProduct(pvec);
+				if (fabs(det) < WMO_FLOOR_EPSILON)
+					continue;
+
+				f32 invDet = 1.0f / det;
+				vector3df tvec = pos - v0;
+				f32 u = tvec.dotProduct(pvec) * invDet;
+				if (u < 0.0f || u > 1.0f)
+					continue;
+
+				vector3df qvec = tvec.crossProduct(e1);
+				f32 v = dir.dotProduct(qvec) * invDet;
+				if (v < 0.0f || u + v > 1.0f)
+					continue;
+
+				f32 t = e2.dotProduct(qvec) * invDet;
+				if (t >= 0.0f && t < dist)
+				{
+					dist = t;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		f32 t1 = min_(e.t1, dist);
+		f32 s = getBspAxis(pos, node.planetype);
+
+		if (top + 2 > WMO_BSP_STACK_SIZE)
+		{
+			ASSERT(false);
+			break;
+		}
+
+		//ֱµֻᴩˮƽķָ
+		if ((node.planetype & 3) != 2)
+		{
+			f32 p = s - node.distance;
+			if (p < WMO_FLOOR_EPSILON)
+			{
+				stack[top].node = node.left;
+				stack[top].t0 = e.t0;
+				stack[top].t1 = t1;
+				++top;
+			}
+			if (p > -WMO_FLOOR_EPSILON)
+			{
+				stack[top].node = node.right;
+				stack[top].t0 = e.t0;
+				stack[top].t1 = t1;
+				++top;
+			}
+			continue;
+		}
+
+		f32 p0 = s - e.t0 - node.distance;
+		f32 p1 = s - t1 - node.distance;
+		if (p0 >= WMO_FLOOR_EPSILON && p1 >= WMO_FLOOR_EPSILON)
+		{
+			stack[top].node = node.right;
+			stack[top].t0 = e.t0;
+			stack[top].t1 = t1;
+			++top;
+		}
+		else if (p0 <= -WMO_FLOOR_EPSILON && p1 <= -WMO_FLOOR_EPSILON)
+		{
+			stack[top].node = node.left;
+			stack[top].t0 = e.t0;
+			stack[top].t1 = t1;
+			++top;
+		}
+		else
+		{
+			//µϰ벿(), ٵ°벿
+			f32 tSplit = clamp_(s - node.distance, e.t0, t1);
+
+			stack[top].node = node.left;
+			stack[top].t0 = max_(e.t0, tSplit - WMO_FLOOR_EPSILON);
+			stack[top].t1 = t1;
+			++top;
+
+			stack[top].node = node.right;
+			stack[top].t0 = e.t0;
+			stack[top].t1 = min_(t1, tSplit + WMO_FLOOR_EPSILON);
+			++top;
+		}
+	}
+
+	return found;
+}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "IFileWMO.h"
+#include "CAssetCache.h"
 #include <unordered_map>
 #include <map>
+#include <vector>
 
 struct SWMOBatch
 {
@@ -83,6 +85,12 @@ public:
 
 private:
 	void buildBspVIBuffers();
+
+	bool loadCache(CAssetCache* cache, const c8* filename, u64 srcStamp);
+	void saveCache(CAssetCache* cache, const c8* filename, u64 srcStamp) const;
+
+public:
+	CAssetCache::SEntry		CacheEntry;			//лʱֱָӳ, ʱ
 };
 
 class CFileWMO : public IFileWMO
@@ -109,6 +117,26 @@ public:
 
 	u32 getNumGroups() const { return Header.nGroups; }
 
+	//portalͼ, ÿgroupportal
+	struct SPortalLink
+	{
+		u16		portalIndex;
+		u16		otherGroup;
+		bool		asFront;			//groupportalfrontһ
+	};
+
+	u32 getPortalLinkCount(u32 groupIndex) const { return GroupLinkStart[groupIndex + 1] - GroupLinkStart[groupIndex]; }
+	const SPortalLink* getPortalLinks(u32 groupIndex) const { return PortalLinks.empty() ? NULL_PTR : &PortalLinks[0] + GroupLinkStart[groupIndex]; }
+
+	//һgroupportal
+	const std::vector<u16>& getEntryPortals() const { return EntryPortals; }
+	const std::vector<u16>& getOutdoorGroups() const { return OutdoorGroups; }
+
+	//ģͿռ, Χаposgroup, ظ
+	u32 getIndoorGroupsAtPoint(const vector3df& pos, u16* groups, u32 maxGroups) const;
+	//ģͿռ, groupbsppos
+	bool getGroupFloorDistance(u32 groupIndex, const vector3df& pos, f32 maxDist, f32& dist) const;
+
 private:
 	void clear();
 
@@ -118,6 +146,11 @@ private:
 
 	void buildPortalEntries();
 
+	void buildPortalGraph();
+
+	void buildIndoorGroupBVH();
+	u32 buildGroupBVHNode(u32 begin, u32 end);
+
 public:
 	u8*			FileData;
 	aabbox3df	Box;
@@ -158,5 +191,20 @@ private:
 
 	T_GroupRefMap	FrontGroupRefMap;
 	T_GroupRefMap	BackGroupRefMap;
+
+	std::vector<SPortalLink>		PortalLinks;
+	std::vector<u32>		GroupLinkStart;
+	std::vector<u16>		EntryPortals;
+	std::vector<u16>		OutdoorGroups;
+
+	struct SGroupBVHNode
+	{
+		aabbox3df	box;
+		u32		first;			//ҶΪGroupBVHIndicesеʼλ, Ϊӽڵ, ӽڵں
+		u16		count;			//0Ϊڲڵ
+	};
+
+	std::vector<SGroupBVHNode>		GroupBVHNodes;
+	std::vector<u16>		GroupBVHIndices;
 };
 
@@ -0,0 +1,362 @@
+#include "stdafx.h"
+#include "CInstanceBVH.h"
+#include <algorithm>
+
+#ifdef MW_USE_SSE
+#include <emmintrin.h>
+#endif
+
+#define BVH_STACK_SIZE		256
+
+namespace
+{
+	struct SBoxLanes
+	{
+		const f32* minX;
+		const f32* minY;
+		const f32* minZ;
+		const f32* maxX;
+		const f32* maxY;
+		const f32* maxZ;
+	};
+
+	//aabbox3d::classifyPlaneRelationͬ, ƽǰԶĵҲǰʱΪISREL3D_BACK
+	//4ûбκƽ޳λ
+#ifdef MW_USE_SSE
+	inline u32 testPlanes4(const SBoxLanes& lanes, const plane3df* planes, u32 numPlanes)
+	{
+		const __m128 mnx = _mm_loadu_ps(lanes.minX);
+		const __m128 mny = _mm_loadu_ps(lanes.minY);
+		const __m128 mnz = _mm_loadu_ps(lanes.minZ);
+		const __m128 mxx = _mm_loadu_ps(lanes.maxX);
+		const __m128 mxy = _mm_loadu_ps(lanes.maxY);
+		const __m128 mxz = _mm_loadu_ps(lanes.maxZ);
+		const __m128 zero = _mm_setzero_ps();
+
+		u32 mask = 0xf;
+		for (u32 p=0; p<numPlanes && mask; ++p)
+		{
+			const plane3df& plane = planes[p];
+			__m128 fx = plane.Normal.X > 0.0f ? mxx : mnx;
+			__m128 fy = plane.Normal.Y > 0.0f ? mxy : mny;
+			__m128 fz = plane.Normal.Z > 0.0f ? mxz : mnz;
+
+			__m128 d = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(fx, _mm_set1_ps(plane.Normal.X)), _mm_mul_ps(fy, _mm_set1_ps(plane.Normal.Y))),
+				_mm_add_ps(_mm_mul_ps(fz, _mm_set1_ps(plane.Normal.Z)), _mm_set1_ps(plane.D)));
+
+			mask &= (u32)_mm_movemask_ps(_mm_cmpgt_ps(d, zero));
+		}
+		return mask;
+	}
+
+	//ӵľ벻limit[i]
+	inline u32 testBoxDistance4(const SBoxLanes& lanes, const vector3df& camPos, const f32* limit)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 cx = _mm_set1_ps(camPos.X);
+		const __m128 cy = _mm_set1_ps(camPos.Y);
+		const __m128 cz = _mm_set1_ps(camPos.Z);
+
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lanes.minX), cx), _mm_sub_ps(cx, _mm_loadu_ps(lanes.maxX))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lanes.minY), cy), _mm_sub_ps(cy, _mm_loadu_ps(lanes.maxY))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lanes.minZ), cz), _mm_sub_ps(cz, _mm_loadu_ps(lanes.maxZ))), zero);
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		__m128 l = _mm_loadu_ps(limit);
+		return (u32)_mm_movemask_ps(_mm_cmple_ps(d2, _mm_mul_ps(l, l)));
+	}
+
+	//ʵĵľ԰뾶, visibleDistanceʱɼ, ͬʱalpha
+	inline u32 testCenterDistance4(const f32* centerX, const f32* centerY, const f32* centerZ, const f32* invRadius,
+		const vector3df& camPos, f32 visibleDistance, f32 invFadeRange, f32* alpha)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(centerX), _mm_set1_ps(camPos.X));
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(centerY), _mm_set1_ps(camPos.Y));
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(centerZ), _mm_set1_ps(camPos.Z));
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		__m128 dist = _mm_mul_ps(_mm_sqrt_ps(d2), _mm_loadu_ps(invRadius));
+
+		__m128 vis = _mm_set1_ps(visibleDistance);
+		__m128 a = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(vis, dist), _mm_set1_ps(invFadeRange)), _mm_set1_ps(1.0f));
+		_mm_storeu_ps(alpha, a);
+
+		return (u32)_mm_movemask_ps(_mm_cmple_ps(dist, vis));
+	}
+#else
+	inline u32 testPlanes4(const SBoxLanes& lanes, const plane3df* planes, u32 numPlanes)
+	{
+		u32 mask = 0;
+		for (u32 i=0; i<4; ++i)
+		{
+			aabbox3df box(lanes.minX[i], lanes.minY[i], lanes.minZ[i], lanes.maxX[i], lanes.maxY[i], lanes.maxZ[i]);
+			u32 p = 0;
+			for (; p<numPlanes; ++p)
+			{
+				if (ISREL3D_BACK == box.classifyPlaneRelation(planes[p]))
+					break;
+			}
+			if (p == numPlanes)
+				mask |= (1 << i);
+		}
+		return mask;
+	}
+
+	inline u32 testBoxDistance4(const SBoxLanes& lanes, const vector3df& camPos, const f32* limit)
+	{
+		u32 mask = 0;
+		for (u32 i=0; i<4; ++i)
+		{
+			f32 dx = max_(max_(lanes.minX[i] - camPos.X, camPos.X - lanes.maxX[i]), 0.0f);
+			f32 dy = max_(max_(lanes.minY[i] - camPos.Y, camPos.Y - lanes.maxY[i]), 0.0f);
+			f32 dz = max_(max_(lanes.minZ[i] - camPos.Z, camPos.Z - lanes.maxZ[i]), 0.0f);
+			if (dx * dx + dy * dy + dz * dz <= limit[i] * limit[i])
+				mask |= (1 << i);
+		}
+		return mask;
+	}
+
+	inline u32 testCenterDistance4(const f32* centerX, const f32* centerY, const f32* centerZ, const f32* invRadius,
+		const vector3df& camPos, f32 visibleDistance, f32 invFadeRange, f32* alpha)
+	{
+		u32 mask = 0;
+		for (u32 i=0; i<4; ++i)
+		{
+			vector3df center(centerX[i], centerY[i], centerZ[i]);
+			f32 dist = camPos.getDistanceFrom(center) * invRadius[i];
+			alpha[i] = min_((visibleDistance - dist) * invFadeRange, 1.0f);
+			if (dist <= visibleDistance)
+				mask |= (1 << i);
+		}
+		return mask;
+	}
+#endif
+}
+
+CInstanceBVH::CInstanceBVH()
+{
+
+}
+
+void CInstanceBVH::clear()
+{
+	BuildItems.clear();
+	Nodes.clear();
+
+	ItemMinX.clear(); ItemMinY.clear(); ItemMinZ.clear();
+	ItemMaxX.clear(); ItemMaxY.clear(); ItemMaxZ.clear();
+	ItemCenterX.clear(); ItemCenterY.clear(); ItemCenterZ.clear();
+	ItemInvRadius.clear();
+	ItemIds.clear();
+}
+
+void CInstanceBVH::addInstance( u32 id, const aabbox3df& box, f32 radius )
+{
+	if (radius <= 0.0f)
+		return;
+
+	SBuildItem item;
+	item.box = box;
+	item.center = box.getCenter();
+	item.radius = radius;
+	item.id = id;
+	BuildItems.push_back(item);
+}
+
+void CInstanceBVH::build()
+{
+	Nodes.clear();
+
+	u32 num = (u32)BuildItems.size();
+	if (!num)
+	{
+		ItemIds.clear();
+		return;
+	}
+
+	Nodes.reserve(num / 2 + 1);
+	buildNode(0, num);
+
+	//ʱBuildItemsѰҶź˳
+	u32 padded = num + LEAF_SIZE;
+	ItemMinX.assign(padded, 0.0f); ItemMinY.assign(padded, 0.0f); ItemMinZ.assign(padded, 0.0f);
+	ItemMaxX.assign(padded, 0.0f); ItemMaxY.assign(padded, 0.0f); ItemMaxZ.assign(padded, 0.0f);
+	ItemCenterX.assign(padded, 0.0f); ItemCenterY.assign(padded, 0.0f); ItemCenterZ.assign(padded, 0.0f);
+	ItemInvRadius.assign(padded, 0.0f);
+	ItemIds.resize(num);
+
+	for (u32 i=0; i<num; ++i)
+	{
+		const SBuildItem& item = BuildItems[i];
+		ItemMinX[i] = item.box.MinEdge.X;
+		ItemMinY[i] = item.box.MinEdge.Y;
+		ItemMinZ[i] = item.box.MinEdge.Z;
+		ItemMaxX[i] = item.box.MaxEdge.X;
+		ItemMaxY[i] = item.box.MaxEdge.Y;
+		ItemMaxZ[i] = item.box.MaxEdge.Z;
+		ItemCenterX[i] = item.center.X;
+		ItemCenterY[i] = item.center.Y;
+		ItemCenterZ[i] = item.center.Z;
+		ItemInvRadius[i] = 1.0f / item.radius;
+		ItemIds[i] = item.id;
+	}
+}
+
+void CInstanceBVH::splitRange( u32 begin, u32 end, u32& mid )
+{
+	aabbox3df centerBox(BuildItems[begin].center);
+	for (u32 i=begin+1; i<end; ++i)
+		centerBox.addInternalPoint(BuildItems[i].center);
+
+	vector3df ext = centerBox.getExtent();
+	u32 axis = 0;
+	if (ext.Y > ext.X && ext.Y >= ext.Z)
+		axis = 1;
+	else if (ext.Z > ext.X && ext.Z > ext.Y)
+		axis = 2;
+
+	mid = (begin + end) / 2;
+	std::nth_element(BuildItems.begin() + begin, BuildItems.begin() + mid, BuildItems.begin() + end, SCenterLess(axis));
+}
+
+u32 CInstanceBVH::buildNode( u32 begin, u32 end )
+{
+	u32 nodeIndex = (u32)Nodes.size();
+	Nodes.push_back(SNode());
+
+	//ÿδһмп, 4
+	u32 bounds[5];
+	u32 numParts = 1;
+	bounds[0] = begin;
+	bounds[1] = end;
+	while (numParts < 4)
+	{
+		u32 largest = 0;
+		for (u32 k=1; k<numParts; ++k)
+		{
+			if (bounds[k + 1] - bounds[k] > bounds[largest + 1] - bounds[largest])
+				largest = k;
+		}
+		if (bounds[largest + 1] - bounds[largest] <= LEAF_SIZE)
+			break;
+
+		u32 mid;
+		splitRange(bounds[largest], bounds[largest + 1], mid);
+		for (u32 k=numParts + 1; k>largest + 1; --k)
+			bounds[k] = bounds[k - 1];
+		bounds[largest + 1] = mid;
+		++numParts;
+	}
+
+	for (u32 k=0; k<numParts; ++k)
+	{
+		u32 b = bounds[k];
+		u32 e = bounds[k + 1];
+
+		aabbox3df box = BuildItems[b].box;
+		f32 maxRadius = BuildItems[b].radius;
+		for (u32 i=b+1; i<e; ++i)
+		{
+			box.addInternalBox(BuildItems[i].box);
+			maxRadius = max_(maxRadius, BuildItems[i].radius);
+		}
+
+		u32 child = b;
+		u8 count = (u8)(e - b);
+		if (e - b > LEAF_SIZE)
+		{
+			child = buildNode(b, e);
+			count = 0;
+		}
+
+		SNode& node = Nodes[nodeIndex];
+		node.minX[k] = box.MinEdge.X;
+		node.minY[k] = box.MinEdge.Y;
+		node.minZ[k] = box.MinEdge.Z;
+		node.maxX[k] = box.MaxEdge.X;
+		node.maxY[k] = box.MaxEdge.Y;
+		node.maxZ[k] = box.MaxEdge.Z;
+		node.maxRadius[k] = maxRadius;
+		node.child[k] = child;
+		node.count[k] = count;
+	}
+
+	Nodes[nodeIndex].numChildren = (u8)numParts;
+	return nodeIndex;
+}
+
+u32 CInstanceBVH::cull( const SCullParam& param, SCullResult* results ) const
+{
+	if (Nodes.empty())
+		return 0;
+
+	ASSERT(param.numPlanes <= MAX_CULL_PLANES);
+
+	const bool checkDistance = param.visibleDistance > 0.0f;
+	const f32 fadeRange = param.visibleDistance - param.alphaDistance;
+	const f32 invFadeRange = fadeRange > 0.0f ? 1.0f / fadeRange : 1000000.0f;
+
+	f32 nodeLimit[4];
+	f32 alpha[4];
+
+	u32 stack[BVH_STACK_SIZE];
+	u32 top = 0;
+	stack[top++] = 0;
+
+	u32 numVisible = 0;
+	while (top > 0)
+	{
+		const SNode& node = Nodes[stack[--top]];
+
+		SBoxLanes lanes = { node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ };
+		u32 mask = testPlanes4(lanes, param.planes, param.numPlanes) & ((1 << node.numChildren) - 1);
+		if (mask && checkDistance)
+		{
+			for (u32 k=0; k<4; ++k)
+				nodeLimit[k] = node.maxRadius[k] * param.visibleDistance;
+			mask &= testBoxDistance4(lanes, param.camPos, nodeLimit);
+		}
+
+		for (u32 k=0; k<4; ++k)
+		{
+			if (!(mask & (1 << k)))
+				continue;
+
+			if (!node.count[k])
+			{
+				ASSERT(top < BVH_STACK_SIZE);
+				stack[top++] = node.child[k];
+				continue;
+			}
+
+			//Ҷ
+			u32 first = node.child[k];
+			SBoxLanes itemLanes = { &ItemMinX[first], &ItemMinY[first], &ItemMinZ[first], &ItemMaxX[first], &ItemMaxY[first], &ItemMaxZ[first] };
+			u32 itemMask = testPlanes4(itemLanes, param.planes, param.numPlanes) & ((1 << node.count[k]) - 1);
+			if (!itemMask)
+				continue;
+
+			if (checkDistance)
+			{
+				itemMask &= testCenterDistance4(&ItemCenterX[first], &ItemCenterY[first], &ItemCenterZ[first], &ItemInvRadius[first],
+					param.camPos, param.visibleDistance, invFadeRange, alpha);
+			}
+			else
+			{
+				alpha[0] = alpha[1] = alpha[2] = alpha[3] = 1.0f;
+			}
+
+			for (u32 i=0; i<4; ++i)
+			{
+				if (itemMask & (1 << i))
+				{
+					results[numVisible].id = ItemIds[first + i];
+					results[numVisible].alpha = alpha[i];
+					++numVisible;
+				}
+			}
+		}
+	}
+
+	return numVisible;
+}
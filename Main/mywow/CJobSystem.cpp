@@ -0,0 +1,179 @@
+#include "stdafx.h"
+#include "CJobSystem.h"
+#include "mywow.h"
+
+CJobSystem::CJobSystem(u32 numThreads)
+	: NumWorkers(0), Quit(0)
+{
+	if (numThreads == 0)
+	{
+		u32 numCpu = CSysUtility::getProcessorCount();
+		numThreads = numCpu > 1 ? numCpu - 1 : 0;			//̱߳Ҳִ
+	}
+	NumWorkers = min_(numThreads, (u32)MAX_JOB_THREADS);
+
+	for (u32 i=0; i<=NumWorkers; ++i)
+	{
+		INIT_LOCK(&Queues[i].cs);
+		Queues[i].jobs.reserve(64);
+		Queues[i].head = 0;
+	}
+
+	for (u32 i=0; i<NumWorkers; ++i)
+	{
+		SWorker* worker = &Workers[i];
+		worker->system = this;
+		worker->index = i;
+		INIT_EVENT(&worker->event, NULL_PTR);
+		INIT_THREAD(&worker->thread, JobThreadFunc, worker, false);
+	}
+}
+
+CJobSystem::~CJobSystem()
+{
+	ATOMIC_INCREMENT(&Quit);
+	for (u32 i=0; i<NumWorkers; ++i)
+	{
+		SET_EVENT(&Workers[i].event);
+	}
+
+	for (u32 i=0; i<NumWorkers; ++i)
+	{
+		if( !WAIT_THREAD(&Workers[i].thread) )
+		{
+			ASSERT(false);
+		}
+		DESTROY_THREAD(&Workers[i].thread);
+		DESTROY_EVENT(&Workers[i].event);
+	}
+
+	for (u32 i=0; i<=NumWorkers; ++i)
+	{
+		DESTROY_LOCK(&Queues[i].cs);
+	}
+}
+
+void CJobSystem::parallelFor( JOB_FUNC func, void* const* params, u32 count )
+{
+	if (count == 0)
+		return;
+
+	//ûйֻ̻߳һʱֱִ
+	if (NumWorkers == 0 || count == 1)
+	{
+		for (u32 i=0; i<count; ++i)
+			func(params[i]);
+		return;
+	}
+
+	SJobBatch batch;
+	batch.pending = (int)count;
+
+	//䵽
+	u32 numQueues = NumWorkers + 1;
+	for (u32 q=0; q<numQueues; ++q)
+	{
+		SJobQueue* queue = &Queues[q];
+
+		BEGIN_LOCK(&queue->cs);
+		if (queue->head == (u32)queue->jobs.size())
+		{
+			queue->jobs.clear();
+			queue->head = 0;
+		}
+		for (u32 i=q; i<count; i += numQueues)
+		{
+			SJob job;
+			job.func = func;
+			job.param = params[i];
+			job.batch = &batch;
+			queue->jobs.push_back(job);
+		}
+		END_LOCK(&queue->cs);
+	}
+
+	u32 numWake = min_(count - 1, NumWorkers);
+	for (u32 i=0; i<numWake; ++i)
+	{
+		SET_EVENT(&Workers[i].event);
+	}
+
+	//ִ߳ԼĶ, Ȼȡ, ֱε
+	//ͬʱõ̹߳һ, Ƕ׵ʱ߳Ҳпʼ
+	while (ATOMIC_LOAD(&batch.pending) > 0)
+	{
+		if (!runOneJob(NumWorkers))
+			SLEEP(0);
+	}
+}
+
+bool CJobSystem::popJob( u32 queue, SJob& job )
+{
+	SJobQueue* q = &Queues[queue];
+	bool ret = false;
+
+	BEGIN_LOCK(&q->cs);
+	if (q->head < (u32)q->jobs.size())
+	{
+		job = q->jobs.back();
+		q->jobs.pop_back();
+		ret = true;
+	}
+	END_LOCK(&q->cs);
+
+	return ret;
+}
+
+bool CJobSystem::stealJob( u32 queue, SJob& job )
+{
+	u32 numQueues = NumWorkers + 1;
+	for (u32 i=1; i<numQueues; ++i)
+	{
+		SJobQueue* q = &Queues[(queue + i) % numQueues];
+		bool ret = false;
+
+		BEGIN_LOCK(&q->cs);
+		if (q->head < (u32)q->jobs.size())
+		{
+			job = q->jobs[q->head];
+			++q->head;
+			ret = true;
+		}
+		END_LOCK(&q->cs);
+
+		if (ret)
+			return true;
+	}
+	return false;
+}
+
+bool CJobSystem::runOneJob( u32 queue )
+{
+	SJob job;
+	if (!popJob(queue, job) && !stealJob(queue, job))
+		return false;
+
+	job.func(job.param);
+
+	//batchڵߵջ, 0߿Ѿ
+	ATOMIC_DECREMENT(&job.batch->pending);
+	return true;
+}
+
+int CJobSystem::JobThreadFunc( void* lpParam )
+{
+	SWorker* worker = (SWorker*)lpParam;
+	CJobSystem* system = worker->system;
+
+	for (;;)
+	{
+		WAIT_EVENT(&worker->event);
+
+		if (ATOMIC_LOAD(&system->Quit))
+			break;
+
+		while (system->runOneJob(worker->index)) {}
+	}
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "core.h"
+#include "CSysSync.h"
+#include "CSysThread.h"
+#include <vector>
+
+//һִ֡лصС, ߳Ҳִ, ȫɺ󷵻
+//ÿ߳һ, ԼĶдβȡ, ʱеͷȡ
+//ֻһ, g_Engine->getJobSystem(), Ҫⴴ
+class CJobSystem
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CJobSystem);
+
+public:
+	typedef void (*JOB_FUNC)(void* param);
+
+	explicit CJobSystem(u32 numThreads = 0);
+	~CJobSystem();
+
+public:
+	//ÿparams[i]ִfunc, ʱȫִ
+	//ÿεõ, ߳̿ͬʱ, Ҳٵ(Ƕ)
+	//ȴʱִ̻߳жеκ, ύ
+	void parallelFor(JOB_FUNC func, void* const* params, u32 count);
+
+	u32 getNumWorkers() const { return NumWorkers; }
+
+private:
+	enum
+	{
+		MAX_JOB_THREADS = 7,
+	};
+
+	struct SJobBatch
+	{
+		volatile int	pending;			//һparallelForδɵ
+	};
+
+	struct SJob
+	{
+		JOB_FUNC	func;
+		void*	param;
+		SJobBatch*	batch;
+	};
+
+	struct SJobQueue
+	{
+		lock_type	cs;
+		std::vector<SJob>	jobs;
+		u32		head;
+	};
+
+	struct SWorker
+	{
+		CJobSystem*	system;
+		thread_type		thread;
+		event_type		event;
+		u32		index;
+	};
+
+	static int JobThreadFunc(void* lpParam);
+
+	bool popJob(u32 queue, SJob& job);
+	bool stealJob(u32 queue, SJob& job);
+	bool runOneJob(u32 queue);
+
+private:
+	SJobQueue	Queues[MAX_JOB_THREADS + 1];			//һΪ̵߳Ķ
+	SWorker		Workers[MAX_JOB_THREADS];
+	u32		NumWorkers;
+	volatile int	Quit;
+};
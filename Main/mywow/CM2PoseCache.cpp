@@ -0,0 +1,130 @@
+#include "stdafx.h"
+#include "CM2PoseCache.h"
+#include "mywow.h"
+#include "wow_m2instance.h"
+
+SM2Pose::SM2Pose( const SM2PoseKey& key, u32 numBones, u32 numMatrices, u32 numGeosets )
+	: Key(key), Refs(1), Ready(false)
+{
+	//m2, ֹͷźַģ͸ɴƥ
+	const_cast<IFileM2*>(Key.mesh)->grab();
+
+	Bones = new SDynBone[numBones];
+	Palettes = numMatrices ? new matrix4[numMatrices] : NULL_PTR;
+	Geosets = numGeosets ? new SM2PoseGeoset[numGeosets] : NULL_PTR;
+}
+
+SM2Pose::~SM2Pose()
+{
+	delete[] Geosets;
+	delete[] Palettes;
+	delete[] Bones;
+
+	const_cast<IFileM2*>(Key.mesh)->drop();
+}
+
+CM2PoseCache::CM2PoseCache()
+	: NumPoses(0), LastHits(0), LastMisses(0)
+{
+	for (u32 i=0; i<NUM_SHARDS; ++i)
+	{
+		INIT_LOCK(&Shards[i].cs);
+		Shards[i].hits = 0;
+		Shards[i].misses = 0;
+	}
+}
+
+CM2PoseCache::~CM2PoseCache()
+{
+	for (u32 i=0; i<NUM_SHARDS; ++i)
+	{
+		T_PoseMap& poses = Shards[i].poses;
+		for (T_PoseMap::iterator itr = poses.begin(); itr != poses.end(); ++itr)
+		{
+			ASSERT(ATOMIC_LOAD(&itr->second->Refs) == 0);
+			delete itr->second;
+		}
+		poses.clear();
+
+		DESTROY_LOCK(&Shards[i].cs);
+	}
+}
+
+SM2Pose* CM2PoseCache::acquire( const SM2PoseKey& key, u32 numBones, u32 numMatrices, u32 numGeosets, bool& build )
+{
+	SShard* shard = &Shards[SM2PoseKey_hash()(key) % NUM_SHARDS];
+	SM2Pose* pose = NULL_PTR;
+	build = false;
+
+	BEGIN_LOCK(&shard->cs);
+
+	T_PoseMap::iterator itr = shard->poses.find(key);
+	if (itr == shard->poses.end())
+	{
+		pose = new SM2Pose(key, numBones, numMatrices, numGeosets);
+		shard->poses[key] = pose;
+		++shard->misses;
+		build = true;
+	}
+	else if (itr->second->Ready)
+	{
+		pose = itr->second;
+		ATOMIC_INCREMENT(&pose->Refs);
+		++shard->hits;
+	}
+
+	END_LOCK(&shard->cs);
+
+	return pose;
+}
+
+void CM2PoseCache::publish( SM2Pose* pose )
+{
+	SShard* shard = &Shards[SM2PoseKey_hash()(pose->Key) % NUM_SHARDS];
+
+	//֤߳̿Readyʱ̬д
+	BEGIN_LOCK(&shard->cs);
+	pose->Ready = true;
+	END_LOCK(&shard->cs);
+}
+
+void CM2PoseCache::beginFrame()
+{
+	u32 numPoses = 0;
+	u32 hits = 0;
+	u32 misses = 0;
+
+	//õ̬ٱ(ʱǰ)
+	for (u32 i=0; i<NUM_SHARDS; ++i)
+	{
+		SShard* shard = &Shards[i];
+
+		BEGIN_LOCK(&shard->cs);
+
+		for (T_PoseMap::iterator itr = shard->poses.begin(); itr != shard->poses.end();)
+		{
+			SM2Pose* pose = itr->second;
+			if (pose->Ready && ATOMIC_LOAD(&pose->Refs) == 0)
+			{
+				delete pose;
+				itr = shard->poses.erase(itr);
+			}
+			else
+			{
+				++itr;
+			}
+		}
+
+		numPoses += (u32)shard->poses.size();
+		hits += shard->hits;
+		misses += shard->misses;
+		shard->hits = 0;
+		shard->misses = 0;
+
+		END_LOCK(&shard->cs);
+	}
+
+	NumPoses = numPoses;
+	LastHits = hits;
+	LastMisses = misses;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "core.h"
+#include "SColor.h"
+#include "CSysSync.h"
+#include <unordered_map>
+
+class IFileM2;
+class CFileSkin;
+struct SDynBone;
+
+//ͬһm2, skin, , ֡, ɼ״̬ʵһ̬(, ɫ, ɫ, 任)
+struct SM2PoseKey
+{
+	const IFileM2*		mesh;
+	const CFileSkin*		skin;
+	u32		anim;
+	u32		time;
+	u32		lastingTime;
+	u32		stateHash;				//ɼgeoset, ҵ, ӵ״̬
+
+	bool operator==(const SM2PoseKey& other) const
+	{
+		return mesh == other.mesh &&
+			skin == other.skin &&
+			anim == other.anim &&
+			time == other.time &&
+			lastingTime == other.lastingTime &&
+			stateHash == other.stateHash;
+	}
+};
+
+struct SM2PoseKey_hash
+{
+	size_t operator()(const SM2PoseKey& _Keyval) const
+	{
+		return (size_t)CRC32_BlockChecksum(&_Keyval, sizeof(_Keyval));
+	}
+};
+
+struct SM2PoseGeoset
+{
+	matrix4		TextureMatrix;
+	SColor		emissive;
+	bool		NoAlpha;
+	bool		UseTextureAnim;
+};
+
+//ɺֻ
+struct SM2Pose
+{
+	SM2Pose(const SM2PoseKey& key, u32 numBones, u32 numMatrices, u32 numGeosets);
+	~SM2Pose();
+
+	SM2PoseKey		Key;
+	SDynBone*		Bones;
+	matrix4*		Palettes;				//geoset, bone unit˳, ƫƼSDynGeoset::SUnit::PaletteOffset
+	SM2PoseGeoset*		Geosets;
+	aabbox3df		AnimatedBox;
+
+	volatile int		Refs;
+	bool		Ready;
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(SM2Pose);
+};
+
+//tickʱ̲߳в, ÿ֡ʼʱõ̬
+class CM2PoseCache
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CM2PoseCache);
+
+public:
+	CM2PoseCache();
+	~CM2PoseCache();
+
+	static const u32 TIME_QUANTUM = 16;			//֡ʱλ, ͬһʵ̬
+
+public:
+	//ҵɵ̬ʱ+1, build = false
+	//ʱ̬(Ϊ1), build = true, ɵpublish
+	//߳ڹʱNULL_PTR, ߱֡˽·
+	SM2Pose* acquire(const SM2PoseKey& key, u32 numBones, u32 numMatrices, u32 numGeosets, bool& build);
+	void publish(SM2Pose* pose);
+	static void release(SM2Pose* pose) { ATOMIC_DECREMENT(&pose->Refs); }
+
+	//̵߳, tick֮ǰ, ʱͷŶm2
+	void beginFrame();
+
+	u32 getNumPoses() const { return NumPoses; }
+	u32 getLastHits() const { return LastHits; }
+	u32 getLastMisses() const { return LastMisses; }
+
+private:
+	enum
+	{
+		NUM_SHARDS = 16,
+	};
+
+	typedef std::unordered_map<SM2PoseKey, SM2Pose*, SM2PoseKey_hash> T_PoseMap;
+
+	struct SShard
+	{
+		lock_type	cs;
+		T_PoseMap	poses;
+		u32		hits;
+		u32		misses;
+	};
+
+	SShard		Shards[NUM_SHARDS];
+	u32		NumPoses;
+	u32		LastHits;
+	u32		LastMisses;
+};
@@ -11,11 +11,12 @@
 #include "wow_m2spell.h"
 #include "CSceneRenderServices.h"
 #include "CFileM2.h"
+#include "CM2PoseCache.h"
 
 CM2SceneNode::CM2SceneNode( IFileM2* mesh, ISceneNode* parent, bool npc )
 	: IM2SceneNode(parent), IsNpc(npc),
 	CurrentAnim(-1), TimeBlend(0), AnimTimeBlend(0),
-	CurrentCamera(-1), AnimateColors(true), Death(false), 
+	CurrentCamera(-1), AnimateColors(true), AnimatePending(false), Death(false), 
 	ModelAlpha(false), EnableFog(false), FrameInterval(0), WorldRadius(0.0f), Scale(1.0f)
 {
 	Mesh = static_cast<CFileM2*>(mesh);
@@ -110,6 +111,8 @@ aabbox3df CM2SceneNode::getBoundingBox() const
 
 void CM2SceneNode::tick( u32 timeSinceStart, u32 timeSinceLastFrame, bool visible )
 {
+	AnimatePending = false;
+
 	if(visible)
 		tickVisible(timeSinceStart, timeSinceLastFrame);
 	else
@@ -148,6 +151,7 @@ void CM2SceneNode::tickVisible( u32 timeSinceStart, u32 timeSinceLastFrame )
 {
 	s32 limit = -1;
 	f32 portion = 1.0f;
+	u32 boneLod = EBL_FINE;
 
 	f32 distance = Distance / WorldRadius;
 	f32 end = g_Engine->getSceneRenderServices()->getM2InvisibleTickDistance();
@@ -160,16 +164,25 @@ void CM2SceneNode::tickVisible( u32 timeSinceStart, u32 timeSinceLastFrame )
 		{
 			portion = clamp_(delta / (end - begin), 0.0f, 1.0f);
 			limit = (s32)(100 * portion);
+			boneLod = portion < 0.34f ? EBL_FINE : (portion < 0.67f ? EBL_MEDIUM : EBL_COARSE);
 		}
 		else
 		{
 			portion = 0.0f;
 			limit = 100;
+			boneLod = EBL_COARSE;
 		}
 	}
 
 	if (!checkFrameLimit(timeSinceLastFrame, limit))
 	{
+		//θֵֻ֮
+		if (limit > 0 && CurrentAnim != -1)
+		{
+			AnimateParam.interpolate = true;
+			AnimateParam.lerpAlpha = FrameInterval / (f32)limit;
+			AnimatePending = true;
+		}
 		return;
 	}
 
@@ -196,8 +209,37 @@ void CM2SceneNode::tickVisible( u32 timeSinceStart, u32 timeSinceLastFrame )
 	u32 lastingFrame = (u32)(timeSinceStart * Animation.getAnimationSpeed());
 	lastingFrame %= 38400;
 
+	//, , Ҽĸanimate, ͬһڵ㲢
+	AnimateParam.portion = portion;
+	AnimateParam.deltaFrame = deltaFrame;
+	AnimateParam.lastingFrame = lastingFrame;
+	AnimateParam.timeSinceLastFrame = timeSinceLastFrame;
+	AnimateParam.boneLod = boneLod;
+	AnimateParam.lerpAlpha = 0.0f;
+	AnimateParam.lerpBones = limit > 0;
+	AnimateParam.interpolate = false;
+	AnimatePending = true;
+}
+
+void CM2SceneNode::animate()
+{
+	if (!AnimatePending)
+		return;
+	AnimatePending = false;
+
+	f32 portion = AnimateParam.portion;
+	f32 deltaFrame = AnimateParam.deltaFrame;
+	u32 lastingFrame = AnimateParam.lastingFrame;
+	u32 timeSinceLastFrame = AnimateParam.timeSinceLastFrame;
+	bool interpolate = AnimateParam.interpolate;
+	bool sharedPose = false;
+
 	//
-	if (CurrentAnim != -1)
+	if (interpolate)
+	{
+		M2Instance->interpolateBones(AnimateParam.lerpAlpha);
+	}
+	else if (CurrentAnim != -1)
 	{
 		if ( fabs(deltaFrame) > 0.0f )			//ڲŶ
 		{
@@ -210,9 +252,21 @@ void CM2SceneNode::tickVisible( u32 timeSinceStart, u32 timeSinceLastFrame )
 				blend = 1.0f - AnimTimeBlend / (f32)TimeBlend;
 			}
 
-			M2Instance->animateColors(CurrentAnim, currentFrame);
+			M2Instance->setBoneLod(AnimateParam.boneLod);
+			M2Instance->setBoneInterpolation(AnimateParam.lerpBones);
+
+			sharedPose = canSharePose(blend);
+			if (sharedPose)			//ɫ, , Թ̬
+			{
+				CM2PoseCache* poseCache = static_cast<CSceneRenderServices*>(g_Engine->getSceneRenderServices())->getM2PoseCache();
+				M2Instance->animateShared(poseCache, CurrentAnim, currentFrame, lastingFrame);
+			}
+			else
+			{
+				M2Instance->animateColors(CurrentAnim, currentFrame);
 
-			M2Instance->animateBones(CurrentAnim, currentFrame, lastingFrame, blend);
+				M2Instance->animateBones(CurrentAnim, currentFrame, lastingFrame, blend);
+			}
 
 			for (T_ParticleSystemNodes::const_iterator i=ParticleSystemNodes.begin(); i != ParticleSystemNodes.end(); ++i)
 			{
@@ -261,7 +315,8 @@ void CM2SceneNode::tickVisible( u32 timeSinceStart, u32 timeSinceLastFrame )
 	}
 
 	//anim texture
-	M2Instance->animateTextures(0, lastingFrame);
+	if (!sharedPose && !interpolate)
+		M2Instance->animateTextures(0, lastingFrame);
 
 	// Attachmentλ
 	for (T_AttachmentList::iterator itr = AttachmentList.begin(); itr != AttachmentList.end(); ++itr)
@@ -1112,6 +1167,17 @@ void CM2SceneNode::setModelColor( bool enable, SColor color )
 	}
 }
 
+bool CM2SceneNode::canSharePose( f32 blend ) const
+{
+	//ɫ, , йҼЧʵ״̬, ˽·
+	//ƵֵʵDynBonesǲֵǱ֡ʱ̬, ܰ֡key
+	return blend >= 1.0f &&
+		!AnimateParam.lerpBones &&
+		!M2Instance->CharacterInfo &&
+		AttachmentList.empty() &&
+		SpellEffectList.empty();
+}
+
 bool CM2SceneNode::checkFrameLimit( u32& timeSinceLastFrame, s32 limit )
 {
 	if (limit <= -1)
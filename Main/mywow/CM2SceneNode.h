@@ -63,6 +63,8 @@ public:
 	virtual void registerSceneNode(bool frustumcheck, int sequence);
 	virtual aabbox3df getBoundingBox() const;
 	virtual void tick(u32 timeSinceStart, u32 timeSinceLastFrame, bool visible);
+	virtual bool needAnimate() const { return AnimatePending; }
+	virtual void animate();
 	virtual void render() const;
 	virtual bool isNodeEligible() const;
 	virtual void onUpdated();
@@ -79,6 +81,7 @@ protected:
 	void updateRightCloseHand(bool sheath);
 
 	bool checkFrameLimit(u32& timeSinceLastFrame, s32 limit);
+	bool canSharePose(f32 blend) const;
 
 	void tickInvisible(u32 timeSinceStart, u32 timeSinceLastFrame);
 	void tickVisible(u32 timeSinceStart, u32 timeSinceLastFrame);
@@ -103,6 +106,20 @@ protected:
 	wow_m2spell* M2Spell;
 
 	aabbox3df		AnimatedWorldAABB;
+
+	//tickVisible¼, animateʹ
+	struct SAnimateParam
+	{
+		f32		portion;
+		f32		deltaFrame;
+		u32		lastingFrame;
+		u32		timeSinceLastFrame;
+		u32		boneLod;
+		f32		lerpAlpha;
+		bool		lerpBones;				//Ƶʱθֵ֮
+		bool		interpolate;				//֡, ֵֻ
+	};
+	SAnimateParam	AnimateParam;
 	aabbox3df	WorldBoundingAABox;
 	aabbox3df	WorldCollisionAABox;
 
@@ -135,6 +152,7 @@ protected:
 
 	bool	IsNpc;
 	bool AnimateColors;
+	bool AnimatePending;
 	bool Death;
 	bool ModelAlpha;
 	bool EnableFog;
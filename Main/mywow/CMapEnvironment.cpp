@@ -93,11 +93,11 @@ void CMapEnvironment::initSkyLights()
 	/*
 	const lightDB* db = g_Engine->getWowDatabase()->getLightDB();
 
-	for (u32 i=0; i<db->getNumRecords(); ++i)
+	const u32* rows;
+	u32 count = db->findRows(lightDB::Map, (u32)MapId, rows);
+	for (u32 i=0; i<count; ++i)
 	{
-		dbc::record r = db->getRecord(i);
-		if (MapId != r.getInt(lightDB::Map))
-			continue;
+		dbc::record r = db->getRecord(rows[i]);
 			
 		SSkyLight* light = new SSkyLight;
 		//position
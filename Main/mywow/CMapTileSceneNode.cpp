@@ -326,6 +326,8 @@ void CMapTileSceneNode::onUpdated()
 			AbsoluteTransformation.transformBox(dynChunk->terrianWorldBox);
 		}
 	}
+
+	g_Engine->getCollisionServices()->addTile(adt, AbsoluteTransformation);
 }
 
 void CMapTileSceneNode::startLoadingM2SceneNodes()
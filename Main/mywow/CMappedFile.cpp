@@ -0,0 +1,177 @@
+#include "stdafx.h"
+#include "CMappedFile.h"
+
+#ifndef MW_PLATFORM_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef MW_PLATFORM_WINDOWS
+
+//PrefetchVirtualMemorywin8ϲ, ʱȡַ
+struct SMemoryRangeEntry
+{
+	PVOID	VirtualAddress;
+	SIZE_T	NumberOfBytes;
+};
+
+typedef BOOL (WINAPI *PREFETCHVIRTUALMEMORY)(HANDLE hProcess, ULONG_PTR NumberOfEntries, SMemoryRangeEntry* VirtualAddresses, ULONG Flags);
+
+static PREFETCHVIRTUALMEMORY getPrefetchVirtualMemory()
+{
+	static PREFETCHVIRTUALMEMORY func = (PREFETCHVIRTUALMEMORY)GetProcAddress(GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+	return func;
+}
+
+#endif
+
+CMappedFile::CMappedFile( const c8* fname, const c8* name )
+	: buffer(NULL_PTR), pointer(0), size(0), eof(true)
+{
+	Q_strcpy(filename, QMAX_PATH, name);
+
+#ifdef MW_PLATFORM_WINDOWS
+	HANDLE hFile = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL_PTR, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL_PTR);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.HighPart != 0 || fileSize.LowPart == 0)
+	{
+		CloseHandle(hFile);
+		return;
+	}
+
+	//дʱ, newĻһԸд
+	HANDLE hMapping = CreateFileMappingA(hFile, NULL_PTR, PAGE_WRITECOPY, 0, 0, NULL_PTR);
+	if (hMapping)
+	{
+		buffer = (u8*)MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(hMapping);				//ӳͼ, ȹ
+	}
+	CloseHandle(hFile);
+
+	if (!buffer)
+		return;
+
+	size = fileSize.LowPart;
+#else
+	int fd = open(fname, O_RDONLY);
+	if (fd == -1)
+		return;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || (u64)st.st_size > 0xffffffff)
+	{
+		::close(fd);
+		return;
+	}
+
+	void* p = mmap(NULL_PTR, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (p == MAP_FAILED)
+		return;
+
+	buffer = (u8*)p;
+	size = (u32)st.st_size;
+
+	madvise(buffer, size, MADV_SEQUENTIAL);
+#endif
+
+	eof = false;
+
+	//ͷ, ϵͳǰ
+	prefetch(0, min_(size, (u32)READAHEAD_LIMIT));
+}
+
+u32 CMappedFile::read( void* dest, u32 bytes )
+{
+	if (eof) 
+		return 0;
+
+	size_t rpos = pointer + bytes;
+	if (rpos > size) {
+		bytes = size - pointer;
+		eof = true;
+	}
+
+	memcpy(dest, &(buffer[pointer]), bytes);
+
+	pointer = (u32)rpos;
+
+	return bytes;
+}
+
+bool CMappedFile::seek( s32 offset, bool relative )
+{
+	if (relative)
+		pointer += offset;
+	else
+		pointer = offset;
+	eof = (pointer >= size);
+	return !eof;
+}
+
+void CMappedFile::close()
+{
+	if (buffer)
+	{
+#ifdef MW_PLATFORM_WINDOWS
+		UnmapViewOfFile(buffer);
+#else
+		munmap(buffer, size);
+#endif
+	}
+	buffer = NULL_PTR;
+
+	eof = true;
+}
+
+void CMappedFile::prefetch( u32 offset, u32 bytes )
+{
+	if (!buffer || offset >= size)
+		return;
+
+	bytes = min_(bytes, size - offset);
+	if (bytes == 0)
+		return;
+
+#ifdef MW_PLATFORM_WINDOWS
+	PREFETCHVIRTUALMEMORY func = getPrefetchVirtualMemory();
+	if (func)
+	{
+		SMemoryRangeEntry entry;
+		entry.VirtualAddress = buffer + offset;
+		entry.NumberOfBytes = bytes;
+		func(GetCurrentProcess(), 1, &entry, 0);
+	}
+#else
+	//madviseҪҳ
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t begin = (size_t)offset / pageSize * pageSize;
+	madvise(buffer + begin, (size_t)offset + bytes - begin, MADV_WILLNEED);
+#endif
+}
+
+bool CMappedFile::save( const c8* filename )
+{
+	c8 realfilename[QMAX_PATH];
+	normalizeFileName(filename, realfilename, QMAX_PATH);
+
+	if (!Q_MakeDirForFileName(realfilename))
+		return false;
+	
+	FILE* file = Q_fopen(realfilename, "wb");
+	if (file != NULL_PTR)
+	{
+		fwrite(buffer, 1, size, file);
+		fclose(file);
+		return true;
+	}
+	else
+	{
+		ASSERT(false);
+		return false;
+	}
+}
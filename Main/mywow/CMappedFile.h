@@ -0,0 +1,48 @@
+#pragma once
+
+#include "IMemFile.h"
+#include "function.h"
+
+//ѴϵļӳΪIMemFile, ʱֱӳڴ϶, freadʱڴ
+//ӳΪдʱ, д岻дļ; getBufferڶɾǰһֱЧ
+class CMappedFile : public IMemFile
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CMappedFile);
+
+public:
+	//filenameǴ·, namegetFileNameص(Դ·)
+	CMappedFile(const c8* filename, const c8* name);
+	~CMappedFile()
+	{
+		close();
+	}
+
+	bool		isValid() const { return buffer != NULL_PTR; }
+
+	u32		read(void* dest, u32 bytes);
+	u32		getSize() const { return size; }
+	u32		getPos() const { return pointer; }
+	u8*		getBuffer() { return buffer; }
+	u8*		getPointer() { return buffer + pointer; }
+	bool		isEof() const { return eof; }
+	bool		seek(s32 offset, bool relative=false);
+	void		close();
+	bool		save(const c8* filename);
+	const c8*	getFileName() const { return filename; }
+
+	//ʾϵͳԤ[offset, offset+bytes)
+	void		prefetch(u32 offset, u32 bytes);
+
+private:
+	enum
+	{
+		READAHEAD_LIMIT = 16 * 1024 * 1024,			//ʱֻԤͷ
+	};
+
+	u8*		buffer;
+	u32		pointer;
+	u32		size;
+	c8		filename[QMAX_PATH];
+	bool eof;
+};
@@ -70,4 +70,5 @@ private:
 	friend class CD3D11Driver;
 	friend class COpenGLDriver;
 	friend class CGLES2Driver;
+	friend class CNullDriver;
 };
\ No newline at end of file
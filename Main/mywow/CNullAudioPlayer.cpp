@@ -0,0 +1,148 @@
+#include "stdafx.h"
+#include "CNullAudioPlayer.h"
+#include "mywow.h"
+#include "CNullSound.h"
+#include "CAudioDecodeServices.h"
+#include "CAudioMixer.h"
+
+#ifdef MW_PLATFORM_WINDOWS
+
+CNullAudioPlayer::CNullAudioPlayer( u32 outputSampleRate, u32 cacheLimit, u32 maxClipSize )
+{
+	DecodeServices = new CAudioDecodeServices(cacheLimit, maxClipSize);
+	Mixer = new CAudioMixer(outputSampleRate);
+
+	for (u32 i=0; i<NUM_WAV_SOUNDS; ++i)
+		WavSounds[i] = new CNullSound(this, EST_WAV, i);
+
+	for (u32 i=0; i<NUM_OGG_SOUNDS; ++i)
+		OggSounds[i] = new CNullSound(this, EST_OGG, i);
+
+	for (u32 i=0; i<NUM_MP3_SOUNDS; ++i)
+		Mp3Sounds[i] = new CNullSound(this, EST_MP3, i);
+
+	Setting.global = true;
+	Setting.hardware = false;
+}
+
+CNullAudioPlayer::~CNullAudioPlayer()
+{
+	for (u32 i=0; i<NUM_WAV_SOUNDS; ++i) delete WavSounds[i];
+	for (u32 i=0; i<NUM_OGG_SOUNDS; ++i) delete OggSounds[i];
+	for (u32 i=0; i<NUM_MP3_SOUNDS; ++i) delete Mp3Sounds[i];
+
+	delete Mixer;
+	delete DecodeServices;
+}
+
+ISound* CNullAudioPlayer::getEmptySound( CNullSound* const* sounds, u32 count ) const
+{
+	for (u32 i=0; i<count; ++i)
+	{
+		if (!sounds[i]->isPlaying())
+			return sounds[i];
+	}
+	return NULL_PTR;
+}
+
+ISound* CNullAudioPlayer::getEmptyWavSound() const
+{
+	return getEmptySound(WavSounds, NUM_WAV_SOUNDS);
+}
+
+ISound* CNullAudioPlayer::getEmptyOggSound() const
+{
+	return getEmptySound(OggSounds, NUM_OGG_SOUNDS);
+}
+
+ISound* CNullAudioPlayer::getEmptyMp3Sound() const
+{
+	return getEmptySound(Mp3Sounds, NUM_MP3_SOUNDS);
+}
+
+ISound* CNullAudioPlayer::getWavSound( u32 index ) const
+{
+	if (index >= NUM_WAV_SOUNDS)
+		return NULL_PTR;
+	return WavSounds[index];
+}
+
+ISound* CNullAudioPlayer::getOggSound( u32 index ) const
+{
+	if (index >= NUM_OGG_SOUNDS)
+		return NULL_PTR;
+	return OggSounds[index];
+}
+
+ISound* CNullAudioPlayer::getMp3Sound( u32 index ) const
+{
+	if (index >= NUM_MP3_SOUNDS)
+		return NULL_PTR;
+	return Mp3Sounds[index];
+}
+
+void CNullAudioPlayer::fadeoutSound( ISound* sound, u32 fadetime )
+{
+	if (!sound->isPlaying())
+		return;
+
+	for (T_FadeoutList::const_iterator itr = FadeoutList.begin(); itr != FadeoutList.end(); ++itr)
+	{
+		if (itr->sound == sound)
+			return;
+	}
+
+	SEntry entry;
+	entry.sound = sound;
+	entry.fadetime = fadetime;
+	FadeoutList.emplace_back(entry);
+}
+
+void CNullAudioPlayer::tickFadeOutSounds( u32 timeSinceLastFrame )
+{
+	for (T_FadeoutList::iterator itr = FadeoutList.begin(); itr != FadeoutList.end();)
+	{
+		if(itr->fadetime > timeSinceLastFrame && itr->sound->isPlaying())
+		{
+			f32 time = (f32)itr->fadetime;
+			itr->fadetime -= timeSinceLastFrame;
+			f32 vol = itr->sound->getVolume() * (itr->fadetime / time);
+			itr->sound->setVolume(vol);
+			++itr;
+		}
+		else
+		{
+			itr->sound->stop();
+			itr = FadeoutList.erase(itr);
+		}
+	}
+}
+
+u32 CNullAudioPlayer::render( u32 numFrames, s16* output )
+{
+	if (!output)
+	{
+		if (DiscardBuffer.size() < numFrames * 2)
+			DiscardBuffer.resize(numFrames * 2);
+		output = &DiscardBuffer[0];
+	}
+
+	u32 active = Mixer->mix(output, numFrames);
+
+	//ص, playͬһ߳
+	CNullSound** groups[] = { WavSounds, OggSounds, Mp3Sounds };
+	const u32 counts[] = { NUM_WAV_SOUNDS, NUM_OGG_SOUNDS, NUM_MP3_SOUNDS };
+	for (u32 g=0; g<3; ++g)
+	{
+		for (u32 i=0; i<counts[g]; ++i)
+		{
+			CNullSound* sound = groups[g][i];
+			if (sound->Voice >= 0 && !Mixer->isVoiceActive((u32)sound->Voice))
+				sound->onVoiceEnded();
+		}
+	}
+
+	return active;
+}
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "IAudioPlayer.h"
+#include <list>
+#include <vector>
+
+#ifdef MW_PLATFORM_WINDOWS
+
+class CNullSound;
+class CAudioDecodeServices;
+class CAudioMixer;
+
+//û豸Ĳ, ͻͬ, renderȡ߻
+//ûĻͽܲ, нӿͬһ̵߳
+class CNullAudioPlayer : public IAudioPlayer
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CNullAudioPlayer);
+
+public:
+	CNullAudioPlayer(u32 outputSampleRate, u32 cacheLimit, u32 maxClipSize);
+	~CNullAudioPlayer();
+
+public:
+	virtual ISound* getEmptyWavSound() const;
+	virtual ISound* getEmptyOggSound() const;
+	virtual ISound* getEmptyMp3Sound() const;
+
+	virtual ISound* getWavSound(u32 index) const;
+	virtual ISound* getOggSound(u32 index) const;
+	virtual ISound* getMp3Sound(u32 index) const;
+
+	virtual void setAudioSetting(const SAudioSetting& setting) { Setting = setting; }
+	virtual const SAudioSetting& getAudioSetting() const { return Setting; }
+
+	virtual void fadeoutSound(ISound* sound, u32 fadetime);
+	virtual void tickFadeOutSounds(u32 timeSinceLastFrame);
+
+	//numFrames֡16λ, outputΪNULL_PTRʱ, ڲŵ
+	u32 render(u32 numFrames, s16* output = NULL_PTR);
+
+	CAudioDecodeServices* getDecodeServices() const { return DecodeServices; }
+	CAudioMixer* getMixer() const { return Mixer; }
+
+private:
+	ISound* getEmptySound(CNullSound* const* sounds, u32 count) const;
+
+private:
+	CAudioDecodeServices*		DecodeServices;
+	CAudioMixer*		Mixer;
+
+	CNullSound*	WavSounds[NUM_WAV_SOUNDS];
+	CNullSound*	OggSounds[NUM_OGG_SOUNDS];
+	CNullSound*	Mp3Sounds[NUM_MP3_SOUNDS];
+
+	SAudioSetting	Setting;
+
+	struct SEntry
+	{
+		ISound*	sound;
+		u32 fadetime;
+	};
+
+	typedef std::list<SEntry, qzone_allocator<SEntry> >	T_FadeoutList;
+	T_FadeoutList		FadeoutList;
+
+	std::vector<s16>		DiscardBuffer;
+};
+
+#endif
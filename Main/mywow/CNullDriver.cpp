@@ -0,0 +1,360 @@
+#include "stdafx.h"
+#include "CNullDriver.h"
+#include "mywow.h"
+
+#include "CNullShaderServices.h"
+#include "CNullMaterialRenderServices.h"
+#include "CNullSceneStateServices.h"
+
+CNullDriver::CNullDriver()
+{
+	CurrentRenderMode = ERM_NONE;
+	ResetRenderStates = true;
+	CurrentRenderTarget = NULL_PTR;
+	FrameCount = 0;
+
+	ShaderServices = NULL_PTR;
+	MaterialRenderServices = NULL_PTR;
+	SceneStateServices = NULL_PTR;
+	NullShaderServices = NULL_PTR;
+	NullMaterialRenderServices = NULL_PTR;
+	NullSceneStateServices = NULL_PTR;
+
+	//2D
+	InitMaterial2D.MaterialType = EMT_2D;
+	InitMaterial2D.Cull = ECM_BACK;
+	InitMaterial2D.Lighting = false;
+	InitMaterial2D.ZWriteEnable = false;
+	InitMaterial2D.ZBuffer = ECFN_NEVER;
+	InitMaterial2D.AntiAliasing = EAAM_LINE_SMOOTH;
+	for (u32 i=0; i<MATERIAL_MAX_TEXTURES; ++i)
+	{
+		InitMaterial2D.TextureLayer[i].TextureWrapU=ETC_CLAMP;
+		InitMaterial2D.TextureLayer[i].TextureWrapV=ETC_CLAMP;
+		InitMaterial2D.TextureLayer[i].UseTextureMatrix = false;
+
+		InitOverrideMaterial2D.TextureFilters[i] = ETF_NONE;
+	}
+	InitMaterial2DZTest = InitMaterial2D;
+	InitMaterial2DZTest.ZBuffer = ECFN_LESSEQUAL;
+	InitMaterial2DScissorTest = InitMaterial2D;
+	InitMaterial2DScissorTest.ScissorEnable = true;
+	InitMaterial2DScissorZTest = InitMaterial2D;
+	InitMaterial2DScissorZTest.ScissorEnable = true;
+	InitMaterial2DScissorZTest.ZBuffer = ECFN_LESSEQUAL;
+
+	memset(DebugMsg, 0, sizeof(DebugMsg));
+}
+
+CNullDriver::~CNullDriver()
+{
+	delete		SceneStateServices;
+	delete		MaterialRenderServices;
+	delete		ShaderServices;
+}
+
+bool CNullDriver::initDriver( const SWindowInfo& wndInfo, u32 adapter, bool fullscreen, bool vsync, u8 antialias, bool multithread )
+{
+	g_Engine->getFileSystem()->writeLog(ELOG_GX, "Device Type: Null");
+
+	DriverSetting.vsync = vsync;
+	DriverSetting.fullscreen = fullscreen;
+	DriverSetting.antialias = antialias;
+	DriverSetting.quality = 0;
+
+	//shader, material
+	ShaderServices =
+	NullShaderServices = new CNullShaderServices;
+
+	MaterialRenderServices =
+	NullMaterialRenderServices = new CNullMaterialRenderServices;
+
+	SceneStateServices =
+	NullSceneStateServices = new CNullSceneStateServices;
+
+	setDisplayMode(dimension2du(wndInfo.width, wndInfo.height));
+
+	return true;
+}
+
+bool CNullDriver::beginScene()
+{
+	return true;
+}
+
+bool CNullDriver::endScene()
+{
+	FrameStats = CurrentStats;
+	CurrentStats.reset();
+	++FrameCount;
+
+	return true;
+}
+
+bool CNullDriver::clear( bool renderTarget, bool zBuffer, bool stencil, SColor color )
+{
+	return true;
+}
+
+void CNullDriver::setTransform( E_TRANSFORMATION_STATE state, const matrix4& mat )
+{
+	ASSERT( 0 <= state && state < ETS_COUNT );
+	switch( state )
+	{
+	case ETS_VIEW:
+	case ETS_WORLD:
+		{
+			Matrices[state] = mat;
+
+			WV = Matrices[ETS_WORLD] * Matrices[ETS_VIEW];
+			WVP = WV * Matrices[ETS_PROJECTION];
+
+			CurrentRenderMode = ERM_3D;
+		}
+		break;
+	case ETS_PROJECTION:
+		{
+			Matrices[ETS_PROJECTION] = mat;
+
+			WVP = WV * Matrices[ETS_PROJECTION];
+
+			CurrentRenderMode = ERM_3D;
+		}
+		break;
+	default:		//texture
+		{
+			s32 tex = state - ETS_TEXTURE_0;
+			if (  tex >= 0  && tex < MATERIAL_MAX_TEXTURES )
+			{
+				Matrices[state] = mat;
+			}
+		}
+		break;
+	}
+}
+
+void CNullDriver::setTexture( u32 stage, ITexture* texture )
+{
+	if (NullMaterialRenderServices->setSampler_Texture(stage, texture))
+		++CurrentStats.textureChanges;
+}
+
+ITexture* CNullDriver::getTexture( u32 index ) const
+{
+	return NullMaterialRenderServices->getSampler_Texture(index);
+}
+
+void CNullDriver::setTransform( const matrix4& matView, const matrix4& matProjection )
+{
+	Matrices[ETS_VIEW] = matView;
+	Matrices[ETS_PROJECTION] = matProjection;
+
+	WV = Matrices[ETS_WORLD] * Matrices[ETS_VIEW];
+	WVP = WV * Matrices[ETS_PROJECTION];
+
+	CurrentRenderMode = ERM_3D;
+}
+
+void CNullDriver::setTransform_Material_Textures( const matrix4& matWorld, const SMaterial& material, ITexture* const textures[], u32 numTextures )
+{
+	Matrices[ETS_WORLD] = matWorld;
+
+	WV = Matrices[ETS_WORLD] * Matrices[ETS_VIEW];
+	WVP = WV * Matrices[ETS_PROJECTION];
+
+	CurrentRenderMode = ERM_3D;
+
+	Material = material;
+
+	u32 n = min_(numTextures, (u32)MATERIAL_MAX_TEXTURES);
+	for (u32 i=0; i<n; ++i)
+	{
+		setTexture(i, textures[i]);
+	}
+}
+
+void CNullDriver::setTransform_Material_Textures( const matrix4& matWorld, const matrix4& matView, const matrix4& matProjection, const SMaterial& material, ITexture* const textures[], u32 numTextures )
+{
+	Matrices[ETS_WORLD] = matWorld;
+	Matrices[ETS_VIEW] = matView;
+	Matrices[ETS_PROJECTION] = matProjection;
+
+	WV = Matrices[ETS_WORLD] * Matrices[ETS_VIEW];
+	WVP = WV * Matrices[ETS_PROJECTION];
+
+	CurrentRenderMode = ERM_3D;
+
+	Material = material;
+
+	u32 n = min_(numTextures, (u32)MATERIAL_MAX_TEXTURES);
+	for (u32 i=0; i<n; ++i)
+	{
+		setTexture(i, textures[i]);
+	}
+}
+
+bool CNullDriver::setRenderTarget( IRenderTarget* texture )
+{
+	if (CurrentRenderTarget != texture)
+	{
+		++CurrentStats.renderTargetChanges;
+		CurrentRenderTarget = texture;
+	}
+
+	return true;
+}
+
+void CNullDriver::setViewPort( recti area )
+{
+	recti vp = area;
+	vp.clipAgainst(recti(0,0,ScreenSize.Width,ScreenSize.Height));
+	if ( vp.getWidth() <= 0 || vp.getHeight() <= 0 )
+		return;
+
+	Viewport = vp;
+}
+
+void CNullDriver::registerLostReset( ILostResetCallback* callback )
+{
+	if (std::find(LostResetList.begin(), LostResetList.end(), callback) == LostResetList.end())
+	{
+		LostResetList.push_back(callback);
+	}
+}
+
+void CNullDriver::removeLostReset( ILostResetCallback* callback )
+{
+	LostResetList.remove(callback);
+}
+
+bool CNullDriver::reset()
+{
+	for( T_LostResetList::const_iterator itr=LostResetList.begin(); itr != LostResetList.end(); ++itr )
+		(*itr)->onLost();
+
+	for( T_LostResetList::const_iterator itr=LostResetList.begin(); itr != LostResetList.end(); ++itr )
+		(*itr)->onReset();
+
+	//reset
+	LastMaterial.MaterialType = (E_MATERIAL_TYPE)-1;
+	ResetRenderStates = true;
+	CurrentRenderMode = ERM_NONE;
+
+	NullMaterialRenderServices->resetSamplers();
+	NullSceneStateServices->reset();
+
+	g_Engine->getFileSystem()->writeLog(ELOG_GX, "reset... Device Format: %dX%d, Null", ScreenSize.Width, ScreenSize.Height);
+
+	return true;
+}
+
+void CNullDriver::setDisplayMode( const dimension2du& size )
+{
+	ScreenSize = size;
+
+	reset();
+
+	setViewPort(recti(0,0,ScreenSize.Width, ScreenSize.Height));
+}
+
+bool CNullDriver::setDriverSetting( const SDriverSetting& setting )
+{
+	DriverSetting = setting;
+	return true;
+}
+
+void CNullDriver::setRenderState3DMode( E_VERTEX_TYPE vType )
+{
+	CurrentRenderMode = ERM_3D;
+
+	if (ResetRenderStates || LastMaterial != Material )
+	{
+		LastMaterial = Material;
+		++CurrentStats.materialChanges;
+	}
+
+	ResetRenderStates = false;
+}
+
+void CNullDriver::setRenderState2DMode( E_VERTEX_TYPE vType, const S2DBlendParam& blendParam )
+{
+	if ( CurrentRenderMode != ERM_2D )
+	{
+		matrix4 matView(true);
+		matView.setTranslation(vector3df(-0.5f,-0.5f,0));
+
+		matrix4 matProject(true);
+		const dimension2du& renderTargetSize = ScreenSize;
+		matProject.buildProjectionMatrixOrthoLH(f32(renderTargetSize.Width), f32(-(s32)(renderTargetSize.Height)), -1.0, 1.0);
+		matProject.setTranslation(vector3df(-1,1,0));
+
+		Matrices[ETS_WORLD] = matrix4::Identity();
+		Matrices[ETS_VIEW] = matView;
+		Matrices[ETS_PROJECTION] = matProject;
+
+		WV = Matrices[ETS_WORLD] * Matrices[ETS_VIEW];
+		WVP = WV * Matrices[ETS_PROJECTION];
+
+		CurrentRenderMode = ERM_2D;
+	}
+
+	if (ResetRenderStates || LastMaterial != InitMaterial2D || Last2DBlendParam != blendParam)
+	{
+		LastMaterial = InitMaterial2D;
+		Last2DBlendParam = blendParam;
+		++CurrentStats.materialChanges;
+	}
+
+	ResetRenderStates = false;
+}
+
+void CNullDriver::draw3DMode( const SBufferParam& bufferParam, E_PRIMITIVE_TYPE primType, u32 primCount, const SDrawParam& drawParam )
+{
+	setRenderState3DMode(bufferParam.vType);
+
+	drawIndexedPrimitive(bufferParam, primType, primCount, drawParam);
+}
+
+void CNullDriver::draw2DMode( const SBufferParam& bufferParam, E_PRIMITIVE_TYPE primType, u32 primCount, const SDrawParam& drawParam, const S2DBlendParam& blendParam, bool zTest )
+{
+	setRenderState2DMode(bufferParam.vType, blendParam);
+
+	drawIndexedPrimitive(bufferParam, primType, primCount, drawParam);
+}
+
+void CNullDriver::drawIndexedPrimitive( const SBufferParam& bufferParam, E_PRIMITIVE_TYPE primType, u32 primCount, const SDrawParam& drawParam )
+{
+	if (!drawParam.numVertices || drawParam.numVertices >= 65536 || !primCount)
+	{
+		IFileSystem* fs = g_Engine->getFileSystem();
+		fs->writeLog(ELOG_GX, "CNullDriver::drawIndexedPrimitive Failed: param invalid!");
+		ASSERT(false);
+		return;
+	}
+
+	if (primType == EPT_TRIANGLES || primType == EPT_TRIANGLE_STRIP)
+	{
+		CurrentStats.primitivesDrawn += primCount;
+	}
+
+	++CurrentStats.drawCall;
+}
+
+void CNullDriver::drawDebugInfo( const c8* strMsg )
+{
+	vector2di pos = vector2di(5,5);
+
+	f32 fps = g_Engine->getSceneManager()->getFPS();
+
+	Q_sprintf(DebugMsg, 512, "Dev: Null\nRes: %d X %d\nFPS: %0.1f\nTriangles: %d\nDraw Call: %d\nState Changes: %d\nUploaded: %d KB\n",
+		Viewport.getWidth(), Viewport.getHeight(),
+		fps,
+		(s32)FrameStats.primitivesDrawn,
+		(s32)FrameStats.drawCall,
+		(s32)FrameStats.getStateChanges(),
+		(s32)(FrameStats.getBytesUploaded() / 1024));
+
+	Q_strcat(DebugMsg, 512, strMsg);
+
+	g_Engine->getDefaultFont()->drawA(DebugMsg, SColor(0, 255, 0), pos);
+}
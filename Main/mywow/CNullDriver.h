@@ -0,0 +1,151 @@
+#pragma once
+
+#include "IVideoDriver.h"
+
+class CNullSceneStateServices;
+class CNullShaderServices;
+class CNullMaterialRenderServices;
+
+struct SWindowInfo;
+
+//ÿ֡ύͳ, endSceneΪ߽֡, ֡ԴʱϴҲ
+struct SNullDriverStats
+{
+	SNullDriverStats() { reset(); }
+
+	void reset() { memset(this, 0, sizeof(SNullDriverStats)); }
+
+	u32 getStateChanges() const { return materialChanges + textureChanges + renderTargetChanges; }
+	u32 getBytesUploaded() const { return bufferBytesUploaded + textureBytesUploaded; }
+
+	u32		drawCall;
+	u32		primitivesDrawn;
+	u32		materialChanges;
+	u32		textureChanges;
+	u32		renderTargetChanges;
+	u32		bufferBytesUploaded;
+	u32		textureBytesUploaded;
+};
+
+//gpuĿ, buffer, texturedraw callֻͳ
+//ԿĻϲԳ, üȾcpu˿
+class CNullDriver : public IVideoDriver
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CNullDriver);
+
+public:
+	CNullDriver();
+	virtual ~CNullDriver();
+
+public:
+	bool initDriver(const SWindowInfo& wndInfo, u32 adapter, bool fullscreen, bool vsync, u8 antialias, bool multithread);
+
+public:
+	virtual E_DRIVER_TYPE getDriverType() const { return EDT_NULL; }
+	virtual u32 getAdapterCount() const { return 1; }
+
+	virtual bool beginScene();
+	virtual bool endScene();
+	virtual bool clear(bool renderTarget, bool zBuffer, bool stencil, SColor color);
+
+	virtual bool checkValid() { return true; }
+	virtual bool setRenderTarget( IRenderTarget* texture );
+
+	virtual void setTransform( E_TRANSFORMATION_STATE state, const matrix4& mat );
+	virtual void setViewPort( recti area );
+	virtual void setDisplayMode(const dimension2du& size);
+	virtual bool setDriverSetting(const SDriverSetting& setting);
+
+	virtual void drawDebugInfo(const c8* strMsg);
+
+	//helper functions
+	virtual void helper_render(CMeshRenderer* meshRenderer, const SRenderUnit*& currentUnit,  ICamera* cam);
+	virtual void helper_render(CTerrainRenderer* terrainRenderer, const SRenderUnit*& currentUnit,  ICamera* cam);
+	virtual void helper_render(CTransluscentRenderer* transluscentRenderer, const SRenderUnit*& currentUnit,  ICamera* cam);
+	virtual void helper_render(CWmoRenderer* wmoRenderer, const SRenderUnit*& currentUnit, ICamera* cam);
+	virtual void helper_render(CAlphaTestMeshRenderer* meshRenderer, const SRenderUnit*& currentUnit, ICamera* cam);
+	virtual void helper_render(CAlphaTestWmoRenderer* wmoRenderer, const SRenderUnit*& currentUnit, ICamera* cam);
+	virtual void helper_renderAllBatches(CParticleRenderer* particleRenderer, const SRenderUnit*& currentUnit,  ICamera* cam);
+	virtual void helper_renderAllBatches(CRibbonRenderer* ribbonRenderer, const SRenderUnit*& currentUnit,  ICamera* cam);
+	virtual void helper_renderAllBatches(CMeshDecalRenderer* meshDecalRenderer, const SRenderUnit*& currentUnit, ICamera* cam);
+	virtual void helper_renderAllBatches(CTransluscentDecalRenderer* transDecalRenderer, const SRenderUnit*& currentUnit, ICamera* cam);
+	virtual void helper_renderAllBatches(CAlphaTestDecalRenderer* meshDecalRenderer, const SRenderUnit*& currentUnit, ICamera* cam);
+
+public:
+	bool queryFeature(E_VIDEO_DRIVER_FEATURE feature) const { return true; }
+
+	void setTexture(u32 stage, ITexture* texture);
+	ITexture* getTexture(u32 index) const;
+	void registerLostReset( ILostResetCallback* callback );
+	void removeLostReset( ILostResetCallback* callback );
+
+	void draw3DMode( const SBufferParam& bufferParam,
+		E_PRIMITIVE_TYPE primType,
+		u32 primCount,
+		const SDrawParam& drawParam);
+
+	void draw2DMode( const SBufferParam& bufferParam,
+		E_PRIMITIVE_TYPE primType,
+		u32 primCount,
+		const SDrawParam& drawParam,
+		const S2DBlendParam& blendParam,
+		bool zTest = false);
+
+	void setTransform(const matrix4& matView, const matrix4& matProjection);
+
+	void setTransform_Material_Textures(const matrix4& matWorld,
+		const SMaterial& material,
+		ITexture* const textures[],
+		u32 numTextures);
+
+	void setTransform_Material_Textures(const matrix4& matWorld,
+		const matrix4& matView,
+		const matrix4& matProjection,
+		const SMaterial& material,
+		ITexture* const textures[],
+		u32 numTextures);
+
+public:
+	//ͳ
+	const SNullDriverStats& getFrameStats() const { return FrameStats; }			//һ֡
+	const SNullDriverStats& getCurrentStats() const { return CurrentStats; }
+	u32 getFrameCount() const { return FrameCount; }
+
+	void addBufferUpload(u32 bytes) { CurrentStats.bufferBytesUploaded += bytes; }
+	void addTextureUpload(u32 bytes) { CurrentStats.textureBytesUploaded += bytes; }
+
+private:
+	void drawIndexedPrimitive( const SBufferParam& bufferParam,
+		E_PRIMITIVE_TYPE primType,
+		u32 primCount,
+		const SDrawParam& drawParam);
+
+	bool reset();
+
+	void setRenderState3DMode(E_VERTEX_TYPE vType);
+	void setRenderState2DMode(E_VERTEX_TYPE vType, const S2DBlendParam& blendParam );
+
+public:
+	IRenderTarget*		CurrentRenderTarget;
+
+private:
+	E_RENDER_MODE		CurrentRenderMode;
+
+	CNullSceneStateServices*	NullSceneStateServices;
+	CNullShaderServices*		NullShaderServices;
+	CNullMaterialRenderServices*		NullMaterialRenderServices;
+
+	S2DBlendParam		Last2DBlendParam;
+
+	SNullDriverStats	CurrentStats;
+	SNullDriverStats	FrameStats;
+	u32		FrameCount;
+
+	typedef std::list<ILostResetCallback*, qzone_allocator<ILostResetCallback*> > T_LostResetList;
+	T_LostResetList	LostResetList;
+
+	c8		DebugMsg[512];
+
+	bool		ResetRenderStates;
+};
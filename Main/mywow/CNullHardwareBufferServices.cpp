@@ -0,0 +1,170 @@
+#include "stdafx.h"
+#include "CNullHardwareBufferServices.h"
+#include "mywow.h"
+#include "CNullDriver.h"
+
+CNullHardwareBufferServices::CNullHardwareBufferServices()
+{
+	InitializeListHead(&VertexBufferList);
+	InitializeListHead(&IndexBufferList);
+
+	Driver = static_cast<CNullDriver*>(g_Engine->getDriver());
+
+	createStaticIndexBufferQuadList();
+}
+
+CNullHardwareBufferServices::~CNullHardwareBufferServices()
+{
+	destroyStaticIndexBufferQuadList();
+
+	ASSERT(IsListEmpty(&VertexBufferList));
+	ASSERT(IsListEmpty(&IndexBufferList));
+}
+
+bool CNullHardwareBufferServices::createHardwareBuffers( const SBufferParam& bufferParam )
+{
+	if (!createHardwareBuffer(bufferParam.vbuffer0))
+	{
+		ASSERT(false);
+		g_Engine->getFileSystem()->writeLog(ELOG_GX, " CNullHardwareBufferServices::createHardwareBuffers Failed: vbuffer0");
+		return false;
+	}
+	if (bufferParam.vbuffer1 && !createHardwareBuffer(bufferParam.vbuffer1))
+	{
+		ASSERT(false);
+		g_Engine->getFileSystem()->writeLog(ELOG_GX, " CNullHardwareBufferServices::createHardwareBuffers Failed: vbuffer1");
+		return false;
+	}
+
+	//index buffer
+	if (bufferParam.ibuffer && !createHardwareBuffer(bufferParam.ibuffer))
+	{
+		ASSERT(false);
+		g_Engine->getFileSystem()->writeLog(ELOG_GX, " CNullHardwareBufferServices::createHardwareBuffers Failed: ibuffer");
+		return false;
+	}
+
+	return true;
+}
+
+bool CNullHardwareBufferServices::createHardwareBuffer( IVertexBuffer* vbuffer )
+{
+	ASSERT(NULL_PTR == vbuffer->HWLink);
+
+	vbuffer->HWLink = vbuffer;
+	InsertTailList(&VertexBufferList, &vbuffer->Link);
+
+	Driver->addBufferUpload(getStreamPitchFromType(vbuffer->Type) * vbuffer->Size);
+
+	return true;
+}
+
+bool CNullHardwareBufferServices::createHardwareBuffer( IIndexBuffer* ibuffer )
+{
+	ASSERT(NULL_PTR == ibuffer->HWLink);
+
+	ibuffer->HWLink = ibuffer;
+	InsertTailList(&IndexBufferList, &ibuffer->Link);
+
+	Driver->addBufferUpload((ibuffer->Type == EIT_16BIT ? 2 : 4) * ibuffer->Size);
+
+	return true;
+}
+
+void CNullHardwareBufferServices::destroyHardwareBuffers( const SBufferParam& bufferParam )
+{
+	if (bufferParam.ibuffer)
+		destroyHardwareBuffer(bufferParam.ibuffer);
+	if(bufferParam.vbuffer0)
+		destroyHardwareBuffer(bufferParam.vbuffer0);
+	if (bufferParam.vbuffer1)
+		destroyHardwareBuffer(bufferParam.vbuffer1);
+}
+
+void CNullHardwareBufferServices::destroyHardwareBuffer( IVertexBuffer* vbuffer )
+{
+	if(vbuffer->HWLink)
+	{
+		RemoveEntryList(&vbuffer->Link);
+		vbuffer->HWLink = NULL_PTR;
+	}
+}
+
+void CNullHardwareBufferServices::destroyHardwareBuffer( IIndexBuffer* ibuffer )
+{
+	if(ibuffer->HWLink)
+	{
+		RemoveEntryList(&ibuffer->Link);
+		ibuffer->HWLink = NULL_PTR;
+	}
+}
+
+bool CNullHardwareBufferServices::updateHardwareBuffer( IVertexBuffer* vbuffer, u32 size )
+{
+	if (vbuffer->Size >= 65536 || size > vbuffer->Size || vbuffer->Mapping == EMM_STATIC || !size)
+	{
+		ASSERT(false);
+		return false;
+	}
+
+	Driver->addBufferUpload(getStreamPitchFromType(vbuffer->Type) * size);
+
+	return true;
+}
+
+bool CNullHardwareBufferServices::updateHardwareBuffer( IIndexBuffer* ibuffer, u32 size )
+{
+	if (ibuffer->Size >= 65536 || size > ibuffer->Size || ibuffer->Mapping == EMM_STATIC || !size)
+	{
+		ASSERT(false);
+		return false;
+	}
+
+	Driver->addBufferUpload((ibuffer->Type == EIT_16BIT ? 2 : 4) * size);
+
+	return true;
+}
+
+void CNullHardwareBufferServices::onLost()
+{
+
+}
+
+void CNullHardwareBufferServices::onReset()
+{
+
+}
+
+void CNullHardwareBufferServices::createStaticIndexBufferQuadList()
+{
+	//index buffer
+	u16* indices = (u16*)Z_AllocateTempMemory(sizeof(u16) * MAX_QUADS() * 6);
+	u32 firstVert = 0;
+	u32 firstIndex = 0;
+	for (u32 i = 0; i < MAX_QUADS(); ++i )
+	{
+		indices[firstIndex + 0] = (u16)firstVert + 0;
+		indices[firstIndex + 1] = (u16)firstVert + 1;
+		indices[firstIndex + 2] = (u16)firstVert + 2;
+		indices[firstIndex + 3] = (u16)firstVert + 3;
+		indices[firstIndex + 4] = (u16)firstVert + 2;
+		indices[firstIndex + 5] = (u16)firstVert + 1;
+
+		firstVert += 4;
+		firstIndex += 6;
+	}
+
+	StaticIndexBufferQuadList = new IIndexBuffer(false);
+	StaticIndexBufferQuadList->set(indices, EIT_16BIT, MAX_QUADS() * 6, EMM_STATIC);
+
+	createHardwareBuffer(StaticIndexBufferQuadList);
+
+	Z_FreeTempMemory(indices);
+}
+
+void CNullHardwareBufferServices::destroyStaticIndexBufferQuadList()
+{
+	destroyHardwareBuffer(StaticIndexBufferQuadList);
+
+	delete StaticIndexBufferQuadList;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "IHardwareBufferServices.h"
+#include "core.h"
+
+class CNullDriver;
+
+//Դbuffer, HWLinkָbufferΪѴ, ͳϴֽ
+class CNullHardwareBufferServices : public IHardwareBufferServices
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CNullHardwareBufferServices);
+
+public:
+	CNullHardwareBufferServices();
+	~CNullHardwareBufferServices();
+
+public:
+	virtual bool createHardwareBuffers(const SBufferParam& bufferParam);
+	virtual bool createHardwareBuffer(IVertexBuffer* vbuffer);
+	virtual bool createHardwareBuffer(IIndexBuffer* ibuffer);
+	virtual void destroyHardwareBuffers(const SBufferParam& bufferParam);
+	virtual void destroyHardwareBuffer(IVertexBuffer* vbuffer);
+	virtual void destroyHardwareBuffer(IIndexBuffer* ibuffer);
+	virtual bool updateHardwareBuffer(IVertexBuffer* vbuffer, u32 size);
+	virtual bool updateHardwareBuffer(IIndexBuffer* ibuffer, u32 size);
+
+public:
+	virtual void onLost();
+	virtual void onReset();
+
+private:
+	void createStaticIndexBufferQuadList();
+	void destroyStaticIndexBufferQuadList();
+
+	CNullDriver*		Driver;
+
+	LENTRY	VertexBufferList;
+	LENTRY	IndexBufferList;
+};
@@ -0,0 +1,178 @@
+#include "stdafx.h"
+#include "CNullManualTextureServices.h"
+#include "mywow.h"
+#include "CImage.h"
+#include "CBLPImage.h"
+#include "CDXTEncoder.h"
+#include "CNullTexture.h"
+#include "CNullRenderTarget.h"
+#include "CNullDriver.h"
+
+CNullManualTextureServices::CNullManualTextureServices()
+{
+	Driver = static_cast<CNullDriver*>(g_Engine->getDriver());
+	Driver->registerLostReset(this);
+
+	DXTEncoder = new CDXTEncoder(true);
+
+	loadDefaultTextures();
+}
+
+CNullManualTextureServices::~CNullManualTextureServices()
+{	
+	Driver->removeLostReset(this);
+
+	delete DXTEncoder;
+
+	for (T_TextureMap::const_iterator itr = TextureMap.begin(); itr != TextureMap.end(); ++itr)
+	{
+		ITexture* tex = itr->second;
+		if (tex)
+			tex->drop();
+	}
+
+	for (T_RTList::const_iterator itr = RenderTargets.begin(); itr != RenderTargets.end(); ++itr)
+	{
+		delete (*itr);
+	}
+}
+
+ITexture* CNullManualTextureServices::addTexture( const c8* name, const dimension2du& size, IImage* img, bool mipmap )
+{
+	if(TextureMap.find(name) != TextureMap.end())
+		return NULL_PTR;
+
+	CNullTexture* tex = new CNullTexture(mipmap);
+	if(!tex->createFromImage(size, img))
+	{
+		tex->drop();
+		return NULL_PTR;
+	}
+	TextureMap[name] =  tex;
+
+	return tex;
+}
+
+void CNullManualTextureServices::removeTexture( const c8* name )
+{
+	T_TextureMap::iterator itr = TextureMap.find(name);
+	if (itr == TextureMap.end())
+		return;
+
+	if ((*itr).second)
+		(*itr).second->drop();
+
+	TextureMap.erase(itr);
+}
+
+IRenderTarget* CNullManualTextureServices::addRenderTarget( const dimension2du& size, ECOLOR_FORMAT colorFmt, ECOLOR_FORMAT depthFmt )
+{
+	CNullRenderTarget* tex = new CNullRenderTarget(size, colorFmt, depthFmt);
+	ASSERT(tex->isValid());
+
+	RenderTargets.push_back(tex);
+
+	return tex;
+}
+
+void CNullManualTextureServices::removeRenderTarget( IRenderTarget* texture )
+{
+	for (T_RTList::iterator itr = RenderTargets.begin(); itr != RenderTargets.end(); ++itr)
+	{
+		if ((*itr) == texture)
+		{
+			delete (*itr);
+			RenderTargets.erase(itr);
+			break;
+		}
+	}
+}
+
+ITexture* CNullManualTextureServices::createTextureFromImage( const dimension2du& size, IImage* image, bool mipmap )
+{
+	CNullTexture* tex = new CNullTexture(mipmap);
+	if (!tex->createFromImage(size, image))
+	{
+		tex->drop();
+		tex = NULL_PTR;
+	}
+	return tex;
+}
+
+ITexture* CNullManualTextureServices::createTextureFromData( const dimension2du& size, ECOLOR_FORMAT format, const void* data, bool mipmap )
+{
+	CImage* image = new CImage(format, size, data, false);
+	CNullTexture* tex = new CNullTexture(mipmap);
+	if (!tex->createFromImage(size, image))
+	{
+		tex->drop();
+		tex = NULL_PTR;
+	}
+	image->drop();
+	return tex;
+}
+
+ITexture* CNullManualTextureServices::createCompressTextureFromData( const dimension2du& size, ECOLOR_FORMAT format, const void* data, bool mipmap )
+{
+	CBLPImage* image = new CBLPImage;
+	if (!image->fromImageData((const u8*)data, size, format, mipmap, ECF_DXT1, DXTEncoder))
+	{
+		image->drop();
+		return NULL_PTR;
+	}
+
+	CNullTexture* tex = new CNullTexture(mipmap);
+	if (!tex->createFromBlpImage(image))
+	{
+		tex->drop();
+		tex = NULL_PTR;
+	}
+	image->drop();
+	return tex;
+}
+
+ITexture* CNullManualTextureServices::createEmptyTexture( const dimension2du& size, ECOLOR_FORMAT format )
+{
+	CNullTexture* tex = new CNullTexture(false);
+	if (tex->createEmptyTexture(size, format))
+	{
+		ASSERT(tex->isValid());
+		return tex;
+	}
+	tex->drop();
+	return NULL_PTR;
+}
+
+void CNullManualTextureServices::onLost()
+{
+	for (T_RTList::const_iterator itr = RenderTargets.begin(); itr != RenderTargets.end(); ++itr)
+	{
+		(*itr)->onLost();
+	}
+}
+
+void CNullManualTextureServices::onReset()
+{
+	for (T_RTList::const_iterator itr = RenderTargets.begin(); itr != RenderTargets.end(); ++itr)
+	{
+		(*itr)->onReset();
+	}
+}
+
+void CNullManualTextureServices::loadDefaultTextures()
+{
+	ECOLOR_FORMAT format = ECF_R5G6B5;
+	dimension2du size = dimension2du(32, 32);
+
+	u32 pitch, nbytes;
+	getImagePitchAndBytes(format, size.Width, size.Height, pitch, nbytes);
+
+	void* data = Z_AllocateTempMemory(nbytes);
+	memset(data, 0xff, nbytes);
+
+	CImage* img = new CImage(format, size, data, false);
+	addTexture("$DefaultWhite", size, img, true);
+	img->drop();
+
+	Z_FreeTempMemory(data);
+}
@@ -0,0 +1,30 @@
+#include "stdafx.h"
+#include "CNullMaterialRenderServices.h"
+#include "mywow.h"
+
+CNullMaterialRenderServices::CNullMaterialRenderServices()
+{
+	resetSamplers();
+}
+
+ITexture* CNullMaterialRenderServices::getSampler_Texture( u32 st ) const
+{
+	if (st >= MATERIAL_MAX_TEXTURES)
+		return NULL_PTR;
+
+	return SamplerTextures[st];
+}
+
+bool CNullMaterialRenderServices::setSampler_Texture( u32 st, ITexture* tex )
+{
+	if (st >= MATERIAL_MAX_TEXTURES || SamplerTextures[st] == tex)
+		return false;
+
+	SamplerTextures[st] = tex;
+	return true;
+}
+
+void CNullMaterialRenderServices::resetSamplers()
+{
+	memset(SamplerTextures, 0, sizeof(SamplerTextures));
+}
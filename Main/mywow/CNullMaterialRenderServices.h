@@ -0,0 +1,22 @@
+#pragma once
+
+#include "IMaterialRenderServices.h"
+
+//ֻ¼ÿsamplerǰ󶨵, ͳл
+class CNullMaterialRenderServices : public IMaterialRenderServices
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CNullMaterialRenderServices);
+
+public:
+	CNullMaterialRenderServices();
+
+public:
+	ITexture* getSampler_Texture(u32 st) const;
+	bool setSampler_Texture(u32 st, ITexture* tex);			//Ƿб仯
+
+	void resetSamplers();
+
+private:
+	ITexture*		SamplerTextures[MATERIAL_MAX_TEXTURES];
+};
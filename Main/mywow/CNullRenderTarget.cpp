@@ -0,0 +1,26 @@
+#include "stdafx.h"
+#include "CNullRenderTarget.h"
+#include "mywow.h"
+#include "CNullTexture.h"
+
+CNullRenderTarget::CNullRenderTarget( const dimension2du& size, ECOLOR_FORMAT colorFmt, ECOLOR_FORMAT depthFmt )
+	: IRenderTarget(colorFmt, depthFmt)
+{
+	TextureSize = size;
+
+	if (ColorFormat == ECF_UNKNOWN)
+		ColorFormat = ECF_A8R8G8B8;
+
+	ColorTexture = new CNullTexture(false);
+	VideoBuilt = ColorTexture->createRTTexture(TextureSize, ColorFormat);
+}
+
+CNullRenderTarget::~CNullRenderTarget()
+{
+	ColorTexture->drop();
+}
+
+ITexture* CNullRenderTarget::getRTTexture() const
+{
+	return ColorTexture;
+}
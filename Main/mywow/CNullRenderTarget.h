@@ -0,0 +1,24 @@
+#pragma once
+
+#include "IRenderTarget.h"
+
+class CNullTexture;
+
+class CNullRenderTarget : public IRenderTarget
+{
+public:
+	CNullRenderTarget(const dimension2du& size, ECOLOR_FORMAT colorFmt, ECOLOR_FORMAT depthFmt);
+	~CNullRenderTarget();
+
+public:
+	virtual bool isValid() const { return VideoBuilt; }
+	virtual ITexture* getRTTexture() const;
+	virtual bool writeToRTTexture() { return true; }
+
+	//lost reset
+	void onLost() {}
+	void onReset() {}
+
+private:
+	CNullTexture*		ColorTexture;
+};
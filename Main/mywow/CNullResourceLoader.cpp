@@ -0,0 +1,43 @@
+#include "stdafx.h"
+#include "CNullResourceLoader.h"
+#include "mywow.h"
+#include "CNullTexture.h"
+
+CNullResourceLoader::CNullResourceLoader()
+{
+
+}
+
+ITexture* CNullResourceLoader::loadTexture( const c8* filename, bool mipmap /*= true*/ )
+{
+	if (strlen(filename) == 0)
+		return NULL_PTR;
+
+	c8 realfilename[QMAX_PATH];
+	normalizeFileName(filename, realfilename, QMAX_PATH);
+	Q_strlwr(realfilename);
+
+	if (MultiThread)
+		BEGIN_LOCK(&textureCS);
+
+	ITexture* tex  = TextureCache.tryLoadFromCache(realfilename);
+	if (tex)
+	{
+		if (MultiThread)
+			END_LOCK(&textureCS);
+
+		return tex;
+	}
+
+	if (g_Engine->getWowEnvironment()->exists(realfilename))
+	{
+		tex = new CNullTexture(mipmap);
+		tex->setFileName(realfilename);
+		TextureCache.addToCache(tex);
+	}
+
+	if (MultiThread)
+		END_LOCK(&textureCS);
+
+	return tex;
+}
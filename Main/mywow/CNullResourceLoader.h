@@ -0,0 +1,15 @@
+#pragma once
+
+#include "CResourceLoader.h"
+
+class CNullResourceLoader : public CResourceLoader
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CNullResourceLoader);
+
+public:
+	CNullResourceLoader();
+
+public:
+	virtual ITexture* loadTexture(const c8* filename, bool mipmap = true);
+};
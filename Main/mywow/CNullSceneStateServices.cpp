@@ -0,0 +1,56 @@
+#include "stdafx.h"
+#include "CNullSceneStateServices.h"
+#include "mywow.h"
+
+CNullSceneStateServices::CNullSceneStateServices()
+{
+
+}
+
+bool CNullSceneStateServices::setClipPlane( u32 index, const plane3df& plane )
+{
+	if (index >= SSceneState::MAX_CLIPPLANES)
+		return false;
+
+	SceneState.clipplanes[index] = plane;
+	return true;
+}
+
+void CNullSceneStateServices::enableClipPlane( u32 index, bool enable )
+{
+	if (index >= SSceneState::MAX_CLIPPLANES)
+		return;
+
+	SceneState.enableclips[index] = enable;
+}
+
+bool CNullSceneStateServices::setDynamicLight( u32 index, const SLight& light )
+{
+	if (index >= SSceneState::MAX_LIGTHTS)
+		return false;
+
+	SceneState.Lights[index] = light;
+	return true;
+}
+
+const SLight* CNullSceneStateServices::getDynamicLight( u32 index ) const
+{
+	if (index >= SSceneState::MAX_LIGTHTS)
+		return NULL_PTR;
+
+	return &SceneState.Lights[index];
+}
+
+void CNullSceneStateServices::turnLightOn( u32 lightIndex, bool turnOn )
+{
+	if (lightIndex >= SSceneState::MAX_LIGTHTS)
+		return;
+
+	SceneState.LightsOn[lightIndex] = turnOn;
+}
+
+bool CNullSceneStateServices::reset()
+{
+	SceneState.resetLights();
+	return true;
+}
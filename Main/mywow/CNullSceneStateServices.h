@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ISceneStateServices.h"
+
+class CNullSceneStateServices : public ISceneStateServices
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CNullSceneStateServices);
+
+public:
+	CNullSceneStateServices();
+
+public:
+	virtual void setLight_Fog(u32 lightIndex, bool enable, const SLight& dirLight,
+		SColor color, const SFogParam& fogParam)
+	{
+		turnLightOn(lightIndex, enable);
+		setDynamicLight(lightIndex, dirLight);
+		setAmbientLight(color);
+		setFog(fogParam);
+	}
+
+	virtual void setLight(u32 lightIndex, bool enable, const SLight& dirLight, SColor color)
+	{
+		turnLightOn(lightIndex, enable);
+		setDynamicLight(lightIndex, dirLight);
+		setAmbientLight(color);
+	}
+
+public:
+	bool setClipPlane( u32 index, const plane3df& plane );
+	void enableClipPlane( u32 index, bool enable );
+	SColor getAmbientLight() const { return SceneState.AmbientLightColor; }
+	void setAmbientLight( SColor color ) { SceneState.AmbientLightColor = color; }
+	void deleteAllDynamicLights() { SceneState.resetLights(); }
+	bool setDynamicLight( u32 index, const SLight& light );
+	const SLight* getDynamicLight(u32 index) const;
+	void turnLightOn(u32 lightIndex, bool turnOn);
+
+	void setFog(const SFogParam& fogParam) { SceneState.FogParam = fogParam; }
+	const SFogParam& getFog() const { return SceneState.FogParam; }
+
+	bool reset();
+
+private:
+	SSceneState		SceneState;
+};
@@ -0,0 +1,18 @@
+#include "stdafx.h"
+#include "CNullShaderServices.h"
+#include "mywow.h"
+
+CNullShaderServices::CNullShaderServices()
+{
+
+}
+
+CNullShaderServices::~CNullShaderServices()
+{
+
+}
+
+void CNullShaderServices::loadAll()
+{
+	g_Engine->getFileSystem()->writeLog(ELOG_GX, "CNullShaderServices::loadAll: no shaders for null driver");
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "IShaderServices.h"
+
+//shader, shaderΪ
+class CNullShaderServices : public IShaderServices
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CNullShaderServices);
+
+public:
+	CNullShaderServices();
+	~CNullShaderServices();
+
+public:
+	virtual void loadAll();
+	virtual IPixelShader* getPixelShader(E_PS_TYPE type, E_PS_MACRO macro = PS_Macro_None) { return NULL_PTR; }
+
+public:
+	virtual void onLost() {}
+	virtual void onReset() {}
+};
@@ -0,0 +1,110 @@
+#include "stdafx.h"
+#include "CNullSound.h"
+#include "mywow.h"
+#include "CNullAudioPlayer.h"
+#include "CAudioDecodeServices.h"
+#include "CAudioMixer.h"
+
+#ifdef MW_PLATFORM_WINDOWS
+
+CNullSound::CNullSound( CNullAudioPlayer* player, E_SOUND_TYPE type, u32 index )
+	: ISound(type), Player(player), Stream(NULL_PTR), Callback(NULL_PTR), Voice(-1), Index(index), Volume(1.0f)
+{
+}
+
+CNullSound::~CNullSound()
+{
+	unload();
+}
+
+bool CNullSound::load( const c8* filename )
+{
+	unload();
+
+	Stream = Player->getDecodeServices()->openStream(filename, (E_SOUND_TYPE)Type);
+	if (!Stream)
+	{
+		ASSERT(false);
+		return false;
+	}
+
+	return true;
+}
+
+void CNullSound::unload()
+{
+	stop();
+
+	Player->getDecodeServices()->closeStream(Stream);
+	Stream = NULL_PTR;
+}
+
+bool CNullSound::play( bool loop, FN_SOUND_CALLBACK callback )
+{
+	if (!Stream)
+		return false;
+
+	stop();
+	reset();
+
+	Voice = Player->getMixer()->addVoice(Stream, 1.0f);
+	if (Voice < 0)
+		return false;
+
+	Volume = 1.0f;
+	Stream->setLoop(loop);
+	Callback = callback;
+
+	return true;
+}
+
+void CNullSound::stop()
+{
+	if (Voice >= 0)
+	{
+		Player->getMixer()->removeVoice((u32)Voice);
+		Voice = -1;
+	}
+}
+
+void CNullSound::reset()
+{
+	Callback = NULL_PTR;
+
+	if (Stream)
+	{
+		Stream->setLoop(false);
+		Stream->rewind();
+	}
+}
+
+bool CNullSound::isPlaying() const
+{
+	return Voice >= 0 && Player->getMixer()->isVoiceActive((u32)Voice);
+}
+
+bool CNullSound::isStopped() const
+{
+	return !isPlaying();
+}
+
+void CNullSound::setVolume( f32 vol )
+{
+	Volume = clamp_<f32>(vol, 0.0f, 1.0f);
+
+	if (Voice >= 0)
+		Player->getMixer()->setVoiceVolume((u32)Voice, Volume);
+}
+
+void CNullSound::onVoiceEnded()
+{
+	FN_SOUND_CALLBACK callback = Callback;
+
+	stop();
+	Callback = NULL_PTR;
+
+	if (callback)
+		callback();
+}
+
+#endif
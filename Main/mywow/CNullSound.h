@@ -0,0 +1,48 @@
+#pragma once
+
+#include "ISound.h"
+
+#ifdef MW_PLATFORM_WINDOWS
+
+class CNullAudioPlayer;
+class CAudioStream;
+
+//豸, CAudioDecodeServicesṩ, CAudioMixerл
+class CNullSound : public ISound
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CNullSound);
+
+public:
+	CNullSound(CNullAudioPlayer* player, E_SOUND_TYPE type, u32 index);
+	~CNullSound();
+
+public:
+	virtual bool load(const c8* filename);
+	virtual void unload();
+	virtual bool play(bool loop, FN_SOUND_CALLBACK callback = NULL_PTR);
+	virtual void stop();
+	virtual void reset();
+	virtual bool isPlaying() const;
+	virtual bool isStopped() const;
+	virtual void setVolume(f32 vol);
+	virtual f32 getVolume() const { return Volume; }
+	virtual u32 getIndex() const { return Index; }
+
+	CAudioStream* getStream() const { return Stream; }
+
+private:
+	void onVoiceEnded();
+
+private:
+	CNullAudioPlayer*		Player;
+	CAudioStream*		Stream;
+	FN_SOUND_CALLBACK	Callback;
+	s32		Voice;
+	u32		Index;
+	f32		Volume;
+
+	friend class CNullAudioPlayer;
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include "stdafx.h"
+#include "CNullTexture.h"
+#include "mywow.h"
+#include "CBlit.h"
+
+CNullTexture::CNullTexture( bool mipmap )
+{
+	HasMipMaps = mipmap;
+}
+
+CNullTexture::~CNullTexture()
+{
+
+}
+
+bool CNullTexture::createEmptyTexture( const dimension2du& size, ECOLOR_FORMAT format )
+{
+	if (VideoBuilt)
+	{
+		ASSERT(false);
+		return false;
+	}
+
+	HasMipMaps = false;
+	NumMipmaps = 1;
+	TextureSize = size;
+	ColorFormat = format;
+
+	ITextureWriter* texWriter = g_Engine->getTextureWriteServices()->createTextureWriter(this, true);
+	texWriter->initEmptyData();
+	texWriter->copyToTexture(this);
+	g_Engine->getTextureWriteServices()->removeTextureWriter(this);
+
+	VideoBuilt = true;
+
+	return true;
+}
+
+bool CNullTexture::createFromImage( const dimension2du& size, IImage* image )
+{
+	if(VideoBuilt || !image)
+	{
+		ASSERT(false);
+		return false;
+	}
+
+	NumMipmaps = HasMipMaps ? image->getDimension().getNumMipLevels() : 1;
+	TextureSize = size;
+	ColorFormat = image->getColorFormat();
+
+	ITextureWriter* texWriter = g_Engine->getTextureWriteServices()->createTextureWriter(this, true);
+
+	copyTexture(texWriter, image);
+
+	if (HasMipMaps)
+		createMipMaps(texWriter);
+
+	texWriter->copyToTexture(this);
+
+	g_Engine->getTextureWriteServices()->removeTextureWriter(this);
+
+	VideoBuilt = true;
+
+	return true;
+}
+
+bool CNullTexture::createFromBlpImage( IBLPImage* blpImage )
+{
+	ASSERT(Type == ETT_IMAGE);
+
+	if (VideoBuilt || Type != ETT_IMAGE)
+		return true;
+
+	if(!blpImage)
+	{
+		ASSERT(false);
+		return false;
+	}
+
+	NumMipmaps = HasMipMaps ? blpImage->getNumMipLevels() : 1;
+	TextureSize = blpImage->getDimension();
+	ColorFormat = blpImage->getColorFormat();
+
+	ITextureWriter* texWriter = g_Engine->getTextureWriteServices()->createTextureWriter(this, true);
+
+	copyTexture(texWriter, blpImage);
+
+	if (HasMipMaps)
+		copyBlpMipMaps(texWriter, blpImage);
+
+	texWriter->copyToTexture(this);
+
+	g_Engine->getTextureWriteServices()->removeTextureWriter(this);
+
+	VideoBuilt = true;
+
+	return true;
+}
+
+bool CNullTexture::createRTTexture( const dimension2du& size, ECOLOR_FORMAT format )
+{
+	if (VideoBuilt)
+	{
+		ASSERT(false);
+		return false;
+	}
+
+	Type = ETT_RENDERTARGET;
+	HasMipMaps = false;
+	NumMipmaps = 1;
+	TextureSize = size;
+	ColorFormat = format;
+
+	VideoBuilt = true;
+
+	return true;
+}
+
+bool CNullTexture::createVideoTexture()
+{
+	ASSERT(Type == ETT_IMAGE);
+
+	if (VideoBuilt || Type != ETT_IMAGE)
+		return true;
+
+	IBLPImage* blpImage = g_Engine->getResourceLoader()->loadBLP(getFileName());
+	if(!blpImage)
+	{
+		ASSERT(false);
+		return false;
+	}
+
+	bool ret = createFromBlpImage(blpImage);
+
+	blpImage->drop();
+
+	return ret;
+}
+
+void CNullTexture::releaseVideoTexture()
+{
+	VideoBuilt = false;
+}
+
+void CNullTexture::copyTexture( ITextureWriter* writer, IBLPImage* blpimage )
+{
+	ASSERT(blpimage);
+
+	u32 pitch;
+	void* destData = writer->lock(0, pitch);
+
+	bool result = blpimage->copyMipmapData(0, destData, pitch, TextureSize.Width, TextureSize.Height);
+	ASSERT(result);
+
+	writer->unlock(0);
+}
+
+void CNullTexture::copyTexture( ITextureWriter* writer, IImage* image )
+{
+	ASSERT(image);
+
+	u32 pitch;
+	void* destData = writer->lock(0, pitch);
+
+	image->copyToScaling(destData, TextureSize.Width, TextureSize.Height, ColorFormat, pitch);
+
+	writer->unlock(0);
+}
+
+void CNullTexture::copyBlpMipMaps( ITextureWriter* writer, IBLPImage* blpimage )
+{
+	for (u32 level = 1; level < NumMipmaps; ++level)
+	{
+		dimension2du size = TextureSize.getMipLevelSize(level);
+
+		u32 pitch;
+		void* destData = writer->lock(level, pitch);
+
+		bool result = blpimage->copyMipmapData(level, destData, pitch, size.Width, size.Height);
+
+		writer->unlock(level);
+
+		if (!result || (size.Width < 2 && size.Height < 2))
+			break;
+	}
+}
+
+void CNullTexture::createMipMaps( ITextureWriter* writer )
+{
+	for (u32 level = 1; level < NumMipmaps; ++level)
+	{
+		dimension2du lowerSize = TextureSize.getMipLevelSize(level);
+
+		u32 upperPitch, lowerPitch;
+		const u8* upperDest = (const u8*)writer->lock(level - 1, upperPitch);
+		u8*	lowerDest = (u8*)writer->lock(level, lowerPitch);
+
+		if (ColorFormat == ECF_R5G6B5 || ColorFormat == ECF_A1R5G5B5)
+			CBlit::copy16BitMipMap(upperDest, lowerDest,
+			lowerSize.Width, lowerSize.Height,
+			upperPitch, lowerPitch, ColorFormat);
+		else if (ColorFormat == ECF_A8R8G8B8)
+			CBlit::copy32BitMipMap(upperDest, lowerDest,
+			lowerSize.Width, lowerSize.Height,
+			upperPitch, lowerPitch, ColorFormat);
+		else if (ColorFormat == ECF_R8G8B8)
+			CBlit::copyR8G8B8BitMipMap(upperDest, lowerDest,
+			lowerSize.Width, lowerSize.Height,
+			upperPitch, lowerPitch);
+		else
+			ASSERT(false);				//ֵ֧ĸʽ
+
+		writer->unlock(level);
+		writer->unlock(level - 1);
+
+		if (lowerSize.Width < 2 && lowerSize.Height < 2)
+			break;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ITexture.h"
+
+class ITextureWriter;
+class IBLPImage;
+class IImage;
+
+//Դ, blpmipmap, ϴʱֻͳֽ
+class CNullTexture : public ITexture
+{
+public:
+	explicit CNullTexture( bool mipmap );			//from blp
+	~CNullTexture();
+
+public:
+	//ITexture
+	bool createEmptyTexture( const dimension2du& size, ECOLOR_FORMAT format );
+	bool createFromImage(const dimension2du& size, IImage* image);
+	bool createFromBlpImage(IBLPImage* blpImage);
+	bool createRTTexture( const dimension2du& size, ECOLOR_FORMAT format );
+
+	virtual bool isValid() const { return VideoBuilt; }
+
+	//video memory
+	virtual bool createVideoTexture();
+	virtual void releaseVideoTexture();
+
+private:
+	//blp
+	void copyTexture( ITextureWriter* writer, IBLPImage* blpimage );
+	void copyBlpMipMaps( ITextureWriter* writer, IBLPImage* blpimage );
+
+	//image
+	void copyTexture( ITextureWriter* writer, IImage* image );
+	void createMipMaps( ITextureWriter* writer );
+};
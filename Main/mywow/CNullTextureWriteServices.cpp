@@ -0,0 +1,130 @@
+#include "stdafx.h"
+#include "CNullTextureWriteServices.h"
+#include "mywow.h"
+#include "CNullDriver.h"
+
+CNullTextureWriter::CNullTextureWriter( const dimension2du& size, ECOLOR_FORMAT format, u32 numMipmap, bool bTempMemory )
+	: ITextureWriter(numMipmap)
+{
+	TempMemory = bTempMemory;
+	TextureSize = size;
+	ColorFormat = format;
+
+	MipData = new SMipData[NumMipmaps];
+	for (u32 i=0; i<NumMipmaps; ++i)
+	{
+		dimension2du mipsize = size.getMipLevelSize(i);
+
+		u32 pitch, bytes;
+		getImagePitchAndBytes(ColorFormat, mipsize.Width, mipsize.Height, pitch, bytes);
+
+		MipData[i].pitch = pitch;
+		MipData[i].bytes = bytes;
+		MipData[i].data = TempMemory ? (u8*)Z_AllocateTempMemory(bytes) : new u8[bytes];
+	}
+}
+
+CNullTextureWriter::~CNullTextureWriter()
+{
+	for (u32 i=0; i<NumMipmaps; ++i)
+	{
+		if (TempMemory)
+			Z_FreeTempMemory(MipData[i].data);
+		else
+			delete[] MipData[i].data;
+	}
+	delete[] MipData;
+}
+
+void* CNullTextureWriter::lock( u32 level, u32& pitch )
+{
+	if (level >= NumMipmaps)
+		return NULL_PTR;
+
+	pitch = MipData[level].pitch;
+	return MipData[level].data;
+}
+
+void CNullTextureWriter::unlock( u32 level )
+{
+
+}
+
+void CNullTextureWriter::initEmptyData()
+{
+	u32 pitch;
+	void* dest = lock(0, pitch);
+	memset(dest, 0, MipData[0].bytes);
+	unlock(0);
+}
+
+bool CNullTextureWriter::copyToTexture( ITexture* texture, const recti* descRect /*= NULL_PTR*/ )
+{
+	CNullDriver* driver = static_cast<CNullDriver*>(g_Engine->getDriver());
+
+	ASSERT(texture->getType() == ETT_IMAGE && texture->getSampleCount() == 1);
+
+	if (descRect)
+	{
+		ASSERT(!texture->hasMipMaps());
+
+		u32 pitch, bytes;
+		getImagePitchAndBytes(ColorFormat, descRect->getWidth(), descRect->getHeight(), pitch, bytes);
+		driver->addTextureUpload(bytes);
+	}
+	else
+	{
+		u32 bytes = 0;
+		for (u32 i=0; i<NumMipmaps; ++i)
+			bytes += MipData[i].bytes;
+		driver->addTextureUpload(bytes);
+	}
+
+	return true;
+}
+
+CNullTextureWriteServices::CNullTextureWriteServices()
+{
+
+}
+
+CNullTextureWriteServices::~CNullTextureWriteServices()
+{
+	for (T_TextureWriterMap::iterator itr = TextureWriterMap.begin(); itr != TextureWriterMap.end(); ++itr)
+	{
+		delete itr->second;
+	}
+	TextureWriterMap.clear();
+}
+
+ITextureWriter* CNullTextureWriteServices::createTextureWriter( ITexture* texture, bool temp )
+{
+	ECOLOR_FORMAT format = texture->getColorFormat();
+	dimension2du size = texture->getSize();
+	u32 numMipmap = texture->getNumMipmaps();
+
+	T_TextureWriterMap::iterator itr = TextureWriterMap.find(texture);
+	if (itr != TextureWriterMap.end())
+	{
+		return itr->second;
+	}
+
+	//not found, create
+	CNullTextureWriter* writer = new CNullTextureWriter(size, format, numMipmap, temp);
+	TextureWriterMap[texture] = writer;
+
+	return writer;
+}
+
+bool CNullTextureWriteServices::removeTextureWriter( ITexture* texture )
+{
+	T_TextureWriterMap::iterator itr = TextureWriterMap.find(texture);
+	if (itr != TextureWriterMap.end())
+	{
+		delete itr->second;
+		TextureWriterMap.erase(itr);
+		return true;
+	}
+
+	return false;
+}
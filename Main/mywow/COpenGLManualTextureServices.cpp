@@ -7,6 +7,7 @@
 
 #include "CImage.h"
 #include "CBLPImage.h"
+#include "CDXTEncoder.h"
 #include "COpenGLTexture.h"
 #include "COpenGLRenderTarget.h"
 #include "COpenGLDriver.h"
@@ -16,6 +17,8 @@ COpenGLManualTextureServices::COpenGLManualTextureServices()
 	Driver = static_cast<COpenGLDriver*>(g_Engine->getDriver());
 	Driver->registerLostReset(this);
 
+	DXTEncoder = new CDXTEncoder(true);
+
 	loadDefaultTextures();
 }
 
@@ -23,6 +26,8 @@ COpenGLManualTextureServices::~COpenGLManualTextureServices()
 {	
 	Driver->removeLostReset(this);
 
+	delete DXTEncoder;
+
 	for (T_TextureMap::const_iterator itr = TextureMap.begin(); itr != TextureMap.end(); ++itr)
 	{
 		ITexture* tex = itr->second;
@@ -114,7 +119,7 @@ ITexture* COpenGLManualTextureServices::createTextureFromData( const dimension2d
 ITexture* COpenGLManualTextureServices::createCompressTextureFromData( const dimension2du& size, ECOLOR_FORMAT format, const void* data, bool mipmap )
 {
 	CBLPImage* image = new CBLPImage;
-	if (!image->fromImageData((const u8*)data, size, format, mipmap))
+	if (!image->fromImageData((const u8*)data, size, format, mipmap, ECF_DXT1, DXTEncoder))
 	{
 		image->drop();
 		return NULL_PTR;
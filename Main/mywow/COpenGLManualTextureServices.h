@@ -10,6 +10,7 @@
 #include "fixstring.h"
 
 class COpenGLDriver;
+class CDXTEncoder;
 
 class COpenGLManualTextureServices : public IManualTextureServices
 {
@@ -44,6 +45,7 @@ private:
 	T_RTList		RenderTargets;
 
 	COpenGLDriver*	Driver;
+	CDXTEncoder*	DXTEncoder;			//createCompressTextureFromDataʹ
 };
 
 
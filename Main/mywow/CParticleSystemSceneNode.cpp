@@ -4,6 +4,10 @@
 #include "CSceneRenderServices.h"
 #include "CParticleSystemServices.h"
 
+#ifdef MW_USE_SSE
+#include <emmintrin.h>
+#endif
+
 CParticleSystemSceneNode::CParticleSystemSceneNode( ParticleSystem* ps, IM2SceneNode* parent )
 	: IParticleSystemSceneNode(parent), Ps(ps), LastAnim(-1), LastTime(-1)
 {
@@ -47,21 +51,20 @@ CParticleSystemSceneNode::CParticleSystemSceneNode( ParticleSystem* ps, IM2Scene
 	EnableModelAlpha = false;
 	ModelAlpha = 1.0f;
 
-	::InitializeListHead(&LiveParticleList);
+	ParticleData = NULL_PTR;
+	ParticleColors = NULL_PTR;
+	ParticleTiles = NULL_PTR;
+	ParticleCapacity = 0;
 	LiveParticleCount = 0;
 }
 
 CParticleSystemSceneNode::~CParticleSystemSceneNode()
 {
-	for (PLENTRY e = LiveParticleList.Flink; e != &LiveParticleList; )
-	{
-		Particle* p = reinterpret_cast<Particle*>CONTAINING_RECORD(e, Particle, Link);
-		e = e->Flink;
+	clearParticles();
 
-		ParticleSystemServices->putParticle(p);
-	}
-	InitializeListHead(&LiveParticleList);
-	LiveParticleCount = 0;
+	delete[] ParticleTiles;
+	delete[] ParticleColors;
+	delete[] ParticleData;
 }
 
 void CParticleSystemSceneNode::registerSceneNode(bool frustumcheck, int sequence)
@@ -162,77 +165,303 @@ void CParticleSystemSceneNode::tick( u32 timeSinceStart, u32 timeSinceLastFrame,
 				param.horizontal = horz;
 				param.maxlife = flife;
 
+				tospawn = ParticleSystemServices->allocParticles(tospawn);
+				reserveParticles(LiveParticleCount + tospawn);
+
+				Particle p;
 				for (u32 i=0; i<tospawn; ++i)
 				{
-					Particle* p = ParticleSystemServices->getParticle();
-					if (!p)
-						break;
-					Ps->emitter->emitParticle(ParentM2Node->getM2Instance(), AbsoluteTransformation, param, p);
-					InsertTailList(&LiveParticleList, &p->Link);
-					++LiveParticleCount;
+					Ps->emitter->emitParticle(ParentM2Node->getM2Instance(), AbsoluteTransformation, param, &p);
+					addParticle(p);
 				}
 			}
 		}
 	}	//end emit
 	
-	float mspeed = 1.0f;
-
-	for (PLENTRY e = LiveParticleList.Flink; e != &LiveParticleList; )
+	//Ƴ, һƵλλ
+	f32* life = getStream(EPS_LIFE);
+	f32* maxlife = getStream(EPS_MAXLIFE);
+	u32 numDead = 0;
+	for (u32 i=0; i<LiveParticleCount; )
 	{
-		Particle* p = reinterpret_cast<Particle*>CONTAINING_RECORD(e, Particle, Link);
-		e = e->Flink;
-
-		p->life += delta;
-			
-		float rlife = p->life / p->maxlife;
-		if (rlife >= 1.0f)					//dead
+		life[i] += delta;
+		if (life[i] / maxlife[i] >= 1.0f)
 		{
-			RemoveEntryList(&p->Link);
-			--LiveParticleCount;
-			ParticleSystemServices->putParticle(p);
+			removeParticle(i);
+			++numDead;
 		}
-		else		//affector
-		{
-			float grav = 0;
-			float deaccel = 0;
+		else
+			++i;
+	}
+	ParticleSystemServices->freeParticles(numDead);
 
-			Hint.grav = Ps->gravity.getValue(anim, time, grav, Hint.grav);
-			Hint.deaccel = Ps->deacceleration.getValue(anim, time, deaccel, Hint.deaccel);
+	if (LiveParticleCount)		//affector
+	{
+		//ÿ֡ѭȡ
+		float grav = 0;
+		float deaccel = 0;
 
-			if (Ps->boneIndex != -1 && Ps->ribbontype)
+		Hint.grav = Ps->gravity.getValue(anim, time, grav, Hint.grav);
+		Hint.deaccel = Ps->deacceleration.getValue(anim, time, deaccel, Hint.deaccel);
+
+		if (Ps->boneIndex != -1 && Ps->ribbontype)
+		{
+			matrix4 mat;
+			Ps->getBoneMatrix(ParentM2Node->getM2Instance(), AbsoluteTransformation, mat);
+			vector3df basepos = Ps->pos;
+			mat.transformVect(basepos);
+
+			f32* baseX = getStream(EPS_BASEX);
+			f32* baseY = getStream(EPS_BASEY);
+			f32* baseZ = getStream(EPS_BASEZ);
+			for (u32 i=0; i<LiveParticleCount; ++i)
 			{
-				matrix4 mat;
-				Ps->getBoneMatrix(ParentM2Node->getM2Instance(), AbsoluteTransformation, mat);
-				p->basepos = Ps->pos;
-				mat.transformVect(p->basepos);
+				baseX[i] = basepos.X;
+				baseY[i] = basepos.Y;
+				baseZ[i] = basepos.Z;
 			}
+		}
 
-			p->speed += ( -vector3df::UnitY() * grav - p->dir * deaccel ) * delta;
+		simulateParticles(delta, grav, deaccel);
+	}
 
-   			if (Ps->slowdown > 0)
-   				mspeed = max_(1.0f - Ps->slowdown * p->life, 0.0f);
+	LastAnim = anim;
+	LastTime = time;
+}
 
-			p->pos += p->speed * mspeed * delta;
+//0-0.5ʹùؼ֡0,1, 0.5-1ʹùؼ֡1,2
+static inline f32 interpolateKeys3(const f32* keys, bool lower, f32 prop)
+{
+	return lower ? interpolate(prop, keys[0], keys[1]) : interpolate(prop, keys[1], keys[2]);
+}
 
-			p->rotation += Ps->rotation * mspeed * delta;
+#ifdef MW_USE_SSE
 
-			if (rlife < 0.5f)
-			{
-				f32 prop = rlife / 0.5f;
-				p->size = interpolate(prop, Ps->sizes[0], Ps->sizes[1]) * interpolate(prop, Ps->scales[0], Ps->scales[1]);
-				p->color = interpolate(prop, Ps->colors[0], Ps->colors[1]);
-			}
-			else
-			{
-				f32 prop = (rlife-0.5f) / 0.5f;
-				p->size = interpolate(prop, Ps->sizes[1], Ps->sizes[2]) * interpolate(prop, Ps->scales[1], Ps->scales[2]);;
-				p->color = interpolate(prop, Ps->colors[1], Ps->colors[2]);
-			}
-		}
+static inline __m128 selectPs(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 interpolateKeys3(const f32* keys, __m128 lower, __m128 prop, __m128 inv)
+{
+	__m128 k0 = selectPs(lower, _mm_set1_ps(keys[0]), _mm_set1_ps(keys[1]));
+	__m128 k1 = selectPs(lower, _mm_set1_ps(keys[1]), _mm_set1_ps(keys[2]));
+	return _mm_add_ps(_mm_mul_ps(k0, inv), _mm_mul_ps(k1, prop));
+}
+
+#endif
+
+void CParticleSystemSceneNode::simulateParticles( f32 delta, f32 grav, f32 deaccel )
+{
+	f32* posX = getStream(EPS_POSX);
+	f32* posY = getStream(EPS_POSY);
+	f32* posZ = getStream(EPS_POSZ);
+	f32* speedX = getStream(EPS_SPEEDX);
+	f32* speedY = getStream(EPS_SPEEDY);
+	f32* speedZ = getStream(EPS_SPEEDZ);
+	const f32* dirX = getStream(EPS_DIRX);
+	const f32* dirY = getStream(EPS_DIRY);
+	const f32* dirZ = getStream(EPS_DIRZ);
+	f32* sizeX = getStream(EPS_SIZEX);
+	f32* sizeY = getStream(EPS_SIZEY);
+	const f32* life = getStream(EPS_LIFE);
+	f32* maxlife = getStream(EPS_MAXLIFE);
+	f32* rotation = getStream(EPS_ROTATION);
+
+	f32 keySizeX[3];
+	f32 keySizeY[3];
+	f32 keyScale[3];
+	f32 keyColor[4][3];				//a, r, g, b
+	for (u32 k=0; k<3; ++k)
+	{
+		keySizeX[k] = Ps->sizes[k].X;
+		keySizeY[k] = Ps->sizes[k].Y;
+		keyScale[k] = Ps->scales[k];
+		keyColor[0][k] = (f32)Ps->colors[k].getAlpha();
+		keyColor[1][k] = (f32)Ps->colors[k].getRed();
+		keyColor[2][k] = (f32)Ps->colors[k].getGreen();
+		keyColor[3][k] = (f32)Ps->colors[k].getBlue();
 	}
 
-	LastAnim = anim;
-	LastTime = time;
+	const f32 slowdown = Ps->slowdown;
+	const f32 gravDelta = grav * delta;
+	const f32 deaccelDelta = deaccel * delta;
+	const f32 rotationDelta = Ps->rotation * delta;
+
+	u32 i = 0;
+
+#ifdef MW_USE_SSE
+	//Ϊ4ı, ĩβ4Ĳһ
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 vDelta = _mm_set1_ps(delta);
+	const __m128 vGrav = _mm_set1_ps(gravDelta);
+	const __m128 vDeaccel = _mm_set1_ps(deaccelDelta);
+	const __m128 vRotation = _mm_set1_ps(rotationDelta);
+	const __m128 vSlowdown = _mm_set1_ps(slowdown);
+
+	//Ĳ0ӵľֵ, maxlife1, 0õinf/nan
+	for (u32 k=LiveParticleCount; k<((LiveParticleCount + 3) & ~3u); ++k)
+		maxlife[k] = 1.0f;
+
+	for (; i<LiveParticleCount; i += 4)
+	{
+		__m128 l = _mm_loadu_ps(life + i);
+		__m128 rlife = _mm_div_ps(l, _mm_loadu_ps(maxlife + i));
+
+		__m128 mspeed = one;
+		if (slowdown > 0)
+			mspeed = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(vSlowdown, l)), zero);
+		__m128 step = _mm_mul_ps(mspeed, vDelta);
+
+		__m128 sx = _mm_sub_ps(_mm_loadu_ps(speedX + i), _mm_mul_ps(_mm_loadu_ps(dirX + i), vDeaccel));
+		__m128 sy = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(speedY + i), vGrav), _mm_mul_ps(_mm_loadu_ps(dirY + i), vDeaccel));
+		__m128 sz = _mm_sub_ps(_mm_loadu_ps(speedZ + i), _mm_mul_ps(_mm_loadu_ps(dirZ + i), vDeaccel));
+		_mm_storeu_ps(speedX + i, sx);
+		_mm_storeu_ps(speedY + i, sy);
+		_mm_storeu_ps(speedZ + i, sz);
+
+		_mm_storeu_ps(posX + i, _mm_add_ps(_mm_loadu_ps(posX + i), _mm_mul_ps(sx, step)));
+		_mm_storeu_ps(posY + i, _mm_add_ps(_mm_loadu_ps(posY + i), _mm_mul_ps(sy, step)));
+		_mm_storeu_ps(posZ + i, _mm_add_ps(_mm_loadu_ps(posZ + i), _mm_mul_ps(sz, step)));
+
+		_mm_storeu_ps(rotation + i, _mm_add_ps(_mm_loadu_ps(rotation + i), _mm_mul_ps(vRotation, mspeed)));
+
+		__m128 lower = _mm_cmplt_ps(rlife, half);
+		__m128 prop = _mm_sub_ps(_mm_mul_ps(rlife, two), _mm_andnot_ps(lower, one));
+		__m128 inv = _mm_sub_ps(one, prop);
+
+		__m128 scale = interpolateKeys3(keyScale, lower, prop, inv);
+		_mm_storeu_ps(sizeX + i, _mm_mul_ps(interpolateKeys3(keySizeX, lower, prop, inv), scale));
+		_mm_storeu_ps(sizeY + i, _mm_mul_ps(interpolateKeys3(keySizeY, lower, prop, inv), scale));
+
+		__m128i a = _mm_cvttps_epi32(interpolateKeys3(keyColor[0], lower, prop, inv));
+		__m128i r = _mm_cvttps_epi32(interpolateKeys3(keyColor[1], lower, prop, inv));
+		__m128i g = _mm_cvttps_epi32(interpolateKeys3(keyColor[2], lower, prop, inv));
+		__m128i b = _mm_cvttps_epi32(interpolateKeys3(keyColor[3], lower, prop, inv));
+		__m128i c = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(a, 24), _mm_slli_epi32(r, 16)),
+			_mm_or_si128(_mm_slli_epi32(g, 8), b));
+		_mm_storeu_si128((__m128i*)(ParticleColors + i), c);
+	}
+#endif
+
+	for (; i<LiveParticleCount; ++i)
+	{
+		f32 mspeed = 1.0f;
+		if (slowdown > 0)
+			mspeed = max_(1.0f - slowdown * life[i], 0.0f);
+		f32 step = mspeed * delta;
+
+		speedX[i] -= dirX[i] * deaccelDelta;
+		speedY[i] -= gravDelta + dirY[i] * deaccelDelta;
+		speedZ[i] -= dirZ[i] * deaccelDelta;
+
+		posX[i] += speedX[i] * step;
+		posY[i] += speedY[i] * step;
+		posZ[i] += speedZ[i] * step;
+
+		rotation[i] += rotationDelta * mspeed;
+
+		f32 rlife = life[i] / maxlife[i];
+		bool lower = rlife < 0.5f;
+		f32 prop = lower ? rlife * 2.0f : rlife * 2.0f - 1.0f;
+
+		f32 scale = interpolateKeys3(keyScale, lower, prop);
+		sizeX[i] = interpolateKeys3(keySizeX, lower, prop) * scale;
+		sizeY[i] = interpolateKeys3(keySizeY, lower, prop) * scale;
+
+		ParticleColors[i] = SColor((u32)interpolateKeys3(keyColor[0], lower, prop),
+			(u32)interpolateKeys3(keyColor[1], lower, prop),
+			(u32)interpolateKeys3(keyColor[2], lower, prop),
+			(u32)interpolateKeys3(keyColor[3], lower, prop)).color;
+	}
+}
+
+void CParticleSystemSceneNode::reserveParticles( u32 count )
+{
+	if (count <= ParticleCapacity)
+		return;
+
+	u32 capacity = max_(ParticleCapacity * 2, 64u);
+	while (capacity < count)
+		capacity *= 2;
+
+	f32* data = new f32[capacity * EPS_COUNT];
+	u32* colors = new u32[capacity];
+	u32* tiles = new u32[capacity];
+	::memset(data, 0, sizeof(f32) * capacity * EPS_COUNT);
+	::memset(colors, 0, sizeof(u32) * capacity);
+	::memset(tiles, 0, sizeof(u32) * capacity);
+
+	if (LiveParticleCount)
+	{
+		for (u32 k=0; k<EPS_COUNT; ++k)
+			Q_memcpy(data + k * capacity, sizeof(f32) * LiveParticleCount, ParticleData + k * ParticleCapacity, sizeof(f32) * LiveParticleCount);
+		Q_memcpy(colors, sizeof(u32) * LiveParticleCount, ParticleColors, sizeof(u32) * LiveParticleCount);
+		Q_memcpy(tiles, sizeof(u32) * LiveParticleCount, ParticleTiles, sizeof(u32) * LiveParticleCount);
+	}
+
+	delete[] ParticleTiles;
+	delete[] ParticleColors;
+	delete[] ParticleData;
+
+	ParticleData = data;
+	ParticleColors = colors;
+	ParticleTiles = tiles;
+	ParticleCapacity = capacity;
+}
+
+void CParticleSystemSceneNode::addParticle( const Particle& p )
+{
+	ASSERT(LiveParticleCount < ParticleCapacity);
+
+	u32 i = LiveParticleCount;
+	getStream(EPS_POSX)[i] = p.pos.X;
+	getStream(EPS_POSY)[i] = p.pos.Y;
+	getStream(EPS_POSZ)[i] = p.pos.Z;
+	getStream(EPS_BASEX)[i] = p.basepos.X;
+	getStream(EPS_BASEY)[i] = p.basepos.Y;
+	getStream(EPS_BASEZ)[i] = p.basepos.Z;
+	getStream(EPS_SPEEDX)[i] = p.speed.X;
+	getStream(EPS_SPEEDY)[i] = p.speed.Y;
+	getStream(EPS_SPEEDZ)[i] = p.speed.Z;
+	getStream(EPS_DIRX)[i] = p.dir.X;
+	getStream(EPS_DIRY)[i] = p.dir.Y;
+	getStream(EPS_DIRZ)[i] = p.dir.Z;
+	getStream(EPS_SIZEX)[i] = p.size.X;
+	getStream(EPS_SIZEY)[i] = p.size.Y;
+	getStream(EPS_LIFE)[i] = p.life;
+	getStream(EPS_MAXLIFE)[i] = p.maxlife;
+	getStream(EPS_ROTATION)[i] = p.rotation;
+	ParticleColors[i] = p.color.color;
+	ParticleTiles[i] = p.tile;
+
+	++LiveParticleCount;
+}
+
+void CParticleSystemSceneNode::removeParticle( u32 index )
+{
+	ASSERT(index < LiveParticleCount);
+
+	u32 last = --LiveParticleCount;
+	if (index == last)
+		return;
+
+	for (u32 k=0; k<EPS_COUNT; ++k)
+	{
+		f32* stream = ParticleData + k * ParticleCapacity;
+		stream[index] = stream[last];
+	}
+	ParticleColors[index] = ParticleColors[last];
+	ParticleTiles[index] = ParticleTiles[last];
+}
+
+void CParticleSystemSceneNode::clearParticles()
+{
+	ParticleSystemServices->freeParticles(LiveParticleCount);
+	LiveParticleCount = 0;
 }
 
 void CParticleSystemSceneNode::render() const
@@ -269,91 +498,153 @@ u32 CParticleSystemSceneNode::onFillVertexBuffer( SVertex_PCT* vertices, u32 ver
 	vector3df up( view[1], view[5], view[9] );
 	vector3df dir( view[2], view[6], view[10]);
 
-	u32 vCount = 0;
+	u32 count = min_(LiveParticleCount, vertexCount / 4);
+
+	const f32* baseX = getStream(EPS_BASEX);
+	const f32* baseY = getStream(EPS_BASEY);
+	const f32* baseZ = getStream(EPS_BASEZ);
+	const f32* posX = getStream(EPS_POSX);
+	const f32* posY = getStream(EPS_POSY);
+	const f32* posZ = getStream(EPS_POSZ);
+	const f32* sizeX = getStream(EPS_SIZEX);
+	const f32* sizeY = getStream(EPS_SIZEY);
 
 	//normal particles
 	if (Ps->billboard)			//world
 	{
-		for (PLENTRY e = LiveParticleList.Flink; e != &LiveParticleList; )
-		{
-			if (vCount + 4 > vertexCount)
-				break;
+		u32 i = 0;
 
-			Particle* p = reinterpret_cast<Particle*>CONTAINING_RECORD(e, Particle, Link);
-			e = e->Flink;
+#ifdef MW_USE_SSE
+		//תͨÿ4, 
+		if (!Ps->ribbontype)
+		{
+			const f32* rotation = getStream(EPS_ROTATION);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 rx = _mm_set1_ps(right.X * Scale), ry = _mm_set1_ps(right.Y * Scale), rz = _mm_set1_ps(right.Z * Scale);
+			const __m128 ux = _mm_set1_ps(up.X * Scale), uy = _mm_set1_ps(up.Y * Scale), uz = _mm_set1_ps(up.Z * Scale);
 
-			vector3df w = right * p->size.X * Scale;
-			vector3df h = up * p->size.Y * Scale;
+			f32 corners[4][3][4];			//, , 
 
-			if (p->rotation != 0.0f)
-			{
-				quaternion q(p->rotation, -dir);
-				 fillParticleRect(p, getParticleUVFlag(p), &vertices[vCount], w, h, q);
-			}
-			else
+			for (; i + 4 <= count; i += 4)
 			{
-				fillParticleRect(p, getParticleUVFlag(p), &vertices[vCount], w, h);
-			}
-
-			SColor c = p->color;
-			if (EnableModelAlpha)
-				c.setAlpha((u32)(p->color.getAlpha() * ModelAlpha));
+				if (_mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(rotation + i), zero)))
+				{
+					for (u32 k=i; k<i+4; ++k)
+						fillBillboardParticle(k, &vertices[k * 4], right, up, dir);
+					continue;
+				}
 
-			vertices[vCount + 0].Color = 
-				vertices[vCount + 1].Color = 
-				vertices[vCount + 2].Color = 
-				vertices[vCount + 3].Color = c;
+				__m128 sx = _mm_loadu_ps(sizeX + i);
+				__m128 sy = _mm_loadu_ps(sizeY + i);
+				__m128 wx = _mm_mul_ps(rx, sx), wy = _mm_mul_ps(ry, sx), wz = _mm_mul_ps(rz, sx);
+				__m128 hx = _mm_mul_ps(ux, sy), hy = _mm_mul_ps(uy, sy), hz = _mm_mul_ps(uz, sy);
+
+				__m128 cx = _mm_add_ps(_mm_loadu_ps(baseX + i), _mm_loadu_ps(posX + i));
+				__m128 cy = _mm_add_ps(_mm_loadu_ps(baseY + i), _mm_loadu_ps(posY + i));
+				__m128 cz = _mm_add_ps(_mm_loadu_ps(baseZ + i), _mm_loadu_ps(posZ + i));
+
+				//worldpos - w + h, worldpos + w + h, worldpos - w - h, worldpos + w - h
+				__m128 mx = _mm_sub_ps(cx, wx), my = _mm_sub_ps(cy, wy), mz = _mm_sub_ps(cz, wz);
+				__m128 px = _mm_add_ps(cx, wx), py = _mm_add_ps(cy, wy), pz = _mm_add_ps(cz, wz);
+				_mm_storeu_ps(corners[0][0], _mm_add_ps(mx, hx));
+				_mm_storeu_ps(corners[0][1], _mm_add_ps(my, hy));
+				_mm_storeu_ps(corners[0][2], _mm_add_ps(mz, hz));
+				_mm_storeu_ps(corners[1][0], _mm_add_ps(px, hx));
+				_mm_storeu_ps(corners[1][1], _mm_add_ps(py, hy));
+				_mm_storeu_ps(corners[1][2], _mm_add_ps(pz, hz));
+				_mm_storeu_ps(corners[2][0], _mm_sub_ps(mx, hx));
+				_mm_storeu_ps(corners[2][1], _mm_sub_ps(my, hy));
+				_mm_storeu_ps(corners[2][2], _mm_sub_ps(mz, hz));
+				_mm_storeu_ps(corners[3][0], _mm_sub_ps(px, hx));
+				_mm_storeu_ps(corners[3][1], _mm_sub_ps(py, hy));
+				_mm_storeu_ps(corners[3][2], _mm_sub_ps(pz, hz));
+
+				for (u32 k=0; k<4; ++k)
+				{
+					SVertex_PCT* v = &vertices[(i + k) * 4];
+					const ParticleSystem::TexCoordSet& tile = Ps->Tiles[ParticleTiles[i + k]];
+					for (u32 n=0; n<4; ++n)
+					{
+						v[n].Pos.set(corners[n][0][k], corners[n][1][k], corners[n][2][k]);
+						v[n].TCoords = tile.tc[n];
+					}
+					fillParticleColor(i + k, v);
+				}
+			}
+		}
+#endif
 
-			vCount += 4;
+		for (; i<count; ++i)
+		{
+			fillBillboardParticle(i, &vertices[i * 4], right, up, dir);
 		}
 	}
 	else
 	{
-		for (PLENTRY e = LiveParticleList.Flink; e != &LiveParticleList;)
+		for (u32 i=0; i<count; ++i)
 		{
-			if (vCount + 4 >= vertexCount)
-				break;
+			SVertex_PCT* v = &vertices[i * 4];
 
-			Particle* p = reinterpret_cast<Particle*>CONTAINING_RECORD(e, Particle, Link);
-			e = e->Flink;
-
-			f32 w = p->size.X * Scale;		
-			f32 h = p->size.Y * Scale;
+			f32 w = sizeX[i] * Scale;		
+			f32 h = sizeY[i] * Scale;
 
 			if (!Ps->ribbontype)
 			{
-				fillParticleRect(p, getParticleUVFlag(p), &vertices[vCount], vector3df(w,0,0), vector3df(0,0,h));
+				fillParticleRect(i, getParticleUVFlag(i), v, vector3df(w,0,0), vector3df(0,0,h));
 			}
 			else
 			{
-				vector3df center = p->basepos;
+				vector3df center(baseX[i], baseY[i], baseZ[i]);
 				AbsoluteTransformation.transformVect(center);
-				vector3df pos = p->pos;
+				vector3df pos(posX[i], posY[i], posZ[i]);
 
-				vertices[vCount + 0].Pos = center + pos + vector3df(-w, 0, h);			
-				vertices[vCount + 1].Pos = center + pos + vector3df(w, 0, h);		
-				vertices[vCount + 2].Pos = center + pos + vector3df(-w, 0,- h);
-				vertices[vCount + 3].Pos = center + pos + vector3df(w, 0, -h);
+				v[0].Pos = center + pos + vector3df(-w, 0, h);			
+				v[1].Pos = center + pos + vector3df(w, 0, h);		
+				v[2].Pos = center + pos + vector3df(-w, 0,- h);
+				v[3].Pos = center + pos + vector3df(w, 0, -h);
 			}
-		
-			vertices[vCount + 0].TCoords = Ps->Tiles[p->tile].tc[0];
-			vertices[vCount + 1].TCoords = Ps->Tiles[p->tile].tc[1];
-			vertices[vCount + 2].TCoords = Ps->Tiles[p->tile].tc[2];
-			vertices[vCount + 3].TCoords = Ps->Tiles[p->tile].tc[3];
-
-			SColor c = p->color;
-			if (EnableModelAlpha)
-				c.setAlpha((u32)(p->color.getAlpha() * ModelAlpha));
-
-			vertices[vCount + 0].Color = 
-				vertices[vCount + 1].Color = 
-				vertices[vCount + 2].Color = 
-				vertices[vCount + 3].Color = c;
-
-			vCount += 4;
+
+			const ParticleSystem::TexCoordSet& tile = Ps->Tiles[ParticleTiles[i]];
+			v[0].TCoords = tile.tc[0];
+			v[1].TCoords = tile.tc[1];
+			v[2].TCoords = tile.tc[2];
+			v[3].TCoords = tile.tc[3];
+
+			fillParticleColor(i, v);
 		}
 	}
-	return vCount;
+	return count * 4;
+}
+
+void CParticleSystemSceneNode::fillBillboardParticle( u32 index, SVertex_PCT* vertices, const vector3df& right, const vector3df& up, const vector3df& dir ) const
+{
+	vector3df w = right * getStream(EPS_SIZEX)[index] * Scale;
+	vector3df h = up * getStream(EPS_SIZEY)[index] * Scale;
+
+	f32 rotation = getStream(EPS_ROTATION)[index];
+	if (rotation != 0.0f)
+	{
+		quaternion q(rotation, -dir);
+		fillParticleRect(index, getParticleUVFlag(index), vertices, w, h, q);
+	}
+	else
+	{
+		fillParticleRect(index, getParticleUVFlag(index), vertices, w, h);
+	}
+
+	fillParticleColor(index, vertices);
+}
+
+void CParticleSystemSceneNode::fillParticleColor( u32 index, SVertex_PCT* vertices ) const
+{
+	SColor c = ParticleColors[index];
+	if (EnableModelAlpha)
+		c.setAlpha((u32)(c.getAlpha() * ModelAlpha));
+
+	vertices[0].Color = 
+		vertices[1].Color = 
+		vertices[2].Color = 
+		vertices[3].Color = c;
 }
 
 void CParticleSystemSceneNode::onUpdated()
@@ -396,9 +687,11 @@ void CParticleSystemSceneNode::setWholeColor( bool enable, SColor color )
 	ModelColor = color;
 }
 
-void CParticleSystemSceneNode::fillParticleRect( Particle* p, u32 uvflag, SVertex_PCT* vertices, const vector3df& w, const vector3df& h ) const
+void CParticleSystemSceneNode::fillParticleRect( u32 index, u32 uvflag, SVertex_PCT* vertices, const vector3df& w, const vector3df& h ) const
 {
-	vector3df worldpos = p->basepos + p->pos;
+	vector3df basepos(getStream(EPS_BASEX)[index], getStream(EPS_BASEY)[index], getStream(EPS_BASEZ)[index]);
+	vector3df worldpos = basepos + vector3df(getStream(EPS_POSX)[index], getStream(EPS_POSY)[index], getStream(EPS_POSZ)[index]);
+	const ParticleSystem::TexCoordSet& tile = Ps->Tiles[ParticleTiles[index]];
 
 	switch(uvflag)
 	{
@@ -409,70 +702,72 @@ void CParticleSystemSceneNode::fillParticleRect( Particle* p, u32 uvflag, SVerte
 			vertices[2].Pos = worldpos -  w - h;
 			vertices[3].Pos = worldpos + w - h;
 
-			vertices[0].TCoords = Ps->Tiles[p->tile].tc[0];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[1];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[2];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[3];
+			vertices[0].TCoords = tile.tc[0];
+			vertices[1].TCoords = tile.tc[1];
+			vertices[2].TCoords = tile.tc[2];
+			vertices[3].TCoords = tile.tc[3];
 		}
 		break;
 	case 1:
 		{
-			vertices[0].Pos = p->basepos + h;
+			vertices[0].Pos = basepos + h;
 			vertices[1].Pos = worldpos +  w + h;
-			vertices[2].Pos = p->basepos - h;
+			vertices[2].Pos = basepos - h;
 			vertices[3].Pos = worldpos + w - h;
 
-			vertices[0].TCoords = Ps->Tiles[p->tile].tc[2];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[3];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[0];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[1];
+			vertices[0].TCoords = tile.tc[2];
+			vertices[1].TCoords = tile.tc[3];
+			vertices[2].TCoords = tile.tc[0];
+			vertices[3].TCoords = tile.tc[1];
 		}
 		break;
 	case 2:
 		{
-			vertices[0].Pos = p->basepos - w;
-			vertices[1].Pos = p->basepos + w;
+			vertices[0].Pos = basepos - w;
+			vertices[1].Pos = basepos + w;
 			vertices[2].Pos = worldpos - w - h;
 			vertices[3].Pos = worldpos + w - h;
 
-			vertices[0].TCoords = Ps->Tiles[p->tile].tc[1];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[2];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[3];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[0];
+			vertices[0].TCoords = tile.tc[1];
+			vertices[1].TCoords = tile.tc[2];
+			vertices[2].TCoords = tile.tc[3];
+			vertices[3].TCoords = tile.tc[0];
 		}
 		break;
 	case 3:
 		{
 			vertices[0].Pos = worldpos - w + h;
-			vertices[1].Pos = p->basepos + h;
+			vertices[1].Pos = basepos + h;
 			vertices[2].Pos = worldpos - w - h;
-			vertices[3].Pos = p->basepos - h;
+			vertices[3].Pos = basepos - h;
 
-			vertices[ 0].TCoords = Ps->Tiles[p->tile].tc[0];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[1];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[2];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[3];
+			vertices[ 0].TCoords = tile.tc[0];
+			vertices[1].TCoords = tile.tc[1];
+			vertices[2].TCoords = tile.tc[2];
+			vertices[3].TCoords = tile.tc[3];
 		}
 		break;
 	case 4:
 		{
 			vertices[0].Pos = worldpos- w + h;
 			vertices[1].Pos = worldpos +  w + h;
-			vertices[2].Pos = p->basepos - w;
-			vertices[3].Pos = p->basepos + w;
+			vertices[2].Pos = basepos - w;
+			vertices[3].Pos = basepos + w;
 
-			vertices[0].TCoords = Ps->Tiles[p->tile].tc[3];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[0];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[1];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[2];
+			vertices[0].TCoords = tile.tc[3];
+			vertices[1].TCoords = tile.tc[0];
+			vertices[2].TCoords = tile.tc[1];
+			vertices[3].TCoords = tile.tc[2];
 		}
 		break;
 	}
 }
 
-void CParticleSystemSceneNode::fillParticleRect( Particle* p, u32 uvflag, SVertex_PCT* vertices, const vector3df& w, const vector3df& h, const quaternion& q ) const
+void CParticleSystemSceneNode::fillParticleRect( u32 index, u32 uvflag, SVertex_PCT* vertices, const vector3df& w, const vector3df& h, const quaternion& q ) const
 {
-	vector3df worldpos = p->basepos + p->pos;
+	vector3df basepos(getStream(EPS_BASEX)[index], getStream(EPS_BASEY)[index], getStream(EPS_BASEZ)[index]);
+	vector3df worldpos = basepos + vector3df(getStream(EPS_POSX)[index], getStream(EPS_POSY)[index], getStream(EPS_POSZ)[index]);
+	const ParticleSystem::TexCoordSet& tile = Ps->Tiles[ParticleTiles[index]];
 
 	vector3df a = q * (w - h);
 	vector3df b = q * (w + h);
@@ -488,82 +783,84 @@ void CParticleSystemSceneNode::fillParticleRect( Particle* p, u32 uvflag, SVerte
 			vertices[2].Pos = worldpos - b;
 			vertices[3].Pos = worldpos +  a;
 
-			vertices[0].TCoords = Ps->Tiles[p->tile].tc[0];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[1];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[2];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[3];
+			vertices[0].TCoords = tile.tc[0];
+			vertices[1].TCoords = tile.tc[1];
+			vertices[2].TCoords = tile.tc[2];
+			vertices[3].TCoords = tile.tc[3];
 		}
 		break;
 	case 1:
 		{
-			vertices[0].Pos = p->basepos + d;
+			vertices[0].Pos = basepos + d;
 			vertices[1].Pos = worldpos +  b;
-			vertices[2].Pos = p->basepos - d;
+			vertices[2].Pos = basepos - d;
 			vertices[3].Pos = worldpos + a;
 
-			vertices[0].TCoords = Ps->Tiles[p->tile].tc[2];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[3];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[0];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[1];
+			vertices[0].TCoords = tile.tc[2];
+			vertices[1].TCoords = tile.tc[3];
+			vertices[2].TCoords = tile.tc[0];
+			vertices[3].TCoords = tile.tc[1];
 		}
 		break;
 	case 2:
 		{
-			vertices[0].Pos = p->basepos - c;
-			vertices[1].Pos = p->basepos + c;
+			vertices[0].Pos = basepos - c;
+			vertices[1].Pos = basepos + c;
 			vertices[2].Pos = worldpos - b;
 			vertices[3].Pos = worldpos + a;
 
-			vertices[0].TCoords = Ps->Tiles[p->tile].tc[1];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[2];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[3];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[0];
+			vertices[0].TCoords = tile.tc[1];
+			vertices[1].TCoords = tile.tc[2];
+			vertices[2].TCoords = tile.tc[3];
+			vertices[3].TCoords = tile.tc[0];
 		}
 		break;
 	case 3:
 		{
 			vertices[0].Pos = worldpos - a;
-			vertices[1].Pos = p->basepos + d;
+			vertices[1].Pos = basepos + d;
 			vertices[2].Pos = worldpos - b;
-			vertices[3].Pos = p->basepos - d;
+			vertices[3].Pos = basepos - d;
 
-			vertices[ 0].TCoords = Ps->Tiles[p->tile].tc[0];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[1];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[2];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[3];
+			vertices[ 0].TCoords = tile.tc[0];
+			vertices[1].TCoords = tile.tc[1];
+			vertices[2].TCoords = tile.tc[2];
+			vertices[3].TCoords = tile.tc[3];
 		}
 		break;
 	case 4:
 		{
 			vertices[0].Pos = worldpos- a;
 			vertices[1].Pos = worldpos +  b;
-			vertices[2].Pos = p->basepos - c; 
-			vertices[3].Pos = p->basepos + c;
+			vertices[2].Pos = basepos - c; 
+			vertices[3].Pos = basepos + c;
 
-			vertices[0].TCoords = Ps->Tiles[p->tile].tc[3];
-			vertices[1].TCoords = Ps->Tiles[p->tile].tc[0];
-			vertices[2].TCoords = Ps->Tiles[p->tile].tc[1];
-			vertices[3].TCoords = Ps->Tiles[p->tile].tc[2];
+			vertices[0].TCoords = tile.tc[3];
+			vertices[1].TCoords = tile.tc[0];
+			vertices[2].TCoords = tile.tc[1];
+			vertices[3].TCoords = tile.tc[2];
 		}
 		break;
 	}
 }
 
-u32 CParticleSystemSceneNode::getParticleUVFlag( Particle* p ) const
+u32 CParticleSystemSceneNode::getParticleUVFlag( u32 index ) const
 {
 	if (!Ps->ribbontype)
 		return 0;
 
-	if(p->pos.X > 0.0f)
+	f32 x = getStream(EPS_POSX)[index];
+	f32 z = getStream(EPS_POSZ)[index];
+	if(x > 0.0f)
 	{
-		if(p->pos.X > fabs(p->pos.Z))
+		if(x > fabs(z))
 			return 1;
 		else
 			return 2;
 	}
 	else
 	{
-		if(-p->pos.X > fabs(p->pos.Z))
+		if(-x > fabs(z))
 			return 3;
 		else
 			return 4;
@@ -37,10 +37,18 @@ public:
 protected:
 	void setMaterial(SMaterial& material) const;
 
-	void fillParticleRect(Particle* p, u32 uvflag, SVertex_PCT* vertices, const vector3df& w, const vector3df& h) const;
-	void fillParticleRect(Particle* p, u32 uvflag, SVertex_PCT* vertices, const vector3df& w, const vector3df& h, const quaternion& q) const;
+	void fillParticleRect(u32 index, u32 uvflag, SVertex_PCT* vertices, const vector3df& w, const vector3df& h) const;
+	void fillParticleRect(u32 index, u32 uvflag, SVertex_PCT* vertices, const vector3df& w, const vector3df& h, const quaternion& q) const;
+	void fillBillboardParticle(u32 index, SVertex_PCT* vertices, const vector3df& right, const vector3df& up, const vector3df& dir) const;
+	void fillParticleColor(u32 index, SVertex_PCT* vertices) const;
 
-	u32 getParticleUVFlag(Particle* p) const;
+	u32 getParticleUVFlag(u32 index) const;
+
+	void reserveParticles(u32 count);
+	void addParticle(const Particle& p);
+	void removeParticle(u32 index);
+	void clearParticles();
+	void simulateParticles(f32 delta, f32 grav, f32 deaccel);
 
 private:
 	struct SHint
@@ -58,6 +66,32 @@ private:
 		s32 en;
 	};
 
+	//Ӱ洢, ÿParticleCapacity(4ı), һ
+	enum E_PARTICLE_STREAM
+	{
+		EPS_POSX = 0,
+		EPS_POSY,
+		EPS_POSZ,
+		EPS_BASEX,
+		EPS_BASEY,
+		EPS_BASEZ,
+		EPS_SPEEDX,
+		EPS_SPEEDY,
+		EPS_SPEEDZ,
+		EPS_DIRX,
+		EPS_DIRY,
+		EPS_DIRZ,
+		EPS_SIZEX,
+		EPS_SIZEY,
+		EPS_LIFE,
+		EPS_MAXLIFE,
+		EPS_ROTATION,
+
+		EPS_COUNT,
+	};
+
+	f32* getStream(E_PARTICLE_STREAM s) const { return ParticleData + s * ParticleCapacity; }
+
 private:
 	CParticleSystemServices*	ParticleSystemServices;
 	IM2SceneNode*		ParentM2Node;
@@ -65,7 +99,10 @@ private:
 	matrix4*		CurrentProjection;
 	matrix4*		CurrentView;
 
-	LENTRY		LiveParticleList;
+	f32*		ParticleData;
+	u32*		ParticleColors;
+	u32*		ParticleTiles;
+	u32		ParticleCapacity;
 	u32		LiveParticleCount;
 	u32		CurrentAnim;
 	u32		CurrentFrame;
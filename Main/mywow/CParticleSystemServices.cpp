@@ -3,12 +3,10 @@
 #include "mywow.h"
 
 CParticleSystemServices::CParticleSystemServices( u32 poolQuota, u32 bufferQuota, float density)
-	: PoolQuota(poolQuota), LackParticle(false)
+	: PoolQuota(poolQuota), ActiveParticles(0), LackParticle(false)
 {
 	BufferQuota = min_(bufferQuota, IHardwareBufferServices::MAX_QUADS());
 
-	ParticlePool.allocateAll(PoolQuota);
-
 	setParticleDensity(density);
 
 	ParticleFactor = 1.0f;
@@ -52,18 +50,23 @@ void CParticleSystemServices::updateVertices(u32 numVertices)
 	g_Engine->getHardwareBufferServices()->updateHardwareBuffer(BufferParam.vbuffer0, numVertices);
 }
 
-Particle* CParticleSystemServices::getParticle()
+u32 CParticleSystemServices::allocParticles( u32 count )
 {
-	Particle* p = ParticlePool.get();
-	if (!p)
+	u32 avail = PoolQuota > ActiveParticles ? PoolQuota - ActiveParticles : 0;
+	if (count > avail)
+	{
+		count = avail;
 		LackParticle = true;
+	}
 
-	return p;
+	ActiveParticles += count;
+	return count;
 }
 
-void CParticleSystemServices::putParticle( Particle* p )
+void CParticleSystemServices::freeParticles( u32 count )
 {
-	ParticlePool.put(p);
+	ASSERT(count <= ActiveParticles);
+	ActiveParticles -= count;
 }
 
 void CParticleSystemServices::adjustParticles()
@@ -1,7 +1,6 @@
 #pragma once
 
 #include "IParticleSystemServices.h"
-#include "IResourcePool.h"
 #include "S3DVertex.h"
 
 class CParticleSystemServices : public IParticleSystemServices
@@ -15,13 +14,13 @@ public:
 	virtual void setParticleDensity(float density) { ParticleDensity = min_(1.0f, density); }
 	virtual f32 getParticleDensity() const { return ParticleDensity; }
 	
-	virtual u32 getActiveParticlesCount() const { return ParticlePool.getUsedSize(); }
+	virtual u32 getActiveParticlesCount() const { return ActiveParticles; }
 	virtual void adjustParticles();
 
 	void updateVertices(u32 numVertices);
 
-	Particle* getParticle();
-	void putParticle(Particle* p);
+	u32 allocParticles(u32 count);
+	void freeParticles(u32 count);
 
 	f32 getParticleDynamicDensity() const { return ParticleDensity * ParticleFactor; }
 	u32 getMaxVertexCount() const { return BufferQuota * 4; }
@@ -31,9 +30,8 @@ private:
 	void createBuffer();
 
 private:
-	IResourcePool<Particle>			ParticlePool;
-
 	u32		PoolQuota;
+	u32		ActiveParticles;
 	u32		BufferQuota;
 
 	f32	ParticleDensity;
@@ -1,7 +1,6 @@
 #include "stdafx.h"
 #include "CResourceLoader.h"
 #include "mywow.h"
-#include "CMemFile.h"
 #include "CFileM2.h"
 #include "CBLPImage.h"
 #include "CPVRImage.h"
@@ -10,8 +9,23 @@
 #include "CFileADT.h"
 #include "CFileWMO.h"
 
+//ͬʱwmo, wmom2
+static const f32 g_TaskTypeBias[] =
+{
+	0.0f,			//ET_NONE
+	64.0f,			//ET_M2
+	32.0f,			//ET_WMO
+	0.0f,			//ET_ADT
+	0.0f,			//ET_ANIM
+};
+
+//ƶ˾ʱλŶӵ
+static const f32 g_RekeyDistance = 16.0f;
+
 CResourceLoader::CResourceLoader()
-	: MultiThread(false), StopLoading(false), Suspended(true)
+	: MultiThread(false), StopLoading(false), NumWorkers(0), NumLoading(0), TaskSerial(0),
+	BudgetTimeLimit(DEFAULT_BUDGET_TIME), BudgetByteLimit(DEFAULT_BUDGET_BYTES),
+	BudgetTime(0), BudgetBytes(0), BudgetTasks(0), CompletedTaskPopped(false)
 {
 	M2Cache_Character.setCacheLimit(10);
 	M2Cache_Item.setCacheLimit(10);
@@ -31,8 +45,6 @@ CResourceLoader::CResourceLoader()
 	ADTCache.setCacheLimit(5);
 	WMOCache.setCacheLimit(0);
 
-	currentTask.file = NULL_PTR;
-
 	INIT_LOCK(&cs);
 	INIT_LOCK(&m2CS);
 	INIT_LOCK(&imageCS);
@@ -45,15 +57,10 @@ CResourceLoader::CResourceLoader()
 	INIT_LOCK(&wmoCS);
 
 	//thread
-	INIT_EVENT(&hLoadingEvent, "LoadingEvent"); 
-
-	ThreadParam.loader = this;
-
-	INIT_THREAD(&hThread, LoadingThreadFunc, &ThreadParam, true);
+	INIT_EVENT(&hTaskEvent, "LoadingTaskEvent");
+	INIT_EVENT(&hIdleEvent, "LoadingIdleEvent");
 
-	Suspended = true;
-
-	//::SetThreadPriority(hThread, THREAD_PRIORITY_BELOW_NORMAL);
+	memset(Workers, 0, sizeof(Workers));
 }
 
 CResourceLoader::~CResourceLoader()
@@ -69,10 +76,14 @@ CResourceLoader::~CResourceLoader()
 	DESTROY_LOCK(&m2CS);
 	DESTROY_LOCK(&cs); 
 
-	ASSERT(!currentTask.file);
+	ASSERT(completedList.empty());
+	ASSERT(NumWorkers == 0);
+
+	for (u32 i=0; i<(u32)RetiredAnimBlocks.size(); ++i)
+		delete[] RetiredAnimBlocks[i];
 
-	DESTROY_THREAD(&hThread);
-	DESTROY_EVENT(&hLoadingEvent);
+	DESTROY_EVENT(&hIdleEvent);
+	DESTROY_EVENT(&hTaskEvent);
 
 	ADTCache.flushCache();
 	WMOCache.flushCache();
@@ -106,26 +117,17 @@ IImage* CResourceLoader::loadJPGAsImage( const c8* filename )
 	if (MultiThread)
 		BEGIN_LOCK(&imageCS);
 
-	IReadFile* rfile = g_Engine->getFileSystem()->createAndOpenFile(realfilename, true);
-	u32 size = rfile->getSize();
-	if (size <= 1)
+	IMemFile* memFile = g_Engine->getFileSystem()->createMemFile(realfilename, realfilename, true);
+	if (!memFile)
 	{
 		if (MultiThread)
 			END_LOCK(&imageCS);
 
-		delete rfile;
 		return NULL_PTR;
 	}
 
-	u8* buffer = (u8*)Z_AllocateTempMemory(size);
-	u32 readSize = rfile->read(buffer, size);
-	ASSERT(readSize == size);
-	delete rfile;
-
 	IImage* image = NULL_PTR;
 
-	IMemFile* memFile = new CMemFile(buffer, size, realfilename, true);
-
 	if (JpgLoader.isALoadableFileExtension(realfilename))
 	{	
 		image = JpgLoader.loadAsImage(memFile);
@@ -151,26 +153,17 @@ IImage* CResourceLoader::loadPNGAsImage(const c8* filename)
 	if (MultiThread)
 		BEGIN_LOCK(&imageCS);
 
-	IReadFile* rfile = g_Engine->getFileSystem()->createAndOpenFile(realfilename, true);
-	u32 size = rfile->getSize();
-	if (size <= 1)
+	IMemFile* memFile = g_Engine->getFileSystem()->createMemFile(realfilename, realfilename, true);
+	if (!memFile)
 	{
 		if (MultiThread)
 			END_LOCK(&imageCS);
 
-		delete rfile;
 		return NULL_PTR;
 	}
 
-	u8* buffer = (u8*)Z_AllocateTempMemory(size);
-	u32 readSize = rfile->read(buffer, size);
-	ASSERT(readSize == size);
-	delete rfile;
-
 	IImage* image = NULL_PTR;
 
-	IMemFile* memFile = new CMemFile(buffer, size, realfilename, true);
-
 	if (PngLoader.isALoadableFileExtension(realfilename))
 	{	
 		image = PngLoader.loadAsImage(memFile);
@@ -442,14 +435,14 @@ IFileM2* CResourceLoader::loadM2( const c8* filename, bool videobuild )
 	normalizeFileName(filename, realfilename, QMAX_PATH);
 	Q_strlwr(realfilename);
 
-	if (MultiThread)
-		BEGIN_LOCK(&m2CS);
-
 	IFileM2* m2 = NULL_PTR;
 	IResourceCache<IFileM2>* cache = getM2Cache(realfilename);
 
 	if (cache)
 	{
+		if (MultiThread)
+			BEGIN_LOCK(&m2CS);
+
 		m2 = cache->tryLoadFromCache(realfilename);
 		if (m2)
 		{
@@ -461,40 +454,71 @@ IFileM2* CResourceLoader::loadM2( const c8* filename, bool videobuild )
 
 			return m2;
 		}
+
+		if (MultiThread)
+			END_LOCK(&m2CS);
 	}
 
-	IMemFile* file = g_Engine->getWowEnvironment()->openFile(realfilename);
+	//߳̿ͬʱ
+	//ֱm2ļĻ, ʱڴ
+	IMemFile* file = g_Engine->getWowEnvironment()->openFile(realfilename, false);
 	if (file && M2Loader.isALoadableFileExtension(realfilename))
 	{	
-		m2 = M2Loader.loadM2(file);
+		m2 = M2Loader.loadM2(file);			//filem2
+		file = NULL_PTR;
 		if(m2 && cache)
 		{
 			m2->setFileName(realfilename);
 
+			if (MultiThread)
+				BEGIN_LOCK(&m2CS);
+
+			IFileM2* cached = cache->tryLoadFromCache(realfilename);		//߳Ѽͬһļ, صǸִ߳
+			if (cached)
+			{
+				m2->drop();
+				m2 = cached;
+			}
+			else
+			{
+				cache->addToCache(m2);
+
+				//ڻص, ̴߳cacheȡʱص
+				onM2Loaded(m2);
+			}
+
 			if (videobuild)
 				m2->buildVideoResources();
 
-			cache->addToCache(m2);
+			if (MultiThread)
+				END_LOCK(&m2CS);
 		}
-	}
-
-	delete file;
+		else if (m2)
+		{
+			if (MultiThread)
+				BEGIN_LOCK(&m2CS);
 
-	if (MultiThread)
-		END_LOCK(&m2CS);
+			onM2Loaded(m2);
 
-	//callback
-	if (m2)
-	{
-		for (T_M2LoadedList::const_iterator itr = M2LoadedCallbackList.begin(); itr != M2LoadedCallbackList.end(); ++itr)
-		{
-			(*itr)->onM2Loaded(m2);
+			if (MultiThread)
+				END_LOCK(&m2CS);
 		}
 	}
+
+	delete file;
 	
 	return m2;
 }
 
+void CResourceLoader::onM2Loaded( IFileM2* m2 )
+{
+	//߳m2CS, ̹߳ûصб
+	for (T_M2LoadedList::const_iterator itr = M2LoadedCallbackList.begin(); itr != M2LoadedCallbackList.end(); ++itr)
+	{
+		(*itr)->onM2Loaded(m2);
+	}
+}
+
 IFileWDT* CResourceLoader::loadWDT( const c8* filename, s32 mapid, bool simple )
 {
 	if (strlen(filename) == 0)
@@ -530,14 +554,14 @@ IFileADT* CResourceLoader::loadADT( const c8* filename, bool simple, bool videob
 	normalizeFileName(filename, realfilename, QMAX_PATH);
 	Q_strlwr(realfilename);
 
-	if (MultiThread)
-		BEGIN_LOCK(&adtCS);
-
 	IFileADT* adt = NULL_PTR;
 
 	//simple²뻺
 	if (!simple)
 	{
+		if (MultiThread)
+			BEGIN_LOCK(&adtCS);
+
 		adt = ADTCache.tryLoadFromCache(realfilename);
 		if (adt)
 		{
@@ -549,6 +573,9 @@ IFileADT* CResourceLoader::loadADT( const c8* filename, bool simple, bool videob
 
 			return adt;
 		}
+
+		if (MultiThread)
+			END_LOCK(&adtCS);
 	}
 
 	IMemFile* file = g_Engine->getWowEnvironment()->openFile(realfilename);
@@ -565,19 +592,31 @@ IFileADT* CResourceLoader::loadADT( const c8* filename, bool simple, bool videob
 			{
 				adt->setFileName(realfilename);
 
+				if (MultiThread)
+					BEGIN_LOCK(&adtCS);
+
+				IFileADT* cached = ADTCache.tryLoadFromCache(realfilename);
+				if (cached)
+				{
+					adt->drop();
+					adt = cached;
+				}
+				else
+				{
+					ADTCache.addToCache(adt);	
+				}
+
 				if (videobuild)
 					adt->buildVideoResources();
 
-				ADTCache.addToCache(adt);	
+				if (MultiThread)
+					END_LOCK(&adtCS);
 			}	
 		}
 	}
 
 	delete file;
 
-	if (MultiThread)
-		END_LOCK(&adtCS);
-
 	return adt;
 }
 
@@ -637,6 +676,9 @@ IFileWMO* CResourceLoader::loadWMO( const c8* filename, bool videobuild )
 		return wmo;
 	}
 
+	if (MultiThread)
+		END_LOCK(&wmoCS);
+
 	IMemFile* file = g_Engine->getWowEnvironment()->openFile(realfilename);
 	if (file && WMOLoader.isALoadableFileExtension(realfilename))
 	{	
@@ -645,25 +687,37 @@ IFileWMO* CResourceLoader::loadWMO( const c8* filename, bool videobuild )
 		{
 			wmo->setFileName(realfilename);
 
+			if (MultiThread)
+				BEGIN_LOCK(&wmoCS);
+
+			IFileWMO* cached = WMOCache.tryLoadFromCache(realfilename);
+			if (cached)
+			{
+				wmo->drop();
+				wmo = cached;
+			}
+			else
+			{
+				WMOCache.addToCache(wmo);		
+			}
+
 			if (videobuild)
 				wmo->buildVideoResources();
 
-			WMOCache.addToCache(wmo);		
+			if (MultiThread)
+				END_LOCK(&wmoCS);
 		}
 	}
 
 	delete file;
 
-	if (MultiThread)
-		END_LOCK(&wmoCS);
-
 	return wmo;
 }
 
 int CResourceLoader::LoadingThreadFunc( void* lpParam )
 {
-	SParam* param = (SParam*)lpParam;
-	CResourceLoader* loader = param->loader;
+	SWorker* worker = (SWorker*)lpParam;
+	CResourceLoader* loader = worker->loader;
 
 #ifdef MW_VIDEO_MULTITHREAD
 		bool videobuild = true;
@@ -671,242 +725,411 @@ int CResourceLoader::LoadingThreadFunc( void* lpParam )
 		bool videobuild = false;
 #endif
 
-	STask task;	
-	bool stop = false;
-	while (!stop)
+	while (loader->popTask(worker))
 	{
-		BEGIN_LOCK(&loader->cs);
-		//check stop
-		stop = loader->StopLoading;			//˳ź
-		if (stop)
+		const STask& task = worker->task;
+
+		void* file = NULL_PTR;
+		if(task.type == ET_M2)
+			file = loader->loadM2(task.filename, videobuild);
+		else if (task.type == ET_WMO)
+			file = loader->loadWMO(task.filename, videobuild);
+		else if (task.type == ET_ADT)
+			file = loader->loadADT(task.filename, false, videobuild);
+		else if (task.type == ET_ANIM)
+			file = g_Engine->getWowEnvironment()->openFile(task.filename, false);
+		else
+			ASSERT(false);
+
+		loader->publishTask(worker, file);
+	}
+
+	return 0;
+}
+
+bool CResourceLoader::popTask( SWorker* worker )
+{
+	for (;;)
+	{
+		BEGIN_LOCK(&cs);
+
+		if (StopLoading)			//˳ź
 		{
-			loader->Suspended = true;
-			END_LOCK(&loader->cs);
-			break;
+			END_LOCK(&cs);
+			return false;
 		}
 
-		bool bEmpty = true;		
-		while(!loader->taskList.empty())		//бǷΪ
+		if (!taskHeap.empty())
 		{
-			task = loader->taskList.front();
-			if(task.cancel)
-			{
-				loader->taskList.pop_front();
-			}
-			else
-			{	
-				bEmpty = false;
-				break;
-			}
+			std::pop_heap(taskHeap.begin(), taskHeap.end(), STaskEntryGreater());
+			T_TaskList::iterator itr = taskHeap.back().itr;
+			taskHeap.pop_back();
+
+			worker->task = *itr;
+			worker->loading = true;
+			++NumLoading;
+			taskList.erase(itr);
+
+			bool more = !taskHeap.empty();
+			END_LOCK(&cs);
+
+			if (more)
+				SET_EVENT(&hTaskEvent);		//߳
+
+			return true;
 		}
-		END_LOCK(&loader->cs);
-		
-		if (!bEmpty)
-		{
-			WAIT_EVENT(&loader->hLoadingEvent);				//ȴloading¼
 
-			//ڵȴ¼stopܷ仯Ҫж
-			BEGIN_LOCK(&loader->cs);
-			stop = loader->StopLoading;			
-			if (stop)
-			{
-				loader->Suspended = true;
-				END_LOCK(&loader->cs);
-				break;
-			}
-			END_LOCK(&loader->cs);
+		END_LOCK(&cs);
 
-			//ڵȴ¼tasklistܷ仯Ҫж
-			BEGIN_LOCK(&loader->cs);
-			while(!loader->taskList.empty())		//бǷΪ
-			{
-				task = loader->taskList.front();
-				loader->taskList.pop_front();
+		WAIT_EVENT(&hTaskEvent, 10);
+	}
+}
 
-				if(!task.cancel)
-				{	
-					bEmpty = false;
-					break;
-				}
-			}
-			END_LOCK(&loader->cs);
+void CResourceLoader::publishTask( SWorker* worker, void* file )
+{
+#ifdef MW_VIDEO_MULTITHREAD
+	u32 buildBytes = 0;			//ԴԴڼ߳̽
+#else
+	u32 buildBytes = estimateBuildBytes(worker->task.type, file);
+#endif
 
-			if (!bEmpty)
-			{
-				BEGIN_LOCK(&loader->cs);
-				loader->Suspended = false;
-				END_LOCK(&loader->cs);
-
-				void* file = NULL_PTR;
-				if(task.type == ET_M2)
-					file = loader->loadM2(task.filename, videobuild);
-				else if (task.type == ET_WMO)
-					file = loader->loadWMO(task.filename, videobuild);
-				else if (task.type == ET_ADT)
-					file = loader->loadADT(task.filename, false, videobuild);
-				else
-					ASSERT(false);
+	bool bPublished = false;
 
-				BEGIN_LOCK(&loader->cs);
-				task.file = file;
-				loader->currentTask = task;
-				loader->Suspended = true;
-				END_LOCK(&loader->cs);
-			}
-		}
-		else
-		{
-			BEGIN_LOCK(&loader->cs);
-			loader->Suspended = true;
-			END_LOCK(&loader->cs);
+	BEGIN_LOCK(&cs);
 
-			SLEEP(1);		
-		}
+	worker->loading = false;
+	ASSERT(NumLoading > 0);
+	if (--NumLoading == 0)
+		SET_EVENT(&hIdleEvent);			//waitLoadingSuspend
+
+	//ʧܻȡ񲻽߳, ɶкһ
+	//.animҲҪ, һֱȴ
+	if ((file || worker->task.type == ET_ANIM) && !worker->task.cancel && !StopLoading)
+	{
+		completedList.emplace_back(worker->task);
+		STask& task = completedList.back();
+		task.file = file;
+		task.buildBytes = buildBytes;
+		bPublished = true;
 	}
 
-	return 0;
+	END_LOCK(&cs);
+
+	if (!bPublished)
+		dropTaskFile(worker->task.type, file);
 }
 
-void CResourceLoader::beginLoadM2( const c8* filename, const SParamBlock& param )
+void CResourceLoader::addTask( const c8* filename, const SParamBlock& param, E_TASK_TYPE type, f32 distance, const vector3df* position )
 {
-	if (!MultiThread || !hasFileExtensionA(filename, "m2"))
-		return;
-
 	STask task = {0};
 	Q_strcpy(task.filename, QMAX_PATH, filename);
 	normalizeFileName(task.filename);
 	Q_strlwr(task.filename);
-	task.type = ET_M2;
+	task.type = type;
 	task.param = param;
+	if (position)
+	{
+		task.position = *position;
+		task.hasPosition = true;
+		distance = LoadingCenter.getDistanceFrom(*position);
+	}
+	task.priority = distance + g_TaskTypeBias[type];
 
 	BEGIN_LOCK(&cs);
 
 	taskList.emplace_back(task);
 
+	STaskEntry entry;
+	entry.priority = task.priority;
+	entry.serial = TaskSerial++;
+	entry.itr = --taskList.end();
+	taskHeap.push_back(entry);
+	std::push_heap(taskHeap.begin(), taskHeap.end(), STaskEntryGreater());
+
 	END_LOCK(&cs);
+
+	SET_EVENT(&hTaskEvent);
 }
 
-void CResourceLoader::cancelAll(E_TASK_TYPE type)
+bool CResourceLoader::isTaskMatch( const STask& task, E_TASK_TYPE type, const void* sender, const void* param2 )
 {
-	if (!MultiThread)
-		return;
+	return (type == ET_NONE || task.type == type) &&
+		(!sender || task.param.param1 == sender) &&
+		(!param2 || task.param.param2 == param2);
+}
 
-	BEGIN_LOCK(&cs);
+void CResourceLoader::removeQueuedTasks( T_TaskList& dropped, E_TASK_TYPE type, const void* sender, const void* param2 )
+{
+	//csڵ, typeΪET_NONEʱsenderƥ, senderΪʱtypeƥ, Ϊʱȫȡ
+	//param2Ϊʱֻȡparam2ͬ
+	//ɵļƵdropped, ɵ߳csͷ, ͷm2ʱٵcancelTasks
+	u32 count = 0;
+	for (u32 i=0; i<(u32)taskHeap.size(); ++i)
+	{
+		const STask& task = *taskHeap[i].itr;
+		if (isTaskMatch(task, type, sender, param2))
+			taskList.erase(taskHeap[i].itr);
+		else
+			taskHeap[count++] = taskHeap[i];
+	}
+	taskHeap.resize(count);
+	std::make_heap(taskHeap.begin(), taskHeap.end(), STaskEntryGreater());
 
-	for (T_TaskList::iterator itr = taskList.begin(); itr != taskList.end(); ++itr)
+	//ڼصɺֱͷ
+	for (u32 i=0; i<NumWorkers; ++i)
 	{
-		if ((*itr).type == type)
-			itr->cancel = true;
+		STask& task = Workers[i].task;
+		if (isTaskMatch(task, type, sender, param2))
+			task.cancel = true;
 	}
 
-	if (currentTask.type == type)
+	//ɻûȡߵ
+	for (T_TaskList::iterator itr = completedList.begin(); itr != completedList.end();)
 	{
-		clearLoadedFiles();
+		T_TaskList::iterator cur = itr++;
+		if (isTaskMatch(*cur, type, sender, param2))
+			dropped.splice(dropped.end(), completedList, cur);
 	}
+}
+
+void CResourceLoader::dropTasks( T_TaskList& dropped )
+{
+	for (T_TaskList::iterator itr = dropped.begin(); itr != dropped.end(); ++itr)
+		dropTaskFile(itr->type, itr->file);
+	dropped.clear();
+}
+
+void CResourceLoader::beginLoadM2( const c8* filename, const SParamBlock& param, const vector3df* position )
+{
+	if (!MultiThread || !hasFileExtensionA(filename, "m2"))
+		return;
+
+	addTask(filename, param, ET_M2, 0.0f, position);
+}
 
+void CResourceLoader::cancelAll(E_TASK_TYPE type)
+{
+	if (!MultiThread)
+		return;
+
+	T_TaskList dropped;
+	BEGIN_LOCK(&cs);
+	removeQueuedTasks(dropped, type, NULL_PTR);
 	END_LOCK(&cs);
+	dropTasks(dropped);
 }
 
-bool CResourceLoader::m2LoadCompleted()
+void CResourceLoader::cancelTasks( const void* sender )
 {
-	E_TASK_TYPE type;
+	if (!MultiThread || !sender)
+		return;
+
+	T_TaskList dropped;
 	BEGIN_LOCK(&cs);
-	type = currentTask.type;
+	removeQueuedTasks(dropped, ET_NONE, sender);
 	END_LOCK(&cs);
+	dropTasks(dropped);
+}
 
-	if (!MultiThread || type != ET_M2)
-		return false;
-	return true;
+void CResourceLoader::cancelTask( const void* sender, const void* param2 )
+{
+	if (!MultiThread || !sender)
+		return;
+
+	T_TaskList dropped;
+	BEGIN_LOCK(&cs);
+	removeQueuedTasks(dropped, ET_NONE, sender, param2);
+	END_LOCK(&cs);
+	dropTasks(dropped);
 }
 
-void CResourceLoader::beginLoadWMO( const c8* filename, const SParamBlock& param )
+void CResourceLoader::beginLoadWMO( const c8* filename, const SParamBlock& param, const vector3df* position )
 {
 	if (!MultiThread || !hasFileExtensionA(filename, "wmo"))
 		return;
 
-	STask task = {0};
-	Q_strcpy(task.filename, QMAX_PATH, filename);
-	normalizeFileName(task.filename);
-	Q_strlwr(task.filename);
-	task.type = ET_WMO;
-	task.param = param;
+	addTask(filename, param, ET_WMO, 0.0f, position);
+}
 
-	BEGIN_LOCK(&cs);
 
-	taskList.emplace_back(task);
+void CResourceLoader::beginLoadADT( const c8* filename, const SParamBlock& param, f32 distance )
+{
+	if (!MultiThread || !hasFileExtensionA(filename, "adt"))
+		return;
 
-	END_LOCK(&cs);
+	addTask(filename, param, ET_ADT, distance);
+}
+
+void CResourceLoader::beginLoadAnim( const c8* filename, const SParamBlock& param )
+{
+	if (!MultiThread)
+		return;
+
+	addTask(filename, param, ET_ANIM, 0.0f);
 }
 
-bool CResourceLoader::wmoLoadCompleted()
+bool CResourceLoader::popCompletedTask( E_TASK_TYPE type, const void* sender, STask& task )
 {
-	E_TASK_TYPE type;
+	if (!MultiThread)
+		return false;
+
+	ASSERT(!CompletedTaskPopped);
+
+	//ٴһ, ֤Ҳ
+	if (BudgetTasks > 0 &&
+		((BudgetTimeLimit && BudgetTime >= BudgetTimeLimit) || (BudgetByteLimit && BudgetBytes >= BudgetByteLimit)))
+		return false;
+
+	bool found = false;
+
 	BEGIN_LOCK(&cs);
-	type = currentTask.type;
+	for (T_TaskList::iterator itr = completedList.begin(); itr != completedList.end(); ++itr)
+	{
+		if (itr->type == type && (!sender || itr->param.param1 == sender))
+		{
+			task = *itr;
+			completedList.erase(itr);
+			found = true;
+			break;
+		}
+	}
 	END_LOCK(&cs);
 
-	if (!MultiThread || type != ET_WMO)
+	if (!found)
 		return false;
+
+	++BudgetTasks;
+	BudgetBytes += task.buildBytes;
+	CompletedTaskPopped = true;
+	BudgetTimer.beginPerf(true);
+
 	return true;
 }
 
-void CResourceLoader::beginLoadADT( const c8* filename, const SParamBlock& param )
+void CResourceLoader::finishCompletedTask()
 {
-	if (!MultiThread || !hasFileExtensionA(filename, "adt"))
+	if (!CompletedTaskPopped)
 		return;
 
-	STask task = {0};
-	Q_strcpy(task.filename, QMAX_PATH, filename);
-	normalizeFileName(task.filename);
-	Q_strlwr(task.filename);
-	task.type = ET_ADT;
-	task.param = param;
+	u32 time = 0;
+	BudgetTimer.endPerf(true, time);
+	BudgetTime += time;
+	CompletedTaskPopped = false;
+}
 
+u32 CResourceLoader::getNumCompletedTasks() const
+{
 	BEGIN_LOCK(&cs);
+	u32 count = (u32)completedList.size();
+	END_LOCK(&cs);
+	return count;
+}
 
-	taskList.emplace_back(task);
+void CResourceLoader::setCompletedTaskBudget( u32 timeLimit, u32 byteLimit )
+{
+	BudgetTimeLimit = timeLimit;
+	BudgetByteLimit = byteLimit;
+}
+
+void CResourceLoader::beginFrame()
+{
+	BudgetTime = 0;
+	BudgetBytes = 0;
+	BudgetTasks = 0;
+
+	deliverAnimFiles();
+
+	if (LoadingCenter.getDistanceFromSQ(RekeyCenter) > g_RekeyDistance * g_RekeyDistance)
+		rekeyTasks();
+}
+
+void CResourceLoader::rekeyTasks()
+{
+	RekeyCenter = LoadingCenter;
+
+	if (!MultiThread)
+		return;
+
+	//ύʱľѹʱ, ǰλõ, ûλõıԭȼ
+	BEGIN_LOCK(&cs);
+	bool changed = false;
+	for (u32 i=0; i<(u32)taskHeap.size(); ++i)
+	{
+		STask& task = *taskHeap[i].itr;
+		if (!task.hasPosition)
+			continue;
 
+		task.priority = LoadingCenter.getDistanceFrom(task.position) + g_TaskTypeBias[task.type];
+		taskHeap[i].priority = task.priority;
+		changed = true;
+	}
+	if (changed)
+		std::make_heap(taskHeap.begin(), taskHeap.end(), STaskEntryGreater());
 	END_LOCK(&cs);
 }
 
-bool CResourceLoader::adtLoadCompleted()
+void CResourceLoader::setTaskPriority( const void* sender, const void* param2, f32 distance )
 {
-	E_TASK_TYPE type;
+	if (!MultiThread || !sender)
+		return;
+
 	BEGIN_LOCK(&cs);
-	type = currentTask.type;
+	bool changed = false;
+	for (u32 i=0; i<(u32)taskHeap.size(); ++i)
+	{
+		STask& task = *taskHeap[i].itr;
+		if (!isTaskMatch(task, ET_NONE, sender, param2))
+			continue;
+
+		task.priority = distance + g_TaskTypeBias[task.type];
+		taskHeap[i].priority = task.priority;
+		changed = true;
+	}
+	if (changed)
+		std::make_heap(taskHeap.begin(), taskHeap.end(), STaskEntryGreater());
 	END_LOCK(&cs);
+}
 
-	if (!MultiThread || type != ET_ADT)
-		return false;
-	return true;
+void CResourceLoader::deliverAnimFiles()
+{
+	if (!MultiThread)
+		return;
+
+	//.animԴԴ, Ԥ, cs󽻸, onAnimFileLoadedDecodeCS
+	T_TaskList animList;
+	BEGIN_LOCK(&cs);
+	for (T_TaskList::iterator itr = completedList.begin(); itr != completedList.end();)
+	{
+		T_TaskList::iterator cur = itr++;
+		if (cur->type == ET_ANIM)
+			animList.splice(animList.end(), completedList, cur);
+	}
+	END_LOCK(&cs);
+
+	for (T_TaskList::iterator itr = animList.begin(); itr != animList.end(); ++itr)
+	{
+		CM2AnimSource* source = (CM2AnimSource*)itr->param.param1;
+		source->onAnimFileLoaded(PTR_TO_UINT32(itr->param.param2), (IMemFile*)itr->file);
+	}
 }
 
 void CResourceLoader::waitLoadingSuspend()
 {
 	if(MultiThread)
 	{
-		bool bSuspend = false;
-		BEGIN_LOCK(&cs);
-		bSuspend = Suspended;
-		END_LOCK(&cs);
-
-		while (!bSuspend)		//ȷֹͣ
+		//ȴм߳̽ǰĽ, ɵɶ
+		//һе߳publishTaskﴥhIdleEvent, ȴڼȡ, ¼
+		for (;;)
 		{
-			SLEEP(10);
-
 			BEGIN_LOCK(&cs);
-			bSuspend = Suspended;
+			bool bLoading = NumLoading > 0;
 			END_LOCK(&cs);
-		}
-	}
-}
 
-void CResourceLoader::resumeLoading()
-{ 
-	if(MultiThread)
-	{
-		SET_EVENT(&hLoadingEvent); 
-		SLEEP(1);
+			if (!bLoading)
+				break;
+
+			WAIT_EVENT(&hIdleEvent, 100);
+		}
 	}
 }
 
@@ -934,54 +1157,66 @@ IResourceCache<IFileM2>* CResourceLoader::getM2Cache( const c8* filename )
 	}
 }
 
-void CResourceLoader::beginLoading()
+void CResourceLoader::beginLoading(u32 numThreads)
 {
-	RESUME_THREAD(&hThread);
-	SET_EVENT(&hLoadingEvent);
+	if (MultiThread)
+		return;
+
+	if (numThreads == 0)
+	{
+		u32 numCpu = CSysUtility::getProcessorCount();
+		numThreads = numCpu > 2 ? numCpu - 1 : 1;			//һ˸߳
+	}
+	NumWorkers = min_(numThreads, (u32)MAX_LOADING_THREADS);
+
+	StopLoading = false;
 	MultiThread = true;
+	NumLoading = 0;
+
+	for (u32 i=0; i<NumWorkers; ++i)
+	{
+		SWorker* worker = &Workers[i];
+		memset(&worker->task, 0, sizeof(STask));
+		worker->loader = this;
+		worker->loading = false;
+		INIT_THREAD(&worker->thread, LoadingThreadFunc, worker, false);
+	}
 }
 
 void CResourceLoader::endLoading()
 {
 	if (MultiThread)
 	{
-		waitLoadingSuspend();
-
 		//thread
+		T_TaskList dropped;
 		BEGIN_LOCK(&cs);
 		//ȡ
-		for (T_TaskList::iterator itr = taskList.begin(); itr != taskList.end(); ++itr)
-		{
-			itr->cancel = true;
-		}
+		removeQueuedTasks(dropped, ET_NONE, NULL_PTR);
 
 		CResourceLoader::StopLoading = true;			//
 		END_LOCK(&cs);
+		dropTasks(dropped);
 
-		clearLoadedFiles();
-
-		resumeLoading();		//ִloading߳, ʱȻһtaskѾڼ
-
-		waitLoadingSuspend();		//ȴtaskֹͣ, Դ
+		for (u32 i=0; i<NumWorkers; ++i)
+			SET_EVENT(&hTaskEvent);
 
-		clearLoadedFiles();
-
-		if( !WAIT_THREAD(&hThread) )
+		//еɺᱻ
+		for (u32 i=0; i<NumWorkers; ++i)
 		{
-			ASSERT(false);
+			if( !WAIT_THREAD(&Workers[i].thread) )
+			{
+				ASSERT(false);
+			}
+			DESTROY_THREAD(&Workers[i].thread);
 		}
+		NumWorkers = 0;
+
+		clearLoadedFiles();
 
 		MultiThread = false;
 	}
 }
 
-void CResourceLoader::clearCurrentTask()
-{
-	BEGIN_LOCK(&cs);
-	memset(&currentTask, 0, sizeof(STask));
-	END_LOCK(&cs);
-}
-
 void CResourceLoader::setCacheLimit( E_CACHE_TYPE type, u32 limit )
 {
 	switch(type)
@@ -1077,49 +1312,130 @@ u32 CResourceLoader::getCacheLimit( E_CACHE_TYPE type ) const
 	}
 }
 
+u32 CResourceLoader::releaseUnusedAnimations()
+{
+	//һժµѾһͷ, timesgetValueѷ
+	for (u32 i=0; i<(u32)RetiredAnimBlocks.size(); ++i)
+		delete[] RetiredAnimBlocks[i];
+	RetiredAnimBlocks.clear();
+
+	SReleaseAnimParam param = { &RetiredAnimBlocks, 0 };
+
+	M2Cache_Character.iterateItems(releaseM2Animations, &param);
+	M2Cache_Item.iterateItems(releaseM2Animations, &param);
+	M2Cache_Creature.iterateItems(releaseM2Animations, &param);
+	M2Cache_Particles.iterateItems(releaseM2Animations, &param);
+	M2Cache_Spells.iterateItems(releaseM2Animations, &param);
+	M2Cache_Interface.iterateItems(releaseM2Animations, &param);
+	M2Cache_World.iterateItems(releaseM2Animations, &param);
+	M2Cache_Default.iterateItems(releaseM2Animations, &param);
+
+	return param.count;
+}
+
+void CResourceLoader::releaseM2Animations( IFileM2* m2, void* param )
+{
+	SReleaseAnimParam* p = (SReleaseAnimParam*)param;
+	p->count += m2->releaseUnusedAnimations(*p->retired);
+}
+
 void CResourceLoader::registerM2Loaded( IM2LoadCallback* callback )
 {
+	if (MultiThread)
+		BEGIN_LOCK(&m2CS);
+
 	if (std::find(M2LoadedCallbackList.begin(), M2LoadedCallbackList.end(), callback) == M2LoadedCallbackList.end())
 	{
 		M2LoadedCallbackList.push_back(callback);
 	}
+
+	if (MultiThread)
+		END_LOCK(&m2CS);
 }
 
 void CResourceLoader::removeM2Loaded( IM2LoadCallback* callback )
 {
+	if (MultiThread)
+		BEGIN_LOCK(&m2CS);
+
 	M2LoadedCallbackList.remove(callback);
+
+	if (MultiThread)
+		END_LOCK(&m2CS);
 }
 
 void CResourceLoader::clearLoadedFiles()
 {
-	if (!currentTask.file)
+	T_TaskList dropped;
+	BEGIN_LOCK(&cs);
+	dropped.splice(dropped.end(), completedList);
+	END_LOCK(&cs);
+	dropTasks(dropped);
+}
+
+void CResourceLoader::dropTaskFile( E_TASK_TYPE type, void* file )
+{
+	if (!file)
 		return;
 
-	switch(currentTask.type)
+	switch(type)
 	{
 	case ET_M2:
 		{
-			IReferenceCounted<IFileM2>* iref = (IReferenceCounted<IFileM2>*)currentTask.file;
+			IReferenceCounted<IFileM2>* iref = (IReferenceCounted<IFileM2>*)file;
 			iref->drop();
 		}
 		break;
 	case ET_WMO:
 		{
-			IReferenceCounted<IFileWMO>* iref = (IReferenceCounted<IFileWMO>*)currentTask.file;
+			IReferenceCounted<IFileWMO>* iref = (IReferenceCounted<IFileWMO>*)file;
 			iref->drop();
 		}
 		break;
 	case ET_ADT:
 		{
-			IReferenceCounted<IFileADT>* iref = (IReferenceCounted<IFileADT>*)currentTask.file;
+			IReferenceCounted<IFileADT>* iref = (IReferenceCounted<IFileADT>*)file;
 			iref->drop();
 		}
 		break;
+	case ET_ANIM:
+		delete (IMemFile*)file;
+		break;
 	default:
 		ASSERT(false);
 		break;
 	}		
-
-	memset(&currentTask, 0, sizeof(currentTask));
 }
 
+u32 CResourceLoader::estimateBuildBytes( E_TASK_TYPE type, void* file )
+{
+	//ֻ㶥, 湲
+	switch(type)
+	{
+	case ET_M2:
+		{
+			IFileM2* m2 = (IFileM2*)file;
+			return m2->NumVertices * (sizeof(SVertex_PNT2W) + sizeof(SVertex_A));
+		}
+	case ET_WMO:
+		{
+			CFileWMO* wmo = static_cast<CFileWMO*>((IFileWMO*)file);
+			u32 bytes = 0;
+			if (wmo->VertexBuffer)
+				bytes += getStreamPitchFromType(wmo->VertexBuffer->Type) * wmo->VertexBuffer->Size;
+			if (wmo->IndexBuffer)
+				bytes += (wmo->IndexBuffer->Type == EIT_16BIT ? 2 : 4) * wmo->IndexBuffer->Size;
+			return bytes;
+		}
+	case ET_ADT:
+		{
+			IVertexBuffer* vbuffer = static_cast<CFileADT*>((IFileADT*)file)->getVBuffer();
+			return vbuffer ? getStreamPitchFromType(vbuffer->Type) * vbuffer->Size : 0;
+		}
+	case ET_ANIM:
+		return 0;
+	default:
+		ASSERT(false);
+		return 0;
+	}
+}
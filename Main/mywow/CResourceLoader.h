@@ -2,8 +2,10 @@
 
 #include "IResourceLoader.h"
 #include "IResourceCache.h"
+#include "wow_animation.h"
 
 #include "CSysThread.h"
+#include "CTimer.h"
 
 #include "CFileM2Loader.h"
 #include "CFileWMOLoader.h"
@@ -40,47 +42,106 @@ public:
 	virtual void registerM2Loaded(IM2LoadCallback* callback);
 	virtual void removeM2Loaded(IM2LoadCallback* callback);
 
-	virtual void clearCurrentTask();
-
 	virtual void setCacheLimit(E_CACHE_TYPE type, u32 limit);
 	virtual u32 getCacheLimit(E_CACHE_TYPE type) const;
 
+	virtual u32 releaseUnusedAnimations();
+
 	//m2 async loading
-	virtual void beginLoadM2(const c8* filename, const SParamBlock& param);
-	virtual bool m2LoadCompleted();
+	virtual void beginLoadM2(const c8* filename, const SParamBlock& param, const vector3df* position = NULL_PTR);
 
 	//wmo async loading
-	virtual void beginLoadWMO(const c8* filename, const SParamBlock& param);
-	virtual bool wmoLoadCompleted();
+	virtual void beginLoadWMO(const c8* filename, const SParamBlock& param, const vector3df* position = NULL_PTR);
 
 	//adt async loading
-	virtual void beginLoadADT(const c8* filename, const SParamBlock& param);
-	virtual bool adtLoadCompleted();
+	virtual void beginLoadADT(const c8* filename, const SParamBlock& param, f32 distance = 0.0f);
+
+	//.anim async loading
+	virtual void beginLoadAnim(const c8* filename, const SParamBlock& param);
+
+	virtual bool popCompletedTask(E_TASK_TYPE type, const void* sender, STask& task);
+	virtual void finishCompletedTask();
+	virtual u32 getNumCompletedTasks() const;
+
+	virtual void setCompletedTaskBudget(u32 timeLimit, u32 byteLimit);
+	virtual void beginFrame();
+
+	virtual void setLoadingCenter(const vector3df& center) { LoadingCenter = center; }
+	virtual void setTaskPriority(const void* sender, const void* param2, f32 distance);
 
-	virtual void beginLoading();
+	virtual void beginLoading(u32 numThreads = 0);
+	virtual bool isMultiThread() const { return MultiThread; }
 	virtual void cancelAll(E_TASK_TYPE type);
+	virtual void cancelTasks(const void* sender);
+	virtual void cancelTask(const void* sender, const void* param2);
 	virtual void waitLoadingSuspend(); 
-	virtual void resumeLoading();
 	virtual void endLoading();
 
 protected:	
-	struct SParam
+	enum
+	{
+		MAX_LOADING_THREADS = 8,
+		DEFAULT_BUDGET_TIME = 4000,			//΢
+		DEFAULT_BUDGET_BYTES = 8 * 1024 * 1024,
+	};
+
+	struct SWorker
 	{
 		CResourceLoader* loader;
-	} ;
+		thread_type		thread;
+		STask		task;			//ڼص
+		bool		loading;
+	};
+
+	typedef std::list<STask, qzone_allocator<STask> >		T_TaskList;
+
+	struct STaskEntry
+	{
+		f32		priority;
+		u32		serial;			//ͬȼύ˳
+		T_TaskList::iterator	itr;
+	};
+
+	struct STaskEntryGreater
+	{
+		bool operator()(const STaskEntry& a, const STaskEntry& b) const
+		{
+			if (a.priority != b.priority)
+				return a.priority > b.priority;
+			return a.serial > b.serial;
+		}
+	};
+
+	struct SReleaseAnimParam
+	{
+		T_AnimBlockList*	retired;
+		u32		count;
+	};
 
 	IResourceCache<IFileM2>* getM2Cache(const c8* filename);
+	void onM2Loaded(IFileM2* m2);
+	static void releaseM2Animations(IFileM2* m2, void* param);
+
+	void addTask(const c8* filename, const SParamBlock& param, E_TASK_TYPE type, f32 distance, const vector3df* position = NULL_PTR);
+	void rekeyTasks();
+	bool popTask(SWorker* worker);
+	void publishTask(SWorker* worker, void* file);
+	void removeQueuedTasks(T_TaskList& dropped, E_TASK_TYPE type, const void* sender, const void* param2 = NULL_PTR);
+	void dropTasks(T_TaskList& dropped);
+	void deliverAnimFiles();
+	static bool isTaskMatch(const STask& task, E_TASK_TYPE type, const void* sender, const void* param2);
 
 	void clearLoadedFiles();
+	static void dropTaskFile(E_TASK_TYPE type, void* file);
+	static u32 estimateBuildBytes(E_TASK_TYPE type, void* file);
 
 	static int LoadingThreadFunc( void* lpParam ); 
 
 protected:
-	SParam		ThreadParam;
-
-	thread_type		hThread;
+	SWorker		Workers[MAX_LOADING_THREADS];
+	u32		NumWorkers;
 
-	lock_type		cs;
+	mutable lock_type		cs;
 
 	lock_type		m2CS;
 	lock_type		imageCS;
@@ -92,14 +153,36 @@ protected:
 	lock_type		adtCS;
 	lock_type		wmoCS;
 
-	event_type		hLoadingEvent;
+	event_type		hTaskEvent;			//
+	event_type		hIdleEvent;			//м̶߳
+	u32		NumLoading;			//ڼص߳
 
-	typedef std::list<STask, qzone_allocator<STask> >		T_TaskList;
 	T_TaskList taskList;	
 
+	typedef std::vector<STaskEntry, qzone_allocator<STaskEntry> >	T_TaskHeap;
+	T_TaskHeap	taskHeap;			//taskListС
+	u32		TaskSerial;
+
+	//̷ֻ߳
+	vector3df	LoadingCenter;
+	vector3df	RekeyCenter;			//ϴʱļ
+
+	T_TaskList	completedList;			//ɵ, ˳
+
+	//֡Ԥ, ̷ֻ߳
+	CTimer		BudgetTimer;
+	u32		BudgetTimeLimit;
+	u32		BudgetByteLimit;
+	u32		BudgetTime;
+	u32		BudgetBytes;
+	u32		BudgetTasks;
+	bool		CompletedTaskPopped;
+
 	typedef std::list<IM2LoadCallback*, qzone_allocator<IM2LoadCallback*> > T_M2LoadedList;
 	T_M2LoadedList	M2LoadedCallbackList;
 
+	T_AnimBlockList	RetiredAnimBlocks;			//һreleaseUnusedAnimationsժµ
+
 protected:
 	IResourceCache<IFileM2>			M2Cache_Character;
 	IResourceCache<IFileM2>			M2Cache_Item;
@@ -130,6 +213,5 @@ protected:
 	CWMOLoader		WMOLoader;
 
 	volatile bool StopLoading;
-	volatile bool Suspended;
 	bool	MultiThread;
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "CTimer.h"
 #include "CCamera.h"
 #include "CSceneRenderServices.h"
+#include "CM2PoseCache.h"
 #include "CMeshSceneNode.h"
 #include "CM2SceneNode.h"
 #include "CMapTileSceneNode.h"
@@ -14,7 +15,7 @@
 #include "CFTFont.h"
 
 CSceneManager::CSceneManager( )
-	: PerfCalcTime(0), 
+	: PerfCalcTime(0), AnimReleaseTime(0), 
 	Perf_tickTime(0), Perf_renderTime(0), 
 	Perf_terrainTime(0), Perf_wmoTime(0), Perf_meshTime(0),
 	Perf_alphaTestTime(0), Perf_transparentTime(0), Perf_3DwireTime(0), Perf_2DTime(0),
@@ -87,6 +88,11 @@ bool CSceneManager::beginFrame(bool foreground)
 	if (limit > 0 && !Timer->checkFrameLimit(limit))
 		return false;
 #endif
+
+	IResourceLoader* loader = g_Engine->getResourceLoader();
+	if (ActiveCamera)
+		loader->setLoadingCenter(ActiveCamera->getPosition());			//ԽԽȼ
+	loader->beginFrame();			//ĴԤ㰴֡
     
 	return true;
 }
@@ -101,7 +107,7 @@ void CSceneManager::drawAll(bool foreground)
 	u32 timeSinceStart = Timer->getTimeSinceStart();
 	u32 timeSinceLastFrame = Timer->getTimeSinceLastFrame();
 
-	CalcPerf = false;
+	CalcPerf = PerfEveryFrame;
 	if (timeSinceStart - PerfCalcTime > 1000)
 	{
 		CalcPerf = true;
@@ -109,6 +115,14 @@ void CSceneManager::drawAll(bool foreground)
 	}
 	
 	SceneRenderServices->clearAllSceneNodes();
+	SceneRenderServices->getM2PoseCache()->beginFrame();
+
+	//tick֮ǰ, ûйڸ; һûвŹһͷ
+	if (timeSinceStart - AnimReleaseTime > ANIM_RELEASE_INTERVAL)
+	{
+		g_Engine->getResourceLoader()->releaseUnusedAnimations();
+		AnimReleaseTime = timeSinceStart;
+	}
 
 	//3d mode	
 	// normal nodes
@@ -485,14 +499,16 @@ void CSceneManager::drawSceneInfo()
 {
 	const vector3df& Pos = ActiveCamera->getPosition();
 	vector3df& Dir = g_Engine->getSceneEnvironment()->LightDir;
+	const CM2PoseCache* poseCache = SceneRenderServices->getM2PoseCache();
 	
 
 	Q_sprintf(SceneInfo, MAX_TEXT_LENGTH, 
-		"camera pos: (%0.2f, %0.2f, %0.2f)\nlight dir: (%0.2f, %0.2f, %0.2f)\nactive particles: %d\navailable main memory: %0.4f\navailable small memory: %0.4f\navailable temp memory: %0.4f",
+		"camera pos: (%0.2f, %0.2f, %0.2f)\nlight dir: (%0.2f, %0.2f, %0.2f)\nactive particles: %d\navailable main memory: %0.4f\navailable small memory: %0.4f\navailable temp memory: %0.4f\nm2 poses: %d (hit %d, miss %d)",
 		Pos.X, Pos.Y, Pos.Z,
 		Dir.X, Dir.Y, Dir.Z,
 		g_Engine->getParticleSystemServices()->getActiveParticlesCount(),
-		Z_AvailableMainMemoryPercent(), Z_AvailableSmallMemoryPercent(), Z_AvailableTempMemoryPercent() );
+		Z_AvailableMainMemoryPercent(), Z_AvailableSmallMemoryPercent(), Z_AvailableTempMemoryPercent(),
+		poseCache->getNumPoses(), poseCache->getLastHits(), poseCache->getLastMisses() );
 
 	s32 right = Driver->getViewPort().getWidth() - 300;
 	g_Engine->getDefaultFont()->drawA(SceneInfo, SColor(255,255,0), vector2di(right, 0));
@@ -541,6 +557,20 @@ void CSceneManager::onWindowSizeChanged( const dimension2du& size )
 #endif
 }
 
+void CSceneManager::getFramePerf( SFramePerf& perf ) const
+{
+	perf.tickTime = Perf_tickTime;
+	perf.renderTime = Perf_renderTime;
+	perf.terrainTime = Perf_terrainTime;
+	perf.wmoTime = Perf_wmoTime;
+	perf.meshTime = Perf_meshTime;
+	perf.alphaTestTime = Perf_alphaTestTime;
+	perf.transparentTime = Perf_transparentTime;
+	perf.wire3DTime = Perf_3DwireTime;
+	perf.time2D = Perf_2DTime;
+	perf.gpuTime = Perf_GPUTime;
+}
+
 void CSceneManager::registerM2SceneNodeLoad( IM2SceneNodeAddCallback* callback )
 {
 	if (std::find(M2SceneNodeAddCallbackList.begin(), M2SceneNodeAddCallbackList.end(), callback) == M2SceneNodeAddCallbackList.end())
@@ -12,6 +12,8 @@ class ITexture;
 class IRenderTarget;
 class CTimer;
 
+#define ANIM_RELEASE_INTERVAL		30000			//, ôûвŲͷ
+
 class CSceneManager : public ISceneManager
 {
 private:
@@ -34,6 +36,8 @@ public:
 
 	virtual void onWindowSizeChanged(const dimension2du& size);
 
+	virtual void getFramePerf(SFramePerf& perf) const;
+
 	virtual ICamera* addCamera(const vector3df& position, const vector3df& lookat, const vector3df& up, f32 nearValue, f32 farValue, f32 fov);
 
 	virtual ISkySceneNode* addSkySceneNode(CMapEnvironment* mapEnv);
@@ -84,6 +88,7 @@ protected:
 
 	//performance
 	u32		PerfCalcTime;
+	u32		AnimReleaseTime;
 	u32		Perf_GPUTime;
 	u32		Perf_tickTime;
 	u32		Perf_renderTime;
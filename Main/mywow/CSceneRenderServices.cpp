@@ -12,6 +12,13 @@
 #include "CAlphaTestWmoRenderer.h"
 #include "CAlphaTestMeshRenderer.h"
 #include "CAlphaTestDecalRenderer.h"
+#include "CJobSystem.h"
+#include "CM2PoseCache.h"
+
+static void animateSceneNode(void* param)
+{
+	reinterpret_cast<ISceneNode*>(param)->animate();
+}
 
 CSceneRenderServices::CSceneRenderServices()
 {
@@ -36,6 +43,9 @@ CSceneRenderServices::CSceneRenderServices()
 		m_SceneNodes[i].reserve(100);
 	}
 
+	AnimateNodes.reserve(100);
+	M2PoseCache = new CM2PoseCache;
+
 	ClipDistance = 1000.0f;
 	ModelLodBias = 0;
 	TerrainLodBias = 0;
@@ -47,6 +57,8 @@ CSceneRenderServices::CSceneRenderServices()
 
 CSceneRenderServices::~CSceneRenderServices()
 {
+	delete M2PoseCache;
+
 	delete Wire_Renderer;
 	delete RibbonRenderer;
 	delete ParticleRenderer;
@@ -112,12 +124,40 @@ void CSceneRenderServices::tickAllSceneNodes( u32 timeSinceStart, u32 timeSinceL
 	std::vector<SEntry>& sceneNodes = m_SceneNodes[sequence];
 	std::sort(sceneNodes.begin(), sceneNodes.end());
 	u32 size = (u32)sceneNodes.size();
-	for (u32 i=0; i<size; ++i)
-	{		
-		if (sceneNodes[i].skip)
-			continue;
-		ISceneNode* node = sceneNodes[i].node;
-		node->tick(timeSinceStart, timeSinceLastFrame, sceneNodes[i].visible);
+
+	//Generation: ˳tick(״̬, , ص), ٲanimate
+	//һ㿪ʼǰڵĹ͹ҼλѾ
+	//skipĽڵѱɾ, ܷ
+	u32 i = 0;
+	while (i < size)
+	{
+		s32 generation = -1;
+
+		u32 end = i;
+		for (; end < size; ++end)
+		{
+			if (sceneNodes[end].skip)
+				continue;
+			ISceneNode* node = sceneNodes[end].node;
+			if (generation == -1)
+				generation = node->Generation;
+			else if (node->Generation != generation)
+				break;
+			node->tick(timeSinceStart, timeSinceLastFrame, sceneNodes[end].visible);
+		}
+
+		//tickпɾڵ, ȫtickռ
+		AnimateNodes.clear();
+		for (u32 k=i; k<end; ++k)
+		{
+			if (!sceneNodes[k].skip && sceneNodes[k].node->needAnimate())
+				AnimateNodes.push_back(sceneNodes[k].node);
+		}
+
+		if (!AnimateNodes.empty())
+			g_Engine->getJobSystem()->parallelFor(animateSceneNode, &AnimateNodes[0], (u32)AnimateNodes.size());
+
+		i = end;
 	}
 }
 
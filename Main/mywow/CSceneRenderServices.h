@@ -17,6 +17,7 @@ class CTransluscentDecalRenderer;
 class CAlphaTestWmoRenderer;
 class CAlphaTestMeshRenderer;
 class CAlphaTestDecalRenderer;
+class CM2PoseCache;
 
 class CSceneRenderServices : public ISceneRenderServices
 {
@@ -38,6 +39,8 @@ public:
 	void addRenderUnit(const SRenderUnit* unit, E_RENDERINST_TYPE type);
 	void renderAll(E_RENDERINST_TYPE type, ICamera* cam);
 
+	CM2PoseCache* getM2PoseCache() const { return M2PoseCache; }
+
 private:
 	struct SEntry 
 	{
@@ -59,6 +62,10 @@ private:
 private:
 	std::vector<SEntry>		m_SceneNodes[MAX_SCENENODE_SEQUENCE];
 
+	//ͬһGenerationĽڵ㲢animate
+	std::vector<void*>		AnimateNodes;
+	CM2PoseCache*		M2PoseCache;
+
 	//Ⱦ˳: , رwmo, doodads, ɫģͣЧ
 	CMeshRenderer*		Sky_Renderer;
 	CTerrainRenderer*		Terrain_Renderer;
@@ -0,0 +1,125 @@
+#include "stdafx.h"
+#include "CSkylinePacker.h"
+
+CSkylinePacker::CSkylinePacker( u32 width, u32 height )
+	: Width(width), Height(height), UsedArea(0)
+{
+	reset();
+}
+
+void CSkylinePacker::reset()
+{
+	Nodes.clear();
+
+	SNode node;
+	node.x = 0;
+	node.y = 0;
+	node.width = (s32)Width;
+	Nodes.push_back(node);
+
+	UsedArea = 0;
+}
+
+bool CSkylinePacker::insert( u32 width, u32 height, vector2di& pos )
+{
+	if (width == 0 || height == 0 || width > Width || height > Height)
+		return false;
+
+	//ѡױ͵λ, ͬʱѡխĽڵ, Ƭ
+	s32 bestBottom = 0x7fffffff;
+	s32 bestWidth = 0x7fffffff;
+	s32 bestY = 0;
+	s32 bestIndex = -1;
+
+	for (u32 i=0; i<(u32)Nodes.size(); ++i)
+	{
+		s32 y;
+		if (!fit(i, width, height, y))
+			continue;
+
+		s32 bottom = y + (s32)height;
+		if (bottom < bestBottom || (bottom == bestBottom && Nodes[i].width < bestWidth))
+		{
+			bestBottom = bottom;
+			bestWidth = Nodes[i].width;
+			bestY = y;
+			bestIndex = (s32)i;
+		}
+	}
+
+	if (bestIndex == -1)
+		return false;
+
+	pos.X = Nodes[bestIndex].x;
+	pos.Y = bestY;
+
+	addLevel((u32)bestIndex, pos.X, pos.Y, width, height);
+	UsedArea += width * height;
+
+	return true;
+}
+
+bool CSkylinePacker::fit( u32 index, u32 width, u32 height, s32& y ) const
+{
+	s32 x = Nodes[index].x;
+	if (x + (s32)width > (s32)Width)
+		return false;
+
+	//Ľڵȡߴ
+	s32 widthLeft = (s32)width;
+	y = Nodes[index].y;
+	while (widthLeft > 0)
+	{
+		const SNode& node = Nodes[index];
+		if (node.y > y)
+			y = node.y;
+		if (y + (s32)height > (s32)Height)
+			return false;
+
+		widthLeft -= node.width;
+		++index;
+	}
+
+	return true;
+}
+
+void CSkylinePacker::addLevel( u32 index, s32 x, s32 y, u32 width, u32 height )
+{
+	SNode node;
+	node.x = x;
+	node.y = y + (s32)height;
+	node.width = (s32)width;
+	Nodes.insert(Nodes.begin() + index, node);
+
+	//½ڵסĲֽص
+	for (u32 i=index+1; i<(u32)Nodes.size(); ++i)
+	{
+		const SNode& prev = Nodes[i-1];
+		SNode& cur = Nodes[i];
+
+		s32 prevRight = prev.x + prev.width;
+		if (cur.x >= prevRight)
+			break;
+
+		s32 shrink = prevRight - cur.x;
+		cur.x += shrink;
+		cur.width -= shrink;
+
+		if (cur.width > 0)
+			break;
+
+		Nodes.erase(Nodes.begin() + i);
+		--i;
+	}
+
+	//ϲȸߵڽڵ
+	for (u32 i=0; i+1<(u32)Nodes.size(); ++i)
+	{
+		if (Nodes[i].y == Nodes[i+1].y)
+		{
+			Nodes[i].width += Nodes[i+1].width;
+			Nodes.erase(Nodes.begin() + i + 1);
+			--i;
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "core.h"
+#include <vector>
+
+//skyline bottom-leftװ, ȶ̬ͼ, ÿηƶ
+class CSkylinePacker
+{
+public:
+	CSkylinePacker(u32 width, u32 height);
+
+public:
+	void reset();
+
+	//Ųʱfalse
+	bool insert(u32 width, u32 height, vector2di& pos);
+
+	u32 getWidth() const { return Width; }
+	u32 getHeight() const { return Height; }
+	f32 getOccupancy() const { return (f32)UsedArea / (Width * Height); }
+
+private:
+	struct SNode
+	{
+		s32		x;
+		s32		y;
+		s32		width;
+	};
+
+	bool fit(u32 index, u32 width, u32 height, s32& y) const;
+	void addLevel(u32 index, s32 x, s32 y, u32 width, u32 height);
+
+private:
+	std::vector<SNode>		Nodes;
+	u32		Width;
+	u32		Height;
+	u32		UsedArea;
+};
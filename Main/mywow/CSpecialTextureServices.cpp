@@ -14,6 +14,9 @@ CSpecialTextureServices::CSpecialTextureServices()
 
 CSpecialTextureServices::~CSpecialTextureServices()
 {
+	for (T_ComposedTextures::const_iterator itr = ComposedTextures.begin(); itr != ComposedTextures.end(); ++itr)
+		itr->second->drop();
+
 	for (u32 i=0; i<EST_TEXTURE_COUNT; ++i)
 	{
 		if (Textures[i])
@@ -46,3 +49,46 @@ void CSpecialTextureServices::loadTextures()
 		Textures[EST_ARMORREFLECT_RAINBOW] = tex;
 	}
 }
+
+ITexture* CSpecialTextureServices::findComposedTexture( u64 key )
+{
+	T_ComposedTextures::const_iterator itr = ComposedTextures.find(key);
+	if (itr == ComposedTextures.end())
+		return NULL_PTR;
+
+	itr->second->grab();
+	return itr->second;
+}
+
+void CSpecialTextureServices::addComposedTexture( u64 key, ITexture* tex )
+{
+	removeUnusedComposedTextures();
+
+	T_ComposedTextures::iterator itr = ComposedTextures.find(key);
+	if (itr != ComposedTextures.end())
+	{
+		if (itr->second == tex)
+			return;
+		itr->second->drop();
+	}
+
+	tex->grab();
+	ComposedTextures[key] = tex;
+}
+
+void CSpecialTextureServices::removeUnusedComposedTextures()
+{
+	//ֻʣе
+	for (T_ComposedTextures::iterator itr = ComposedTextures.begin(); itr != ComposedTextures.end(); )
+	{
+		if (itr->second->getReferenceCount() == 1)
+		{
+			itr->second->drop();
+			ComposedTextures.erase(itr++);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
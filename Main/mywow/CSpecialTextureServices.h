@@ -15,9 +15,16 @@ public:
 public:
 	virtual ITexture* getTexture(E_SPECIAL_TEXTURES tex) const;
 
+	virtual ITexture* findComposedTexture(u64 key);
+	virtual void addComposedTexture(u64 key, ITexture* tex);
+
 private:
 	void loadTextures();
+	void removeUnusedComposedTextures();
 
 private:
 	ITexture* Textures[EST_TEXTURE_COUNT];
+
+	typedef std::map<u64, ITexture*> T_ComposedTextures;
+	T_ComposedTextures		ComposedTextures;
 };
\ No newline at end of file
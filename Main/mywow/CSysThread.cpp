@@ -28,6 +28,8 @@ DWORD WINAPI PlatformThreadFunction(LPVOID p)
 	thread_type* pInfo = static_cast<thread_type*>(p);
 	pInfo->function(pInfo->param);
 
+	QMem_ThreadExit();
+
 	return 0;
 }
 #else
@@ -43,6 +45,8 @@ void* PlatformThreadFunction(void* p)
 	//ʼִ
 	pinfo->function(pinfo->param);
 
+	QMem_ThreadExit();
+
 	return NULL_PTR;
 }
 #endif
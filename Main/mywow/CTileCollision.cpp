@@ -0,0 +1,583 @@
+#include "stdafx.h"
+#include "CTileCollision.h"
+#include "mywow.h"
+#include "CFileADT.h"
+#include "CFileWMO.h"
+
+#define COLLISION_EPSILON		0.0001f
+#define BSP_STACK_SIZE		128
+
+namespace
+{
+	inline s32 toCell(f32 v, s32 maxCell)
+	{
+		s32 c = (s32)floorf(v);
+		return c < 0 ? 0 : (c > maxCell ? maxCell : c);
+	}
+
+	//bspڵķָ, ļеy, zڼʱѽ
+	inline f32 getBspAxis(const vector3df& v, u16 planetype)
+	{
+		switch(planetype & 3)
+		{
+		case 0:
+			return v.X;
+		case 1:
+			return v.Z;
+		default:
+			return v.Y;
+		}
+	}
+
+	//a*t*t + b*t + c = 0  (0, maxR) ڵС
+	inline bool getLowestRoot(f32 a, f32 b, f32 c, f32 maxR, f32& root)
+	{
+		f32 det = b * b - 4.0f * a * c;
+		if (det < 0.0f || fabs(a) < COLLISION_EPSILON * COLLISION_EPSILON)
+			return false;
+
+		f32 sqrtD = sqrtf(det);
+		f32 r1 = (-b - sqrtD) / (2.0f * a);
+		f32 r2 = (-b + sqrtD) / (2.0f * a);
+		if (r1 > r2)
+		{
+			f32 tmp = r2;
+			r2 = r1;
+			r1 = tmp;
+		}
+
+		if (r1 > 0 && r1 < maxR)
+		{
+			root = r1;
+			return true;
+		}
+		if (r2 > 0 && r2 < maxR)
+		{
+			root = r2;
+			return true;
+		}
+		return false;
+	}
+
+	inline bool isPointInTriangle(const vector3df& p, const vector3df& a, const vector3df& b, const vector3df& c, const vector3df& faceNormal)
+	{
+		return (b - a).crossProduct(p - a).dotProduct(faceNormal) >= 0.0f &&
+			(c - b).crossProduct(p - b).dotProduct(faceNormal) >= 0.0f &&
+			(a - c).crossProduct(p - c).dotProduct(faceNormal) >= 0.0f;
+	}
+}
+
+CTileCollision::CTileCollision( IFileADT* adt )
+{
+	FileADT = static_cast<CFileADT*>(adt);
+	FileADT->grab();
+
+	const CMapChunk* first = FileADT->getChunk(0, 0);
+	XBase = first->xbase;
+	ZBase = first->zbase;
+
+	Box = first->box;
+	for (u8 i=0; i<16; ++i)
+	{
+		for (u8 j=0; j<16; ++j)
+		{
+			Box.addInternalBox(FileADT->getChunk(i, j)->box);
+		}
+	}
+}
+
+CTileCollision::~CTileCollision()
+{
+	for (u32 i=0; i<(u32)Instances.size(); ++i)
+	{
+		if (Instances[i].m2)
+			Instances[i].m2->drop();
+		if (Instances[i].wmo)
+			Instances[i].wmo->drop();
+	}
+
+	FileADT->drop();
+}
+
+void CTileCollision::addM2Instance( IFileM2* m2, const matrix4& mat )
+{
+	if (!m2->NumBoundingVerts || m2->NumBoundingTriangles < 3 || !m2->Bounds || !m2->BoundTris)
+		return;
+
+	SInstance inst;
+	inst.type = ECT_M2;
+	inst.m2 = m2;
+	inst.wmo = NULL_PTR;
+	inst.mat = mat;
+
+	inst.localBox.reset(m2->Bounds[0]);
+	for (u32 i=1; i<m2->NumBoundingVerts; ++i)
+		inst.localBox.addInternalPoint(m2->Bounds[i]);
+
+	m2->grab();
+	addInstance(inst);
+}
+
+void CTileCollision::addWMOInstance( IFileWMO* wmo, const matrix4& mat )
+{
+	CFileWMO* fileWmo = static_cast<CFileWMO*>(wmo);
+
+	SInstance inst;
+	inst.type = ECT_WMO;
+	inst.m2 = NULL_PTR;
+	inst.wmo = fileWmo;
+	inst.mat = mat;
+	inst.localBox = fileWmo->getBoundingBox();
+
+	fileWmo->grab();
+	addInstance(inst);
+}
+
+void CTileCollision::addInstance( SInstance& inst )
+{
+	if (!inst.mat.getInverse(inst.invMat))
+		inst.invMat = matrix4::Identity();
+
+	//ȱŴ뾶
+	vector3df unit(1, 0, 0);
+	inst.invMat.rotateVect(unit);
+	inst.invScale = unit.getLength();
+
+	inst.box = inst.localBox;
+	inst.mat.transformBox(inst.box);
+	getCellRange(inst.box, inst.rowMin, inst.rowMax, inst.colMin, inst.colMax);
+
+	u32 index = (u32)Instances.size();
+	Instances.push_back(inst);
+
+	for (u8 r=inst.rowMin; r<=inst.rowMax; ++r)
+	{
+		for (u8 c=inst.colMin; c<=inst.colMax; ++c)
+			CellInstances[r][c].push_back(index);
+	}
+
+	Box.addInternalBox(inst.box);
+}
+
+void CTileCollision::getCellRange( const aabbox3df& box, u8& rowMin, u8& rowMax, u8& colMin, u8& colMax ) const
+{
+	//rowz, colxС
+	rowMin = (u8)toCell((box.MinEdge.Z - ZBase) / CHUNKSIZE, 15);
+	rowMax = (u8)toCell((box.MaxEdge.Z - ZBase) / CHUNKSIZE, 15);
+	colMin = (u8)toCell((XBase - box.MaxEdge.X) / CHUNKSIZE, 15);
+	colMax = (u8)toCell((XBase - box.MinEdge.X) / CHUNKSIZE, 15);
+}
+
+bool CTileCollision::sweep( const vector3df& start, const vector3df& end, f32 radius, SCollisionHit& hit ) const
+{
+	aabbox3df sweepBox(start);
+	sweepBox.addInternalPoint(end);
+	sweepBox.MinEdge -= vector3df(radius);
+	sweepBox.MaxEdge += vector3df(radius);
+
+	if (!sweepBox.intersectsWithBox(Box))
+		return false;
+
+	u8 rowMin, rowMax, colMin, colMax;
+	getCellRange(sweepBox, rowMin, rowMax, colMin, colMax);
+
+	bool found = false;
+
+	//terrain
+	SSweepParam param;
+	param.start = start;
+	param.dir = end - start;
+	param.radius = radius;
+	param.fraction = hit.fraction;
+	param.hit = false;
+
+	for (u8 r=rowMin; r<=rowMax; ++r)
+	{
+		for (u8 c=colMin; c<=colMax; ++c)
+			sweepTerrain(r, c, sweepBox, param);
+	}
+
+	if (param.hit)
+	{
+		hit.fraction = param.fraction;
+		hit.normal = param.normal;
+		hit.position = start + param.dir * param.fraction;
+		hit.type = ECT_TERRAIN;
+		found = true;
+	}
+
+	//instances, ӵʵֻںͲѯΧصĵһ
+	for (u8 r=rowMin; r<=rowMax; ++r)
+	{
+		for (u8 c=colMin; c<=colMax; ++c)
+		{
+			const std::vector<u32>& cell = CellInstances[r][c];
+			for (u32 k=0; k<(u32)cell.size(); ++k)
+			{
+				const SInstance& inst = Instances[cell[k]];
+				if (r != max_(inst.rowMin, rowMin) || c != max_(inst.colMin, colMin))
+					continue;
+
+				if (!inst.box.intersectsWithBox(sweepBox))
+					continue;
+
+				if (sweepInstance(inst, start, end, radius, hit))
+					found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+void CTileCollision::sweepTerrain( u8 row, u8 col, const aabbox3df& sweepBox, SSweepParam& param ) const
+{
+	const CMapChunk* chunk = FileADT->getChunk(row, col);
+	if (!chunk->box.intersectsWithBox(sweepBox))
+		return;
+
+	s32 crMin = toCell((sweepBox.MinEdge.Z - chunk->zbase) / UNITSIZE, 7);
+	s32 crMax = toCell((sweepBox.MaxEdge.Z - chunk->zbase) / UNITSIZE, 7);
+	s32 ccMin = toCell((chunk->xbase - sweepBox.MaxEdge.X) / UNITSIZE, 7);
+	s32 ccMax = toCell((chunk->xbase - sweepBox.MinEdge.X) / UNITSIZE, 7);
+
+	//CTerrainServicesĸ߾ͬ, ÿ4Χĵ
+	const SVertex_PNCT2* vertices = FileADT->getChunkVertices(row, col);
+	for (s32 r=crMin; r<=crMax; ++r)
+	{
+		const SVertex_PNCT2* thisrow = &vertices[r * 17];
+		const SVertex_PNCT2* nextrow = thisrow + 9;
+		const SVertex_PNCT2* overrow = thisrow + 17;
+
+		for (s32 c=ccMin; c<=ccMax; ++c)
+		{
+			const vector3df& tl = thisrow[c].Pos;
+			const vector3df& tr = thisrow[c + 1].Pos;
+			const vector3df& center = nextrow[c].Pos;
+			const vector3df& bl = overrow[c].Pos;
+			const vector3df& br = overrow[c + 1].Pos;
+
+			sweepTriangle(tl, tr, center, param);
+			sweepTriangle(tr, br, center, param);
+			sweepTriangle(br, bl, center, param);
+			sweepTriangle(bl, tl, center, param);
+		}
+	}
+}
+
+bool CTileCollision::sweepInstance( const SInstance& inst, const vector3df& start, const vector3df& end, f32 radius, SCollisionHit& hit ) const
+{
+	vector3df localStart = start;
+	vector3df localEnd = end;
+	inst.invMat.transformVect(localStart);
+	inst.invMat.transformVect(localEnd);
+	f32 localRadius = radius * inst.invScale;
+
+	aabbox3df localBox(localStart);
+	localBox.addInternalPoint(localEnd);
+	localBox.MinEdge -= vector3df(localRadius);
+	localBox.MaxEdge += vector3df(localRadius);
+	if (!localBox.intersectsWithBox(inst.localBox))
+		return false;
+
+	SSweepParam param;
+	param.start = localStart;
+	param.dir = localEnd - localStart;
+	param.radius = localRadius;
+	param.fraction = hit.fraction;
+	param.hit = false;
+
+	if (inst.type == ECT_M2)
+	{
+		sweepM2(inst.m2, param);
+	}
+	else
+	{
+		const CFileWMO* wmo = inst.wmo;
+		for (u32 i=0; i<wmo->getNumGroups(); ++i)
+		{
+			const CWMOGroup* group = &wmo->Groups[i];
+			if (group->NumBspNodes && group->box.intersectsWithBox(localBox))
+				sweepWMOGroup(wmo, group, param);
+		}
+	}
+
+	if (!param.hit)
+		return false;
+
+	vector3df normal = param.normal;
+	inst.mat.rotateVect(normal);
+	normal.normalize();
+
+	hit.fraction = param.fraction;
+	hit.normal = normal;
+	hit.position = start + (end - start) * param.fraction;
+	hit.type = inst.type;
+	return true;
+}
+
+void CTileCollision::sweepM2( const IFileM2* m2, SSweepParam& param ) const
+{
+	const vector3df* verts = m2->Bounds;
+	const u16* tris = m2->BoundTris;
+	u32 numTris = m2->NumBoundingTriangles / 3;
+	for (u32 i=0; i<numTris; ++i)
+	{
+		const u16* idx = &tris[i * 3];
+		if (idx[0] >= m2->NumBoundingVerts || idx[1] >= m2->NumBoundingVerts || idx[2] >= m2->NumBoundingVerts)
+			continue;
+		sweepTriangle(verts[idx[0]], verts[idx[1]], verts[idx[2]], param);
+	}
+}
+
+void CTileCollision::sweepWMOGroup( const CFileWMO* wmo, const CWMOGroup* group, SSweepParam& param ) const
+{
+	struct SStackEntry
+	{
+		s16		node;
+		f32		t0;
+		f32		t1;
+	};
+
+	SStackEntry stack[BSP_STACK_SIZE];
+	u32 top = 0;
+
+	stack[top].node = 0;
+	stack[top].t0 = 0.0f;
+	stack[top].t1 = param.fraction;
+	++top;
+
+	const u32* indices = &wmo->Indices[group->IStart];
+
+	while (top > 0)
+	{
+		SStackEntry e = stack[--top];
+		if (e.node < 0 || (u32)e.node >= group->NumBspNodes || e.t0 > param.fraction)
+			continue;
+
+		const SWMOBspNode& node = group->BspNodes[e.node];
+		if (node.planetype & 4)			//leaf
+		{
+			for (u32 k=0; k<node.numfaces; ++k)
+			{
+				u32 face = node.firstface + k;
+				if (face >= group->NumBspTriangles)
+					break;
+
+				u32 tri = group->BspTriangles[face];
+				if (tri * 3 + 2 >= group->ICount)
+					continue;
+
+				const u32* idx = &indices[tri * 3];
+				sweepTriangle(wmo->Vertices[idx[0]].Pos, wmo->Vertices[idx[1]].Pos, wmo->Vertices[idx[2]].Pos, param);
+			}
+			continue;
+		}
+
+		f32 t1 = min_(e.t1, param.fraction);
+		f32 s = getBspAxis(param.start, node.planetype);
+		f32 d = getBspAxis(param.dir, node.planetype);
+		f32 p0 = s + d * e.t0 - node.distance;
+		f32 p1 = s + d * t1 - node.distance;
+
+		f32 r = param.radius + COLLISION_EPSILON;
+		bool toNeg = min_(p0, p1) < r;
+		bool toPos = max_(p0, p1) > -r;
+
+		if (top + 2 > BSP_STACK_SIZE)
+		{
+			ASSERT(false);
+			break;
+		}
+
+		if (toNeg && toPos)
+		{
+			s16 nearNode = p0 < 0 ? node.left : node.right;
+			s16 farNode = p0 < 0 ? node.right : node.left;
+
+			//ָ߰г, ඼
+			f32 tSplit = t1;
+			if (param.radius == 0.0f && fabs(d) > COLLISION_EPSILON)
+				tSplit = clamp_((node.distance - s) / d, e.t0, t1);
+
+			stack[top].node = farNode;
+			stack[top].t0 = param.radius == 0.0f ? max_(e.t0, tSplit - COLLISION_EPSILON) : e.t0;
+			stack[top].t1 = t1;
+			++top;
+
+			stack[top].node = nearNode;
+			stack[top].t0 = e.t0;
+			stack[top].t1 = param.radius == 0.0f ? min_(t1, tSplit + COLLISION_EPSILON) : t1;
+			++top;
+		}
+		else
+		{
+			stack[top].node = toNeg ? node.left : node.right;
+			stack[top].t0 = e.t0;
+			stack[top].t1 = t1;
+			++top;
+		}
+	}
+}
+
+void CTileCollision::sweepTriangle( const vector3df& a, const vector3df& b, const vector3df& c, SSweepParam& param )
+{
+	const vector3df e1 = b - a;
+	const vector3df e2 = c - a;
+
+	if (param.radius == 0.0f)
+	{
+		//Moller-Trumbore, ˫
+		vector3df p = param.dir.crossProduct(e2);
+		f32 det = e1.dotProduct(p);
+		if (fabs(det) < COLLISION_EPSILON * COLLISION_EPSILON)
+			return;
+
+		f32 invDet = 1.0f / det;
+		vector3df s = param.start - a;
+		f32 u = s.dotProduct(p) * invDet;
+		if (u < 0.0f || u > 1.0f)
+			return;
+
+		vector3df q = s.crossProduct(e1);
+		f32 v = param.dir.dotProduct(q) * invDet;
+		if (v < 0.0f || u + v > 1.0f)
+			return;
+
+		f32 t = e2.dotProduct(q) * invDet;
+		if (t < 0.0f || t >= param.fraction)
+			return;
+
+		vector3df normal = e1.crossProduct(e2);
+		normal.normalize();
+		if (normal.dotProduct(param.dir) > 0.0f)
+			normal = -normal;
+
+		param.fraction = t;
+		param.normal = normal;
+		param.hit = true;
+		return;
+	}
+
+	//ɨ: Ⱥƽ, ٺ, 
+	vector3df faceNormal = e1.crossProduct(e2);
+	f32 len = faceNormal.getLength();
+	if (len < COLLISION_EPSILON * COLLISION_EPSILON)
+		return;
+	faceNormal /= len;
+
+	vector3df n = faceNormal;
+	f32 dist = n.dotProduct(param.start - a);
+	if (dist < 0.0f)
+	{
+		n = -n;
+		dist = -dist;
+	}
+
+	const f32 r = param.radius;
+	f32 nDotV = n.dotProduct(param.dir);
+	f32 t0, t1;
+	bool embedded = false;
+	if (fabs(nDotV) < COLLISION_EPSILON)
+	{
+		if (dist >= r)
+			return;
+		embedded = true;
+		t0 = 0.0f;
+		t1 = 1.0f;
+	}
+	else
+	{
+		t0 = (r - dist) / nDotV;
+		t1 = (-r - dist) / nDotV;
+		if (t0 > t1)
+		{
+			f32 tmp = t1;
+			t1 = t0;
+			t0 = tmp;
+		}
+		if (t0 > 1.0f || t1 < 0.0f)
+			return;
+		t0 = clamp_(t0, 0.0f, 1.0f);
+	}
+
+	f32 bestT = param.fraction;
+	vector3df contact;
+	bool found = false;
+
+	if (!embedded)
+	{
+		vector3df planePoint = param.start - n * r + param.dir * t0;
+		if (isPointInTriangle(planePoint, a, b, c, faceNormal))
+		{
+			if (t0 < bestT)
+			{
+				bestT = t0;
+				contact = planePoint;
+				found = true;
+			}
+			else
+			{
+				return;
+			}
+		}
+	}
+
+	if (!found)
+	{
+		const f32 velSq = param.dir.getLengthSQ();
+		const vector3df* points[3] = { &a, &b, &c };
+		f32 root;
+
+		for (u32 i=0; i<3; ++i)
+		{
+			const vector3df& p = *points[i];
+			f32 qa = velSq;
+			f32 qb = 2.0f * param.dir.dotProduct(param.start - p);
+			f32 qc = (p - param.start).getLengthSQ() - r * r;
+			if (getLowestRoot(qa, qb, qc, bestT, root))
+			{
+				bestT = root;
+				contact = p;
+				found = true;
+			}
+		}
+
+		for (u32 i=0; i<3; ++i)
+		{
+			const vector3df& p1 = *points[i];
+			const vector3df& p2 = *points[(i + 1) % 3];
+			vector3df edge = p2 - p1;
+			vector3df baseToVertex = p1 - param.start;
+			f32 edgeSq = edge.getLengthSQ();
+			f32 edgeDotVel = edge.dotProduct(param.dir);
+			f32 edgeDotBTV = edge.dotProduct(baseToVertex);
+
+			f32 qa = edgeSq * -velSq + edgeDotVel * edgeDotVel;
+			f32 qb = edgeSq * (2.0f * param.dir.dotProduct(baseToVertex)) - 2.0f * edgeDotVel * edgeDotBTV;
+			f32 qc = edgeSq * (r * r - baseToVertex.getLengthSQ()) + edgeDotBTV * edgeDotBTV;
+			if (getLowestRoot(qa, qb, qc, bestT, root))
+			{
+				f32 f = (edgeDotVel * root - edgeDotBTV) / edgeSq;
+				if (f >= 0.0f && f <= 1.0f)
+				{
+					bestT = root;
+					contact = p1 + edge * f;
+					found = true;
+				}
+			}
+		}
+	}
+
+	if (!found)
+		return;
+
+	vector3df normal = param.start + param.dir * bestT - contact;
+	if (normal.getLengthSQ() < COLLISION_EPSILON * COLLISION_EPSILON)
+		normal = n;
+	normal.normalize();
+
+	param.fraction = bestT;
+	param.normal = normal;
+	param.hit = true;
+}
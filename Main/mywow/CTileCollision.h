@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ICollisionServices.h"
+#include <vector>
+
+class CFileADT;
+class CFileWMO;
+class CWMOGroup;
+
+//һadtײ, 궼tileռ
+//һΪ16x16chunk, ÿ¼ʵ, ڶΪθ, wmo groupbspm2ײ
+//radiusΪ0ʱ, ɨ
+class CTileCollision
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CTileCollision);
+
+public:
+	explicit CTileCollision(IFileADT* adt);
+	~CTileCollision();
+
+public:
+	void addM2Instance(IFileM2* m2, const matrix4& mat);
+	void addWMOInstance(IFileWMO* wmo, const matrix4& mat);
+
+	const aabbox3df& getBoundingBox() const { return Box; }
+
+	//hit.fractionΪǰ, ҵĲŸhit
+	bool sweep(const vector3df& start, const vector3df& end, f32 radius, SCollisionHit& hit) const;
+
+private:
+	struct SInstance
+	{
+		E_COLLISION_TYPE		type;
+		IFileM2*		m2;
+		CFileWMO*		wmo;
+		matrix4		mat;
+		matrix4		invMat;
+		f32		invScale;
+		aabbox3df		localBox;			//ģͿռ
+		aabbox3df		box;				//tileռ
+		u8		rowMin, rowMax, colMin, colMax;
+	};
+
+	struct SSweepParam
+	{
+		vector3df	start;
+		vector3df	dir;
+		f32		radius;
+		f32		fraction;
+		vector3df	normal;
+		bool	hit;
+	};
+
+	void getCellRange(const aabbox3df& box, u8& rowMin, u8& rowMax, u8& colMin, u8& colMax) const;
+	void addInstance(SInstance& inst);
+
+	void sweepTerrain(u8 row, u8 col, const aabbox3df& sweepBox, SSweepParam& param) const;
+	bool sweepInstance(const SInstance& inst, const vector3df& start, const vector3df& end, f32 radius, SCollisionHit& hit) const;
+	void sweepM2(const IFileM2* m2, SSweepParam& param) const;
+	void sweepWMOGroup(const CFileWMO* wmo, const CWMOGroup* group, SSweepParam& param) const;
+
+	static void sweepTriangle(const vector3df& a, const vector3df& b, const vector3df& c, SSweepParam& param);
+
+private:
+	CFileADT*		FileADT;
+	aabbox3df		Box;
+	f32		XBase;
+	f32		ZBase;
+
+	std::vector<SInstance>		Instances;
+	std::vector<u32>		CellInstances[16][16];
+};
@@ -8,7 +8,7 @@
 #include "CSceneRenderServices.h"
 #include "CTerrainServices.h"
 #include "CFileADT.h"
-#include "CFileWDT.h"
+#include "CMesh.h"
 	
 CWDTSceneNode::CWDTSceneNode( IFileWDT* wdt, ISceneNode* parent )
 	: IWDTSceneNode(parent)
@@ -23,6 +23,12 @@ CWDTSceneNode::CWDTSceneNode( IFileWDT* wdt, ISceneNode* parent )
 	Material.Cull = ECM_BACK;
 	Material.FogEnable = true;
 
+	//һֻöɫ
+	WdlMaterial.MaterialType = EMT_LINE;
+	WdlMaterial.Lighting = false;
+	WdlMaterial.Cull = ECM_BACK;
+	WdlMaterial.FogEnable = true;
+
 //scene
 	WdtScene= new wow_wdtScene(this);
 
@@ -33,6 +39,9 @@ CWDTSceneNode::~CWDTSceneNode()
 {
 	delete WdtScene;
 
+	for (u32 i=0; i<25; ++i)
+		delete MapBlocks[i].wdlMesh;
+
 	FileWDT->drop();
 }
 
@@ -44,11 +53,10 @@ void CWDTSceneNode::setCurrentTile( s32 row, s32 col )
 vector3df CWDTSceneNode::getCenter() const
 {
 	vector3df position(0,0,0);
-	if (MapBlocks[0].tile && 
+	if (MapBlocks[0].tile && MapBlocks[0].tile->fileAdt &&
 		MapBlocks[0].tile->row == WdtScene->getRow() && 
 		MapBlocks[0].tile->col == WdtScene->getCol())
 	{
-		ASSERT(MapBlocks[0].tile->fileAdt);
 		position = static_cast<CFileADT*>(MapBlocks[0].tile->fileAdt)->getBoundingBox().getCenter();
 	}
 	else
@@ -75,6 +83,9 @@ bool CWDTSceneNode::getHeightNormal( f32 x, f32 z, f32* height, vector3df* norma
 	for (u32 i=0; i<num; ++i)
 	{
 		const CMapBlock* block = &MapBlocks[i];
+		if (!block->tile || !block->tile->fileAdt)			//û
+			continue;
+
 		CFileADT* adt = static_cast<CFileADT*>(block->tile->fileAdt);
 		if (block->tile->row == (u8)row && block->tile->col == (u8)col)
 		{
@@ -163,6 +174,7 @@ void CWDTSceneNode::render() const
 	for (u32 i=0; i<num; ++i)
 	{
 		renderMapBlock(i);	
+		renderWdlMesh(i);
 	}
 
 // 	if (CamChunk)
@@ -186,11 +198,14 @@ void CWDTSceneNode::registerVisibleChunks( u32 blockIndex, ICamera* cam )
 {
 	CMapBlock* block = &MapBlocks[blockIndex];
 
+	frustum f = cam->getViewFrustum();
+
+	block->wdlVisible = block->wdlMesh && f.isInFrustum(block->wdlWorldBox);
+
 	CFileADT* adt = NULL_PTR;
 	if (!block->tile || !(adt = static_cast<CFileADT*>(block->tile->fileAdt)))
 		return;
 
-	frustum f = cam->getViewFrustum();
 	plane3df clipPlane = cam->getTerrainClipPlane();
 
 	//chunk
@@ -243,6 +258,8 @@ void CWDTSceneNode::updateMapBlock( u32 blockIndex )
 {
 	CMapBlock* block = &MapBlocks[blockIndex];
 
+	updateWdlMesh(blockIndex);
+
 	CFileADT* adt = NULL_PTR;
 	if (!block->tile || !(adt = static_cast<CFileADT*>(block->tile->fileAdt)))
 		return;
@@ -257,6 +274,176 @@ void CWDTSceneNode::updateMapBlock( u32 blockIndex )
 			AbsoluteTransformation.transformBox(dynChunk->terrianWorldBox);
 		}
 	}
+
+	g_Engine->getCollisionServices()->addTile(adt, AbsoluteTransformation);
+}
+
+void CWDTSceneNode::updateWdlMesh( u32 blockIndex )
+{
+	CMapBlock* block = &MapBlocks[blockIndex];
+	STile* tile = block->tile;
+
+	//ADTѼػblocktile, ͷ
+	if (!tile || tile->fileAdt || tile != block->wdlTile)
+	{
+		delete block->wdlMesh;
+		block->wdlMesh = NULL_PTR;
+		block->wdlTile = NULL_PTR;
+		block->wdlVisible = false;
+	}
+
+	if (!tile || tile->fileAdt)
+		return;
+
+	if (!block->wdlMesh)
+	{
+		block->wdlMesh = createWdlMesh(tile);
+		block->wdlTile = tile;
+	}
+
+	if (block->wdlMesh)
+	{
+		block->wdlWorldBox = block->wdlMesh->getBoundingBox();
+		AbsoluteTransformation.transformBox(block->wdlWorldBox);
+	}
+}
+
+IMesh* CWDTSceneNode::createWdlMesh( STile* tile ) const
+{
+	const s16* heights = FileWDT->getWDLHeights(tile->row, tile->col);
+	f32 xbase, zbase;
+	if (!heights || !FileWDT->getTileBase(tile->row, tile->col, xbase, zbase))
+		return NULL_PTR;
+
+	const u32 outer = CFileWDT::WDL_OUTER;
+	const u32 inner = CFileWDT::WDL_INNER;
+	const s16* innerHeights = heights + outer * outer;
+
+	//Χǰ, Ķں, ÿķֳ4, ͸߾ȵε˳һ
+	u32 vcount = CFileWDT::WDL_HEIGHT_COUNT;
+	u32 icount = inner * inner * 4 * 3;
+
+	SVertex_PC* vertices = new SVertex_PC[vcount];
+	u16* indices = new u16[icount];
+
+	aabbox3df box(vector3df(xbase - TILESIZE, 99999.9f, zbase), vector3df(xbase, -99999.9f, zbase + TILESIZE));
+
+	for (u32 r=0; r<outer; ++r)
+	{
+		for (u32 c=0; c<outer; ++c)
+		{
+			f32 h = (f32)heights[r * outer + c];
+			vertices[r * outer + c].Pos.set(xbase - c * CHUNKSIZE, h, zbase + r * CHUNKSIZE);
+			box.MinEdge.Y = min_(box.MinEdge.Y, h);
+			box.MaxEdge.Y = max_(box.MaxEdge.Y, h);
+		}
+	}
+
+	for (u32 r=0; r<inner; ++r)
+	{
+		for (u32 c=0; c<inner; ++c)
+		{
+			f32 h = (f32)innerHeights[r * inner + c];
+			vertices[outer * outer + r * inner + c].Pos.set(xbase - (c + 0.5f) * CHUNKSIZE, h, zbase + (r + 0.5f) * CHUNKSIZE);
+			box.MinEdge.Y = min_(box.MinEdge.Y, h);
+			box.MaxEdge.Y = max_(box.MaxEdge.Y, h);
+		}
+	}
+
+	//ù, ¶Ȱ決ɫ
+	vector3df lightDir(-1.0f, -2.0f, -1.0f);
+	lightDir.normalize();
+	for (u32 i=0; i<vcount; ++i)
+	{
+		vector3df dx, dz;
+		if (i < outer * outer)
+		{
+			u32 r = i / outer;
+			u32 c = i % outer;
+			u32 c0 = c > 0 ? c - 1 : c;
+			u32 c1 = c < outer - 1 ? c + 1 : c;
+			u32 r0 = r > 0 ? r - 1 : r;
+			u32 r1 = r < outer - 1 ? r + 1 : r;
+			dx = vertices[r * outer + c1].Pos - vertices[r * outer + c0].Pos;
+			dz = vertices[r1 * outer + c].Pos - vertices[r0 * outer + c].Pos;
+		}
+		else
+		{
+			u32 r = (i - outer * outer) / inner;
+			u32 c = (i - outer * outer) % inner;
+			dx = vertices[(r + 1) * outer + c + 1].Pos - vertices[r * outer + c].Pos;
+			dz = vertices[(r + 1) * outer + c].Pos - vertices[r * outer + c + 1].Pos;
+		}
+
+		vector3df normal = dz.crossProduct(dx);
+		normal.normalize();
+		if (normal.Y < 0)
+			normal = -normal;
+
+		f32 shade = 0.45f + 0.55f * max_(0.0f, -normal.dotProduct(lightDir));
+		vertices[i].Color = SColor((u32)(120 * shade), (u32)(112 * shade), (u32)(92 * shade));
+	}
+
+	u32 count = 0;
+	for (u32 r=0; r<inner; ++r)
+	{
+		for (u32 c=0; c<inner; ++c)
+		{
+			u16 thisrow0 = (u16)(r * outer + c);
+			u16 thisrow1 = (u16)(r * outer + c + 1);
+			u16 overrow0 = (u16)((r + 1) * outer + c);
+			u16 overrow1 = (u16)((r + 1) * outer + c + 1);
+			u16 center = (u16)(outer * outer + r * inner + c);
+
+			indices[count++] = thisrow0;
+			indices[count++] = thisrow1;
+			indices[count++] = center;
+
+			indices[count++] = thisrow1;
+			indices[count++] = overrow1;
+			indices[count++] = center;
+
+			indices[count++] = overrow1;
+			indices[count++] = overrow0;
+			indices[count++] = center;
+
+			indices[count++] = overrow0;
+			indices[count++] = thisrow0;
+			indices[count++] = center;
+		}
+	}
+	ASSERT(count == icount);
+
+	SBufferParam bufferParam = {0};
+
+	bufferParam.vType = EVT_PC;
+	bufferParam.vbuffer0 = new IVertexBuffer(true);
+	bufferParam.vbuffer0->set(vertices, EST_PC, vcount, EMM_STATIC);
+
+	bufferParam.ibuffer = new IIndexBuffer(true);
+	bufferParam.ibuffer->set(indices, EIT_16BIT, icount, EMM_STATIC);
+
+	return new CMesh(bufferParam, EPT_TRIANGLES, icount / 3, box);
+}
+
+void CWDTSceneNode::renderWdlMesh( u32 blockIndex ) const
+{
+	const CMapBlock* block = &MapBlocks[blockIndex];
+	if (!block->wdlMesh || !block->wdlVisible)
+		return;
+
+	CSceneRenderServices* sceneRenderServices = static_cast<CSceneRenderServices*>(g_Engine->getSceneRenderServices());
+	SRenderUnit unit = {0};
+
+	unit.bufferParam = block->wdlMesh->BufferParam;
+	unit.primType = block->wdlMesh->PrimType;
+	unit.drawParam.numVertices = block->wdlMesh->BufferParam.vbuffer0->Size;
+	unit.primCount = block->wdlMesh->PrimCount;
+	unit.sceneNode = this;
+	unit.material = WdlMaterial;
+	unit.matWorld = &AbsoluteTransformation;
+
+	sceneRenderServices->addRenderUnit(&unit, ERT_MESH);
 }
 
 void CWDTSceneNode::collectBlockRenderList(u32 blockIndex)
@@ -9,6 +9,7 @@ class CFileWDT;
 class ICamera;
 class ISkySceneNode;
 class wow_wdtScene;
+class IMesh;
 
 class CWDTSceneNode : public IWDTSceneNode
 {
@@ -55,13 +56,19 @@ protected:
 		DISALLOW_COPY_AND_ASSIGN(CMapBlock);
 
 	public:
-		CMapBlock() : tile(NULL_PTR)
+		CMapBlock() : tile(NULL_PTR), wdlTile(NULL_PTR), wdlMesh(NULL_PTR), wdlVisible(false)
 		{
 			memset(DynChunks, 0, sizeof(DynChunks));
 		}
 
 		STile* tile;
 
+		//ADTǰWDLĵ;ȵ
+		STile* wdlTile;
+		IMesh* wdlMesh;
+		aabbox3df wdlWorldBox;
+		bool wdlVisible;
+
 		SDynChunk	DynChunks[16][16];
 
 		typedef std::vector<SChunkRenderUnit> T_ChunkRenderList;
@@ -72,6 +79,9 @@ protected:
 protected:
 	void registerVisibleChunks(u32 blockIndex, ICamera* cam);
 	void updateMapBlock(u32 blockIndex);
+	void updateWdlMesh(u32 blockIndex);
+	IMesh* createWdlMesh(STile* tile) const;
+	void renderWdlMesh(u32 blockIndex) const;
 	
 	void collectBlockRenderList(u32 blockIndex);
 	void renderMapBlock(u32 blockIndex) const;
@@ -80,6 +90,7 @@ protected:
 
 protected:
 	SMaterial		Material;
+	SMaterial		WdlMaterial;
 	
 	CMapBlock	MapBlocks[25];
 
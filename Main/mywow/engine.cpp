@@ -3,6 +3,8 @@
 #include "mywow.h"
 #include "COSInfo.h"
 #include "CTimer.h"
+#include "CAssetCache.h"
+#include "CJobSystem.h"
 #include "CFileSystem.h"
 
 //dx9
@@ -32,6 +34,14 @@
 #include "COpenGLManualTextureServices.h"
 #include "COpenGLHelper.h"
 
+//null
+#include "CNullDriver.h"
+#include "CNullHardwareBufferServices.h"
+#include "CNullDrawServices.h"
+#include "CNullResourceLoader.h"
+#include "CNullTextureWriteServices.h"
+#include "CNullManualTextureServices.h"
+
 #ifdef MW_PLATFORM_WINDOWS
 #include "CDSAudioPlayer.h"
 #include "CX2AudioPlayer.h"
@@ -48,6 +58,7 @@
 #include "CRibbonEmitterServices.h"
 #include "CMeshDecalServices.h"
 #include "CTerrainServices.h"
+#include "CCollisionServices.h"
 #include "CSceneRenderServices.h"
 #include "CSceneManager.h"
 #include "CSceneEnvironment.h"
@@ -67,6 +78,7 @@ Engine::Engine(const SEngineInitParam& param, const SWindowInfo& wndInfo) : Mess
 	OSInfo = new COSInfo(param.osversion);
 
 	Timer = new CTimer;
+	JobSystem = new CJobSystem;
 	FileSystem = new CFileSystem(param.baseDir, param.logDir, param.ignoreSetting);
 
 	FileSystem->writeLog(ELOG_GX, "OS: %s  VERSION: %d.%d", OSInfo->getOSName(), OSInfo->MajorVersion, OSInfo->MinorVersion);
@@ -79,6 +91,8 @@ Engine::Engine(const SEngineInitParam& param, const SWindowInfo& wndInfo) : Mess
 
 	WowDatabase = new wowDatabase(WowEnvironment);
 
+	AssetCache = param.useAssetCache ? new CAssetCache(FileSystem->getBaseDirectory()) : NULL_PTR;
+
 	EngineSetting = new engineSetting();
 
 	Driver = NULL_PTR;
@@ -98,6 +112,7 @@ Engine::Engine(const SEngineInitParam& param, const SWindowInfo& wndInfo) : Mess
 	RibbonEmitterServices = NULL_PTR;
 	MeshDecalServices = NULL_PTR;
 	TerrainServices = NULL_PTR;
+	CollisionServices = NULL_PTR;
 
 	SceneRenderServices = NULL_PTR;
 	SceneEnvironment = NULL_PTR;
@@ -116,6 +131,7 @@ Engine::~Engine()
 	delete SceneEnvironment;
 	delete SceneRenderServices;
 
+	delete CollisionServices;
 	delete TerrainServices;
 	delete MeshDecalServices;
 	delete RibbonEmitterServices;
@@ -136,6 +152,8 @@ Engine::~Engine()
 	delete Driver;
 
 	delete EngineSetting;
+	delete JobSystem;
+	delete AssetCache;
 	delete WowDatabase;
 	delete WowEnvironment;
 	delete FileSystem;
@@ -235,6 +253,20 @@ bool Engine::initDriver(E_DRIVER_TYPE driverType, u32 adapter, bool fullscreen,
 
 #endif
 		break;
+	case EDT_NULL:
+
+		Driver = new CNullDriver;
+		if (!static_cast<CNullDriver*>(Driver)->initDriver(WindowInfo, adapter, fullscreen, vsync, antialias, multithread))
+		{
+			goto fail;
+		}
+		HardwareBufferServices = new CNullHardwareBufferServices;
+		DrawServices = new CNullDrawServices;
+		ResourceLoader = new CNullResourceLoader;
+		TextureWriteServices = new CNullTextureWriteServices;
+		ManualTextureServices = new CNullManualTextureServices;
+
+		break;
 
 	default:
 		ASSERT(false);
@@ -286,6 +318,7 @@ bool Engine::initDriver(E_DRIVER_TYPE driverType, u32 adapter, bool fullscreen,
 	RibbonEmitterServices = new CRibbonEmitterServices(5000, 512);
 	MeshDecalServices = new CMeshDecalServices(512);
 	TerrainServices = new CTerrainServices;
+	CollisionServices = new CCollisionServices;
 	SceneRenderServices = new CSceneRenderServices;
 	SceneEnvironment = new CSceneEnvironment;
 
@@ -303,6 +336,7 @@ fail:
 
 	SAFE_DELETE(SceneEnvironment);
 	SAFE_DELETE(SceneRenderServices);
+	SAFE_DELETE(CollisionServices);
 	SAFE_DELETE(TerrainServices);
 	SAFE_DELETE(RibbonEmitterServices);
 	SAFE_DELETE(ParticleSystemServices);
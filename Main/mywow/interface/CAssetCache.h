@@ -0,0 +1,97 @@
+#pragma once
+
+#include "base.h"
+#include "CSysSync.h"
+
+class CMappedFile;
+
+//ԴԤĴ̻, Ŀ¼Ϊ <baseDir>/AssetCache/<type>/<ļhash>.bin
+//ļ: SHeader, SSection[numSections], (16ֽڶ)
+//ֻ¼ļͷƫ, ӳϻֱַʹ, ֶν
+//汾, Դ, ԴļУһΪʧЧ, ´󸲸
+//УwowEnvironment::getFileStampӹ鵵Ԫݵõ, ʱضԴļ
+//loadõĶοSEntryͷǰֱӵԴʹ, ӳдʱƵ
+enum E_ASSET_CACHE_TYPE
+{
+	EACT_M2 = 0,
+	EACT_WMOGROUP,
+	EACT_ADT,
+
+	EACT_COUNT,
+};
+
+struct SAssetCacheSection
+{
+	const void*	data;
+	u32		size;
+};
+
+class CAssetCache
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CAssetCache);
+
+public:
+	//Ԥʽεб仯ʱ
+	enum { CACHE_VERSION = 2 };
+	enum { MAX_SECTIONS = 16 };
+
+	struct SEntry
+	{
+		SEntry() : File(NULL_PTR), NumSections(0) { }
+
+		CMappedFile*		File;
+		u32		NumSections;
+		SAssetCacheSection		Sections[MAX_SECTIONS];
+	};
+
+public:
+	explicit CAssetCache(const c8* baseDir);
+	~CAssetCache();
+
+public:
+	//ԴļͬһݻʱϲԵУ
+	static u64 combineStamp(u64 stamp, u64 other);
+
+	//ɹʱentry.Sectionsָӳڴе, releaseӳ
+	bool load(E_ASSET_CACHE_TYPE type, const c8* filename, u64 srcStamp, SEntry& entry);
+	static void release(SEntry& entry);
+
+	bool save(E_ASSET_CACHE_TYPE type, const c8* filename, u64 srcStamp, const SAssetCacheSection* sections, u32 numSections);
+
+	u32 getNumHits() const { return (u32)NumHits; }
+	u32 getNumMisses() const { return (u32)NumMisses; }
+	u32 getNumWrites() const { return (u32)NumWrites; }
+
+private:
+#	pragma pack (1)
+	struct SHeader
+	{
+		u32		magic;
+		u32		version;
+		u32		type;
+		u32		numSections;
+		u64		nameHash;
+		u64		srcStamp;
+		u32		totalSize;
+	};
+
+	struct SSection
+	{
+		u32		offset;
+		u32		size;
+	};
+#	pragma pack ()
+
+	static u64 hashFileName(const c8* filename);
+
+	void getCachePath(E_ASSET_CACHE_TYPE type, u64 nameHash, c8* path, u32 size) const;
+
+private:
+	c8		CacheDir[QMAX_PATH];
+	lock_type		cs;
+
+	volatile int		NumHits;
+	volatile int		NumMisses;
+	volatile int		NumWrites;
+};
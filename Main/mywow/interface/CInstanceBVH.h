@@ -0,0 +1,94 @@
+#pragma once
+
+#include "core.h"
+#include <vector>
+
+//tileʵΧе4bvh, ڵ4ӺӺҶʵӶSoA
+//üʱһһƽ4, Ҷͬʱ뵭ļ
+class CInstanceBVH
+{
+private:
+	DISALLOW_COPY_AND_ASSIGN(CInstanceBVH);
+
+public:
+	enum
+	{
+		MAX_CULL_PLANES = 6,
+	};
+
+	struct SCullParam
+	{
+		plane3df	planes[MAX_CULL_PLANES];
+		u32		numPlanes;
+		vector3df	camPos;
+		f32		visibleDistance;			//ʵ뾶һľ, Ϊ0ʱж
+		f32		alphaDistance;
+	};
+
+	struct SCullResult
+	{
+		u32		id;
+		f32		alpha;			//С1ʱڵ
+	};
+
+public:
+	CInstanceBVH();
+
+public:
+	void clear();
+
+	//radiusΪ0ʵü
+	void addInstance(u32 id, const aabbox3df& box, f32 radius);
+	void build();
+
+	u32 getNumInstances() const { return (u32)ItemIds.size(); }
+
+	//resultsܷgetNumInstances(), ؿɼ
+	u32 cull(const SCullParam& param, SCullResult* results) const;
+
+private:
+	enum
+	{
+		LEAF_SIZE = 4,
+	};
+
+	struct SNode
+	{
+		f32		minX[4], minY[4], minZ[4];
+		f32		maxX[4], maxY[4], maxZ[4];
+		f32		maxRadius[4];
+		u32		child[4];			//ҶʱΪʵʼλ, Ϊڵ
+		u8		count[4];			//Ҷӵʵ, 0Ϊڲڵ
+		u8		numChildren;
+	};
+
+	struct SBuildItem
+	{
+		aabbox3df	box;
+		vector3df	center;
+		f32		radius;
+		u32		id;
+	};
+
+	struct SCenterLess
+	{
+		explicit SCenterLess(u32 axis) : axis(axis) {}
+		bool operator()(const SBuildItem& a, const SBuildItem& b) const { return get(a.center) < get(b.center); }
+		f32 get(const vector3df& v) const { return axis == 0 ? v.X : (axis == 1 ? v.Y : v.Z); }
+		u32 axis;
+	};
+
+	u32 buildNode(u32 begin, u32 end);
+	void splitRange(u32 begin, u32 end, u32& mid);
+
+private:
+	std::vector<SBuildItem>		BuildItems;
+	std::vector<SNode>		Nodes;
+
+	//Ҷʵ, ĩβ4ȡ
+	std::vector<f32>		ItemMinX, ItemMinY, ItemMinZ;
+	std::vector<f32>		ItemMaxX, ItemMaxY, ItemMaxZ;
+	std::vector<f32>		ItemCenterX, ItemCenterY, ItemCenterZ;
+	std::vector<f32>		ItemInvRadius;
+	std::vector<u32>		ItemIds;
+};
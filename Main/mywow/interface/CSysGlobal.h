@@ -4,10 +4,6 @@
 
 struct SGlobal
 {
-	lock_type refCS;
-	lock_type allocatorCS;
-	lock_type tempCS;
-
 // 	lock_type	textureCS;
 // 	lock_type	hwbufferCS;
 // 	lock_type	vaoCS;
@@ -17,6 +17,7 @@ struct event_type
 #else
 #include <unistd.h>
 #include <pthread.h>
+#include <sys/time.h>
 typedef pthread_mutex_t lock_type;
 struct event_type
 {
@@ -99,9 +100,13 @@ inline bool WAIT_EVENT(event_type* eve, int millisecond = -1)
 	{
 		if (millisecond >= 0)
 		{
+			//pthread_cond_timedwaitҪʱ
+			struct timeval now;
+			gettimeofday(&now, NULL);
+			long nsec = now.tv_usec * 1000 + (long)(millisecond % 1000) * 1000000;
 			struct timespec wait_time;
-			wait_time.tv_sec = millisecond / 1000;
-			wait_time.tv_nsec = (millisecond % 1000) * 1000000;
+			wait_time.tv_sec = now.tv_sec + millisecond / 1000 + nsec / 1000000000;
+			wait_time.tv_nsec = nsec % 1000000000;
 			ret = pthread_cond_timedwait(&eve->cond, &eve->mutex, &wait_time);
 		}
 		else
@@ -137,5 +142,62 @@ inline void SLEEP(int millisecond)
 #endif
 }
 
+//atomic
+//windowsInterlockedϵΪȫ, ƽ̨;ڴ
+inline int ATOMIC_INCREMENT(volatile int* v)			//òҪͬڴ
+{
+#ifdef MW_PLATFORM_WINDOWS
+	return (int)::InterlockedIncrement((volatile LONG*)v);
+#else
+	return __atomic_add_fetch(v, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+inline int ATOMIC_DECREMENT(volatile int* v)			//release֮ǰд, acquire֮
+{
+#ifdef MW_PLATFORM_WINDOWS
+	return (int)::InterlockedDecrement((volatile LONG*)v);
+#else
+	return __atomic_sub_fetch(v, 1, __ATOMIC_ACQ_REL);
+#endif
+}
+
+inline int ATOMIC_COMPARE_EXCHANGE(volatile int* v, int exchange, int comparand)		//ԭֵ
+{
+#ifdef MW_PLATFORM_WINDOWS
+	return (int)::InterlockedCompareExchange((volatile LONG*)v, (LONG)exchange, (LONG)comparand);
+#else
+	__atomic_compare_exchange_n(v, &comparand, exchange, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+	return comparand;
+#endif
+}
+
+inline int ATOMIC_LOAD(const volatile int* v)
+{
+#ifdef MW_PLATFORM_WINDOWS
+	return *v;				//msvc volatileΪacquire
+#else
+	return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+#endif
+}
+
+inline void* ATOMIC_LOAD_PTR(void* const volatile* v)
+{
+#ifdef MW_PLATFORM_WINDOWS
+	return *v;
+#else
+	return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+#endif
+}
+
+inline void ATOMIC_STORE_PTR(void* volatile* v, void* p)			//֮ǰдATOMIC_LOAD_PTRɼ
+{
+#ifdef MW_PLATFORM_WINDOWS
+	*v = p;					//msvc volatileдΪrelease
+#else
+	__atomic_store_n(v, p, __ATOMIC_RELEASE);
+#endif
+}
 
 
+
\ No newline at end of file
@@ -3,6 +3,13 @@
 #include "core.h"
 #include "SWindowInfo.h"
 
+enum E_CPU_FEATURE
+{
+	ECPU_SSE2 = 0x1,
+	ECPU_SSSE3 = 0x2,
+	ECPU_AVX2 = 0x4,			//ͬʱҪϵͳymmĴ
+};
+
 class CSysUtility
 {
 public:
@@ -20,4 +27,9 @@ public:
 
 	static void exitProcess(int ret);
 
+	static u32 getProcessorCount();
+
+	//E_CPU_FEATURE
+	static u32 getCPUFeatures();
+
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "core.h"
+
+class IFileADT;
+class IFileM2;
+class IFileWMO;
+
+enum E_COLLISION_TYPE
+{
+	ECT_NONE = 0,
+	ECT_TERRAIN,
+	ECT_WMO,
+	ECT_M2,
+};
+
+struct SCollisionHit
+{
+	SCollisionHit() : fraction(1.0f), type(ECT_NONE) { }
+
+	vector3df	position;			//Ϊ, ΪӴʱ
+	vector3df	normal;
+	f32		fraction;			//߶εı [0, 1]
+	E_COLLISION_TYPE	type;
+};
+
+//ײѯ, ǵchunk, wmo group(bsp)m2ײ
+//ÿadtһṹ: 16x16 chunkʵ, ʵڲøԵģͿռ
+//ѯռ, ӿ϶ʱֵ߳
+class ICollisionServices
+{
+public:
+	virtual ~ICollisionServices() {}
+
+public:
+	//tileѴʱֻ±任
+	virtual void addTile(IFileADT* adt, const matrix4& transform) = 0;
+	virtual void removeTile(IFileADT* adt) = 0;
+
+	//matΪʵtileռı任
+	virtual void addM2Instance(IFileADT* adt, IFileM2* m2, const matrix4& mat) = 0;
+	virtual void addWMOInstance(IFileADT* adt, IFileWMO* wmo, const matrix4& mat) = 0;
+
+	//߶κͳĵһ
+	virtual bool raycast(const line3df& ray, SCollisionHit& hit) const = 0;
+	//posmaxDropڵĵһ
+	virtual bool getHeightBelow(const vector3df& pos, f32 maxDrop, SCollisionHit& hit) const = 0;
+	//startƶend, һνӴλ
+	virtual bool sweepSphere(const vector3df& start, const vector3df& end, f32 radius, SCollisionHit& hit) const = 0;
+
+	//ѯ, δеhits[i].typeΪECT_NONE, 
+	virtual u32 raycastBatch(const line3df* rays, u32 count, SCollisionHit* hits) = 0;
+	virtual u32 getHeightBelowBatch(const vector3df* positions, u32 count, f32 maxDrop, SCollisionHit* hits) = 0;
+	virtual u32 sweepSphereBatch(const vector3df* starts, const vector3df* ends, u32 count, f32 radius, SCollisionHit* hits) = 0;
+};
@@ -50,6 +50,9 @@ public:
 	virtual void addTextW(const c16* text, SColor color, vector2di position, int nCharCount = -1, recti* pClip = NULL_PTR, bool bVertical = false) = 0;
 	virtual void flushText() = 0;
 
+	//Ԥȹդһַ, ÿflushTextʱһ, ״ʾʱ
+	virtual void prewarmChars(const c16* text, int nCharCount = -1) = 0;
+
 	virtual dimension2du getTextExtent(const char* utf8text, int nCharCount = -1, bool vertical = false) = 0;	
 	virtual dimension2du getWTextExtent(const c16* text, int nCharCount = -1, bool vertical = false) = 0;	
 	virtual dimension2du getWCharExtent(c16 ch, bool vertical = false) = 0;
@@ -43,7 +43,7 @@ private:
 	DISALLOW_COPY_AND_ASSIGN(CMapChunk);
 
 public:
-	CMapChunk() : numTextures(0), numAlphaMap(0), sounds(NULL_PTR)
+	CMapChunk() : numTextures(0), numAlphaMap(0), numSounds(0), sounds(NULL_PTR)
 	{ 
 		::memset(textures,0, sizeof(ITexture*)*4);
 		areaID = 0;
@@ -99,6 +99,7 @@ public:
 #endif
 
 	//sound
+	u32		numSounds;
 	SChunkSound*		sounds;	
 
 	ADT::MCLY	mclys[4];
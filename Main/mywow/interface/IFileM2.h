@@ -65,6 +65,16 @@ enum E_BONE_TYPE
 	EBT_COUNT
 };
 
+//LOD, ʵֻ㼶𲻳ǰLODĹ, øı任
+enum E_BONE_LOD
+{
+	EBL_COARSE = 0,			//
+	EBL_MEDIUM,
+	EBL_FINE,				//ָ, 沿, ϵϸ
+
+	EBL_COUNT
+};
+
 struct SModelBone
 {
 	SWowAnimationVec3		trans;
@@ -76,9 +86,10 @@ struct SModelBone
 	u32		flags;
 	s16		geosetId;
 	E_BONE_TYPE  bonetype;			//from bone lookup table
+	u8		lod;				//E_BONE_LOD, ڸ
 	bool		billboard;
 
-	void		init(const u8* filedata, s32* globalSeq, u32 numGlobalSeq, const M2::bone& b, SAnimFile* animFiles)
+	void		init(s32* globalSeq, u32 numGlobalSeq, const M2::bone& b, IAnimSource* source)
 	{
 		parent = b._ParentBone;
 		billboard = (b._Flags & 8) != 0;
@@ -86,9 +97,16 @@ struct SModelBone
 		geosetId = b._GeosetID;
 
 		pivot = fixCoordinate(b._PivotPoint);
-		trans.init(&b._Translation, filedata, animFiles, globalSeq, numGlobalSeq);
-		rot.init(&b._Rotation, filedata, animFiles, globalSeq, numGlobalSeq);
-		scale.init(&b._Scaling, filedata, animFiles, globalSeq, numGlobalSeq);
+		trans.init(&b._Translation, source, globalSeq, numGlobalSeq);
+		rot.init(&b._Rotation, source, globalSeq, numGlobalSeq);
+		scale.init(&b._Scaling, source, globalSeq, numGlobalSeq);
+	}
+
+	u32		releaseUnusedAnimations(T_AnimBlockList& retired)
+	{
+		return trans.releaseUnusedAnimations(retired) + 
+			rot.releaseUnusedAnimations(retired) + 
+			scale.releaseUnusedAnimations(retired);
 	}
 };
 
@@ -168,7 +186,7 @@ public:
 	s8		Index;
 
 	typedef std::unordered_set<u8> T_BoneIndices;
-	T_BoneIndices			BoneIndices;
+	T_BoneIndices			BoneIndices;			//ֻзʱʹ, ӻʱΪ
 
 	typedef std::unordered_map<u8, u8>	T_bone2boneMap;	 
 	std::vector<u8>	local2globalMap;					//local -> global
@@ -346,6 +364,9 @@ public:
 	virtual bool addAction(wow_m2Action* action) = 0;
 	virtual wow_m2Action* getAction(const c8* name) const = 0;
 
+	//ժϴε֮ûвŹĹ, Ҫʱ½, ݿretiredɵӺͷ
+	virtual u32 releaseUnusedAnimations(T_AnimBlockList& retired) = 0;
+
 	vector3df getBoundingAACenter() const { return BoundingAABBox.getCenter(); }
 	ITexture* getTexture(u32 idx) const
 	{ 
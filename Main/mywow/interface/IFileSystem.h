@@ -3,6 +3,7 @@
 #include "base.h"
 
 class IReadFile;
+class IMemFile;
 class IWriteFile;
 class IConfigs;
 
@@ -14,6 +15,8 @@ public:
 public:
 	virtual IReadFile* createAndOpenFile( const c8* filename, bool binary ) = 0;
 	virtual IWriteFile* createAndWriteFile( const c8* filename, bool binary, bool append = false) = 0;
+	//ļIMemFile, ϴļӳԭؽ; nameΪIMemFileļ
+	virtual IMemFile* createMemFile( const c8* filename, const c8* name, bool tempfile, bool allowMap = true ) = 0;
 
 	virtual bool createDirectory(const c8* dirname) = 0;
 	virtual bool deleteDirectory(const c8* dirname) = 0;
@@ -11,7 +11,7 @@ public:
 	virtual u32 read(void* dest, u32 bytes) = 0;
 	virtual u32 getSize() const = 0;
 	virtual u32 getPos() const = 0;
-	virtual u8* getBuffer() = 0;
+	virtual u8* getBuffer() = 0;			//ɾIMemFileʧЧ, Ҫ뿽IMemFile
 	virtual u8* getPointer() = 0;
 	virtual bool isEof() const = 0;
 	virtual bool seek(s32 offset, bool relative=false) = 0;
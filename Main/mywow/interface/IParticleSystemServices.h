@@ -23,8 +23,8 @@ public:
 
 	virtual f32 getParticleDynamicDensity() const = 0;
 	virtual void updateVertices(u32 numVertices) = 0;
-	virtual Particle* getParticle()= 0;
-	virtual void putParticle(Particle* p) = 0;
+	virtual u32 allocParticles(u32 count) = 0;
+	virtual void freeParticles(u32 count) = 0;
 	virtual u32 getMaxVertexCount() const = 0;
 	virtual u32 getBufferQuota() const = 0;
 
@@ -16,6 +16,8 @@ class IResourceCache;
 template <class T>
 class IReferenceCounted
 {
+	friend class IResourceCache<T>;
+
 public:
 	//
 	IReferenceCounted() : ReferenceCounter(1), Cache(NULL_PTR)
@@ -27,29 +29,34 @@ public:
 	//
 	void grab()
 	{ 
-		BEGIN_LOCK(&g_Globals.refCS);
-		++ReferenceCounter;
-		END_LOCK(&g_Globals.refCS);
+		ATOMIC_INCREMENT(&ReferenceCounter);
 	}
 
 	bool drop()
 	{
-		s32 refCount;
-
-		BEGIN_LOCK(&g_Globals.refCS);
-
-		ASSERT( ReferenceCounter>0 );
-		--ReferenceCounter;
-		refCount = ReferenceCounter;
-
-		END_LOCK(&g_Globals.refCS);
-
-		if (refCount == 1 && Cache)			
+		//cacheʱ2->1ʾֻʣcacheУcacheɣֹtryLoadFromCache
+		if (Cache)
 		{
-			onRemove();
-			Cache->removeFromCache(static_cast<T*>(this));	
+			s32 refCount = ATOMIC_LOAD(&ReferenceCounter);
+			while (refCount > 2)
+			{
+				s32 old = ATOMIC_COMPARE_EXCHANGE(&ReferenceCounter, refCount - 1, refCount);
+				if (old == refCount)
+					return false;
+				refCount = old;
+			}
+
+			if (refCount == 2)
+			{
+				Cache->removeFromCache(static_cast<T*>(this));
+				return false;
+			}
 		}
-		else if ( 0 == refCount )
+
+		s32 refCount = ATOMIC_DECREMENT(&ReferenceCounter);
+		ASSERT( refCount >= 0 );
+
+		if ( 0 == refCount )
 		{
 			if (!Cache)
 				onRemove();
@@ -63,13 +70,7 @@ public:
 	//
 	s32 getReferenceCount() const 
 	{ 
-		s32 refCount;
-
-		BEGIN_LOCK(&g_Globals.refCS);
-		refCount = ReferenceCounter;
-		END_LOCK(&g_Globals.refCS);
-
-		return refCount; 
+		return ATOMIC_LOAD(&ReferenceCounter); 
 	}
 
 	const c8* getFileName() const { return FileName.c_str(); }
@@ -103,9 +104,12 @@ public:
 public:
 	T* tryLoadFromCache( const char* filename );
 	void addToCache( T* item );
-	void removeFromCache( T* item );
+	void removeFromCache( T* item );			//ͷitemһ, ֻʣcacheʱƵfreelist
 	void flushCache();
 	void setCacheLimit(u32 limit);
+
+	typedef void (*ITEMCALLBACK)(T* item, void* param);
+	void iterateItems(ITEMCALLBACK callback, void* param);			//ʹкfreelistе, csڻص
 	u32 getCacheLimit() const { return CacheLimit; }
 
 protected:
@@ -187,15 +191,29 @@ void IResourceCache<T>::addToCache(T* item)
 template <class T>
 void IResourceCache<T>::removeFromCache( T* item )
 {
+	IReferenceCounted<T>* ref = static_cast<IReferenceCounted<T>*>(item);
+
+	BEGIN_LOCK(&cs);
+
+	//tryLoadFromCachegrabü1ֻcache
+	s32 refCount = ATOMIC_DECREMENT(&ref->ReferenceCounter);
+	ASSERT(refCount >= 1);
+	if (refCount != 1)
+	{
+		END_LOCK(&cs);
+		return;
+	}
+
 	const c8* filename = item->getFileName();
 	ASSERT(!isAbsoluteFileName(filename) && isNormalized(filename) && isLowerFileName(filename));
-	
-	BEGIN_LOCK(&cs);
+
 	typename T_UseMap::iterator itr = UseMap.find(filename);
-	ASSERT(itr != UseMap.end());
+	ASSERT(itr != UseMap.end() && itr->second == item);
 	if (itr != UseMap.end())
 		UseMap.erase(itr);
 
+	ref->onRemove();
+
 	if (!CacheLimit)			//Ƶfreelist
 	{
 		END_LOCK(&cs);
@@ -204,20 +222,34 @@ void IResourceCache<T>::removeFromCache( T* item )
 		return;
 	}
 
+	T_FreeList evictList;
 	while( FreeList.size() >= CacheLimit )
 	{
 		ASSERT(FreeList.back()->getReferenceCount() == 1);
-		T* t = FreeList.back();
-		END_LOCK(&cs);
-
-		t->drop();
-		
-		BEGIN_LOCK(&cs);
+		evictList.push_back(FreeList.back());
 		FreeList.pop_back();
 	}
 	FreeList.push_front(item);
 
 	END_LOCK(&cs);
+
+	//ѴfreelistƳ߳޷ȡͷ
+	for (typename T_FreeList::const_iterator itr = evictList.begin(); itr != evictList.end(); ++itr)
+		(*itr)->drop();
+}
+
+template <class T>
+void IResourceCache<T>::iterateItems( ITEMCALLBACK callback, void* param )
+{
+	BEGIN_LOCK(&cs);
+
+	for(typename T_UseMap::const_iterator itr = UseMap.begin(); itr != UseMap.end(); ++itr)
+		callback(itr->second, param);
+
+	for (typename T_FreeList::const_iterator itr = FreeList.begin(); itr != FreeList.end(); ++itr)
+		callback(*itr, param);
+
+	END_LOCK(&cs);
 }
 
 template <class T>
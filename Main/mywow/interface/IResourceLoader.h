@@ -1,6 +1,6 @@
 #pragma once
 
-#include "base.h"
+#include "core.h"
 
 template <class T>
 class IReferenceCounted;
@@ -50,6 +50,7 @@ public:
 		ET_M2,
 		ET_WMO,
 		ET_ADT,
+		ET_ANIM,			//m2е.animļ, ɺbeginFrameCM2AnimSource
 	};
 
 	struct SParamBlock
@@ -65,6 +66,10 @@ public:
 		SParamBlock		param;
 		void* file;
 		E_TASK_TYPE	type;
+		f32		priority;		//ԽСԽȼ
+		vector3df	position;		//ʵ, ƶȼ
+		bool	hasPosition;
+		u32		buildBytes;		//̻߳ҪԴԴֽ(), ÿ֡Ԥ
 		bool	cancel;		//Ϊcancelʱ
 	};
 
@@ -88,30 +93,45 @@ public:
 	virtual void registerM2Loaded(IM2LoadCallback* callback) = 0;
 	virtual void removeM2Loaded(IM2LoadCallback* callback) = 0;
 
-	const STask& getCurrentTask() const { return currentTask; }
-	virtual void clearCurrentTask() = 0;
-
 	virtual void setCacheLimit(E_CACHE_TYPE type, u32 limit) = 0;
 	virtual u32 getCacheLimit(E_CACHE_TYPE type) const= 0;
 
+	//ͷŻm2ϴεûвŹĹк.animļ, ͷŵ
+	//ܺ͹ĸͬʱ, ժµݵһεʱͷ
+	virtual u32 releaseUnusedAnimations() = 0;
+
+	//positionΪʵ, ĵľһȼ, Ϊʱȼ
 	//m2 async loading
-	virtual void beginLoadM2(const c8* filename, const SParamBlock& param) = 0;
-	virtual bool m2LoadCompleted() = 0;
+	virtual void beginLoadM2(const c8* filename, const SParamBlock& param, const vector3df* position = NULL_PTR) = 0;
 
 	//wmo async loading
-	virtual void beginLoadWMO(const c8* filename, const SParamBlock& param) = 0;
-	virtual bool wmoLoadCompleted() = 0;
+	virtual void beginLoadWMO(const c8* filename, const SParamBlock& param, const vector3df* position = NULL_PTR) = 0;
+
+	//adt async loading, distanceɵ߼, λñ仯setTaskPriority
+	virtual void beginLoadADT(const c8* filename, const SParamBlock& param, f32 distance = 0.0f) = 0;
+
+	//.anim async loading, param1ΪCM2AnimSource, param2Ϊк
+	virtual void beginLoadAnim(const c8* filename, const SParamBlock& param) = 0;
 
-	//adt async loading
-	virtual void beginLoadADT(const c8* filename, const SParamBlock& param) = 0;
-	virtual bool adtLoadCompleted() = 0;
+	//ɵɶ, ̲߳߳ȡ
+	//ȡsenderύһtype͵, task.fileý
+	//֡Ԥʱfalse, ÿ֡ȡһ
+	virtual bool popCompletedTask(E_TASK_TYPE type, const void* sender, STask& task) = 0;
+	virtual void finishCompletedTask() = 0;			//ȡ, ʱ뱾֡Ԥ
+	virtual u32 getNumCompletedTasks() const = 0;
 
-	virtual void beginLoading() = 0;
+	//ÿ֡Ԥ, timeLimitΪ΢, byteLimitΪԴֽ, 0Ϊ
+	virtual void setCompletedTaskBudget(u32 timeLimit, u32 byteLimit) = 0;
+	virtual void beginFrame() = 0;			//ÿ֡ʼʱԤ, .anim, ƶԶʱŶӵ
+
+	virtual void setLoadingCenter(const vector3df& center) = 0;			//һΪλ, ̵ֻ߳
+	virtual void setTaskPriority(const void* sender, const void* param2, f32 distance) = 0;		//Ŷparam1Ϊsender, param2ͬľ
+
+	virtual void beginLoading(u32 numThreads = 0) = 0;		//0Ϊcpu
+	virtual bool isMultiThread() const = 0;			//ûм߳ʱbeginLoad*
 	virtual void cancelAll(E_TASK_TYPE type) = 0;
-	virtual void waitLoadingSuspend() = 0;
-	virtual void resumeLoading() = 0;
+	virtual void cancelTasks(const void* sender) = 0;		//ȡparam1Ϊsender
+	virtual void cancelTask(const void* sender, const void* param2) = 0;		//ȡparam1Ϊsender, param2ͬ
+	virtual void waitLoadingSuspend() = 0;			//ȴ߳ڽ
 	virtual void endLoading()  = 0;
-
-protected:
-	STask currentTask;
 };
\ No newline at end of file
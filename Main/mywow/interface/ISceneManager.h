@@ -25,10 +25,25 @@ class IM2SceneNodeAddCallback;
 
 #define MAX_SCENENODE_SEQUENCE	16
 
+//׶κʱ(΢), ֻCalcPerf֡ڲ
+struct SFramePerf
+{
+	u32		tickTime;
+	u32		renderTime;
+	u32		terrainTime;
+	u32		wmoTime;
+	u32		meshTime;
+	u32		alphaTestTime;
+	u32		transparentTime;
+	u32		wire3DTime;
+	u32		time2D;
+	u32		gpuTime;
+};
+
 class ISceneManager 
 {
 public:
-	ISceneManager() : BackgroundColor(64,64,64), ShowDebugBase(true), CalcPerf(false)
+	ISceneManager() : BackgroundColor(64,64,64), ShowDebugBase(true), CalcPerf(false), PerfEveryFrame(false)
 	{
 		::memset(AreaName, 0, sizeof(AreaName));
 		::memset(DebugText, 0, sizeof(DebugText));
@@ -52,6 +67,8 @@ public:
 
 	virtual void onWindowSizeChanged(const dimension2du& size) = 0;
 
+	virtual void getFramePerf(SFramePerf& perf) const = 0;
+
 	f32 getFPS() const { return FPSCounter.getFPS(); }
 	u32 getTimeSinceLastFrame() const { return Timer->getTimeSinceLastFrame(); }
 
@@ -77,6 +94,7 @@ public:
 	c16		DebugText[MAX_TEXT_LENGTH];
 	bool			ShowDebugBase;
 	bool		CalcPerf;
+	bool		PerfEveryFrame;			//ÿ֡׶κʱ, Ĭÿһ
 
 protected:
 	ICamera*		ActiveCamera;
@@ -85,6 +85,9 @@ public:
 
 	virtual void registerSceneNode(bool frustumcheck,  int sequence);
 	virtual void tick(u32 timeSinceStart, u32 timeSinceLastFrame, bool visible) {}
+	//tick֮ɲеĶ, ͬһGenerationĽڵڶ߳ͬʱִ, ֻ޸ӽڵ
+	virtual bool needAnimate() const { return false; }
+	virtual void animate() {}
 	virtual void render() const = 0;
 	virtual aabbox3df getBoundingBox() const  = 0;
 	const aabbox3df& getWorldBoundingBox() const { return WorldBoundingBox; }
@@ -20,4 +20,9 @@ public:
 
 public:
 	virtual ITexture* getTexture(E_SPECIAL_TEXTURES tex) const = 0;
+
+	//ɫ, keyΪ, Ա͸hash, ֻ߳ʹ
+	//ҵʱgrab
+	virtual ITexture* findComposedTexture(u64 key) = 0;
+	virtual void addComposedTexture(u64 key, ITexture* tex) = 0;
 };
\ No newline at end of file
@@ -199,6 +199,8 @@ inline const c8* getEnumString(E_DRIVER_TYPE type)
 		return "Direct3D11";
 	case EDT_OPENGL:
 		return "OpenGL";
+	case EDT_NULL:
+		return "Null";
 	default:
 		return "Unknown";
 	}
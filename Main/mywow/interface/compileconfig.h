@@ -133,4 +133,24 @@
 
 #endif
 
+//sse2, x86/x64下可用
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+
+	#define MW_USE_SSE
+
+#endif
+
+//ssse3/avx2的代码只在运行时检测到cpu支持后调用, msvc不需要额外的编译选项
+#if defined(MW_USE_SSE) && (defined(_MSC_VER) || defined(__SSSE3__))
+
+	#define MW_USE_SSSE3
+
+#endif
+
+#if defined(MW_USE_SSE) && ((defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__AVX2__))
+
+	#define MW_USE_AVX2
+
+#endif
+
 #endif
\ No newline at end of file
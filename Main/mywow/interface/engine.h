@@ -25,11 +25,14 @@ class IParticleSystemServices;
 class IRibbonEmitterServices;
 class IMeshDecalServices;
 class ITerrainServices;
+class ICollisionServices;
 class IInputReader;
 class IGestureReader;
 class IAudioPlayer;
 class engineSetting;
 class CTimer;
+class CAssetCache;
+class CJobSystem;
 
 class IMessageHandler
 {
@@ -48,6 +51,7 @@ struct SEngineInitParam
 		ignoreSetting = false;
 		useCompress = true;
 		outputFileName = false;
+		useAssetCache = false;
 	}
 
 	c8 baseDir[QMAX_PATH];
@@ -56,6 +60,7 @@ struct SEngineInitParam
 	bool ignoreSetting;
 	bool useCompress;
 	bool outputFileName;
+	bool useAssetCache;		//cache processed m2/wmo data in baseDir/AssetCache
 };
 
 class Engine
@@ -101,11 +106,14 @@ public:
 	IRibbonEmitterServices*		getRibbonEmitterServices() const { return RibbonEmitterServices; }
 	IMeshDecalServices*			getMeshDecalServices() const { return MeshDecalServices; }
 	ITerrainServices*	getTerrainServices() const { return TerrainServices; }
+	ICollisionServices*	getCollisionServices() const { return CollisionServices; }
 	IInputReader*	getInputReader() const { return InputReader; }
 	IGestureReader*		getGestureReader() const { return GestureReader; }
 	IAudioPlayer*   getAudioPlayer() const { return AudioPlayer; }
 	engineSetting*		getEngineSetting() const { return EngineSetting; } 
 	CTimer*		getTimer() const { return Timer; }
+	CAssetCache*		getAssetCache() const { return AssetCache; }
+	CJobSystem*		getJobSystem() const { return JobSystem; }			//в, ߳cpu
 	bool isDXFamily() const { return m_IsDXFamily; }
 
 private:
@@ -133,9 +141,12 @@ private:
 	IRibbonEmitterServices*		RibbonEmitterServices;
 	IMeshDecalServices*			MeshDecalServices;
 	ITerrainServices*		TerrainServices;
+	ICollisionServices*		CollisionServices;
 	IAudioPlayer*		AudioPlayer;
 	engineSetting*		EngineSetting;
 	CTimer*			Timer;
+	CAssetCache*		AssetCache;
+	CJobSystem*		JobSystem;
 	IMessageHandler*		MessageHandler;
 	bool			m_IsDXFamily;	
 };
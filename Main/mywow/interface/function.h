@@ -746,6 +746,43 @@ inline int Q_access(const char * filename, int mode)
 #endif
 }
 
+inline bool Q_getFileSize(const char * filename, u64& size)
+{
+#ifdef MW_PLATFORM_WINDOWS
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &data))
+		return false;
+	size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	return true;
+#else
+	struct stat buf;
+	if (stat(filename, &buf) != 0)
+		return false;
+	size = (u64)buf.st_size;
+	return true;
+#endif
+}
+
+//С޸ʱ, ʱֻڱȽǷ仯, ƽ̨λͬ
+inline bool Q_getFileStat(const char * filename, u64& size, u64& time)
+{
+#ifdef MW_PLATFORM_WINDOWS
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &data))
+		return false;
+	size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	time = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	return true;
+#else
+	struct stat buf;
+	if (stat(filename, &buf) != 0)
+		return false;
+	size = (u64)buf.st_size;
+	time = (u64)buf.st_mtime;
+	return true;
+#endif
+}
+
 inline void Q_getLocalTime(c8* timebuf, size_t size)
 {
 #ifdef MW_PLATFORM_WINDOWS
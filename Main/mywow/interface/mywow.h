@@ -40,6 +40,7 @@
 #include "input.h"
 #include "audio.h"
 #include "ai.h"
+#include "collision.h"
 #include "system.h"
 
 #include "enginesetting.h"
@@ -73,5 +73,6 @@ void* T_Realloc(void* ptr, size_t size, int tag, bool& success);
 
 void QMem_Init(size_t smallZoneM, size_t generalZoneM, size_t tempZoneM);
 void QMem_End(void);
+void QMem_ThreadExit(void);			//߳˳ǰ黹̵߳Ŀ黺temp arena
 
 void QMem_Info( void );
\ No newline at end of file
@@ -104,42 +104,18 @@ private:
 
 inline void* qzone_malloc(size_t size)
 {
-#ifdef MW_PLATFORM_WINDOWS
-	void* p = nullptr;
+	void* p = NULL_PTR;
 	if (size < 512)
-	{
-		if (size <= 4)
-		{
-			BEGIN_LOCK(&g_Globals.allocatorCS);
-			if (Z_AvailableSmallMemory() > 4)
-				p = Z_TagMalloc(size, TAG_SMALL);
-			END_LOCK(&g_Globals.allocatorCS);
-		}
-		else
-		{
-			BEGIN_LOCK(&g_Globals.allocatorCS);
-			if (Z_AvailableMainMemory() > 512)
-				p = Z_TagMalloc(size, TAG_GENERAL);
-			END_LOCK(&g_Globals.allocatorCS);
-		}
-	}
+		p = Z_TagMalloc(size, size <= 4 ? TAG_SMALL : TAG_GENERAL);
 
 	if (p)
 		return p;
 
-#endif
 	return malloc(size);
 }
 
 inline void qzone_free(void* p)
 {
-#ifdef MW_PLATFORM_WINDOWS
-	bool ret;
-	BEGIN_LOCK(&g_Globals.allocatorCS);
-	ret = Z_Free(p);
-	END_LOCK(&g_Globals.allocatorCS);
-
-	if (!ret)
-#endif
+	if (!Z_Free(p))
 		free(p); 
 }
@@ -2,6 +2,7 @@
 
 #include "base.h"
 #include "core.h"
+#include "CSysSync.h"
 #include <vector>
 #include <set>
 #include <unordered_map>
@@ -22,6 +23,10 @@ public:
 
 	bool exists(const c8* filename);
 
+	//ԴļУ, ֻȡ鵵ļϵͳԪ(鵵, λ, С, ʱ), ļ
+	//ԴݴжǷʧЧ, ļʱfalse
+	bool getFileStamp(const c8* filename, u64& stamp);
+
 	const c8* getLocale() const { return Locale.c_str(); }
 	const c8* getLocalePath() const { return LocalePath; }
 	IFileSystem* getFileSystem() const { return FileSystem; }
@@ -42,6 +47,10 @@ public:
 	void getDirectories(const c8* baseDir, std::vector<string_cs256>& dirs, bool useOwn);
 	const char* getFileNameByFileDataId(int filedataId);
 
+	//رպ󰴹鵵˳, ڶԱЧ
+	void setUseFileIndex(bool use) { UseFileIndex = use; }
+	bool isUseFileIndex() const { return UseFileIndex; }
+
 private:
 	bool loadRoot();
 	void unloadRoot();
@@ -50,6 +59,17 @@ private:
 
 	void getCascLocale();
 
+	void buildArchiveStamp();
+
+#ifdef MW_USE_MPQ
+	//listfilempqļ, ļhash -> һļĹ鵵, ûlistfileĹ鵵ÿ̽
+	void buildMpqFileIndex();
+	u32 findMpqIndex(const c8* realfilename) const;
+	MPQArchive* findMpqArchive(const c8* realfilename, bool& alternate, bool& locale, u32& order) const;
+	bool openMpqFile(const c8* realfilename, HANDLE& fh, bool& locale, u32& order);
+	IMemFile* readMpqFile(void* fh, const c8* realfilename, bool tempfile, bool locale);
+#endif
+
 private:	
 #ifdef USE_QALLOCATOR
 	typedef std::map<string_cs256, int, std::less<string_cs256>, qzone_allocator<std::pair<string_cs256, int>>> T_DirIndexMap;
@@ -76,8 +96,27 @@ private:
 	c8		LocalePath[QMAX_PATH];
 	u32		CascLocale;
 	HANDLE	hStorage;
+	u64		ArchiveStamp;			//й鵵()ĴС޸ʱ, cascΪbuild
+
+	lock_type	ArchiveCS;
+
+#ifdef MW_USE_MPQ
+	struct SMpqIndexEntry
+	{
+		u64		hash;			//0Ϊ
+		u32		hash2;			//һhash, ͬΪͬһļ
+		u32		order;			//MpqIndexArchivesеλ, locale鵵ǰ
+	};
+
+	std::vector<SMpqIndexEntry>		MpqFileIndex;		//Ѱַ, СΪ2
+	u32		MpqFileIndexMask;
+	std::vector<MPQArchive*>		MpqIndexArchives;
+	std::vector<u32>		MpqUnlistedArchives;		//ûlistfileĹ鵵MpqIndexArchivesеλ, 
+	u32		NumLocaleIndexArchives;
+#endif
 
 	bool		UseAlternate;
 	bool		UseLocale;
 	bool		UseCompress;
+	bool		UseFileIndex;
 };
@@ -3,6 +3,8 @@
 #include "core.h"
 #include "SColor.h"
 #include "wow_m2_structs.h"
+#include "CLock.h"
+#include <vector>
 
 struct SAnimFile
 {
@@ -83,7 +85,23 @@ public:
 	}
 };
 
+//ԭʼԴ, m2m2ڱ, е.animļIFileM2::releaseUnusedAnimationsʱͷ
+class IAnimSource
+{
+public:
+	virtual ~IAnimSource() {}
+
+	virtual const u8* getM2Data() const = 0;
+	//animе.animļ, ʱsizeΪ0, ڼ߳дʱfalse, ʱgetDecodeLock()
+	virtual bool getAnimFile(u32 anim, SAnimFile& file) = 0;
+	virtual lock_type* getDecodeLock() = 0;
+};
+
+//releaseUnusedAnimationsժµĽ, ܻ߳̿ڶ, һͷʱdelete
+typedef std::vector<u8*>	T_AnimBlockList;
+
 //Ӧһanimation blockanimation blocktrack time&value 
+//IAnimSourceʼʱֻ¼block, ÿڵһgetValueʱ
 template <class T, class D=T, class Conv=Identity<T> >
 class SWowAnimation						
 {
@@ -91,10 +109,11 @@ public:
 	SWowAnimation() 
 		: Animations(NULL_PTR), NumAnimations(0),
 		Type(INTERPOLATION_NONE), Seq(-1), 
-		GlobalSeq(NULL_PTR), NumGlobalSeq(0) { }
+		GlobalSeq(NULL_PTR), NumGlobalSeq(0),
+		Block(NULL_PTR), Source(NULL_PTR) { }
 
 	 void init(const M2::animblock* block, const u8* fileData, s32* globalSeq, u32 numGlobalSeq);
-	 void init(const M2::animblock* block, const u8* m2FileData, SAnimFile* animFiles, s32* globalSeq, u32 numGlobalSeq);
+	 void init(const M2::animblock* block, IAnimSource* source, s32* globalSeq, u32 numGlobalSeq);
 
 	~SWowAnimation()
 	{
@@ -107,29 +126,39 @@ public:
 	 bool		hasAnimation(u32 anim) const { return anim < NumAnimations; }
 	 u32		getGlobalSeq(u32 idx) const;
 
+	 //ժϴε֮ûõ, ݿretiredɵӺͷ
+	 u32		releaseUnusedAnimations(T_AnimBlockList& retired);
+
 	s16		Type;	
 private:
 	struct	SAnimationEntry				//animation
 	{
-		SAnimationEntry() : numKeys(0), times(NULL_PTR), values(NULL_PTR), values1(NULL_PTR), values2(NULL_PTR) { }
+		SAnimationEntry() : numKeys(0), times(NULL_PTR), used(0) { }
 		~SAnimationEntry() 
 		{
-			delete times;
+			delete[] (u8*)times;
 		}
 
+		//valuestimes֮, hermiteʱٸvalues1, values2, ֻӶtimes, ָ
+		const T* getValues(const u32* t, u32 n) const { return (const T*)((const u8*)t + sizeof(u32) * numKeys) + n * numKeys; }
+
 		u32		numKeys;
-		u32*		times;
-		T*		values;
-		T*		values1;					//for hermite interpolation
-		T*		values2;
+		u32* volatile		times;			//ɺд, ͬʱvaluesڴ
+		mutable volatile int		used;
 	};
 
+	void decode(SAnimationEntry& entry, const u32* times, const D* values) const;
+	const u32* decodeAnimation(u32 anim) const;
+
 	u32		NumAnimations;		
 	u32		NumGlobalSeq;		
 	s32		Seq;					//һⲿʱ䳤ȣʱֵʱ䳤
 	SAnimationEntry*		Animations;
 	
 	s32*		GlobalSeq;
+
+	const M2::animblock*		Block;			//Sourcem2
+	IAnimSource*		Source;
 };
 
 template <class T, class D, class Conv>
@@ -140,6 +169,49 @@ u32 SWowAnimation<T, D, Conv>::getGlobalSeq( u32 idx ) const
 	return GlobalSeq[idx];
 }
 
+template <class T, class D, class Conv>
+void SWowAnimation<T,D,Conv>::decode( SAnimationEntry& entry, const u32* times, const D* values ) const
+{
+	u32 num = entry.numKeys;
+
+	switch (Type)
+	{
+	case INTERPOLATION_NONE:
+	case INTERPOLATION_LINEAR:
+		{
+			u32* block = (u32*)new u8[sizeof(u32) * num + sizeof(T) * num];
+			T* v = (T*)((u8*)block + sizeof(u32) * num);
+
+			Q_memcpy(block, sizeof(u32)*num, times, sizeof(u32)*num);
+			for (u32 j=0; j<num; ++j)
+			{
+				v[j] = Conv::conv(values[j]);
+			}
+
+			ATOMIC_STORE_PTR((void* volatile*)&entry.times, block);
+		}
+		break;
+	case INTERPOLATION_HERMITE:
+		{
+			u32* block = (u32*)new u8[sizeof(u32) * num + sizeof(T) * num + sizeof(T) * num + sizeof(T) * num];
+			T* v = (T*)((u8*)block + sizeof(u32) * num);
+
+			Q_memcpy(block, sizeof(u32)*num, times, sizeof(u32)*num);
+			for (u32 j=0; j<num; ++j)
+			{
+				v[j] = Conv::conv(values[j*3]);
+				v[num + j] = Conv::conv(values[j*3+1]);
+				v[num*2 + j] = Conv::conv(values[j*3+2]);
+			}
+
+			ATOMIC_STORE_PTR((void* volatile*)&entry.times, block);
+		}
+		break;
+	default:
+		ASSERT(false);
+	}
+}
+
 //m2ļжȡtime, key, sequence
 template <class T, class D, class Conv>
 void SWowAnimation<T,D,Conv>::init( const M2::animblock* block, const u8* fileData, s32* globalSeq, u32 numGlobalSeq )
@@ -165,59 +237,26 @@ void SWowAnimation<T,D,Conv>::init( const M2::animblock* block, const u8* fileDa
 		if (Animations[i].numKeys == 0)
 			continue;
 
-		u32 num = Animations[i].numKeys;
-
 		M2::sequence* v = (M2::sequence*)(fileData + block->_ValuesOfs +i*sizeof(M2::sequence));
 
 		u32* times = (u32*)(fileData + p->_SequencesOfs);	
 		const D* values = reinterpret_cast<const D*>(fileData + v->_SequencesOfs);
 
-		switch (Type)
-		{
-		case INTERPOLATION_NONE:
-		case INTERPOLATION_LINEAR:
-			{
-				Animations[i].times = (u32*)new u8[sizeof(u32) * num + sizeof(T) * num];
-				Animations[i].values = (T*)((u8*)Animations[i].times + sizeof(u32) * num);
-
-				Q_memcpy(Animations[i].times, sizeof(u32)*num, times, sizeof(u32)*num);
-				for (u32 j=0; j<num; ++j)
-				{
-					Animations[i].values[j] = Conv::conv(values[j]);
-				}
-			}
-			break;
-		case INTERPOLATION_HERMITE:
-			{
-				Animations[i].times = (u32*)new u8[sizeof(u32) * num + sizeof(T) * num + sizeof(T) * num + sizeof(T) * num];
-				Animations[i].values = (T*)((u8*)Animations[i].times + sizeof(u32) * num);
-				Animations[i].values1 = (T*)((u8*)Animations[i].times + sizeof(u32) * num + sizeof(T) * num);
-				Animations[i].values2 = (T*)((u8*)Animations[i].times + sizeof(u32) * num + sizeof(T) * num + sizeof(T) * num);
-
-				Q_memcpy(Animations[i].times, sizeof(u32)*num, times, sizeof(u32)*num);
-				for (u32 j=0; j<num; ++j)
-				{
-					Animations[i].values[j] = Conv::conv(values[j*3]);
-					Animations[i].values1[j] = Conv::conv(values[j*3+1]);
-					Animations[i].values2[j] = Conv::conv(values[j*3+2]);
-				}
-			}
-			break;
-		default:
-			ASSERT(false);
-		}
+		decode(Animations[i], times, values);
 	}
 
 }
 
-//m2ļжȡtime, key, sequence, ҲanimļжȡݣӦanimļڣʹöļ
+//m2ļжȡÿеkey, еһʹʱŴm2animļн룬Ӧanimļڣʹöļ
 template <class T, class D, class Conv>
-void SWowAnimation<T,D,Conv>::init( const M2::animblock* block, const u8* m2FileData, SAnimFile* animFiles, s32* globalSeq, u32 numGlobalSeq )
+void SWowAnimation<T,D,Conv>::init( const M2::animblock* block, IAnimSource* source, s32* globalSeq, u32 numGlobalSeq )
 {
 	Type = block->_Interpolation;
 	Seq = block->_SequenceID;
 	GlobalSeq = globalSeq;
 	NumGlobalSeq = numGlobalSeq;
+	Block = block;
+	Source = source;
 
 	ASSERT(block->_Ntimings == block->_Nvalues);
 
@@ -227,65 +266,72 @@ void SWowAnimation<T,D,Conv>::init( const M2::animblock* block, const u8* m2File
 
 	Animations = new SAnimationEntry[NumAnimations];
 
-	//time
+	const u8* m2FileData = source->getM2Data();
 	for (u32 i=0; i<NumAnimations; ++i)
 	{
 		M2::sequence* p = (M2::sequence*)(m2FileData + block->_TimingsOfs + i*sizeof(M2::sequence));
 		Animations[i].numKeys = p->_NValues;
-		if (Animations[i].numKeys == 0)
-			continue;
+	}
+}
 
-		u32 num = Animations[i].numKeys;
+template <class T, class D, class Conv>
+const u32* SWowAnimation<T,D,Conv>::decodeAnimation( u32 anim ) const
+{
+	CLock lock(Source->getDecodeLock());
+
+	SAnimationEntry& entry = Animations[anim];
+	if (entry.times)							//߳ѽ
+		return entry.times;
+
+	u32 num = entry.numKeys;
+	const u8* m2FileData = Source->getM2Data();
+	SAnimFile animFile;
+	if (!Source->getAnimFile(anim, animFile))			//.animļڼ, β
+		return NULL_PTR;
+
+	M2::sequence* p = (M2::sequence*)(m2FileData + Block->_TimingsOfs + anim*sizeof(M2::sequence));
+	const u32* times;
+	if (animFile.size && (animFile.size >= p->_SequencesOfs + sizeof(u32)*num) )
+		times = (const u32*)(animFile.data + p->_SequencesOfs);
+	else
+		times = (const u32*)(m2FileData + p->_SequencesOfs);
+
+	M2::sequence* v = (M2::sequence*)(m2FileData + Block->_ValuesOfs + anim*sizeof(M2::sequence));
+	const D* values;
+	if (animFile.size && (animFile.size >= (v->_SequencesOfs + sizeof(D)*num)))
+		values = reinterpret_cast<const D*>(animFile.data + v->_SequencesOfs);
+	else
+		values = reinterpret_cast<const D*>(m2FileData + v->_SequencesOfs);	
+
+	decode(entry, times, values);
+	return entry.times;
+}
 
-		u32* times;
-		if (animFiles[i].size && (animFiles[i].size >= p->_SequencesOfs + sizeof(u32)*num) )
-			times = (u32*)(animFiles[i].data + p->_SequencesOfs);
-		else
-			times = (u32*)(m2FileData + p->_SequencesOfs);
+template <class T, class D, class Conv>
+u32 SWowAnimation<T,D,Conv>::releaseUnusedAnimations(T_AnimBlockList& retired)
+{
+	if (!Source)				//ûԴʱ޷½
+		return 0;
 
-		M2::sequence* v = (M2::sequence*)(m2FileData + block->_ValuesOfs + i*sizeof(M2::sequence));
+	//decodeAnimation, ѾõtimesgetValueretiredеĿ
+	CLock lock(Source->getDecodeLock());
 
-		const D* values;
-		if (animFiles[i].size && (animFiles[i].size >= (v->_SequencesOfs + sizeof(D)*num)))
-			values = reinterpret_cast<const D*>(animFiles[i].data + v->_SequencesOfs);
-		else
-			values = reinterpret_cast<const D*>(m2FileData + v->_SequencesOfs);	
+	u32 count = 0;
+	for (u32 i=0; i<NumAnimations; ++i)
+	{
+		SAnimationEntry& entry = Animations[i];
+		if (ATOMIC_COMPARE_EXCHANGE(&entry.used, 0, 1) == 1)
+			continue;
 
-		switch (Type)
+		u32* times = entry.times;
+		if (times)
 		{
-		case INTERPOLATION_NONE:
-		case INTERPOLATION_LINEAR:
-			{
-				Animations[i].times = (u32*)new u8[sizeof(u32) * num + sizeof(T) * num];
-				Animations[i].values = (T*)((u8*)Animations[i].times + sizeof(u32) * num);
-
-				Q_memcpy(Animations[i].times, sizeof(u32)*num, times, sizeof(u32)*num);
-				for (u32 j=0; j<num; ++j)
-				{
-					Animations[i].values[j] = Conv::conv(values[j]);
-				}
-			}
-			break;
-		case INTERPOLATION_HERMITE:
-			{
-				Animations[i].times = (u32*)new u8[sizeof(u32) * num + sizeof(T) * num + sizeof(T) * num + sizeof(T) * num];
-				Animations[i].values = (T*)((u8*)Animations[i].times + sizeof(u32) * num);
-				Animations[i].values1 = (T*)((u8*)Animations[i].times + sizeof(u32) * num + sizeof(T) * num);
-				Animations[i].values2 = (T*)((u8*)Animations[i].times + sizeof(u32) * num + sizeof(T) * num + sizeof(T) * num);
-
-				Q_memcpy(Animations[i].times, sizeof(u32)*num, times, sizeof(u32)*num);
-				for (u32 j=0; j<num; ++j)
-				{
-					Animations[i].values[j] = Conv::conv(values[j*3]);
-					Animations[i].values1[j] = Conv::conv(values[j*3+1]);
-					Animations[i].values2[j] = Conv::conv(values[j*3+2]);
-				}
-			}
-			break;
-		default:
-			ASSERT(false);
+			ATOMIC_STORE_PTR((void* volatile*)&entry.times, NULL_PTR);
+			retired.push_back((u8*)times);
+			++count;
 		}
 	}
+	return count;
 }
 
 template <class T, class D, class Conv>
@@ -295,6 +341,18 @@ s32 SWowAnimation<T,D,Conv>::getValue( u32 anim, u32 time, T& v, s32 hint ) cons
 		return -1;
 
 	const SAnimationEntry& entry = Animations[anim];
+	if (entry.numKeys == 0)
+		return -1;
+
+	const u32* times = (const u32*)ATOMIC_LOAD_PTR((void* const volatile*)&entry.times);
+	if (!times)
+		times = decodeAnimation(anim);
+	if (!times)
+		return -1;
+	if (!ATOMIC_LOAD(&entry.used))			//ѱʱֻ, jobдͬһ
+		ATOMIC_COMPARE_EXCHANGE(&entry.used, 1, 0);
+
+	const T* values = entry.getValues(times, 0);
 
 	s32 pos = -1;
 	if (entry.numKeys > 1)
@@ -308,24 +366,24 @@ s32 SWowAnimation<T,D,Conv>::getValue( u32 anim, u32 time, T& v, s32 hint ) cons
 				time = time % GlobalSeq[Seq];
 		}
 
-		if (time <= entry.times[0])			//СС֡
+		if (time <= times[0])			//СС֡
 		{
- 			v = entry.values[0];
+ 			v = values[0];
  			return 0;
 		}
-		else if (time >= entry.times[entry.numKeys-1])		//֡
+		else if (time >= times[entry.numKeys-1])		//֡
 		{
- 			v = entry.values[entry.numKeys-1];
+ 			v = values[entry.numKeys-1];
  			return (s32)entry.numKeys-1;
 		}
 
 		u32 i = 1;
-		if (hint >1 && time > entry.times[hint-1])					//
+		if (hint >1 && time > times[hint-1])					//
 			i = hint;			
 	
 		for (; i<entry.numKeys; ++i )
 		{
-			if (time <= entry.times[i])
+			if (time <= times[i])
 			{
 				pos = i;
 				break;
@@ -334,20 +392,20 @@ s32 SWowAnimation<T,D,Conv>::getValue( u32 anim, u32 time, T& v, s32 hint ) cons
 		
 		if (pos != -1)
 		{
-			u32 t1 = entry.times[pos];
-			u32 t2 = entry.times[pos-1];
+			u32 t1 = times[pos];
+			u32 t2 = times[pos-1];
 			float r = (time-t2)/(float)(t1-t2);
 
 			switch (Type)
 			{
 			case INTERPOLATION_NONE:
-				v = entry.values[pos-1];
+				v = values[pos-1];
 				break;
 			case INTERPOLATION_LINEAR:
-				v = interpolate<T>(r, entry.values[pos-1], entry.values[pos]);	
+				v = interpolate<T>(r, values[pos-1], values[pos]);	
 				break;
 			case INTERPOLATION_HERMITE:
-				v = interpolateHermite<T>(r, entry.values[pos-1], entry.values[pos], entry.values1[pos-1], entry.values2[pos-1]);
+				v = interpolateHermite<T>(r, values[pos-1], values[pos], entry.getValues(times, 1)[pos-1], entry.getValues(times, 2)[pos-1]);
 				break;
 			default:
 				ASSERT(false);
@@ -357,7 +415,7 @@ s32 SWowAnimation<T,D,Conv>::getValue( u32 anim, u32 time, T& v, s32 hint ) cons
 	}
 	else if (entry.numKeys == 1)
 	{
-		v = entry.values[0];
+		v = values[0];
 		pos = 0;
 	}
 
@@ -248,14 +248,15 @@ public:
 
 	dbc::record getByID(u32 id) const
 	{
-		T_RecordLookup32::const_iterator itr = RecordLookup32.find(id);
-		if ( itr == RecordLookup32.end())
+		s32 i = findRowByID(id);
+		if (i < 0)
 			return record::EMPTY();
 
-		u32 i = itr->second;
-		return getRecord(i);
+		return getRecord((u32)i);
 	}
 
+	s32 findRowByID(u32 id) const;
+
 	u32 getNumRecords() const { return nRecords; }
 	u32 getNumActualRecords() const { return nActualRecords; }
 	u32 getNumFields() const { return nFields; }
@@ -270,14 +271,23 @@ public:
 	//for sparse db2
 	s32 getRecordSparseRow(u32 index) const
 	{
-		T_RecordSparseLookup32::const_iterator itr = RecordSparseLookup32.find(index);
-		if (itr == RecordSparseLookup32.end())
+		if (index >= (u32)SparseRows.size())
 			return -1;
 
-		return (s32)itr->second;
+		return (s32)SparseRows[index];
 	}
 
+	//, ֵֶ -> ¼, ѯʱٱ
+	//๹ʱΪֶεaddIndex, ʱһ
+	void addIndex(u32 field);
+	//ֵֶΪkeyļ¼, rowsָЩк
+	u32 findRows(u32 field, u32 key, const u32*& rows) const;
+
+protected:
+	void buildIDLookup(const u8* ids, u32 stride, u32 count);
+
 protected:
+	IMemFile*	File;			//Ϊʱ¼, ַIDsֱָļ, ٸ
 	u8*		_recordStart;
 	u8*		_stringStart;
 
@@ -289,17 +299,35 @@ protected:
 
 	u32		minorVersion;
 
-#ifdef USE_QALLOCATOR
-	typedef std::map<u32, u32, std::less<u32>, qzone_allocator<std::pair<u32, u32>>> T_RecordLookup32;
-	typedef std::map<u32, u32, std::less<u32>, qzone_allocator<std::pair<u32, u32>>> T_RecordSparseLookup32;
-#else
-	typedef std::unordered_map<u32, u32> T_RecordLookup32;
-	typedef std::unordered_map<u32, u32> T_RecordSparseLookup32;
-#endif
+	//id -> к, idʱֱѰַ, ж
+	struct SIDEntry
+	{
+		u32		id;
+		u32		row;
+
+		bool operator<(const SIDEntry& other) const
+		{
+			if (id != other.id)
+				return id < other.id;
+			return row < other.row;
+		}
+	};
+
+	u32		MinID;
+	std::vector<u32>		DenseIDRows;			//[id - MinID], λΪ-1
+	std::vector<SIDEntry>		SortedIDs;
+
+	struct SSecondaryIndex
+	{
+		u32		field;
+		std::vector<u32>	keys;		//
+		std::vector<u32>	rows;		//keysһһӦ
+	};
+
+	std::vector<SSecondaryIndex>		SecondaryIndices;
 
-	T_RecordLookup32		RecordLookup32;
 protected:		//WDB2
-	T_RecordSparseLookup32			RecordSparseLookup32;
+	std::vector<u32>			SparseRows;
 	bool	IsSparse;
 
 protected:	//WDB5
@@ -709,7 +737,7 @@ public:
 class charSectionsDB : public dbc
 {
 public:
-	charSectionsDB(wowEnvironment* env) : dbc(env, "DBFilesClient\\CharSections.dbc") {}
+	charSectionsDB(wowEnvironment* env) : dbc(env, "DBFilesClient\\CharSections.dbc") { addIndex(Race); }
 	
 #ifdef WOW70
 	static const u32 Race = 2;		// byte
@@ -857,7 +885,7 @@ public:
 class npcModelItemSlotDisplayInfoDB : public dbc
 {
 public:
-	npcModelItemSlotDisplayInfoDB(wowEnvironment* env) : dbc(env, "DBFilesClient\\NpcModelItemSlotDisplayInfo.dbc") {}
+	npcModelItemSlotDisplayInfoDB(wowEnvironment* env) : dbc(env, "DBFilesClient\\NpcModelItemSlotDisplayInfo.dbc") { addIndex(NPCExtraID); }
 
 	static const u32 NPCExtraID = 0;
 	static const u32 ItemDisplayInfoID = 1;
@@ -932,7 +960,7 @@ public:
 class itemDisplayInfoMaterialResDB : public dbc
 {
 public:
-	itemDisplayInfoMaterialResDB(wowEnvironment* env) : dbc(env, "DBFilesClient\\ItemDisplayInfoMaterialRes.dbc") {}
+	itemDisplayInfoMaterialResDB(wowEnvironment* env) : dbc(env, "DBFilesClient\\ItemDisplayInfoMaterialRes.dbc") { addIndex(ItemDisplayInfoID); }
 
 	static const u32 ItemDisplayInfoID = 0;		//uint
 	static const u32 TextureFileDataID = 1;
@@ -1019,7 +1047,7 @@ public:
 class lightDB : public dbc
 {
 public:
-	lightDB(wowEnvironment* env) : dbc(env, "DBFilesClient\\Light.dbc") {}
+	lightDB(wowEnvironment* env) : dbc(env, "DBFilesClient\\Light.dbc") { addIndex(Map); }
 
 	static const u32 Map = 1;			// uint
 	static const u32 PositionX = 2;		// float
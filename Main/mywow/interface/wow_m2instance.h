@@ -9,6 +9,8 @@
 class ITexture;
 class IVertexBuffer;
 class CFileSkin;
+class CM2PoseCache;
+struct SM2Pose;
 
 struct CharTexturePart				//
 {
@@ -22,6 +24,23 @@ struct CharTexturePart				//
 	}
 };
 
+struct SCharComposeState			//ϴϵĽ, װʱֻϱ仯
+{
+	SCharComposeState() : Data(NULL_PTR), Width(0), Height(0)
+	{
+		::memset(RegionHashes, 0, sizeof(RegionHashes));
+	}
+	~SCharComposeState() { delete[] Data; }
+
+	u32*		Data;
+	u32		Width;
+	u32		Height;
+	u64		RegionHashes[NUM_REGIONS];
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(SCharComposeState);
+};
+
 struct CharTexture				//ʹʱڴ
 {
 	explicit CharTexture(bool isHD);
@@ -31,13 +50,18 @@ struct CharTexture				//ʹ
 	bool addItemLayer(const c8* name, s32 region,  u32 gender, s32 layer);
 	bool makeItemTexture(s32 region,  u32 gender, const c8* name, c8* outname);
 
-	ITexture* compose(bool pandarenOrHD);
+	//stateΪʱ
+	ITexture* compose(u32 race, u32 gender, bool pandarenOrHD, SCharComposeState* state);
 
 	static const int MAX_TEX_PART_SIZE = 40;
 
 	CharTexturePart*		TextureParts;
 	u32		TexPartCount;	
 	bool		IsHD;
+
+private:
+	void blendPart(const CharTexturePart* part, const CharRegionCoords& coords, u32* destData, u32 texWidth, const recti& clip);
+	u64 getRegionHash(s32 region) const;
 };
 
 struct SDynGeoset
@@ -56,7 +80,8 @@ struct SDynGeoset
 	{
 		bool		Enable;
 		matrix4*		BoneMats;
-		SBoneMatrixArray*		BoneMatrixArray;
+		SBoneMatrixArray*		BoneMatrixArray;				//ʹù̬ʱָ̬еĵɫ
+		u32		PaletteOffset;				//ڹ̬ɫеƫ
 	};
 
 	LENTRY		Link;
@@ -149,6 +174,8 @@ struct SCharacterInfo
 #ifdef MW_EDITOR
 	c8			BodyTextureFileNames[NUM_REGIONS][QMAX_PATH];
 #endif
+
+	SCharComposeState		ComposeState;			//npc
 };
 
 //m2̬ϵĶ̬ɫϢ
@@ -169,6 +196,17 @@ public:
 	void animateTextures(u32 anim, u32 time);
 	void solidColors();
 
+	//ͬ״̬ʵ̬, ൱animateColors(anim, time), animateBones(anim, time, lastingtime, 1), animateTextures(0, lastingtime)
+	void animateShared(CM2PoseCache* cache, u32 anim, u32 time, u32 lastingtime);
+
+	//LOD, ֻlodmaxLodĹ(E_BONE_LOD)
+	void setBoneLod(u32 maxLod);
+	u32 getBoneLod() const { return BoneLod; }
+
+	//animateBonesʾ̬, interpolateBones(0~1)һʾ̬ɹȥ
+	void setBoneInterpolation(bool enable);
+	void interpolateBones(f32 alpha);
+
 	//clothes
 	void updateEquipments(s32 slot, s32 itemid);
 	s32 getItemSlot(s32 itemid) const;
@@ -211,7 +249,7 @@ public:
 
 	SDynGeoset*	DynGeosets;			
 	CFileSkin*		CurrentSkin;
-	SDynBone*		DynBones;
+	SDynBone*		DynBones;				//ʹù̬ʱֻ
 
 	s8*			UseAttachments;
 	ITexture*		ReplaceTextures[NUM_TEXTURETYPE];				//滻
@@ -238,17 +276,46 @@ private:
 	s32 getSlot(s32 type) const;
 	static int getClothesSlotLayer( int slot )	;
 
-	void calcAttachmentBone(u8 i, u32 anim, u32 time, f32 blend);
-	void calcBone(u8 i, u32 anim, u32 time, f32 blend, bool enableScale, aabbox3df* animatedBox=NULL_PTR);				//i: indexinGlobal
+	bool updateBoneEvalState();
+	void buildBoneEvals();
+	void addBoneEval(u8 i, u8 channel, bool scale, bool box, bool lod);
+	void sampleBone(u32 k, u32 anim, u32 time, f32 blend);
+	void setBoneRest(u32 k);
+	void updateBoneMatrices(bool updateBox);
+	void updateBoneUnits();
 
 	bool isBlinkGeoset(u32 index) const;
 	void getEquipScale(f32& head, f32& shoulder, f32& weapon, f32& waist) const;
 
 	void calcTextureAnim(u32 c, u32 anim, u32 time);
 
+	u32 getPoseStateHash() const;
+	void storePose(SM2Pose* pose) const;
+	void attachPose(SM2Pose* pose);
+	void detachPose();
+
 	bool setMaterialShaders(SMaterial& material, const STexUnit* texUnit, bool billboard);
 
 private:
+	enum E_BONE_CHANNEL
+	{
+		EBC_NONE = 0,
+		EBC_ANIM,				//ǰ
+		EBC_BLINK,				//գ, 0
+		EBC_FIST,				//ȭ
+		EBC_ATTACHMENT,			//ҵ, 0
+		EBC_INHERIT,			//LOD, , øı任
+	};
+
+	//ǰĴ, һηʱchannelЧ
+	struct SBoneEval
+	{
+		u8		bone;
+		u8		channel;
+		bool		scale;
+		bool		box;
+	};
+
 	struct SHint
 	{
 		s32		transHint;
@@ -271,5 +338,23 @@ private:
 	SHint*		BoneHints;
 	SHint*		TextureAnimHints;
 	SColorHint*		ColorHints;
-	bool*		Calcs;
+
+	SBoneEval*		BoneEvals;
+	u32		NumBoneEvals;
+	u8*		BoneChannels;				//ÿchannel, BoneEvalsʱʹ
+	u16*		BoneEvalState;				//BoneEvalsʱĿɼgeoset˳, ҵ״̬
+	u16*		NewBoneEvalState;
+	u32		BoneEvalStateSize;
+	f32*		BoneLocals;				//BoneEvals˳SoA: trans, rot, scale, pivot
+	u32		BoneLocalStride;
+
+	SDynBone*		OwnBones;				//˽·Ĺ, ʹù̬ʱDynBonesָ
+	SM2Pose*		Pose;				//ǰõĹ̬
+	u32		NumPaletteMatrices;
+
+	u32		BoneLod;
+	f32*		LerpFromLocals;				//ֵ(ϴʾ̬)յ(¼̬), BoneLocalsͬSoA
+	f32*		LerpToLocals;
+	bool		BoneInterpolation;
+	bool		LerpReady;
 };
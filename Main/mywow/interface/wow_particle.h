@@ -10,10 +10,9 @@ class IFileM2;
 struct SModelBone;
 class wow_m2instance;
 
+//, ӽڵ㰴洢
 struct Particle
 {
-	LENTRY	Link;			//live particles link
-
 	vector3df		basepos;
 	vector3df		pos;
 	vector3df		speed;
@@ -2,6 +2,7 @@
 
 #include "core.h"
 #include "IFileWDT.h"
+#include "CInstanceBVH.h"
 
 class CMapTileSceneNode;
 class IM2SceneNode;
@@ -35,6 +36,10 @@ private:
 
 	void classifyM2Instance(u32 index, const matrix4& instMat);
 
+	void fillCullParam(ICamera* cam, CInstanceBVH::SCullParam& param) const;
+	void rebuildM2BVH();
+	void rebuildWmoBVH();
+
 	void processResources();
 
 public:
@@ -64,14 +69,12 @@ private:
 	CMapChunk*			CamChunk;
 	
 private:
-	typedef std::list<u32, qzone_allocator<u32> > T_InstanceList;
-
-	struct SChunkM2List
-	{
-		T_InstanceList		m2InstList;
-	};
-
-	//С
-	SChunkM2List		ChunkM2List[16][16];
-
+	//ʵtileƶһβüǰؽ
+	CInstanceBVH		M2BVH;
+	CInstanceBVH		WmoBVH;
+	matrix4		BVHTileMat;
+	bool		M2BVHDirty;
+	bool		WmoBVHDirty;
+
+	std::vector<CInstanceBVH::SCullResult>		CullResults;
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "IFileWDT.h"
 #include <unordered_map>
 #include <map>
+#include <vector>
 
 class CWDTSceneNode;
 class CMapChunk;
@@ -27,18 +28,27 @@ public:
 	void setAdtLoadSize(E_ADT_LOAD size);
 
 	void setCurrentTile(s32 row, s32 col);
-	void startLoadADT(STile* tile);
+	void startLoadADT(STile* tile, f32 distance);
 	bool processADT();
 	bool updateBlocksByCamera();
 	void unloadOutBlocks();
 
 	void updateTileTransform(STile* tile);
 	bool isTileNeeded(STile* tile) const;		//ǷҪصķΧ
+	bool isTileWanted(STile* tile) const;		//ǷҪפ, طΧһȦԤλΧ
 
 	bool isLoading(STile* tile) const;
 	void recalculateTilesNeeded(s32 row, s32 col);
 	u32 getNumBlocks() const;
 
+private:
+	void updateCameraVelocity(const vector3df& camPos);
+	void updateBlocks();
+	void requestTiles();
+	bool processSyncQueue();
+	s32 getLoadRadius() const;
+	f32 getTilePriority(STile* tile) const;
+
 private:
 #ifdef USE_QALLOCATOR
 	typedef std::map<STile*, bool, std::less<STile*>, qzone_allocator<std::pair<STile*, bool>>>		T_TileMap;
@@ -46,6 +56,13 @@ private:
 	typedef std::unordered_map<STile*, bool>		T_TileMap;
 #endif
 
+	struct SSyncEntry
+	{
+		STile*	tile;
+		f32		priority;
+	};
+	typedef std::vector<SSyncEntry>		T_SyncQueue;
+
 private:
 	CWDTSceneNode* WdtSceneNode;
 	CFileWDT*	FileWDT;
@@ -56,14 +73,21 @@ private:
 	CMapChunk*			CamChunk;
 	CMapChunk*			LastCamChunk;
 
+	//ûм߳ʱ֡ͬ
+	T_SyncQueue		SyncQueue;
+
 	s32	Row;			//row
 	s32	Col;				//col;
 
+	//ٶԤtile
+	s32	PredictRow;
+	s32	PredictCol;
+
+	vector3df		LastCamPos;
+	vector3df		CamVelocity;			//ÿ
+	bool		HasLastCamPos;
+
 	vector2di		Coords[25];
 	
-	//flags
-	u32 TileChangeTick;
-	bool TileChanging;
-	
 	E_ADT_LOAD		AdtLoadSize;
 };
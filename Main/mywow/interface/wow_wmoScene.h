@@ -24,8 +24,10 @@ private:
 	//portal
 	s32 getIndoorGroupIndexOfPosition(ICamera* cam, const vector3df& pos);
 	
-	void goThroughPortalFront(u32 index, ICamera* cam, const frustum& f, const rectf& rect, bool onlyIndoor);
-	void goThroughPortalBack(u32 index, ICamera* cam, const frustum& f, const rectf& rect, bool onlyIndoor);
+	bool isOutsideGroupPortals(u32 groupIndex, const vector3df& pos) const;
+
+	//frontΪtrueʱportalfront groupback group, 
+	void goThroughPortal(u32 index, bool front, ICamera* cam, const frustum& f, const rectf& rect, bool onlyIndoor);
 
 	bool clipPortal2D(rectf& rect, const vector2df& vmin, const vector2df& vmax);
 	void makeFrustum(frustum& f, ICamera* cam, f32 left, f32 top, f32 right, f32 z, f32 bottom);
@@ -44,6 +46,21 @@ private:
 		bool operator<(const SGroupVisEntry& other) const { return groupIndex < other.groupIndex; }
 	};
 
+	struct SPortalStackEntry
+	{
+		SPortalStackEntry(u32 index, bool front, const frustum& f, const rectf& rect) : portalIndex(index), front(front), frust(f), rect(rect) {}
+
+		u32	portalIndex;
+		bool	front;
+		frustum	frust;
+		rectf	rect;
+	};
+
+	enum
+	{
+		MAX_INDOOR_CANDIDATES = 16,
+	};
+
 private:
 	CWMOSceneNode*	WmoSceneNode;
 	const CFileWMO*		FileWmo;
@@ -54,7 +71,10 @@ private:
 
 	std::vector<IM2SceneNode*>		DoodadSceneNodes;
 
-	bool*	PortalChecked;
+	std::vector<SPortalStackEntry>		PortalStack;
+
+	u32*	PortalCheckedFrame;			//FrameStampʾ֡ж
+	u32		FrameStamp;
 
 	f32	XOnePixel;
 	f32	YOnePixel;
@@ -6,10 +6,6 @@ SGlobal g_Globals;
 
 void initGlobal()
 {
-	INIT_LOCK(&g_Globals.refCS);
-	INIT_LOCK(&g_Globals.allocatorCS);
-	INIT_LOCK(&g_Globals.tempCS);
-
 // 	INIT_LOCK(&g_Globals.textureCS);
 // 	INIT_LOCK(&g_Globals.hwbufferCS);
 // 	INIT_LOCK(&g_Globals.vaoCS);
@@ -28,10 +24,6 @@ void deleteGlobal()
 // 	DESTROY_LOCK(&g_Globals.vaoCS);
 // 	DESTROY_LOCK(&g_Globals.hwbufferCS);
 // 	DESTROY_LOCK(&g_Globals.textureCS);
-
-	DESTROY_LOCK(&g_Globals.tempCS);
-	DESTROY_LOCK(&g_Globals.allocatorCS);
-	DESTROY_LOCK(&g_Globals.refCS);
 }
 
 void createEngine(const SEngineInitParam& param, const SWindowInfo& wndInfo)
@@ -46,6 +46,17 @@ void CSysUtility::exitProcess( int ret )
 	exit(ret);
 }
 
+u32 CSysUtility::getProcessorCount()
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (u32)count : 1;
+}
+
+u32 CSysUtility::getCPUFeatures()
+{
+	return 0;
+}
+
 SWindowInfo CSysUtility::createWindow( const char* caption, const dimension2du& windowSize, f32 scale, bool fullscreen, bool hide )
 {
 	SWindowInfo windowInfo;
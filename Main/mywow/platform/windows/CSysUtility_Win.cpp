@@ -13,6 +13,7 @@
 #endif
 #include <windows.h>
 #include <WinInet.h>
+#include <intrin.h>
 
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
@@ -201,6 +202,43 @@ void CSysUtility::exitProcess( int ret )
 	::ExitProcess(ret);
 }
 
+u32 CSysUtility::getProcessorCount()
+{
+	SYSTEM_INFO info;
+	::GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (u32)info.dwNumberOfProcessors : 1;
+}
+
+u32 CSysUtility::getCPUFeatures()
+{
+	u32 features = 0;
+
+#if defined(_M_IX86) || defined(_M_X64)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	if (maxLeaf < 1)
+		return 0;
+
+	__cpuid(info, 1);
+	if (info[3] & (1 << 26))
+		features |= ECPU_SSE2;
+	if (info[2] & (1 << 9))
+		features |= ECPU_SSSE3;
+
+	//osxsaveavx, xcr0xmm/ymm״̬ѿ
+	bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+	if (avx && maxLeaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+			features |= ECPU_AVX2;
+	}
+#endif
+
+	return features;
+}
+
 SWindowInfo CSysUtility::createWindow( const char* caption, const dimension2du& windowSize, f32 scale, bool fullscreen, bool hide )
 {
 	if (fullscreen)
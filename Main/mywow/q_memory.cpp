@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "base.h"
 #include "q_memory.h"
+#include "CSysSync.h"
 
 typedef unsigned char 		byte;
 
@@ -9,593 +10,839 @@ typedef unsigned char 		byte;
 
 						ZONE MEMORY ALLOCATION
 
-There is never any space between memblocks, and there will never be two
-contiguous free memblocks.
+small, main, tempzoneһ鰴ҳڴ, ҳϢ, ûͷ,
+ָǷzoneַֻΧ, ڷΧڵɵԼfree
 
-The rover can be left pointing at a non-empty block
+small/main:
+	QMEM_MAX_SMALL_SIZEİsize class, һҳгɵȴĿ
+	ÿ߳ԼĿп黺, ͷŲ; ˻̫ʱ͸class
+	ȫֿб, ֻʱclass
+	ֱӷҳ(ҳ)
 
-The zone calls are pretty much only used for small strings and structures,
-all big things are allocated on the hunk.
+temp:
+	ÿ߳һbump arena(ҳ), 鰴˳, arenaĿΪ0ʱ
+	δͷ; ̻߳arenaʱarenaһͷŵĿ黹
+	Ȱarenaֱӷҳ
+
+߳˳ǰQMem_ThreadExit黹(PlatformThreadFunctionѾ)
+windows̻߳ڶ̬tls(__declspec(thread)xpLoadLibrarydllв),
+vistafls, ûQMem_ThreadExit߳˳ʱϵͳص黹
 ==============================================================================
 */
 
-#define	ZONEID	0x1d4a11
-#define MINFRAGMENT	64
-
-typedef struct zonedebug_s {
-	char *label;
-	char *file;
-	int line;
-	int allocSize;
-} zonedebug_t;
-
-typedef struct memblock_s {
-	int	size;           // including the header and possibly tiny fragments
-	int     tag;            // a tag of 0 is a free block
-	struct memblock_s       *next, *prev;
-	int     id;        		// should be ZONEID
-#ifdef ZONE_DEBUG
-	zonedebug_t d;
-#endif
-} memblock_t;
+#define QMEM_PAGE_SHIFT			16
+#define QMEM_PAGE_SIZE			(1 << QMEM_PAGE_SHIFT)				//64K
+#define QMEM_MAX_SMALL_SIZE		512
+#define QMEM_NUM_SIZE_CLASSES	17
+#define QMEM_CACHE_BATCH		32				//̻߳ȫֿбһνĿ
+#define QMEM_CACHE_MAX			(QMEM_CACHE_BATCH * 2)
+#define QMEM_ARENA_PAGES		4				//temp arena 256K
+#define QMEM_ARENA_SIZE			(QMEM_ARENA_PAGES * QMEM_PAGE_SIZE)
+#define QMEM_ARENA_ALIGN		16
+#define QMEM_INVALID_PAGE		0xffffffff
+
+enum E_ZONE
+{
+	EZ_SMALL = 0,
+	EZ_MAIN,
+	EZ_TEMP,
+
+	EZ_COUNT,
+};
+
+enum E_PAGE_KIND
+{
+	EPK_FREE = 0,
+	EPK_SLAB,				//гsize classĿ
+	EPK_LARGE,				//һηҳ
+	EPK_ARENA,				//temp arena
+};
+
+static const u32 g_SizeClasses[QMEM_NUM_SIZE_CLASSES] =
+{
+	8, 16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512,
+};
+
+static u8	g_SizeClassLookup[QMEM_MAX_SMALL_SIZE / 8 + 1];		//(size+7)/8 -> size class
+
+struct SPageInfo
+{
+	u8		kind;
+	u8		sizeClass;
+	u32		first;				//ҳĵһҳ
+	u32		count;				//һҳЧ, ҳ
+	volatile int	live;		//arenaһҳЧ, δͷŵĿ, ̳߳ʱ+1
+};
+
+struct SFreeBlock
+{
+	SFreeBlock*		next;
+};
+
+struct SFreeList
+{
+	SFreeBlock*		head;
+	u32		count;
+};
+
+//ȫֿб, ̻߳潻ʱñ
+struct SCentralList
+{
+	lock_type	cs;
+	SFreeList*	batches;
+	u32		numBatches;
+	u32		capacity;
+	u32		numBlocks;
+};
+
+struct SMemZone
+{
+	byte*		raw;				//callocصĵַ
+	byte*		base;				//ҳ
+	size_t		size;
+	u32		numPages;
+	u32		usedPages;
+	u32		rover;				//´ҿҳ
+	u32		slabPages[QMEM_NUM_SIZE_CLASSES];
+	SPageInfo*	pages;
+	lock_type	pageCS;
+	SCentralList	central[QMEM_NUM_SIZE_CLASSES];			//temp
+	bool		retired;			//QMem_Endַֻ֮Χ, ͷʱ
+};
+
+struct SThreadCache
+{
+	SFreeList		lists[EZ_TEMP][QMEM_NUM_SIZE_CLASSES];		//small, main
+
+	u32		arenaFirst;
+	u32		arenaTop;
+
+	//ͳֻ߳д, ߳ͷŵĿͷŵ߳
+	s64		bytes[EZ_COUNT];
+	s64		blocks[EZ_COUNT];
+	u32		allocCount[EZ_COUNT];
+	u32		freeCount[EZ_COUNT];
+
+	SThreadCache*	next;
+	bool		inUse;
+};
+
+static SMemZone		g_Zones[EZ_COUNT];
+static bool		g_QMemInit = false;
+
+static lock_type	g_CacheCS;
+static SThreadCache*	g_CacheList = NULL_PTR;			//˳̵߳Ļ߳
+
+#ifdef MW_PLATFORM_WINDOWS
+
+typedef void (WINAPI *QMEM_FLS_CALLBACK)(void* data);
+typedef DWORD (WINAPI *QMEM_FLSALLOC)(QMEM_FLS_CALLBACK callback);
+typedef void* (WINAPI *QMEM_SLOTGETVALUE)(DWORD index);
+typedef BOOL (WINAPI *QMEM_SLOTSETVALUE)(DWORD index, void* value);
+typedef BOOL (WINAPI *QMEM_SLOTFREE)(DWORD index);
+
+static DWORD	g_CacheSlot = TLS_OUT_OF_INDEXES;
+static QMEM_SLOTGETVALUE	g_SlotGetValue = NULL_PTR;
+static QMEM_SLOTSETVALUE	g_SlotSetValue = NULL_PTR;
+static QMEM_SLOTFREE	g_SlotFree = NULL_PTR;
+
+static void Q_ReleaseThreadCache( SThreadCache* cache );
+
+//߳˳ʱϵͳ, dataΪ̲߳Ļ
+static void WINAPI Q_ThreadCacheCallback( void* data )
+{
+	if (g_QMemInit)
+		Q_ReleaseThreadCache((SThreadCache*)data);
+}
+
+static void Q_InitThreadSlot()
+{
+	//Fls*xpû, ʱȡַ
+	HMODULE kernel = GetModuleHandleA("kernel32.dll");
+	QMEM_FLSALLOC flsAlloc = (QMEM_FLSALLOC)GetProcAddress(kernel, "FlsAlloc");
+	if (flsAlloc)
+	{
+		g_CacheSlot = flsAlloc(Q_ThreadCacheCallback);
+		if (g_CacheSlot != TLS_OUT_OF_INDEXES)
+		{
+			g_SlotGetValue = (QMEM_SLOTGETVALUE)GetProcAddress(kernel, "FlsGetValue");
+			g_SlotSetValue = (QMEM_SLOTSETVALUE)GetProcAddress(kernel, "FlsSetValue");
+			g_SlotFree = (QMEM_SLOTFREE)GetProcAddress(kernel, "FlsFree");
+			return;
+		}
+	}
+
+	g_CacheSlot = TlsAlloc();
+	ASSERT(g_CacheSlot != TLS_OUT_OF_INDEXES);
+	g_SlotGetValue = TlsGetValue;
+	g_SlotSetValue = TlsSetValue;
+	g_SlotFree = TlsFree;
+}
+
+static void Q_FreeThreadSlot()
+{
+	if (g_CacheSlot == TLS_OUT_OF_INDEXES)
+		return;
+
+	g_SlotFree(g_CacheSlot);			//flsԻֵ̻߳ص, g_QMemInitΪfalse, صֱӷ
+	g_CacheSlot = TLS_OUT_OF_INDEXES;
+}
+
+static inline SThreadCache* Q_LoadThreadCache()
+{
+	DWORD err = GetLastError();				//TlsGetValueɹʱ, 䲻ӦıߵGetLastError
+	SThreadCache* cache = (SThreadCache*)g_SlotGetValue(g_CacheSlot);
+	SetLastError(err);
+	return cache;
+}
+
+static inline void Q_StoreThreadCache( SThreadCache* cache )
+{
+	g_SlotSetValue(g_CacheSlot, cache);
+}
+
+#else
 
-typedef struct {
-	int		size;			// total bytes malloced, including header
-	int		used;			// total bytes used
-	memblock_t	blocklist;	// start / end cap for linked list
-	memblock_t	*rover;
-} memzone_t;
+static __thread SThreadCache*	t_Cache = NULL_PTR;
 
-// main zone for all "dynamic" memory allocation
-memzone_t*		mainzone;
-// we also have a small zone for small allocations that would only
-// fragment the main zone (think of cvar and cmd strings)
-memzone_t*		smallzone;
+static inline void Q_InitThreadSlot() { t_Cache = NULL_PTR; }
+static inline void Q_FreeThreadSlot() { t_Cache = NULL_PTR; }
+static inline SThreadCache* Q_LoadThreadCache() { return t_Cache; }
+static inline void Q_StoreThreadCache( SThreadCache* cache ) { t_Cache = cache; }
 
-// temp zone for temporary memory allocation
-memzone_t*		tempzone;
+#endif
 
-void Z_CheckHeap( void );
+static const char* const g_ZoneNames[EZ_COUNT] = { "small", "main", "temp" };
 
 /*
 ========================
-Z_CheckHeap
+Thread cache
 ========================
 */
-void Z_CheckHeap( void ) {
-	memblock_t	*block;
-	
-	for (block = mainzone->blocklist.next ; ; block = block->next) {
-		if (block->next == &mainzone->blocklist) {
-			break;			// all blocks have been hit
-		}
-		if ( (byte *)block + block->size != (byte *)block->next) {
-			//Com_Error( ERR_FATAL, "Z_CheckHeap: block size does not touch the next block\n" );
-			ASSERT(false);
-		}
-		if ( block->next->prev != block) {
-			//Com_Error( ERR_FATAL, "Z_CheckHeap: next block doesn't have proper back link\n" );
-			ASSERT(false);
-		}
-		if ( !block->tag && !block->next->tag ) {
-			//Com_Error( ERR_FATAL, "Z_CheckHeap: two consecutive free blocks\n" );
-			ASSERT(false);
-		}
+static SThreadCache* Q_GetThreadCache()
+{
+	SThreadCache* cache = Q_LoadThreadCache();
+	if (cache)
+		return cache;
+
+	BEGIN_LOCK(&g_CacheCS);
+	for (cache = g_CacheList; cache; cache = cache->next)
+	{
+		if (!cache->inUse)
+			break;
 	}
-}
+	if (!cache)
+	{
+		cache = (SThreadCache*)calloc(1, sizeof(SThreadCache));
+		cache->next = g_CacheList;
+		g_CacheList = cache;
+	}
+	cache->inUse = true;
+	cache->arenaFirst = QMEM_INVALID_PAGE;
+	cache->arenaTop = 0;
+	END_LOCK(&g_CacheCS);
 
-static	size_t		s_zoneTotal;
-static	size_t		s_smallZoneTotal;
-static	size_t		s_tempZoneTotal;
+	Q_StoreThreadCache(cache);
+	return cache;
+}
 
 /*
-=================
-QMem_Info
-=================
+========================
+Page runs
+========================
 */
-void QMem_Info( void ) {
-	memblock_t	*block;
-	int			zoneBytes, zoneBlocks;
-	int			smallZoneBytes, smallZoneBlocks;
-
-	zoneBytes = 0;
-	zoneBlocks = 0;
-	for (block = mainzone->blocklist.next ; ; block = block->next) {
-	
-		if ( block->tag ) {
-			zoneBytes += block->size;
-			zoneBlocks++;
-		}
+static bool Q_AllocPages( SMemZone* zone, u32 count, u8 kind, u32& first )
+{
+	bool found = false;
 
-		if (block->next == &mainzone->blocklist) {
-			break;			// all blocks have been hit	
-		}
-		if ( (byte *)block + block->size != (byte *)block->next) {
-			printf ("ERROR: block size does not touch the next block\n");
-		}
-		if ( block->next->prev != block) {
-			printf ("ERROR: next block doesn't have proper back link\n");
-		}
-		if ( !block->tag && !block->next->tag ) {
-			printf ("ERROR: two consecutive free blocks\n");
+	BEGIN_LOCK(&zone->pageCS);
+	if (zone->numPages - zone->usedPages >= count)
+	{
+		//first fit, roverʼһȦ
+		u32 start = zone->rover;
+		for (u32 pass = 0; pass < 2 && !found; ++pass)
+		{
+			u32 begin = pass == 0 ? start : 0;
+			u32 end = pass == 0 ? zone->numPages : start + count;
+			if (end > zone->numPages)
+				end = zone->numPages;
+			u32 run = 0;
+			for (u32 i = begin; i < end; ++i)
+			{
+				if (zone->pages[i].kind != EPK_FREE)
+				{
+					run = 0;
+					continue;
+				}
+				if (++run == count)
+				{
+					first = i + 1 - count;
+					found = true;
+					break;
+				}
+			}
 		}
 	}
 
-	smallZoneBytes = 0;
-	smallZoneBlocks = 0;
-	for (block = smallzone->blocklist.next ; ; block = block->next) {
-		if ( block->tag ) {
-			smallZoneBytes += block->size;
-			smallZoneBlocks++;
+	if (found)
+	{
+		for (u32 i = first; i < first + count; ++i)
+		{
+			SPageInfo& page = zone->pages[i];
+			page.kind = kind;
+			page.sizeClass = 0;
+			page.first = first;
+			page.count = 0;
 		}
+		zone->pages[first].count = count;
+		zone->pages[first].live = 0;
+		zone->usedPages += count;
+		zone->rover = first + count < zone->numPages ? first + count : 0;
+	}
+	END_LOCK(&zone->pageCS);
 
-		if (block->next == &smallzone->blocklist) {
-			break;			// all blocks have been hit	
-		}
+	return found;
+}
+
+static void Q_FreePages( SMemZone* zone, u32 first )
+{
+	BEGIN_LOCK(&zone->pageCS);
+	u32 count = zone->pages[first].count;
+	ASSERT(count && zone->pages[first].first == first);
+	for (u32 i = first; i < first + count; ++i)
+	{
+		zone->pages[i].kind = EPK_FREE;
+		zone->pages[i].count = 0;
 	}
+	zone->usedPages -= count;
+	if (first < zone->rover)
+		zone->rover = first;
+	END_LOCK(&zone->pageCS);
+}
 
-	printf( "%8i bytes in %i zone blocks\n", zoneBytes, zoneBlocks	);
-	printf( "        %8i bytes in dynamic other\n", zoneBytes );
-	printf( "        %8i bytes in small Zone memory\n", smallZoneBytes );
+static inline byte* Q_PageAddress( SMemZone* zone, u32 page )
+{
+	return zone->base + ((size_t)page << QMEM_PAGE_SHIFT);
+}
+
+static SMemZone* Q_FindZone( const void* ptr, E_ZONE& index )
+{
+	for (u32 i = 0; i < EZ_COUNT; ++i)
+	{
+		SMemZone* zone = &g_Zones[i];
+		if ((const byte*)ptr >= zone->base && (const byte*)ptr < zone->base + zone->size)
+		{
+			index = (E_ZONE)i;
+			return zone;
+		}
+	}
+	return NULL_PTR;
 }
 
 /*
 ========================
-Z_ClearZone
+Size class blocks
 ========================
 */
-void Z_ClearZone( memzone_t *zone, size_t size ) {
-	memblock_t	*block;
-	
-	// set the entire zone to one free block
-
-	zone->blocklist.next = zone->blocklist.prev = block =
-		(memblock_t *)( (byte *)zone + sizeof(memzone_t) );
-	zone->blocklist.tag = 1;	// in use block
-	zone->blocklist.id = 0;
-	zone->blocklist.size = 0;
-	zone->rover = block;
-	zone->size = (int)size;
-	zone->used = 0;
-	
-	block->prev = block->next = &zone->blocklist;
-	block->tag = 0;			// free block
-	block->id = ZONEID;
-	block->size = (int)(size - sizeof(memzone_t));
+static void Q_PushCentralLocked( SCentralList& central, SFreeBlock* head, u32 count )
+{
+	if (central.numBatches == central.capacity)
+	{
+		u32 capacity = central.capacity ? central.capacity * 2 : 64;
+		SFreeList* batches = (SFreeList*)realloc(central.batches, capacity * sizeof(SFreeList));
+		if (!batches)
+		{
+			ASSERT(false);
+			return;
+		}
+		central.batches = batches;
+		central.capacity = capacity;
+	}
+
+	SFreeList& batch = central.batches[central.numBatches++];
+	batch.head = head;
+	batch.count = count;
+	central.numBlocks += count;
 }
 
-/*
-=================
-Com_InitZoneMemory
-=================
-*/
-void Com_InitSmallZoneMemory( size_t cv ) {
-	if (cv < 1)
-		cv = 1;
+static void Q_PushCentral( SMemZone* zone, u32 sizeClass, SFreeBlock* head, u32 count )
+{
+	SCentralList& central = zone->central[sizeClass];
+	BEGIN_LOCK(&central.cs);
+	Q_PushCentralLocked(central, head, count);
+	END_LOCK(&central.cs);
+}
 
-	s_smallZoneTotal = 1024 * 1024 * cv;
+//̻߳Ϊʱ
+static bool Q_RefillCache( SMemZone* zone, u32 sizeClass, SFreeList& list )
+{
+	SCentralList& central = zone->central[sizeClass];
+	bool found = false;
+	BEGIN_LOCK(&central.cs);
+	if (central.numBatches)
+	{
+		list = central.batches[--central.numBatches];
+		central.numBlocks -= list.count;
+		found = true;
+	}
+	END_LOCK(&central.cs);
 
-	// bk001205 - was malloc
-	smallzone = (memzone_t *)calloc( s_smallZoneTotal, 1 );
-	if ( !smallzone ) {
-		/*Com_Error( ERR_FATAL, "Small zone data failed to allocate %1.1f megs", (float)s_smallZoneTotal / (1024*1024) );*/
-		ASSERT(false);
+	if (found)
+		return true;
+
+	//һҳ, һ̻߳, ఴŵȫֿб
+	u32 first;
+	if (!Q_AllocPages(zone, 1, EPK_SLAB, first))
+		return false;
+
+	BEGIN_LOCK(&zone->pageCS);
+	zone->pages[first].sizeClass = (u8)sizeClass;
+	++zone->slabPages[sizeClass];
+	END_LOCK(&zone->pageCS);
+
+	u32 blockSize = g_SizeClasses[sizeClass];
+	u32 numBlocks = QMEM_PAGE_SIZE / blockSize;
+	byte* p = Q_PageAddress(zone, first);
+
+	BEGIN_LOCK(&central.cs);
+	for (u32 start = 0; start < numBlocks; start += QMEM_CACHE_BATCH)
+	{
+		u32 count = numBlocks - start < QMEM_CACHE_BATCH ? numBlocks - start : QMEM_CACHE_BATCH;
+		SFreeBlock* head = NULL_PTR;
+		for (u32 i = start + count; i > start; --i)
+		{
+			SFreeBlock* block = (SFreeBlock*)(p + (i - 1) * blockSize);
+			block->next = head;
+			head = block;
+		}
+
+		if (start == 0)
+		{
+			list.head = head;
+			list.count = count;
+		}
+		else
+		{
+			Q_PushCentralLocked(central, head, count);
+		}
 	}
-	Z_ClearZone( smallzone, s_smallZoneTotal );
-	
-	return;
+	END_LOCK(&central.cs);
+
+	return true;
 }
 
-void Com_InitMainZoneMemory( size_t cv ) {
-	if (cv < 1)
-		cv = 1;
-	// allocate the random block zone
-	s_zoneTotal = cv * 1024 * 1024;
+static void* Q_AllocSmall( SMemZone* zone, E_ZONE index, size_t size )
+{
+	u32 sizeClass = g_SizeClassLookup[(size + 7) >> 3];
+	SThreadCache* cache = Q_GetThreadCache();
+	SFreeList& list = cache->lists[index][sizeClass];
 
-	// bk001205 - was malloc
-	mainzone = (memzone_t *)calloc( s_zoneTotal, 1 );
-	if ( !mainzone ) {
-		/*Com_Error( ERR_FATAL, "Zone data failed to allocate %i megs", s_zoneTotal / (1024*1024) );*/
-		ASSERT(false);
-	}
-	Z_ClearZone( mainzone, s_zoneTotal );
+	if (!list.head && !Q_RefillCache(zone, sizeClass, list))
+		return NULL_PTR;
+
+	SFreeBlock* block = list.head;
+	list.head = block->next;
+	--list.count;
+
+	cache->bytes[index] += g_SizeClasses[sizeClass];
+	++cache->blocks[index];
+	++cache->allocCount[index];
+	return block;
 }
 
-void Com_InitTempZoneMemory( size_t cv ){
-	if (cv < 1)
-		cv = 1;
+static void Q_FreeSmall( SMemZone* zone, E_ZONE index, u32 sizeClass, void* ptr )
+{
+	SThreadCache* cache = Q_GetThreadCache();
+	SFreeList& list = cache->lists[index][sizeClass];
 
-	// allocate the random block zone
-	s_tempZoneTotal = cv * 1024 * 1024;
+#ifdef ZONE_DEBUG
+	memset(ptr, 0xcc, g_SizeClasses[sizeClass]);
+#endif
 
-	// bk001205 - was malloc
-	tempzone = (memzone_t *)calloc( s_tempZoneTotal, 1 );
-	if ( !tempzone ) {
-		/*Com_Error( ERR_FATAL, "Zone data failed to allocate %i megs", s_zoneTotal / (1024*1024) );*/
-		ASSERT(false);
+	SFreeBlock* block = (SFreeBlock*)ptr;
+	block->next = list.head;
+	list.head = block;
+	++list.count;
+
+	cache->bytes[index] -= g_SizeClasses[sizeClass];
+	--cache->blocks[index];
+	++cache->freeCount[index];
+
+	if (list.count > QMEM_CACHE_MAX)
+	{
+		//ͷŵһcache, ȫֿб
+		SFreeBlock* tail = list.head;
+		for (u32 i = 1; i < QMEM_CACHE_BATCH; ++i)
+			tail = tail->next;
+
+		SFreeBlock* head = list.head;
+		list.head = tail->next;
+		list.count -= QMEM_CACHE_BATCH;
+		tail->next = NULL_PTR;
+		Q_PushCentral(zone, sizeClass, head, QMEM_CACHE_BATCH);
 	}
-	Z_ClearZone( tempzone, s_tempZoneTotal );
 }
 
 /*
-=================
-Com_ReleaseZoneMemory
-=================
+========================
+Large blocks
+========================
 */
-void Com_ReleaseSmallZoneMemory( void )
+static void* Q_AllocLarge( SMemZone* zone, E_ZONE index, size_t size )
 {
-	free(smallzone);
-}
- 
-void Com_ReleaseMainZoneMemory( void )
-{
-	free(mainzone);
+	u32 count = (u32)((size + QMEM_PAGE_SIZE - 1) >> QMEM_PAGE_SHIFT);
+	u32 first;
+	if (!Q_AllocPages(zone, count, EPK_LARGE, first))
+		return NULL_PTR;
+
+	SThreadCache* cache = Q_GetThreadCache();
+	cache->bytes[index] += (s64)count << QMEM_PAGE_SHIFT;
+	++cache->blocks[index];
+	++cache->allocCount[index];
+	return Q_PageAddress(zone, first);
 }
 
-void Com_ReleaseTempZoneMemory( void )
+static void Q_FreeLarge( SMemZone* zone, E_ZONE index, u32 first )
 {
-	free(tempzone);
+	SThreadCache* cache = Q_GetThreadCache();
+	cache->bytes[index] -= (s64)zone->pages[first].count << QMEM_PAGE_SHIFT;
+	--cache->blocks[index];
+	++cache->freeCount[index];
+
+#ifdef ZONE_DEBUG
+	memset(Q_PageAddress(zone, first), 0xcc, (size_t)zone->pages[first].count << QMEM_PAGE_SHIFT);
+#endif
+
+	Q_FreePages(zone, first);
 }
 
 /*
-================
-Z_TagMalloc
-================
+========================
+Temp arena
+========================
 */
-#ifdef ZONE_DEBUG
-void *Z_TagMallocDebug( size_t size, int tag, char *label, char *file, int line ) {
-#else
-void *Z_TagMalloc( size_t size, int tag ) {
-#endif
-	size_t		extra, allocSize;
-	memblock_t	*start, *rover, *newblock, *base;
-	memzone_t *zone;
+struct SArenaHeader
+{
+	u32		size;				//ĴС
+	u32		padded;				//ͬͷռõĴС
+	u32		reserved[2];
+};
 
-	if (!tag) {
-		ASSERT(false);//Com_Error( ERR_FATAL, "Z_TagMalloc: tried to use a 0 tag" );
-	}
+static void Q_ReleaseArena( SMemZone* zone, SThreadCache* cache )
+{
+	u32 first = cache->arenaFirst;
+	cache->arenaFirst = QMEM_INVALID_PAGE;
+	cache->arenaTop = 0;
 
-	if ( tag == TAG_SMALL ) {
-		zone = smallzone;
-	}
-	else if ( tag == TAG_TEMP ){
-		zone = tempzone;
-	}
-	else {
-		zone = mainzone;
+	if (ATOMIC_DECREMENT(&zone->pages[first].live) == 0)
+		Q_FreePages(zone, first);
+}
+
+static void* Q_AllocTemp( size_t size )
+{
+	SMemZone* zone = &g_Zones[EZ_TEMP];
+	size_t padded = ((size + QMEM_ARENA_ALIGN - 1) & ~(size_t)(QMEM_ARENA_ALIGN - 1)) + sizeof(SArenaHeader);
+
+	if (padded > QMEM_ARENA_SIZE / 2)
+		return Q_AllocLarge(zone, EZ_TEMP, size);
+
+	SThreadCache* cache = Q_GetThreadCache();
+	if (cache->arenaFirst != QMEM_INVALID_PAGE)
+	{
+		//ֻʣԼеļ, 鶼ͷ, ͷʼ
+		if (ATOMIC_LOAD(&zone->pages[cache->arenaFirst].live) == 1)
+			cache->arenaTop = 0;
+
+		if (cache->arenaTop + padded > QMEM_ARENA_SIZE)
+			Q_ReleaseArena(zone, cache);
 	}
 
-	allocSize = size;
-
-	//
-	// scan through the block list looking for the first free block
-	// of sufficient size
-	//
-	size += sizeof(memblock_t);	// account for size of block header
-	size += 4;					// space for memory trash tester
-	size = (size + 3) & ~3;		// align to 32 bit boundary
-	
-	base = rover = zone->rover;
-	start = base->prev;
-	
-	do {
-		if (rover == start)	{
-			// scaned all the way around the list
-// 			Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
-// 								size, zone == smallzone ? "small" : "main");
-//			ASSERT(false);
+	if (cache->arenaFirst == QMEM_INVALID_PAGE)
+	{
+		u32 first;
+		if (!Q_AllocPages(zone, QMEM_ARENA_PAGES, EPK_ARENA, first))
 			return NULL_PTR;
-		}
-		if (rover->tag) {
-			base = rover = rover->next;
-		} else {
-			rover = rover->next;
-		}
-	} while (base->tag || base->size < (int)size);
-	
-	//
-	// found a block big enough
-	//
-	extra = base->size - size;
-	if (extra > MINFRAGMENT) {
-		// there will be a free fragment after the allocated block
-		newblock = (memblock_t *) ((byte *)base + size );
-		newblock->size = (int)extra;
-		newblock->tag = 0;			// free block
-		newblock->prev = base;
-		newblock->id = ZONEID;
-		newblock->next = base->next;
-		newblock->next->prev = newblock;
-		base->next = newblock;
-		base->size = (int)size;
+
+		zone->pages[first].live = 1;
+		cache->arenaFirst = first;
+		cache->arenaTop = 0;
 	}
-	
-	base->tag = tag;			// no longer a free block
-	
-	zone->rover = base->next;	// next allocation will start looking here
-	zone->used += base->size;	//
-	
-	base->id = ZONEID;
 
-#ifdef ZONE_DEBUG
-	base->d.label = label;
-	base->d.file = file;
-	base->d.line = line;
-	base->d.allocSize = (u32)allocSize;
-#endif
+	SArenaHeader* header = (SArenaHeader*)(Q_PageAddress(zone, cache->arenaFirst) + cache->arenaTop);
+	header->size = (u32)size;
+	header->padded = (u32)padded;
+	cache->arenaTop += (u32)padded;
+	ATOMIC_INCREMENT(&zone->pages[cache->arenaFirst].live);
 
-	// marker for memory trash testing
-	*(int *)((byte *)base + base->size - 4) = ZONEID;
+	cache->bytes[EZ_TEMP] += padded;
+	++cache->blocks[EZ_TEMP];
+	++cache->allocCount[EZ_TEMP];
+	return header + 1;
+}
 
-	return (void *) ((byte *)base + sizeof(memblock_t));
+static void Q_FreeTemp( SMemZone* zone, u32 first, void* ptr )
+{
+	SArenaHeader* header = (SArenaHeader*)ptr - 1;
+	SThreadCache* cache = Q_GetThreadCache();
+
+	cache->bytes[EZ_TEMP] -= header->padded;
+	--cache->blocks[EZ_TEMP];
+	++cache->freeCount[EZ_TEMP];
+
+	//ԼarenaĿ, ջ
+	if (cache->arenaFirst == first &&
+		(byte*)header + header->padded == Q_PageAddress(zone, first) + cache->arenaTop)
+	{
+		cache->arenaTop -= header->padded;
+	}
+
+#ifdef TEMP_DEBUG
+	memset(ptr, 0xcc, header->size);
+#endif
+
+	if (ATOMIC_DECREMENT(&zone->pages[first].live) == 0)
+		Q_FreePages(zone, first);
 }
 
 /*
 ========================
-Z_Free
+Common
 ========================
 */
-bool Z_Free( void *ptr ) {
-	memblock_t	*block, *other;
-	memzone_t *zone;
-	
-	if (!ptr) {
-		//Com_Error( ERR_DROP, "Z_Free: NULL_PTR pointer" );
-		ASSERT(false);
-		return true;
-	}
+static void* Q_Malloc( size_t size, int tag )
+{
+	if (!g_QMemInit)
+		return NULL_PTR;
 
-	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-	if (block->id != ZONEID) {
-		//Com_Error( ERR_FATAL, "Z_Free: freed a pointer without ZONEID" );
-		//ASSERT(false);
-		return false;
-	}
-	if (block->tag == 0) {
-		//Com_Error( ERR_FATAL, "Z_Free: freed a freed pointer" );
-		ASSERT(false);
-	}
+	if (tag == TAG_TEMP)
+		return Q_AllocTemp(size);
 
-	// check the memory trash tester
-	if (  *(int *)((byte *)block + block->size - 4 ) != ZONEID ) {
-		//Com_Error( ERR_FATAL, "Z_Free: memory block wrote past end" );
-		ASSERT(false);
-	}
+	E_ZONE index = tag == TAG_SMALL ? EZ_SMALL : EZ_MAIN;
+	SMemZone* zone = &g_Zones[index];
 
-	if (block->tag == TAG_SMALL) {
-		zone = smallzone;
-	} 
-	else if (block->tag == TAG_TEMP){
-		zone = tempzone;
-	}
-	else {
-		zone = mainzone;
-	}
+	if (size == 0)
+		size = 1;
 
-	zone->used -= block->size;
-	// set the block to something that should cause problems
-	// if it is referenced...
-	memset( ptr, 0xcc, block->size - sizeof( *block ) );
-
-	block->tag = 0;		// mark as free
-	
-	other = block->prev;
-	if (!other->tag) {
-		// merge with previous free block
-		other->size += block->size;
-		other->next = block->next;
-		other->next->prev = other;
-		if (block == zone->rover) {
-			zone->rover = other;
-		}
-		block = other;
-	}
+	if (size <= QMEM_MAX_SMALL_SIZE)
+		return Q_AllocSmall(zone, index, size);
 
-	zone->rover = block;
+	return Q_AllocLarge(zone, index, size);
+}
 
-	other = block->next;
-	if ( !other->tag ) {
-		// merge the next free block onto the end
-		block->size += other->size;
-		block->next = other->next;
-		block->next->prev = block;
-		if (other == zone->rover) {
-			zone->rover = block;
-		}
-	}
+static bool Q_Free( void* ptr )
+{
+	E_ZONE index;
+	SMemZone* zone = Q_FindZone(ptr, index);
+	if (!zone)
+		return false;
+
+	if (zone->retired)
+		return true;
 
+	u32 pageIndex = (u32)(((byte*)ptr - zone->base) >> QMEM_PAGE_SHIFT);
+	const SPageInfo& page = zone->pages[pageIndex];
+	switch (page.kind)
+	{
+	case EPK_SLAB:
+		Q_FreeSmall(zone, index, page.sizeClass, ptr);
+		break;
+	case EPK_LARGE:
+		ASSERT(Q_PageAddress(zone, page.first) == ptr);
+		Q_FreeLarge(zone, index, page.first);
+		break;
+	case EPK_ARENA:
+		Q_FreeTemp(zone, page.first, ptr);
+		break;
+	default:
+		//freed a freed pointer
+		ASSERT(false);
+		break;
+	}
 	return true;
 }
 
-/*
-========================
-Z_Realloc
-========================
-*/
-void* Z_Realloc( void* ptr, size_t size, int tag, bool& success )
+//ôС, ptrzone
+static size_t Q_UsableSize( SMemZone* zone, void* ptr )
+{
+	u32 pageIndex = (u32)(((byte*)ptr - zone->base) >> QMEM_PAGE_SHIFT);
+	const SPageInfo& page = zone->pages[pageIndex];
+	switch (page.kind)
+	{
+	case EPK_SLAB:
+		return g_SizeClasses[page.sizeClass];
+	case EPK_LARGE:
+		return (size_t)zone->pages[page.first].count << QMEM_PAGE_SHIFT;
+	case EPK_ARENA:
+		return ((SArenaHeader*)ptr - 1)->size;
+	default:
+		return 0;
+	}
+}
+
+static void* Q_Realloc( void* ptr, size_t size, int tag, bool& success )
 {
 	success = true;
 
-	if (!size && ptr)
+	if (!ptr)
 	{
-		Z_Free(ptr);
-		return NULL_PTR;
+		void* p = Q_Malloc(size, tag);
+		success = p != NULL_PTR;
+		return p;
 	}
 
-	if (!ptr)
-		return Z_TagMalloc(size, tag);
+	if (!size)
+	{
+		success = Q_Free(ptr);
+		return NULL_PTR;
+	}
 
-	memblock_t* base = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-	if (base->tag == 0) {
-		ASSERT(false);
+	E_ZONE index;
+	SMemZone* zone = Q_FindZone(ptr, index);
+	if (!zone || zone->retired)
+	{
 		success = false;
 		return NULL_PTR;
 	}
 
-	// check the memory trash tester
-	if (  *(int *)((byte *)base + base->size - 4 ) != ZONEID ) {
+	size_t oldsize = Q_UsableSize(zone, ptr);
+	if (!oldsize)
+	{
 		ASSERT(false);
 		success = false;
 		return NULL_PTR;
 	}
 
-	int newsize = (int)size;
-	newsize += sizeof(memblock_t);	// account for size of block header
-	newsize += 4;					// space for memory trash tester
-	newsize = (newsize + 3) & ~3;
+	if (size <= oldsize && size * 2 > oldsize)			//big enough, return memory block unchanged
+		return ptr;
 
-	if (newsize < base->size)			//big enough, return memory block unchanged
+	//temp arenaջĿֱԭչ
+	if (index == EZ_TEMP && oldsize < size)
 	{
-		int extra = base->size - newsize;
-		if (extra > MINFRAGMENT) {
-			// there will be a free fragment after the allocated block
-			memblock_t* newblock = (memblock_t *) ((byte *)base + newsize );
-			newblock->size = extra;
-			newblock->tag = 0;			// free block
-			newblock->prev = base;
-			newblock->id = ZONEID;
-			newblock->next = base->next;
-			newblock->next->prev = newblock;
-			base->next = newblock;
-			base->size = newsize;
-
-			*(int *)((byte *)base + base->size - 4) = ZONEID;
+		u32 first = zone->pages[((byte*)ptr - zone->base) >> QMEM_PAGE_SHIFT].first;
+		SArenaHeader* header = (SArenaHeader*)ptr - 1;
+		SThreadCache* cache = Q_GetThreadCache();
+		size_t padded = ((size + QMEM_ARENA_ALIGN - 1) & ~(size_t)(QMEM_ARENA_ALIGN - 1)) + sizeof(SArenaHeader);
+		u32 offset = (u32)((byte*)header - Q_PageAddress(zone, first));
+		if (zone->pages[first].kind == EPK_ARENA && cache->arenaFirst == first &&
+			offset + header->padded == cache->arenaTop && offset + padded <= QMEM_ARENA_SIZE)
+		{
+			cache->bytes[EZ_TEMP] += (s64)padded - header->padded;
+			cache->arenaTop = offset + (u32)padded;
+			header->size = (u32)size;
+			header->padded = (u32)padded;
+			return ptr;
 		}
-		return ptr;
 	}
 
-	//alloc new memory
-	void* newptr = Z_TagMalloc(size, tag);
+	void* newptr = Q_Malloc(size, tag);
+	if (!newptr)
+		newptr = malloc(size);
 	if (!newptr)
 		return NULL_PTR;
 
-	if (newptr != ptr)
-	{
-		memcpy(newptr, ptr, size);
-		Z_Free(ptr);
+	memcpy(newptr, ptr, oldsize < size ? oldsize : size);
+	Q_Free(ptr);
+	return newptr;
+}
+
+/*
+========================
+Z_Malloc
+========================
+*/
+#ifdef ZONE_DEBUG
+void *Z_TagMallocDebug( size_t size, int tag, char *label, char *file, int line ) {
+#else
+void *Z_TagMalloc( size_t size, int tag ) {
+#endif
+	if (!tag) {
+		//Com_Error( ERR_FATAL, "Z_TagMalloc: tried to use a 0 tag" );
+		ASSERT(false);
+		return NULL_PTR;
 	}
 
-	return newptr;
+	//zoneʱNULL_PTR, ɵmalloc
+	return Q_Malloc(size, tag);
 }
 
 /*
 ========================
-Z_AvailableZoneMemory
+Z_Free
 ========================
 */
-size_t Z_AvailableZoneMemory( memzone_t *zone ) {
-	return zone->size - zone->used;
+bool Z_Free( void *ptr ) {
+	if (!ptr) {
+		//Com_Error( ERR_DROP, "Z_Free: NULL_PTR pointer" );
+		ASSERT(false);
+		return true;
+	}
+
+	return Q_Free(ptr);
 }
 
 /*
 ========================
-Z_AvailableMemory
+Z_Realloc
 ========================
 */
+void* Z_Realloc( void* ptr, size_t size, int tag, bool& success )
+{
+	return Q_Realloc(ptr, size, tag, success);
+}
+
+/*
+========================
+Z_Available
+========================
+*/
+static size_t Z_AvailableZoneMemory( E_ZONE index ) {
+	SMemZone* zone = &g_Zones[index];
+	if (!g_QMemInit)
+		return 0;
+	return (size_t)(zone->numPages - zone->usedPages) << QMEM_PAGE_SHIFT;
+}
+
+static float Z_AvailableZoneMemoryPercent( E_ZONE index ) {
+	SMemZone* zone = &g_Zones[index];
+	if (!g_QMemInit || !zone->numPages)
+		return 0.0f;
+	return (zone->numPages - zone->usedPages) / (float)zone->numPages;
+}
+
 size_t Z_AvailableMainMemory( void ) {
-	return Z_AvailableZoneMemory( mainzone );
+	return Z_AvailableZoneMemory(EZ_MAIN);
 }
 
 size_t Z_AvailableSmallMemory( void ){
-	return Z_AvailableZoneMemory( smallzone );
+	return Z_AvailableZoneMemory(EZ_SMALL);
 }
 
 size_t Z_AvailableTempMemory( void ){
-	return Z_AvailableZoneMemory( tempzone );
+	return Z_AvailableZoneMemory(EZ_TEMP);
 }
 
 float Z_AvailableMainMemoryPercent(){
-	return (mainzone->size - mainzone->used) / (float)mainzone->size;
+	return Z_AvailableZoneMemoryPercent(EZ_MAIN);
 }
 float Z_AvailableSmallMemoryPercent(){
-	return (smallzone->size - smallzone->used) / (float)smallzone->size;
+	return Z_AvailableZoneMemoryPercent(EZ_SMALL);
 }
 float Z_AvailableTempMemoryPercent(){
-	return (tempzone->size - tempzone->used) / (float)tempzone->size;
+	return Z_AvailableZoneMemoryPercent(EZ_TEMP);
 }
 
-
 /*
-================
-T_TagMalloc
-================
+========================
+T_Malloc
+========================
 */
 #ifdef TEMP_DEBUG
 void *T_TagMallocDebug( size_t size, int tag, char *label, char *file, int line ) {
 #else
 void *T_TagMalloc( size_t size, int tag ) {
 #endif
-    
-	size_t		extra, allocSize;
-	memblock_t	*start, *rover, *newblock, *base;
-	memzone_t *zone = tempzone;
-
-	if (!tag) {
-		ASSERT(false);//Com_Error( ERR_FATAL, "Z_TagMalloc: tried to use a 0 tag" );
-	}
-
-	allocSize = size;
-	//
-	// scan through the block list looking for the first free block
-	// of sufficient size
-	//
-	size += sizeof(memblock_t);	// account for size of block header
-	size += 4;					// space for memory trash tester
-	size = (size + 3) & ~3;		// align to 32 bit boundary
-	
-	base = rover = zone->rover;
-	start = base->prev;
-	
-	do {
-		if (rover == start)	{
-			// scaned all the way around the list
-// 			Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
-// 								size, zone == smallzone ? "small" : "main");
-			ASSERT(false);
-			return NULL_PTR;
-		}
-		if (rover->tag) {
-			base = rover = rover->next;
-		} else {
-			rover = rover->next;
-		}
-	} while (base->tag || base->size < (int)size);
-	
-	//
-	// found a block big enough
-	//
-	extra = base->size - size;
-	if (extra > MINFRAGMENT) {
-		// there will be a free fragment after the allocated block
-		newblock = (memblock_t *) ((byte *)base + size );
-		newblock->size = (int)extra;
-		newblock->tag = 0;			// free block
-		newblock->prev = base;
-		newblock->id = ZONEID;
-		newblock->next = base->next;
-		newblock->next->prev = newblock;
-		base->next = newblock;
-		base->size = (int)size;
-	}
-	
-	base->tag = tag;			// no longer a free block
-	
-	zone->rover = base->next;	// next allocation will start looking here
-	zone->used += base->size;	//
-	
-	base->id = ZONEID;
-
-#ifdef ZONE_DEBUG
-	base->d.label = label;
-	base->d.file = file;
-	base->d.line = line;
-	base->d.allocSize = (int)allocSize;
-#endif
-
-	// marker for memory trash testing
-	*(int *)((byte *)base + base->size - 4) = ZONEID;
-
-	return (void *) ((byte *)base + sizeof(memblock_t));
+	ASSERT(tag == TAG_TEMP);
+	return Q_Malloc(size, TAG_TEMP);
 }
 
 /*
@@ -604,65 +851,13 @@ T_Free
 ========================
 */
 bool T_Free( void* ptr ) {
-	memblock_t	*block, *other;
-	memzone_t *zone = tempzone;
-	
 	if (!ptr) {
 		//Com_Error( ERR_DROP, "Z_Free: NULL_PTR pointer" );
 		ASSERT(false);
 		return true;
 	}
 
-	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-	if (block->id != ZONEID) {
-		//Com_Error( ERR_FATAL, "Z_Free: freed a pointer without ZONEID" );
-		//ASSERT(false);
-		return false;
-	}
-	if (block->tag == 0) {
-		//Com_Error( ERR_FATAL, "Z_Free: freed a freed pointer" );
-		ASSERT(false);
-	}
-
-	// check the memory trash tester
-	if (  *(int *)((byte *)block + block->size - 4 ) != ZONEID ) {
-		//Com_Error( ERR_FATAL, "Z_Free: memory block wrote past end" );
-		ASSERT(false);
-	}
-
-	zone->used -= block->size;
-	// set the block to something that should cause problems
-	// if it is referenced...
-	memset( ptr, 0xcc, block->size - sizeof( *block ) );
-
-	block->tag = 0;		// mark as free
-	
-	other = block->prev;
-	if (!other->tag) {
-		// merge with previous free block
-		other->size += block->size;
-		other->next = block->next;
-		other->next->prev = other;
-		if (block == zone->rover) {
-			zone->rover = other;
-		}
-		block = other;
-	}
-
-	zone->rover = block;
-
-	other = block->next;
-	if ( !other->tag ) {
-		// merge the next free block onto the end
-		block->size += other->size;
-		block->next = other->next;
-		block->next->prev = block;
-		if (other == zone->rover) {
-			zone->rover = block;
-		}
-	}
-
-	return true;
+	return Q_Free(ptr);
 }
 
 /*
@@ -672,81 +867,190 @@ T_Realloc
 */
 void* T_Realloc( void* ptr, size_t size, int tag, bool& success )
 {
-	success = true;
+	return Q_Realloc(ptr, size, TAG_TEMP, success);
+}
 
-	if (!size && ptr)
+/*
+=================
+QMem_Info
+=================
+*/
+void QMem_Info( void ) {
+	s64 bytes[EZ_COUNT] = {0};
+	s64 blocks[EZ_COUNT] = {0};
+	u64 allocs[EZ_COUNT] = {0};
+	u64 frees[EZ_COUNT] = {0};
+	u32 numThreads = 0;
+
+	if (!g_QMemInit)
+		return;
+
+	//̻߳ʱֻǽֵ
+	BEGIN_LOCK(&g_CacheCS);
+	for (SThreadCache* cache = g_CacheList; cache; cache = cache->next)
 	{
-		T_Free(ptr);
-		return NULL_PTR;
+		for (u32 i = 0; i < EZ_COUNT; ++i)
+		{
+			bytes[i] += cache->bytes[i];
+			blocks[i] += cache->blocks[i];
+			allocs[i] += cache->allocCount[i];
+			frees[i] += cache->freeCount[i];
+		}
+		if (cache->inUse)
+			++numThreads;
 	}
+	END_LOCK(&g_CacheCS);
 
-	if (!ptr)
-		return T_TagMalloc(size, tag);
-
-	memblock_t* base = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-	if (base->tag == 0) {
-		ASSERT(false);
-		success = false;
-		return NULL_PTR;
+	for (u32 i = 0; i < EZ_COUNT; ++i)
+	{
+		SMemZone* zone = &g_Zones[i];
+		printf( "%8i bytes in %i %s zone blocks\n", (int)bytes[i], (int)blocks[i], g_ZoneNames[i] );
+		printf( "        %8i / %8i pages used, %u allocs, %u frees\n", (int)zone->usedPages, (int)zone->numPages, (u32)allocs[i], (u32)frees[i] );
+
+		if (i == EZ_TEMP)
+			continue;
+
+		for (u32 c = 0; c < QMEM_NUM_SIZE_CLASSES; ++c)
+		{
+			if (!zone->slabPages[c])
+				continue;
+			printf( "        %8i bytes class: %i pages, %i free blocks in central list\n",
+				(int)g_SizeClasses[c], (int)zone->slabPages[c], (int)zone->central[c].numBlocks );
+		}
 	}
+	printf( "        %8i threads\n", (int)numThreads );
+}
+
+/*
+=================
+QMem_Init
+=================
+*/
+static void Q_InitZone( SMemZone* zone, size_t cv ) {
+	if (cv < 1)
+		cv = 1;
 
-	// check the memory trash tester
-	if (  *(int *)((byte *)base + base->size - 4 ) != ZONEID ) {
+	memset(zone, 0, sizeof(SMemZone));
+
+	zone->size = cv * 1024 * 1024;
+	zone->numPages = (u32)(zone->size >> QMEM_PAGE_SHIFT);
+
+	// bk001205 - was malloc
+	zone->raw = (byte*)calloc( zone->size + QMEM_PAGE_SIZE, 1 );
+	zone->pages = (SPageInfo*)calloc( zone->numPages, sizeof(SPageInfo) );
+	if ( !zone->raw || !zone->pages ) {
+		/*Com_Error( ERR_FATAL, "Zone data failed to allocate %i megs", zone->size / (1024*1024) );*/
 		ASSERT(false);
-		success = false;
-		return NULL_PTR;
+		free(zone->raw);
+		free(zone->pages);
+		memset(zone, 0, sizeof(SMemZone));
+		return;
 	}
 
-	size_t newsize = size;
-	newsize += sizeof(memblock_t);	// account for size of block header
-	newsize += 4;					// space for memory trash tester
-	newsize = (newsize + 3) & ~3;
+	zone->base = (byte*)(((ptrdiff_t)zone->raw + QMEM_PAGE_SIZE - 1) & ~(ptrdiff_t)(QMEM_PAGE_SIZE - 1));
 
-	if ((int)newsize < base->size)			//big enough, return memory block unchanged
+	INIT_LOCK(&zone->pageCS);
+	for (u32 i = 0; i < QMEM_NUM_SIZE_CLASSES; ++i)
+		INIT_LOCK(&zone->central[i].cs);
+}
+
+static void Q_ReleaseZone( SMemZone* zone ) {
+	if (!zone->raw)
+		return;
+
+	for (u32 i = 0; i < QMEM_NUM_SIZE_CLASSES; ++i)
 	{
-		int extra = base->size - (int)newsize;
-		if (extra > MINFRAGMENT) {
-			// there will be a free fragment after the allocated block
-			memblock_t* newblock = (memblock_t *) ((byte *)base + newsize );
-			newblock->size = extra;
-			newblock->tag = 0;			// free block
-			newblock->prev = base;
-			newblock->id = ZONEID;
-			newblock->next = base->next;
-			newblock->next->prev = newblock;
-			base->next = newblock;
-			base->size = (int)newsize;
-
-			*(int *)((byte *)base + base->size - 4) = ZONEID;
-		}
-		return ptr;
+		free(zone->central[i].batches);
+		DESTROY_LOCK(&zone->central[i].cs);
 	}
+	DESTROY_LOCK(&zone->pageCS);
 
-	//alloc new memory
-	void* newptr = T_TagMalloc(size, tag);
-	if (!newptr)
-		return NULL_PTR;
+	free(zone->pages);
+	free(zone->raw);
+
+	zone->pages = NULL_PTR;
+	zone->raw = NULL_PTR;
+	zone->numPages = zone->usedPages = 0;
+	zone->retired = true;
+}
+
+void QMem_Init(size_t smallZoneM, size_t generalZoneM, size_t tempZoneM)
+{
+	ASSERT(!g_QMemInit);
 
-	if (newptr != ptr)
+	u32 sizeClass = 0;
+	for (u32 i = 0; i <= QMEM_MAX_SMALL_SIZE / 8; ++i)
 	{
-		memcpy(newptr, ptr, size);
-		T_Free(ptr);
+		while (g_SizeClasses[sizeClass] < i * 8)
+			++sizeClass;
+		g_SizeClassLookup[i] = (u8)sizeClass;
 	}
 
-	return newptr;
+	INIT_LOCK(&g_CacheCS);
+	g_CacheList = NULL_PTR;
+	Q_InitThreadSlot();
+
+	Q_InitZone(&g_Zones[EZ_SMALL], smallZoneM);
+	Q_InitZone(&g_Zones[EZ_MAIN], generalZoneM);
+	Q_InitZone(&g_Zones[EZ_TEMP], tempZoneM);
+
+	g_QMemInit = true;
 }
 
+static void Q_ReleaseThreadCache( SThreadCache* cache )
+{
+	for (u32 z = 0; z < EZ_TEMP; ++z)
+	{
+		for (u32 c = 0; c < QMEM_NUM_SIZE_CLASSES; ++c)
+		{
+			SFreeList& list = cache->lists[z][c];
+			if (!list.head)
+				continue;
+
+			Q_PushCentral(&g_Zones[z], c, list.head, list.count);
+			list.head = NULL_PTR;
+			list.count = 0;
+		}
+	}
 
-void QMem_Init(size_t smallZoneM, size_t generalZoneM, size_t tempZoneM)
+	if (cache->arenaFirst != QMEM_INVALID_PAGE)
+		Q_ReleaseArena(&g_Zones[EZ_TEMP], cache);
+
+	BEGIN_LOCK(&g_CacheCS);
+	cache->inUse = false;
+	END_LOCK(&g_CacheCS);
+}
+
+void QMem_ThreadExit()
 {
-	Com_InitSmallZoneMemory(smallZoneM);		//
-	Com_InitMainZoneMemory(generalZoneM);			//
-	Com_InitTempZoneMemory(tempZoneM);
+	SThreadCache* cache = Q_LoadThreadCache();
+	if (!cache || !g_QMemInit)
+		return;
+
+	Q_StoreThreadCache(NULL_PTR);			//, flsٻص
+	Q_ReleaseThreadCache(cache);
 }
 
 void QMem_End()
 {
-	Com_ReleaseTempZoneMemory();
-	Com_ReleaseMainZoneMemory();
-	Com_ReleaseSmallZoneMemory();
+	if (!g_QMemInit)
+		return;
+
+	//߳ӦöѾ˳
+	g_QMemInit = false;
+	Q_FreeThreadSlot();
+
+	Q_ReleaseZone(&g_Zones[EZ_TEMP]);
+	Q_ReleaseZone(&g_Zones[EZ_MAIN]);
+	Q_ReleaseZone(&g_Zones[EZ_SMALL]);
+
+	SThreadCache* cache = g_CacheList;
+	while (cache)
+	{
+		SThreadCache* next = cache->next;
+		free(cache);
+		cache = next;
+	}
+	g_CacheList = NULL_PTR;
+	DESTROY_LOCK(&g_CacheCS);
 }
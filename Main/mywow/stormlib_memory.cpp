@@ -13,19 +13,9 @@ void* Malloc(size_t nSize)
 {
 	void* p = NULL_PTR;
 	if (nSize <= 4)
-	{
-		BEGIN_LOCK(&g_Globals.allocatorCS);
-		if (Z_AvailableSmallMemory() > 4)
-			p = Z_TagMalloc(nSize, TAG_SMALL);
-		END_LOCK(&g_Globals.allocatorCS);
-	}
+		p = Z_TagMalloc(nSize, TAG_SMALL);
 	else if (nSize <= 64)
-	{
-		BEGIN_LOCK(&g_Globals.allocatorCS);
-		if (Z_AvailableMainMemory() > 64)
-			p = Z_TagMalloc(nSize, TAG_GENERAL);
-		END_LOCK(&g_Globals.allocatorCS);
-	}
+		p = Z_TagMalloc(nSize, TAG_GENERAL);
 
 	if (!p)
 		p = malloc(nSize);
@@ -35,12 +25,7 @@ void* Malloc(size_t nSize)
 
 void Free(void * ptr)
 {
-	bool ret;
-	BEGIN_LOCK(&g_Globals.allocatorCS);
-	ret = Z_Free(ptr);
-	END_LOCK(&g_Globals.allocatorCS);
-
-	if (!ret)
+	if (!Z_Free(ptr))
 		free(ptr);
 }
 
@@ -50,19 +35,9 @@ void* ReAlloc(void* ptr, size_t nSize)
 
 	void* p = NULL_PTR;
 	if (nSize <= 4)
-	{
-		BEGIN_LOCK(&g_Globals.allocatorCS);
-		if (Z_AvailableSmallMemory() > 4)
-			p = Z_Realloc(ptr, nSize, TAG_SMALL, ret);
-		END_LOCK(&g_Globals.allocatorCS);
-	}
+		p = Z_Realloc(ptr, nSize, TAG_SMALL, ret);
 	else if (nSize <= 64)
-	{
-		BEGIN_LOCK(&g_Globals.allocatorCS);
-		if (Z_AvailableMainMemory() > 64)
-			p = Z_Realloc(ptr, nSize, TAG_GENERAL, ret);
-		END_LOCK(&g_Globals.allocatorCS);
-	}
+		p = Z_Realloc(ptr, nSize, TAG_GENERAL, ret);
 
 	if (ret)
 		return p;
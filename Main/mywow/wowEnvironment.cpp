@@ -3,6 +3,7 @@
 #include "mpq_stormlib.h"
 #include "mywow.h"
 #include "CMemFile.h"
+#include "CLock.h"
 
 #define MPQFILES	"mpqfiles/"
 
@@ -55,9 +56,46 @@ const c8* updatefiles[] =
 	"18273",
 };
 
+#ifdef MW_USE_MPQ
+#define MPQ_INDEX_NONE		0xffffffff
+
+//mpqļִСдбܷ, hash2һ㷨, hashһųͻ
+static u64 hashMpqFileName(const c8* filename, u32& hash2)
+{
+	u64 h = 14695981039346656037ULL;			//fnv-1a
+	u32 h2 = 0;									//bkdr
+	for (const c8* p = filename; *p; ++p)
+	{
+		c8 c = *p;
+		if (c == '\\')
+			c = '/';
+		else if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		h ^= (u8)c;
+		h *= 1099511628211ULL;
+		h2 = h2 * 131 + (u8)c;
+	}
+	hash2 = h2;
+	return h ? h : 1;
+}
+#endif
+
+//fnv-1a8ֽڻԪ
+static u64 mixStamp(u64 h, u64 v)
+{
+	h ^= v;
+	h *= 1099511628211ULL;
+	return h;
+}
+
 wowEnvironment::wowEnvironment(IFileSystem* fs, bool useCompress, bool outputFilename)
-	: FileSystem(fs), UseLocale(true), RecordFile(NULL_PTR), hStorage(NULL_PTR), CascLocale(0)
+	: FileSystem(fs), UseLocale(true), UseFileIndex(true), RecordFile(NULL_PTR), hStorage(NULL_PTR), CascLocale(0), ArchiveStamp(0)
 {
+#ifdef MW_USE_MPQ
+	MpqFileIndexMask = 0;
+	NumLocaleIndexArchives = 0;
+#endif
+
 #if defined(MW_USE_MPQ) || defined(MW_USE_CASC)
 	UseCompress = useCompress;
 #else
@@ -112,14 +150,24 @@ wowEnvironment::wowEnvironment(IFileSystem* fs, bool useCompress, bool outputFil
 			UseAlternate ? "true" : "false");
 	}
 
+	INIT_LOCK(&ArchiveCS);
+
 	InitializeListHead(&LocaleMpqArchiveList);
 	InitializeListHead(&MainMpqArchiveList);
 	InitializeListHead(&LocalePatchMpqArchiveList);
 	InitializeListHead(&MainPatchMpqArchiveList);
 
 	if(UseCompress)
+	{
 		loadRoot();
 
+#ifdef MW_USE_MPQ
+		buildMpqFileIndex();
+#endif
+
+		buildArchiveStamp();
+	}
+
 	if(outputFilename)
 	{
 		const c8* filename = FileSystem->getConfigs()->getSetting(ECT_SETTING, "output");
@@ -139,6 +187,8 @@ wowEnvironment::~wowEnvironment()
 
 	if(UseCompress)
 		unloadRoot();
+
+	DESTROY_LOCK(&ArchiveCS);
 }
 
 void wowEnvironment::loadCascListFiles()
@@ -410,6 +460,11 @@ bool wowEnvironment::loadRoot()
 void wowEnvironment::unloadRoot()
 {
 #ifdef MW_USE_MPQ
+	MpqFileIndex.clear();
+	MpqFileIndexMask = 0;
+	MpqIndexArchives.clear();
+	MpqUnlistedArchives.clear();
+	NumLocaleIndexArchives = 0;
 
 	for(PLENTRY e = LocaleMpqArchiveList.Flink; e != &LocaleMpqArchiveList; )
 	{
@@ -463,110 +518,18 @@ IMemFile* wowEnvironment::openFile( const c8* filename, bool tempfile )
 
 	unsigned char* buffer = 0;
 
-	string256 strfilename;
-	if (UseAlternate)
-	{
-		strfilename = "alternate/";
-		strfilename.append(filename);
-		strfilename.normalize();
-	}
-
 	if(UseCompress)
 	{
-#if defined(MW_USE_MPQ)
-		for(PLENTRY e = LocaleMpqArchiveList.Flink; e != &LocaleMpqArchiveList; )
-		{
-			MPQArchive* ar = reinterpret_cast<MPQArchive*>CONTAINING_RECORD(e, MPQArchive, Link);
-			e = e->Flink;
-
-			HANDLE& mpq_a = ar->mpq_a;
-			HANDLE fh;
-			if( !SFileOpenFileEx( mpq_a, realfilename, SFILE_OPEN_FROM_MPQ, &fh ) )
-				continue;
-
-			// Found!
-			u32 size = SFileGetFileSize( fh, NULL_PTR );
-
-			// HACK: in patch.mpq some files don't want to open and give 1 for filesize
-			if (size<=1) {
-				SFileCloseFile(fh);
-				return NULL_PTR;
-			}
+		CLock lock(&ArchiveCS);			//stormlib, casclibľܶ߳ͬʱ
 
-			//found
-			if (tempfile)
-				buffer = (unsigned char*)Z_AllocateTempMemory(size);
-			else
-				buffer = new unsigned char[size];
-
-			bool ret = SFileReadFile(fh, buffer, (DWORD)size, NULL_PTR, NULL_PTR);
-			ASSERT(ret);
-			SFileCloseFile(fh);
-
-			//record file
-			if(RecordFile)
-			{
-				c8 tmp[1024];
-				Q_sprintf(tmp, 1024, "%s , %d\n", realfilename, 1);
-				RecordFile->writeText(tmp, 1024);
-				RecordFile->flush();
-			}
-
-			return  new CMemFile(buffer, size, realfilename, tempfile);
-		}
-
-		for(PLENTRY e = MainMpqArchiveList.Flink; e != &MainMpqArchiveList; )
-		{
-			MPQArchive* ar = reinterpret_cast<MPQArchive*>CONTAINING_RECORD(e, MPQArchive, Link);
-			e = e->Flink;
-
-			HANDLE& mpq_a = ar->mpq_a;
-			HANDLE fh;
-
-			if (UseAlternate)
-			{
-				if( !SFileOpenFileEx( mpq_a, strfilename.c_str(), SFILE_OPEN_FROM_MPQ, &fh ) )
-				{
-					if( !SFileOpenFileEx( mpq_a, realfilename, SFILE_OPEN_FROM_MPQ, &fh ) )
-						continue;
-				}
-			}
-			else
-			{
-				if( !SFileOpenFileEx( mpq_a, realfilename, SFILE_OPEN_FROM_MPQ, &fh ) )
-					continue;
-			}
-			
-			// Found!
-			u32 size = SFileGetFileSize( fh, NULL_PTR );
-
-			// HACK: in patch.mpq some files don't want to open and give 1 for filesize
-			if (size<=1 || size == 0xffffffff) {
-				SFileCloseFile(fh);
-				return NULL_PTR;
-			}
-
-			//found
-			if (tempfile)
-				buffer = (unsigned char*)Z_AllocateTempMemory(size);
-			else
-				buffer = new unsigned char[size];
-
-			bool ret = SFileReadFile(fh, buffer, (DWORD)size, NULL_PTR, NULL_PTR);
-			ASSERT(ret);
-			SFileCloseFile(fh);
-
-			//record file
-			if(RecordFile)
-			{
-				c8 tmp[1024];
-				Q_sprintf(tmp, 1024, "%s , %d\n", realfilename, 0);
-				RecordFile->writeText(tmp, 1024);
-				RecordFile->flush();
-			}
+#if defined(MW_USE_MPQ)
+		HANDLE fh;
+		bool locale;
+		u32 order;
+		if (!openMpqFile(realfilename, fh, locale, order))
+			return NULL_PTR;
 
-			return new CMemFile(buffer, size, realfilename, tempfile);
-		}
+		return readMpqFile(fh, realfilename, tempfile, locale);
 #elif defined(MW_USE_CASC)
 		string_path path = FileSystem->getDataDirectory();
 		path.normalizeDir();
@@ -574,27 +537,7 @@ IMemFile* wowEnvironment::openFile( const c8* filename, bool tempfile )
 		path.append(realfilename);
 		path.normalize();
 		if (FileSystem->isFileExists(path.c_str()))
-		{
-			IReadFile* rfile = FileSystem->createAndOpenFile(path.c_str(), true);
-			u32 size = rfile->getSize();
-
-			if (size <= 1 || size == 0xffffffff)
-			{
-				delete rfile;
-				return NULL_PTR;
-			}
-
-			if (tempfile)
-				buffer = (unsigned char*)Z_AllocateTempMemory(size);
-			else
-				buffer = new unsigned char[size];
-
-			u32 readSize = rfile->read(buffer, size);
-			ASSERT(readSize == size);
-			delete rfile;
-
-			return new CMemFile(buffer, size, realfilename, tempfile);
-		}
+			return FileSystem->createMemFile(path.c_str(), realfilename, tempfile);
 
 		HANDLE hFile;
 
@@ -668,25 +611,7 @@ IMemFile* wowEnvironment::openFile( const c8* filename, bool tempfile )
 			}
 		}
 
-		IReadFile* rfile = FileSystem->createAndOpenFile(path.c_str(), true);
-		u32 size = rfile->getSize();
-
-		if (size <= 1)
-		{
-			delete rfile;
-			return NULL_PTR;
-		}
-
-		if (tempfile)
-			buffer = (unsigned char*)Z_AllocateTempMemory(size);
-		else
-			buffer = new unsigned char[size];
-
-		u32 readSize = rfile->read(buffer, size);
-		ASSERT(readSize == size);
-		delete rfile;
-
-		return new CMemFile(buffer, size, realfilename, tempfile);
+		return FileSystem->createMemFile(path.c_str(), realfilename, tempfile);
 	}
 
 	return NULL_PTR;
@@ -703,14 +628,23 @@ bool wowEnvironment::exists( const c8* filename )
 	
 	if(UseCompress)
 	{
+		CLock lock(&ArchiveCS);
+
 #if defined(MW_USE_MPQ)
+		if (UseFileIndex)
+		{
+			bool alternate, locale;
+			u32 order;
+			return findMpqArchive(realfilename, alternate, locale, order) != NULL_PTR;
+		}
+
 		for(PLENTRY e = LocaleMpqArchiveList.Flink; e != &LocaleMpqArchiveList; )
 		{
 			MPQArchive* ar = reinterpret_cast<MPQArchive*>CONTAINING_RECORD(e, MPQArchive, Link);
 			e = e->Flink;
 
 			HANDLE& mpq_a = ar->mpq_a;
-			if( SFileHasFile( mpq_a, filename) )
+			if( SFileHasFile( mpq_a, realfilename) )
 				return true;
 		}
 		for(PLENTRY e = MainMpqArchiveList.Flink; e != &MainMpqArchiveList; )
@@ -774,6 +708,337 @@ bool wowEnvironment::exists( const c8* filename )
 	return false;
 }
 
+bool wowEnvironment::getFileStamp( const c8* filename, u64& stamp )
+{
+	c8 realfilename[QMAX_PATH];
+	normalizeFileName(filename, realfilename, QMAX_PATH);
+	Q_strlwr(realfilename);
+
+	u64 size, time;
+
+	if(UseCompress)
+	{
+		CLock lock(&ArchiveCS);
+
+#if defined(MW_USE_MPQ)
+		//λúʹС, (attributes)ʱ, ֻ򿪾ѹ
+		HANDLE fh;
+		bool locale;
+		u32 order;
+		if (!openMpqFile(realfilename, fh, locale, order))
+			return false;
+
+		DWORD fileSize = 0, cmpSize = 0;
+		ULONGLONG position = 0, fileTime = 0;
+		SFileGetFileInfo(fh, SFILE_INFO_FILE_SIZE, &fileSize, sizeof(fileSize), NULL_PTR);
+		SFileGetFileInfo(fh, SFILE_INFO_COMPRESSED_SIZE, &cmpSize, sizeof(cmpSize), NULL_PTR);
+		SFileGetFileInfo(fh, SFILE_INFO_POSITION, &position, sizeof(position), NULL_PTR);
+		SFileGetFileInfo(fh, SFILE_INFO_FILETIME, &fileTime, sizeof(fileTime), NULL_PTR);			//û(attributes)ʱΪ0
+		SFileCloseFile(fh);
+
+		stamp = mixStamp(ArchiveStamp, order);
+		stamp = mixStamp(stamp, ((u64)cmpSize << 32) | fileSize);
+		stamp = mixStamp(stamp, position);
+		stamp = mixStamp(stamp, fileTime);
+		return true;
+#elif defined(MW_USE_CASC)
+		string_path path = FileSystem->getDataDirectory();
+		path.normalizeDir();
+		path.append(MPQFILES);
+		path.append(realfilename);
+		path.normalize();
+		if (Q_getFileStat(path.c_str(), size, time))
+		{
+			stamp = mixStamp(mixStamp(14695981039346656037ULL, size), time);
+			return true;
+		}
+
+		//ͬһbuildݲ, ټϴС
+		HANDLE hFile;
+		if (!CascOpenFile(hStorage, realfilename, CascLocale, 0, &hFile))
+		{
+			if (CascLocale == 0 || !CascOpenFile(hStorage, realfilename, 0, 0, &hFile))
+				return false;
+		}
+
+		DWORD dwHigh;
+		u32 fileSize = CascGetFileSize(hFile, &dwHigh);
+		CascCloseFile(hFile);
+
+		stamp = mixStamp(ArchiveStamp, fileSize);
+		return true;
+#endif
+	}
+	else
+	{
+		string_path path = FileSystem->getMpqDirectory();
+		path.normalizeDir();
+		path.append(MPQFILES);
+		path.append(realfilename);
+		path.normalize();
+		if (!Q_getFileStat(path.c_str(), size, time))
+		{
+			if (!UseLocale)
+				return false;
+
+			path = LocalePath;
+			path.append(MPQFILES);
+			path.append(realfilename);
+			path.normalize();
+			if (!Q_getFileStat(path.c_str(), size, time))
+				return false;
+		}
+
+		stamp = mixStamp(mixStamp(14695981039346656037ULL, size), time);
+		return true;
+	}
+
+	return false;
+}
+
+void wowEnvironment::buildArchiveStamp()
+{
+	u64 h = 14695981039346656037ULL;
+
+#if defined(MW_USE_MPQ)
+	//ֱӦڹ鵵, ļĿ, й鵵ȥ
+	PLENTRY lists[] = { &LocaleMpqArchiveList, &MainMpqArchiveList, &LocalePatchMpqArchiveList, &MainPatchMpqArchiveList };
+	for (u32 i=0; i<sizeof(lists) / sizeof(lists[0]); ++i)
+	{
+		for(PLENTRY e = lists[i]->Flink; e != lists[i]; e = e->Flink)
+		{
+			MPQArchive* ar = reinterpret_cast<MPQArchive*>CONTAINING_RECORD(e, MPQArchive, Link);
+			u64 size = 0, time = 0;
+			Q_getFileStat(ar->archivename.c_str(), size, time);
+			h = mixStamp(h, size);
+			h = mixStamp(h, time);
+		}
+		h = mixStamp(h, i);
+	}
+#elif defined(MW_USE_CASC)
+	DWORD build = 0;
+	CascGetStorageInfo(hStorage, CascStorageGameBuild, &build, sizeof(build), NULL_PTR);
+	h = mixStamp(h, build);
+	h = mixStamp(h, CascLocale);
+#endif
+
+	ArchiveStamp = h;
+}
+
+#ifdef MW_USE_MPQ
+void wowEnvironment::buildMpqFileIndex()
+{
+	CTimer timer;
+	u32 begin = timer.getMillisecond();
+
+	//˳openFileһ: locale, main, ѾӦڹ鵵
+	MpqIndexArchives.clear();
+	for(PLENTRY e = LocaleMpqArchiveList.Flink; e != &LocaleMpqArchiveList; e = e->Flink)
+		MpqIndexArchives.push_back(reinterpret_cast<MPQArchive*>CONTAINING_RECORD(e, MPQArchive, Link));
+	NumLocaleIndexArchives = (u32)MpqIndexArchives.size();
+	for(PLENTRY e = MainMpqArchiveList.Flink; e != &MainMpqArchiveList; e = e->Flink)
+		MpqIndexArchives.push_back(reinterpret_cast<MPQArchive*>CONTAINING_RECORD(e, MPQArchive, Link));
+
+	MpqUnlistedArchives.clear();
+	MpqFileIndex.clear();
+	MpqFileIndexMask = 0;
+
+	std::vector<SMpqIndexEntry> entries;
+	entries.reserve(65536);
+	for (u32 i = 0; i < (u32)MpqIndexArchives.size(); ++i)
+	{
+		SFILE_FIND_DATA sf;
+		HANDLE hFind = SFileFindFirstFile(MpqIndexArchives[i]->mpq_a, "*", &sf, NULL_PTR);
+		if (!hFind)				//ûļб, ʱֻ̽鵵
+		{
+			FileSystem->writeLog(ELOG_RES, "mpq file index: cannot list %s, probed on lookup", MpqIndexArchives[i]->archivename.c_str());
+			MpqUnlistedArchives.push_back(i);
+			continue;
+		}
+
+		do
+		{
+			SMpqIndexEntry entry;
+			entry.hash = hashMpqFileName(sf.cFileName, entry.hash2);
+			entry.order = i;
+			entries.push_back(entry);
+		} while (SFileFindNextFile(hFind, &sf));
+
+		SFileFindClose(hFind);
+	}
+
+	if (entries.empty())
+		return;
+
+	u32 size = 1024;
+	while (size * 3 < (u32)entries.size() * 4)
+		size <<= 1;
+
+	SMpqIndexEntry empty = { 0, 0, 0 };
+	MpqFileIndex.assign(size, empty);
+	MpqFileIndexMask = size - 1;
+
+	u32 count = 0;
+	for (u32 i = 0; i < (u32)entries.size(); ++i)
+	{
+		const SMpqIndexEntry& entry = entries[i];
+		u32 slot = (u32)entry.hash & MpqFileIndexMask;
+		while (MpqFileIndex[slot].hash != 0 && 
+			(MpqFileIndex[slot].hash != entry.hash || MpqFileIndex[slot].hash2 != entry.hash2))
+			slot = (slot + 1) & MpqFileIndexMask;
+
+		//ȳֵĹ鵵
+		if (MpqFileIndex[slot].hash == 0)
+		{
+			MpqFileIndex[slot] = entry;
+			++count;
+		}
+	}
+
+	FileSystem->writeLog(ELOG_RES, "mpq file index: %u files, %u archives, %u unlisted, %u ms", 
+		count, (u32)MpqIndexArchives.size(), (u32)MpqUnlistedArchives.size(), timer.getMillisecond() - begin);
+}
+
+u32 wowEnvironment::findMpqIndex( const c8* realfilename ) const
+{
+	if (MpqFileIndex.empty())
+		return MPQ_INDEX_NONE;
+
+	u32 hash2;
+	u64 hash = hashMpqFileName(realfilename, hash2);
+	u32 slot = (u32)hash & MpqFileIndexMask;
+	for (; MpqFileIndex[slot].hash != 0; slot = (slot + 1) & MpqFileIndexMask)
+	{
+		if (MpqFileIndex[slot].hash == hash && MpqFileIndex[slot].hash2 == hash2)
+			return MpqFileIndex[slot].order;
+	}
+	return MPQ_INDEX_NONE;
+}
+
+MPQArchive* wowEnvironment::findMpqArchive( const c8* realfilename, bool& alternate, bool& locale, u32& order ) const
+{
+	alternate = false;
+	locale = false;
+
+	order = findMpqIndex(realfilename);
+
+	//alternateֻmain鵵в, ͬһ鵵alternate
+	string256 strfilename;
+	if (UseAlternate)
+	{
+		strfilename = "alternate/";
+		strfilename.append(realfilename);
+
+		u32 altorder = findMpqIndex(strfilename.c_str());
+		if (altorder != MPQ_INDEX_NONE && altorder >= NumLocaleIndexArchives && altorder <= order)
+		{
+			order = altorder;
+			alternate = true;
+		}
+	}
+
+	//ûlistfileĹ鵵ֻ֮̽ǰ
+	for (u32 i = 0; i < (u32)MpqUnlistedArchives.size() && MpqUnlistedArchives[i] < order; ++i)
+	{
+		u32 k = MpqUnlistedArchives[i];
+		HANDLE mpq_a = MpqIndexArchives[k]->mpq_a;
+		if (UseAlternate && k >= NumLocaleIndexArchives && SFileHasFile(mpq_a, strfilename.c_str()))
+		{
+			order = k;
+			alternate = true;
+			break;
+		}
+		if (SFileHasFile(mpq_a, realfilename))
+		{
+			order = k;
+			alternate = false;
+			break;
+		}
+	}
+
+	if (order >= (u32)MpqIndexArchives.size())
+		return NULL_PTR;
+
+	locale = order < NumLocaleIndexArchives;
+	return MpqIndexArchives[order];
+}
+
+//˳: Ĺ鵵, رʱlocalemain̽; orderΪ鵵MpqIndexArchivesеλ
+bool wowEnvironment::openMpqFile( const c8* realfilename, HANDLE& fh, bool& locale, u32& order )
+{
+	string256 strfilename;
+	if (UseAlternate)
+	{
+		strfilename = "alternate/";
+		strfilename.append(realfilename);
+		strfilename.normalize();
+	}
+
+	if (UseFileIndex)
+	{
+		//Ĺ鵵ǽ, ̽
+		bool alternate;
+		MPQArchive* ar = findMpqArchive(realfilename, alternate, locale, order);
+		return ar && SFileOpenFileEx( ar->mpq_a, alternate ? strfilename.c_str() : realfilename, SFILE_OPEN_FROM_MPQ, &fh );
+	}
+
+	order = 0;
+	locale = true;
+	for(PLENTRY e = LocaleMpqArchiveList.Flink; e != &LocaleMpqArchiveList; e = e->Flink, ++order)
+	{
+		MPQArchive* ar = reinterpret_cast<MPQArchive*>CONTAINING_RECORD(e, MPQArchive, Link);
+		if( SFileOpenFileEx( ar->mpq_a, realfilename, SFILE_OPEN_FROM_MPQ, &fh ) )
+			return true;
+	}
+
+	locale = false;
+	for(PLENTRY e = MainMpqArchiveList.Flink; e != &MainMpqArchiveList; e = e->Flink, ++order)
+	{
+		MPQArchive* ar = reinterpret_cast<MPQArchive*>CONTAINING_RECORD(e, MPQArchive, Link);
+		if (UseAlternate && SFileOpenFileEx( ar->mpq_a, strfilename.c_str(), SFILE_OPEN_FROM_MPQ, &fh ) )
+			return true;
+		if( SFileOpenFileEx( ar->mpq_a, realfilename, SFILE_OPEN_FROM_MPQ, &fh ) )
+			return true;
+	}
+
+	return false;
+}
+
+IMemFile* wowEnvironment::readMpqFile( void* fh, const c8* realfilename, bool tempfile, bool locale )
+{
+	// Found!
+	u32 size = SFileGetFileSize( fh, NULL_PTR );
+
+	// HACK: in patch.mpq some files don't want to open and give 1 for filesize
+	if (size<=1 || size == 0xffffffff) {
+		SFileCloseFile(fh);
+		return NULL_PTR;
+	}
+
+	//found
+	unsigned char* buffer;
+	if (tempfile)
+		buffer = (unsigned char*)Z_AllocateTempMemory(size);
+	else
+		buffer = new unsigned char[size];
+
+	bool ret = SFileReadFile(fh, buffer, (DWORD)size, NULL_PTR, NULL_PTR);
+	ASSERT(ret);
+	SFileCloseFile(fh);
+
+	//record file
+	if(RecordFile)
+	{
+		c8 tmp[1024];
+		Q_sprintf(tmp, 1024, "%s , %d\n", realfilename, locale ? 1 : 0);
+		RecordFile->writeText(tmp, 1024);
+		RecordFile->flush();
+	}
+
+	return new CMemFile(buffer, size, realfilename, tempfile);
+}
+#endif
+
 void wowEnvironment::iterateFiles(const c8* ext, MPQFILECALLBACK callback, void* param )
 {
 	if(UseCompress)
@@ -2,10 +2,12 @@
 #include "wow_dbc.h"
 #include "mywow.h"
 #include <tuple>
+#include <algorithm>
 
 dbc::dbc( wowEnvironment* env, const c8* filename, bool tmp )
 	: minorVersion(0), IsSparse(false)
 {
+	File = NULL_PTR;
 	_recordStart = NULL_PTR;
 	_stringStart = NULL_PTR;
 
@@ -20,20 +22,22 @@ dbc::dbc( wowEnvironment* env, const c8* filename, bool tmp )
 	IDs = NULL_PTR;
 	CopyTables = NULL_PTR;
 	CommonColumns = NULL_PTR;
+	MinID = 0;
 
 	HasDataOffsetBlock = false;
 	HasIndex = false;
 	HasUnknownStuff = false;
 
+	//ʱڴ, ļݿһֱ
 	string512 path = filename;
-	IMemFile* file = env->openFile(path.c_str());
+	IMemFile* file = env->openFile(path.c_str(), false);
 
 	if (!file)
 	{
 		if (hasFileExtensionA(path.c_str(), "dbc"))
 			path.changeExt(".dbc", ".db2");
 
-		file = env->openFile(path.c_str());
+		file = env->openFile(path.c_str(), false);
 	}
 
 	ASSERT(file);
@@ -69,18 +73,26 @@ dbc::dbc( wowEnvironment* env, const c8* filename, bool tmp )
 	else if (db_type == 6)	//db6
 		readWDB6(env, file, tmp);
 
-	delete file;
+	if (File != file)
+		delete file;
 }
 
 dbc::~dbc()
 {
 	delete[] CommonColumns;
 	delete[] CopyTables;
-	delete[] IDs;
 	delete[] OffsetMaps;
 	delete[] Fields;
-	delete[] _stringStart;
-	delete[] _recordStart;
+	if (File)
+	{
+		delete File;
+	}
+	else
+	{
+		delete[] IDs;
+		delete[] _stringStart;
+		delete[] _recordStart;
+	}
 }
 
 void dbc::readWDBC(wowEnvironment* env, IMemFile* file, bool tmp)
@@ -100,23 +112,18 @@ void dbc::readWDBC(wowEnvironment* env, IMemFile* file, bool tmp)
 		file->getFileName(), nFields, RecordSize, nActualRecords, StringSize);
 
 	u32 current = file->getPos();
-	_recordStart = new u8[RecordSize * nActualRecords];
-	_stringStart = new u8[StringSize];
-
-	file->read(_recordStart, RecordSize * nActualRecords);			//records
+	File = file;
+	_recordStart = file->getPointer();			//records
 	file->seek(current + RecordSize * nRecords);
-	file->read(_stringStart, StringSize);		//string
+	_stringStart = file->getPointer();		//string
+	file->seek(StringSize, true);
 
 	ASSERT(file->getPos() == file->getSize());
 
 	//build map
 	if (!tmp)		//ʱļдmap
 	{
-		for (u32 i=0; i<nActualRecords; ++i)
-		{
-			u32 id =  *reinterpret_cast<u32*>(_recordStart + i * RecordSize);
-			RecordLookup32[id] = i;
-		}
+		buildIDLookup(_recordStart, RecordSize, nActualRecords);
 	}
 
 	fs->writeLog(ELOG_RES, "successfully loaded db file: %s", file->getFileName());
@@ -149,7 +156,7 @@ void dbc::readWDB2(wowEnvironment* env, IMemFile* file, bool tmp)
 				continue;
 			if(!tmp)		//ʱļдmap
 			{
-				RecordSparseLookup32[nActualRecords] = i;
+				SparseRows.push_back(i);
 			}
 			++nActualRecords;
 		}
@@ -162,23 +169,18 @@ void dbc::readWDB2(wowEnvironment* env, IMemFile* file, bool tmp)
 		file->getFileName(), nFields, RecordSize, nActualRecords, StringSize);
 
 	u32 current = file->getPos();
-	_recordStart = new u8[RecordSize * nActualRecords];
-	_stringStart = new u8[StringSize];
-
-	file->read(_recordStart, RecordSize * nActualRecords);			//records
+	File = file;
+	_recordStart = file->getPointer();			//records
 	file->seek(current + RecordSize * nRecords);
-	file->read(_stringStart, StringSize);		//string
+	_stringStart = file->getPointer();		//string
+	file->seek(StringSize, true);
 
 	ASSERT(file->getPos() == file->getSize());
 
 	//build map
 	if (!IsSparse && !tmp)		//ʱļдmap
 	{
-		for (u32 i=0; i<nActualRecords; ++i)
-		{
-			u32 id =  *reinterpret_cast<u32*>(_recordStart + i * RecordSize);
-			RecordLookup32[id] = i;
-		}
+		buildIDLookup(_recordStart, RecordSize, nActualRecords);
 	}
 
 	fs->writeLog(ELOG_RES, "successfully loaded db file: %s", file->getFileName());
@@ -271,12 +273,11 @@ void dbc::readWDB5(wowEnvironment* env, IMemFile* file, bool tmp)
 	else
 	{
 		u32 current = file->getPos();
-		_recordStart = new u8[RecordSize * nRecords];
-		_stringStart = new u8[StringSize];
-
-		file->read(_recordStart, RecordSize * nRecords);			//records
+		File = file;
+		_recordStart = file->getPointer();			//records
 		file->seek(current + RecordSize * nRecords);
-		file->read(_stringStart, StringSize);		//string
+		_stringStart = file->getPointer();		//string
+		file->seek(StringSize, true);
 	}
 
 	s32 indexDataSize = nRecords * sizeof(s32);
@@ -285,8 +286,16 @@ void dbc::readWDB5(wowEnvironment* env, IMemFile* file, bool tmp)
 
 	if (HasIndex)
 	{
-		IDs = new u32[nRecords];
-		file->read(IDs, sizeof(u32) * nRecords);
+		if (File)
+		{
+			IDs = reinterpret_cast<u32*>(file->getPointer());
+			file->seek(sizeof(u32) * nRecords, true);
+		}
+		else
+		{
+			IDs = new u32[nRecords];
+			file->read(IDs, sizeof(u32) * nRecords);
+		}
 	}
 
 	if (header.refdatasize > 0)
@@ -303,11 +312,7 @@ void dbc::readWDB5(wowEnvironment* env, IMemFile* file, bool tmp)
 	//build map
 	if (!tmp && HasIndex)		//ʱļдmap
 	{
-		for (u32 i=0; i<nRecords; ++i)
-		{
-			u32 id = IDs[i];
-			RecordLookup32[id] = i;
-		}
+		buildIDLookup(reinterpret_cast<const u8*>(IDs), sizeof(u32), nRecords);
 	}
 
 	fs->writeLog(ELOG_RES, "successfully loaded db file: %s", file->getFileName());
@@ -400,12 +405,11 @@ void dbc::readWDB6(wowEnvironment* env, IMemFile* file, bool tmp)
 	else
 	{
 		u32 current = file->getPos();
-		_recordStart = new u8[RecordSize * nRecords];
-		_stringStart = new u8[StringSize];
-
-		file->read(_recordStart, RecordSize * nRecords);			//records
+		File = file;
+		_recordStart = file->getPointer();			//records
 		file->seek(current + RecordSize * nRecords);
-		file->read(_stringStart, StringSize);		//string
+		_stringStart = file->getPointer();		//string
+		file->seek(StringSize, true);
 	}
 
 	s32 indexDataSize = nRecords * sizeof(s32);
@@ -414,8 +418,16 @@ void dbc::readWDB6(wowEnvironment* env, IMemFile* file, bool tmp)
 
 	if (HasIndex)
 	{
-		IDs = new u32[nRecords];
-		file->read(IDs, sizeof(u32) * nRecords);
+		if (File)
+		{
+			IDs = reinterpret_cast<u32*>(file->getPointer());
+			file->seek(sizeof(u32) * nRecords, true);
+		}
+		else
+		{
+			IDs = new u32[nRecords];
+			file->read(IDs, sizeof(u32) * nRecords);
+		}
 	}
 
 	if (header.refdatasize > 0)
@@ -474,14 +486,127 @@ void dbc::readWDB6(wowEnvironment* env, IMemFile* file, bool tmp)
 	//build map
 	if (!tmp && HasIndex)		//ʱļдmap
 	{
-		for (u32 i = 0; i < nRecords; ++i)
+		buildIDLookup(reinterpret_cast<const u8*>(IDs), sizeof(u32), nRecords);
+	}
+
+	fs->writeLog(ELOG_RES, "successfully loaded db file: %s", file->getFileName());
+}
+
+void dbc::buildIDLookup( const u8* ids, u32 stride, u32 count )
+{
+	if (count == 0)
+		return;
+
+	u32 minId = 0xffffffff;
+	u32 maxId = 0;
+	for (u32 i=0; i<count; ++i)
+	{
+		u32 id = *reinterpret_cast<const u32*>(ids + i * stride);
+		minId = min_(minId, id);
+		maxId = max_(maxId, id);
+	}
+
+	//ظidȡһ, ԭmapĸǽһ
+	if ((u64)maxId - minId < (u64)count * 2)
+	{
+		MinID = minId;
+		DenseIDRows.assign(maxId - minId + 1, 0xffffffff);
+		for (u32 i=0; i<count; ++i)
 		{
-			u32 id = IDs[i];
-			RecordLookup32[id] = i;
+			u32 id = *reinterpret_cast<const u32*>(ids + i * stride);
+			DenseIDRows[id - minId] = i;
 		}
 	}
+	else
+	{
+		SortedIDs.resize(count);
+		for (u32 i=0; i<count; ++i)
+		{
+			SortedIDs[i].id = *reinterpret_cast<const u32*>(ids + i * stride);
+			SortedIDs[i].row = i;
+		}
+		std::sort(SortedIDs.begin(), SortedIDs.end());
 
-	fs->writeLog(ELOG_RES, "successfully loaded db file: %s", file->getFileName());
+		u32 n = 0;
+		for (u32 i=0; i<count; ++i)
+		{
+			if (i + 1 < count && SortedIDs[i + 1].id == SortedIDs[i].id)
+				continue;
+			SortedIDs[n++] = SortedIDs[i];
+		}
+		SortedIDs.resize(n);
+	}
+}
+
+s32 dbc::findRowByID( u32 id ) const
+{
+	if (!DenseIDRows.empty())
+	{
+		u32 k = id - MinID;
+		if (k >= (u32)DenseIDRows.size() || DenseIDRows[k] == 0xffffffff)
+			return -1;
+		return (s32)DenseIDRows[k];
+	}
+
+	SIDEntry key;
+	key.id = id;
+	key.row = 0;
+	std::vector<SIDEntry>::const_iterator itr = std::lower_bound(SortedIDs.begin(), SortedIDs.end(), key);
+	if (itr == SortedIDs.end() || itr->id != id)
+		return -1;
+	return (s32)itr->row;
+}
+
+void dbc::addIndex( u32 field )
+{
+	ASSERT(nRecords == 0 || field < nFields);
+
+	SecondaryIndices.emplace_back(SSecondaryIndex());
+	SSecondaryIndex& index = SecondaryIndices.back();
+	index.field = field;
+
+	if (nRecords == 0)
+		return;
+
+	std::vector<std::pair<u32, u32> > pairs;
+	pairs.reserve(nRecords);
+	for (u32 i=0; i<nRecords; ++i)
+	{
+		dbc::record r = getRecord(i);
+		pairs.emplace_back(std::make_pair(r.getUInt(field), i));
+	}
+	std::sort(pairs.begin(), pairs.end());		//ͬһkeyڱк, ˳һ
+
+	index.keys.resize(nRecords);
+	index.rows.resize(nRecords);
+	for (u32 i=0; i<nRecords; ++i)
+	{
+		index.keys[i] = pairs[i].first;
+		index.rows[i] = pairs[i].second;
+	}
+}
+
+u32 dbc::findRows( u32 field, u32 key, const u32*& rows ) const
+{
+	rows = NULL_PTR;
+
+	for (u32 i=0; i<(u32)SecondaryIndices.size(); ++i)
+	{
+		const SSecondaryIndex& index = SecondaryIndices[i];
+		if (index.field != field)
+			continue;
+
+		std::vector<u32>::const_iterator lower = std::lower_bound(index.keys.begin(), index.keys.end(), key);
+		std::vector<u32>::const_iterator upper = std::upper_bound(lower, index.keys.end(), key);
+		if (lower == upper)
+			return 0;
+
+		rows = &index.rows[lower - index.keys.begin()];
+		return (u32)(upper - lower);
+	}
+
+	ASSERT(false);			//ֶûн
+	return 0;
 }
 
 dbc::record charFacialHairDB::getByParams(unsigned int race, unsigned int gender, unsigned int style) const
@@ -551,11 +676,12 @@ dbc::record charRacesDB::getByName( const c8* name )
 
 dbc::record charSectionsDB::getByParams( u32 race, u32 gender, u32 type, u32 section, u32 color ) const
 {
-	for (u32 i=0; i<nRecords; ++i)
+	const u32* rows;
+	u32 count = findRows(Race, race, rows);
+	for (u32 i=0; i<count; ++i)
 	{
-		dbc::record r = getRecord(i);
-		if (r.getUInt(Race) == race &&
-			r.getUInt(Gender) == gender &&
+		dbc::record r = getRecord(rows[i]);
+		if (r.getUInt(Gender) == gender &&
 			r.getUInt(Type) == type &&
 			r.getUInt(Section) == section &&
 			r.getUInt(Color) == color)					//idrecordĵһֶ
@@ -568,11 +694,12 @@ u32 charSectionsDB::getColorsFor( u32 race, u32 gender, u32 type, u32 section )
 {
 	u32 n = 0;
 
-	for (u32 i=0; i<nRecords; ++i)
+	const u32* rows;
+	u32 count = findRows(Race, race, rows);
+	for (u32 i=0; i<count; ++i)
 	{
-		dbc::record r = getRecord(i);
-		if (r.getUInt(Race) == race &&
-			r.getUInt(Gender) == gender &&
+		dbc::record r = getRecord(rows[i]);
+		if (r.getUInt(Gender) == gender &&
 			r.getUInt(Type) == type &&
 			r.getUInt(Section) == section)
 			++n;
@@ -584,11 +711,12 @@ u32 charSectionsDB::getSectionsFor( u32 race, u32 gender, u32 type, u32 color )
 {
 	u32 n = 0;
 
-	for (u32 i=0; i<nRecords; ++i)
+	const u32* rows;
+	u32 count = findRows(Race, race, rows);
+	for (u32 i=0; i<count; ++i)
 	{
-		dbc::record r = getRecord(i);
-		if (r.getUInt(Race) == race &&
-			r.getUInt(Gender) == gender &&
+		dbc::record r = getRecord(rows[i]);
+		if (r.getUInt(Gender) == gender &&
 			r.getUInt(Type) == type &&
 			r.getUInt(Color) == color)
 				++n;
@@ -939,11 +1067,12 @@ void fileDataDB::saveListFile(const char* szPath)
 
 dbc::record itemDisplayInfoMaterialResDB::getByItemDisplayInfoIDAndSlot(u32 itemDisplayId, u32 slot) const
 {
-	for (u32 i=0; i<nRecords; ++i)
+	const u32* rows;
+	u32 count = findRows(ItemDisplayInfoID, itemDisplayId, rows);
+	for (u32 i=0; i<count; ++i)
 	{
-		dbc::record r = getRecord(i);
-		if(r.getUInt(itemDisplayInfoMaterialResDB::ItemDisplayInfoID) == itemDisplayId &&
-			r.getUInt(itemDisplayInfoMaterialResDB::TextureSlot) == slot)
+		dbc::record r = getRecord(rows[i]);
+		if(r.getUInt(itemDisplayInfoMaterialResDB::TextureSlot) == slot)
 			return r;
 	}
 	return dbc::record::EMPTY();
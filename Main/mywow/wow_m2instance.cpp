@@ -4,6 +4,11 @@
 #include "CImage.h"
 #include "CFileM2.h"
 #include "CBlit.h"
+#include "CM2PoseCache.h"
+
+#ifdef MW_USE_SSE
+#include <xmmintrin.h>
+#endif
 
 const char* regionTextureItemPaths[NUM_REGIONS] =
 {
@@ -116,7 +121,87 @@ bool CharTexture::makeItemTexture(s32 region, u32 gender, const c8* name, c8* ou
 	return false;
 }
 
-ITexture* CharTexture::compose(bool pandaren)
+u64 CharTexture::getRegionHash( s32 region ) const
+{
+	//fnv-1a, ˳, ȺӰ
+	u64 h = 14695981039346656037ULL;
+	for (u32 i=0; i<TexPartCount; ++i)
+	{
+		const CharTexturePart* part = &TextureParts[i];
+		if (part->Region != region)
+			continue;
+
+		for (const c8* p = part->Name; *p; ++p)
+		{
+			h ^= (u8)*p;
+			h *= 1099511628211ULL;
+		}
+		h ^= (u32)part->Layer;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+void CharTexture::blendPart( const CharTexturePart* part, const CharRegionCoords& coords, u32* destData, u32 texWidth, const recti& clip )
+{
+	s32 x0 = max_((s32)coords.xpos, clip.UpperLeftCorner.X);
+	s32 y0 = max_((s32)coords.ypos, clip.UpperLeftCorner.Y);
+	s32 x1 = min_((s32)(coords.xpos + coords.xsize), clip.LowerRightCorner.X);
+	s32 y1 = min_((s32)(coords.ypos + coords.ysize), clip.LowerRightCorner.Y);
+	if (x0 >= x1 || y0 >= y1)
+		return;
+
+#ifdef MW_COMPILE_WITH_GLES2
+#if defined(USE_PVR)
+	string256 path = part->Name;
+	path.changeExt(".blp", ".pvr");
+	IImage* image = g_Engine->getResourceLoader()->loadPVRAsImage(path.c_str());
+#elif defined(USE_KTX)
+	string256 path = part->Name;
+	path.changeExt(".blp", ".ktx");
+	IImage* image = g_Engine->getResourceLoader()->loadKTXAsImage(path.c_str());
+#endif
+#else
+	IImage* image = g_Engine->getResourceLoader()->loadBLPAsImage(part->Name);
+#endif
+
+	if (!image)
+		return;
+
+	const dimension2du& size = image->getDimension();
+	ECOLOR_FORMAT format = image->getColorFormat();
+	const u32* srcData = (const u32*)image->lock();
+	u32* tmpData = NULL_PTR;			//Żʽתʱ
+
+	if (size.Width != coords.xsize || size.Height != coords.ysize)
+	{
+		tmpData = (u32*)Z_AllocateTempMemory(coords.xsize * coords.ysize * sizeof(u32));
+		if (format == ECF_A8R8G8B8 && size.Width <= coords.xsize && size.Height <= coords.ysize && size.Width > 1 && size.Height > 1)
+			CBlit::resizeBilinearA8R8G8B8Fixed(srcData, size.Width, size.Height, tmpData, coords.xsize, coords.ysize, coords.xsize * sizeof(u32));			//
+		else
+			image->copyToScaling(tmpData, coords.xsize, coords.ysize, ECF_A8R8G8B8);
+		srcData = tmpData;
+	}
+	else if (format != ECF_A8R8G8B8)
+	{
+		tmpData = (u32*)Z_AllocateTempMemory(coords.xsize * coords.ysize * sizeof(u32));
+		CBlit::convert_viaFormat(srcData, format, (s32)(coords.xsize * coords.ysize), tmpData, ECF_A8R8G8B8);
+		srcData = tmpData;
+	}
+
+	for (s32 y=y0; y<y1; ++y)
+	{
+		const u32* src = srcData + (y - coords.ypos) * coords.xsize + (x0 - coords.xpos);
+		CBlit::blendA8R8G8B8(src, destData + y * texWidth + x0, (u32)(x1 - x0));
+	}
+
+	if (tmpData)
+		Z_FreeTempMemory(tmpData);
+
+	image->drop();
+}
+
+ITexture* CharTexture::compose(u32 race, u32 gender, bool pandaren, SCharComposeState* state)
 {
 	bool largeScale = pandaren || IsHD;
 
@@ -126,75 +211,92 @@ ITexture* CharTexture::compose(bool pandaren)
 	u32 texWidth = largeScale ? REGION_PX * 2 : REGION_PX;
 	u32 texHeight = REGION_PX;
 
-	u32* destData = (u32*)Z_AllocateTempMemory(texWidth * texHeight * sizeof(u32));
-	memset(destData, 0xff, texWidth * texHeight * sizeof(u32));
+	u64 regionHashes[NUM_REGIONS];
+	for (s32 r=0; r<NUM_REGIONS; ++r)
+		regionHashes[r] = getRegionHash(r);
 
-	for (u32 i=0; i<TexPartCount; ++i)
-	{
-		CharTexturePart* part = &TextureParts[i];
-		const CharRegionCoords coords = largeScale ? pandaren_regions[part->Region] : regions[part->Region];
+	u64 keyParts[3 + NUM_REGIONS] = { race, gender, texWidth };
+	::memcpy(&keyParts[3], regionHashes, sizeof(regionHashes));
 
-#ifdef MW_COMPILE_WITH_GLES2
-#if defined(USE_PVR)
-		string256 path = part->Name;
-		path.changeExt(".blp", ".pvr");
-		IImage* image = g_Engine->getResourceLoader()->loadPVRAsImage(path.c_str());
-#elif defined(USE_KTX)
-		string256 path = part->Name;
-		path.changeExt(".blp", ".ktx");
-		IImage* image = g_Engine->getResourceLoader()->loadKTXAsImage(path.c_str());
-#endif
-#else
-		IImage* image = g_Engine->getResourceLoader()->loadBLPAsImage(part->Name);
-#endif
+	u64 key = 14695981039346656037ULL;
+	for (u32 i=0; i<3 + NUM_REGIONS; ++i)
+	{
+		key ^= keyParts[i];
+		key *= 1099511628211ULL;
+	}
 
-		if(image)
+	//ͬ۵Ľɫһ
+	ITexture* tex = g_Engine->getSpecialTextureServices()->findComposedTexture(key);
+	if (tex)
+	{
+		if (state)			//ϽٶӦ, ´
 		{
-			CImage* srcImage = static_cast<CImage*>(image);
-			CImage* newImage = srcImage;
-			u32* tmpData = NULL_PTR;			//ʱimage
-			bool needScale = srcImage->getDimension().Width != coords.xsize ||
-				srcImage->getDimension().Height != coords.ysize;			//
-
-			if (needScale)
-			{
-				tmpData = (u32*)Z_AllocateTempMemory(coords.xsize * coords.ysize * sizeof(u32));
-				newImage = new CImage(ECF_A8R8G8B8, dimension2du(coords.xsize, coords.ysize), tmpData, false);
-				srcImage->copyToScaling(newImage);
-			}
+			delete[] state->Data;
+			state->Data = NULL_PTR;
+			state->Width = state->Height = 0;
+		}
+		return tex;
+	}
 
-			u32 width = coords.xsize;
-			u32 height = coords.ysize;
+	//㲻ʱֻϱ仯
+	bool incremental = state && state->Data &&
+		state->Width == texWidth && state->Height == texHeight &&
+		state->RegionHashes[CR_BASE] == regionHashes[CR_BASE];
 
-			ASSERT(newImage->getDimension().Width == coords.xsize &&
-				newImage->getDimension().Height == coords.ysize );
+	u32* destData;
+	if (state)
+	{
+		if (!incremental)
+		{
+			delete[] state->Data;
+			state->Data = new u32[texWidth * texHeight];
+			state->Width = texWidth;
+			state->Height = texHeight;
+		}
+		destData = state->Data;
+	}
+	else
+	{
+		destData = (u32*)Z_AllocateTempMemory(texWidth * texHeight * sizeof(u32));
+	}
 
-			u32 srcX, srcY, dstX, dstY;
-			for ( srcY=0, dstY=coords.ypos; srcY<height; ++srcY, ++dstY)
-			{
-				for ( srcX=0, dstX=coords.xpos; srcX<width; ++srcX, ++dstX )
-				{
-					SColor src = newImage->getPixel(srcX, srcY);
-					u32* dst = destData + dstY*texWidth + dstX;
+	if (!incremental)
+	{
+		memset(destData, 0xff, texWidth * texHeight * sizeof(u32));
 
-					SColor d(*dst);
-					d = SColor::interpolate(src, d, 1 - src.getAlpha() / 255.0f, true);
+		recti clip(0, 0, (s32)texWidth, (s32)texHeight);
+		for (u32 i=0; i<TexPartCount; ++i)
+		{
+			CharTexturePart* part = &TextureParts[i];
+			const CharRegionCoords coords = largeScale ? pandaren_regions[part->Region] : regions[part->Region];
+			blendPart(part, coords, destData, texWidth, clip);
+		}
+	}
+	else
+	{
+		for (s32 r=CR_BASE+1; r<NUM_REGIONS; ++r)
+		{
+			if (state->RegionHashes[r] == regionHashes[r])
+				continue;
 
-					*dst = d.color;
-				}
-			}
+			const CharRegionCoords& rc = largeScale ? pandaren_regions[r] : regions[r];
+			recti clip((s32)rc.xpos, (s32)rc.ypos, (s32)(rc.xpos + rc.xsize), (s32)(rc.ypos + rc.ysize));
+			for (u32 y=rc.ypos; y<rc.ypos + rc.ysize; ++y)
+				memset(destData + y * texWidth + rc.xpos, 0xff, rc.xsize * sizeof(u32));
 
-			if (needScale)
+			//ཻĲ㶼Ҫ»
+			for (u32 i=0; i<TexPartCount; ++i)
 			{
-				newImage->drop();
-				Z_FreeTempMemory(tmpData);
+				CharTexturePart* part = &TextureParts[i];
+				const CharRegionCoords coords = largeScale ? pandaren_regions[part->Region] : regions[part->Region];
+				blendPart(part, coords, destData, texWidth, clip);
 			}
-
-			image->drop();
 		}
 	}
 
-	ITexture* tex;
+	if (state)
+		::memcpy(state->RegionHashes, regionHashes, sizeof(regionHashes));
+
 #ifdef MW_COMPILE_WITH_GLES2
 	//gles2ʹòѹ 256X256
 	const u32 len_px = 256;
@@ -221,7 +323,11 @@ ITexture* CharTexture::compose(bool pandaren)
 	}
 #endif
 
-	Z_FreeTempMemory(destData);
+	if (!state)
+		Z_FreeTempMemory(destData);
+
+	if (tex)
+		g_Engine->getSpecialTextureServices()->addComposedTexture(key, tex);
 
 	return tex;
 }
@@ -248,9 +354,22 @@ wow_m2instance::wow_m2instance( IFileM2* m2, bool npc )
 
 	InitializeListHead(&VisibleGeosetList);
 
-	DynBones = new SDynBone[Mesh->NumBones];
-	Calcs = new bool[Mesh->NumBones];
+	OwnBones = new SDynBone[Mesh->NumBones];
+	DynBones = OwnBones;
+	Pose = NULL_PTR;
+	NumPaletteMatrices = 0;
+	BoneLod = EBL_FINE;
+	LerpFromLocals = NULL_PTR;
+	LerpToLocals = NULL_PTR;
+	BoneInterpolation = false;
+	LerpReady = false;
 	BoneHints = new SHint[Mesh->NumBones];
+	BoneEvals = new SBoneEval[Mesh->NumBones];
+	NumBoneEvals = 0;
+	BoneChannels = new u8[Mesh->NumBones];
+	BoneLocalStride = (Mesh->NumBones + 3) & ~3;
+	BoneLocals = new f32[BoneLocalStride * 13];
+	::memset(BoneLocals, 0, sizeof(f32) * BoneLocalStride * 13);
 	UseAttachments = new s8[Mesh->NumAttachments];
 	::memset(UseAttachments, 0, sizeof(s8) * Mesh->NumAttachments);
 
@@ -273,12 +392,20 @@ wow_m2instance::wow_m2instance( IFileM2* m2, bool npc )
 					unit->BoneMats, 
 					(*itr).BoneCount, 
 					set->MaxWeights);
+				unit->PaletteOffset = NumPaletteMatrices;
+				NumPaletteMatrices += (*itr).BoneCount;
 			}
 		}
 
 		ColorHints = new SColorHint[CurrentSkin->NumGeosets];
 		TextureAnimHints = new SHint[CurrentSkin->NumGeosets];
 	}
+
+	//geosets, attachments, flags
+	BoneEvalStateSize = (CurrentSkin ? CurrentSkin->NumGeosets : 0) + Mesh->NumAttachments + 1;
+	BoneEvalState = new u16[BoneEvalStateSize];
+	NewBoneEvalState = new u16[BoneEvalStateSize];
+	::memset(BoneEvalState, 0xff, sizeof(u16) * BoneEvalStateSize);			//һanimateBonesʱ
 	
 	if(Mesh->getType() == MT_CHARACTER && Mesh->isCharacter())
 	{
@@ -296,6 +423,9 @@ wow_m2instance::wow_m2instance( IFileM2* m2, bool npc )
 
 wow_m2instance::~wow_m2instance()
 {
+	if (Pose)
+		CM2PoseCache::release(Pose);
+
 	delete CharacterInfo;
 
 	delete[] ColorHints;
@@ -304,8 +434,14 @@ wow_m2instance::~wow_m2instance()
 
 	delete[] UseAttachments;
 	delete[] BoneHints;
-	delete[] Calcs;
-	delete[] DynBones;
+	delete[] BoneLocals;
+	delete[] NewBoneEvalState;
+	delete[] BoneEvalState;
+	delete[] BoneChannels;
+	delete[] BoneEvals;
+	delete[] LerpToLocals;
+	delete[] LerpFromLocals;
+	delete[] OwnBones;
 
 	for (u32 i=0; i<NUM_TEXTURETYPE; ++i)
 		if(ReplaceTextures[i])
@@ -334,7 +470,8 @@ void wow_m2instance::updateCharacter()
 	dressupCharacter(charTex);
 
 	//
-	setReplaceTexture(TEXTURE_BODY, charTex.compose(CharacterInfo->Race == RACE_PANDAREN));
+	setReplaceTexture(TEXTURE_BODY, charTex.compose(CharacterInfo->Race, CharacterInfo->Gender, CharacterInfo->Race == RACE_PANDAREN,
+		CharacterInfo->IsNpc ? NULL_PTR : &CharacterInfo->ComposeState));
 
 #ifdef MW_EDITOR
 	::memset(CharacterInfo->BodyTextureFileNames, 0, sizeof(CharacterInfo->BodyTextureFileNames));
@@ -348,6 +485,123 @@ void wow_m2instance::updateCharacter()
 	buildVisibleGeosets();
 }
 
+//local: inverse(pivot) * (rot, trans, scale) * pivot, ΪSoAеһ
+#ifdef MW_USE_SSE
+
+static inline void composeBoneMatrices4(const f32* locals, u32 stride, matrix4** mats, u32 count)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	__m128 tx = _mm_loadu_ps(locals);
+	__m128 ty = _mm_loadu_ps(locals + stride);
+	__m128 tz = _mm_loadu_ps(locals + stride*2);
+	__m128 qx = _mm_loadu_ps(locals + stride*3);
+	__m128 qy = _mm_loadu_ps(locals + stride*4);
+	__m128 qz = _mm_loadu_ps(locals + stride*5);
+	__m128 qw = _mm_loadu_ps(locals + stride*6);
+	__m128 sx = _mm_andnot_ps(signMask, _mm_loadu_ps(locals + stride*7));
+	__m128 sy = _mm_andnot_ps(signMask, _mm_loadu_ps(locals + stride*8));
+	__m128 sz = _mm_andnot_ps(signMask, _mm_loadu_ps(locals + stride*9));
+	__m128 px = _mm_loadu_ps(locals + stride*10);
+	__m128 py = _mm_loadu_ps(locals + stride*11);
+	__m128 pz = _mm_loadu_ps(locals + stride*12);
+
+	//quaternion::getMatrix
+	__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+	__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+	__m128 xw = _mm_mul_ps(qx, qw), yw = _mm_mul_ps(qy, qw), zw = _mm_mul_ps(qz, qw);
+
+	//setScale
+	__m128 a00 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+	__m128 a01 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, zw)), sy);
+	__m128 a02 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, yw)), sz);
+	__m128 a10 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, zw)), sx);
+	__m128 a11 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+	__m128 a12 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, xw)), sz);
+	__m128 a20 = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, yw)), sx);
+	__m128 a21 = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, xw)), sy);
+	__m128 a22 = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+
+	//pivot
+	__m128 a30 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(tx, sx), px), 
+		_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, a00), _mm_mul_ps(py, a10)), _mm_mul_ps(pz, a20)));
+	__m128 a31 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(ty, sy), py), 
+		_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, a01), _mm_mul_ps(py, a11)), _mm_mul_ps(pz, a21)));
+	__m128 a32 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(tz, sz), pz), 
+		_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, a02), _mm_mul_ps(py, a12)), _mm_mul_ps(pz, a22)));
+
+	__m128 a03 = _mm_setzero_ps(), a13 = _mm_setzero_ps(), a23 = _mm_setzero_ps(), a33 = one;
+	_MM_TRANSPOSE4_PS(a00, a01, a02, a03);
+	_MM_TRANSPOSE4_PS(a10, a11, a12, a13);
+	_MM_TRANSPOSE4_PS(a20, a21, a22, a23);
+	_MM_TRANSPOSE4_PS(a30, a31, a32, a33);
+
+	__m128 rows[4][4] = 
+	{
+		{ a00, a10, a20, a30 },
+		{ a01, a11, a21, a31 },
+		{ a02, a12, a22, a32 },
+		{ a03, a13, a23, a33 },
+	};
+	for (u32 l=0; l<count; ++l)
+	{
+		f32* m = mats[l]->pointer();
+		_mm_storeu_ps(m, rows[l][0]);
+		_mm_storeu_ps(m + 4, rows[l][1]);
+		_mm_storeu_ps(m + 8, rows[l][2]);
+		_mm_storeu_ps(m + 12, rows[l][3]);
+	}
+}
+
+//m = m * parent
+static inline void mulBoneMatrix(matrix4& m, const matrix4& parent)
+{
+	const f32* p = parent.pointer();
+	__m128 p0 = _mm_loadu_ps(p);
+	__m128 p1 = _mm_loadu_ps(p + 4);
+	__m128 p2 = _mm_loadu_ps(p + 8);
+	__m128 p3 = _mm_loadu_ps(p + 12);
+
+	f32* a = m.pointer();
+	for (u32 r=0; r<4; ++r, a += 4)
+	{
+		__m128 v = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), p0), _mm_mul_ps(_mm_set1_ps(a[1]), p1)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), p2), _mm_mul_ps(_mm_set1_ps(a[3]), p3)));
+		_mm_storeu_ps(a, v);
+	}
+}
+
+#else
+
+static inline void composeBoneMatrix(const f32* locals, u32 stride, matrix4& mat)
+{
+	vector3df t(locals[0], locals[stride], locals[stride*2]);
+	quaternion r(locals[stride*3], locals[stride*4], locals[stride*5], locals[stride*6]);
+	vector3df s(locals[stride*7], locals[stride*8], locals[stride*9]);
+	vector3df pivot(locals[stride*10], locals[stride*11], locals[stride*12]);
+
+	matrix4 global, inverseGlobal;
+	global.setTranslation(pivot);
+	inverseGlobal.setTranslation(-pivot);
+
+	matrix4 m;
+	r.getMatrix(m);
+	m.setTranslation(t);
+	m.setScale(s);
+
+	mat = inverseGlobal * m * global;
+}
+
+static inline void mulBoneMatrix(matrix4& m, const matrix4& parent)
+{
+	m = m * parent;
+}
+
+#endif
+
 void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 blend)
 {
 
@@ -357,13 +611,115 @@ void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 ble
 	if (blend < 0)
 		blend = 1.0f;
 
-	::memset(Calcs, 0, sizeof(bool)*Mesh->NumBones);
+	detachPose();
+
+	bool rebuilt = updateBoneEvalState();
+	if (rebuilt)
+		buildBoneEvals();
+
+	//ֵΪǰʾ̬, ϱ仯ûпõ
+	bool lerp = BoneInterpolation && LerpReady && !rebuilt;
+	if (lerp)
+		::memcpy(LerpFromLocals, BoneLocals, sizeof(f32) * BoneLocalStride * 13);
 
 	if (LastBoneAnim != anim || time < LastBoneTime)			//animıʱᵹʱhint
 		::memset(BoneHints, 0, sizeof(SHint)*Mesh->NumBones);
 	
+	u32 closeFistIndex = CharacterInfo ? Mesh->AnimationLookup[ANIMATION_HANDSCLOSED] : 0;
+	for (u32 k=0; k<NumBoneEvals; ++k)
+	{
+		switch (BoneEvals[k].channel)
+		{
+		case EBC_BLINK:
+			sampleBone(k, 0, lastingtime, blend);
+			break;
+		case EBC_FIST:
+			sampleBone(k, closeFistIndex, 0, blend);
+			break;
+		case EBC_ATTACHMENT:
+			sampleBone(k, 0, time, blend);
+			break;
+		case EBC_INHERIT:				//ֲ任buildBoneEvalsʱΪλ
+			break;
+		default:
+			sampleBone(k, anim, time, blend);
+			break;
+		}
+	}
+
 	AnimatedBox = static_cast<CFileM2*>(Mesh)->getBoundingBox();
 
+	//Χа̬
+	updateBoneMatrices(true);
+
+	if (BoneInterpolation)
+	{
+		::memcpy(LerpToLocals, BoneLocals, sizeof(f32) * BoneLocalStride * 13);
+		if (!lerp)
+			::memcpy(LerpFromLocals, BoneLocals, sizeof(f32) * BoneLocalStride * 13);
+		LerpReady = true;
+
+		if (lerp)
+			interpolateBones(0.0f);
+		else
+			updateBoneUnits();
+	}
+	else
+	{
+		updateBoneUnits();
+	}
+
+	vector3df center = AnimatedBox.getCenter();
+	vector3df ext = AnimatedBox.getExtent();
+	AnimatedBox.set(center - ext * 0.6f, center + ext * 0.6f);
+
+	LastBoneAnim = anim;
+	LastBoneTime = time;
+}
+
+bool wow_m2instance::updateBoneEvalState()
+{
+	u16* state = NewBoneEvalState;
+	::memset(state, 0, sizeof(u16) * BoneEvalStateSize);
+
+	u16 order = 0;
+	for (PLENTRY p = VisibleGeosetList.Flink; p != &VisibleGeosetList; p = p->Flink)
+	{
+		u32 c = (u32)(reinterpret_cast<SDynGeoset*>CONTAINING_RECORD(p, SDynGeoset, Link) - DynGeosets);
+		++order;
+		if (!DynGeosets[c].NoAlpha)
+			state[c] = order;
+	}
+
+	u32 n = CurrentSkin->NumGeosets;
+	for (u32 c=0; c<Mesh->NumAttachments; ++c)
+	{
+#ifdef MW_EDITOR
+		state[n + c] = 1;
+#else
+		state[n + c] = UseAttachments[c] > 0 ? 1 : 0;
+#endif
+	}
+	n += Mesh->NumAttachments;
+
+	state[n] = (ShowParticles ? 1 : 0) | (ShowRibbons ? 2 : 0) | (u16)(BoneLod << 4);
+	if (CharacterInfo)
+		state[n] |= (CharacterInfo->CloseLHand ? 4 : 0) | (CharacterInfo->CloseRHand ? 8 : 0);
+
+	if (::memcmp(state, BoneEvalState, sizeof(u16) * BoneEvalStateSize) == 0)
+		return false;
+
+	NewBoneEvalState = BoneEvalState;
+	BoneEvalState = state;
+	return true;
+}
+
+//ԭݹķ˳ȷÿʹõĶ, ȷʵЧ
+void wow_m2instance::buildBoneEvals()
+{
+	NumBoneEvals = 0;
+	::memset(BoneChannels, EBC_NONE, sizeof(u8) * Mesh->NumBones);
+
 	if (CharacterInfo)
 	{		
 		u32 blinkGeosets[256];
@@ -371,7 +727,6 @@ void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 ble
 		u32 fistGeosets[256];
 		u32 fistGeosetCount = 0;
 
-		u32 closeFistIndex = Mesh->AnimationLookup[ANIMATION_HANDSCLOSED];
 		for (PLENTRY p = VisibleGeosetList.Flink; p != &VisibleGeosetList;)
 		{
 			u32 c = (u32)(reinterpret_cast<SDynGeoset*>CONTAINING_RECORD(p, SDynGeoset, Link) - DynGeosets);
@@ -395,9 +750,6 @@ void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 ble
 			bool isFist = false;
 			for (CGeoset::T_BoneUnits::iterator itr =set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
 			{
-				SDynGeoset::SUnit* unit = &DynGeosets[c].Units[itr->Index];
-				unit->Enable = itr->BoneCount > 0;
-
 				for(u8 k=0; k <(*itr).BoneCount; ++k)
 				{
 					u8 idx = (*itr).local2globalMap[k];
@@ -411,8 +763,7 @@ void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 ble
 					}
 					else
 					{
-						calcBone(idx, anim, time, blend, true, &AnimatedBox);
-						unit->BoneMats[k] = *(const matrix4*)DynBones[idx].mat.pointer();
+						addBoneEval(idx, EBC_ANIM, true, true, true);
 					}		
 				}
 			}
@@ -428,35 +779,20 @@ void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 ble
 		//blink geosets
 		for (u32 i=0; i<blinkGeosetCount; ++i)
 		{
-			u32 c = blinkGeosets[i];
-			CGeoset* set = &CurrentSkin->Geosets[c];
-
+			CGeoset* set = &CurrentSkin->Geosets[blinkGeosets[i]];
 			for (CGeoset::T_BoneUnits::iterator itr =set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
 			{
-				SDynGeoset::SUnit* unit = &DynGeosets[c].Units[itr->Index];
-				unit->Enable = itr->BoneCount > 0;
-
 				for(u8 k=0; k <(*itr).BoneCount; ++k)
-				{
-					u8 idx = (*itr).local2globalMap[k];
-					
-					calcBone(idx, 0, lastingtime, blend, true, &AnimatedBox);
-					unit->BoneMats[k] = *(const matrix4*)DynBones[idx].mat.pointer();
-				}
+					addBoneEval((*itr).local2globalMap[k], EBC_BLINK, true, true, true);
 			}
 		}
 
 		//fist geosets
 		for (u32 i=0; i<fistGeosetCount; ++i)
 		{
-			u32 c = fistGeosets[i];
-			CGeoset* set = &CurrentSkin->Geosets[c];
-
+			CGeoset* set = &CurrentSkin->Geosets[fistGeosets[i]];
 			for (CGeoset::T_BoneUnits::iterator itr =set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
 			{
-				SDynGeoset::SUnit* unit = &DynGeosets[c].Units[itr->Index];
-				unit->Enable = itr->BoneCount > 0;
-
 				for(u8 k=0; k <(*itr).BoneCount; ++k)
 				{
 					u8 idx = (*itr).local2globalMap[k];
@@ -465,8 +801,7 @@ void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 ble
 					if ((CharacterInfo->CloseLHand && b->bonetype == EBT_LEFTHAND) ||
 						(CharacterInfo->CloseRHand && b->bonetype == EBT_RIGHTHAND))
 					{
-						calcBone(idx, closeFistIndex, 0, blend, true, &AnimatedBox);				
-						unit->BoneMats[k] = *(const matrix4*)DynBones[idx].mat.pointer();
+						addBoneEval(idx, EBC_FIST, true, true, true);
 					}
 				}
 			}
@@ -485,31 +820,28 @@ void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 ble
 			CGeoset* set = &CurrentSkin->Geosets[c];
 			for (CGeoset::T_BoneUnits::iterator itr =set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
 			{
-				SDynGeoset::SUnit* unit = &DynGeosets[c].Units[itr->Index];
-				unit->Enable = itr->BoneCount > 0;
-
 				for(u8 k=0; k <(*itr).BoneCount; ++k)
-				{
-					u8 idx = (*itr).local2globalMap[k];
-
-					calcBone(idx, anim, time, blend, true, &AnimatedBox);
-					unit->BoneMats[k] = *(const matrix4*)DynBones[idx].mat.pointer();	
-				}
+					addBoneEval((*itr).local2globalMap[k], EBC_ANIM, true, true, true);
 			}
 		}
 	}
 
-	//attachments
+	//attachments, ҵö0, õǰ
 	for (u32 c=0; c<Mesh->NumAttachments; ++c)
 	{
 		s32 i = Mesh->Attachments[c].boneIndex;
 
 #ifdef MW_EDITOR
-		if (i != -1)
+		if (i != -1 && BoneChannels[i] == EBC_NONE)
 #else
-		if (i != -1 && UseAttachments[c] > 0)
+		if (i != -1 && UseAttachments[c] > 0 && BoneChannels[i] == EBC_NONE)
 #endif
-			calcAttachmentBone(i, anim, time, blend);
+		{
+			s32 parent = Mesh->Bones[i].parent;
+			if (parent != -1)
+				addBoneEval((u8)parent, EBC_ANIM, false, false, false);
+			addBoneEval((u8)i, EBC_ATTACHMENT, false, false, false);
+		}
 	}
 
 	//particles
@@ -519,7 +851,7 @@ void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 ble
 		{
 			s16 i;
 			if((i = Mesh->ParticleSystems[c].boneIndex) != -1)
-				calcBone((u8)i, anim, time, blend, false, &AnimatedBox);
+				addBoneEval((u8)i, EBC_ANIM, false, true, false);
 		}
 	}
 
@@ -530,38 +862,47 @@ void wow_m2instance::animateBones( u32 anim, u32 time,  u32 lastingtime, f32 ble
 		{
 			s16 i;
 			if((i= Mesh->RibbonEmitters[c].boneIndex) != -1)
-				calcBone((u8)i, anim, time, blend, false, &AnimatedBox);
+				addBoneEval((u8)i, EBC_ANIM, false, true, false);
 		}
 	}
 
-	vector3df center = AnimatedBox.getCenter();
-	vector3df ext = AnimatedBox.getExtent();
-	AnimatedBox.set(center - ext * 0.6f, center + ext * 0.6f);
-
-	LastBoneAnim = anim;
-	LastBoneTime = time;
+	for (u32 k=0; k<NumBoneEvals; ++k)
+	{
+		if (BoneEvals[k].channel == EBC_INHERIT)
+			setBoneRest(k);
+	}
 }
 
-void wow_m2instance::calcBone( u8 i, u32 anim, u32 time, f32 blend, bool enableScale, aabbox3df* animatedBox)
+void wow_m2instance::addBoneEval( u8 i, u8 channel, bool scale, bool box, bool lod )
 {
-	if (Calcs[i])
-		return;
-
 	ASSERT(i < Mesh->NumBones);
-	const SModelBone* b = &Mesh->Bones[i];
 
-	// 	{
-	// 		u32 numtrans = b->trans.getNumAnims();
-	// 		u32 numrot = b->rot.getNumAnims();
-	// 		if (numtrans || numrot)
-	// 		{
-	// 			ASSERT(numtrans > anim || numrot > anim);
-	// 		}
-	// 	}
+	//δĸȼ, ֤ǰ
+	//lodʱBoneLodĹ(¶), øı任
+	u8 chain[256];
+	u32 count = 0;
+	for (s32 b = i; b != -1 && BoneChannels[b] == EBC_NONE; b = Mesh->Bones[b].parent)
+	{
+		ASSERT(count < 256);
+		chain[count++] = (u8)b;
+		BoneChannels[b] = (lod && Mesh->Bones[b].lod > BoneLod) ? (u8)EBC_INHERIT : channel;
+	}
 
-	matrix4 global, inverseGlobal;
-	global.setTranslation(b->pivot);
-	inverseGlobal.setTranslation(-b->pivot);
+	while (count > 0)
+	{
+		SBoneEval& e = BoneEvals[NumBoneEvals++];
+		e.bone = chain[--count];
+		e.channel = BoneChannels[e.bone];
+		e.scale = scale;
+		e.box = box;
+	}
+}
+
+void wow_m2instance::sampleBone( u32 k, u32 anim, u32 time, f32 blend )
+{
+	const SBoneEval& e = BoneEvals[k];
+	u8 i = e.bone;
+	const SModelBone* b = &Mesh->Bones[i];
 
 	vector3df t(0,0,0);
 	vector3df s(1,1,1);
@@ -585,7 +926,7 @@ void wow_m2instance::calcBone( u8 i, u32 anim, u32 time, f32 blend, bool enableS
 
 	DynBones[i].rot = r;
 
-	if (enableScale)
+	if (e.scale)
 	{
 		BoneHints[i].scaleHint = b->scale.getValue(anim, time, s, BoneHints[i].scaleHint);
 		bool _scale = BoneHints[i].scaleHint != -1;
@@ -594,38 +935,75 @@ void wow_m2instance::calcBone( u8 i, u32 anim, u32 time, f32 blend, bool enableS
 		DynBones[i].scale = s;
 	}
 
-	matrix4 m;
+	if (b->billboard)			//λ
+	{
+		t.set(0,0,0);
+		s.set(1,1,1);
+		r = quaternion(0,0,0,1);
+	}
 
-	if (!b->billboard)
-	{							//任ǻpivotռ
-		r.getMatrix(m);
-		m.setTranslation(t);
-		m.setScale(s);		
+	f32* p = BoneLocals + k;
+	const u32 stride = BoneLocalStride;
+	p[0] = t.X;	p[stride] = t.Y;	p[stride*2] = t.Z;
+	p[stride*3] = r.X;	p[stride*4] = r.Y;	p[stride*5] = r.Z;	p[stride*6] = r.W;
+	p[stride*7] = s.X;	p[stride*8] = s.Y;	p[stride*9] = s.Z;
+	p[stride*10] = b->pivot.X;	p[stride*11] = b->pivot.Y;	p[stride*12] = b->pivot.Z;
+}
 
-		m = inverseGlobal * m * global;		//pivot
-	}
+void wow_m2instance::setBoneRest( u32 k )
+{
+	u8 i = BoneEvals[k].bone;
+	const SModelBone* b = &Mesh->Bones[i];
 
-	if (b->parent != -1)
+	DynBones[i].trans.set(0,0,0);
+	DynBones[i].scale.set(1,1,1);
+	DynBones[i].rot = quaternion(0,0,0,1);
+
+	f32* p = BoneLocals + k;
+	const u32 stride = BoneLocalStride;
+	p[0] = 0;	p[stride] = 0;	p[stride*2] = 0;
+	p[stride*3] = 0;	p[stride*4] = 0;	p[stride*5] = 0;	p[stride*6] = 1;
+	p[stride*7] = 1;	p[stride*8] = 1;	p[stride*9] = 1;
+	p[stride*10] = b->pivot.X;	p[stride*11] = b->pivot.Y;	p[stride*12] = b->pivot.Z;
+}
+
+void wow_m2instance::updateBoneMatrices( bool updateBox )
+{
+	//local, 任ǻpivotռ
+#ifdef MW_USE_SSE
+	for (u32 k=0; k<NumBoneEvals; k+=4)
 	{
-		calcBone((u8)b->parent, anim, time, blend, enableScale, animatedBox);
+		matrix4* mats[4];
+		u32 count = min_(NumBoneEvals - k, 4u);
+		for (u32 l=0; l<count; ++l)
+			mats[l] = &DynBones[BoneEvals[k+l].bone].mat;
 
-		DynBones[i].mat = m * DynBones[b->parent].mat;
+		composeBoneMatrices4(BoneLocals + k, BoneLocalStride, mats, count);
 	}
-	else
+#else
+	for (u32 k=0; k<NumBoneEvals; ++k)
+		composeBoneMatrix(BoneLocals + k, BoneLocalStride, DynBones[BoneEvals[k].bone].mat);
+#endif
+
+	//global, ǰ
+	for (u32 k=0; k<NumBoneEvals; ++k)
 	{
-		DynBones[i].mat = m;
-	}
+		const SBoneEval& e = BoneEvals[k];
+		u8 i = e.bone;
+		const SModelBone* b = &Mesh->Bones[i];
 
-	DynBones[i].transPivot =b->pivot;
-	DynBones[i].mat.transformVect(DynBones[i].transPivot);
+		if (b->parent != -1)
+			mulBoneMatrix(DynBones[i].mat, DynBones[b->parent].mat);
 
-	if (animatedBox && b->parent != -1)
-		animatedBox->addInternalPoint(DynBones[i].transPivot);
+		DynBones[i].transPivot =b->pivot;
+		DynBones[i].mat.transformVect(DynBones[i].transPivot);
 
-	Calcs[i]= true;
+		if (updateBox && e.box && b->parent != -1)
+			AnimatedBox.addInternalPoint(DynBones[i].transPivot);
+	}
 }
 
-void wow_m2instance::disableBones()
+void wow_m2instance::updateBoneUnits()
 {
 	for (PLENTRY p = VisibleGeosetList.Flink; p != &VisibleGeosetList;)
 	{
@@ -636,78 +1014,99 @@ void wow_m2instance::disableBones()
 			continue;
 
 		CGeoset* set = &CurrentSkin->Geosets[c];
-		for (CGeoset::T_BoneUnits::const_iterator itr =set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
+		for (CGeoset::T_BoneUnits::iterator itr =set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
 		{
 			SDynGeoset::SUnit* unit = &DynGeosets[c].Units[itr->Index];
-			unit->Enable = false;
+			unit->Enable = itr->BoneCount > 0;
+
+			for(u8 k=0; k <(*itr).BoneCount; ++k)
+			{
+				u8 idx = (*itr).local2globalMap[k];
+				unit->BoneMats[k] = DynBones[idx].mat;
+			}
 		}
 	}
 }
 
-void wow_m2instance::calcAttachmentBone( u8 i, u32 anim, u32 time, f32 blend )
+void wow_m2instance::setBoneLod( u32 maxLod )
 {
-	if (Calcs[i])
-		return;
-
-	ASSERT(i < Mesh->NumBones);
-	SModelBone* b = &Mesh->Bones[i];
-
-	matrix4 global, inverseGlobal;
-	global.setTranslation(b->pivot);
-	inverseGlobal.setTranslation(-b->pivot);
-
-	vector3df t(0,0,0);
-	quaternion r(0,0,0,1);
-
-	bool _trans;
-	bool _rot;
-
-	bool soft = blend < 1.0f;
+	BoneLod = min_(maxLod, (u32)EBL_FINE);			//´animateBonesʱؽBoneEvals
+}
 
-	BoneHints[i].transHint = Mesh->Bones[i].trans.getValue(0, time, t, BoneHints[i].transHint);
-	_trans =  BoneHints[i].transHint != -1;
+void wow_m2instance::setBoneInterpolation( bool enable )
+{
+	if (enable && !LerpFromLocals)
+	{
+		LerpFromLocals = new f32[BoneLocalStride * 13];
+		LerpToLocals = new f32[BoneLocalStride * 13];
+	}
 
-	if(soft && _trans)
-		t = vector3df::interpolate(DynBones[i].trans, t, blend);
-	DynBones[i].trans = t;
+	if (BoneInterpolation != enable)
+		LerpReady = false;
+	BoneInterpolation = enable;
+}
 
-	BoneHints[i].rotHint = Mesh->Bones[i].rot.getValue(0, time, r, BoneHints[i].rotHint);
-	_rot = BoneHints[i].rotHint != -1; 
-	if(soft && _rot)
-		r = quaternion::slerp(DynBones[i].rot, r, blend);
+void wow_m2instance::interpolateBones( f32 alpha )
+{
+	//ֻ̬
+	if (!CurrentSkin || !BoneInterpolation || !LerpReady || Pose)
+		return;
 
-	DynBones[i].rot = r;
+	//ֱӲֵתеĹС, ֲֵtrans, scale, rotnlerp, ϲز㼶
+	alpha = clamp_(alpha, 0.0f, 1.0f);
+	const u32 stride = BoneLocalStride;
+	for (u32 k=0; k<NumBoneEvals; ++k)
+	{
+		const f32* a = LerpFromLocals + k;
+		const f32* b = LerpToLocals + k;
+		f32* p = BoneLocals + k;
 
-	matrix4 m;
+		for (u32 c=0; c<3; ++c)
+		{
+			p[stride*c] = a[stride*c] + (b[stride*c] - a[stride*c]) * alpha;					//trans
+			p[stride*(c+7)] = a[stride*(c+7)] + (b[stride*(c+7)] - a[stride*(c+7)]) * alpha;	//scale
+		}
 
-	if (b->billboard)
-	{
-		//ASSERT(!_rot && !_trans && !_scale);
-		//m = (*billboardRot);
+		f32 dot = a[stride*3] * b[stride*3] + a[stride*4] * b[stride*4] + a[stride*5] * b[stride*5] + a[stride*6] * b[stride*6];
+		f32 sign = dot < 0.0f ? -alpha : alpha;				//߶̵һ
+		f32 len = 0.0f;
+		for (u32 c=3; c<7; ++c)
+		{
+			p[stride*c] = a[stride*c] * (1.0f - alpha) + b[stride*c] * sign;
+			len += p[stride*c] * p[stride*c];
+		}
+		if (len > 0.0f)
+		{
+			f32 inv = reciprocal_squareroot_(len);
+			for (u32 c=3; c<7; ++c)
+				p[stride*c] *= inv;
+		}
 	}
-	else
-	{							//任ǻpivotռ
-		r.getMatrix(m);
-		m.setTranslation(t);		
 
-		m = inverseGlobal * m * global;		//pivot
-	}
+	updateBoneMatrices(false);
+	updateBoneUnits();
+}
 
-	if (b->parent != -1)
-	{
-		calcBone((u8)b->parent, anim, time, blend, false, NULL_PTR);
+void wow_m2instance::disableBones()
+{
+	detachPose();
+	LerpReady = false;
 
-		DynBones[i].mat = m * DynBones[b->parent].mat;
-	}
-	else
+	for (PLENTRY p = VisibleGeosetList.Flink; p != &VisibleGeosetList;)
 	{
-		DynBones[i].mat = m;
-	}
+		u32 c = (u32)(reinterpret_cast<SDynGeoset*>CONTAINING_RECORD(p, SDynGeoset, Link) - DynGeosets);
+		p = p->Flink;
 
-	DynBones[i].transPivot =b->pivot;
-	DynBones[i].mat.transformVect(DynBones[i].transPivot);
+		if (DynGeosets[c].NoAlpha)
+			continue;
 
-	Calcs[i]= true;
+		CGeoset* set = &CurrentSkin->Geosets[c];
+		for (CGeoset::T_BoneUnits::const_iterator itr =set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
+		{
+			SDynGeoset::SUnit* unit = &DynGeosets[c].Units[itr->Index];
+			unit->Enable = false;
+		}
+	}
 }
 
 void wow_m2instance::animateColors(u32 anim, u32 time)
@@ -878,6 +1277,153 @@ void wow_m2instance::calcTextureAnim( u32 c, u32 anim, u32 time )
 	DynGeosets[c].TextureMatrix = mat;
 }
 
+void wow_m2instance::animateShared( CM2PoseCache* cache, u32 anim, u32 time, u32 lastingtime )
+{
+	if (!CurrentSkin)
+		return;
+
+	time -= time % CM2PoseCache::TIME_QUANTUM;
+	lastingtime -= lastingtime % CM2PoseCache::TIME_QUANTUM;
+
+	SM2PoseKey key;
+	key.mesh = Mesh;
+	key.skin = CurrentSkin;
+	key.anim = anim;
+	key.time = time;
+	key.lastingTime = lastingtime;
+	key.stateHash = getPoseStateHash();
+
+	if (Pose && Pose->Key == key)
+		return;
+
+	bool build;
+	SM2Pose* pose = cache->acquire(key, Mesh->NumBones, NumPaletteMatrices, CurrentSkin->NumGeosets, build);
+
+	//ûֳɵ̬ʱ˽ϼ, ٿ̬
+	if (!pose || build)
+	{
+		animateColors(anim, time);
+		animateBones(anim, time, lastingtime, 1.0f);
+		animateTextures(0, lastingtime);
+	}
+
+	if (!pose)
+		return;
+
+	if (build)
+	{
+		storePose(pose);
+		cache->publish(pose);
+	}
+
+	attachPose(pose);
+}
+
+u32 wow_m2instance::getPoseStateHash() const
+{
+	u32 h = 2166136261u;
+	for (PLENTRY p = VisibleGeosetList.Flink; p != &VisibleGeosetList; p = p->Flink)
+	{
+		u32 c = (u32)(reinterpret_cast<SDynGeoset*>CONTAINING_RECORD(p, SDynGeoset, Link) - DynGeosets);
+		h = (h ^ c) * 16777619u;
+	}
+
+	for (u32 c=0; c<Mesh->NumAttachments; ++c)
+		h = (h ^ (u8)UseAttachments[c]) * 16777619u;
+
+	h = (h ^ ((ShowParticles ? 1 : 0) | (ShowRibbons ? 2 : 0) | (BoneLod << 4))) * 16777619u;
+	return h;
+}
+
+void wow_m2instance::storePose( SM2Pose* pose ) const
+{
+	for (u32 i=0; i<Mesh->NumBones; ++i)
+		pose->Bones[i] = DynBones[i];
+
+	pose->AnimatedBox = AnimatedBox;
+
+	for (PLENTRY p = VisibleGeosetList.Flink; p != &VisibleGeosetList; p = p->Flink)
+	{
+		const SDynGeoset* geoset = reinterpret_cast<SDynGeoset*>CONTAINING_RECORD(p, SDynGeoset, Link);
+		u32 c = (u32)(geoset - DynGeosets);
+
+		SM2PoseGeoset* dst = &pose->Geosets[c];
+		dst->TextureMatrix = geoset->TextureMatrix;
+		dst->emissive = geoset->emissive;
+		dst->NoAlpha = geoset->NoAlpha;
+		dst->UseTextureAnim = geoset->UseTextureAnim;
+
+		if (geoset->NoAlpha)
+			continue;
+
+		CGeoset* set = &CurrentSkin->Geosets[c];
+		for (CGeoset::T_BoneUnits::const_iterator itr =set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
+		{
+			const SDynGeoset::SUnit* unit = &geoset->Units[itr->Index];
+			::memcpy(pose->Palettes + unit->PaletteOffset, unit->BoneMats, sizeof(matrix4) * (*itr).BoneCount);
+		}
+	}
+}
+
+void wow_m2instance::attachPose( SM2Pose* pose )
+{
+	if (Pose)
+		CM2PoseCache::release(Pose);
+	Pose = pose;
+
+	DynBones = pose->Bones;
+	AnimatedBox = pose->AnimatedBox;
+
+	for (PLENTRY p = VisibleGeosetList.Flink; p != &VisibleGeosetList; p = p->Flink)
+	{
+		SDynGeoset* geoset = reinterpret_cast<SDynGeoset*>CONTAINING_RECORD(p, SDynGeoset, Link);
+		u32 c = (u32)(geoset - DynGeosets);
+
+		const SM2PoseGeoset* src = &pose->Geosets[c];
+		geoset->TextureMatrix = src->TextureMatrix;
+		geoset->emissive = src->emissive;
+		geoset->NoAlpha = src->NoAlpha;
+		geoset->UseTextureAnim = src->UseTextureAnim;
+
+		if (geoset->NoAlpha)
+			continue;
+
+		CGeoset* set = &CurrentSkin->Geosets[c];
+		for (CGeoset::T_BoneUnits::const_iterator itr =set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
+		{
+			SDynGeoset::SUnit* unit = &geoset->Units[itr->Index];
+			unit->Enable = itr->BoneCount > 0;
+			unit->BoneMatrixArray->matrices = pose->Palettes + unit->PaletteOffset;
+		}
+	}
+
+	//˽ѹ, ´˽мʱؽhint
+	LastBoneAnim = LastColorAnim = LastTextureAnim = -1;
+}
+
+void wow_m2instance::detachPose()
+{
+	if (!Pose)
+		return;
+
+	//̬ľֲ任, ֮Ķϴ￪ʼ
+	for (u32 i=0; i<Mesh->NumBones; ++i)
+		OwnBones[i] = Pose->Bones[i];
+	DynBones = OwnBones;
+
+	for (u32 c=0; c<CurrentSkin->NumGeosets; ++c)
+	{
+		for (u32 i=0; i<DynGeosets[c].NumUnits; ++i)
+		{
+			SDynGeoset::SUnit* unit = &DynGeosets[c].Units[i];
+			unit->BoneMatrixArray->matrices = unit->BoneMats;
+		}
+	}
+
+	CM2PoseCache::release(Pose);
+	Pose = NULL_PTR;
+}
+
 void wow_m2instance::updateEquipments( s32 slot, s32 itemid )
 {
 	ASSERT(slot >= 0 && slot < NUM_CHAR_SLOTS);
@@ -1021,11 +1567,11 @@ bool wow_m2instance::updateNpc(s32 npcid)
 
 #ifdef WOW70
 		const npcModelItemSlotDisplayInfoDB* npcItemDB = g_Engine->getWowDatabase()->getNpcModelItemSlotDisplayInfoDB();
-		for(u32 i= 0; i < npcItemDB->getNumRecords(); ++i)
+		const u32* rows;
+		u32 count = npcItemDB->findRows(npcModelItemSlotDisplayInfoDB::NPCExtraID, npcId, rows);
+		for(u32 i= 0; i < count; ++i)
 		{
-			dbc::record rItem = npcItemDB->getRecord(i);
-			if(npcId != rItem.getUInt(npcModelItemSlotDisplayInfoDB::NPCExtraID))
-				continue;
+			dbc::record rItem = npcItemDB->getRecord(rows[i]);
 
 			u32 itemDisplayID = rItem.getUInt(npcModelItemSlotDisplayInfoDB::ItemDisplayInfoID);
 			u32 itemType = rItem.getUInt(npcModelItemSlotDisplayInfoDB::ItemType);
@@ -28,10 +28,17 @@ wow_tileScene::wow_tileScene( CMapTileSceneNode* mapTileNode ) : TileSceneNode(m
 
 	WmoInstVisible = new bool[numWmoInstance];
 	memset(WmoInstVisible, 0, sizeof(bool) * numWmoInstance);
+
+	M2BVHDirty = WmoBVHDirty = true;
+
+	//ײ, ʵڼغ
+	g_Engine->getCollisionServices()->addTile(TileSceneNode->Block.tile->fileAdt, TileSceneNode->getAbsoluteTransformation());
 }
 
 wow_tileScene::~wow_tileScene()
 {
+	g_Engine->getResourceLoader()->cancelTasks(TileSceneNode);
+
 	delete[] WmoInstVisible;
 	delete[] WmoInstSceneNodes;
 
@@ -74,6 +81,7 @@ void wow_tileScene::addM2SceneNodes()
 		mat.setScale(inst->scale);
 		mat.setTranslation(inst->position);
 		m2SceneNode->setRelativeTransformation(mat);	
+		g_Engine->getCollisionServices()->addM2Instance(adt, m2, mat);
 		m2SceneNode->update(true);
 		m2SceneNode->buildVisibleGeosets();
 		m2SceneNode->RenderInstType = ERT_DOODAD;
@@ -111,9 +119,11 @@ void wow_tileScene::addWMOSceneNodes()
 		mat.setScale(inst->scale);
 		mat.setTranslation(inst->pos);
 		wmoSceneNode->setRelativeTransformation(mat);
+		g_Engine->getCollisionServices()->addWMOInstance(adt, wmo, mat);
 		wmoSceneNode->enableFog(true);
 
 		WmoInstSceneNodes[i].node = wmoSceneNode;
+		WmoBVHDirty = true;
 	}	
 
 }
@@ -123,16 +133,20 @@ void wow_tileScene::startLoadingM2SceneNodes()
 	CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
 
 	IResourceLoader* resourceLoader = g_Engine->getResourceLoader();
+	const matrix4& tileMat = TileSceneNode->getAbsoluteTransformation();
 	for (u32 i=0; i<adt->NumM2Instance; ++i)
 	{
 		const IFileADT::SM2Instance* instInfo = adt->getM2Instance(i);
 		u32 index = instInfo->m2Index;
 
+		vector3df pos = instInfo->position;
+		tileMat.transformVect(pos);
+
 		const c8* filename = adt->getM2FileName(index);
 		IResourceLoader::SParamBlock block = {0};
 		block.param1 = TileSceneNode;
 		block.param2 = (void*)(ptr_t)i;
-		resourceLoader->beginLoadM2(filename, block);
+		resourceLoader->beginLoadM2(filename, block, &pos);
 	}
 }
 
@@ -141,16 +155,20 @@ void wow_tileScene::startLoadingWMOSceneNodes()
 	CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
 
 	IResourceLoader* resourceLoader = g_Engine->getResourceLoader();
+	const matrix4& tileMat = TileSceneNode->getAbsoluteTransformation();
 	for (u32 i=0; i<adt->NumWmoInstance; ++i)
 	{
 		const IFileADT::SWmoInstance* instInfo = adt->getWMOInstance(i);
 		u32 index = instInfo->wmoIndex;
 
+		vector3df pos = instInfo->pos;
+		tileMat.transformVect(pos);
+
 		const c8* filename = adt->getWMOFileName(index);
 		IResourceLoader::SParamBlock block = {0};
 		block.param1 = TileSceneNode;
 		block.param2 = (void*)(ptr_t)i;
-		resourceLoader->beginLoadWMO(filename, block);
+		resourceLoader->beginLoadWMO(filename, block, &pos);
 	}
 }
 
@@ -190,113 +208,130 @@ void wow_tileScene::update( )
 
 void wow_tileScene::registerInstances( ICamera* cam )
 {
+	const matrix4& tileMat = TileSceneNode->getAbsoluteTransformation();
+	if (tileMat != BVHTileMat)
+	{
+		BVHTileMat = tileMat;
+		M2BVHDirty = WmoBVHDirty = true;
+	}
+
 	registerVisibleM2Instances(cam);
 
 	registerVisibleWmoInstances(cam);
 }
 
-void wow_tileScene::registerVisibleM2Instances( ICamera* cam )
+void wow_tileScene::fillCullParam( ICamera* cam, CInstanceBVH::SCullParam& param ) const
 {
-	CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
+	//Ҫnear, farж
 	frustum f = cam->getViewFrustum();
+	param.planes[0] = cam->getTerrainClipPlane();
+	param.planes[1] = f.getPlane(VF_LEFT_PLANE);
+	param.planes[2] = f.getPlane(VF_RIGHT_PLANE);
+	param.planes[3] = f.getPlane(VF_TOP_PLANE);
+	param.planes[4] = f.getPlane(VF_BOTTOM_PLANE);
+	param.numPlanes = 5;
+	param.camPos = cam->getPosition();
+	param.visibleDistance = 0.0f;
+	param.alphaDistance = 0.0f;
+}
+
+void wow_tileScene::rebuildM2BVH()
+{
+	CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
+
+	M2BVH.clear();
+	for (u32 i=0; i<adt->NumM2Instance; ++i)
+	{
+		IM2SceneNode* node = M2InstSceneNodes[i].node;
+		if (node)
+			M2BVH.addInstance(i, node->getWorldBoundingAABox(), M2InstSceneNodes[i].radius);
+	}
+	M2BVH.build();
+
+	M2BVHDirty = false;
+}
+
+void wow_tileScene::rebuildWmoBVH()
+{
+	CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
+
+	WmoBVH.clear();
+	for (u32 i=0; i<adt->NumWmoInstance; ++i)
+	{
+		IWMOSceneNode* node = WmoInstSceneNodes[i].node;
+		if (node)
+			WmoBVH.addInstance(i, node->getWorldBoundingBox(), 1.0f);
+	}
+	WmoBVH.build();
+
+	WmoBVHDirty = false;
+}
 
-	f32 objectVisibleDistance = g_Engine->getSceneRenderServices()->getObjectVisibleDistance();
-	f32 objectAlphaDistance = g_Engine->getSceneRenderServices()->getObjectAlphaDistance();
+void wow_tileScene::registerVisibleM2Instances( ICamera* cam )
+{
+	CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
 
 	//жϿɼ
 	memset(M2InstVisible, 0, sizeof(bool) * adt->NumM2Instance);
 
-	plane3df clipPlane = cam->getTerrainClipPlane();
+	if (M2BVHDirty)
+		rebuildM2BVH();
+
+	CInstanceBVH::SCullParam param;
+	fillCullParam(cam, param);
+	param.visibleDistance = g_Engine->getSceneRenderServices()->getObjectVisibleDistance();
+	param.alphaDistance = g_Engine->getSceneRenderServices()->getObjectAlphaDistance();
 
-	for (u8 i=0; i<16; ++i)
+	CullResults.resize(M2BVH.getNumInstances() + 1);
+	u32 numVisible = M2BVH.cull(param, &CullResults[0]);
+
+	for (u32 i=0; i<numVisible; ++i)
 	{
-		for (u8 j=0; j<16; ++j)
-		{
-			CMapTileSceneNode::SDynChunk* dynChunk = &TileSceneNode->Block.DynChunks[i][j];
-
-			aabbox3df boxChunk = dynChunk->terrianWorldBox;
-			boxChunk.MaxEdge.Y = FLT_MAX;
-			if (!f.isInFrustum(boxChunk))
-				continue;
-
-			//С
-			T_InstanceList& littleM2Instances = ChunkM2List[i][j].m2InstList;
-			for (T_InstanceList::const_iterator itr=littleM2Instances.begin(); itr != littleM2Instances.end(); ++itr)
-			{
-				u32 idx = *itr;
-				IM2SceneNode* node = M2InstSceneNodes[idx].node;
-				if (!node || M2InstVisible[idx])		//Ѿɼж
-					continue;
-
-				aabbox3df box = node->getWorldBoundingAABox();
-
-				vector3df center = box.getCenter();
-				f32 radius = M2InstSceneNodes[idx].radius;
-				if (radius == 0.0f)
-					continue;
-
-				f32 distance = cam->getPosition().getDistanceFrom(center) / radius;
-				if(distance > objectVisibleDistance)			//Զ
-					continue;
-
-				//Ҫclipplaneж
-				if (ISREL3D_BACK == box.classifyPlaneRelation(clipPlane) ||
-					ISREL3D_BACK == box.classifyPlaneRelation(f.getPlane(VF_LEFT_PLANE)) ||
-					ISREL3D_BACK == box.classifyPlaneRelation(f.getPlane(VF_RIGHT_PLANE)) ||
-					ISREL3D_BACK == box.classifyPlaneRelation(f.getPlane(VF_TOP_PLANE)) ||
-					ISREL3D_BACK == box.classifyPlaneRelation(f.getPlane(VF_BOTTOM_PLANE)) )
-					continue;
-
-				f32 delta = distance - objectAlphaDistance;
-				if (delta > 0)
-					node->setModelAlpha(true, 1.0f - delta / (objectVisibleDistance - objectAlphaDistance));
-				else
-					node->setModelAlpha(false, 1.0f);
-
-				node->Visible = true;
-				node->registerSceneNode(false, false);
-
-				M2InstVisible[idx] = true;
-			}
-		}
+		const CInstanceBVH::SCullResult& result = CullResults[i];
+		IM2SceneNode* node = M2InstSceneNodes[result.id].node;
+
+		if (result.alpha < 1.0f)
+			node->setModelAlpha(true, result.alpha);
+		else
+			node->setModelAlpha(false, 1.0f);
+
+		node->Visible = true;
+		node->registerSceneNode(false, false);
+
+		M2InstVisible[result.id] = true;
 	}
 }
 
 void wow_tileScene::registerVisibleWmoInstances( ICamera* cam )
 {
 	CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
-	frustum f = cam->getViewFrustum();
 
 	//жϿɼ
 	memset(WmoInstVisible, 0, sizeof(bool) * adt->NumWmoInstance);
 
-	plane3df clipPlane = cam->getTerrainClipPlane();
+	if (WmoBVHDirty)
+		rebuildWmoBVH();
 
-	for (u32 i=0; i<adt->NumWmoInstance; ++i)
-	{
-		IWMOSceneNode* node = WmoInstSceneNodes[i].node;
-		if (!node)
-			continue;
+	CInstanceBVH::SCullParam param;
+	fillCullParam(cam, param);
 
-		aabbox3df box = node->getWorldBoundingBox();
+	CullResults.resize(WmoBVH.getNumInstances() + 1);
+	u32 numVisible = WmoBVH.cull(param, &CullResults[0]);
 
-		if (ISREL3D_BACK == box.classifyPlaneRelation(clipPlane) ||
-			ISREL3D_BACK == box.classifyPlaneRelation(f.getPlane(VF_LEFT_PLANE)) ||
-			ISREL3D_BACK == box.classifyPlaneRelation(f.getPlane(VF_RIGHT_PLANE)) ||
-			ISREL3D_BACK == box.classifyPlaneRelation(f.getPlane(VF_TOP_PLANE)) ||
-			ISREL3D_BACK == box.classifyPlaneRelation(f.getPlane(VF_BOTTOM_PLANE)) )
-			continue;
+	for (u32 i=0; i<numVisible; ++i)
+	{
+		u32 idx = CullResults[i].id;
+		IWMOSceneNode* node = WmoInstSceneNodes[idx].node;
 
 		node->Visible = true;
 		node->registerSceneNode(false, false);
 
-		WmoInstVisible[i] = true;
+		WmoInstVisible[idx] = true;
 	}
 }
 
 void wow_tileScene::classifyM2Instance( u32 index, const matrix4& instMat )
 {
-	CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
 	SDynM2Inst* m2Inst = &M2InstSceneNodes[index];
 	const CFileM2* m2 = static_cast<const CFileM2*>(m2Inst->node->getFileM2());
 
@@ -306,36 +341,19 @@ void wow_tileScene::classifyM2Instance( u32 index, const matrix4& instMat )
 	vector3df ext = b.getExtent();
 	m2Inst->radius = (ext.X + ext.Y + ext.Z) / 3;
 
-	rectf rcM2(b.MinEdge.X, b.MinEdge.Z, b.MaxEdge.X, b.MaxEdge.Z);
-
-	for (u32 i=0; i<16; ++i)
-	{
-		for (u32 j=0; j<16; ++j)
-		{
-			aabbox3df box = adt->getChunk(i,j)->box;
-			rectf rc(box.MinEdge.X, box.MinEdge.Z, box.MaxEdge.X, box.MaxEdge.Z);
-			if (rcM2.intersectsWithRect(rc))
-			{
-				ChunkM2List[i][j].m2InstList.push_back(index);
-			}
-		}
-	}
+	M2BVHDirty = true;
 }
 
 void wow_tileScene::processResources()
 {
 	IResourceLoader* loader = g_Engine->getResourceLoader();
-	if(loader->m2LoadCompleted())
+	IResourceLoader::STask task;
+
+	//ȡtileɵ, ֱ֡Ԥ
+	while (loader->popCompletedTask(IResourceLoader::ET_M2, TileSceneNode, task))
 	{
-		IResourceLoader::STask task = loader->getCurrentTask();
-		ASSERT(task.type == IResourceLoader::ET_M2);
 		IFileM2* filem2 = (IFileM2*)task.file;
-		if(!filem2 || TileSceneNode != (IMapTileSceneNode*)task.param.param1)		//Ҫm2
-			return;
 		u32 index = PTR_TO_UINT32(task.param.param2);
-		
-		loader->clearCurrentTask();
-		loader->resumeLoading();
 
 		CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
 		IM2SceneNode* m2SceneNode =g_Engine->getSceneManager()->addM2SceneNode(filem2, TileSceneNode);
@@ -345,6 +363,7 @@ void wow_tileScene::processResources()
 		mat.setScale(inst->scale);
 		mat.setTranslation(inst->position);
 		m2SceneNode->setRelativeTransformation(mat);
+		g_Engine->getCollisionServices()->addM2Instance(adt, filem2, mat);
 		m2SceneNode->update(true);
 		m2SceneNode->buildVisibleGeosets();
 		m2SceneNode->RenderInstType = ERT_DOODAD;
@@ -354,20 +373,15 @@ void wow_tileScene::processResources()
 		M2InstSceneNodes[index].node = m2SceneNode;
 
 		classifyM2Instance(index, mat);
+
+		loader->finishCompletedTask();
 	}
 
-	if (loader->wmoLoadCompleted())
+	while (loader->popCompletedTask(IResourceLoader::ET_WMO, TileSceneNode, task))
 	{
-		IResourceLoader::STask task = loader->getCurrentTask();
-		ASSERT(task.type == IResourceLoader::ET_WMO);
 		IFileWMO* filewmo = (IFileWMO*)task.file;
-		if(!filewmo || TileSceneNode != (IMapTileSceneNode*)task.param.param1)		//Ҫm2
-			return;
 		u32 index = PTR_TO_UINT32(task.param.param2);
 
-		loader->clearCurrentTask();
-		loader->resumeLoading();
-
 		CFileADT* adt = static_cast<CFileADT*>(TileSceneNode->Block.tile->fileAdt);
 		IWMOSceneNode* wmoSceneNode =g_Engine->getSceneManager()->addWMOSceneNode(filewmo, TileSceneNode);
 		const IFileADT::SWmoInstance* inst =adt->getWMOInstance(index);
@@ -375,8 +389,12 @@ void wow_tileScene::processResources()
 		mat.setRotationDegrees(inst->dir);
 		mat.setTranslation(inst->pos);
 		wmoSceneNode->setRelativeTransformation(mat);
+		g_Engine->getCollisionServices()->addWMOInstance(adt, filewmo, mat);
 
 		WmoInstSceneNodes[index].node = wmoSceneNode;
+		WmoBVHDirty = true;
+
+		loader->finishCompletedTask();
 	}
 }
 
@@ -4,7 +4,11 @@
 #include "CWDTSceneNode.h"
 #include "CFileWDT.h"
 
-#define TIME_DELAY_TILE_CHANGED		5		//tileı󣬸֡ʼµļ
+#define PREDICT_TIME			2.0f				//ٶԤλ
+#define PREDICT_MAX_DISTANCE	(TILESIZE * 2)		//Ԥ
+#define TELEPORT_DISTANCE		(TILESIZE)			//һ֡ƶ뵱, ٶ
+#define RESIDENT_HYSTERESIS		1					//뿪طΧtileж
+#define RESIDENT_EXTRA_TILES	16					//طΧפtile
 
 wow_wdtScene::wow_wdtScene( CWDTSceneNode* wdtNode )
 	: WdtSceneNode(wdtNode)
@@ -12,13 +16,14 @@ wow_wdtScene::wow_wdtScene( CWDTSceneNode* wdtNode )
 	FileWDT = WdtSceneNode->FileWDT;
 
 	Row = Col = -1;
+	PredictRow = PredictCol = -1;
+
+	CamVelocity.set(0,0,0);
+	HasLastCamPos = false;
 
 	CamChunk = LastCamChunk = NULL_PTR;
 
 	AdtLoadSize = g_Engine->getSceneRenderServices()->getAdtLoadSize();
-
-	TileChangeTick = 0;
-	TileChanging = false;
 }
 
 wow_wdtScene::~wow_wdtScene()
@@ -37,55 +42,65 @@ wow_wdtScene::~wow_wdtScene()
 
 void wow_wdtScene::setCurrentTile( s32 row, s32 col )
 {
-	Row = row;
-	Col = col;
+	Row = PredictRow = row;
+	Col = PredictCol = col;
+
+	//ʱٶ
+	CamVelocity.set(0,0,0);
+	HasLastCamPos = false;
 
 	recalculateTilesNeeded(Row, Col);
 
-	g_Engine->getResourceLoader()->cancelAll(IResourceLoader::ET_ADT);
+	//ͬ, ѼغͼеtileפΧ, requestTilesȡ
+	unloadOutBlocks();
 
-	for (T_TileMap::const_iterator itr = TilesMap.begin(); itr != TilesMap.end(); ++itr)
-	{
-		if (!itr->second)			//loading
-			continue;
+	updateBlocks();
 
-		STile* tile = itr->first;
-		FileWDT->unloadADT(tile);
-	}
+	requestTiles();
+}
 
-	TilesMap.clear();
+void wow_wdtScene::startLoadADT( STile* tile, f32 distance )
+{
+	if (!tile || tile->fileAdt)
+		return;
 
-	u32 num = getNumBlocks();
-	for (u32 i=0; i<num; ++i)
+	IResourceLoader* loader = g_Engine->getResourceLoader();
+	if (isLoading(tile))
 	{
-		u8 r = (u8)Coords[i].X;
-		u8 c = (u8)Coords[i].Y;
-		STile* newTile = FileWDT->getTile(r,c);
-		WdtSceneNode->MapBlocks[i].tile = newTile;
-		if (newTile && !newTile->fileAdt && !isLoading(newTile))
+		//tileǰλøȼ
+		if (loader->isMultiThread())
 		{
-			bool success = FileWDT->loadADT(newTile);
-			ASSERT(success);
-			TilesMap[newTile] = true;
+			loader->setTaskPriority(WdtSceneNode, tile, distance);
+		}
+		else
+		{
+			for (u32 i=0; i<(u32)SyncQueue.size(); ++i)
+			{
+				if (SyncQueue[i].tile == tile)
+					SyncQueue[i].priority = distance;
+			}
 		}
-
-		WdtSceneNode->updateMapBlock(i);
-	}
-}
-
-void wow_wdtScene::startLoadADT( STile* tile )
-{
-	if (!tile || tile->fileAdt)
 		return;
+	}
 
-	c8 adtname[QMAX_PATH];
-	FileWDT->getADTFileName(tile->row, tile->col, adtname, QMAX_PATH);
+	if (!loader->isMultiThread())
+	{
+		SSyncEntry entry;
+		entry.tile = tile;
+		entry.priority = distance;
+		SyncQueue.push_back(entry);
+	}
+	else
+	{
+		c8 adtname[QMAX_PATH];
+		FileWDT->getADTFileName(tile->row, tile->col, adtname, QMAX_PATH);
 
-	IResourceLoader::SParamBlock block = {0};
-	block.param1 = WdtSceneNode;
-	block.param2 = tile;
+		IResourceLoader::SParamBlock block = {0};
+		block.param1 = WdtSceneNode;
+		block.param2 = tile;
 
-	g_Engine->getResourceLoader()->beginLoadADT(adtname, block);
+		loader->beginLoadADT(adtname, block, distance);
+	}
 
 	TilesMap[tile] = false;
 }
@@ -93,19 +108,17 @@ void wow_wdtScene::startLoadADT( STile* tile )
 bool wow_wdtScene::processADT()
 {
 	IResourceLoader* loader = g_Engine->getResourceLoader();
-	if(loader->adtLoadCompleted())
-	{
-		IResourceLoader::STask task = loader->getCurrentTask();
-		ASSERT(task.type == IResourceLoader::ET_ADT);
+	if (!loader->isMultiThread())
+		return processSyncQueue();
 
+	IResourceLoader::STask task;
+
+	bool processed = false;
+	while (loader->popCompletedTask(IResourceLoader::ET_ADT, WdtSceneNode, task))
+	{
 		IFileADT* fileadt = (IFileADT*)task.file;
-		if(WdtSceneNode != (IWDTSceneNode*)task.param.param1)		//Ҫadt
-			return false;
 		STile* tile = (STile*)task.param.param2;
 
-		//process
-		loader->clearCurrentTask();
-
 		ASSERT(!tile->fileAdt);
 
 		fileadt->SetPosition(tile->row, tile->col);
@@ -113,65 +126,193 @@ bool wow_wdtScene::processADT()
 
 		tile->fileAdt->buildVideoResources();			//ȽԴԴ
 		
-		loader->resumeLoading();
-		
 		//
 		updateTileTransform(tile);
 
-		return true;
+		loader->finishCompletedTask();
+		processed = true;
 	}
 
-	return false;
+	return processed;
+}
+
+bool wow_wdtScene::processSyncQueue()
+{
+	if (SyncQueue.empty())
+		return false;
+
+	//ÿֻ֡һ
+	u32 best = 0;
+	for (u32 i=1; i<(u32)SyncQueue.size(); ++i)
+	{
+		if (SyncQueue[i].priority < SyncQueue[best].priority)
+			best = i;
+	}
+
+	STile* tile = SyncQueue[best].tile;
+	SyncQueue.erase(SyncQueue.begin() + best);
+
+	if (!FileWDT->loadADT(tile))
+	{
+		TilesMap.erase(tile);
+		return false;
+	}
+
+	updateTileTransform(tile);
+	return true;
 }
 
 bool wow_wdtScene::updateBlocksByCamera()
 {
 	ICamera* cam = g_Engine->getSceneManager()->getActiveCamera();
+	vector3df camPos = cam->getPosition();
 	s32 row, col;
-	if(!WdtSceneNode->getTileByPosition(cam->getPosition(), row, col))
+	if(!WdtSceneNode->getTileByPosition(camPos, row, col))
 		return false;
 
-	bool changed = false;
+	updateCameraVelocity(camPos);
 
-	if (TileChanging)
-	{
-		++TileChangeTick;
-		if (TileChangeTick > TIME_DELAY_TILE_CHANGED)			//tileı5tickٷ
-		{
-			//ǰڸӷ仯tile
-			u32 num = getNumBlocks();
-			for (u32 i=0; i<num; ++i)
-			{
-				u8 r = (u8)Coords[i].X;
-				u8 c = (u8)Coords[i].Y;
-				STile* newTile = FileWDT->getTile(r,c);
-				WdtSceneNode->MapBlocks[i].tile = newTile;
-    			if (newTile && !newTile->fileAdt && !isLoading(newTile))
-           			startLoadADT(newTile);
-
-				//block仯, 
-				WdtSceneNode->updateMapBlock(i);
-			}
-			TileChanging = false;
+	//ٶԤһʱڵtile
+	vector3df ahead = CamVelocity * PREDICT_TIME;
+	ahead.Y = 0;
+	f32 len = ahead.getLength();
+	if (len > PREDICT_MAX_DISTANCE)
+		ahead *= PREDICT_MAX_DISTANCE / len;
 
-			//
-			changed = true;
-		}
+	s32 predictRow, predictCol;
+	if (!WdtSceneNode->getTileByPosition(camPos + ahead, predictRow, predictCol))
+	{
+		predictRow = row;
+		predictCol = col;
 	}
 
+	bool changed = false;
+
 	if (Row != row || Col != col)
 	{
-		TileChanging = true;
-		TileChangeTick = 0;
-
+		//ǰڸӷ仯tile, ûȻWDL
 		Row = row;
 		Col = col;
 
 		recalculateTilesNeeded(Row, Col);
+		updateBlocks();
+
+		changed = true;
 	}
+
+	if (changed || PredictRow != predictRow || PredictCol != predictCol)
+	{
+		PredictRow = predictRow;
+		PredictCol = predictCol;
+
+		requestTiles();
+	}
+
 	return changed;
 }
 
+void wow_wdtScene::updateCameraVelocity( const vector3df& camPos )
+{
+	u32 timeSinceLastFrame = g_Engine->getTimer()->getTimeSinceLastFrame();
+	if (!HasLastCamPos || timeSinceLastFrame == 0)
+	{
+		LastCamPos = camPos;
+		HasLastCamPos = true;
+		return;
+	}
+
+	vector3df move = camPos - LastCamPos;
+	LastCamPos = camPos;
+
+	if (move.getLength() > TELEPORT_DISTANCE)
+	{
+		CamVelocity.set(0,0,0);
+		return;
+	}
+
+	//ƽ, ⵥ֡ıԤ
+	vector3df velocity = move * (1000.0f / timeSinceLastFrame);
+	CamVelocity = CamVelocity * 0.8f + velocity * 0.2f;
+}
+
+void wow_wdtScene::updateBlocks()
+{
+	u32 num = getNumBlocks();
+	for (u32 i=0; i<num; ++i)
+	{
+		u8 r = (u8)Coords[i].X;
+		u8 c = (u8)Coords[i].Y;
+		WdtSceneNode->MapBlocks[i].tile = FileWDT->getTile(r,c);
+
+		//block仯, 
+		WdtSceneNode->updateMapBlock(i);
+	}
+}
+
+void wow_wdtScene::requestTiles()
+{
+	IResourceLoader* loader = g_Engine->getResourceLoader();
+
+	//Ҫȡ, ó߳
+	for (T_TileMap::iterator itr = TilesMap.begin(); itr != TilesMap.end(); )
+	{
+		if (!itr->second && !isTileWanted(itr->first))
+		{
+			loader->cancelTask(WdtSceneNode, itr->first);
+			TilesMap.erase(itr++);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+
+	for (T_SyncQueue::iterator itr = SyncQueue.begin(); itr != SyncQueue.end(); )
+	{
+		if (!isLoading(itr->tile))
+			itr = SyncQueue.erase(itr);
+		else
+			++itr;
+	}
+
+	//طΧڵtile
+	u32 num = getNumBlocks();
+	for (u32 i=0; i<num; ++i)
+	{
+		STile* tile = FileWDT->getTile((u8)Coords[i].X, (u8)Coords[i].Y);
+		if (tile)
+			startLoadADT(tile, getTilePriority(tile));
+	}
+
+	//ԤλΧtile
+	for (s32 r = PredictRow - 1; r <= PredictRow + 1; ++r)
+	{
+		for (s32 c = PredictCol - 1; c <= PredictCol + 1; ++c)
+		{
+			if (r < 0 || c < 0 || r >= TILENUM || c >= TILENUM)
+				continue;
+
+			STile* tile = FileWDT->getTile((u8)r, (u8)c);
+			if (tile)
+				startLoadADT(tile, getTilePriority(tile));
+		}
+	}
+}
+
+f32 wow_wdtScene::getTilePriority( STile* tile ) const
+{
+	//뵱ǰtileԽԽȼ, ԤλΧڵǰطΧ֮
+	f32 dr = (f32)((s32)tile->row - Row);
+	f32 dc = (f32)((s32)tile->col - Col);
+	f32 dist = sqrtf(dr * dr + dc * dc);
+
+	f32 pr = (f32)((s32)tile->row - PredictRow);
+	f32 pc = (f32)((s32)tile->col - PredictCol);
+	f32 predictDist = sqrtf(pr * pr + pc * pc) + 1.0f;
+
+	return min_(dist, predictDist) * TILESIZE;
+}
+
 bool wow_wdtScene::isLoading( STile* tile ) const
 {
 	T_TileMap::const_iterator itr = TilesMap.find(tile);
@@ -194,6 +335,8 @@ void wow_wdtScene::updateTileTransform( STile* tile )
 
 void wow_wdtScene::unloadOutBlocks()
 {
+	//뿪طΧһȦж, ߹tile߽ʱ
+	u32 resident = 0;
 	for (T_TileMap::iterator itr = TilesMap.begin(); itr != TilesMap.end(); )
 	{
 		if (!itr->second)	//loading
@@ -202,17 +345,45 @@ void wow_wdtScene::unloadOutBlocks()
 			continue;
 		}
 
-		STile* tile = itr->first;			//ɾڼطΧ֮tile
-		if (!isTileNeeded(tile))
+		STile* tile = itr->first;
+		if (!isTileWanted(tile))
 		{
 			FileWDT->unloadADT(tile);
 			TilesMap.erase(itr++);
 		}
 		else
 		{
+			++resident;
 			++itr;
 		}
 	}
+
+	//פ, ʱжؼطΧ뵱ǰԤλöԶ
+	u32 limit = getNumBlocks() + RESIDENT_EXTRA_TILES;
+	while (resident > limit)
+	{
+		T_TileMap::iterator farthest = TilesMap.end();
+		f32 farthestPriority = -1.0f;
+		for (T_TileMap::iterator itr = TilesMap.begin(); itr != TilesMap.end(); ++itr)
+		{
+			if (!itr->second || isTileNeeded(itr->first))
+				continue;
+
+			f32 priority = getTilePriority(itr->first);
+			if (priority > farthestPriority)
+			{
+				farthestPriority = priority;
+				farthest = itr;
+			}
+		}
+
+		if (farthest == TilesMap.end())
+			break;
+
+		FileWDT->unloadADT(farthest->first);
+		TilesMap.erase(farthest);
+		--resident;
+	}
 }
 
 void wow_wdtScene::recalculateTilesNeeded( s32 row, s32 col )
@@ -311,6 +482,27 @@ bool wow_wdtScene::isTileNeeded( STile* tile ) const
 	return false;
 }
 
+bool wow_wdtScene::isTileWanted( STile* tile ) const
+{
+	s32 radius = getLoadRadius() + RESIDENT_HYSTERESIS;
+	if (abs((s32)tile->row - Row) <= radius && abs((s32)tile->col - Col) <= radius)
+		return true;
+
+	return abs((s32)tile->row - PredictRow) <= 1 && abs((s32)tile->col - PredictCol) <= 1;
+}
+
+s32 wow_wdtScene::getLoadRadius() const
+{
+	switch(AdtLoadSize)
+	{
+	case EAL_3X3:
+		return 1;
+	case EAL_5X5:
+		return 2;
+	}
+	return 0;
+}
+
 u32 wow_wdtScene::getNumBlocks() const
 {
 	switch(AdtLoadSize)
@@ -11,71 +11,93 @@ wow_wmoScene::wow_wmoScene( CWMOSceneNode* wmoNode )
 
 	XOnePixel = YOnePixel = 0.0f;
 
-	PortalChecked = new bool[FileWmo->Header.nPortals];
+	FrameStamp = 0;
+	PortalCheckedFrame = new u32[FileWmo->Header.nPortals];
+	memset(PortalCheckedFrame, 0, sizeof(u32) * FileWmo->Header.nPortals);
 }
 
 wow_wmoScene::~wow_wmoScene()
 {
-	delete[] PortalChecked;
+	delete[] PortalCheckedFrame;
+}
+
+bool wow_wmoScene::isOutsideGroupPortals( u32 groupIndex, const vector3df& pos ) const
+{
+	//portal⣬Ϊ
+	u32 count = FileWmo->getPortalLinkCount(groupIndex);
+	const CFileWMO::SPortalLink* links = FileWmo->getPortalLinks(groupIndex);
+	for (u32 k=0; k<count; ++k)
+	{
+		const CWMOSceneNode::SDynPortal* dynPortal = &WmoSceneNode->DynPortals[links[k].portalIndex];
+		EIntersectionRelation3D relation = dynPortal->worldplane.classifyPointRelation(pos);
+		if (relation == (links[k].asFront ? ISREL3D_FRONT : ISREL3D_BACK))
+			return true;
+	}
+	return false;
 }
 
 s32 wow_wmoScene::getIndoorGroupIndexOfPosition( ICamera* cam, const vector3df& pos )
 {
-	u32 nGroups = FileWmo->Header.nGroups;
-	for (u32 i=0; i<nGroups; ++i)
+	matrix4 invMat;
+	if (!WmoSceneNode->getAbsoluteTransformation().getInverse(invMat))
+		return -1;
+
+	vector3df localPos = pos;
+	invMat.transformVect(localPos);
+
+	u16 candidates[MAX_INDOOR_CANDIDATES];
+	u32 numCandidates = FileWmo->getIndoorGroupsAtPoint(localPos, candidates, MAX_INDOOR_CANDIDATES);
+
+	//bvhı˳group˳޹, ûеϢʱԭһȡһ
+	std::sort(candidates, candidates + numCandidates);
+
+	s32 result = -1;
+	f32 nearestFloor = 0.0f;
+	for (u32 i=0; i<numCandidates; ++i)
 	{
-		const CWMOGroup* group = &FileWmo->Groups[i];
-		if(!group->indoor || group->NumBatches == 0)
+		u32 groupIndex = candidates[i];
+		if (!WmoSceneNode->DynGroups[groupIndex].visible)
 			continue;
 
-		const CWMOSceneNode::SDynGroup* dynGroup = &WmoSceneNode->DynGroups[i];
-		if (dynGroup->visible && dynGroup->worldbox.isPointInside(pos))
+		if (isOutsideGroupPortals(groupIndex, pos))
 		{
-			//portal⣬Ϊ
-			
-			u32 frontCount = FileWmo->getPortalCountAsFront(i);
-			for (u32 k=0; k<frontCount; ++k)		
-			{
-				s32 portalIndex = FileWmo->getPortalIndexAsFront(i, k);
-				if (portalIndex != -1 && FileWmo->Portals[portalIndex].isValid())
-				{
-					const CWMOSceneNode::SDynPortal* dynPortal = &WmoSceneNode->DynPortals[portalIndex];
-					EIntersectionRelation3D relation = dynPortal->worldplane.classifyPointRelation(pos);
-					if (relation == ISREL3D_FRONT)
-						return -1;
-				}
-			}
-
-			u32 backCount = FileWmo->getPortalCountAsBack(i);
-			for (u32 k=0; k<backCount; ++k)		
-			{
-				s32 portalIndex = FileWmo->getPortalIndexAsBack(i, k);
-				if (portalIndex != -1 && FileWmo->Portals[portalIndex].isValid())
-				{
-					const CWMOSceneNode::SDynPortal* dynPortal = &WmoSceneNode->DynPortals[portalIndex];
-					EIntersectionRelation3D relation = dynPortal->worldplane.classifyPointRelation(pos);
-					if (relation == ISREL3D_BACK)
-						return -1;
-				}
-			}
-
-			//
-			return (s32)i;
+			//ԭһ, һõgroupportalʱΪ
+			if (result == -1)
+				return -1;
+			continue;
+		}
+
+		//Χصʱȡµgroup
+		const aabbox3df& box = FileWmo->Groups[groupIndex].box;
+		f32 floorDist;
+		if (!FileWmo->getGroupFloorDistance(groupIndex, localPos, localPos.Y - box.MinEdge.Y + 1.0f, floorDist))
+			floorDist = FLT_MAX;
+
+		if (result == -1 || floorDist < nearestFloor)
+		{
+			result = (s32)groupIndex;
+			nearestFloor = floorDist;
 		}
 	}
-	return -1;
+
+	return result;
 }
 
 void wow_wmoScene::tick( u32 timeSinceStart, u32 timeSinceLastFrame )
 {
-	u32 nPortals = FileWmo->Header.nPortals;
-	
 	const recti& vp = g_Engine->getDriver()->getViewPort();
 	XOnePixel = 2.0f / vp.getWidth();
 	YOnePixel = 2.0f / vp.getHeight();
 
 	VisibleGroups.clear();
-	memset(PortalChecked, 0, sizeof(bool) * nPortals);
+
+	//֡Ŵÿ֡portal
+	++FrameStamp;
+	if (FrameStamp == 0)
+	{
+		memset(PortalCheckedFrame, 0, sizeof(u32) * FileWmo->Header.nPortals);
+		FrameStamp = 1;
+	}
 
 	ICamera* cam = g_Engine->getSceneManager()->getActiveCamera();
 	CameraIndoorGroupIndex = getIndoorGroupIndexOfPosition(cam, cam->getPosition());
@@ -83,66 +105,41 @@ void wow_wmoScene::tick( u32 timeSinceStart, u32 timeSinceLastFrame )
 	frustum f = cam->getViewFrustum();
 	f.setFarPlane(cam->getTerrainClipPlane());
 
+	rectf rect(-1.0f, 1.0f, 1.0f, -1.0f);
+
 	//
 	if (CameraIndoorGroupIndex == -1)
 	{
-		u32 nGroups = FileWmo->Header.nGroups;
-		for (u32 i=0; i<nGroups; ++i)
+		const std::vector<u16>& outdoorGroups = FileWmo->getOutdoorGroups();
+		for (u32 i=0; i<(u32)outdoorGroups.size(); ++i)
 		{
-			const CWMOGroup* group = &FileWmo->Groups[i];
-			const CWMOSceneNode::SDynGroup* dynGroup = &WmoSceneNode->DynGroups[i];
-			if(!group->indoor && dynGroup->visible)
-				VisibleGroups.insert(SGroupVisEntry(i, f));			//add all visible outdoor groups		
+			u32 groupIndex = outdoorGroups[i];
+			if (WmoSceneNode->DynGroups[groupIndex].visible)
+				VisibleGroups.insert(SGroupVisEntry(groupIndex, f));			//add all visible outdoor groups		
 		}
 
-		rectf rect(-1.0f, 1.0f, 1.0f, -1.0f);
-
-		for (u32 i=0; i<nPortals; ++i)
+		//ֻgroupportalΪ
+		const std::vector<u16>& entryPortals = FileWmo->getEntryPortals();
+		for (u32 i=0; i<(u32)entryPortals.size(); ++i)
 		{
-			const SWMOPortal* portal = &FileWmo->Portals[i];
+			u32 portalIndex = entryPortals[i];
+			const SWMOPortal* portal = &FileWmo->Portals[portalIndex];
 
-			if (!portal->isValid())
-				continue;
-		
-			const CWMOGroup* front = &FileWmo->Groups[portal->frontGroupIndex];
-			const CWMOGroup* back = &FileWmo->Groups[portal->backGroupIndex];
+			if (!FileWmo->Groups[portal->frontGroupIndex].indoor)
+				goThroughPortal(portalIndex, true, cam, f, rect, true);
 
-			if (!front->indoor)
-			{
-				goThroughPortalFront(i, cam, f, rect, true);
-			}
-		
-			if (!back->indoor)
-			{
-				goThroughPortalBack(i, cam, f, rect, true);
-			}	
+			if (!FileWmo->Groups[portal->backGroupIndex].indoor)
+				goThroughPortal(portalIndex, false, cam, f, rect, true);
 		}
 	}
 	else		//
 	{
-		rectf rect(-1.0f, 1.0f, 1.0f, -1.0f);
-
 		VisibleGroups.insert(SGroupVisEntry(CameraIndoorGroupIndex, f));
 
-		u32 frontCount = FileWmo->getPortalCountAsFront((u32)CameraIndoorGroupIndex);
-		for (u32 i=0; i<frontCount; ++i)
-		{
-			s32 portalIndex = FileWmo->getPortalIndexAsFront((u32)CameraIndoorGroupIndex, i);
-			if (portalIndex != -1 && FileWmo->Portals[portalIndex].isValid())
-			{
-				goThroughPortalFront(portalIndex, cam, f, rect, false);
-			}
-		}
-
-		u32 backCount = FileWmo->getPortalCountAsBack((u32)CameraIndoorGroupIndex);
-		for (u32 i=0; i<backCount; ++i)
-		{
-			s32 portalIndex = FileWmo->getPortalIndexAsBack((u32)CameraIndoorGroupIndex, i);
-			if (portalIndex != -1 && FileWmo->Portals[portalIndex].isValid())
-			{
-				goThroughPortalBack(portalIndex, cam, f, rect, false);
-			}
-		}
+		u32 count = FileWmo->getPortalLinkCount((u32)CameraIndoorGroupIndex);
+		const CFileWMO::SPortalLink* links = FileWmo->getPortalLinks((u32)CameraIndoorGroupIndex);
+		for (u32 i=0; i<count; ++i)
+			goThroughPortal(links[i].portalIndex, links[i].asFront, cam, f, rect, false);
 	}
 
 	//swprintf_s( g_Engine->getSceneManager()->DebugText, 512, L"%s, %d groupж", CameraIndoorGroupIndex == -1 ? L"" : L"",						VisibleGroups.size());
@@ -194,119 +191,76 @@ void wow_wmoScene::unloadDoodadSceneNodes()
 	DoodadSceneNodes.clear();
 }
 
-void wow_wmoScene::goThroughPortalFront( u32 index, ICamera* cam, const frustum& f, const rectf& rect, bool onlyIndoor )
+void wow_wmoScene::goThroughPortal( u32 index, bool front, ICamera* cam, const frustum& f, const rectf& rect, bool onlyIndoor )
 {
-	const SWMOPortal* portal = &FileWmo->Portals[index];
-	const CWMOSceneNode::SDynPortal* dynPortal = &WmoSceneNode->DynPortals[index];
-
-	if (PortalChecked[index] ||
-		!dynPortal->visible ||
-		(onlyIndoor && !FileWmo->Groups[portal->backGroupIndex].indoor) ||
-		cam->getDir().dotProduct(dynPortal->worldplane.Normal) < 0 || 
-		!f.isInFrustum(dynPortal->worldbox))
-		return;
-
-	PortalChecked[index] = true;
-	
-	vector3df vmin = dynPortal->worldbox.MinEdge;
-	vector3df vmax = dynPortal->worldbox.MaxEdge;
-
-	f32 wmin, wmax;
-	cam->getViewProjectionMatrix().transformVect(vmin, wmin);
-	cam->getViewProjectionMatrix().transformVect(vmax, wmax);
-	ASSERT(wmin != 0.0f && wmax != 0.0f);
-	
-	wmin = 1.0f / wmin;
-	wmax = 1.0f / wmax;
-
-	vmin *= wmin;
-	vmax *= wmax;
-
-	if (fabs(vmin.X - vmax.X) < XOnePixel || fabs(vmin.Y - vmax.Y) < YOnePixel)		//Сһ
-		return;
-
-	rectf rcPortal = rect;
-	frustum clipFrustum = f;
-
-	if (wmin > 0.0f && wmax > 0.0f)		//portalȫnear plane
-	{
-		f32 minz = min_(vmin.Z, vmax.Z);		//
-
-		//portal
-		if(!clipPortal2D(rcPortal, vector2df(vmin.X, vmin.Y), vector2df(vmax.X, vmax.Y)))
-			return;
+	//, portalѹջ, ж˳͵ݹʱһ
+	PortalStack.clear();
+	PortalStack.push_back(SPortalStackEntry(index, front, f, rect));
 
-		//portalfrustum
-		makeFrustum(clipFrustum, cam, rcPortal.UpperLeftCorner.X, rcPortal.UpperLeftCorner.Y, rcPortal.LowerRightCorner.X, rcPortal.LowerRightCorner.Y, minz);
-	}
+	const matrix4& matVP = cam->getViewProjectionMatrix();
+	const vector3df& camDir = cam->getDir();
 
-	VisibleGroups.insert(SGroupVisEntry(portal->backGroupIndex, clipFrustum));			
-	
-	//find back -> font, portal
-	u32 frontCount = FileWmo->getPortalCountAsFront(portal->backGroupIndex);
-	for (u32 i=0; i<frontCount; ++i)
+	while (!PortalStack.empty())
 	{
-		s32 portalIndex = FileWmo->getPortalIndexAsFront(portal->backGroupIndex, i);
-		if (portalIndex != -1)
-			goThroughPortalFront((u32)portalIndex, cam, clipFrustum, rcPortal, onlyIndoor);
-	}
-}
-
-void wow_wmoScene::goThroughPortalBack( u32 index, ICamera* cam, const frustum& f, const rectf& rect, bool onlyIndoor )
-{
-	const SWMOPortal* portal = &FileWmo->Portals[index];
-	const CWMOSceneNode::SDynPortal* dynPortal = &WmoSceneNode->DynPortals[index];
-
-	if (PortalChecked[index] ||
-		!dynPortal->visible ||
-		(onlyIndoor && !FileWmo->Groups[portal->frontGroupIndex].indoor) ||
-		cam->getDir().dotProduct(dynPortal->worldplane.Normal) > 0 || 
-		!f.isInFrustum(dynPortal->worldbox))
-		return;
+		SPortalStackEntry e = PortalStack.back();
+		PortalStack.pop_back();
+
+		const SWMOPortal* portal = &FileWmo->Portals[e.portalIndex];
+		const CWMOSceneNode::SDynPortal* dynPortal = &WmoSceneNode->DynPortals[e.portalIndex];
+		s16 nextGroup = e.front ? portal->backGroupIndex : portal->frontGroupIndex;
+		f32 facing = camDir.dotProduct(dynPortal->worldplane.Normal);
+
+		if (PortalCheckedFrame[e.portalIndex] == FrameStamp ||
+			!dynPortal->visible ||
+			(onlyIndoor && !FileWmo->Groups[nextGroup].indoor) ||
+			(e.front ? facing < 0 : facing > 0) || 
+			!e.frust.isInFrustum(dynPortal->worldbox))
+			continue;
 
-	PortalChecked[index] = true;
+		PortalCheckedFrame[e.portalIndex] = FrameStamp;
 
-	vector3df vmin = dynPortal->worldbox.MinEdge;
-	vector3df vmax = dynPortal->worldbox.MaxEdge;
+		vector3df vmin = dynPortal->worldbox.MinEdge;
+		vector3df vmax = dynPortal->worldbox.MaxEdge;
 
-	f32 wmin, wmax;
-	cam->getViewProjectionMatrix().transformVect(vmin, wmin);
-	cam->getViewProjectionMatrix().transformVect(vmax, wmax);
-	ASSERT(wmin != 0.0f && wmax != 0.0f);
+		f32 wmin, wmax;
+		matVP.transformVect(vmin, wmin);
+		matVP.transformVect(vmax, wmax);
+		ASSERT(wmin != 0.0f && wmax != 0.0f);
 
-	wmin = 1.0f / wmin;
-	wmax = 1.0f / wmax;
+		wmin = 1.0f / wmin;
+		wmax = 1.0f / wmax;
 
-	vmin *= wmin;
-	vmax *= wmax;
+		vmin *= wmin;
+		vmax *= wmax;
 
-	if (fabs(vmin.X - vmax.X) < XOnePixel || fabs(vmin.Y - vmax.Y) < YOnePixel)		//Сһ
-		return;
+		if (fabs(vmin.X - vmax.X) < XOnePixel || fabs(vmin.Y - vmax.Y) < YOnePixel)		//Сһ
+			continue;
 
-	rectf rcPortal = rect;
-	frustum clipFrustum = f;
+		rectf rcPortal = e.rect;
+		frustum clipFrustum = e.frust;
 
-	if (wmin > 0.0f && wmax > 0.0f)		//portalȫnear plane
-	{
-		f32 minz = min_(vmin.Z, vmax.Z);		//
+		if (wmin > 0.0f && wmax > 0.0f)		//portalȫnear plane
+		{
+			f32 minz = min_(vmin.Z, vmax.Z);		//
 
-		//portal
-		if(!clipPortal2D(rcPortal, vector2df(vmin.X, vmin.Y), vector2df(vmax.X, vmax.Y)))
-			return;
+			//portal
+			if(!clipPortal2D(rcPortal, vector2df(vmin.X, vmin.Y), vector2df(vmax.X, vmax.Y)))
+				continue;
 
-		//portalfrustum
-		makeFrustum(clipFrustum, cam, rcPortal.UpperLeftCorner.X, rcPortal.UpperLeftCorner.Y, rcPortal.LowerRightCorner.X, rcPortal.LowerRightCorner.Y, minz);
-	}
+			//portalfrustum
+			makeFrustum(clipFrustum, cam, rcPortal.UpperLeftCorner.X, rcPortal.UpperLeftCorner.Y, rcPortal.LowerRightCorner.X, rcPortal.LowerRightCorner.Y, minz);
+		}
 
-	VisibleGroups.insert(SGroupVisEntry(portal->frontGroupIndex, clipFrustum));			
+		VisibleGroups.insert(SGroupVisEntry(nextGroup, clipFrustum));
 
-	//find front -> back, portal
-	u32 backCount = FileWmo->getPortalCountAsBack(portal->frontGroupIndex);
-	for (u32 i=0; i<backCount; ++i)
-	{
-		s32 portalIndex = FileWmo->getPortalIndexAsBack(portal->frontGroupIndex, i);
-		if (portalIndex != -1)
-			goThroughPortalBack((u32)portalIndex, cam, clipFrustum, rcPortal, onlyIndoor);
+		//ͬportal, front: back -> front, back: front -> back
+		u32 count = FileWmo->getPortalLinkCount(nextGroup);
+		const CFileWMO::SPortalLink* links = FileWmo->getPortalLinks(nextGroup);
+		for (u32 i=count; i>0; --i)
+		{
+			if (links[i - 1].asFront == e.front)
+				PortalStack.push_back(SPortalStackEntry(links[i - 1].portalIndex, e.front, clipFrustum, rcPortal));
+		}
 	}
 }
 
@@ -0,0 +1,126 @@
+#include "AssetCacheBuilder.h"
+#include "mywow.h"
+#include "CAssetCache.h"
+#include "CFileWDT.h"
+#include "CFileADT.h"
+
+#pragma comment(lib, "mywow.lib")
+
+typedef std::set<string512, std::less<string512>, qzone_allocator<string512> > T_FileNameSet;
+
+bool buildMapCache(const SMapRecord* mapRecord);
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("usage: AssetCacheBuilder.exe <map name> [<map name> ...]\n");
+		getchar();
+		return 0;
+	}
+
+#if defined(DEBUG) | defined(_DEBUG)
+	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
+#endif
+
+	SWindowInfo wndInfo = Engine::createWindow("AssetCacheBuilder", dimension2du(800,600), 1.0f, false, true);
+
+	SEngineInitParam param;
+	param.useAssetCache = true;
+	createEngine(param, wndInfo);
+
+	g_Engine->initDriver(EDT_OPENGL, 0, false, true, 1, true);
+
+	wowDatabase* database = g_Engine->getWowDatabase();
+	database->buildMaps();
+
+	for (int i=1; i<argc; ++i)
+	{
+		const SMapRecord* mapRecord = NULL_PTR;
+		for (u32 iMap = 0; iMap < database->getNumMaps(); ++iMap)
+		{
+			if (Q_stricmp(database->getMap(iMap)->name, argv[i]) == 0)
+			{
+				mapRecord = database->getMap(iMap);
+				break;
+			}
+		}
+
+		if (!mapRecord)
+		{
+			printf("map %s not found.\n", argv[i]);
+			continue;
+		}
+
+		buildMapCache(mapRecord);
+	}
+
+	CAssetCache* cache = g_Engine->getAssetCache();
+	printf("cache hits: %u, misses: %u, written: %u\n", cache->getNumHits(), cache->getNumMisses(), cache->getNumWrites());
+
+	destroyEngine();
+
+	return 0;
+}
+
+bool buildMapCache(const SMapRecord* mapRecord)
+{
+	c8 mapname[QMAX_PATH];
+	Q_sprintf(mapname, QMAX_PATH, "World\\Maps\\%s\\%s.wdt", mapRecord->name, mapRecord->name);
+
+	IResourceLoader* loader = g_Engine->getResourceLoader();
+
+	CFileWDT* fileWDT = static_cast<CFileWDT*>(loader->loadWDT(mapname, mapRecord->id));
+	if (!fileWDT)
+	{
+		printf("%s open failed.\n", mapname);
+		return false;
+	}
+
+	//ռtileõm2, wmo, ȥغ, عд뻺
+	T_FileNameSet m2FileNameSet;
+	T_FileNameSet wmoFileNameSet;
+
+	if (strlen(fileWDT->GlobalWmoFileName) > 0)
+		wmoFileNameSet.insert(fileWDT->GlobalWmoFileName);
+
+	u32 nTiles = fileWDT->getTileCount();
+	for (u32 i=0; i<nTiles; ++i)
+	{
+		STile* tile = fileWDT->getTile(i);
+		if (!fileWDT->loadADT(tile, false))			//, ͬʱдadtĻ
+			continue;
+
+		CFileADT* fileADT = static_cast<CFileADT*>(tile->fileAdt);
+		for (u32 k=0; k<fileADT->NumM2FileNames; ++k)
+			m2FileNameSet.insert(fileADT->getM2FileName(k));
+		for (u32 k=0; k<fileADT->NumWmoFileNames; ++k)
+			wmoFileNameSet.insert(fileADT->getWMOFileName(k));
+
+		fileWDT->unloadADT(tile);
+	}
+
+	fileWDT->drop();
+
+	printf("%s: %u tiles, %u m2, %u wmo\n", mapRecord->name, nTiles, (u32)m2FileNameSet.size(), (u32)wmoFileNameSet.size());
+
+	for (T_FileNameSet::iterator itr = m2FileNameSet.begin(); itr != m2FileNameSet.end(); ++itr)
+	{
+		IFileM2* fileM2 = loader->loadM2(itr->c_str(), false);
+		if (fileM2)
+			fileM2->drop();
+		else
+			printf("%s open failed.\n", itr->c_str());
+	}
+
+	for (T_FileNameSet::iterator itr = wmoFileNameSet.begin(); itr != wmoFileNameSet.end(); ++itr)
+	{
+		IFileWMO* fileWMO = loader->loadWMO(itr->c_str(), false);
+		if (fileWMO)
+			fileWMO->drop();
+		else
+			printf("%s open failed.\n", itr->c_str());
+	}
+
+	return true;
+}
@@ -0,0 +1,1774 @@
+#include "FrameBenchmark.h"
+#include "mywow.h"
+#include "CNullDriver.h"
+#include "CInstanceBVH.h"
+#include "CDXTEncoder.h"
+#include "CBlit.h"
+#include "CNullAudioPlayer.h"
+#include "CAudioDecodeServices.h"
+#include "CAudioMixer.h"
+#include "IMemFile.h"
+#include "ddslib.h"
+#include "CFileM2.h"
+
+#pragma comment(lib, "mywow.lib")
+
+//ÿطһι̶·, ͳÿ֡׶εcpuʱύ
+//Կ, ڹвԱǰεĽ
+
+#define WARMUP_FRAMES		120			//ȴΧtile첽
+#define DEFAULT_FRAMES		1000
+#define CAMERA_HEIGHT		20.0f
+#define DEFAULT_CULL_ITERATIONS		3600
+#define DEFAULT_DXT_ITERATIONS		20
+#define DEFAULT_BLIT_ITERATIONS		50
+#define BLIT_WIDTH		1024
+#define BLIT_HEIGHT		1024
+#define DEFAULT_AUDIO_VOICES		16
+#define DEFAULT_AUDIO_SECONDS		60
+#define AUDIO_SAMPLE_RATE		44100
+#define AUDIO_RENDER_FRAMES		1024
+#define DEFAULT_IO_ITERATIONS		3
+#define DEFAULT_ALLOC_THREADS		3
+#define DEFAULT_ALLOC_SECONDS		10
+#define ALLOC_TASK_OBJECTS		256			//loaderÿС, render߳ͷ
+#define ALLOC_FRAME_OBJECTS		2000		//render߳ÿ֡ԼͷŵС
+#define ALLOC_MAX_HANDOFF		(ALLOC_TASK_OBJECTS * 64)		//render߳ͷʱloaderȡ
+#define DEFAULT_MPQ_LOOKUPS		100000		//һ, һ벻
+#define MPQ_OPEN_FILES		2000			//openҪѹȡ, ֻȡǰһ
+#define DEFAULT_REFCOUNT_THREADS		8
+#define DEFAULT_REFCOUNT_ITERATIONS		1000000
+#define REFCOUNT_OBJECTS		16			//̹߳õĶ, ģͬһģͱ߳
+#define DEFAULT_BONES_INSTANCES		1000
+#define DEFAULT_BONES_FRAMES		200
+#define BONES_FRAME_TIME		33			//ÿ֡ƽĶʱ(ms)
+#define BONES_TIME_STAGGER		37			//ʵʱ, ʵͬһ֡
+#define DEFAULT_DBC_LOOKUPS		5000
+
+enum E_BENCH_PHASE
+{
+	EBP_TICK = 0,
+	EBP_RENDER,
+	EBP_TERRAIN,
+	EBP_WMO,
+	EBP_MESH,
+	EBP_ALPHATEST,
+	EBP_TRANSPARENT,
+	EBP_WIRE3D,
+	EBP_2D,
+	EBP_GPU,
+	EBP_DRAWCALL,
+	EBP_PRIMITIVES,
+	EBP_STATECHANGES,
+	EBP_UPLOADBYTES,
+
+	EBP_COUNT,
+};
+
+static const c8* g_phaseNames[EBP_COUNT] =
+{
+	"tick (us)",
+	"render (us)",
+	"terrain (us)",
+	"wmo (us)",
+	"mesh (us)",
+	"alphatest (us)",
+	"transparent (us)",
+	"3Dwire (us)",
+	"2D (us)",
+	"present (us)",
+	"draw calls",
+	"primitives",
+	"state changes",
+	"upload bytes",
+};
+
+struct SPhaseStat
+{
+	SPhaseStat() : total(0), minValue(0xffffffff), maxValue(0) { }
+
+	void add(u32 v)
+	{
+		total += v;
+		if (v < minValue) minValue = v;
+		if (v > maxValue) maxValue = v;
+	}
+
+	u64		total;
+	u32		minValue;
+	u32		maxValue;
+};
+
+bool runBenchmark(const SMapRecord* mapRecord, s32 row, s32 col, u32 numFrames);
+bool runCullBenchmark(const SMapRecord* mapRecord, s32 row, s32 col, u32 iterations);
+bool runDXTBenchmark(const c8* filename, u32 iterations);
+bool runBlitBenchmark(u32 iterations);
+bool runAudioBenchmark(const c8* filename, u32 numVoices, u32 seconds);
+bool runIOBenchmark(const c8* dirname, const c8* ext, u32 iterations);
+bool runAllocBenchmark(u32 numThreads, u32 seconds);
+bool runMpqBenchmark(const c8* ext, u32 numFiles);
+bool runRefCountBenchmark(u32 maxThreads, u32 iterations);
+bool runBonesBenchmark(const c8* filename, u32 numInstances, u32 numFrames);
+bool runDbcBenchmark(u32 numLookups);
+
+int main(int argc, char* argv[])
+{
+	//-cull: ֻȽһtiledoodadwmoĲü, Ӧѡеʵܼtile
+	bool cullOnly = argc >= 2 && Q_stricmp(argv[1], "-cull") == 0;
+	//-dxt: Ƚԭ565ѹCDXTEncoderĺʱpsnr
+	bool dxtOnly = argc >= 2 && Q_stricmp(argv[1], "-dxt") == 0;
+	//-blit: CBlitʽתڸָµ, ͬʱscalarһ
+	bool blitOnly = argc >= 2 && Q_stricmp(argv[1], "-blit") == 0;
+	//-audio: 豸µĽ, кطźͶ·ʱ
+	bool audioOnly = argc >= 2 && Q_stricmp(argv[1], "-audio") == 0;
+	//-io: Ŀ¼ɢļӳַʽ/ȼ
+	bool ioOnly = argc >= 2 && Q_stricmp(argv[1], "-io") == 0;
+	//-alloc: ģloaderrender̵߳ķģʽ, Ƚzonemalloc
+	bool allocOnly = argc >= 2 && Q_stricmp(argv[1], "-alloc") == 0;
+	//-mpq: /ļʱ, mpqдںͲڵļĲҺʱ
+	bool mpqOnly = argc >= 2 && Q_stricmp(argv[1], "-mpq") == 0;
+	//-refcount: ߳ͬʱgrab/drop, ȽԭȫԭӼ
+	bool refcountOnly = argc >= 2 && Q_stricmp(argv[1], "-refcount") == 0;
+	//-bones: ͬһm2Ĵʵ֡, ȽԭĵݹcalcBone͸ǰ˳
+	bool bonesOnly = argc >= 2 && Q_stricmp(argv[1], "-bones") == 0;
+	//-dbc: npcװͽɫ۵ѯ, ȽϱͶ
+	bool dbcOnly = argc >= 2 && Q_stricmp(argv[1], "-dbc") == 0;
+	if (cullOnly || dxtOnly || blitOnly || audioOnly || ioOnly || allocOnly || mpqOnly || refcountOnly || bonesOnly || dbcOnly)
+	{
+		--argc;
+		++argv;
+	}
+
+	if (argc < 2 && !blitOnly && !allocOnly && !mpqOnly && !refcountOnly && !dbcOnly)
+	{
+		printf("usage: FrameBenchmark.exe [-cull] <map name> [<row> <col>] [<frames>]\n");
+		printf("       FrameBenchmark.exe -dxt <blp file> [<iterations>]\n");
+		printf("       FrameBenchmark.exe -blit [<iterations>]\n");
+		printf("       FrameBenchmark.exe -audio <wav/ogg/mp3 file> [<voices>] [<seconds>]\n");
+		printf("       FrameBenchmark.exe -io <directory> [<extension>] [<iterations>]\n");
+		printf("       FrameBenchmark.exe -alloc [<loader threads>] [<seconds>]\n");
+		printf("       FrameBenchmark.exe -mpq [<extension>] [<lookups>]\n");
+		printf("       FrameBenchmark.exe -refcount [<max threads>] [<iterations>]\n");
+		printf("       FrameBenchmark.exe -bones <m2 file> [<instances>] [<frames>]\n");
+		printf("       FrameBenchmark.exe -dbc [<lookups>]\n");
+		getchar();
+		return 0;
+	}
+
+#if defined(DEBUG) | defined(_DEBUG)
+	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
+#endif
+
+	s32 row = argc >= 4 ? atoi(argv[2]) : 29;
+	s32 col = argc >= 4 ? atoi(argv[3]) : 40;
+	u32 numFrames = argc >= 5 ? (u32)atoi(argv[4]) : DEFAULT_FRAMES;
+	if (numFrames == 0 || (cullOnly && argc < 5))
+		numFrames = cullOnly ? DEFAULT_CULL_ITERATIONS : DEFAULT_FRAMES;
+
+	SWindowInfo wndInfo = Engine::createWindow("FrameBenchmark", dimension2du(1136,640), 1.0f, false, true);
+
+	SEngineInitParam param;
+	createEngine(param, wndInfo);
+
+	if (!g_Engine->initDriver(EDT_NULL, 0, false, false, 1, true))
+	{
+		printf("init null driver failed.\n");
+		destroyEngine();
+		return 0;
+	}
+
+	g_Engine->getEngineSetting()->setForegroundFPSLimit(0);			//֡
+
+	if (dxtOnly)
+	{
+		u32 iterations = argc >= 3 ? (u32)atoi(argv[2]) : DEFAULT_DXT_ITERATIONS;
+		runDXTBenchmark(argv[1], iterations ? iterations : DEFAULT_DXT_ITERATIONS);
+		destroyEngine();
+		return 0;
+	}
+
+	if (blitOnly)
+	{
+		u32 iterations = argc >= 2 ? (u32)atoi(argv[1]) : DEFAULT_BLIT_ITERATIONS;
+		runBlitBenchmark(iterations ? iterations : DEFAULT_BLIT_ITERATIONS);
+		destroyEngine();
+		return 0;
+	}
+
+	if (audioOnly)
+	{
+		u32 numVoices = argc >= 3 ? (u32)atoi(argv[2]) : DEFAULT_AUDIO_VOICES;
+		u32 seconds = argc >= 4 ? (u32)atoi(argv[3]) : DEFAULT_AUDIO_SECONDS;
+		runAudioBenchmark(argv[1], numVoices ? numVoices : DEFAULT_AUDIO_VOICES, seconds ? seconds : DEFAULT_AUDIO_SECONDS);
+		destroyEngine();
+		return 0;
+	}
+
+	if (ioOnly)
+	{
+		const c8* ext = argc >= 3 ? argv[2] : "";
+		u32 iterations = argc >= 4 ? (u32)atoi(argv[3]) : DEFAULT_IO_ITERATIONS;
+		runIOBenchmark(argv[1], ext, iterations ? iterations : DEFAULT_IO_ITERATIONS);
+		destroyEngine();
+		return 0;
+	}
+
+	if (allocOnly)
+	{
+		u32 numThreads = argc >= 2 ? (u32)atoi(argv[1]) : DEFAULT_ALLOC_THREADS;
+		u32 seconds = argc >= 3 ? (u32)atoi(argv[2]) : DEFAULT_ALLOC_SECONDS;
+		runAllocBenchmark(numThreads ? numThreads : DEFAULT_ALLOC_THREADS, seconds ? seconds : DEFAULT_ALLOC_SECONDS);
+		destroyEngine();
+		return 0;
+	}
+
+	if (mpqOnly)
+	{
+		const c8* ext = argc >= 2 ? argv[1] : "m2";
+		u32 numLookups = argc >= 3 ? (u32)atoi(argv[2]) : DEFAULT_MPQ_LOOKUPS;
+		runMpqBenchmark(ext, numLookups ? numLookups : DEFAULT_MPQ_LOOKUPS);
+		destroyEngine();
+		return 0;
+	}
+
+	if (refcountOnly)
+	{
+		u32 maxThreads = argc >= 2 ? (u32)atoi(argv[1]) : DEFAULT_REFCOUNT_THREADS;
+		u32 iterations = argc >= 3 ? (u32)atoi(argv[2]) : DEFAULT_REFCOUNT_ITERATIONS;
+		runRefCountBenchmark(maxThreads ? maxThreads : DEFAULT_REFCOUNT_THREADS, iterations ? iterations : DEFAULT_REFCOUNT_ITERATIONS);
+		destroyEngine();
+		return 0;
+	}
+
+	if (bonesOnly)
+	{
+		u32 numInstances = argc >= 3 ? (u32)atoi(argv[2]) : DEFAULT_BONES_INSTANCES;
+		u32 numFrames = argc >= 4 ? (u32)atoi(argv[3]) : DEFAULT_BONES_FRAMES;
+		runBonesBenchmark(argv[1], numInstances ? numInstances : DEFAULT_BONES_INSTANCES, numFrames ? numFrames : DEFAULT_BONES_FRAMES);
+		destroyEngine();
+		return 0;
+	}
+
+	if (dbcOnly)
+	{
+		u32 numLookups = argc >= 2 ? (u32)atoi(argv[1]) : DEFAULT_DBC_LOOKUPS;
+		runDbcBenchmark(numLookups ? numLookups : DEFAULT_DBC_LOOKUPS);
+		destroyEngine();
+		return 0;
+	}
+
+	wowDatabase* database = g_Engine->getWowDatabase();
+	database->buildMaps();
+
+	const SMapRecord* mapRecord = NULL_PTR;
+	for (u32 iMap = 0; iMap < database->getNumMaps(); ++iMap)
+	{
+		if (Q_stricmp(database->getMap(iMap)->name, argv[1]) == 0)
+		{
+			mapRecord = database->getMap(iMap);
+			break;
+		}
+	}
+
+	if (mapRecord && cullOnly)
+		runCullBenchmark(mapRecord, row, col, numFrames);
+	else if (mapRecord)
+		runBenchmark(mapRecord, row, col, numFrames);
+	else
+		printf("map %s not found.\n", argv[1]);
+
+	destroyEngine();
+
+	return 0;
+}
+
+bool runBenchmark(const SMapRecord* mapRecord, s32 row, s32 col, u32 numFrames)
+{
+	c8 mapname[QMAX_PATH];
+	Q_sprintf(mapname, QMAX_PATH, "World\\Maps\\%s\\%s.wdt", mapRecord->name, mapRecord->name);
+
+	IFileWDT* fileWDT = g_Engine->getResourceLoader()->loadWDT(mapname, mapRecord->id);
+	if (!fileWDT)
+	{
+		printf("%s open failed.\n", mapname);
+		return false;
+	}
+
+	g_Engine->initSceneManager();
+	ISceneManager* sceneMgr = g_Engine->getSceneManager();
+	sceneMgr->ShowDebugBase = false;
+	sceneMgr->PerfEveryFrame = true;
+
+	ICamera* cam = sceneMgr->addCamera(vector3df(0, 5, -10), vector3df(0,0,0), vector3df(0,1,0), 1.0f, 2500.0f, PI/4.0f);
+	sceneMgr->setActiveCamera(cam);
+
+	IWDTSceneNode* node = sceneMgr->addWDTSceneNode(fileWDT, NULL_PTR);
+	matrix4 mat;
+	mat.setScale(g_Engine->getSceneRenderServices()->SCENE_SCALE);
+	node->setRelativeTransformation(mat);
+	node->update();
+	node->setCurrentTile(row, col);
+
+	sceneMgr->addSkySceneNode(fileWDT->getMapEnvironment());
+
+	//4tileһȦ, ÿ֡ǰ̶, ֤ÿ·ͬ
+	vector3df waypoints[4];
+	waypoints[0] = node->getPositionByTile(row, col);
+	waypoints[1] = node->getPositionByTile(row, col + 1);
+	waypoints[2] = node->getPositionByTile(row + 1, col + 1);
+	waypoints[3] = node->getPositionByTile(row + 1, col);
+
+	CNullDriver* driver = static_cast<CNullDriver*>(g_Engine->getDriver());
+
+	SPhaseStat stats[EBP_COUNT];
+	f32 height = waypoints[0].Y + CAMERA_HEIGHT;
+	u32 totalFrames = WARMUP_FRAMES + numFrames;
+	u32 frame = 0;
+	while (frame < totalFrames)
+	{
+		f32 t = (f32)(frame % numFrames) / numFrames * 4.0f;
+		u32 seg = (u32)t;
+		if (seg > 3)
+			seg = 3;
+		vector3df from = waypoints[seg];
+		vector3df to = waypoints[(seg + 1) % 4];
+		vector3df pos = from + (to - from) * (t - seg);
+
+		f32 h;
+		if (node->getHeightNormal(pos.X, pos.Z, &h, NULL_PTR))
+			height = h + CAMERA_HEIGHT;
+		pos.Y = height;
+
+		vector3df dir = to - from;
+		dir.Y = 0;
+		if (dir.getLength() > 0.0f)
+			cam->setDir(dir);
+		cam->setPosition(pos);
+		cam->recalculateAll();
+
+		if (!sceneMgr->beginFrame(true))
+			continue;
+
+		sceneMgr->drawAll(true);
+		sceneMgr->endFrame();
+
+		if (frame >= WARMUP_FRAMES)
+		{
+			SFramePerf perf;
+			sceneMgr->getFramePerf(perf);
+			const SNullDriverStats& driverStats = driver->getFrameStats();
+
+			stats[EBP_TICK].add(perf.tickTime);
+			stats[EBP_RENDER].add(perf.renderTime);
+			stats[EBP_TERRAIN].add(perf.terrainTime);
+			stats[EBP_WMO].add(perf.wmoTime);
+			stats[EBP_MESH].add(perf.meshTime);
+			stats[EBP_ALPHATEST].add(perf.alphaTestTime);
+			stats[EBP_TRANSPARENT].add(perf.transparentTime);
+			stats[EBP_WIRE3D].add(perf.wire3DTime);
+			stats[EBP_2D].add(perf.time2D);
+			stats[EBP_GPU].add(perf.gpuTime);
+			stats[EBP_DRAWCALL].add(driverStats.drawCall);
+			stats[EBP_PRIMITIVES].add(driverStats.primitivesDrawn);
+			stats[EBP_STATECHANGES].add(driverStats.getStateChanges());
+			stats[EBP_UPLOADBYTES].add(driverStats.getBytesUploaded());
+		}
+
+		++frame;
+	}
+
+	printf("%s (%d, %d): %u frames\n", mapRecord->name, row, col, numFrames);
+	printf("%-16s %12s %12s %12s\n", "", "avg", "min", "max");
+	for (u32 i=0; i<EBP_COUNT; ++i)
+	{
+		printf("%-16s %12.1f %12u %12u\n", g_phaseNames[i],
+			(double)stats[i].total / numFrames, stats[i].minValue, stats[i].maxValue);
+	}
+
+	fileWDT->drop();
+
+	return true;
+}
+
+//ʵı, ԭregisterVisibleM2Instancesÿdoodadжͬ
+static u32 cullReference(const std::vector<aabbox3df>& boxes, const std::vector<f32>& radius, const CInstanceBVH::SCullParam& param)
+{
+	u32 numVisible = 0;
+	for (u32 i=0; i<(u32)boxes.size(); ++i)
+	{
+		if (radius[i] == 0.0f)
+			continue;
+
+		if (param.visibleDistance > 0.0f &&
+			param.camPos.getDistanceFrom(boxes[i].getCenter()) / radius[i] > param.visibleDistance)
+			continue;
+
+		u32 p = 0;
+		for (; p<param.numPlanes; ++p)
+		{
+			if (ISREL3D_BACK == boxes[i].classifyPlaneRelation(param.planes[p]))
+				break;
+		}
+		if (p == param.numPlanes)
+			++numVisible;
+	}
+	return numVisible;
+}
+
+bool runCullBenchmark(const SMapRecord* mapRecord, s32 row, s32 col, u32 iterations)
+{
+	c8 mapname[QMAX_PATH];
+	Q_sprintf(mapname, QMAX_PATH, "World\\Maps\\%s\\%s.wdt", mapRecord->name, mapRecord->name);
+
+	IFileWDT* fileWDT = g_Engine->getResourceLoader()->loadWDT(mapname, mapRecord->id);
+	if (!fileWDT)
+	{
+		printf("%s open failed.\n", mapname);
+		return false;
+	}
+
+	STile* tile = fileWDT->getTile((u8)row, (u8)col);
+	if (!tile)
+	{
+		printf("tile (%d, %d) not found.\n", row, col);
+		fileWDT->drop();
+		return false;
+	}
+
+	g_Engine->initSceneManager();
+	ISceneManager* sceneMgr = g_Engine->getSceneManager();
+
+	ICamera* cam = sceneMgr->addCamera(vector3df(0, 5, -10), vector3df(0,0,0), vector3df(0,1,0), 1.0f, 2500.0f, PI/4.0f);
+	sceneMgr->setActiveCamera(cam);
+
+	IMapTileSceneNode* tileNode = sceneMgr->addMapTileSceneNode(fileWDT, tile, NULL_PTR);
+	matrix4 mat;
+	mat.setScale(g_Engine->getSceneRenderServices()->SCENE_SCALE);
+	tileNode->setRelativeTransformation(mat);
+	tileNode->update();
+	tileNode->addM2SceneNodes();
+	tileNode->addWMOSceneNodes();
+	tileNode->update();
+
+	//ռtileϵʵ
+	CInstanceBVH m2BVH;
+	CInstanceBVH wmoBVH;
+	std::vector<aabbox3df> m2Boxes, wmoBoxes;
+	std::vector<f32> m2Radius, wmoRadius;
+	for (PLENTRY e = tileNode->ChildNodeList.Flink; e != &tileNode->ChildNodeList; e = e->Flink)
+	{
+		ISceneNode* node = reinterpret_cast<ISceneNode*>CONTAINING_RECORD(e, ISceneNode, Link);
+		if (node->getType() == EST_M2)
+		{
+			aabbox3df box = static_cast<IM2SceneNode*>(node)->getWorldBoundingAABox();
+			vector3df ext = box.getExtent();
+			m2BVH.addInstance((u32)m2Boxes.size(), box, (ext.X + ext.Y + ext.Z) / 3);
+			m2Boxes.push_back(box);
+			m2Radius.push_back((ext.X + ext.Y + ext.Z) / 3);
+		}
+		else if (node->getType() == EST_WMO)
+		{
+			wmoBVH.addInstance((u32)wmoBoxes.size(), node->getWorldBoundingBox(), 1.0f);
+			wmoBoxes.push_back(node->getWorldBoundingBox());
+			wmoRadius.push_back(1.0f);
+		}
+	}
+
+	CTimer timer;
+	u32 buildTime = 0;
+	timer.beginPerf(true);
+	m2BVH.build();
+	wmoBVH.build();
+	timer.endPerf(true, buildTime);
+
+	std::vector<CInstanceBVH::SCullResult> results(m2Boxes.size() + wmoBoxes.size() + 1);
+
+	//tileԭתһȦ, ÿת̶Ƕ
+	vector3df center = tileNode->getCenter();
+	f32 h;
+	if (tileNode->getHeightNormal(center.X, center.Z, &h, NULL_PTR))
+		center.Y = h + CAMERA_HEIGHT;
+
+	f32 visibleDistance = g_Engine->getSceneRenderServices()->getObjectVisibleDistance();
+	f32 alphaDistance = g_Engine->getSceneRenderServices()->getObjectAlphaDistance();
+
+	std::vector<CInstanceBVH::SCullParam> params(iterations);
+	for (u32 i=0; i<iterations; ++i)
+	{
+		f32 angle = 2 * PI * i / iterations;
+		cam->setPosition(center);
+		cam->setDir(vector3df(cosf(angle), -0.2f, sinf(angle)));
+		cam->recalculateAll();
+
+		const frustum& f = cam->getViewFrustum();
+		CInstanceBVH::SCullParam& param = params[i];
+		param.planes[0] = cam->getTerrainClipPlane();
+		param.planes[1] = f.getPlane(VF_LEFT_PLANE);
+		param.planes[2] = f.getPlane(VF_RIGHT_PLANE);
+		param.planes[3] = f.getPlane(VF_TOP_PLANE);
+		param.planes[4] = f.getPlane(VF_BOTTOM_PLANE);
+		param.numPlanes = 5;
+		param.camPos = cam->getPosition();
+		param.visibleDistance = visibleDistance;
+		param.alphaDistance = alphaDistance;
+	}
+
+	//βüֻм΢, μʱ
+	u32 refTime = 0, bvhTime = 0;
+	u64 refVisible = 0, bvhVisible = 0;
+
+	timer.beginPerf(true);
+	for (u32 i=0; i<iterations; ++i)
+	{
+		CInstanceBVH::SCullParam param = params[i];
+		refVisible += cullReference(m2Boxes, m2Radius, param);
+		param.visibleDistance = 0.0f;
+		refVisible += cullReference(wmoBoxes, wmoRadius, param);
+	}
+	timer.endPerf(true, refTime);
+
+	timer.beginPerf(true);
+	for (u32 i=0; i<iterations; ++i)
+	{
+		CInstanceBVH::SCullParam param = params[i];
+		bvhVisible += m2BVH.cull(param, &results[0]);
+		param.visibleDistance = 0.0f;
+		bvhVisible += wmoBVH.cull(param, &results[0]);
+	}
+	timer.endPerf(true, bvhTime);
+
+	printf("%s (%d, %d): %u m2, %u wmo, %u iterations, bvh build %u us\n", mapRecord->name, row, col,
+		(u32)m2Boxes.size(), (u32)wmoBoxes.size(), iterations, buildTime);
+	printf("%-16s %12s %12s\n", "", "avg (us)", "visible");
+	printf("%-16s %12.2f %12.1f\n", "per instance", (double)refTime / iterations, (double)refVisible / iterations);
+	printf("%-16s %12.2f %12.1f\n", "bvh", (double)bvhTime / iterations, (double)bvhVisible / iterations);
+	if (refVisible != bvhVisible)
+		printf("visible count mismatch!\n");
+
+	fileWDT->drop();
+
+	return true;
+}
+
+//ѹԭͼȽ, rgbalphapsnr
+static void computePSNR(const u32* src, const u32* decoded, u32 count, double& rgbPSNR, double& alphaPSNR)
+{
+	double rgbError = 0, alphaError = 0;
+	for (u32 i=0; i<count; ++i)
+	{
+		for (u32 shift=0; shift<24; shift+=8)
+		{
+			double d = (double)((src[i] >> shift) & 0xff) - (double)((decoded[i] >> shift) & 0xff);
+			rgbError += d * d;
+		}
+		double d = (double)(src[i] >> 24) - (double)(decoded[i] >> 24);
+		alphaError += d * d;
+	}
+
+	rgbPSNR = rgbError > 0 ? 10.0 * log10(255.0 * 255.0 * 3 * count / rgbError) : 99.0;
+	alphaPSNR = alphaError > 0 ? 10.0 * log10(255.0 * 255.0 * count / alphaError) : 99.0;
+}
+
+bool runDXTBenchmark(const c8* filename, u32 iterations)
+{
+	IImage* image = g_Engine->getResourceLoader()->loadBLPAsImage(filename);
+	if (!image)
+	{
+		printf("%s open failed.\n", filename);
+		return false;
+	}
+
+	const dimension2du& size = image->getDimension();
+	if (image->getColorFormat() != ECF_A8R8G8B8 || size.Width % 4 || size.Height % 4)
+	{
+		printf("%s: only A8R8G8B8 images with 4 aligned size are supported.\n", filename);
+		image->drop();
+		return false;
+	}
+
+	u32 count = size.Width * size.Height;
+	std::vector<u32> src(count);
+	for (u32 y=0; y<size.Height; ++y)
+		memcpy(&src[y * size.Width], image->getData() + y * image->getPitch(), size.Width * sizeof(u32));
+	image->drop();
+
+	std::vector<u16> tmp565(count);
+	std::vector<u8> compressed(count);			//dxt5ÿ1ֽ
+	std::vector<u32> decoded(count);
+
+	printf("%s (%u x %u): %u iterations\n", filename, size.Width, size.Height, iterations);
+	printf("%-20s %12s %12s %12s\n", "", "avg (us)", "rgb psnr", "alpha psnr");
+
+	CTimer timer;
+	u32 time = 0;
+	double rgbPSNR, alphaPSNR;
+
+	//ԭCBLPImage::fromImageData·
+	timer.beginPerf(true);
+	for (u32 i=0; i<iterations; ++i)
+	{
+		CBlit::resizeBilinearA8R8G8B8(&src[0], size.Width, size.Height, &tmp565[0], size.Width, size.Height, ECF_R5G6B5);
+		DDSCompressRGB565ToDXT1((u8*)&tmp565[0], size.Width, size.Height, &compressed[0]);
+	}
+	timer.endPerf(true, time);
+	DDSDecompressDXT1(&compressed[0], size.Width, size.Height, (u8*)&decoded[0], false);
+	computePSNR(&src[0], &decoded[0], count, rgbPSNR, alphaPSNR);
+	printf("%-20s %12.1f %12.2f %12s\n", "565 dxt1", (double)time / iterations, rgbPSNR, "-");
+
+	static const c8* qualityNames[EDQ_COUNT] = { "fast", "normal", "high" };
+	c8 name[64];
+	for (u32 t=0; t<2; ++t)
+	{
+		CDXTEncoder encoder(t == 1);
+		for (u32 q=0; q<EDQ_COUNT; ++q)
+		{
+			for (u32 f=0; f<2; ++f)
+			{
+				ECOLOR_FORMAT format = f == 0 ? ECF_DXT1 : ECF_DXT5;
+				encoder.setQuality((E_DXT_QUALITY)q);
+
+				timer.beginPerf(true);
+				for (u32 i=0; i<iterations; ++i)
+					encoder.compress(&src[0], size.Width, size.Height, format, &compressed[0]);
+				timer.endPerf(true, time);
+
+				if (format == ECF_DXT1)
+					DDSDecompressDXT1(&compressed[0], size.Width, size.Height, (u8*)&decoded[0], false);
+				else
+					DDSDecompressDXT5(&compressed[0], size.Width, size.Height, (u8*)&decoded[0]);
+				computePSNR(&src[0], &decoded[0], count, rgbPSNR, alphaPSNR);
+
+				Q_sprintf(name, 64, "%s %s%s", format == ECF_DXT1 ? "dxt1" : "dxt5", qualityNames[q], t == 1 ? " mt" : "");
+				if (format == ECF_DXT1)
+					printf("%-20s %12.1f %12.2f %12s\n", name, (double)time / iterations, rgbPSNR, "-");
+				else
+					printf("%-20s %12.1f %12.2f %12.2f\n", name, (double)time / iterations, rgbPSNR, alphaPSNR);
+			}
+		}
+	}
+
+	return true;
+}
+
+typedef void (*BLIT_CONVERT_FUNC)(const void* sP, s32 sN, void* dP);
+
+struct SBlitPair
+{
+	const c8*		name;
+	BLIT_CONVERT_FUNC		func;
+	u32		srcBpp;
+	u32		dstBpp;
+};
+
+static const SBlitPair g_blitPairs[] =
+{
+	{ "A8R8G8B8->R5G6B5", CBlit::convert_A8R8G8B8toR5G6B5, 4, 2 },
+	{ "A8R8G8B8->A1R5G5B5", CBlit::convert_A8R8G8B8toA1R5G5B5, 4, 2 },
+	{ "R5G6B5->A8R8G8B8", CBlit::convert_R5G6B5toA8R8G8B8, 2, 4 },
+	{ "A1R5G5B5->A8R8G8B8", CBlit::convert_A1R5G5B5toA8R8G8B8, 2, 4 },
+	{ "R8G8B8->A8R8G8B8", CBlit::convert_R8G8B8toA8R8G8B8, 3, 4 },
+	{ "B8G8R8->A8R8G8B8", CBlit::convert_B8G8R8toA8R8G8B8, 3, 4 },
+	{ "A8R8G8B8->R8G8B8", CBlit::convert_A8R8G8B8toR8G8B8, 4, 3 },
+	{ "A8R8G8B8->B8G8R8", CBlit::convert_A8R8G8B8toB8G8R8, 4, 3 },
+	{ "R8G8B8->R5G6B5", CBlit::convert_R8G8B8toR5G6B5, 3, 2 },
+	{ "R8G8B8->A1R5G5B5", CBlit::convert_R8G8B8toA1R5G5B5, 3, 2 },
+};
+
+bool runBlitBenchmark(u32 iterations)
+{
+	static const c8* levelNames[EBS_COUNT] = { "scalar", "sse2", "ssse3", "avx2" };
+
+	E_BLIT_SIMD maxLevel = CBlit::getMaxSIMDLevel();
+	u32 count = BLIT_WIDTH * BLIT_HEIGHT;
+
+	//̶ӵ, ÿͬ
+	std::vector<u8> src(count * 4);
+	srand(1);
+	for (u32 i=0; i<(u32)src.size(); ++i)
+		src[i] = (u8)(rand() & 0xff);
+
+	std::vector<u8> reference(count * 4);
+	std::vector<u8> result(count * 4);
+
+	printf("%u x %u, %u iterations, max level %s (Mpixels/s)\n", BLIT_WIDTH, BLIT_HEIGHT, iterations, levelNames[maxLevel]);
+	printf("%-24s", "");
+	for (u32 l=0; l<EBS_COUNT; ++l)
+		printf(" %10s", levelNames[l]);
+	printf("\n");
+
+	CTimer timer;
+	bool allMatch = true;
+	u32 numPairs = sizeof(g_blitPairs) / sizeof(g_blitPairs[0]);
+	for (u32 k=0; k<numPairs + 2; ++k)
+	{
+		//Ϊ512x512˫ԷŴ1024x1024
+		bool resize = k >= numPairs;
+		ECOLOR_FORMAT resizeFormat = k == numPairs ? ECF_A8R8G8B8 : ECF_R5G6B5;
+		u32 outBytes = resize ? count * getBytesPerPixelFromFormat(resizeFormat) : count * g_blitPairs[k].dstBpp;
+
+		printf("%-24s", resize ? (resizeFormat == ECF_A8R8G8B8 ? "bilinear ->A8R8G8B8" : "bilinear ->R5G6B5") : g_blitPairs[k].name);
+
+		bool match = true;
+		for (u32 l=0; l<EBS_COUNT; ++l)
+		{
+			if (l > (u32)maxLevel)
+			{
+				printf(" %10s", "-");
+				continue;
+			}
+
+			CBlit::setSIMDLevel((E_BLIT_SIMD)l);
+			u8* out = l == EBS_SCALAR ? &reference[0] : &result[0];
+
+			u32 time = 0;
+			timer.beginPerf(true);
+			for (u32 i=0; i<iterations; ++i)
+			{
+				if (resize)
+					CBlit::resizeBilinearA8R8G8B8(&src[0], BLIT_WIDTH / 2, BLIT_HEIGHT / 2, out, BLIT_WIDTH, BLIT_HEIGHT, resizeFormat);
+				else
+					g_blitPairs[k].func(&src[0], (s32)count, out);
+			}
+			timer.endPerf(true, time);
+
+			if (l != EBS_SCALAR && memcmp(&reference[0], &result[0], outBytes) != 0)
+				match = false;
+
+			printf(" %10.1f", time ? (double)count * iterations / time : 0.0);
+		}
+
+		printf(match ? "\n" : "  mismatch!\n");
+		allMatch &= match;
+	}
+
+	CBlit::setSIMDLevel(maxLevel);
+
+	if (!allMatch)
+		printf("simd results differ from scalar!\n");
+
+	return allMatch;
+}
+
+//ļһ, pcmֽ
+static u32 readWholeStream(CAudioStream* stream, std::vector<u8>& buffer)
+{
+	u32 total = 0;
+	stream->rewind();
+	for (;;)
+	{
+		u32 n = stream->read(&buffer[0], (u32)buffer.size());
+		total += n;
+		if (n < (u32)buffer.size())
+			break;
+	}
+	return total;
+}
+
+bool runAudioBenchmark(const c8* filename, u32 numVoices, u32 seconds)
+{
+	c8 ext[10] = {0};
+	getFileExtensionA(filename, ext, 10);
+
+	E_SOUND_TYPE type;
+	if (Q_stricmp(ext, "wav") == 0)
+		type = EST_WAV;
+	else if (Q_stricmp(ext, "ogg") == 0)
+		type = EST_OGG;
+	else if (Q_stricmp(ext, "mp3") == 0)
+		type = EST_MP3;
+	else
+	{
+		printf("%s: only wav, ogg and mp3 are supported.\n", filename);
+		return false;
+	}
+
+	numVoices = min_(numVoices, (u32)CAudioMixer::MAX_VOICES);
+
+	CNullAudioPlayer player(AUDIO_SAMPLE_RATE, 16 * 1024 * 1024, 1024 * 1024);
+	CAudioDecodeServices* services = player.getDecodeServices();
+
+	std::vector<u8> buffer(64 * 1024);
+	CTimer timer;
+
+	//һβ: , Чͬʱ¼뻺
+	CAudioStream* stream = services->openStream(filename, type);
+	if (!stream)
+	{
+		printf("%s open failed.\n", filename);
+		return false;
+	}
+
+	u32 decodeTime = 0;
+	timer.beginPerf(true);
+	u32 pcmBytes = readWholeStream(stream, buffer);
+	timer.endPerf(true, decodeTime);
+
+	u32 bytesPerSecond = stream->SampleRate * stream->getSampleSize();
+	double length = bytesPerSecond ? (double)pcmBytes / bytesPerSecond : 0.0;
+	printf("%s: %u Hz, %u bit, %u channels, %.2f s\n", filename, stream->SampleRate, stream->BitsPerSample, stream->NumChannels, length);
+	services->closeStream(stream);
+
+	if (pcmBytes == 0)
+	{
+		printf("%s: no pcm data.\n", filename);
+		return false;
+	}
+
+	printf("%-20s %12s %12s\n", "", "time (us)", "x realtime");
+	printf("%-20s %12u %12.1f\n", "decode", decodeTime, decodeTime ? length * 1000000.0 / decodeTime : 0.0);
+
+	//ڶβ: ЧֱӴӻ濽
+	stream = services->openStream(filename, type);
+	u32 replayTime = 0;
+	timer.beginPerf(true);
+	readWholeStream(stream, buffer);
+	timer.endPerf(true, replayTime);
+	printf("%-20s %12u %12.1f\n", stream->isCached() ? "replay (cached)" : "replay (stream)", replayTime, replayTime ? length * 1000000.0 / replayTime : 0.0);
+	services->closeStream(stream);
+
+	//·ѭ, ߳ͬʱδstream
+	std::vector<CAudioStream*> streams;
+	std::vector<u32> voices;
+	for (u32 i=0; i<numVoices; ++i)
+	{
+		stream = services->openStream(filename, type);
+		if (!stream)
+			break;
+		stream->rewind();
+		stream->setLoop(true);
+		s32 voice = player.getMixer()->addVoice(stream, 1.0f / numVoices);
+		if (voice < 0)
+		{
+			services->closeStream(stream);
+			break;
+		}
+		streams.push_back(stream);
+		voices.push_back((u32)voice);
+	}
+
+	std::vector<s16> output(AUDIO_RENDER_FRAMES * 2);
+	u32 totalFrames = seconds * AUDIO_SAMPLE_RATE;
+	u32 mixTime = 0;
+	timer.beginPerf(true);
+	for (u32 frames=0; frames<totalFrames; frames+=AUDIO_RENDER_FRAMES)
+		player.render(AUDIO_RENDER_FRAMES, &output[0]);
+	timer.endPerf(true, mixTime);
+
+	c8 name[64];
+	Q_sprintf(name, 64, "mix %u voices", (u32)streams.size());
+	printf("%-20s %12u %12.1f\n", name, mixTime, mixTime ? (double)seconds * 1000000.0 / mixTime : 0.0);
+
+	for (u32 i=0; i<(u32)streams.size(); ++i)
+	{
+		player.getMixer()->removeVoice(voices[i]);
+		services->closeStream(streams[i]);
+	}
+
+	SAudioDecodeStats stats;
+	services->getStats(stats);
+	printf("cache: %u hits, %u misses, %u clips, %u bytes; %u underruns\n", stats.cacheHits, stats.cacheMisses, stats.numClips, stats.cacheSize, stats.underruns);
+
+	return true;
+}
+
+struct SIOFileList
+{
+	const c8*		ext;
+	std::vector<string_path>		files;
+};
+
+static void addIOFile(const c8* filename, void* args)
+{
+	SIOFileList* list = (SIOFileList*)args;
+	if (strlen(list->ext) == 0 || hasFileExtensionA(filename, list->ext))
+		list->files.push_back(filename);
+}
+
+//ϵͳļĻҳ, һζӴ̿ʼ
+static void purgeFileCache(const c8* filename)
+{
+	//ûʱ, Բ巽ʽ򿪻ļĻ
+	HANDLE hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL_PTR, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL_PTR);
+	if (hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile);
+}
+
+//ÿļķʽͷβһ, ֽ
+static u64 loadIOFiles(const SIOFileList& list, bool map, u32& checksum)
+{
+	IFileSystem* fs = g_Engine->getFileSystem();
+
+	u64 total = 0;
+	for (u32 i=0; i<(u32)list.files.size(); ++i)
+	{
+		IMemFile* file = fs->createMemFile(list.files[i].c_str(), list.files[i].c_str(), true, map);
+		if (!file)
+			continue;
+
+		const u8* p = file->getBuffer();
+		u32 size = file->getSize();
+		for (u32 k=0; k<size; k+=64)
+			checksum += p[k];
+
+		total += size;
+		delete file;
+	}
+	return total;
+}
+
+bool runIOBenchmark(const c8* dirname, const c8* ext, u32 iterations)
+{
+	SIOFileList list;
+	list.ext = ext;
+	Q_iterateFiles(dirname, "*", addIOFile, &list);
+
+	if (list.files.empty())
+	{
+		printf("%s: no files.\n", dirname);
+		return false;
+	}
+
+	printf("%s: %u files, %u iterations\n", dirname, (u32)list.files.size(), iterations);
+	printf("%-12s %12s %12s %12s\n", "", "time (ms)", "MB/s", "files/s");
+
+	CTimer timer;
+	u32 checksum[2] = { 0, 0 };
+	for (u32 m=0; m<2; ++m)
+	{
+		bool map = m == 1;
+		for (u32 w=0; w<2; ++w)
+		{
+			bool warm = w == 1;
+
+			u64 bytes = 0;
+			u32 time = 0;
+			for (u32 it=0; it<iterations; ++it)
+			{
+				if (!warm)
+				{
+					for (u32 i=0; i<(u32)list.files.size(); ++i)
+						purgeFileCache(list.files[i].c_str());
+				}
+				else if (it == 0)
+				{
+					u32 dummy = 0;
+					loadIOFiles(list, map, dummy);			//Ԥ
+				}
+
+				u32 t = 0;
+				timer.beginPerf(true);
+				bytes += loadIOFiles(list, map, checksum[m]);
+				timer.endPerf(true, t);
+				time += t;
+			}
+
+			c8 name[32];
+			Q_sprintf(name, 32, "%s %s", map ? "map" : "read", warm ? "warm" : "cold");
+			double seconds = (double)time / 1000000.0;
+			printf("%-12s %12.1f %12.1f %12.1f\n", name, (double)time / 1000.0 / iterations,
+				seconds > 0 ? (double)bytes / (1024 * 1024) / seconds : 0.0,
+				seconds > 0 ? (double)list.files.size() * iterations / seconds : 0.0);
+		}
+	}
+
+	if (checksum[0] != checksum[1])
+		printf("checksum mismatch!\n");
+
+	return checksum[0] == checksum[1];
+}
+
+//СС, ڵ, ַͽĽṹ
+static const u32 g_allocSizes[] = { 8, 12, 16, 24, 32, 40, 48, 64, 96, 128, 192, 256, 384 };
+
+struct SAllocShared
+{
+	bool		zone;			//zone, malloc
+	volatile int		stop;
+	lock_type		cs;
+	std::vector<void*>		handoff;			//loader, renderͷ
+};
+
+struct SAllocThread
+{
+	SAllocShared*		shared;
+	thread_type		thread;
+	u32		seed;
+	u64		ops;				//ͷŴ
+	u32		count;				//loader: , render: ֡
+	u64		totalTime;
+	u32		maxTime;
+};
+
+static inline u32 allocRandom(u32& seed)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+static inline void* allocSmall(bool zone, u32 size)
+{
+	return zone ? qzone_malloc(size) : malloc(size);
+}
+
+static inline void freeSmall(bool zone, void* p)
+{
+	if (zone)
+		qzone_free(p);
+	else
+		free(p);
+}
+
+static inline void* allocTemp(bool zone, u32 size)
+{
+	return zone ? Z_AllocateTempMemory(size) : malloc(size);
+}
+
+static inline void freeTemp(bool zone, void* p)
+{
+	if (zone)
+		Z_FreeTempMemory(p);
+	else
+		free(p);
+}
+
+//: ļ뻺ͽõʱ, С󽻸render߳
+static int allocLoaderThread(void* param)
+{
+	SAllocThread* t = (SAllocThread*)param;
+	SAllocShared* shared = t->shared;
+	bool zone = shared->zone;
+	void* objects[ALLOC_TASK_OBJECTS];
+
+	while (!ATOMIC_LOAD(&shared->stop))
+	{
+		u32 fileSize = 4 * 1024 + allocRandom(t->seed) % (508 * 1024);
+		u8* file = (u8*)allocTemp(zone, fileSize);
+		for (u32 i=0; i<fileSize; i+=4096)
+			file[i] = (u8)i;
+
+		u32 tableSize = 256 + allocRandom(t->seed) % (16 * 1024);
+		u8* table = (u8*)allocTemp(zone, tableSize);
+		memset(table, 0, tableSize);
+
+		for (u32 i=0; i<ALLOC_TASK_OBJECTS; ++i)
+		{
+			u32 size = g_allocSizes[allocRandom(t->seed) % ARRAY_COUNT(g_allocSizes)];
+			objects[i] = allocSmall(zone, size);
+			*(u32*)objects[i] = size;
+
+			//;ʱڵ
+			if (i % 4 == 0)
+			{
+				void* node = allocSmall(zone, 24);
+				freeSmall(zone, node);
+				t->ops += 2;
+			}
+		}
+
+		freeTemp(zone, table);
+		freeTemp(zone, file);
+
+		bool handoff;
+		BEGIN_LOCK(&shared->cs);
+		handoff = shared->handoff.size() < ALLOC_MAX_HANDOFF;
+		if (handoff)
+			shared->handoff.insert(shared->handoff.end(), objects, objects + ALLOC_TASK_OBJECTS);
+		END_LOCK(&shared->cs);
+
+		if (!handoff)
+		{
+			for (u32 i=0; i<ALLOC_TASK_OBJECTS; ++i)
+				freeSmall(zone, objects[i]);
+			t->ops += ALLOC_TASK_OBJECTS;
+		}
+
+		t->ops += 4 + ALLOC_TASK_OBJECTS;
+		++t->count;
+	}
+
+	return 0;
+}
+
+//ÿ֡ͷԼС, ͷloaderĶ
+static int allocRenderThread(void* param)
+{
+	SAllocThread* t = (SAllocThread*)param;
+	SAllocShared* shared = t->shared;
+	bool zone = shared->zone;
+	std::vector<void*> objects(ALLOC_FRAME_OBJECTS);
+	std::vector<void*> released;
+	CTimer timer;
+
+	while (!ATOMIC_LOAD(&shared->stop))
+	{
+		u32 time = 0;
+		timer.beginPerf(true);
+
+		for (u32 i=0; i<ALLOC_FRAME_OBJECTS; ++i)
+			objects[i] = allocSmall(zone, 16 + (allocRandom(t->seed) % 8) * 16);
+
+		BEGIN_LOCK(&shared->cs);
+		released.swap(shared->handoff);
+		END_LOCK(&shared->cs);
+
+		for (u32 i=0; i<(u32)released.size(); ++i)
+			freeSmall(zone, released[i]);
+		t->ops += released.size();
+		released.clear();
+
+		for (u32 i=0; i<ALLOC_FRAME_OBJECTS; ++i)
+			freeSmall(zone, objects[i]);
+		t->ops += ALLOC_FRAME_OBJECTS * 2;
+
+		timer.endPerf(true, time);
+		t->totalTime += time;
+		t->maxTime = max_(t->maxTime, time);
+		++t->count;
+	}
+
+	return 0;
+}
+
+bool runAllocBenchmark(u32 numThreads, u32 seconds)
+{
+	printf("%u loader threads + 1 render thread, %u s each\n", numThreads, seconds);
+	printf("%-8s %14s %12s %12s %14s %14s\n", "", "Mops/s", "tasks/s", "frames/s", "avg frame (us)", "max frame (us)");
+
+	CTimer timer;
+	for (u32 m=0; m<2; ++m)
+	{
+		SAllocShared shared;
+		shared.zone = m == 1;
+		shared.stop = 0;
+		INIT_LOCK(&shared.cs);
+
+		std::vector<SAllocThread> threads(numThreads + 1);
+		for (u32 i=0; i<(u32)threads.size(); ++i)
+		{
+			SAllocThread& t = threads[i];
+			memset(&t, 0, sizeof(SAllocThread));
+			t.shared = &shared;
+			t.seed = i + 1;
+		}
+
+		u32 elapsed = 0;
+		timer.beginPerf(true);
+		INIT_THREAD(&threads[0].thread, allocRenderThread, &threads[0], false);
+		for (u32 i=1; i<(u32)threads.size(); ++i)
+			INIT_THREAD(&threads[i].thread, allocLoaderThread, &threads[i], false);
+
+		SLEEP(seconds * 1000);
+		ATOMIC_COMPARE_EXCHANGE(&shared.stop, 1, 0);
+
+		for (u32 i=0; i<(u32)threads.size(); ++i)
+		{
+			WAIT_THREAD(&threads[i].thread);
+			DESTROY_THREAD(&threads[i].thread);
+		}
+		timer.endPerf(true, elapsed);
+
+		for (u32 i=0; i<(u32)shared.handoff.size(); ++i)
+			freeSmall(shared.zone, shared.handoff[i]);
+		DESTROY_LOCK(&shared.cs);
+
+		u64 ops = 0;
+		u32 tasks = 0;
+		for (u32 i=0; i<(u32)threads.size(); ++i)
+		{
+			ops += threads[i].ops;
+			if (i > 0)
+				tasks += threads[i].count;
+		}
+
+		const SAllocThread& render = threads[0];
+		double sec = elapsed ? (double)elapsed / 1000000.0 : 1.0;
+		printf("%-8s %14.2f %12.1f %12.1f %14.1f %14u\n", shared.zone ? "zone" : "malloc",
+			(double)ops / 1000000.0 / sec, tasks / sec, render.count / sec,
+			render.count ? (double)render.totalTime / render.count : 0.0, render.maxTime);
+	}
+
+	QMem_Info();
+
+	return true;
+}
+
+static void addMpqFile(const c8* filename, void* args)
+{
+	std::vector<string256>* files = (std::vector<string256>*)args;
+	files->push_back(filename);
+}
+
+//ҵļ, ڼַʽһ
+static u32 lookupMpqFiles(const std::vector<string256>& files, bool open, u32& time)
+{
+	wowEnvironment* env = g_Engine->getWowEnvironment();
+
+	CTimer timer;
+	u32 found = 0;
+	timer.beginPerf(true);
+	for (u32 i=0; i<(u32)files.size(); ++i)
+	{
+		if (open)
+		{
+			IMemFile* file = env->openFile(files[i].c_str());
+			if (file)
+			{
+				++found;
+				delete file;
+			}
+		}
+		else if (env->exists(files[i].c_str()))
+		{
+			++found;
+		}
+	}
+	timer.endPerf(true, time);
+	return found;
+}
+
+bool runMpqBenchmark(const c8* ext, u32 numLookups)
+{
+	wowEnvironment* env = g_Engine->getWowEnvironment();
+
+	std::vector<string256> all;
+	env->iterateFiles(ext, addMpqFile, &all);
+	if (all.empty())
+	{
+		printf("no %s files in mpq.\n", ext);
+		return false;
+	}
+
+	//ȡ, ļʱظ, ڵļͬһĿ¼, ģȱʧͼģ
+	u32 numFiles = max_(numLookups / 2, 1u);
+	std::vector<string256> hits;
+	std::vector<string256> misses;
+	hits.reserve(numFiles);
+	misses.reserve(numFiles);
+	for (u32 i=0; i<numFiles; ++i)
+	{
+		u32 k = numFiles <= (u32)all.size() ? (u32)((u64)i * all.size() / numFiles) : i % (u32)all.size();
+		hits.push_back(all[k]);
+
+		string256 missing = all[k];
+		missing.append("_missing");
+		misses.push_back(missing);
+	}
+	std::vector<string256> opens(hits.begin(), hits.begin() + min_(numFiles, (u32)MPQ_OPEN_FILES));
+
+	printf("%s: %u files in mpq, %u hit and %u miss lookups\n", ext, (u32)all.size(), (u32)hits.size(), (u32)misses.size());
+	printf("%-20s %12s %12s %10s\n", "", "linear (us)", "index (us)", "found");
+
+	const c8* names[] = { "exists hit", "exists miss", "open hit" };
+	bool same = true;
+	bool useIndex = env->isUseFileIndex();
+	for (u32 k=0; k<3; ++k)
+	{
+		const std::vector<string256>& files = k == 0 ? hits : (k == 1 ? misses : opens);
+		bool open = k == 2;
+
+		u32 time[2] = { 0, 0 };
+		u32 found[2] = { 0, 0 };
+		for (u32 m=0; m<2; ++m)
+		{
+			env->setUseFileIndex(m == 1);
+			u32 dummy = 0;
+			lookupMpqFiles(files, open, dummy);			//Ԥstormlibhash
+			found[m] = lookupMpqFiles(files, open, time[m]);
+		}
+
+		printf("%-20s %12.2f %12.2f %10u\n", names[k], (double)time[0] / files.size(), (double)time[1] / files.size(), found[1]);
+		if (found[0] != found[1])
+		{
+			printf("%s: linear found %u, index found %u!\n", names[k], found[0], found[1]);
+			same = false;
+		}
+	}
+	env->setUseFileIndex(useIndex);
+
+	return same;
+}
+
+enum E_REFCOUNT_MODE
+{
+	ERM_LOCKED = 0,			//ԭķʽ: жһȫ
+	ERM_ATOMIC,				//ԭӼ, cache
+	ERM_ATOMIC_CACHED,		//ԭӼ, cacheʱdrop߱ȽϽ
+
+	ERM_COUNT,
+};
+
+static const c8* g_refCountModeNames[ERM_COUNT] =
+{
+	"global lock",
+	"atomic",
+	"atomic cached",
+};
+
+class CBenchRefItem : public IReferenceCounted<CBenchRefItem>
+{
+protected:
+	virtual void onRemove() {}
+};
+
+struct SLockedRef
+{
+	s32		counter;
+};
+
+struct SRefCountShared
+{
+	E_REFCOUNT_MODE		mode;
+	u32		iterations;
+	volatile int		start;
+	lock_type		refCS;				//൱ԭg_Globals.refCS
+	SLockedRef		lockedRefs[REFCOUNT_OBJECTS];
+	CBenchRefItem*		items[REFCOUNT_OBJECTS];
+};
+
+struct SRefCountThread
+{
+	SRefCountShared*		shared;
+	thread_type		thread;
+	u32		index;
+};
+
+static int refCountThread(void* param)
+{
+	SRefCountThread* t = (SRefCountThread*)param;
+	SRefCountShared* shared = t->shared;
+
+	while (!ATOMIC_LOAD(&shared->start))
+		SLEEP(0);
+
+	for (u32 i=0; i<shared->iterations; ++i)
+	{
+		u32 k = (t->index + i) % REFCOUNT_OBJECTS;
+		if (shared->mode == ERM_LOCKED)
+		{
+			SLockedRef* ref = &shared->lockedRefs[k];
+
+			BEGIN_LOCK(&shared->refCS);
+			++ref->counter;
+			END_LOCK(&shared->refCS);
+
+			BEGIN_LOCK(&shared->refCS);
+			--ref->counter;
+			END_LOCK(&shared->refCS);
+		}
+		else
+		{
+			shared->items[k]->grab();
+			shared->items[k]->drop();
+		}
+	}
+
+	return 0;
+}
+
+bool runRefCountBenchmark(u32 maxThreads, u32 iterations)
+{
+	printf("%u grab/drop pairs per thread on %u shared objects\n", iterations, REFCOUNT_OBJECTS);
+	printf("%-8s", "threads");
+	for (u32 m=0; m<ERM_COUNT; ++m)
+		printf(" %20s", g_refCountModeNames[m]);
+	printf("   (ns per pair, Mpairs/s)\n");
+
+	CTimer timer;
+	bool ok = true;
+	for (u32 numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		printf("%-8u", numThreads);
+		for (u32 m=0; m<ERM_COUNT; ++m)
+		{
+			SRefCountShared shared;
+			shared.mode = (E_REFCOUNT_MODE)m;
+			shared.iterations = iterations;
+			shared.start = 0;
+			INIT_LOCK(&shared.refCS);
+
+			IResourceCache<CBenchRefItem> cache;
+			for (u32 k=0; k<REFCOUNT_OBJECTS; ++k)
+			{
+				shared.lockedRefs[k].counter = 1;
+				shared.items[k] = new CBenchRefItem;
+				if (m == ERM_ATOMIC_CACHED)
+				{
+					c8 name[32];
+					Q_sprintf(name, 32, "ref%u", k);
+					shared.items[k]->setFileName(name);
+					cache.addToCache(shared.items[k]);
+				}
+			}
+
+			std::vector<SRefCountThread> threads(numThreads);
+			for (u32 i=0; i<numThreads; ++i)
+			{
+				threads[i].shared = &shared;
+				threads[i].index = i;
+				INIT_THREAD(&threads[i].thread, refCountThread, &threads[i], false);
+			}
+
+			u32 elapsed = 0;
+			timer.beginPerf(true);
+			ATOMIC_COMPARE_EXCHANGE(&shared.start, 1, 0);
+			for (u32 i=0; i<numThreads; ++i)
+			{
+				WAIT_THREAD(&threads[i].thread);
+				DESTROY_THREAD(&threads[i].thread);
+			}
+			timer.endPerf(true, elapsed);
+
+			//ÿ߳grab/dropɶ, ʱӦصʼֵ
+			for (u32 k=0; k<REFCOUNT_OBJECTS; ++k)
+			{
+				s32 expected = m == ERM_ATOMIC_CACHED ? 2 : 1;
+				s32 count = m == ERM_LOCKED ? shared.lockedRefs[k].counter : shared.items[k]->getReferenceCount();
+				if (count != expected)
+					ok = false;
+				shared.items[k]->drop();
+			}
+			cache.flushCache();
+			DESTROY_LOCK(&shared.refCS);
+
+			double pairs = (double)iterations * numThreads;
+			double sec = elapsed ? (double)elapsed / 1000000.0 : 1.0;
+			c8 text[32];
+			Q_sprintf(text, 32, "%.1f, %.1f", (double)elapsed * 1000.0 / iterations, pairs / 1000000.0 / sec);
+			printf(" %20s", text);
+		}
+		printf("\n");
+	}
+
+	if (!ok)
+		printf("reference count mismatch!\n");
+
+	return ok;
+}
+
+struct SRefBoneHint
+{
+	s32		transHint;
+	s32		rotHint;
+	s32		scaleHint;
+};
+
+//ԭanimateBonesÿʵ״̬
+struct SRefBoneState
+{
+	std::vector<SDynBone>		bones;
+	std::vector<SRefBoneHint>		hints;
+	std::vector<u8>		calcs;
+	aabbox3df		box;
+	u32		lastTime;
+};
+
+//ԭcalcBone: ʹ˳ݹ㸸, ÿξ˷
+static void calcBoneReference(const IFileM2* mesh, SRefBoneState& state, u32 i, u32 anim, u32 time, bool enableScale)
+{
+	if (state.calcs[i])
+		return;
+
+	const SModelBone* b = &mesh->Bones[i];
+
+	matrix4 global, inverseGlobal;
+	global.setTranslation(b->pivot);
+	inverseGlobal.setTranslation(-b->pivot);
+
+	vector3df t(0,0,0);
+	vector3df s(1,1,1);
+	quaternion r(0,0,0,1);
+
+	SRefBoneHint& hint = state.hints[i];
+	SDynBone& bone = state.bones[i];
+	hint.transHint = b->trans.getValue(anim, time, t, hint.transHint);
+	bone.trans = t;
+	hint.rotHint = b->rot.getValue(anim, time, r, hint.rotHint);
+	bone.rot = r;
+	if (enableScale)
+	{
+		hint.scaleHint = b->scale.getValue(anim, time, s, hint.scaleHint);
+		bone.scale = s;
+	}
+
+	matrix4 m;
+	if (!b->billboard)
+	{
+		r.getMatrix(m);
+		m.setTranslation(t);
+		m.setScale(s);
+
+		m = inverseGlobal * m * global;
+	}
+
+	if (b->parent != -1)
+	{
+		calcBoneReference(mesh, state, (u32)b->parent, anim, time, enableScale);
+		bone.mat = m * state.bones[b->parent].mat;
+	}
+	else
+	{
+		bone.mat = m;
+	}
+
+	bone.transPivot = b->pivot;
+	bone.mat.transformVect(bone.transPivot);
+
+	if (b->parent != -1)
+		state.box.addInternalPoint(bone.transPivot);
+
+	state.calcs[i] = 1;
+}
+
+//ԭanimateBonesķǽɫ֧: ɼgeosetbone unit, ӺĹ
+static void animateBonesReference(wow_m2instance* inst, SRefBoneState& state, u32 anim, u32 time, matrix4* palette)
+{
+	IFileM2* mesh = inst->getMesh();
+
+	::memset(&state.calcs[0], 0, state.calcs.size());
+	if (time < state.lastTime)
+		::memset(&state.hints[0], 0, sizeof(SRefBoneHint) * state.hints.size());
+	state.lastTime = time;
+
+	state.box = static_cast<CFileM2*>(mesh)->getBoundingBox();
+
+	for (PLENTRY p = inst->VisibleGeosetList.Flink; p != &inst->VisibleGeosetList; p = p->Flink)
+	{
+		u32 c = (u32)(reinterpret_cast<SDynGeoset*>CONTAINING_RECORD(p, SDynGeoset, Link) - inst->DynGeosets);
+		if (inst->DynGeosets[c].NoAlpha)
+			continue;
+
+		const CGeoset* set = &inst->CurrentSkin->Geosets[c];
+		for (CGeoset::T_BoneUnits::const_iterator itr = set->BoneUnits.begin(); itr != set->BoneUnits.end(); ++itr)
+		{
+			for (u8 k=0; k<(*itr).BoneCount; ++k)
+			{
+				u8 idx = (*itr).local2globalMap[k];
+				calcBoneReference(mesh, state, idx, anim, time, true);
+				palette[idx] = state.bones[idx].mat;
+			}
+		}
+	}
+
+	if (inst->ShowParticles)
+	{
+		for (u32 c=0; c<mesh->NumParticleSystems; ++c)
+		{
+			s16 i = mesh->ParticleSystems[c].boneIndex;
+			if (i != -1)
+				calcBoneReference(mesh, state, (u32)(u8)i, anim, time, false);
+		}
+	}
+
+	if (inst->ShowRibbons)
+	{
+		for (u32 c=0; c<mesh->NumRibbonEmitters; ++c)
+		{
+			s16 i = mesh->RibbonEmitters[c].boneIndex;
+			if (i != -1)
+				calcBoneReference(mesh, state, (u32)(u8)i, anim, time, false);
+		}
+	}
+}
+
+bool runBonesBenchmark(const c8* filename, u32 numInstances, u32 numFrames)
+{
+	IFileM2* m2 = g_Engine->getResourceLoader()->loadM2(filename);
+	if (!m2)
+	{
+		printf("cannot load %s.\n", filename);
+		return false;
+	}
+
+	s16 anim = m2->getAnimationIndex("Stand");
+	if (anim == -1)
+		anim = 0;
+	u32 timeLength = m2->NumAnimations ? max_(m2->Animations[anim].timeLength, 1u) : 1;
+
+	std::vector<wow_m2instance*> instances(numInstances);
+	std::vector<SRefBoneState> states(numInstances);
+	for (u32 i=0; i<numInstances; ++i)
+	{
+		instances[i] = new wow_m2instance(m2, false);
+		instances[i]->setBoneLod(EBL_FINE);
+
+		states[i].bones.resize(m2->NumBones);
+		states[i].hints.resize(m2->NumBones);
+		states[i].calcs.resize(m2->NumBones);
+		::memset(&states[i].hints[0], 0, sizeof(SRefBoneHint) * m2->NumBones);
+		states[i].lastTime = 0;
+	}
+
+	bool character = instances[0]->CharacterInfo != NULL_PTR;
+	printf("%s: %u bones, anim %d (%u ms), %u instances, %u frames%s\n", filename, m2->NumBones, (s32)anim, timeLength,
+		numInstances, numFrames, character ? ", character (reference uses the non-character path)" : "");
+
+	//οʵֻǽɫ֧, ɫգۺȭͨͬ, ֻڷǽɫʱȽϽ
+	std::vector<matrix4> palette(256);
+	u32 mismatches = 0;
+	CTimer timer;
+	u32 time[2] = { 0, 0 };
+	for (u32 m=0; m<2; ++m)
+	{
+		timer.beginPerf(true);
+		for (u32 f=0; f<numFrames; ++f)
+		{
+			for (u32 i=0; i<numInstances; ++i)
+			{
+				u32 t = (f * BONES_FRAME_TIME + i * BONES_TIME_STAGGER) % timeLength;
+				if (m == 0)
+					animateBonesReference(instances[i], states[i], (u32)anim, t, &palette[0]);
+				else
+					instances[i]->animateBones((u32)anim, t, t, 1.0f);
+			}
+		}
+		timer.endPerf(true, time[m]);
+	}
+
+	if (!character)
+	{
+		for (u32 i=0; i<numInstances; ++i)
+		{
+			for (u32 k=0; k<m2->NumBones; ++k)
+			{
+				if (states[i].calcs[k] && !states[i].bones[k].mat.equals(instances[i]->DynBones[k].mat, 0.01f))
+					++mismatches;
+			}
+		}
+	}
+
+	u32 evals = numInstances * numFrames;
+	printf("%-20s %12s %12s\n", "", "frame (us)", "instance (us)");
+	printf("%-20s %12.2f %12.3f\n", "recursive", (double)time[0] / numFrames, (double)time[0] / evals);
+	printf("%-20s %12.2f %12.3f\n", "parent first", (double)time[1] / numFrames, (double)time[1] / evals);
+	if (time[1])
+		printf("speedup: %.2fx\n", (double)time[0] / time[1]);
+
+	for (u32 i=0; i<numInstances; ++i)
+		delete instances[i];
+	m2->drop();
+
+	if (mismatches)
+		printf("%u bone matrices differ from the reference!\n", mismatches);
+
+	return mismatches == 0;
+}
+
+//оȡ, ģˢnpcͻʱĲѯ
+static void sampleDbcKeys(const dbc* db, u32 field, u32 count, std::vector<u32>& keys)
+{
+	u32 step = max_(db->getNumRecords() / count, 1u);
+	for (u32 i=0; i<db->getNumRecords() && (u32)keys.size() < count; i+=step)
+	{
+		u32 key = db->getRecord(i).getUInt(field);
+		if (key)
+			keys.push_back(key);
+	}
+}
+
+//ԭķʽ: ÿβѯ
+static u32 lookupDbcLinear(const dbc* db, u32 field, const std::vector<u32>& keys, u32& checksum, u32& time)
+{
+	CTimer timer;
+	u32 found = 0;
+	checksum = 0;
+	timer.beginPerf(true);
+	for (u32 k=0; k<(u32)keys.size(); ++k)
+	{
+		for (u32 i=0; i<db->getNumRecords(); ++i)
+		{
+			if (db->getRecord(i).getUInt(field) == keys[k])
+			{
+				checksum += i;
+				++found;
+			}
+		}
+	}
+	timer.endPerf(true, time);
+	return found;
+}
+
+static u32 lookupDbcIndex(const dbc* db, u32 field, const std::vector<u32>& keys, u32& checksum, u32& time)
+{
+	CTimer timer;
+	u32 found = 0;
+	checksum = 0;
+	timer.beginPerf(true);
+	for (u32 k=0; k<(u32)keys.size(); ++k)
+	{
+		const u32* rows;
+		u32 count = db->findRows(field, keys[k], rows);
+		for (u32 i=0; i<count; ++i)
+		{
+			if (db->getRecord(rows[i]).getUInt(field) == keys[k])
+			{
+				checksum += rows[i];
+				++found;
+			}
+		}
+	}
+	timer.endPerf(true, time);
+	return found;
+}
+
+bool runDbcBenchmark(u32 numLookups)
+{
+	wowDatabase* database = g_Engine->getWowDatabase();
+	const npcModelItemSlotDisplayInfoDB* npcItemDB = database->getNpcModelItemSlotDisplayInfoDB();
+	const itemDisplayInfoMaterialResDB* materialResDB = database->getItemDisplayInfoMaterialResDB();
+	const charSectionsDB* charSectDB = database->getCharSectionDB();
+
+	struct SDbcQuery
+	{
+		const c8*		name;
+		const dbc*		db;
+		u32		field;
+		const dbc*		driver;				//ѯ
+		u32		driverField;
+	};
+
+	//npcװλ -> Ʒͼ -> ɫƤ, ζӦupdateNpcеβѯ
+	const SDbcQuery queries[] =
+	{
+		{ "npc item slots", npcItemDB, npcModelItemSlotDisplayInfoDB::NPCExtraID, database->getCreatureDisplayInfoDB(), creatureDisplayInfoDB::NPCExtraID },
+		{ "item material res", materialResDB, itemDisplayInfoMaterialResDB::ItemDisplayInfoID, npcItemDB, npcModelItemSlotDisplayInfoDB::ItemDisplayInfoID },
+		{ "char sections", charSectDB, charSectionsDB::Race, charSectDB, charSectionsDB::Race },
+	};
+
+	printf("%u lookups per table\n", numLookups);
+	printf("%-20s %10s %12s %12s %10s\n", "", "records", "linear (us)", "index (us)", "found");
+
+	bool same = true;
+	for (u32 q=0; q<sizeof(queries)/sizeof(queries[0]); ++q)
+	{
+		const SDbcQuery& query = queries[q];
+		if (!query.db || !query.driver || !query.db->getNumRecords())
+		{
+			printf("%-20s not loaded\n", query.name);
+			continue;
+		}
+
+		std::vector<u32> keys;
+		sampleDbcKeys(query.driver, query.driverField, numLookups, keys);
+		if (keys.empty())
+		{
+			printf("%-20s no keys\n", query.name);
+			continue;
+		}
+
+		u32 time[2] = { 0, 0 };
+		u32 checksum[2] = { 0, 0 };
+		u32 found[2];
+		found[0] = lookupDbcLinear(query.db, query.field, keys, checksum[0], time[0]);
+		found[1] = lookupDbcIndex(query.db, query.field, keys, checksum[1], time[1]);
+
+		printf("%-20s %10u %12.3f %12.3f %10u\n", query.name, query.db->getNumRecords(),
+			(double)time[0] / keys.size(), (double)time[1] / keys.size(), found[1]);
+		if (found[0] != found[1] || checksum[0] != checksum[1])
+		{
+			printf("%s: linear found %u, index found %u!\n", query.name, found[0], found[1]);
+			same = false;
+		}
+	}
+
+	return same;
+}